@@ -0,0 +1,441 @@
+#define WINGS_IMPL
+#include "wings.h"
+
+#include <stdint.h>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+// Runs interpreter workloads and prints one JSON object per benchmark to stdout.
+// Usage: bench [--iterations N] [name filters...]
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+	int iterations = 0;
+	std::vector<std::string> filters;
+};
+
+struct Result {
+	std::string name;
+	// The number of operations timed by each iteration, for C API benchmarks
+	int64_t ops = 1;
+	std::vector<double> times;
+	int64_t allocations = 0;
+	int64_t bytesAllocated = 0;
+	int64_t collections = 0;
+	int64_t pauseNanoseconds = 0;
+	int64_t maxPauseNanoseconds = 0;
+};
+
+static double Milliseconds(Clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static void PrintResult(const Result& result) {
+	std::vector<double> times = result.times;
+	std::sort(times.begin(), times.end());
+	double total = 0;
+	for (double time : times)
+		total += time;
+	double mean = total / times.size();
+	double median = times[times.size() / 2];
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(4);
+	ss << "{\"name\": \"" << result.name << "\""
+		<< ", \"iterations\": " << times.size()
+		<< ", \"ops\": " << result.ops
+		<< ", \"mean_ms\": " << mean
+		<< ", \"median_ms\": " << median
+		<< ", \"min_ms\": " << times.front()
+		<< ", \"max_ms\": " << times.back()
+		<< ", \"ns_per_op\": " << mean * 1e6 / result.ops
+		<< ", \"allocations_per_iteration\": " << result.allocations / (int64_t)times.size()
+		<< ", \"bytes_per_iteration\": " << result.bytesAllocated / (int64_t)times.size()
+		<< ", \"gc_collections\": " << result.collections
+		<< ", \"gc_pause_total_ms\": " << result.pauseNanoseconds / 1e6
+		<< ", \"gc_pause_max_ms\": " << result.maxPauseNanoseconds / 1e6
+		<< "}";
+	std::cout << ss.str() << std::endl;
+}
+
+static Wg_Context* CreateContext(int gcThreads = 0) {
+	Wg_Config cfg{};
+	Wg_DefaultConfig(&cfg);
+	cfg.maxRecursion = 1000;
+	cfg.gcThreads = gcThreads;
+	cfg.print = [](const char*, int, void*) {};
+	return Wg_CreateContext(&cfg);
+}
+
+// Accumulates the GC statistics of a context between two points in time
+class GCStatsDelta {
+public:
+	GCStatsDelta(Wg_Context* context) : context(context) {
+		Wg_GetGCStats(context, &start);
+
+		// The longest pause is not cumulative, so only count pauses from now on
+		Wg_SetGCCallback(context, [](Wg_Context* context, void* userdata) {
+			Wg_GCStats stats{};
+			Wg_GetGCStats(context, &stats);
+			int64_t& maxPause = *(int64_t*)userdata;
+			maxPause = std::max(maxPause, stats.lastPauseNanoseconds);
+			}, &maxPause);
+	}
+	~GCStatsDelta() {
+		Wg_SetGCCallback(context, nullptr);
+	}
+	void AddTo(Result& result) const {
+		Wg_GCStats end{};
+		Wg_GetGCStats(context, &end);
+		AddStats(result, end, start);
+		result.maxPauseNanoseconds = std::max(result.maxPauseNanoseconds, maxPause);
+	}
+	static void AddStats(Result& result, const Wg_GCStats& end, const Wg_GCStats& start) {
+		result.allocations += end.allocations - start.allocations;
+		result.bytesAllocated += end.bytesAllocated - start.bytesAllocated;
+		result.collections += end.collections - start.collections;
+		result.pauseNanoseconds += end.pauseNanoseconds - start.pauseNanoseconds;
+	}
+private:
+	Wg_Context* context;
+	Wg_GCStats start{};
+	int64_t maxPause = 0;
+};
+
+// Calls a compiled script once to warm up, then times it for a number of iterations
+static bool BenchScript(Result& result, const char* script, int iterations) {
+	Wg_Context* context = CreateContext();
+	Wg_Obj* fn = Wg_Compile(context, script, result.name.c_str());
+	bool success = fn && Wg_Call(fn, nullptr, 0);
+	if (success) {
+		Wg_IncRef(fn);
+		GCStatsDelta delta(context);
+		for (int i = 0; i < iterations && success; i++) {
+			auto start = Clock::now();
+			success = Wg_Call(fn, nullptr, 0) != nullptr;
+			result.times.push_back(Milliseconds(Clock::now() - start));
+		}
+		delta.AddTo(result);
+		Wg_DecRef(fn);
+	}
+
+	if (!success)
+		std::cerr << result.name << ": " << Wg_GetErrorMessage(context);
+	Wg_DestroyContext(context);
+	return success;
+}
+
+static bool BenchStartup(Result& result, int iterations) {
+	for (int i = 0; i < iterations; i++) {
+		auto start = Clock::now();
+		Wg_Context* context = CreateContext();
+		bool success = Wg_Execute(context, "x = [i for i in range(10)]", "startup");
+		result.times.push_back(Milliseconds(Clock::now() - start));
+
+		// The statistics start from zero, so the whole startup is included
+		Wg_GCStats stats{};
+		Wg_GetGCStats(context, &stats);
+		GCStatsDelta::AddStats(result, stats, {});
+		result.maxPauseNanoseconds = std::max(result.maxPauseNanoseconds, stats.maxPauseNanoseconds);
+
+		if (!success)
+			std::cerr << result.name << ": " << Wg_GetErrorMessage(context);
+		Wg_DestroyContext(context);
+		if (!success)
+			return false;
+	}
+	return true;
+}
+
+// Generates a large script similar to machine generated data and glue code
+static std::string GenerateScript(int functions) {
+	std::stringstream ss;
+	ss << "table = {\n";
+	for (int i = 0; i < functions; i++)
+		ss << "\t'key" << i << "': [" << i << ", " << i * 0.5 << ", 'value" << i << "'],\n";
+	ss << "}\n";
+	for (int i = 0; i < functions; i++) {
+		ss << "def handler" << i << "(event, scale=" << i << "):\n"
+			<< "\t# Generated handler\n"
+			<< "\tif event['kind'] == 'value" << i << "' and scale > 0:\n"
+			<< "\t\treturn table['key" << i << "'][0] * scale + len(event)\n"
+			<< "\tfor item in event.get('items', []):\n"
+			<< "\t\tscale += item if item % 2 else -item\n"
+			<< "\treturn scale\n";
+	}
+	return ss.str();
+}
+
+// Times compiling a large generated script, with one operation per source line
+static bool BenchCompile(Result& result, int iterations) {
+	std::string source = GenerateScript(2000);
+	result.ops = std::count(source.begin(), source.end(), '\n');
+
+	Wg_Context* context = CreateContext();
+	bool success = true;
+	for (int i = 0; i < iterations && success; i++) {
+		auto start = Clock::now();
+		success = Wg_CompileBuffer(context, source.data(), (int)source.size(), result.name.c_str()) != nullptr;
+		result.times.push_back(Milliseconds(Clock::now() - start));
+		Wg_CollectGarbage(context);
+	}
+
+	if (!success)
+		std::cerr << result.name << ": " << Wg_GetErrorMessage(context);
+	Wg_DestroyContext(context);
+	return success;
+}
+
+// Times a C API operation repeated result.ops times per iteration
+static bool BenchApi(Result& result, const char* setup, int iterations, const std::function<bool(Wg_Context*)>& body, int gcThreads = 0) {
+	Wg_Context* context = CreateContext(gcThreads);
+	bool success = Wg_Execute(context, setup, result.name.c_str());
+	if (success) {
+		GCStatsDelta delta(context);
+		for (int i = 0; i < iterations && success; i++) {
+			auto start = Clock::now();
+			success = body(context);
+			result.times.push_back(Milliseconds(Clock::now() - start));
+		}
+		delta.AddTo(result);
+	}
+
+	if (!success)
+		std::cerr << result.name << ": " << Wg_GetErrorMessage(context);
+	Wg_DestroyContext(context);
+	return success;
+}
+
+static const char* const FIB = R"(
+def fib(n):
+	if n < 2:
+		return n
+	return fib(n - 1) + fib(n - 2)
+fib(20)
+)";
+
+static const char* const NBODY = R"(
+import math
+class Body:
+	def __init__(self, x, y, z, vx, vy, vz, mass):
+		self.x = x
+		self.y = y
+		self.z = z
+		self.vx = vx
+		self.vy = vy
+		self.vz = vz
+		self.mass = mass
+def advance(bodies, dt, steps):
+	n = len(bodies)
+	for s in range(steps):
+		for i in range(n):
+			a = bodies[i]
+			for j in range(i + 1, n):
+				b = bodies[j]
+				dx = a.x - b.x
+				dy = a.y - b.y
+				dz = a.z - b.z
+				d2 = dx * dx + dy * dy + dz * dz
+				mag = dt / (d2 * math.sqrt(d2))
+				a.vx -= dx * b.mass * mag
+				a.vy -= dy * b.mass * mag
+				a.vz -= dz * b.mass * mag
+				b.vx += dx * a.mass * mag
+				b.vy += dy * a.mass * mag
+				b.vz += dz * a.mass * mag
+		for b in bodies:
+			b.x += dt * b.vx
+			b.y += dt * b.vy
+			b.z += dt * b.vz
+bodies = [
+	Body(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 39.47),
+	Body(4.84, -1.16, -0.10, 0.60, 2.81, -0.02, 0.037),
+	Body(8.34, 4.12, -0.40, -1.01, 1.82, 0.008, 0.011),
+	Body(12.89, -15.11, -0.22, 1.08, 0.86, -0.01, 0.0017),
+	Body(15.37, -25.91, 0.17, 0.97, 0.59, -0.03, 0.002),
+]
+advance(bodies, 0.01, 200)
+)";
+
+static const char* const STRINGS = R"(
+parts = []
+for i in range(2000):
+	parts.append(str(i))
+joined = ",".join(parts)
+total = 0
+for part in joined.split(","):
+	total += len(part)
+built = ""
+for i in range(500):
+	built += "ab"
+changed = joined.upper().replace("1", "x")
+words = ("the quick brown fox " * 100).split()
+)";
+
+static const char* const DICTS = R"(
+d = {}
+for i in range(5000):
+	d[str(i)] = i
+for i in range(0, 5000, 2):
+	d.pop(str(i))
+total = 0
+for k in d:
+	total += d[k]
+s = set()
+for i in range(5000):
+	s.add(i * 7 % 1000)
+for i in range(500):
+	s.discard(i)
+)";
+
+static const char* const METHODS = R"(
+class Shape:
+	def area(self):
+		return 0
+	def scaled(self, k):
+		return self.area() * k
+class Square(Shape):
+	def __init__(self, side):
+		self.side = side
+	def area(self):
+		return self.side * self.side
+class Circle(Shape):
+	def __init__(self, radius):
+		self.radius = radius
+	def area(self):
+		return 3 * self.radius * self.radius
+shapes = []
+for i in range(100):
+	if i % 2:
+		shapes.append(Square(i))
+	else:
+		shapes.append(Circle(i))
+total = 0
+for k in range(50):
+	for shape in shapes:
+		total += shape.scaled(2)
+)";
+
+static const char* const EXCEPTIONS = R"(
+def check(i):
+	if i % 3 == 0:
+		raise ValueError("bad value")
+	return i
+total = 0
+for i in range(3000):
+	try:
+		total += check(i)
+	except ValueError:
+		total -= 1
+	finally:
+		total += 1
+)";
+
+struct Benchmark {
+	const char* name;
+	int iterations;
+	std::function<bool(Result&, int)> run;
+};
+
+static std::vector<Benchmark> GetBenchmarks() {
+	auto script = [](const char* code) {
+		return [code](Result& result, int iterations) { return BenchScript(result, code, iterations); };
+	};
+
+	// Full collections of a heap of 200000 live objects
+	auto collect = [](int gcThreads) {
+		return [gcThreads](Result& result, int iterations) {
+			const char* setup = "live = []\nfor i in range(100000):\n\tlive.append([i])";
+			return BenchApi(result, setup, iterations, [](Wg_Context* context) {
+				Wg_CollectGarbage(context);
+				return true;
+			}, gcThreads);
+		};
+	};
+
+	constexpr int64_t API_OPS = 100'000;
+	return {
+		{ "fib", 20, script(FIB) },
+		{ "nbody", 20, script(NBODY) },
+		{ "strings", 50, script(STRINGS) },
+		{ "dict_set_churn", 50, script(DICTS) },
+		{ "method_dispatch", 50, script(METHODS) },
+		{ "exceptions", 20, script(EXCEPTIONS) },
+		{ "startup", 50, BenchStartup },
+		{ "compile_generated", 20, BenchCompile },
+		{ "api_call", 20, [](Result& result, int iterations) {
+			result.ops = API_OPS;
+			return BenchApi(result, "def f(x):\n\treturn x", iterations, [](Wg_Context* context) {
+				Wg_Obj* fn = Wg_GetGlobal(context, "f");
+				Wg_Obj* arg = Wg_NewInt(context, 1000);
+				if (fn == nullptr || arg == nullptr)
+					return false;
+
+				Wg_IncRef(arg);
+				bool success = true;
+				for (int64_t i = 0; i < API_OPS && success; i++)
+					success = Wg_Call(fn, &arg, 1) != nullptr;
+				Wg_DecRef(arg);
+				return success;
+			});
+		} },
+		{ "api_new_int", 20, [](Result& result, int iterations) {
+			result.ops = API_OPS;
+			return BenchApi(result, "", iterations, [](Wg_Context* context) {
+				for (int64_t i = 0; i < API_OPS; i++)
+					if (Wg_NewInt(context, 1000 + i) == nullptr)
+						return false;
+				return true;
+			});
+		} },
+		{ "api_collect_garbage", 20, collect(0) },
+		{ "api_collect_garbage_parallel", 20, collect(3) },
+	};
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+			options.iterations = std::max(1, atoi(argv[++i]));
+		} else if (argv[i][0] == '-') {
+			std::cerr << "Usage: " << argv[0] << " [--iterations N] [name filters...]" << std::endl;
+			return false;
+		} else {
+			options.filters.push_back(argv[i]);
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+		return 1;
+
+	bool success = true;
+	for (const auto& benchmark : GetBenchmarks()) {
+		std::string name = benchmark.name;
+		bool selected = options.filters.empty() || std::any_of(options.filters.begin(), options.filters.end(),
+			[&](const std::string& filter) { return name.find(filter) != std::string::npos; });
+		if (!selected)
+			continue;
+
+		Result result;
+		result.name = name;
+		int iterations = options.iterations ? options.iterations : benchmark.iterations;
+		if (benchmark.run(result, iterations)) {
+			PrintResult(result);
+		} else {
+			success = false;
+		}
+	}
+	return success ? 0 : 1;
+}
@@ -14,6 +14,42 @@ namespace Wings {
 			public override int GetHashCode() => _data.GetHashCode();
 		}
 
+		public struct Snapshot {
+			public IntPtr _data;
+			public static implicit operator bool(Snapshot a) => a._data != IntPtr.Zero;
+			public static bool operator==(Snapshot a, Snapshot b) => a._data == b._data;
+			public static bool operator!=(Snapshot a, Snapshot b) => !(a == b);
+			public override bool Equals(Object? a) => a is Snapshot b && this == b;
+			public override int GetHashCode() => _data.GetHashCode();
+		}
+
+		public struct ContextPool {
+			public IntPtr _data;
+			public static implicit operator bool(ContextPool a) => a._data != IntPtr.Zero;
+			public static bool operator==(ContextPool a, ContextPool b) => a._data == b._data;
+			public static bool operator!=(ContextPool a, ContextPool b) => !(a == b);
+			public override bool Equals(Object? a) => a is ContextPool b && this == b;
+			public override int GetHashCode() => _data.GetHashCode();
+		}
+
+		public struct Future {
+			public IntPtr _data;
+			public static implicit operator bool(Future a) => a._data != IntPtr.Zero;
+			public static bool operator==(Future a, Future b) => a._data == b._data;
+			public static bool operator!=(Future a, Future b) => !(a == b);
+			public override bool Equals(Object? a) => a is Future b && this == b;
+			public override int GetHashCode() => _data.GetHashCode();
+		}
+
+		public struct Program {
+			public IntPtr _data;
+			public static implicit operator bool(Program a) => a._data != IntPtr.Zero;
+			public static bool operator==(Program a, Program b) => a._data == b._data;
+			public static bool operator!=(Program a, Program b) => !(a == b);
+			public override bool Equals(Object? a) => a is Program b && this == b;
+			public override int GetHashCode() => _data.GetHashCode();
+		}
+
 		public struct Obj {
 			public IntPtr _data;
 			public static implicit operator bool(Obj a) => a._data != IntPtr.Zero;
@@ -36,27 +72,39 @@ namespace Wings {
 		[UnmanagedFunctionPointer(CallingConvention.Cdecl)]
 		[return: MarshalAs(UnmanagedType.U1)]
 		public delegate bool ModuleLoader(Context context);
+		[UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+		public delegate void GCCallback(Context context, IntPtr userdata);
 		
 
 		[StructLayout(LayoutKind.Sequential, Pack=1)]
 		private struct Wg_ConfigNative {
 			public byte enableOSAccess;
 			public int maxAlloc;
+			public long maxBytes;
 			public int maxRecursion;
 			public float gcRunFactor;
+			public int gcNurserySize;
+			public int gcThreads;
 			public IntPtr print;
 			public IntPtr printUserdata;
 			public IntPtr importPath;
+			public byte enableBytecodeCache;
+			public int optimizationLevel;
 			public IntPtr argv;
 			public int argc;
 			public Wg_ConfigNative(Config src) {
 				enableOSAccess = (byte)(src.enableOSAccess ? 1 : 0);
 				maxAlloc = src.maxAlloc;
+				maxBytes = src.maxBytes;
 				maxRecursion = src.maxRecursion;
 				gcRunFactor = src.gcRunFactor;
+				gcNurserySize = src.gcNurserySize;
+				gcThreads = src.gcThreads;
 				print = src.print is null ? IntPtr.Zero : Marshal.GetFunctionPointerForDelegate(src.print);
 				printUserdata = src.printUserdata;
 				importPath = Marshal.StringToHGlobalAnsi(src.importPath);
+				enableBytecodeCache = (byte)(src.enableBytecodeCache ? 1 : 0);
+				optimizationLevel = src.optimizationLevel;
 				if (src.argv is null) {
 					argv = default;
 				} else {
@@ -82,11 +130,16 @@ namespace Wings {
 			var dst = new Config();
 			dst.enableOSAccess = src.enableOSAccess != 0;
 			dst.maxAlloc = src.maxAlloc;
+			dst.maxBytes = src.maxBytes;
 			dst.maxRecursion = src.maxRecursion;
 			dst.gcRunFactor = src.gcRunFactor;
+			dst.gcNurserySize = src.gcNurserySize;
+			dst.gcThreads = src.gcThreads;
 			dst.print = src.print == IntPtr.Zero ? null : Marshal.GetDelegateForFunctionPointer<PrintFunction>(src.print);
 			dst.printUserdata = src.printUserdata;
 			dst.importPath = null;
+			dst.enableBytecodeCache = src.enableBytecodeCache != 0;
+			dst.optimizationLevel = src.optimizationLevel;
 			dst.argv = null;
 			dst.argc = src.argc;
 			return dst;
@@ -108,6 +161,14 @@ namespace Wings {
 			/// </summary>
 			public int maxAlloc;
 			/// <summary>
+			/// The approximate number of bytes that objects may use
+			/// before a MemoryError will be raised.
+			/// </summary>
+			/// <see>
+			/// GetGCStats
+			/// </see>
+			public long maxBytes;
+			/// <summary>
 			/// The maximum recursion depth allowed before a RecursionError will be raised.
 			/// </summary>
 			public int maxRecursion;
@@ -116,6 +177,22 @@ namespace Wings {
 			/// </summary>
 			public float gcRunFactor;
 			/// <summary>
+			/// The number of newly allocated objects that triggers a collection
+			/// of the young generation only.
+			/// </summary>
+			/// <see>
+			/// gcRunFactor
+			/// </see>
+			public int gcNurserySize;
+			/// <summary>
+			/// The number of helper threads that mark and sweep together with the
+			/// owning thread during a full collection.
+			/// </summary>
+			/// <see>
+			/// gcNurserySize
+			/// </see>
+			public int gcThreads;
+			/// <summary>
 			/// The callback to be invoked when print is called in the interpreter.
 			/// If this is null, then print messages are discarded.
 			/// </summary>
@@ -134,6 +211,17 @@ namespace Wings {
 			/// </summary>
 			public string? importPath;
 			/// <summary>
+			/// Caches the compiled form of imported file modules.
+			/// </summary>
+			/// <see>
+			/// importPath
+			/// </see>
+			public bool enableBytecodeCache;
+			/// <summary>
+			/// The amount of optimization applied when compiling scripts.
+			/// </summary>
+			public int optimizationLevel;
+			/// <summary>
 			/// The commandline arguments passed to the interpreter.
 			/// If argc is 0, then this can be null.
 			/// </summary>
@@ -145,6 +233,153 @@ namespace Wings {
 			public int argc;
 		}
 
+		[StructLayout(LayoutKind.Sequential, Pack=1)]
+		private struct Wg_GCStatsNative {
+			public long collections;
+			public long youngCollections;
+			public long allocations;
+			public long bytesAllocated;
+			public long objects;
+			public long bytes;
+			public long bytesAfterCollection;
+			public long bytesSinceCollection;
+			public long pauseNanoseconds;
+			public long maxPauseNanoseconds;
+			public long lastPauseNanoseconds;
+			public Wg_GCStatsNative(GCStats src) {
+				collections = src.collections;
+				youngCollections = src.youngCollections;
+				allocations = src.allocations;
+				bytesAllocated = src.bytesAllocated;
+				objects = src.objects;
+				bytes = src.bytes;
+				bytesAfterCollection = src.bytesAfterCollection;
+				bytesSinceCollection = src.bytesSinceCollection;
+				pauseNanoseconds = src.pauseNanoseconds;
+				maxPauseNanoseconds = src.maxPauseNanoseconds;
+				lastPauseNanoseconds = src.lastPauseNanoseconds;
+			}
+			public void Free(GCStats src) {
+			}
+		}
+
+		private static GCStats MakeWg_GCStats(Wg_GCStatsNative src) {
+			var dst = new GCStats();
+			dst.collections = src.collections;
+			dst.youngCollections = src.youngCollections;
+			dst.allocations = src.allocations;
+			dst.bytesAllocated = src.bytesAllocated;
+			dst.objects = src.objects;
+			dst.bytes = src.bytes;
+			dst.bytesAfterCollection = src.bytesAfterCollection;
+			dst.bytesSinceCollection = src.bytesSinceCollection;
+			dst.pauseNanoseconds = src.pauseNanoseconds;
+			dst.maxPauseNanoseconds = src.maxPauseNanoseconds;
+			dst.lastPauseNanoseconds = src.lastPauseNanoseconds;
+			return dst;
+		}
+		public struct GCStats {
+			/// <summary>
+			/// The number of collections, including young collections.
+			/// </summary>
+			public long collections;
+			/// <summary>
+			/// The number of collections of the young generation only.
+			/// </summary>
+			public long youngCollections;
+			/// <summary>
+			/// The total number of objects allocated.
+			/// </summary>
+			public long allocations;
+			/// <summary>
+			/// The total number of bytes allocated.
+			/// </summary>
+			public long bytesAllocated;
+			/// <summary>
+			/// The number of objects currently allocated.
+			/// </summary>
+			public long objects;
+			/// <summary>
+			/// The approximate number of bytes currently in use.
+			/// </summary>
+			public long bytes;
+			/// <summary>
+			/// The number of bytes in use after the last full collection.
+			/// </summary>
+			public long bytesAfterCollection;
+			/// <summary>
+			/// The number of bytes allocated since the last full collection.
+			/// </summary>
+			public long bytesSinceCollection;
+			/// <summary>
+			/// The total time spent collecting garbage in nanoseconds.
+			/// </summary>
+			public long pauseNanoseconds;
+			/// <summary>
+			/// The longest collection in nanoseconds.
+			/// </summary>
+			public long maxPauseNanoseconds;
+			/// <summary>
+			/// The duration of the last collection in nanoseconds.
+			/// </summary>
+			public long lastPauseNanoseconds;
+		}
+
+		public enum GCType {
+			/// <summary>
+			/// None
+			/// </summary>
+			NONE,
+			/// <summary>
+			/// bool
+			/// </summary>
+			BOOL,
+			/// <summary>
+			/// int
+			/// </summary>
+			INT,
+			/// <summary>
+			/// float
+			/// </summary>
+			FLOAT,
+			/// <summary>
+			/// str
+			/// </summary>
+			STR,
+			/// <summary>
+			/// tuple
+			/// </summary>
+			TUPLE,
+			/// <summary>
+			/// list
+			/// </summary>
+			LIST,
+			/// <summary>
+			/// dict
+			/// </summary>
+			DICT,
+			/// <summary>
+			/// set
+			/// </summary>
+			SET,
+			/// <summary>
+			/// Functions and bound methods
+			/// </summary>
+			FUNCTION,
+			/// <summary>
+			/// Classes
+			/// </summary>
+			CLASS,
+			/// <summary>
+			/// Instances of every other class
+			/// </summary>
+			OBJECT,
+			/// <summary>
+			/// The number of categories
+			/// </summary>
+			TYPE_COUNT,
+		}
+
 		public enum UnOp {
 			/// <summary>
 			/// The identity operator
@@ -422,118 +657,141 @@ namespace Wings {
 		private static extern unsafe void Wg_DestroyContext(Context context);
 
 		/// <summary>
-		/// Get the default configuration.
+		/// Freeze the state of a context so that new contexts can be created from it.
 		/// </summary>
-		/// <param name="config">
-		/// The returned default configuration.
+		/// <param name="context">
+		/// The context to snapshot.
 		/// </param>
+		/// <returns>
+		/// The snapshot, or null on failure.
+		/// </returns>
 		/// <see>
-		/// CreateContext
+		/// CreateContextFromSnapshot
 		/// </see>
-		public static void DefaultConfig(out Config config) {
+		public static Snapshot SnapshotContext(Context context) {
 			unsafe {
-				Wg_DefaultConfig(out var _config);
-				config = MakeWg_Config(_config);
+				Snapshot r;
+				r = Wg_SnapshotContext(context);
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_DefaultConfig(out Wg_ConfigNative config);
+		private static extern unsafe Snapshot Wg_SnapshotContext(Context context);
 
 		/// <summary>
-		/// Execute a script.
+		/// Create an instance of an interpreter from a snapshot.
 		/// </summary>
-		/// <param name="context">
-		/// The associated context.
-		/// </param>
-		/// <param name="script">
-		/// The script to execute.
-		/// </param>
-		/// <param name="prettyName">
-		/// The name to run the script under, or null to use a default name.
+		/// <param name="snapshot">
+		/// The snapshot to copy.
 		/// </param>
 		/// <returns>
-		/// A boolean indicating whether the script compiled and executed successfully.
+		/// A newly created context, or null if a dictionary key could not be rehashed.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// SnapshotContext
 		/// </see>
-		public static bool Execute(Context context, string script, string? prettyName = default) {
+		public static Context CreateContextFromSnapshot(Snapshot snapshot) {
 			unsafe {
-				bool r;
-				fixed (byte* _script = script is null ? null : Encoding.ASCII.GetBytes(script + '\0')) {
-					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
-						r = Wg_Execute(context, (IntPtr)_script, (IntPtr)_prettyName) != 0;
-					}
-				}
+				Context r;
+				r = Wg_CreateContextFromSnapshot(snapshot);
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe byte Wg_Execute(Context context, IntPtr script, IntPtr prettyName);
+		private static extern unsafe Context Wg_CreateContextFromSnapshot(Snapshot snapshot);
 
 		/// <summary>
-		/// Execute a script containing an expression.
+		/// Free a snapshot created with SnapshotContext().
 		/// </summary>
-		/// <param name="context">
-		/// The associated context.
+		/// <param name="snapshot">
+		/// The snapshot to free.
 		/// </param>
-		/// <param name="script">
-		/// The expression to execute.
+		public static void DestroySnapshot(Snapshot snapshot) {
+			unsafe {
+				Wg_DestroySnapshot(snapshot);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_DestroySnapshot(Snapshot snapshot);
+
+		/// <summary>
+		/// Create a pool of worker threads that each own a context.
+		/// </summary>
+		/// <param name="config">
+		/// The configuration of the worker contexts, or null to use the default configuration.
+		/// Ignored if a snapshot is given.
 		/// </param>
-		/// <param name="prettyName">
-		/// The name to run the script under, or null to use a default name.
+		/// <param name="snapshot">
+		/// A snapshot to create the worker contexts from, or null to create fresh contexts.
+		/// </param>
+		/// <param name="threadCount">
+		/// The number of worker threads, or 0 to use the number of hardware threads.
 		/// </param>
 		/// <returns>
-		/// The result of executing the expression, or null on failure.
+		/// The newly created pool, or null if a worker context could not be created.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// SubmitExecute
+		/// SubmitExecuteExpression
+		/// SubmitCall
 		/// </see>
-		public static Obj ExecuteExpression(Context context, string script, string? prettyName = default) {
+		public static ContextPool CreateContextPool(Config? config = default, Snapshot snapshot = default, int threadCount = default) {
 			unsafe {
-				Obj r;
-				fixed (byte* _script = script is null ? null : Encoding.ASCII.GetBytes(script + '\0')) {
-					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
-						r = Wg_ExecuteExpression(context, (IntPtr)_script, (IntPtr)_prettyName);
-					}
+				ContextPool r;
+				var _config = config is null ? new() : new Wg_ConfigNative(config.Value);
+				r = Wg_CreateContextPool(config is null ? IntPtr.Zero : new IntPtr(&_config), snapshot, threadCount);
+				if (config != null) {
+					_config.Free(config.Value);
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_ExecuteExpression(Context context, IntPtr script, IntPtr prettyName);
+		private static extern unsafe ContextPool Wg_CreateContextPool(IntPtr config, Snapshot snapshot, int threadCount);
 
 		/// <summary>
-		/// Compile a script into a function object.
+		/// Free a context pool.
 		/// </summary>
-		/// <param name="context">
-		/// The associated context.
+		/// <param name="pool">
+		/// The pool to free.
+		/// </param>
+		public static void DestroyContextPool(ContextPool pool) {
+			unsafe {
+				Wg_DestroyContextPool(pool);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_DestroyContextPool(ContextPool pool);
+
+		/// <summary>
+		/// Submit a script to be executed by a context pool.
+		/// </summary>
+		/// <param name="pool">
+		/// The pool to run the script.
 		/// </param>
 		/// <param name="script">
-		/// The script to compile.
+		/// The script to execute.
 		/// </param>
 		/// <param name="prettyName">
 		/// The name to run the script under, or null to use a default name.
 		/// </param>
 		/// <returns>
-		/// A function object, or null on failure.
+		/// The future of the job.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
-		/// Call
+		/// Execute
 		/// </see>
-		public static Obj Compile(Context context, string script, string? prettyName = default) {
+		public static Future SubmitExecute(ContextPool pool, string script, string? prettyName = default) {
 			unsafe {
-				Obj r;
+				Future r;
 				fixed (byte* _script = script is null ? null : Encoding.ASCII.GetBytes(script + '\0')) {
 					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
-						r = Wg_Compile(context, (IntPtr)_script, (IntPtr)_prettyName);
+						r = Wg_SubmitExecute(pool, (IntPtr)_script, (IntPtr)_prettyName);
 					}
 				}
 				return r;
@@ -541,34 +799,32 @@ namespace Wings {
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_Compile(Context context, IntPtr script, IntPtr prettyName);
+		private static extern unsafe Future Wg_SubmitExecute(ContextPool pool, IntPtr script, IntPtr prettyName);
 
 		/// <summary>
-		/// Compile an expression into a function object.
+		/// Submit an expression to be evaluated by a context pool.
 		/// </summary>
-		/// <param name="context">
-		/// The associated context.
+		/// <param name="pool">
+		/// The pool to evaluate the expression.
 		/// </param>
 		/// <param name="script">
-		/// The expression to compile.
+		/// The expression to evaluate.
 		/// </param>
 		/// <param name="prettyName">
 		/// The name to run the script under, or null to use a default name.
 		/// </param>
 		/// <returns>
-		/// A function object, or null on failure.
+		/// The future of the job.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
-		/// Call
+		/// ExecuteExpression
 		/// </see>
-		public static Obj CompileExpression(Context context, string script, string? prettyName = default) {
+		public static Future SubmitExecuteExpression(ContextPool pool, string script, string? prettyName = default) {
 			unsafe {
-				Obj r;
+				Future r;
 				fixed (byte* _script = script is null ? null : Encoding.ASCII.GetBytes(script + '\0')) {
 					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
-						r = Wg_CompileExpression(context, (IntPtr)_script, (IntPtr)_prettyName);
+						r = Wg_SubmitExecuteExpression(pool, (IntPtr)_script, (IntPtr)_prettyName);
 					}
 				}
 				return r;
@@ -576,823 +832,1948 @@ namespace Wings {
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_CompileExpression(Context context, IntPtr script, IntPtr prettyName);
+		private static extern unsafe Future Wg_SubmitExecuteExpression(ContextPool pool, IntPtr script, IntPtr prettyName);
 
 		/// <summary>
-		/// Set a callback for programmer errors.
+		/// Submit a call to a global function of the __main__ module to a context pool.
 		/// </summary>
-		/// <param name="callback">
-		/// The callback to use, or null to default to abort().
+		/// <param name="pool">
+		/// The pool to run the function.
 		/// </param>
-		public static void SetErrorCallback(ErrorCallback callback) {
+		/// <param name="function">
+		/// The name of the global function to call.
+		/// </param>
+		/// <param name="argv">
+		/// A pointer to an array of arguments. This can be null if argc is 0.
+		/// </param>
+		/// <param name="argc">
+		/// The number of arguments.
+		/// </param>
+		/// <returns>
+		/// The future of the job, or null if an argument is not plain data.
+		/// In this case, an exception is raised in the context of the argument.
+		/// </returns>
+		/// <see>
+		/// Call
+		/// </see>
+		public static Future SubmitCall(ContextPool pool, string function, Obj[] argv, int argc) {
 			unsafe {
-				Wg_SetErrorCallback(callback);
+				Future r;
+				fixed (byte* _function = function is null ? null : Encoding.ASCII.GetBytes(function + '\0')) {
+					fixed (Obj* _argv = argv) {
+						r = Wg_SubmitCall(pool, (IntPtr)_function, (IntPtr)_argv, argc);
+					}
+				}
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_SetErrorCallback(ErrorCallback callback);
+		private static extern unsafe Future Wg_SubmitCall(ContextPool pool, IntPtr function, IntPtr argv, int argc);
 
 		/// <summary>
-		/// Get the current exception message.
+		/// Check if the job of a future has finished.
 		/// </summary>
-		/// <param name="context">
-		/// The associated context.
+		/// <param name="future">
+		/// The future to check.
 		/// </param>
 		/// <returns>
-		/// The current error string.
+		/// True if GetFutureResult() would not block, otherwise false.
 		/// </returns>
-		/// <see>
-		/// GetException
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
-		/// ReraiseExceptionObject
-		/// </see>
-		public static string GetErrorMessage(Context context) {
+		public static bool IsFutureReady(Future future) {
 			unsafe {
-				string r;
-				r = Marshal.PtrToStringAnsi(Wg_GetErrorMessage(context))!;
+				bool r;
+				r = Wg_IsFutureReady(future) != 0;
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe IntPtr Wg_GetErrorMessage(Context context);
+		private static extern unsafe byte Wg_IsFutureReady(Future future);
 
 		/// <summary>
-		/// Get the current exception object.
+		/// Wait for the job of a future to finish and copy its result into a context.
 		/// </summary>
+		/// <param name="future">
+		/// The future to wait for.
+		/// </param>
 		/// <param name="context">
-		/// The associated context.
+		/// The context to create the result in.
 		/// </param>
 		/// <returns>
-		/// The current exception object, or null if there is no exception.
+		/// The result of the job, or null on failure.
 		/// </returns>
-		/// <see>
-		/// GetErrorMessage
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
-		/// ReraiseExceptionObject
-		/// </see>
-		public static Obj GetException(Context context) {
+		public static Obj GetFutureResult(Future future, Context context) {
 			unsafe {
 				Obj r;
-				r = Wg_GetException(context);
+				r = Wg_GetFutureResult(future, context);
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_GetException(Context context);
+		private static extern unsafe Obj Wg_GetFutureResult(Future future, Context context);
 
 		/// <summary>
-		/// Set a timeout before a WingTimeoutError is raised.
+		/// Free a future.
 		/// </summary>
-		/// <param name="context">
-		/// The associated context.
+		/// <param name="future">
+		/// The future to free.
 		/// </param>
-		/// <param name="milliseconds">
-		/// The timeout in milliseconds.
-		/// </param>
-		/// <see>
-		/// ClearTimeout
-		/// CheckTimeout
-		/// </see>
-		public static void SetTimeout(Context context, int milliseconds) {
+		public static void DestroyFuture(Future future) {
+			unsafe {
+				Wg_DestroyFuture(future);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_DestroyFuture(Future future);
+
+		/// <summary>
+		/// Get the default configuration.
+		/// </summary>
+		/// <param name="config">
+		/// The returned default configuration.
+		/// </param>
+		/// <see>
+		/// CreateContext
+		/// </see>
+		public static void DefaultConfig(out Config config) {
+			unsafe {
+				Wg_DefaultConfig(out var _config);
+				config = MakeWg_Config(_config);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_DefaultConfig(out Wg_ConfigNative config);
+
+		/// <summary>
+		/// Execute a script.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="script">
+		/// The script to execute.
+		/// </param>
+		/// <param name="prettyName">
+		/// The name to run the script under, or null to use a default name.
+		/// </param>
+		/// <returns>
+		/// A boolean indicating whether the script compiled and executed successfully.
+		/// </returns>
+		/// <see>
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static bool Execute(Context context, string script, string? prettyName = default) {
+			unsafe {
+				bool r;
+				fixed (byte* _script = script is null ? null : Encoding.ASCII.GetBytes(script + '\0')) {
+					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
+						r = Wg_Execute(context, (IntPtr)_script, (IntPtr)_prettyName) != 0;
+					}
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe byte Wg_Execute(Context context, IntPtr script, IntPtr prettyName);
+
+		/// <summary>
+		/// Execute a script containing an expression.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="script">
+		/// The expression to execute.
+		/// </param>
+		/// <param name="prettyName">
+		/// The name to run the script under, or null to use a default name.
+		/// </param>
+		/// <returns>
+		/// The result of executing the expression, or null on failure.
+		/// </returns>
+		/// <see>
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static Obj ExecuteExpression(Context context, string script, string? prettyName = default) {
+			unsafe {
+				Obj r;
+				fixed (byte* _script = script is null ? null : Encoding.ASCII.GetBytes(script + '\0')) {
+					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
+						r = Wg_ExecuteExpression(context, (IntPtr)_script, (IntPtr)_prettyName);
+					}
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_ExecuteExpression(Context context, IntPtr script, IntPtr prettyName);
+
+		/// <summary>
+		/// Compile a script into a function object.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="script">
+		/// The script to compile.
+		/// </param>
+		/// <param name="prettyName">
+		/// The name to run the script under, or null to use a default name.
+		/// </param>
+		/// <returns>
+		/// A function object, or null on failure.
+		/// </returns>
+		/// <see>
+		/// GetException
+		/// GetErrorMessage
+		/// Call
+		/// </see>
+		public static Obj Compile(Context context, string script, string? prettyName = default) {
+			unsafe {
+				Obj r;
+				fixed (byte* _script = script is null ? null : Encoding.ASCII.GetBytes(script + '\0')) {
+					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
+						r = Wg_Compile(context, (IntPtr)_script, (IntPtr)_prettyName);
+					}
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_Compile(Context context, IntPtr script, IntPtr prettyName);
+
+		/// <summary>
+		/// Compile an expression into a function object.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="script">
+		/// The expression to compile.
+		/// </param>
+		/// <param name="prettyName">
+		/// The name to run the script under, or null to use a default name.
+		/// </param>
+		/// <returns>
+		/// A function object, or null on failure.
+		/// </returns>
+		/// <see>
+		/// GetException
+		/// GetErrorMessage
+		/// Call
+		/// </see>
+		public static Obj CompileExpression(Context context, string script, string? prettyName = default) {
+			unsafe {
+				Obj r;
+				fixed (byte* _script = script is null ? null : Encoding.ASCII.GetBytes(script + '\0')) {
+					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
+						r = Wg_CompileExpression(context, (IntPtr)_script, (IntPtr)_prettyName);
+					}
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_CompileExpression(Context context, IntPtr script, IntPtr prettyName);
+
+		/// <summary>
+		/// Compile a script from a buffer into a function object.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="buffer">
+		/// The script to compile.
+		/// </param>
+		/// <param name="len">
+		/// The length of the buffer.
+		/// </param>
+		/// <param name="prettyName">
+		/// The name to run the script under, or null to use a default name.
+		/// </param>
+		/// <returns>
+		/// A function object, or null on failure.
+		/// </returns>
+		/// <see>
+		/// Compile
+		/// GetException
+		/// GetErrorMessage
+		/// Call
+		/// </see>
+		public static Obj CompileBuffer(Context context, string buffer, int len, string? prettyName = default) {
+			unsafe {
+				Obj r;
+				fixed (byte* _buffer = buffer is null ? null : Encoding.ASCII.GetBytes(buffer + '\0')) {
+					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
+						r = Wg_CompileBuffer(context, (IntPtr)_buffer, len, (IntPtr)_prettyName);
+					}
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_CompileBuffer(Context context, IntPtr buffer, int len, IntPtr prettyName);
+
+		/// <summary>
+		/// Compile a script without a context.
+		/// </summary>
+		/// <param name="buffer">
+		/// The script to compile. This does not need to be null terminated.
+		/// </param>
+		/// <param name="len">
+		/// The length of the buffer.
+		/// </param>
+		/// <param name="prettyName">
+		/// The name to run the script under, or null to use a default name.
+		/// </param>
+		/// <param name="config">
+		/// The configuration to take the optimization level from, or null to use the default configuration.
+		/// </param>
+		/// <returns>
+		/// The program, or null if memory could not be allocated.
+		/// </returns>
+		/// <see>
+		/// GetProgramError
+		/// </see>
+		public static Program CompileProgram(string buffer, int len, string? prettyName = default, Config? config = default) {
+			unsafe {
+				Program r;
+				fixed (byte* _buffer = buffer is null ? null : Encoding.ASCII.GetBytes(buffer + '\0')) {
+					fixed (byte* _prettyName = prettyName is null ? null : Encoding.ASCII.GetBytes(prettyName + '\0')) {
+						var _config = config is null ? new() : new Wg_ConfigNative(config.Value);
+						r = Wg_CompileProgram((IntPtr)_buffer, len, (IntPtr)_prettyName, config is null ? IntPtr.Zero : new IntPtr(&_config));
+					}
+				}
+				if (config != null) {
+					_config.Free(config.Value);
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Program Wg_CompileProgram(IntPtr buffer, int len, IntPtr prettyName, IntPtr config);
+
+		/// <summary>
+		/// Get the syntax error of a program.
+		/// </summary>
+		/// <param name="program">
+		/// The program.
+		/// </param>
+		/// <returns>
+		/// The error message, or null if the program compiled successfully.
+		/// The string is valid until the program is freed.
+		/// </returns>
+		public static string GetProgramError(Program program) {
+			unsafe {
+				string r;
+				r = Marshal.PtrToStringAnsi(Wg_GetProgramError(program))!;
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe IntPtr Wg_GetProgramError(Program program);
+
+		/// <summary>
+		/// Create a function object that runs a program in the __main__ module of a context.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="program">
+		/// The program to instantiate.
+		/// </param>
+		/// <returns>
+		/// A function object, or null on failure.
+		/// </returns>
+		/// <see>
+		/// Compile
+		/// Call
+		/// </see>
+		public static Obj InstantiateProgram(Context context, Program program) {
+			unsafe {
+				Obj r;
+				r = Wg_InstantiateProgram(context, program);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_InstantiateProgram(Context context, Program program);
+
+		/// <summary>
+		/// Free a program created with CompileProgram().
+		/// </summary>
+		/// <param name="program">
+		/// The program to free.
+		/// </param>
+		public static void DestroyProgram(Program program) {
+			unsafe {
+				Wg_DestroyProgram(program);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_DestroyProgram(Program program);
+
+		/// <summary>
+		/// Set a callback for programmer errors.
+		/// </summary>
+		/// <param name="callback">
+		/// The callback to use, or null to default to abort().
+		/// </param>
+		public static void SetErrorCallback(ErrorCallback callback) {
+			unsafe {
+				Wg_SetErrorCallback(callback);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_SetErrorCallback(ErrorCallback callback);
+
+		/// <summary>
+		/// Get the current exception message.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <returns>
+		/// The current error string.
+		/// </returns>
+		/// <see>
+		/// GetException
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
+		/// ReraiseExceptionObject
+		/// </see>
+		public static string GetErrorMessage(Context context) {
+			unsafe {
+				string r;
+				r = Marshal.PtrToStringAnsi(Wg_GetErrorMessage(context))!;
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe IntPtr Wg_GetErrorMessage(Context context);
+
+		/// <summary>
+		/// Get the current exception object.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <returns>
+		/// The current exception object, or null if there is no exception.
+		/// </returns>
+		/// <see>
+		/// GetErrorMessage
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
+		/// ReraiseExceptionObject
+		/// </see>
+		public static Obj GetException(Context context) {
+			unsafe {
+				Obj r;
+				r = Wg_GetException(context);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_GetException(Context context);
+
+		/// <summary>
+		/// Set a timeout before a WingTimeoutError is raised.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="milliseconds">
+		/// The timeout in milliseconds.
+		/// </param>
+		/// <see>
+		/// ClearTimeout
+		/// CheckTimeout
+		/// </see>
+		public static void SetTimeout(Context context, int milliseconds) {
 			unsafe {
 				Wg_SetTimeout(context, milliseconds);
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_SetTimeout(Context context, int milliseconds);
+		private static extern unsafe void Wg_SetTimeout(Context context, int milliseconds);
+
+		/// <summary>
+		/// Pop the previous timeout.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <see>
+		/// SetTimeout
+		/// CheckTimeout
+		/// </see>
+		public static void ClearTimeout(Context context) {
+			unsafe {
+				Wg_ClearTimeout(context);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_ClearTimeout(Context context);
+
+		/// <summary>
+		/// Limit the amount of work a context may perform before a WingsTimeoutError is raised.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="ticks">
+		/// The number of ticks allowed, or -1 to remove the budget.
+		/// </param>
+		/// <see>
+		/// GetInstructionBudget
+		/// CheckTimeout
+		/// </see>
+		public static void SetInstructionBudget(Context context, long ticks) {
+			unsafe {
+				Wg_SetInstructionBudget(context, ticks);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_SetInstructionBudget(Context context, long ticks);
+
+		/// <summary>
+		/// Get the number of ticks left in the instruction budget.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <returns>
+		/// The number of ticks left, or -1 if there is no budget.
+		/// </returns>
+		/// <see>
+		/// SetInstructionBudget
+		/// </see>
+		public static long GetInstructionBudget(Context context) {
+			unsafe {
+				long r;
+				r = Wg_GetInstructionBudget(context);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe long Wg_GetInstructionBudget(Context context);
+
+		/// <summary>
+		/// Request that the code running in a context is stopped.
+		/// </summary>
+		/// <param name="context">
+		/// The context to interrupt.
+		/// </param>
+		/// <see>
+		/// CheckTimeout
+		/// </see>
+		public static void Interrupt(Context context) {
+			unsafe {
+				Wg_Interrupt(context);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_Interrupt(Context context);
+
+		/// <summary>
+		/// Check if any timeout has occurred, the instruction budget has
+		/// been exceeded, or an interrupt has been requested.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <returns>
+		/// True if any limit has been hit, otherwise false.
+		/// </returns>
+		/// <see>
+		/// SetTimeout
+		/// ClearTimeout
+		/// SetInstructionBudget
+		/// Interrupt
+		/// </see>
+		public static bool CheckTimeout(Context context) {
+			unsafe {
+				bool r;
+				r = Wg_CheckTimeout(context) != 0;
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe byte Wg_CheckTimeout(Context context);
+
+		/// <summary>
+		/// Start recording where the time of a context is spent.
+		/// </summary>
+		/// <param name="context">
+		/// The context to profile.
+		/// </param>
+		/// <param name="sampleInterval">
+		/// The interval between samples in microseconds, or 0 to disable sampling.
+		/// </param>
+		/// <see>
+		/// StopProfiler
+		/// GetProfileReport
+		/// GetProfileCollapsedStacks
+		/// </see>
+		public static void StartProfiler(Context context, int sampleInterval) {
+			unsafe {
+				Wg_StartProfiler(context, sampleInterval);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_StartProfiler(Context context, int sampleInterval);
+
+		/// <summary>
+		/// Stop recording a profile.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <see>
+		/// StartProfiler
+		/// </see>
+		public static void StopProfiler(Context context) {
+			unsafe {
+				Wg_StopProfiler(context);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_StopProfiler(Context context);
+
+		/// <summary>
+		/// Get a human readable table of the results of the profiler.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <returns>
+		/// The report, or an empty string if the profiler has not been started.
+		/// </returns>
+		/// <see>
+		/// StartProfiler
+		/// GetProfileCollapsedStacks
+		/// </see>
+		public static string GetProfileReport(Context context) {
+			unsafe {
+				string r;
+				r = Marshal.PtrToStringAnsi(Wg_GetProfileReport(context))!;
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe IntPtr Wg_GetProfileReport(Context context);
+
+		/// <summary>
+		/// Get the sampled call stacks of the profiler in the collapsed stack format used by flame graph tools.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <returns>
+		/// The collapsed stacks, or an empty string if the profiler has not been started.
+		/// </returns>
+		/// <see>
+		/// StartProfiler
+		/// GetProfileReport
+		/// </see>
+		public static string GetProfileCollapsedStacks(Context context) {
+			unsafe {
+				string r;
+				r = Marshal.PtrToStringAnsi(Wg_GetProfileCollapsedStacks(context))!;
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe IntPtr Wg_GetProfileCollapsedStacks(Context context);
+
+		/// <summary>
+		/// Create and raise an exception.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="type">
+		/// The exception type.
+		/// </param>
+		/// <param name="message">
+		/// The error message, or null for an empty string.
+		/// </param>
+		/// <see>
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
+		/// ReraiseExceptionObject
+		/// </see>
+		public static void RaiseException(Context context, Exc type, string? message = default) {
+			unsafe {
+				fixed (byte* _message = message is null ? null : Encoding.ASCII.GetBytes(message + '\0')) {
+					Wg_RaiseException(context, type, (IntPtr)_message);
+				}
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_RaiseException(Context context, Exc type, IntPtr message);
+
+		/// <summary>
+		/// Create and raise an exception using a class object.
+		/// </summary>
+		/// <param name="klass">
+		/// The exception class.
+		/// </param>
+		/// <param name="message">
+		/// The error message, or null for an empty string.
+		/// </param>
+		/// <see>
+		/// RaiseException
+		/// RaiseExceptionObject
+		/// ReraiseExceptionObject
+		/// </see>
+		public static void RaiseExceptionClass(Obj klass, string? message = default) {
+			unsafe {
+				fixed (byte* _message = message is null ? null : Encoding.ASCII.GetBytes(message + '\0')) {
+					Wg_RaiseExceptionClass(klass, (IntPtr)_message);
+				}
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_RaiseExceptionClass(Obj klass, IntPtr message);
+
+		/// <summary>
+		/// Raise an existing exception object.
+		/// </summary>
+		/// <param name="obj">
+		/// The exception object to raise. The type must be a subclass of BaseException.
+		/// </param>
+		/// <see>
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// ReraiseExceptionObject
+		/// </see>
+		public static void RaiseExceptionObject(Obj obj) {
+			unsafe {
+				Wg_RaiseExceptionObject(obj);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_RaiseExceptionObject(Obj obj);
+
+		/// <summary>
+		/// Raise an existing exception object without affecting the stack trace.
+		/// </summary>
+		/// <param name="obj">
+		/// The exception object to raise. The type must be a subclass of BaseException.
+		/// </param>
+		/// <see>
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
+		/// </see>
+		public static void ReraiseExceptionObject(Obj obj) {
+			unsafe {
+				Wg_ReraiseExceptionObject(obj);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_ReraiseExceptionObject(Obj obj);
+
+		/// <summary>
+		/// Raise a TypeError with a formatted message.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="given">
+		/// The number of arguments given.
+		/// </param>
+		/// <param name="expected">
+		/// The number of arguments expected, or -1 if this is not a fixed number.
+		/// </param>
+		/// <see>
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
+		/// </see>
+		public static void RaiseArgumentCountError(Context context, int given, int expected) {
+			unsafe {
+				Wg_RaiseArgumentCountError(context, given, expected);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_RaiseArgumentCountError(Context context, int given, int expected);
+
+		/// <summary>
+		/// Raise a TypeError with a formatted message.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="index">
+		/// The parameter index of the invalid argument.
+		/// </param>
+		/// <param name="expected">
+		/// A string describing the expected type.
+		/// </param>
+		/// <see>
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
+		/// </see>
+		public static void RaiseArgumentTypeError(Context context, int index, string expected) {
+			unsafe {
+				fixed (byte* _expected = expected is null ? null : Encoding.ASCII.GetBytes(expected + '\0')) {
+					Wg_RaiseArgumentTypeError(context, index, (IntPtr)_expected);
+				}
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_RaiseArgumentTypeError(Context context, int index, IntPtr expected);
+
+		/// <summary>
+		/// Raise a AttributeError with a formatted message.
+		/// </summary>
+		/// <param name="obj">
+		/// The object missing the attribute.
+		/// </param>
+		/// <param name="attribute">
+		/// The missing attribute.
+		/// </param>
+		/// <see>
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
+		/// </see>
+		public static void RaiseAttributeError(Obj obj, string attribute) {
+			unsafe {
+				fixed (byte* _attribute = attribute is null ? null : Encoding.ASCII.GetBytes(attribute + '\0')) {
+					Wg_RaiseAttributeError(obj, (IntPtr)_attribute);
+				}
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_RaiseAttributeError(Obj obj, IntPtr attribute);
+
+		/// <summary>
+		/// Raise a KeyError with a formatted message.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="key">
+		/// The key that caused the KeyError, or null to leave unspecified.
+		/// </param>
+		/// <see>
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
+		/// </see>
+		public static void RaiseKeyError(Context context, Obj key = default) {
+			unsafe {
+				Wg_RaiseKeyError(context, key);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_RaiseKeyError(Context context, Obj key);
 
 		/// <summary>
-		/// Pop the previous timeout.
+		/// Raise a NameError with a formatted message.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
+		/// <param name="name">
+		/// The name that was not found.
+		/// </param>
 		/// <see>
-		/// SetTimeout
-		/// CheckTimeout
+		/// RaiseException
+		/// RaiseExceptionClass
+		/// RaiseExceptionObject
 		/// </see>
-		public static void ClearTimeout(Context context) {
+		public static void RaiseNameError(Context context, string name) {
 			unsafe {
-				Wg_ClearTimeout(context);
+				fixed (byte* _name = name is null ? null : Encoding.ASCII.GetBytes(name + '\0')) {
+					Wg_RaiseNameError(context, (IntPtr)_name);
+				}
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_ClearTimeout(Context context);
+		private static extern unsafe void Wg_RaiseNameError(Context context, IntPtr name);
+
+		/// <summary>
+		/// Clear the current exception.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		public static void ClearException(Context context) {
+			unsafe {
+				Wg_ClearException(context);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_ClearException(Context context);
+
+		/// <summary>
+		/// Get the context associated with an object.
+		/// </summary>
+		/// <param name="obj">
+		/// The object.
+		/// </param>
+		/// <returns>
+		/// The associated context.
+		/// </returns>
+		public static Context GetContextFromObject(Obj obj) {
+			unsafe {
+				Context r;
+				r = Wg_GetContextFromObject(obj);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Context Wg_GetContextFromObject(Obj obj);
+
+		/// <summary>
+		/// Check if an object's class derives from any of the specified classes.
+		/// </summary>
+		/// <param name="instance">
+		/// The object to be checked.
+		/// </param>
+		/// <param name="types">
+		/// An array of class objects to be checked against.
+		/// This can be null if typesLen is 0.
+		/// </param>
+		/// <param name="typesLen">
+		/// The length of the types array.
+		/// </param>
+		/// <returns>
+		/// The first subclass matched, or null if the object's
+		/// class does not derive from any of the specified classes.
+		/// </returns>
+		public static Obj IsInstance(Obj instance, Obj[] types, int typesLen) {
+			unsafe {
+				Obj r;
+				fixed (Obj* _types = types) {
+					r = Wg_IsInstance(instance, (IntPtr)_types, typesLen);
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_IsInstance(Obj instance, IntPtr types, int typesLen);
 
 		/// <summary>
-		/// Check if any timeout has occurred.
+		/// Get a global variable in the current module namespace.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
+		/// <param name="name">
+		/// The name of the global variable.
+		/// </param>
 		/// <returns>
-		/// True if any timeout has occurred, otherwise false.
+		/// The value of the global variable, or null if it does not exist.
 		/// </returns>
 		/// <see>
-		/// SetTimeout
-		/// ClearTimeout
+		/// SetGlobal
 		/// </see>
-		public static bool CheckTimeout(Context context) {
+		public static Obj GetGlobal(Context context, string name) {
 			unsafe {
-				bool r;
-				r = Wg_CheckTimeout(context) != 0;
+				Obj r;
+				fixed (byte* _name = name is null ? null : Encoding.ASCII.GetBytes(name + '\0')) {
+					r = Wg_GetGlobal(context, (IntPtr)_name);
+				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe byte Wg_CheckTimeout(Context context);
+		private static extern unsafe Obj Wg_GetGlobal(Context context, IntPtr name);
 
 		/// <summary>
-		/// Create and raise an exception.
+		/// Get several global variables in the current module namespace.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="type">
-		/// The exception type.
+		/// <param name="names">
+		/// An array of the names of the global variables.
+		/// </param>
+		/// <param name="len">
+		/// The length of the names and values arrays.
+		/// </param>
+		/// <param name="values">
+		/// An array to receive the values.
+		/// A value is null if the global variable does not exist.
+		/// </param>
+		/// <returns>
+		/// The number of global variables that exist.
+		/// </returns>
+		/// <see>
+		/// GetGlobal
+		/// </see>
+		public static int GetGlobals(Context context, string[] names, int len, Obj[] values) {
+			unsafe {
+				int r;
+				var handles = names.Select(x => GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
+				fixed(void* _names = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {
+					r = Wg_GetGlobals(context, (IntPtr)_names, len, values);
+					foreach (var handle in handles) handle.Free();
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe int Wg_GetGlobals(Context context, IntPtr names, int len, [In, Out] Obj[] values);
+
+		/// <summary>
+		/// Set a global variable in the current module namespace.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="name">
+		/// The name of the global variable.
+		/// </param>
+		/// <param name="value">
+		/// The value to set.
+		/// </param>
+		/// <see>
+		/// GetGlobal
+		/// </see>
+		public static void SetGlobal(Context context, string name, Obj value) {
+			unsafe {
+				fixed (byte* _name = name is null ? null : Encoding.ASCII.GetBytes(name + '\0')) {
+					Wg_SetGlobal(context, (IntPtr)_name, value);
+				}
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_SetGlobal(Context context, IntPtr name, Obj value);
+
+		/// <summary>
+		/// Print a message.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
 		/// </param>
 		/// <param name="message">
-		/// The error message, or null for an empty string.
+		/// A byte array containing the message.
+		/// This can null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the message byte array.
 		/// </param>
 		/// <see>
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
-		/// ReraiseExceptionObject
+		/// PrintString
+		/// Config
 		/// </see>
-		public static void RaiseException(Context context, Exc type, string? message = default) {
+		public static void Print(Context context, string message, int len) {
 			unsafe {
 				fixed (byte* _message = message is null ? null : Encoding.ASCII.GetBytes(message + '\0')) {
-					Wg_RaiseException(context, type, (IntPtr)_message);
+					Wg_Print(context, (IntPtr)_message, len);
 				}
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_RaiseException(Context context, Exc type, IntPtr message);
+		private static extern unsafe void Wg_Print(Context context, IntPtr message, int len);
 
 		/// <summary>
-		/// Create and raise an exception using a class object.
+		/// Print a string message.
 		/// </summary>
-		/// <param name="klass">
-		/// The exception class.
+		/// <param name="context">
+		/// The associated context.
 		/// </param>
 		/// <param name="message">
-		/// The error message, or null for an empty string.
+		/// A null terminated message string.
 		/// </param>
 		/// <see>
-		/// RaiseException
-		/// RaiseExceptionObject
-		/// ReraiseExceptionObject
+		/// Print
+		/// Config
 		/// </see>
-		public static void RaiseExceptionClass(Obj klass, string? message = default) {
+		public static void PrintString(Context context, string message) {
 			unsafe {
 				fixed (byte* _message = message is null ? null : Encoding.ASCII.GetBytes(message + '\0')) {
-					Wg_RaiseExceptionClass(klass, (IntPtr)_message);
+					Wg_PrintString(context, (IntPtr)_message);
 				}
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_RaiseExceptionClass(Obj klass, IntPtr message);
+		private static extern unsafe void Wg_PrintString(Context context, IntPtr message);
 
 		/// <summary>
-		/// Raise an existing exception object.
+		/// Force run the garbage collector and free all unreachable objects.
 		/// </summary>
-		/// <param name="obj">
-		/// The exception object to raise. The type must be a subclass of BaseException.
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		public static void CollectGarbage(Context context) {
+			unsafe {
+				Wg_CollectGarbage(context);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_CollectGarbage(Context context);
+
+		/// <summary>
+		/// Get the garbage collection and memory statistics of a context.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="stats">
+		/// The statistics.
 		/// </param>
 		/// <see>
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// ReraiseExceptionObject
+		/// GetGCPauseHistogram
+		/// GetGCTypeStats
+		/// SetGCCallback
 		/// </see>
-		public static void RaiseExceptionObject(Obj obj) {
+		public static void GetGCStats(Context context, out GCStats stats) {
 			unsafe {
-				Wg_RaiseExceptionObject(obj);
+				Wg_GetGCStats(context, out var _stats);
+				stats = MakeWg_GCStats(_stats);
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_RaiseExceptionObject(Obj obj);
+		private static extern unsafe void Wg_GetGCStats(Context context, out Wg_GCStatsNative stats);
 
 		/// <summary>
-		/// Raise an existing exception object without affecting the stack trace.
+		/// Get a histogram of the durations of garbage collections.
 		/// </summary>
-		/// <param name="obj">
-		/// The exception object to raise. The type must be a subclass of BaseException.
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="counts">
+		/// An array to receive the number of collections in each bucket.
+		/// At most len buckets are written. This parameter may be null.
+		/// </param>
+		/// <param name="len">
+		/// The length of the counts array.
 		/// </param>
+		/// <returns>
+		/// The number of buckets in the histogram.
+		/// </returns>
 		/// <see>
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
+		/// GetGCStats
 		/// </see>
-		public static void ReraiseExceptionObject(Obj obj) {
+		public static int GetGCPauseHistogram(Context context, long[] counts, int len) {
 			unsafe {
-				Wg_ReraiseExceptionObject(obj);
+				int r;
+				r = Wg_GetGCPauseHistogram(context, counts, len);
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_ReraiseExceptionObject(Obj obj);
+		private static extern unsafe int Wg_GetGCPauseHistogram(Context context, [In, Out] long[] counts, int len);
 
 		/// <summary>
-		/// Raise a TypeError with a formatted message.
+		/// Get the number of live objects and the bytes they use for each category of object.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="given">
-		/// The number of arguments given.
+		/// <param name="objects">
+		/// An array indexed by GCType to receive the object counts.
+		/// At most len values are written. This parameter may be null.
 		/// </param>
-		/// <param name="expected">
-		/// The number of arguments expected, or -1 if this is not a fixed number.
+		/// <param name="bytes">
+		/// An array indexed by GCType to receive the byte counts.
+		/// At most len values are written. This parameter may be null.
+		/// </param>
+		/// <param name="len">
+		/// The length of the arrays.
 		/// </param>
+		/// <returns>
+		/// The number of categories, which is WG_GC_TYPE_COUNT.
+		/// </returns>
 		/// <see>
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
+		/// GetGCStats
+		/// GCType
 		/// </see>
-		public static void RaiseArgumentCountError(Context context, int given, int expected) {
+		public static int GetGCTypeStats(Context context, long[] objects, long[] bytes, int len) {
 			unsafe {
-				Wg_RaiseArgumentCountError(context, given, expected);
+				int r;
+				r = Wg_GetGCTypeStats(context, objects, bytes, len);
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_RaiseArgumentCountError(Context context, int given, int expected);
+		private static extern unsafe int Wg_GetGCTypeStats(Context context, [In, Out] long[] objects, [In, Out] long[] bytes, int len);
 
 		/// <summary>
-		/// Raise a TypeError with a formatted message.
+		/// Set a callback to be invoked after every garbage collection.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="index">
-		/// The parameter index of the invalid argument.
+		/// <param name="callback">
+		/// The callback, or null to remove the callback.
 		/// </param>
-		/// <param name="expected">
-		/// A string describing the expected type.
+		/// <param name="userdata">
+		/// The userdata to pass to the callback.
 		/// </param>
 		/// <see>
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
+		/// GCCallback
+		/// GetGCStats
 		/// </see>
-		public static void RaiseArgumentTypeError(Context context, int index, string expected) {
+		public static void SetGCCallback(Context context, GCCallback callback, IntPtr userdata = default) {
 			unsafe {
-				fixed (byte* _expected = expected is null ? null : Encoding.ASCII.GetBytes(expected + '\0')) {
-					Wg_RaiseArgumentTypeError(context, index, (IntPtr)_expected);
-				}
+				Wg_SetGCCallback(context, callback, userdata);
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_RaiseArgumentTypeError(Context context, int index, IntPtr expected);
+		private static extern unsafe void Wg_SetGCCallback(Context context, GCCallback callback, IntPtr userdata);
 
 		/// <summary>
-		/// Raise a AttributeError with a formatted message.
+		/// Increment the reference count of an object.
+		/// A positive reference count prevents the object from being garbage collected.
 		/// </summary>
 		/// <param name="obj">
-		/// The object missing the attribute.
+		/// The object whose reference count is to be incremented.
 		/// </param>
-		/// <param name="attribute">
-		/// The missing attribute.
+		/// <see>
+		/// DecRef
+		/// </see>
+		public static void IncRef(Obj obj) {
+			unsafe {
+				Wg_IncRef(obj);
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe void Wg_IncRef(Obj obj);
+
+		/// <summary>
+		/// Decrement the reference count of an object.
+		/// A positive reference count prevents the object from being garbage collected.
+		/// </summary>
+		/// <param name="obj">
+		/// The object whose reference count is to be decremented.
 		/// </param>
 		/// <see>
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
+		/// IncRef
 		/// </see>
-		public static void RaiseAttributeError(Obj obj, string attribute) {
+		public static void DecRef(Obj obj) {
 			unsafe {
-				fixed (byte* _attribute = attribute is null ? null : Encoding.ASCII.GetBytes(attribute + '\0')) {
-					Wg_RaiseAttributeError(obj, (IntPtr)_attribute);
-				}
+				Wg_DecRef(obj);
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_RaiseAttributeError(Obj obj, IntPtr attribute);
+		private static extern unsafe void Wg_DecRef(Obj obj);
 
 		/// <summary>
-		/// Raise a KeyError with a formatted message.
+		/// Get the None singleton value.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="key">
-		/// The key that caused the KeyError, or null to leave unspecified.
-		/// </param>
-		/// <see>
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
-		/// </see>
-		public static void RaiseKeyError(Context context, Obj key = default) {
+		/// <returns>
+		/// The None singleton object.
+		/// </returns>
+		public static Obj None(Context context) {
 			unsafe {
-				Wg_RaiseKeyError(context, key);
+				Obj r;
+				r = Wg_None(context);
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_RaiseKeyError(Context context, Obj key);
+		private static extern unsafe Obj Wg_None(Context context);
 
 		/// <summary>
-		/// Raise a NameError with a formatted message.
+		/// Instantiate a boolean object.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="name">
-		/// The name that was not found.
+		/// <param name="value">
+		/// The value of the object.
 		/// </param>
-		/// <see>
-		/// RaiseException
-		/// RaiseExceptionClass
-		/// RaiseExceptionObject
-		/// </see>
-		public static void RaiseNameError(Context context, string name) {
+		/// <returns>
+		/// The instantiated object.
+		/// </returns>
+		public static Obj NewBool(Context context, bool value = default) {
 			unsafe {
-				fixed (byte* _name = name is null ? null : Encoding.ASCII.GetBytes(name + '\0')) {
-					Wg_RaiseNameError(context, (IntPtr)_name);
-				}
+				Obj r;
+				r = Wg_NewBool(context, (byte)(value ? 1 : 0));
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_RaiseNameError(Context context, IntPtr name);
+		private static extern unsafe Obj Wg_NewBool(Context context, byte value);
 
 		/// <summary>
-		/// Clear the current exception.
+		/// Instantiate an integer object.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		public static void ClearException(Context context) {
+		/// <param name="value">
+		/// The value of the object.
+		/// </param>
+		/// <returns>
+		/// The instantiated object, or null on failure.
+		/// </returns>
+		/// <see>
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static Obj NewInt(Context context, long value = default) {
 			unsafe {
-				Wg_ClearException(context);
+				Obj r;
+				r = Wg_NewInt(context, value);
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_ClearException(Context context);
+		private static extern unsafe Obj Wg_NewInt(Context context, long value);
 
 		/// <summary>
-		/// Get the context associated with an object.
+		/// Instantiate a float object.
 		/// </summary>
-		/// <param name="obj">
-		/// The object.
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="value">
+		/// The value of the object.
 		/// </param>
 		/// <returns>
-		/// The associated context.
+		/// The instantiated object, or null on failure.
 		/// </returns>
-		public static Context GetContextFromObject(Obj obj) {
+		/// <see>
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static Obj NewFloat(Context context, double value = default) {
 			unsafe {
-				Context r;
-				r = Wg_GetContextFromObject(obj);
+				Obj r;
+				r = Wg_NewFloat(context, value);
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Context Wg_GetContextFromObject(Obj obj);
+		private static extern unsafe Obj Wg_NewFloat(Context context, double value);
 
 		/// <summary>
-		/// Check if an object's class derives from any of the specified classes.
+		/// Instantiate a string object.
 		/// </summary>
-		/// <param name="instance">
-		/// The object to be checked.
-		/// </param>
-		/// <param name="types">
-		/// An array of class objects to be checked against.
-		/// This can be null if typesLen is 0.
+		/// <param name="context">
+		/// The associated context.
 		/// </param>
-		/// <param name="typesLen">
-		/// The length of the types array.
+		/// <param name="value">
+		/// A null terminated string, or null for an empty string.
 		/// </param>
 		/// <returns>
-		/// The first subclass matched, or null if the object's
-		/// class does not derive from any of the specified classes.
+		/// The instantiated object, or null on failure.
 		/// </returns>
-		public static Obj IsInstance(Obj instance, Obj[] types, int typesLen) {
+		/// <see>
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static Obj NewString(Context context, string? value = default) {
 			unsafe {
 				Obj r;
-				fixed (Obj* _types = types) {
-					r = Wg_IsInstance(instance, (IntPtr)_types, typesLen);
+				fixed (byte* _value = value is null ? null : Encoding.ASCII.GetBytes(value + '\0')) {
+					r = Wg_NewString(context, (IntPtr)_value);
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_IsInstance(Obj instance, IntPtr types, int typesLen);
+		private static extern unsafe Obj Wg_NewString(Context context, IntPtr value);
 
 		/// <summary>
-		/// Get a global variable in the current module namespace.
+		/// Instantiate a string object from a buffer.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="name">
-		/// The name of the global variable.
+		/// <param name="buffer">
+		/// The buffer.
+		/// </param>
+		/// <param name="len">
+		/// The length of the buffer.
 		/// </param>
 		/// <returns>
-		/// The value of the global variable, or null if it does not exist.
+		/// The instantiated object, or null on failure.
 		/// </returns>
 		/// <see>
-		/// SetGlobal
+		/// GetException
+		/// GetErrorMessage
 		/// </see>
-		public static Obj GetGlobal(Context context, string name) {
+		public static Obj NewStringBuffer(Context context, string buffer, int len) {
 			unsafe {
 				Obj r;
-				fixed (byte* _name = name is null ? null : Encoding.ASCII.GetBytes(name + '\0')) {
-					r = Wg_GetGlobal(context, (IntPtr)_name);
+				fixed (byte* _buffer = buffer is null ? null : Encoding.ASCII.GetBytes(buffer + '\0')) {
+					r = Wg_NewStringBuffer(context, (IntPtr)_buffer, len);
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_GetGlobal(Context context, IntPtr name);
+		private static extern unsafe Obj Wg_NewStringBuffer(Context context, IntPtr buffer, int len);
 
 		/// <summary>
-		/// Set a global variable in the current module namespace.
+		/// Instantiate a bytes object by copying a buffer.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="name">
-		/// The name of the global variable.
+		/// <param name="buffer">
+		/// The buffer. This can be null if len is 0.
 		/// </param>
-		/// <param name="value">
-		/// The value to set.
+		/// <param name="len">
+		/// The length of the buffer.
 		/// </param>
+		/// <returns>
+		/// The instantiated object, or null on failure.
+		/// </returns>
 		/// <see>
-		/// GetGlobal
+		/// NewBufferView
+		/// TryGetBuffer
 		/// </see>
-		public static void SetGlobal(Context context, string name, Obj value) {
+		public static Obj NewBytes(Context context, IntPtr buffer, int len) {
 			unsafe {
-				fixed (byte* _name = name is null ? null : Encoding.ASCII.GetBytes(name + '\0')) {
-					Wg_SetGlobal(context, (IntPtr)_name, value);
-				}
+				Obj r;
+				r = Wg_NewBytes(context, buffer, len);
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_SetGlobal(Context context, IntPtr name, Obj value);
+		private static extern unsafe Obj Wg_NewBytes(Context context, IntPtr buffer, int len);
 
 		/// <summary>
-		/// Print a message.
+		/// Instantiate a memoryview object that refers to host memory without copying it.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="message">
-		/// A byte array containing the message.
-		/// This can null if len is 0.
+		/// <param name="buffer">
+		/// The memory to refer to. This can be null if len is 0.
 		/// </param>
 		/// <param name="len">
-		/// The length of the message byte array.
+		/// The length of the memory in bytes.
+		/// </param>
+		/// <param name="readOnly">
+		/// Whether scripts are prevented from writing to the memory.
 		/// </param>
+		/// <param name="finalizer">
+		/// The function to call when the memory is no longer referenced. This may be null.
+		/// </param>
+		/// <param name="userdata">
+		/// The userdata to pass to the finalizer.
+		/// </param>
+		/// <returns>
+		/// The instantiated object, or null on failure.
+		/// </returns>
 		/// <see>
-		/// PrintString
-		/// Config
+		/// NewBytes
+		/// TryGetBuffer
 		/// </see>
-		public static void Print(Context context, string message, int len) {
+		public static Obj NewBufferView(Context context, IntPtr buffer, int len, bool readOnly, Finalizer finalizer = default, IntPtr userdata = default) {
 			unsafe {
-				fixed (byte* _message = message is null ? null : Encoding.ASCII.GetBytes(message + '\0')) {
-					Wg_Print(context, (IntPtr)_message, len);
-				}
+				Obj r;
+				r = Wg_NewBufferView(context, buffer, len, (byte)(readOnly ? 1 : 0), finalizer, userdata);
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_Print(Context context, IntPtr message, int len);
+		private static extern unsafe Obj Wg_NewBufferView(Context context, IntPtr buffer, int len, byte readOnly, Finalizer finalizer, IntPtr userdata);
 
 		/// <summary>
-		/// Print a string message.
+		/// Instantiate a tuple object.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="message">
-		/// A null terminated message string.
+		/// <param name="argv">
+		/// An array of objects to initialise the tuple with.
+		/// This can be null if argc is 0.
+		/// </param>
+		/// <param name="argc">
+		/// The length of the argv array.
 		/// </param>
+		/// <returns>
+		/// The instantiated object, or null on failure.
+		/// </returns>
 		/// <see>
-		/// Print
-		/// Config
+		/// GetException
+		/// GetErrorMessage
 		/// </see>
-		public static void PrintString(Context context, string message) {
+		public static Obj NewTuple(Context context, Obj[] argv, int argc) {
 			unsafe {
-				fixed (byte* _message = message is null ? null : Encoding.ASCII.GetBytes(message + '\0')) {
-					Wg_PrintString(context, (IntPtr)_message);
+				Obj r;
+				fixed (Obj* _argv = argv) {
+					r = Wg_NewTuple(context, (IntPtr)_argv, argc);
 				}
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_PrintString(Context context, IntPtr message);
+		private static extern unsafe Obj Wg_NewTuple(Context context, IntPtr argv, int argc);
 
 		/// <summary>
-		/// Force run the garbage collector and free all unreachable objects.
+		/// Instantiate a list object.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		public static void CollectGarbage(Context context) {
+		/// <param name="argv">
+		/// An array of objects to initialise the list with.
+		/// This can be null if argc is 0.
+		/// </param>
+		/// <param name="argc">
+		/// The length of the argv array.
+		/// </param>
+		/// <returns>
+		/// The instantiated object, or null on failure.
+		/// </returns>
+		/// <see>
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static Obj NewList(Context context, Obj[]? argv = default, int argc = default) {
 			unsafe {
-				Wg_CollectGarbage(context);
+				Obj r;
+				fixed (Obj* _argv = argv) {
+					r = Wg_NewList(context, (IntPtr)_argv, argc);
+				}
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_CollectGarbage(Context context);
+		private static extern unsafe Obj Wg_NewList(Context context, IntPtr argv, int argc);
 
 		/// <summary>
-		/// Increment the reference count of an object.
-		/// A positive reference count prevents the object from being garbage collected.
+		/// Instantiate a dictionary object.
 		/// </summary>
-		/// <param name="obj">
-		/// The object whose reference count is to be incremented.
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="keys">
+		/// An array of keys to initialise the dictionary with.
+		/// This can be null if argc is 0.
 		/// </param>
+		/// <param name="values">
+		/// An array of values to initialise the dictionary with.
+		/// This can be null if argc is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the keys and values arrays.
+		/// </param>
+		/// <returns>
+		/// The instantiated object, or null on failure.
+		/// </returns>
 		/// <see>
-		/// DecRef
+		/// GetException
+		/// GetErrorMessage
 		/// </see>
-		public static void IncRef(Obj obj) {
+		public static Obj NewDictionary(Context context, Obj[]? keys = default, Obj[]? values = default, int len = default) {
 			unsafe {
-				Wg_IncRef(obj);
+				Obj r;
+				fixed (Obj* _keys = keys) {
+					fixed (Obj* _values = values) {
+						r = Wg_NewDictionary(context, (IntPtr)_keys, (IntPtr)_values, len);
+					}
+				}
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_IncRef(Obj obj);
+		private static extern unsafe Obj Wg_NewDictionary(Context context, IntPtr keys, IntPtr values, int len);
 
 		/// <summary>
-		/// Decrement the reference count of an object.
-		/// A positive reference count prevents the object from being garbage collected.
+		/// Instantiate a set object.
 		/// </summary>
-		/// <param name="obj">
-		/// The object whose reference count is to be decremented.
+		/// <param name="context">
+		/// The associated context.
 		/// </param>
+		/// <param name="argv">
+		/// An array of objects to initialise the set with.
+		/// This can be null if argc is 0.
+		/// </param>
+		/// <param name="argc">
+		/// The length of the argv array.
+		/// </param>
+		/// <returns>
+		/// The instantiated object, or null on failure.
+		/// </returns>
 		/// <see>
-		/// IncRef
+		/// GetException
+		/// GetErrorMessage
 		/// </see>
-		public static void DecRef(Obj obj) {
+		public static Obj NewSet(Context context, Obj[]? argv = default, int argc = default) {
 			unsafe {
-				Wg_DecRef(obj);
+				Obj r;
+				fixed (Obj* _argv = argv) {
+					r = Wg_NewSet(context, (IntPtr)_argv, argc);
+				}
+				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe void Wg_DecRef(Obj obj);
+		private static extern unsafe Obj Wg_NewSet(Context context, IntPtr argv, int argc);
 
 		/// <summary>
-		/// Get the None singleton value.
+		/// Instantiate a list object from an array of integers.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
+		/// <param name="values">
+		/// An array of values to initialise the list with.
+		/// This can be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
+		/// </param>
 		/// <returns>
-		/// The None singleton object.
+		/// The instantiated object, or null on failure.
 		/// </returns>
-		public static Obj None(Context context) {
+		/// <see>
+		/// NewList
+		/// GetInts
+		/// </see>
+		public static Obj NewListFromInts(Context context, long[] values, int len) {
 			unsafe {
 				Obj r;
-				r = Wg_None(context);
+				fixed (long* _values = values) {
+					r = Wg_NewListFromInts(context, (IntPtr)_values, len);
+				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_None(Context context);
+		private static extern unsafe Obj Wg_NewListFromInts(Context context, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate a boolean object.
+		/// Instantiate a list object from an array of floats.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="value">
-		/// The value of the object.
+		/// <param name="values">
+		/// An array of values to initialise the list with.
+		/// This can be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
 		/// </param>
 		/// <returns>
-		/// The instantiated object.
+		/// The instantiated object, or null on failure.
 		/// </returns>
-		public static Obj NewBool(Context context, bool value = default) {
+		/// <see>
+		/// NewList
+		/// GetFloats
+		/// </see>
+		public static Obj NewListFromFloats(Context context, double[] values, int len) {
 			unsafe {
 				Obj r;
-				r = Wg_NewBool(context, (byte)(value ? 1 : 0));
+				fixed (double* _values = values) {
+					r = Wg_NewListFromFloats(context, (IntPtr)_values, len);
+				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewBool(Context context, byte value);
+		private static extern unsafe Obj Wg_NewListFromFloats(Context context, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate an integer object.
+		/// Instantiate a list object from an array of strings.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="value">
-		/// The value of the object.
+		/// <param name="values">
+		/// An array of values to initialise the list with.
+		/// This can be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
 		/// </param>
 		/// <returns>
 		/// The instantiated object, or null on failure.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// NewList
+		/// GetStrings
 		/// </see>
-		public static Obj NewInt(Context context, long value = default) {
+		public static Obj NewListFromStrings(Context context, string[] values, int len) {
 			unsafe {
 				Obj r;
-				r = Wg_NewInt(context, value);
+				var handles = values.Select(x => GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
+				fixed(void* _values = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {
+					r = Wg_NewListFromStrings(context, (IntPtr)_values, len);
+					foreach (var handle in handles) handle.Free();
+				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewInt(Context context, long value);
+		private static extern unsafe Obj Wg_NewListFromStrings(Context context, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate a float object.
+		/// Instantiate a tuple object from an array of integers.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="value">
-		/// The value of the object.
+		/// <param name="values">
+		/// An array of values to initialise the tuple with.
+		/// This can be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
 		/// </param>
 		/// <returns>
 		/// The instantiated object, or null on failure.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// NewTuple
+		/// GetInts
 		/// </see>
-		public static Obj NewFloat(Context context, float value = default) {
+		public static Obj NewTupleFromInts(Context context, long[] values, int len) {
 			unsafe {
 				Obj r;
-				r = Wg_NewFloat(context, value);
+				fixed (long* _values = values) {
+					r = Wg_NewTupleFromInts(context, (IntPtr)_values, len);
+				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewFloat(Context context, float value);
+		private static extern unsafe Obj Wg_NewTupleFromInts(Context context, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate a string object.
+		/// Instantiate a tuple object from an array of floats.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="value">
-		/// A null terminated string, or null for an empty string.
+		/// <param name="values">
+		/// An array of values to initialise the tuple with.
+		/// This can be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
 		/// </param>
 		/// <returns>
 		/// The instantiated object, or null on failure.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// NewTuple
+		/// GetFloats
 		/// </see>
-		public static Obj NewString(Context context, string? value = default) {
+		public static Obj NewTupleFromFloats(Context context, double[] values, int len) {
 			unsafe {
 				Obj r;
-				fixed (byte* _value = value is null ? null : Encoding.ASCII.GetBytes(value + '\0')) {
-					r = Wg_NewString(context, (IntPtr)_value);
+				fixed (double* _values = values) {
+					r = Wg_NewTupleFromFloats(context, (IntPtr)_values, len);
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewString(Context context, IntPtr value);
+		private static extern unsafe Obj Wg_NewTupleFromFloats(Context context, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate a string object from a buffer.
+		/// Instantiate a tuple object from an array of strings.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="buffer">
-		/// The buffer.
+		/// <param name="values">
+		/// An array of values to initialise the tuple with.
+		/// This can be null if len is 0.
 		/// </param>
 		/// <param name="len">
-		/// The length of the buffer.
+		/// The length of the values array.
 		/// </param>
 		/// <returns>
 		/// The instantiated object, or null on failure.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// NewTuple
+		/// GetStrings
 		/// </see>
-		public static Obj NewStringBuffer(Context context, string buffer, int len) {
+		public static Obj NewTupleFromStrings(Context context, string[] values, int len) {
 			unsafe {
 				Obj r;
-				fixed (byte* _buffer = buffer is null ? null : Encoding.ASCII.GetBytes(buffer + '\0')) {
-					r = Wg_NewStringBuffer(context, (IntPtr)_buffer, len);
+				var handles = values.Select(x => GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
+				fixed(void* _values = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {
+					r = Wg_NewTupleFromStrings(context, (IntPtr)_values, len);
+					foreach (var handle in handles) handle.Free();
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewStringBuffer(Context context, IntPtr buffer, int len);
+		private static extern unsafe Obj Wg_NewTupleFromStrings(Context context, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate a tuple object.
+		/// Instantiate a dictionary object with string keys from an array of integers.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="argv">
-		/// An array of objects to initialise the tuple with.
-		/// This can be null if argc is 0.
+		/// <param name="keys">
+		/// An array of keys to initialise the dictionary with.
+		/// This can be null if len is 0.
 		/// </param>
-		/// <param name="argc">
-		/// The length of the argv array.
+		/// <param name="values">
+		/// An array of values to initialise the dictionary with.
+		/// This can be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the keys and values arrays.
 		/// </param>
 		/// <returns>
 		/// The instantiated object, or null on failure.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// NewDictionary
+		/// GetDictionaryItems
 		/// </see>
-		public static Obj NewTuple(Context context, Obj[] argv, int argc) {
+		public static Obj NewDictionaryFromInts(Context context, string[] keys, long[] values, int len) {
 			unsafe {
 				Obj r;
-				fixed (Obj* _argv = argv) {
-					r = Wg_NewTuple(context, (IntPtr)_argv, argc);
+				var handles = keys.Select(x => GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
+				fixed(void* _keys = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {
+					fixed (long* _values = values) {
+						r = Wg_NewDictionaryFromInts(context, (IntPtr)_keys, (IntPtr)_values, len);
+						foreach (var handle in handles) handle.Free();
+					}
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewTuple(Context context, IntPtr argv, int argc);
+		private static extern unsafe Obj Wg_NewDictionaryFromInts(Context context, IntPtr keys, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate a list object.
+		/// Instantiate a dictionary object with string keys from an array of floats.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="argv">
-		/// An array of objects to initialise the list with.
-		/// This can be null if argc is 0.
+		/// <param name="keys">
+		/// An array of keys to initialise the dictionary with.
+		/// This can be null if len is 0.
 		/// </param>
-		/// <param name="argc">
-		/// The length of the argv array.
+		/// <param name="values">
+		/// An array of values to initialise the dictionary with.
+		/// This can be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the keys and values arrays.
 		/// </param>
 		/// <returns>
 		/// The instantiated object, or null on failure.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// NewDictionary
+		/// GetDictionaryItems
 		/// </see>
-		public static Obj NewList(Context context, Obj[]? argv = default, int argc = default) {
+		public static Obj NewDictionaryFromFloats(Context context, string[] keys, double[] values, int len) {
 			unsafe {
 				Obj r;
-				fixed (Obj* _argv = argv) {
-					r = Wg_NewList(context, (IntPtr)_argv, argc);
+				var handles = keys.Select(x => GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
+				fixed(void* _keys = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {
+					fixed (double* _values = values) {
+						r = Wg_NewDictionaryFromFloats(context, (IntPtr)_keys, (IntPtr)_values, len);
+						foreach (var handle in handles) handle.Free();
+					}
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewList(Context context, IntPtr argv, int argc);
+		private static extern unsafe Obj Wg_NewDictionaryFromFloats(Context context, IntPtr keys, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate a dictionary object.
+		/// Instantiate a dictionary object with string keys from an array of strings.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
 		/// <param name="keys">
 		/// An array of keys to initialise the dictionary with.
-		/// This can be null if argc is 0.
+		/// This can be null if len is 0.
 		/// </param>
 		/// <param name="values">
 		/// An array of values to initialise the dictionary with.
-		/// This can be null if argc is 0.
+		/// This can be null if len is 0.
 		/// </param>
 		/// <param name="len">
 		/// The length of the keys and values arrays.
@@ -1401,56 +2782,89 @@ namespace Wings {
 		/// The instantiated object, or null on failure.
 		/// </returns>
 		/// <see>
-		/// GetException
-		/// GetErrorMessage
+		/// NewDictionary
+		/// GetDictionaryItems
 		/// </see>
-		public static Obj NewDictionary(Context context, Obj[]? keys = default, Obj[]? values = default, int len = default) {
+		public static Obj NewDictionaryFromStrings(Context context, string[] keys, string[] values, int len) {
 			unsafe {
 				Obj r;
-				fixed (Obj* _keys = keys) {
-					fixed (Obj* _values = values) {
-						r = Wg_NewDictionary(context, (IntPtr)_keys, (IntPtr)_values, len);
+				var handles = keys.Select(x => GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
+				fixed(void* _keys = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {
+					var handles = values.Select(x => GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
+					fixed(void* _values = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {
+						r = Wg_NewDictionaryFromStrings(context, (IntPtr)_keys, (IntPtr)_values, len);
+						foreach (var handle in handles) handle.Free();
 					}
+					foreach (var handle in handles) handle.Free();
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewDictionary(Context context, IntPtr keys, IntPtr values, int len);
+		private static extern unsafe Obj Wg_NewDictionaryFromStrings(Context context, IntPtr keys, IntPtr values, int len);
 
 		/// <summary>
-		/// Instantiate a set object.
+		/// Parse a JSON document into objects.
 		/// </summary>
 		/// <param name="context">
 		/// The associated context.
 		/// </param>
-		/// <param name="argv">
-		/// An array of objects to initialise the set with.
-		/// This can be null if argc is 0.
+		/// <param name="buffer">
+		/// The UTF-8 document. This can be null if len is 0.
 		/// </param>
-		/// <param name="argc">
-		/// The length of the argv array.
+		/// <param name="len">
+		/// The length of the buffer in bytes.
 		/// </param>
 		/// <returns>
-		/// The instantiated object, or null on failure.
+		/// The parsed value, or null on failure.
 		/// </returns>
 		/// <see>
+		/// ToJson
 		/// GetException
 		/// GetErrorMessage
 		/// </see>
-		public static Obj NewSet(Context context, Obj[]? argv = default, int argc = default) {
+		public static Obj ParseJson(Context context, string buffer, int len) {
 			unsafe {
 				Obj r;
-				fixed (Obj* _argv = argv) {
-					r = Wg_NewSet(context, (IntPtr)_argv, argc);
+				fixed (byte* _buffer = buffer is null ? null : Encoding.ASCII.GetBytes(buffer + '\0')) {
+					r = Wg_ParseJson(context, (IntPtr)_buffer, len);
 				}
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe Obj Wg_NewSet(Context context, IntPtr argv, int argc);
+		private static extern unsafe Obj Wg_ParseJson(Context context, IntPtr buffer, int len);
+
+		/// <summary>
+		/// Serialise an object to a JSON string.
+		/// </summary>
+		/// <param name="obj">
+		/// The object to serialise.
+		/// </param>
+		/// <param name="indent">
+		/// The number of spaces to indent nested values by, or -1 to write the
+		/// most compact form with no whitespace.
+		/// </param>
+		/// <returns>
+		/// A str object containing the JSON, or null on failure.
+		/// </returns>
+		/// <see>
+		/// ParseJson
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static Obj ToJson(Obj obj, int indent = default) {
+			unsafe {
+				Obj r;
+				r = Wg_ToJson(obj, indent);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_ToJson(Obj obj, int indent);
 
 		/// <summary>
 		/// Instantiate a function object.
@@ -1834,16 +3248,16 @@ namespace Wings {
 		/// <returns>
 		/// The float value of the object.
 		/// </returns>
-		public static float GetFloat(Obj obj) {
+		public static double GetFloat(Obj obj) {
 			unsafe {
-				float r;
+				double r;
 				r = Wg_GetFloat(obj);
 				return r;
 			}
 		}
 
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
-		private static extern unsafe float Wg_GetFloat(Obj obj);
+		private static extern unsafe double Wg_GetFloat(Obj obj);
 
 		/// <summary>
 		/// Get the value from a string object.
@@ -1873,6 +3287,179 @@ namespace Wings {
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
 		private static extern unsafe IntPtr Wg_GetString(Obj obj, out int len);
 
+		/// <summary>
+		/// Copy the items of an iterable object into an array of integers.
+		/// </summary>
+		/// <param name="obj">
+		/// The object to read.
+		/// </param>
+		/// <param name="values">
+		/// An array to receive the items. At most len items are written.
+		/// This parameter may be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
+		/// </param>
+		/// <returns>
+		/// The number of items in obj, which may be more than len, or -1 on failure.
+		/// </returns>
+		/// <see>
+		/// NewListFromInts
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static int GetInts(Obj obj, long[] values, int len) {
+			unsafe {
+				int r;
+				r = Wg_GetInts(obj, values, len);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe int Wg_GetInts(Obj obj, [In, Out] long[] values, int len);
+
+		/// <summary>
+		/// Copy the items of an iterable object into an array of floats.
+		/// </summary>
+		/// <param name="obj">
+		/// The object to read.
+		/// </param>
+		/// <param name="values">
+		/// An array to receive the items. At most len items are written.
+		/// This parameter may be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
+		/// </param>
+		/// <returns>
+		/// The number of items in obj, which may be more than len, or -1 on failure.
+		/// </returns>
+		/// <see>
+		/// NewListFromFloats
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static int GetFloats(Obj obj, double[] values, int len) {
+			unsafe {
+				int r;
+				r = Wg_GetFloats(obj, values, len);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe int Wg_GetFloats(Obj obj, [In, Out] double[] values, int len);
+
+		/// <summary>
+		/// Copy the items of an iterable object into an array of strings.
+		/// </summary>
+		/// <param name="obj">
+		/// The object to read.
+		/// </param>
+		/// <param name="values">
+		/// An array to receive the items. At most len items are written.
+		/// This parameter may be null if len is 0.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
+		/// </param>
+		/// <returns>
+		/// The number of items in obj, which may be more than len, or -1 on failure.
+		/// </returns>
+		/// <see>
+		/// NewListFromStrings
+		/// GetException
+		/// GetErrorMessage
+		/// </see>
+		public static int GetStrings(Obj obj, string?[] values, int len) {
+			unsafe {
+				int r;
+				var _values = values is null ? null : new IntPtr[values.Length];
+				r = Wg_GetStrings(obj, _values, len);
+				for (int i = 0; values is not null && i < values.Length && i < r; i++) {
+					values[i] = Marshal.PtrToStringUTF8(_values![i]);
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe int Wg_GetStrings(Obj obj, [In, Out] IntPtr[] values, int len);
+
+		/// <summary>
+		/// Copy the items of a dictionary into arrays of keys and values.
+		/// </summary>
+		/// <param name="obj">
+		/// The dictionary to read.
+		/// </param>
+		/// <param name="keys">
+		/// An array to receive the keys. At most len keys are written.
+		/// This parameter may be null.
+		/// </param>
+		/// <param name="values">
+		/// An array to receive the values. At most len values are written.
+		/// This parameter may be null.
+		/// </param>
+		/// <param name="len">
+		/// The length of the keys and values arrays.
+		/// </param>
+		/// <returns>
+		/// The number of items in the dictionary, which may be more than len.
+		/// </returns>
+		/// <see>
+		/// NewDictionary
+		/// IsDictionary
+		/// </see>
+		public static int GetDictionaryItems(Obj obj, Obj[] keys, Obj[] values, int len) {
+			unsafe {
+				int r;
+				r = Wg_GetDictionaryItems(obj, keys, values, len);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe int Wg_GetDictionaryItems(Obj obj, [In, Out] Obj[] keys, [In, Out] Obj[] values, int len);
+
+		/// <summary>
+		/// Get the memory of a bytes, bytearray, memoryview or array object without copying it.
+		/// </summary>
+		/// <param name="obj">
+		/// The object to get the memory from.
+		/// </param>
+		/// <param name="data">
+		/// The memory. This parameter may be null.
+		/// </param>
+		/// <param name="len">
+		/// The length of the memory in bytes. This parameter may be null.
+		/// </param>
+		/// <param name="readOnly">
+		/// Whether the memory must not be written to. This parameter may be null.
+		/// </param>
+		/// <returns>
+		/// A boolean indicating whether obj is a bytes, bytearray, array or unreleased memoryview.
+		/// </returns>
+		/// <see>
+		/// NewBytes
+		/// NewBufferView
+		/// </see>
+		/// <remarks>
+		/// The memory of a bytearray or array may move when it is resized.
+		/// Do not keep the pointer after running any code that may modify the object.
+		/// </remarks>
+		public static bool TryGetBuffer(Obj obj, out IntPtr data, out int len, out bool readOnly) {
+			unsafe {
+				bool r;
+				r = Wg_TryGetBuffer(obj, out data, out len, out var _readOnly) != 0;
+				readOnly = _readOnly != 0;
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe byte Wg_TryGetBuffer(Obj obj, out IntPtr data, out int len, out byte readOnly);
+
 		/// <summary>
 		/// Set the userdata for an object.
 		/// </summary>
@@ -1898,6 +3485,34 @@ namespace Wings {
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
 		private static extern unsafe void Wg_SetUserdata(Obj obj, IntPtr userdata);
 
+		/// <summary>
+		/// Report the number of bytes of memory owned by the userdata of an object.
+		/// </summary>
+		/// <param name="obj">
+		/// The object that owns the userdata.
+		/// </param>
+		/// <param name="size">
+		/// The size of the userdata in bytes.
+		/// </param>
+		/// <returns>
+		/// A boolean indicating whether the size was set.
+		/// </returns>
+		/// <see>
+		/// SetUserdata
+		/// Config
+		/// GetGCStats
+		/// </see>
+		public static bool SetUserdataSize(Obj obj, long size) {
+			unsafe {
+				bool r;
+				r = Wg_SetUserdataSize(obj, size) != 0;
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe byte Wg_SetUserdataSize(Obj obj, long size);
+
 		/// <summary>
 		/// Get the userdata from an object if it is of the expected type.
 		/// </summary>
@@ -2178,6 +3793,36 @@ namespace Wings {
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
 		private static extern unsafe byte Wg_Unpack(Obj obj, int count, [In, Out] Obj[] values);
 
+		/// <summary>
+		/// Iterate over an object and store the yielded objects in an array.
+		/// </summary>
+		/// <param name="obj">
+		/// The object to iterate over.
+		/// </param>
+		/// <param name="values">
+		/// An array to receive the yielded objects.
+		/// </param>
+		/// <param name="len">
+		/// The length of the values array.
+		/// </param>
+		/// <returns>
+		/// The number of objects written, or -1 on failure.
+		/// </returns>
+		/// <see>
+		/// Iterate
+		/// Unpack
+		/// </see>
+		public static int IterateInto(Obj obj, Obj[] values, int len) {
+			unsafe {
+				int r;
+				r = Wg_IterateInto(obj, values, len);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe int Wg_IterateInto(Obj obj, [In, Out] Obj[] values, int len);
+
 		/// <summary>
 		/// Get the keyword arguments dictionary passed to the current function.
 		/// </summary>
@@ -2269,6 +3914,42 @@ namespace Wings {
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
 		private static extern unsafe Obj Wg_Call(Obj callable, IntPtr argv, int argc, Obj kwargs);
 
+		/// <summary>
+		/// Call a callable object with keyword arguments stored in an array.
+		/// </summary>
+		/// <param name="callable">
+		/// The object to call.
+		/// </param>
+		/// <param name="argv">
+		/// An array of the positional arguments followed by the
+		/// values of the keyword arguments.
+		/// </param>
+		/// <param name="argc">
+		/// The number of positional arguments in argv.
+		/// </param>
+		/// <param name="kwnames">
+		/// A tuple of strings naming the keyword arguments at the
+		/// end of argv, or null if there are none.
+		/// </param>
+		/// <returns>
+		/// The return value of the callable, or null on failure.
+		/// </returns>
+		/// <see>
+		/// Call
+		/// </see>
+		public static Obj CallVector(Obj callable, Obj[] argv, int argc, Obj kwnames) {
+			unsafe {
+				Obj r;
+				fixed (Obj* _argv = argv) {
+					r = Wg_CallVector(callable, (IntPtr)_argv, argc, kwnames);
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_CallVector(Obj callable, IntPtr argv, int argc, Obj kwnames);
+
 		/// <summary>
 		/// Call a method on a object.
 		/// </summary>
@@ -2356,6 +4037,122 @@ namespace Wings {
 		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
 		private static extern unsafe Obj Wg_CallMethodFromBase(Obj obj, IntPtr method, IntPtr argv, int argc, Obj kwargs, Obj baseClass);
 
+		/// <summary>
+		/// Call a callable object so that native functions called by it can suspend it.
+		/// </summary>
+		/// <param name="callable">
+		/// The object to call.
+		/// </param>
+		/// <param name="argv">
+		/// An array of arguments to pass to the callable object.
+		/// If argc is 0 then this can be null.
+		/// </param>
+		/// <param name="argc">
+		/// The length of the argv array.
+		/// </param>
+		/// <returns>
+		/// The return value of the callable, or null on failure or suspension.
+		/// </returns>
+		/// <see>
+		/// Suspend
+		/// Resume
+		/// IsSuspended
+		/// </see>
+		public static Obj CallSuspendable(Obj callable, Obj[] argv, int argc) {
+			unsafe {
+				Obj r;
+				fixed (Obj* _argv = argv) {
+					r = Wg_CallSuspendable(callable, (IntPtr)_argv, argc);
+				}
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_CallSuspendable(Obj callable, IntPtr argv, int argc);
+
+		/// <summary>
+		/// Suspend the script calling the current native function.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <returns>
+		/// The value to return from the native function, or null on failure.
+		/// </returns>
+		/// <see>
+		/// CallSuspendable
+		/// Resume
+		/// </see>
+		/// <remarks>
+		/// This function must be called inside a function bound with NewFunction() or BindMethod().
+		/// </remarks>
+		public static Obj Suspend(Context context) {
+			unsafe {
+				Obj r;
+				r = Wg_Suspend(context);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_Suspend(Context context);
+
+		/// <summary>
+		/// Check whether the context has a suspended call waiting for Resume().
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <returns>
+		/// True if the last call to CallSuspendable() or Resume() was suspended.
+		/// </returns>
+		/// <see>
+		/// CallSuspendable
+		/// Resume
+		/// </see>
+		public static bool IsSuspended(Context context) {
+			unsafe {
+				bool r;
+				r = Wg_IsSuspended(context) != 0;
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe byte Wg_IsSuspended(Context context);
+
+		/// <summary>
+		/// Resume the suspended call of a context.
+		/// </summary>
+		/// <param name="context">
+		/// The associated context.
+		/// </param>
+		/// <param name="value">
+		/// The return value of the suspended native function. This is ignored if exception is not null.
+		/// </param>
+		/// <param name="exception">
+		/// An exception class or instance to raise, or null.
+		/// </param>
+		/// <returns>
+		/// The return value of the callable passed to CallSuspendable(),
+		/// or null on failure or suspension.
+		/// </returns>
+		/// <see>
+		/// CallSuspendable
+		/// IsSuspended
+		/// </see>
+		public static Obj Resume(Context context, Obj value, Obj exception = default) {
+			unsafe {
+				Obj r;
+				r = Wg_Resume(context, value, exception);
+				return r;
+			}
+		}
+
+		[DllImport("wings", CallingConvention = CallingConvention.Cdecl)]
+		private static extern unsafe Obj Wg_Resume(Context context, Obj value, Obj exception);
+
 		/// <summary>
 		/// Get the values from a kwargs parameter.
 		/// </summary>
@@ -2388,7 +4185,7 @@ namespace Wings {
 		public static bool ParseKwargs(Obj dict, string[] keys, int keysLen, Obj[] values) {
 			unsafe {
 				bool r;
-				var handles = keys.Select(x => GCHandle.Alloc(Encoding.ASCII.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
+				var handles = keys.Select(x => GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\0'), GCHandleType.Pinned)).ToArray();
 				fixed(void* _keys = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {
 					r = Wg_ParseKwargs(dict, (IntPtr)_keys, keysLen, values) != 0;
 					foreach (var handle in handles) handle.Free();
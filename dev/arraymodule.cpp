@@ -0,0 +1,822 @@
+#include "arraymodule.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace wings {
+	namespace arraymodule {
+		// Arrays are buffers of contiguous items, so the garbage collector sees one object
+		// however many items there are. The items are int64 for typecode 'q' and float64
+		// for typecode 'd'. Unlike the array module of CPython, the arithmetic operators
+		// work element-wise with another array of the same length or with a scalar.
+
+		static constexpr size_t ITEM_SIZE = 8;
+		static constexpr size_t LANES = 8;
+
+		enum class Op {
+			Add,
+			Sub,
+			Mul,
+			Div,
+		};
+
+		struct ArrayIterator {
+			size_t index = 0;
+		};
+
+		// Calls f with a value of the item type of the typecode
+		template <class F>
+		static auto WithItemType(char typecode, F f) {
+			if (typecode == 'q') {
+				return f(Wg_int{});
+			} else {
+				return f(Wg_float{});
+			}
+		}
+
+		template <class T>
+		static T* Items(const BufferObject* buf) {
+			return (T*)buf->Data();
+		}
+
+		static size_t Length(const BufferObject* buf) {
+			return buf->length / ITEM_SIZE;
+		}
+
+		static bool IsTypecode(Wg_Obj* obj) {
+			if (!Wg_IsString(obj))
+				return false;
+			std::string_view s = GetStringView(obj);
+			return s == "q" || s == "d";
+		}
+
+		static char GetTypecodeArg(Wg_Context* context, Wg_Obj** argv, int index) {
+			if (!IsTypecode(argv[index])) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "bad typecode (must be q or d)");
+				return 0;
+			}
+			return GetStringView(argv[index])[0];
+		}
+
+		static BufferObject* GetArray(Wg_Obj* obj) {
+			BufferObject* buf = GetBuffer(obj);
+			return buf && buf->kind == BufferObject::Kind::Array ? buf : nullptr;
+		}
+
+		static BufferObject* GetArrayArg(Wg_Context* context, Wg_Obj** argv, int index) {
+			BufferObject* buf = GetArray(argv[index]);
+			if (buf == nullptr)
+				Wg_RaiseArgumentTypeError(context, index, "array");
+			return buf;
+		}
+
+		// Converts a number to an item, raising TypeError if it is the wrong type
+		template <class T>
+		static bool ToItem(Wg_Context* context, Wg_Obj* value, T& out) {
+			if constexpr (std::is_same_v<T, Wg_int>) {
+				if (!Wg_IsInt(value)) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "array item must be integer");
+					return false;
+				}
+				out = Wg_GetInt(value);
+			} else {
+				if (!Wg_IsIntOrFloat(value)) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "array item must be a real number");
+					return false;
+				}
+				out = Wg_GetFloat(value);
+			}
+			return true;
+		}
+
+		static Wg_Obj* FromItem(Wg_Context* context, Wg_int value) {
+			return Wg_NewInt(context, value);
+		}
+
+		static Wg_Obj* FromItem(Wg_Context* context, Wg_float value) {
+			return Wg_NewFloat(context, value);
+		}
+
+		static BufferObject OwnedArray(char typecode, size_t length) {
+			BufferObject buf;
+			buf.kind = BufferObject::Kind::Array;
+			buf.readonly = false;
+			buf.typecode = typecode;
+			buf.storage = MakeRcPtr<BufferStorage>();
+			buf.storage->owned.resize(length * ITEM_SIZE);
+			buf.length = length * ITEM_SIZE;
+			return buf;
+		}
+
+		static bool InstallArray(Wg_Obj* obj, BufferObject buffer) {
+			Wg_Context* context = obj->context;
+			char typecode = buffer.typecode;
+			if (BufferObject* existing = GetArray(obj)) {
+				*existing = std::move(buffer);
+			} else {
+				auto* data = new BufferObject(std::move(buffer));
+				Wg_SetUserdata(obj, data);
+				Wg_RegisterFinalizer(obj, DeleteUserdata<BufferObject>, data);
+			}
+
+			Wg_Obj* typecodeStr = Wg_NewStringBuffer(context, &typecode, 1);
+			if (typecodeStr == nullptr)
+				return false;
+			Wg_SetAttribute(obj, "typecode", typecodeStr);
+			Wg_SetAttribute(obj, "itemsize", Wg_NewInt(context, (Wg_int)ITEM_SIZE));
+			return true;
+		}
+
+		// Creates an array without calling its constructor
+		static Wg_Obj* NewArray(Wg_Context* context, BufferObject buffer) {
+			Wg_Obj* klass = Wg_GetGlobal(context, "array");
+			if (klass == nullptr)
+				return nullptr;
+
+			Wg_Obj* obj = Alloc(context);
+			if (obj == nullptr)
+				return nullptr;
+			Wg_ObjRef ref(obj);
+
+			auto& cls = klass->Get<Wg_Obj::Class>();
+			obj->attributes = cls.instanceAttributes.Copy();
+			obj->type = cls.instanceType;
+			if (!InstallArray(obj, std::move(buffer)))
+				return nullptr;
+			return obj;
+		}
+
+		// Appends the numbers from an iterable, which may be another array
+		static bool AppendItems(Wg_Context* context, Wg_Obj* arrayObj, Wg_Obj* iterable) {
+			std::vector<unsigned char> items;
+			char typecode = GetArray(arrayObj)->typecode;
+
+			if (BufferObject* source = GetArray(iterable)) {
+				size_t len = Length(source);
+				items.resize(len * ITEM_SIZE);
+				bool ok = WithItemType(typecode, [&](auto to) {
+					using T = decltype(to);
+					return WithItemType(source->typecode, [&](auto from) {
+						using S = decltype(from);
+						if constexpr (std::is_same_v<T, Wg_int> && !std::is_same_v<S, Wg_int>) {
+							return false;
+						} else {
+							const S* src = Items<S>(source);
+							T* dst = (T*)items.data();
+							for (size_t i = 0; i < len; i++)
+								dst[i] = (T)src[i];
+							return true;
+						}
+						});
+					});
+				if (!ok) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "cannot convert a float array to an int array");
+					return false;
+				}
+			} else {
+				struct State {
+					Wg_Context* context;
+					char typecode;
+					std::vector<unsigned char>* items;
+				} s = { context, typecode, &items };
+
+				bool ok = Wg_Iterate(iterable, &s, [](Wg_Obj* value, void* userdata) {
+					auto* s = (State*)userdata;
+					return WithItemType(s->typecode, [&](auto tag) {
+						decltype(tag) item{};
+						if (!ToItem(s->context, value, item))
+							return false;
+						s->items->resize(s->items->size() + ITEM_SIZE);
+						std::memcpy(s->items->data() + s->items->size() - ITEM_SIZE, &item, ITEM_SIZE);
+						return true;
+						});
+					});
+				if (!ok)
+					return false;
+			}
+
+			BufferObject* buf = GetArray(arrayObj);
+			if (items.empty())
+				return true;
+			if (!CheckResizable(context, buf) || !ChargeBytes(context, items.size()))
+				return false;
+
+			// The array may refer to part of a storage that it no longer shares
+			auto& owned = buf->storage->owned;
+			owned.erase(owned.begin() + (buf->offset + buf->length), owned.end());
+			owned.erase(owned.begin(), owned.begin() + buf->offset);
+			owned.insert(owned.end(), items.begin(), items.end());
+			buf->offset = 0;
+			buf->length = owned.size();
+			return true;
+		}
+
+		// Computes the indices of a slice in the same way as slice.indices() in Python
+		static bool SliceIndices(Wg_Context* context, Wg_Obj* slice, size_t length, Wg_int& start, Wg_int& stop, Wg_int& step) {
+			Wg_Obj* attrs[3]{};
+			const char* names[3] = { "start", "stop", "step" };
+			for (int i = 0; i < 3; i++) {
+				if ((attrs[i] = Wg_GetAttribute(slice, names[i])) == nullptr)
+					return false;
+				if (!Wg_IsNone(attrs[i]) && !Wg_IsInt(attrs[i])) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "slice indices must be integers or None");
+					return false;
+				}
+			}
+
+			step = Wg_IsNone(attrs[2]) ? 1 : Wg_GetInt(attrs[2]);
+			if (step == 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "slice step cannot be zero");
+				return false;
+			}
+
+			Wg_int len = (Wg_int)length;
+			auto adjust = [&](Wg_Obj* value, Wg_int defaultValue) {
+				if (Wg_IsNone(value))
+					return defaultValue;
+				Wg_int i = Wg_GetInt(value);
+				if (i < 0)
+					i = std::max(i + len, step < 0 ? (Wg_int)-1 : (Wg_int)0);
+				else
+					i = std::min(i, step < 0 ? len - 1 : len);
+				return i;
+			};
+			start = adjust(attrs[0], step < 0 ? len - 1 : 0);
+			stop = adjust(attrs[1], step < 0 ? -1 : len);
+			return true;
+		}
+
+		static bool GetIndex(Wg_Context* context, Wg_Obj* indexObj, size_t length, size_t& out) {
+			Wg_Obj* index = Wg_UnaryOp(WG_UOP_INDEX, indexObj);
+			if (index == nullptr)
+				return false;
+			if (!Wg_IsInt(index)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "array indices must be integers");
+				return false;
+			}
+
+			Wg_int i = Wg_GetInt(index);
+			if (i < 0)
+				i += (Wg_int)length;
+			if (i < 0 || i >= (Wg_int)length) {
+				Wg_RaiseException(context, WG_EXC_INDEXERROR, "array index out of range");
+				return false;
+			}
+			out = (size_t)i;
+			return true;
+		}
+
+		// Reduces with independent accumulators. A single accumulator would make every
+		// step depend on the previous one, and the compiler is not allowed to reorder
+		// floating point additions into SIMD lanes by itself.
+		template <class Acc, class T, class F>
+		static Acc Reduce(const T* data, size_t n, Acc init, F f) {
+			Acc acc[LANES];
+			for (auto& a : acc)
+				a = init;
+
+			size_t i = 0;
+			for (; i + LANES <= n; i += LANES)
+				for (size_t j = 0; j < LANES; j++)
+					acc[j] = f(acc[j], (Acc)data[i + j]);
+
+			Acc total = init;
+			for (Acc a : acc)
+				total = f(total, a);
+			for (; i < n; i++)
+				total = f(total, (Acc)data[i]);
+			return total;
+		}
+
+		template <class Acc, class A, class B>
+		static Acc Dot(const A* a, const B* b, size_t n) {
+			Acc acc[LANES]{};
+			size_t i = 0;
+			for (; i + LANES <= n; i += LANES)
+				for (size_t j = 0; j < LANES; j++)
+					acc[j] += (Acc)a[i + j] * (Acc)b[i + j];
+
+			Acc total{};
+			for (Acc x : acc)
+				total += x;
+			for (; i < n; i++)
+				total += (Acc)a[i] * (Acc)b[i];
+			return total;
+		}
+
+		// Integer arithmetic is done unsigned so that overflow wraps
+		template <Op op, class R>
+		static R Apply(R a, R b) {
+			if constexpr (std::is_same_v<R, Wg_int>) {
+				if constexpr (op == Op::Add) return (Wg_int)((Wg_uint)a + (Wg_uint)b);
+				else if constexpr (op == Op::Sub) return (Wg_int)((Wg_uint)a - (Wg_uint)b);
+				else return (Wg_int)((Wg_uint)a * (Wg_uint)b);
+			} else {
+				if constexpr (op == Op::Add) return a + b;
+				else if constexpr (op == Op::Sub) return a - b;
+				else if constexpr (op == Op::Mul) return a * b;
+				else return a / b;
+			}
+		}
+
+		template <Op op, class R, class A, class B>
+		static void ElementWise(R* out, const A* a, const B* b, size_t n) {
+			for (size_t i = 0; i < n; i++)
+				out[i] = Apply<op, R>((R)a[i], (R)b[i]);
+		}
+
+		template <Op op, class R, class A>
+		static void ElementWiseScalar(R* out, const A* a, R b, size_t n) {
+			for (size_t i = 0; i < n; i++)
+				out[i] = Apply<op, R>((R)a[i], b);
+		}
+
+		static Wg_Obj* array_init(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(2, 3);
+			char typecode = GetTypecodeArg(context, argv, 1);
+			if (typecode == 0)
+				return nullptr;
+
+			if (!InstallArray(argv[0], OwnedArray(typecode, 0)))
+				return nullptr;
+			if (argc == 3 && !AppendItems(context, argv[0], argv[2]))
+				return nullptr;
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* array_len(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			return Wg_NewInt(context, (Wg_int)Length(buf));
+		}
+
+		static Wg_Obj* array_nonzero(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			return Wg_NewBool(context, buf->length != 0);
+		}
+
+		static Wg_Obj* array_repr(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			std::string s = "array('";
+			s += buf->typecode;
+			s += "'";
+			size_t len = Length(buf);
+			for (size_t i = 0; i < len; i++) {
+				Wg_Obj* item = WithItemType(buf->typecode, [&](auto tag) {
+					return FromItem(context, Items<decltype(tag)>(buf)[i]);
+					});
+				if (item == nullptr)
+					return nullptr;
+				Wg_Obj* repr = Wg_UnaryOp(WG_UOP_REPR, item);
+				if (repr == nullptr)
+					return nullptr;
+				s += i == 0 ? ", [" : ", ";
+				s += GetStringView(repr);
+				if ((buf = GetArrayArg(context, argv, 0)) == nullptr)
+					return nullptr;
+				len = std::min(len, Length(buf));
+			}
+			s += len ? "])" : ")";
+			return Wg_NewStringBuffer(context, s.data(), (int)s.size());
+		}
+
+		static Wg_Obj* array_getitem(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			if (Wg_IsInstance(argv[1], &context->builtins.slice, 1)) {
+				Wg_int start, stop, step;
+				if (!SliceIndices(context, argv[1], Length(buf), start, stop, step))
+					return nullptr;
+
+				std::vector<Wg_int> indices;
+				for (Wg_int i = start; step > 0 ? i < stop : i > stop; i += step)
+					indices.push_back(i);
+
+				BufferObject sliced = OwnedArray(buf->typecode, indices.size());
+				const unsigned char* src = buf->Data();
+				unsigned char* dst = sliced.storage->owned.data();
+				for (size_t i = 0; i < indices.size(); i++)
+					std::memcpy(dst + i * ITEM_SIZE, src + (size_t)indices[i] * ITEM_SIZE, ITEM_SIZE);
+				return NewArray(context, std::move(sliced));
+			}
+
+			size_t index{};
+			if (!GetIndex(context, argv[1], Length(buf), index))
+				return nullptr;
+			if ((buf = GetArrayArg(context, argv, 0)) == nullptr || index >= Length(buf))
+				return nullptr;
+			return WithItemType(buf->typecode, [&](auto tag) {
+				return FromItem(context, Items<decltype(tag)>(buf)[index]);
+				});
+		}
+
+		static Wg_Obj* array_setitem(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(3);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			if (buf->readonly) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "cannot modify read-only memory");
+				return nullptr;
+			}
+
+			if (Wg_IsInstance(argv[1], &context->builtins.slice, 1)) {
+				Wg_int start, stop, step;
+				if (!SliceIndices(context, argv[1], Length(buf), start, stop, step))
+					return nullptr;
+
+				// The values are collected first in case they come from the same array
+				Wg_Obj* values = NewArray(context, OwnedArray(buf->typecode, 0));
+				if (values == nullptr)
+					return nullptr;
+				Wg_ObjRef ref(values);
+				if (!AppendItems(context, values, argv[2]))
+					return nullptr;
+				if ((buf = GetArrayArg(context, argv, 0)) == nullptr)
+					return nullptr;
+
+				const BufferObject* src = GetArray(values);
+				Wg_int size = (Wg_int)Length(buf);
+				if (step == 1) {
+					start = std::clamp(start, (Wg_int)0, size);
+					stop = std::clamp(stop, start, size);
+					size_t count = (size_t)(stop - start);
+					if (Length(src) == count) {
+						// An empty array may have no storage to copy from
+						if (count)
+							std::memcpy(buf->Data() + (size_t)start * ITEM_SIZE, src->Data(), count * ITEM_SIZE);
+						return Wg_None(context);
+					}
+
+					size_t grown = Length(src) > count ? (Length(src) - count) * ITEM_SIZE : 0;
+					if (!CheckResizable(context, buf) || !ChargeBytes(context, grown))
+						return nullptr;
+
+					// The array may refer to part of a storage that it no longer shares
+					auto& owned = buf->storage->owned;
+					owned.erase(owned.begin() + (buf->offset + buf->length), owned.end());
+					owned.erase(owned.begin(), owned.begin() + buf->offset);
+					owned.erase(owned.begin() + (size_t)start * ITEM_SIZE, owned.begin() + (size_t)stop * ITEM_SIZE);
+					if (src->length)
+						owned.insert(owned.begin() + (size_t)start * ITEM_SIZE, src->Data(), src->Data() + src->length);
+					buf->offset = 0;
+					buf->length = owned.size();
+					return Wg_None(context);
+				}
+
+				std::vector<Wg_int> indices;
+				for (Wg_int i = start; step > 0 ? i < stop : i > stop; i += step)
+					if (i < size)
+						indices.push_back(i);
+
+				if (indices.size() != Length(src)) {
+					std::string msg = "attempt to assign array of size " + std::to_string(Length(src))
+						+ " to extended slice of size " + std::to_string(indices.size());
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, msg.c_str());
+					return nullptr;
+				}
+				for (size_t i = 0; i < indices.size(); i++)
+					std::memcpy(buf->Data() + (size_t)indices[i] * ITEM_SIZE, src->Data() + i * ITEM_SIZE, ITEM_SIZE);
+				return Wg_None(context);
+			}
+
+			size_t index{};
+			if (!GetIndex(context, argv[1], Length(buf), index))
+				return nullptr;
+			bool ok = WithItemType(buf->typecode, [&](auto tag) {
+				decltype(tag) item{};
+				if (!ToItem(context, argv[2], item))
+					return false;
+				Items<decltype(tag)>(buf)[index] = item;
+				return true;
+				});
+			if (!ok)
+				return nullptr;
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* array_iter(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			if (GetArrayArg(context, argv, 0) == nullptr)
+				return nullptr;
+
+			Wg_Obj* klass = Wg_GetGlobal(context, "arrayiterator");
+			if (klass == nullptr)
+				return nullptr;
+
+			Wg_Obj* it = Alloc(context);
+			if (it == nullptr)
+				return nullptr;
+			Wg_ObjRef ref(it);
+
+			auto& cls = klass->Get<Wg_Obj::Class>();
+			it->attributes = cls.instanceAttributes.Copy();
+			it->type = cls.instanceType;
+			auto* data = new ArrayIterator();
+			Wg_SetUserdata(it, data);
+			Wg_RegisterFinalizer(it, DeleteUserdata<ArrayIterator>, data);
+			Wg_SetAttribute(it, "_array", argv[0]);
+			return it;
+		}
+
+		static Wg_Obj* arrayiterator_next(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			ArrayIterator* it{};
+			if (!TryGetUserdata(argv[0], "arrayiterator", &it)) {
+				Wg_RaiseArgumentTypeError(context, 0, "arrayiterator");
+				return nullptr;
+			}
+
+			Wg_Obj* arrayObj = Wg_GetAttribute(argv[0], "_array");
+			if (arrayObj == nullptr)
+				return nullptr;
+			BufferObject* buf = GetArray(arrayObj);
+			if (buf == nullptr || it->index >= Length(buf)) {
+				Wg_RaiseException(context, WG_EXC_STOPITERATION);
+				return nullptr;
+			}
+
+			size_t index = it->index++;
+			return WithItemType(buf->typecode, [&](auto tag) {
+				return FromItem(context, Items<decltype(tag)>(buf)[index]);
+				});
+		}
+
+		static Wg_Obj* array_append(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			if (GetArrayArg(context, argv, 0) == nullptr)
+				return nullptr;
+
+			Wg_Obj* item = Wg_NewTuple(context, &argv[1], 1);
+			if (item == nullptr || !AppendItems(context, argv[0], item))
+				return nullptr;
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* array_extend(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			if (GetArrayArg(context, argv, 0) == nullptr)
+				return nullptr;
+			if (!AppendItems(context, argv[0], argv[1]))
+				return nullptr;
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* array_tolist(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			Wg_Obj* list = Wg_NewList(context);
+			if (list == nullptr)
+				return nullptr;
+			Wg_ObjRef ref(list);
+
+			auto& items = list->Get<std::vector<Wg_Obj*>>();
+			items.reserve(Length(buf));
+			for (size_t i = 0; i < Length(buf); i++) {
+				Wg_Obj* item = WithItemType(buf->typecode, [&](auto tag) {
+					return FromItem(context, Items<decltype(tag)>(buf)[i]);
+					});
+				if (item == nullptr)
+					return nullptr;
+				list->Get<std::vector<Wg_Obj*>>().push_back(item);
+				WriteBarrier(list);
+			}
+			return list;
+		}
+
+		static Wg_Obj* array_tobytes(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			return Wg_NewBytes(context, buf->Data(), (int)buf->length);
+		}
+
+		static Wg_Obj* array_sum(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			size_t len = Length(buf);
+			if (buf->typecode == 'q') {
+				Wg_uint sum = Reduce(Items<Wg_int>(buf), len, (Wg_uint)0, [](Wg_uint a, Wg_uint b) { return a + b; });
+				return Wg_NewInt(context, (Wg_int)sum);
+			} else {
+				Wg_float sum = Reduce(Items<Wg_float>(buf), len, (Wg_float)0, [](Wg_float a, Wg_float b) { return a + b; });
+				return Wg_NewFloat(context, sum);
+			}
+		}
+
+		static Wg_Obj* array_mean(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			size_t len = Length(buf);
+			if (len == 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "mean() of an empty array");
+				return nullptr;
+			}
+			Wg_float sum = WithItemType(buf->typecode, [&](auto tag) {
+				return Reduce(Items<decltype(tag)>(buf), len, (Wg_float)0, [](Wg_float a, Wg_float b) { return a + b; });
+				});
+			return Wg_NewFloat(context, sum / (Wg_float)len);
+		}
+
+		template <bool max>
+		static Wg_Obj* array_minmax(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetArrayArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			size_t len = Length(buf);
+			if (len == 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, max ? "max() of an empty array" : "min() of an empty array");
+				return nullptr;
+			}
+			return WithItemType(buf->typecode, [&](auto tag) {
+				using T = decltype(tag);
+				const T* items = Items<T>(buf);
+				T result = Reduce(items, len, items[0], [](T a, T b) {
+					if constexpr (max) {
+						return a < b ? b : a;
+					} else {
+						return b < a ? b : a;
+					}
+					});
+				return FromItem(context, result);
+				});
+		}
+
+		static Wg_Obj* array_dot(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* a = GetArrayArg(context, argv, 0);
+			if (a == nullptr)
+				return nullptr;
+			BufferObject* b = GetArrayArg(context, argv, 1);
+			if (b == nullptr)
+				return nullptr;
+			if (Length(a) != Length(b)) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "arrays must have the same length");
+				return nullptr;
+			}
+
+			size_t len = Length(a);
+			if (a->typecode == 'q' && b->typecode == 'q')
+				return Wg_NewInt(context, (Wg_int)Dot<Wg_uint>(Items<Wg_int>(a), Items<Wg_int>(b), len));
+
+			Wg_float dot = WithItemType(a->typecode, [&](auto aTag) {
+				return WithItemType(b->typecode, [&](auto bTag) {
+					return Dot<Wg_float>(Items<decltype(aTag)>(a), Items<decltype(bTag)>(b), len);
+					});
+				});
+			return Wg_NewFloat(context, dot);
+		}
+
+		template <Op op>
+		static Wg_Obj* array_binop(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* a = GetArrayArg(context, argv, 0);
+			if (a == nullptr)
+				return nullptr;
+
+			BufferObject* b = GetArray(argv[1]);
+			char rhsType{};
+			if (b) {
+				if (Length(a) != Length(b)) {
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, "arrays must have the same length");
+					return nullptr;
+				}
+				rhsType = b->typecode;
+			} else if (Wg_IsInt(argv[1])) {
+				rhsType = 'q';
+			} else if (Wg_IsIntOrFloat(argv[1])) {
+				rhsType = 'd';
+			} else {
+				Wg_RaiseArgumentTypeError(context, 1, "array, int or float");
+				return nullptr;
+			}
+
+			size_t len = Length(a);
+			char resultType = op == Op::Div || a->typecode == 'd' || rhsType == 'd' ? 'd' : 'q';
+			BufferObject result = OwnedArray(resultType, len);
+
+			WithItemType(resultType, [&](auto rTag) {
+				using R = decltype(rTag);
+				R* out = Items<R>(&result);
+				WithItemType(a->typecode, [&](auto aTag) {
+					using A = decltype(aTag);
+					if (b == nullptr) {
+						R scalar = std::is_same_v<R, Wg_int> ? (R)Wg_GetInt(argv[1]) : (R)Wg_GetFloat(argv[1]);
+						ElementWiseScalar<op, R>(out, Items<A>(a), scalar, len);
+					} else {
+						WithItemType(b->typecode, [&](auto bTag) {
+							ElementWise<op, R>(out, Items<A>(a), Items<decltype(bTag)>(b), len);
+							});
+					}
+					});
+				});
+			return NewArray(context, std::move(result));
+		}
+
+		// frombuffer(typecode, buffer) creates an array that shares the memory of a
+		// bytes, bytearray, memoryview or array instead of copying it. It is read-only
+		// if the buffer is. Host memory can be shared with Wg_NewBufferView().
+		static Wg_Obj* frombuffer(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			char typecode = GetTypecodeArg(context, argv, 0);
+			if (typecode == 0)
+				return nullptr;
+
+			BufferObject* source = GetBuffer(argv[1]);
+			if (source == nullptr) {
+				Wg_RaiseArgumentTypeError(context, 1, "bytes, bytearray, memoryview or array");
+				return nullptr;
+			} else if (source->storage == nullptr) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "operation forbidden on released memoryview object");
+				return nullptr;
+			} else if (source->length % ITEM_SIZE != 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "buffer size must be a multiple of element size");
+				return nullptr;
+			} else if ((uintptr_t)source->Data() % alignof(Wg_int) != 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "buffer is not aligned to the element size");
+				return nullptr;
+			}
+
+			BufferObject view = *source;
+			view.kind = BufferObject::Kind::Array;
+			view.typecode = typecode;
+			return NewArray(context, std::move(view));
+		}
+	}
+
+	bool ImportArray(Wg_Context* context) {
+		using namespace arraymodule;
+		try {
+			Wg_Obj* array = Wg_NewClass(context, "array", nullptr, 0);
+			if (array == nullptr)
+				throw LibraryInitException();
+			Wg_SetGlobal(context, "array", array);
+			RegisterMethod(array, "__init__", array_init);
+			RegisterMethod(array, "__len__", array_len);
+			RegisterMethod(array, "__nonzero__", array_nonzero);
+			RegisterMethod(array, "__str__", array_repr);
+			RegisterMethod(array, "__repr__", array_repr);
+			RegisterMethod(array, "__getitem__", array_getitem);
+			RegisterMethod(array, "__setitem__", array_setitem);
+			RegisterMethod(array, "__iter__", array_iter);
+			RegisterMethod(array, "__add__", array_binop<Op::Add>);
+			RegisterMethod(array, "__sub__", array_binop<Op::Sub>);
+			RegisterMethod(array, "__mul__", array_binop<Op::Mul>);
+			RegisterMethod(array, "__truediv__", array_binop<Op::Div>);
+			RegisterMethod(array, "append", array_append);
+			RegisterMethod(array, "extend", array_extend);
+			RegisterMethod(array, "tolist", array_tolist);
+			RegisterMethod(array, "tobytes", array_tobytes);
+			RegisterMethod(array, "sum", array_sum);
+			RegisterMethod(array, "mean", array_mean);
+			RegisterMethod(array, "min", array_minmax<false>);
+			RegisterMethod(array, "max", array_minmax<true>);
+			RegisterMethod(array, "dot", array_dot);
+
+			Wg_Obj* iterator = Wg_NewClass(context, "arrayiterator", nullptr, 0);
+			if (iterator == nullptr)
+				throw LibraryInitException();
+			Wg_SetGlobal(context, "arrayiterator", iterator);
+			RegisterMethod(iterator, "__next__", arrayiterator_next);
+			RegisterMethod(iterator, "__iter__", [](Wg_Context* context, Wg_Obj** argv, int argc) -> Wg_Obj* {
+				WG_EXPECT_ARG_COUNT(1);
+				return argv[0];
+				});
+
+			RegisterFunction(context, "frombuffer", frombuffer);
+			RegisterConstant(context, "typecodes", Wg_NewString, "qd");
+			return true;
+		} catch (LibraryInitException&) {
+			return false;
+		}
+	}
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "wings.h"
+
+namespace wings {
+	bool ImportArray(Wg_Context* context);
+}
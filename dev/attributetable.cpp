@@ -2,20 +2,58 @@
 
 namespace wings {
 
+	// Tables with more attributes than this get their own shape
+	// to avoid copying large index maps on every insertion.
+	static constexpr size_t MAX_SHARED_SHAPE_SIZE = 64;
+
 	AttributeTable::AttributeTable() :
 		attributes(MakeRcPtr<Table>()),
 		owned(true)
 	{
 	}
 
+	AttributeTable::AttributeTable(RcPtr<Table> attributes, bool owned) :
+		attributes(std::move(attributes)),
+		owned(owned)
+	{
+	}
+
 	Wg_Obj* AttributeTable::Get(const std::string& name) const {
 		return attributes->Get(name);
 	}
 
+	Wg_Obj* AttributeTable::Get(const std::string& name, InlineCache& cache) const {
+		const Table& table = *attributes;
+		if (table.shape && table.shape == cache.shape)
+			return table.values[cache.index];
+
+		if (const size_t* index = table.Find(name)) {
+			cache.shape = table.shape;
+			cache.index = *index;
+			cache.next = nullptr;
+			return table.values[*index];
+		}
+
+		for (const auto& parent : table.parents)
+			if (Wg_Obj* val = parent->Get(name))
+				return val;
+
+		return nullptr;
+	}
+
+	const size_t* AttributeTable::Table::Find(const std::string& name) const {
+		if (shape == nullptr)
+			return nullptr;
+
+		auto it = shape->indices.find(name);
+		if (it == shape->indices.end())
+			return nullptr;
+		return &it->second;
+	}
+
 	Wg_Obj* AttributeTable::Table::Get(const std::string& name) const {
-		auto it = entries.find(name);
-		if (it != entries.end())
-			return it->second;
+		if (const size_t* index = Find(name))
+			return values[*index];
 
 		for (const auto& parent : parents)
 			if (Wg_Obj* val = parent->Get(name))
@@ -32,8 +70,60 @@ namespace wings {
 	}
 
 	void AttributeTable::Set(const std::string& name, Wg_Obj* value) {
+		InlineCache cache;
+		Set(name, value, cache);
+	}
+
+	void AttributeTable::Set(const std::string& name, Wg_Obj* value, InlineCache& cache) {
 		Mutate();
-		attributes->entries[name] = value;
+		Table& table = *attributes;
+
+		if (table.shape && table.shape == cache.shape) {
+			if (cache.next) {
+				table.values.push_back(value);
+				table.shape = cache.next;
+			} else {
+				table.values[cache.index] = value;
+			}
+			return;
+		}
+
+		if (const size_t* index = table.Find(name)) {
+			table.values[*index] = value;
+			cache.shape = table.shape;
+			cache.index = *index;
+			cache.next = nullptr;
+			return;
+		}
+
+		size_t index = table.values.size();
+		table.values.push_back(value);
+
+		if (table.shape == nullptr) {
+			table.shape = MakeRcPtr<Shape>();
+		}
+
+		if (!table.shape->shared) {
+			table.shape->indices.insert({ name, index });
+			return;
+		}
+
+		auto& next = table.shape->transitions[name];
+		if (next == nullptr) {
+			next = MakeRcPtr<Shape>();
+			next->indices = table.shape->indices;
+			next->indices.insert({ name, index });
+		}
+
+		if (next->indices.size() > MAX_SHARED_SHAPE_SIZE) {
+			table.shape = MakeRcPtr<Shape>(Shape{ next->indices, {}, false });
+			return;
+		}
+
+		cache.shape = table.shape;
+		cache.index = index;
+		cache.next = next;
+		table.shape = next;
 	}
 
 	void AttributeTable::AddParent(AttributeTable& parent) {
@@ -41,15 +131,64 @@ namespace wings {
 	}
 
 	AttributeTable AttributeTable::Copy() {
-		AttributeTable copy;
-		copy.attributes = attributes;
-		copy.owned = false;
+		return AttributeTable(attributes, false);
+	}
+
+	AttributeTable AttributeTable::Clone(Cloner& cloner) const {
+		return AttributeTable(cloner.CloneTable(attributes), owned);
+	}
+
+	RcPtr<AttributeTable::Table> AttributeTable::Cloner::CloneTable(const RcPtr<Table>& table) {
+		auto& copy = tables[table.get()];
+		if (copy == nullptr) {
+			copy = MakeRcPtr<Table>();
+			copy->shape = CloneShape(table->shape);
+			copy->values.reserve(table->values.size());
+			for (Wg_Obj* value : table->values)
+				copy->values.push_back(remap(value));
+			for (const auto& parent : table->parents)
+				copy->parents.push_back(CloneTable(parent));
+		}
+		return copy;
+	}
+
+	RcPtr<AttributeTable::Shape> AttributeTable::Cloner::CloneShape(const RcPtr<Shape>& shape) {
+		if (shape == nullptr)
+			return nullptr;
+
+		auto& copy = shapes[shape.get()];
+		if (copy == nullptr) {
+			copy = MakeRcPtr<Shape>(Shape{ shape->indices, {}, shape->shared });
+			for (const auto& [name, next] : shape->transitions)
+				copy->transitions.insert({ name, CloneShape(next) });
+		}
 		return copy;
 	}
 
+	bool AttributeTable::IsUnmodifiedCopyOf(const AttributeTable& other) const {
+		return !owned && attributes == other.attributes;
+	}
+
+	size_t AttributeTable::MemoryUsage() const {
+		if (!owned)
+			return 0;
+
+		const Table& table = *attributes;
+		size_t bytes = sizeof(Table)
+			+ table.values.capacity() * sizeof(Wg_Obj*)
+			+ table.parents.capacity() * sizeof(RcPtr<Table>);
+		if (table.shape && !table.shape->shared) {
+			for (const auto& entry : table.shape->indices)
+				bytes += sizeof(entry) + 2 * sizeof(void*) + entry.first.capacity();
+		}
+		return bytes;
+	}
+
 	void AttributeTable::Mutate() {
 		if (!owned) {
 			attributes = MakeRcPtr<Table>(*attributes);
+			if (attributes->shape && !attributes->shape->shared)
+				attributes->shape = MakeRcPtr<Shape>(*attributes->shape);
 			owned = true;
 		}
 	}
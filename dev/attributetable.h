@@ -5,11 +5,46 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <functional>
 #include <cstdlib>
 
 namespace wings {
 
 	struct AttributeTable {
+	private:
+		struct Table;
+	public:
+		// The layout of a table. Tables that had the same attributes
+		// added in the same order share a shape so that the position
+		// of an attribute can be cached across objects.
+		struct Shape {
+			std::unordered_map<std::string, size_t> indices;
+			std::unordered_map<std::string, RcPtr<Shape>> transitions;
+			// Unshared shapes belong to a single table and are modified in place
+			bool shared = true;
+		};
+
+		// Remembers where an attribute was last found or added.
+		struct InlineCache {
+			RcPtr<Shape> shape;
+			size_t index = 0;
+			// The shape that results from adding the attribute to 'shape'
+			RcPtr<Shape> next;
+		};
+
+		// Copies tables into another heap. Tables and shapes that are shared
+		// between the originals are also shared between the copies.
+		struct Cloner {
+			// Maps an object to its copy
+			std::function<Wg_Obj*(Wg_Obj*)> remap;
+		private:
+			friend AttributeTable;
+			RcPtr<Table> CloneTable(const RcPtr<Table>& table);
+			RcPtr<Shape> CloneShape(const RcPtr<Shape>& shape);
+			std::unordered_map<const Table*, RcPtr<Table>> tables;
+			std::unordered_map<const Shape*, RcPtr<Shape>> shapes;
+		};
+
 		AttributeTable();
 		AttributeTable(const AttributeTable&) = delete;
 		AttributeTable(AttributeTable&&) = default;
@@ -17,20 +52,29 @@ namespace wings {
 		AttributeTable& operator=(AttributeTable&&) = default;
 		
 		Wg_Obj* Get(const std::string& name) const;
+		Wg_Obj* Get(const std::string& name, InlineCache& cache) const;
 		Wg_Obj* GetFromBase(const std::string& name) const;
 		void Set(const std::string& name, Wg_Obj* value);
+		void Set(const std::string& name, Wg_Obj* value, InlineCache& cache);
 		
 		void AddParent(AttributeTable& parent);
 		AttributeTable Copy();
+		AttributeTable Clone(Cloner& cloner) const;
+		bool IsUnmodifiedCopyOf(const AttributeTable& other) const;
+		// The bytes owned by this table, which is 0 for an unmodified copy
+		size_t MemoryUsage() const;
 		template <class Fn> void ForEach(Fn fn) const;
 	private:		
 		struct Table {
 			Wg_Obj* Get(const std::string& name) const;
+			const size_t* Find(const std::string& name) const;
 			template <class Fn> void ForEach(Fn fn) const;
-			std::unordered_map<std::string, Wg_Obj*> entries;
+			RcPtr<Shape> shape;
+			std::vector<Wg_Obj*> values;
 			std::vector<RcPtr<Table>> parents;
 		};
 
+		AttributeTable(RcPtr<Table> attributes, bool owned);
 		void Mutate();
 
 		RcPtr<Table> attributes;
@@ -44,11 +88,10 @@ namespace wings {
 
 	template <class Fn>
 	void AttributeTable::Table::ForEach(Fn fn) const {
-		for (const auto& [_, val] : entries)
+		for (const auto& val : values)
 			fn(val);
 
 		for (const auto& parent : parents)
 			parent->ForEach(fn);
 	}
 }
-
@@ -1,5 +1,6 @@
 #include "builtinsmodule.h"
 #include "common.h"
+#include "executor.h"
 
 #include <iostream>
 #include <sstream>
@@ -14,6 +15,13 @@
 #include <cstring>
 #include <bit>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace wings {
 	static const char* const BUILTINS_CODE = R"(
 class __DefaultIter:
@@ -43,39 +51,10 @@ class __DefaultReverseIter:
 	def __iter__(self):
 		return self
 
-class __RangeIter:
-	def __init__(self, start, stop, step):
-		self.cur = start
-		self.stop = stop
-		self.step = step
-	def __next__(self):
-		cur = self.cur
-		if self.step > 0:
-			if cur >= self.stop:
-				raise StopIteration
-		else:
-			if cur <= self.stop:
-				raise StopIteration
-		self.cur = cur + self.step
-		return cur
-	def __iter__(self):
-		return self
-
 class __CodeObject:
 	def __init__(self, f):
 		self.f = f
 
-class __ReadLineIter:
-	def __init__(self, f):
-		self.f = f
-	def __next__(self):
-		line = self.f.readline()
-		if line == "":
-			raise StopIteration
-		return line
-	def __iter__(self):
-		return self
-
 def abs(x):
 	return x.__abs__()
 
@@ -94,30 +73,6 @@ def any(x):
 def divmod(a, b):
 	return (a // b, a % b)
 
-class enumerate:
-	def __init__(self, x, start=0):
-		self.iter = iter(x)
-		self.i = start
-	def __iter__(self):
-		return self
-	def __next__(self):
-		i = self.i
-		self.i += 1
-		return (i, next(self.iter))
-
-class filter:
-	def __init__(self, f, iterable):
-		self.f = f
-		self.iter = iter(iterable)
-	def __iter__(self):
-		return self
-	def __next__(self):
-		while True:
-			val = next(self.iter)
-			if self.f(val):
-				return val
-		raise StopIteration
-
 def hasattr(obj, name):
 	try:
 		getattr(obj, name)
@@ -125,121 +80,15 @@ def hasattr(obj, name):
 	except AttributeError:
 		return False
 
-def hash(x):
-	v = x.__hash__()
-	if not isinstance(v, int):
-		raise TypeError("__hash__() returned a non integer type")
-	return v
-
 def iter(x):
 	return x.__iter__()
 
-def len(x):
-	v = x.__len__()
-	if not isinstance(v, int):
-		raise TypeError("__len__() returned a non integer type")
-	elif v < 0:
-		raise ValueError("__len__() returned a negative value")
-	return v
-
-class map:
-	def __init__(self, f, iterable):
-		self.f = f
-		self.iter = iter(iterable)
-	def __iter__(self):
-		return self
-	def __next__(self):
-		return self.f(next(self.iter))
-
-def max(*args, **kwargs):
-	if len(args) == 1:
-		args = list(args[0])
-	else:
-		args = list(args)
-
-	if len(args) == 0:
-		if "default" in kwargs:
-			return kwargs["default"]
-		raise ValueError("max() arg is an empty sequence")
-		
-	if "key" in kwargs:
-		key = kwargs["key"]
-	else:
-		key = lambda x: x
-	
-	m = args[0]
-	for i in range(1, len(args)):
-		if key(args[i]) > key(m):
-			m = args[i]
-	return m
-
-def min(*args, **kwargs):
-	if len(args) == 1:
-		args = list(args[0])
-	else:
-		args = list(args)
-
-	if len(args) == 0:
-		if "default" in kwargs:
-			return kwargs["default"]
-		raise ValueError("min() arg is an empty sequence")
-		
-	if "key" in kwargs:
-		key = kwargs["key"]
-	else:
-		key = lambda x: x
-	
-	m = args[0]
-	for i in range(1, len(args)):
-		if key(args[i]) < key(m):
-			m = args[i]
-	return m
-
 def next(x):
 	return x.__next__()
 
 def pow(x, y):
 	return x ** y
 
-class range:
-	def __init__(self, start, stop=None, step=None):
-		if step is 0:
-			raise ValueError("step cannot be 0")
-		if stop == None:
-			if not isinstance(start, int):
-				raise TypeError("stop must be an integer")
-			self.start = 0
-			self.stop = start
-			self.step = 1
-		elif step is None:
-			if not isinstance(start, int):
-				raise TypeError("start must be an integer")
-			elif not isinstance(stop, int):
-				raise TypeError("start must be an integer")
-			self.start = start
-			self.stop = stop
-			self.step = 1
-		else:
-			if not isinstance(start, int):
-				raise TypeError("start must be an integer")
-			elif not isinstance(stop, int):
-				raise TypeError("start must be an integer")
-			elif not isinstance(step, int):
-				raise TypeError("step must be an integer")
-			self.start = start
-			self.stop = stop
-			self.step = step
-	def __iter__(self):
-		return __RangeIter(self.start, self.stop, self.step)
-	def __reversed__(self):
-		return range(self.stop - self.step, self.start - self.step, -self.step)
-
-def repr(x):
-	v = x.__repr__()
-	if not isinstance(v, str):
-		raise TypeError("__repr__() returned a non string type")
-	return v
-
 def reversed(x):
 	return x.__reversed__()
 
@@ -260,28 +109,9 @@ class slice:
 	def __index__(self):
 		return self
 
-def sorted(iterable, key=None, reverse=False):
-	li = list(iterable)
-	li.sort(key=key, reverse=reverse)
-	return li
-
-def sum(iterable, start=0):
-	n = start
-	for i in iterable:
-		n += i
-	return n
-
 def type(x):
 	return x.__class__
 
-class zip:
-	def __init__(self, *iterables):
-		self.iters = [iter(i) for i in iterables]
-	def __iter__(self):
-		return self
-	def __next__(self):
-		return tuple([next(i) for i in self.iters])
-
 class BaseException:
 	def __init__(self, message=""):
 		self._message = message
@@ -294,6 +124,9 @@ class WingsTimeoutError(BaseException):
 class SystemExit(BaseException):
 	pass
 
+class GeneratorExit(BaseException):
+	pass
+
 class Exception(BaseException):
 	pass
 
@@ -353,6 +186,9 @@ class TypeError(Exception):
 
 class ValueError(Exception):
 	pass
+
+class BufferError(Exception):
+	pass
 	)";
 
 
@@ -547,60 +383,598 @@ class ValueError(Exception):
 			|| c == '\v' || c == '\f';
 	}
 
-	static bool MergeSort(Wg_Obj** data, size_t len, Wg_Obj* key) {
-		if (len == 1)
+	// An adaptive stable merge sort in the style of timsort. The ascending and
+	// strictly descending runs already in the data are merged, so sorted or nearly
+	// sorted input takes close to linear time. Runs shorter than minRun are
+	// extended with a binary insertion sort. less returns std::nullopt if the
+	// comparison raised an exception.
+	template <class T, class Less>
+	static bool TimSort(std::vector<T>& data, Less less) {
+		size_t n = data.size();
+		if (n < 2)
+			return true;
+
+		size_t minRun = n;
+		size_t remainder = 0;
+		while (minRun >= 64) {
+			remainder |= minRun & 1;
+			minRun >>= 1;
+		}
+		minRun += remainder;
+
+		struct Run {
+			size_t start;
+			size_t len;
+		};
+		std::vector<Run> runs;
+		std::vector<T> tmp;
+
+		auto merge = [&](size_t r) -> bool {
+			Run& a = runs[r];
+			Run& b = runs[r + 1];
+			size_t mid = b.start;
+			size_t end = b.start + b.len;
+
+			// The runs may already be in order
+			auto ordered = less(data[mid], data[mid - 1]);
+			if (!ordered)
+				return false;
+			if (*ordered) {
+				tmp.assign(data.begin() + a.start, data.begin() + mid);
+				size_t i = 0;
+				size_t j = mid;
+				size_t k = a.start;
+				while (i < tmp.size() && j < end) {
+					auto lt = less(data[j], tmp[i]);
+					if (!lt)
+						return false;
+					data[k++] = *lt ? data[j++] : tmp[i++];
+				}
+				std::copy(tmp.begin() + i, tmp.end(), data.begin() + k);
+			}
+
+			a.len += b.len;
+			runs.erase(runs.begin() + r + 1);
+			return true;
+		};
+
+		for (size_t lo = 0; lo < n; ) {
+			size_t hi = lo + 1;
+			if (hi < n) {
+				auto descending = less(data[hi], data[lo]);
+				if (!descending)
+					return false;
+				for (hi++; hi < n; hi++) {
+					auto lt = less(data[hi], data[hi - 1]);
+					if (!lt)
+						return false;
+					if (*lt != *descending)
+						break;
+				}
+				// Only strictly descending runs are reversed, which keeps the sort stable
+				if (*descending)
+					std::reverse(data.begin() + lo, data.begin() + hi);
+			}
+
+			size_t end = std::min(n, lo + std::max(minRun, hi - lo));
+			for (size_t i = hi; i < end; i++) {
+				size_t left = lo;
+				size_t right = i;
+				while (left < right) {
+					size_t mid = left + (right - left) / 2;
+					auto lt = less(data[i], data[mid]);
+					if (!lt)
+						return false;
+					if (*lt) {
+						right = mid;
+					} else {
+						left = mid + 1;
+					}
+				}
+				std::rotate(data.begin() + left, data.begin() + i, data.begin() + i + 1);
+			}
+			runs.push_back({ lo, end - lo });
+			lo = end;
+
+			// Keep the pending run lengths growing faster than the Fibonacci
+			// numbers so that merges stay balanced
+			while (runs.size() > 1) {
+				size_t k = runs.size();
+				if ((k >= 3 && runs[k - 3].len <= runs[k - 2].len + runs[k - 1].len)
+					|| (k >= 4 && runs[k - 4].len <= runs[k - 3].len + runs[k - 2].len)) {
+					if (!merge(runs[k - 3].len < runs[k - 1].len ? k - 3 : k - 2))
+						return false;
+				} else if (runs[k - 2].len <= runs[k - 1].len) {
+					if (!merge(k - 2))
+						return false;
+				} else {
+					break;
+				}
+			}
+		}
+
+		while (runs.size() > 1)
+			if (!merge(runs.size() - 2))
+				return false;
+		return true;
+	}
+
+	// Sorts items by the corresponding keys. If every key is a plain int, float
+	// or str, they are compared natively rather than through __lt__.
+	static bool SortObjects(std::vector<Wg_Obj*>& items, const std::vector<Wg_Obj*>& keys, bool reverse) {
+		auto sortBy = [&](auto getKey, auto less) {
+			using Entry = std::pair<decltype(getKey(keys[0])), Wg_Obj*>;
+			std::vector<Entry> entries;
+			entries.reserve(items.size());
+			for (size_t i = 0; i < items.size(); i++)
+				entries.emplace_back(getKey(keys[i]), items[i]);
+
+			// Reversing before and after sorting keeps equal elements in their original order
+			if (reverse)
+				std::reverse(entries.begin(), entries.end());
+			bool success = TimSort(entries, [&](const Entry& a, const Entry& b) { return less(a.first, b.first); });
+			if (!success)
+				return false;
+			if (reverse)
+				std::reverse(entries.begin(), entries.end());
+
+			for (size_t i = 0; i < items.size(); i++)
+				items[i] = entries[i].second;
+			return true;
+		};
+
+		bool ints = true;
+		bool numbers = true;
+		bool strs = true;
+		for (Wg_Obj* key : keys) {
+			if (!IsPlainBuiltin(key)) {
+				ints = numbers = strs = false;
+				break;
+			}
+			ints = ints && Wg_IsInt(key);
+			numbers = numbers && Wg_IsIntOrFloat(key);
+			strs = strs && Wg_IsString(key);
+		}
+
+		if (items.empty()) {
 			return true;
+		} else if (ints) {
+			return sortBy([](Wg_Obj* obj) { return Wg_GetInt(obj); }, [](Wg_int a, Wg_int b) { return std::optional(a < b); });
+		} else if (numbers) {
+			return sortBy([](Wg_Obj* obj) { return Wg_GetFloat(obj); }, [](Wg_float a, Wg_float b) { return std::optional(a < b); });
+		} else if (strs) {
+			return sortBy([](Wg_Obj* obj) { return GetStringView(obj); }, [](std::string_view a, std::string_view b) { return std::optional(a < b); });
+		} else {
+			return sortBy([](Wg_Obj* obj) { return obj; }, [](Wg_Obj* a, Wg_Obj* b) -> std::optional<bool> {
+				Wg_Obj* lt = Wg_BinaryOp(WG_BOP_LT, a, b);
+				if (lt == nullptr)
+					return std::nullopt;
+				return Wg_GetBool(lt);
+				});
+		}
+	}
+
+	struct RangeIterator {
+		Wg_int cur;
+		Wg_int stop;
+		Wg_int step;
+	};
+
+	static Wg_Obj* MinMax(Wg_Context* context, Wg_Obj** argv, int argc, Wg_BinOp op, const char* emptyMessage) {
+		Wg_Obj* kwargs = Wg_GetKwargs(context);
+
+		Wg_Obj* kw[2]{};
+		const char* keys[2] = { "key", "default" };
+		if (!Wg_ParseKwargs(kwargs, keys, 2, kw))
+			return nullptr;
+
+		struct State {
+			std::vector<Wg_Obj*> v;
+			std::vector<Wg_ObjRef> refs;
+		} s;
+		if (argc == 1) {
+			auto f = [](Wg_Obj* x, void* u) {
+				State* s = (State*)u;
+				s->refs.emplace_back(x);
+				s->v.push_back(x);
+				return true;
+			};
+
+			if (!Wg_Iterate(argv[0], &s, f))
+				return nullptr;
+		} else {
+			s.v.assign(argv, argv + argc);
+		}
+
+		if (s.v.empty()) {
+			if (kw[1])
+				return kw[1];
+			Wg_RaiseException(context, WG_EXC_VALUEERROR, emptyMessage);
+			return nullptr;
+		}
+
+		Wg_Obj* key = kw[0];
+		Wg_Obj* best = s.v[0];
+		Wg_Obj* bestKey = key ? Wg_Call(key, &best, 1) : best;
+		if (bestKey == nullptr)
+			return nullptr;
+		Wg_IncRef(bestKey);
+
+		Wg_Obj* result = best;
+		for (size_t i = 1; i < s.v.size(); i++) {
+			Wg_Obj* candidateKey = key ? Wg_Call(key, &s.v[i], 1) : s.v[i];
+			if (candidateKey == nullptr) {
+				result = nullptr;
+				break;
+			}
+			Wg_ObjRef ref(candidateKey);
+
+			Wg_Obj* better = Wg_BinaryOp(op, candidateKey, bestKey);
+			if (better == nullptr) {
+				result = nullptr;
+				break;
+			}
+
+			if (Wg_GetBool(better)) {
+				Wg_IncRef(candidateKey);
+				Wg_DecRef(bestKey);
+				bestKey = candidateKey;
+				result = s.v[i];
+			}
+		}
+		Wg_DecRef(bestKey);
+		return result;
+	}
+
+	// Gets the buffer of a bytes, bytearray or memoryview argument. Raises an exception
+	// and returns null if the argument is not a buffer or is a released memoryview.
+	static BufferObject* GetBufferArg(Wg_Context* context, Wg_Obj** argv, int index) {
+		BufferObject* buf = GetBuffer(argv[index]);
+		if (buf == nullptr) {
+			Wg_RaiseArgumentTypeError(context, index, "bytes, bytearray or memoryview");
+			return nullptr;
+		} else if (buf->storage == nullptr) {
+			Wg_RaiseException(context, WG_EXC_VALUEERROR, "operation forbidden on released memoryview object");
+			return nullptr;
+		}
+		return buf;
+	}
 
-		Wg_Obj** left = data;
-		size_t leftSize = len / 2;
-		Wg_Obj** right = data + leftSize;
-		size_t rightSize = len - leftSize;
-		if (!MergeSort(left, leftSize, key))
+	static bool ByteFromObject(Wg_Context* context, Wg_Obj* value, unsigned char& out) {
+		if (!Wg_IsInt(value)) {
+			Wg_RaiseException(context, WG_EXC_TYPEERROR, "an integer is required");
 			return false;
-		if (!MergeSort(right, rightSize, key))
+		}
+		Wg_int i = Wg_GetInt(value);
+		if (i < 0 || i > 255) {
+			Wg_RaiseException(context, WG_EXC_VALUEERROR, "byte must be in range(0, 256)");
 			return false;
+		}
+		out = (unsigned char)i;
+		return true;
+	}
 
-		std::vector<Wg_Obj*> buf(len);
-		size_t a = 0;
-		size_t b = 0;
-		for (size_t i = 0; i < len; i++) {
-			if (a == leftSize) {
-				// No more elements on the left
-				buf[i] = right[b];
-				b++;
-			} else if (b == rightSize) {
-				// No more elements on the right
-				buf[i] = left[a];
-				a++;
-			} else {
-				Wg_Obj* leftMapped = (key && !Wg_IsNone(key)) ? Wg_Call(key, &left[a], 1) : left[a];
-				if (leftMapped == nullptr)
-					return false;
-				Wg_Obj* rightMapped = (key && !Wg_IsNone(key)) ? Wg_Call(key, &right[b], 1) : right[b];
-				if (rightMapped == nullptr)
-					return false;
+	// Appends the bytes of a buffer, a number of zero bytes, or the values of an iterable of ints
+	static bool CollectBytes(Wg_Context* context, Wg_Obj* source, std::vector<unsigned char>& out) {
+		if (GetBuffer(source)) {
+			BufferObject* buf = GetBufferArg(context, &source, 0);
+			if (buf == nullptr)
+				return false;
+			std::string_view data = buf->View();
+			out.insert(out.end(), data.begin(), data.end());
+			return true;
+		} else if (Wg_IsInt(source)) {
+			Wg_int count = Wg_GetInt(source);
+			if (count < 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "negative count");
+				return false;
+			}
+			out.resize(out.size() + (size_t)count);
+			return true;
+		} else if (Wg_IsString(source)) {
+			Wg_RaiseException(context, WG_EXC_TYPEERROR, "string argument without an encoding");
+			return false;
+		}
 
-				Wg_Obj* gt = Wg_BinaryOp(WG_BOP_LE, rightMapped, leftMapped);
-				if (gt == nullptr)
+		struct State {
+			Wg_Context* context;
+			std::vector<unsigned char>& out;
+		} s = { context, out };
+		return Wg_Iterate(source, &s, [](Wg_Obj* value, void* u) {
+			State* s = (State*)u;
+			unsigned char byte{};
+			if (!ByteFromObject(s->context, value, byte))
+				return false;
+			s->out.push_back(byte);
+			return true;
+			});
+	}
+
+	// Strings are stored as UTF-8, so encoding and decoding only validates the data
+	static bool CheckEncoding(Wg_Context* context, Wg_Obj* encoding, std::string_view data) {
+		std::string name = "utf-8";
+		if (encoding != nullptr) {
+			if (!Wg_IsString(encoding)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "encoding must be a string");
+				return false;
+			}
+			name = Wg_GetString(encoding);
+			for (char& c : name)
+				c = (char)std::tolower(c);
+		}
+
+		if (name == "utf-8" || name == "utf8") {
+			return true;
+		} else if (name == "ascii") {
+			for (char c : data) {
+				if ((unsigned char)c >= 128) {
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, "'ascii' codec can't handle a byte not in range(128)");
 					return false;
+				}
+			}
+			return true;
+		}
+
+		std::string msg = "unknown encoding: " + name;
+		Wg_RaiseException(context, WG_EXC_LOOKUPERROR, msg.c_str());
+		return false;
+	}
+
+	static BufferObject OwnedBuffer(BufferObject::Kind kind, std::vector<unsigned char> data) {
+		BufferObject buf;
+		buf.kind = kind;
+		buf.readonly = kind != BufferObject::Kind::ByteArray;
+		buf.storage = MakeRcPtr<BufferStorage>();
+		buf.storage->owned = std::move(data);
+		buf.length = buf.storage->owned.size();
+		return buf;
+	}
+
+	static Wg_Obj* NewOwnedBuffer(Wg_Context* context, BufferObject::Kind kind, std::string_view data) {
+		return NewBuffer(context, OwnedBuffer(kind, std::vector<unsigned char>(data.begin(), data.end())));
+	}
+
+	// Installs the buffer of a newly constructed bytes, bytearray or memoryview
+	static void InitBuffer(Wg_Obj* obj, BufferObject buffer) {
+		bool memoryView = buffer.kind == BufferObject::Kind::MemoryView;
+		bool readonly = buffer.readonly;
+		if (BufferObject* existing = GetBuffer(obj)) {
+			*existing = std::move(buffer);
+			obj->hasCachedHash = false;
+		} else {
+			auto* data = new BufferObject(std::move(buffer));
+			Wg_SetUserdata(obj, data);
+			Wg_RegisterFinalizer(obj, DeleteUserdata<BufferObject>, data);
+		}
+		if (memoryView)
+			Wg_SetAttribute(obj, "readonly", Wg_NewBool(obj->context, readonly));
+	}
 
-				if (Wg_GetBool(gt)) {
-					// right < left
-					buf[i] = right[b];
-					b++;
+	static std::string BytesRepr(std::string_view data) {
+		char quote = data.find('\'') != std::string_view::npos && data.find('"') == std::string_view::npos ? '"' : '\'';
+		std::string s = "b";
+		s += quote;
+		for (char c : data) {
+			unsigned char u = (unsigned char)c;
+			switch (c) {
+			case '\t': s += "\\t"; break;
+			case '\n': s += "\\n"; break;
+			case '\r': s += "\\r"; break;
+			case '\\': s += "\\\\"; break;
+			default:
+				if (c == quote) {
+					s += '\\';
+					s += c;
+				} else if (u < 32 || u >= 127) {
+					const char* digits = "0123456789abcdef";
+					s += "\\x";
+					s += digits[u >> 4];
+					s += digits[u & 15];
 				} else {
-					// right >= left
-					buf[i] = left[a];
-					a++;
+					s += c;
 				}
 			}
 		}
-	
-		for (size_t i = 0; i < len; i++)
-			data[i] = buf[i];
-		return true;
+		s += quote;
+		return s;
+	}
+
+	// The default size of the read buffer of a file
+	constexpr size_t FILE_BUFFER_SIZE = 64 * 1024;
+
+	// The userdata of a file returned by open(). Reads go through a large buffer
+	// so that lines are found with memchr rather than read a character at a time.
+	// In memory-mapped mode the whole file is a read-only storage instead, which
+	// is shared with the bytes objects read from a binary file.
+	struct FileObject {
+		FileObject() = default;
+		FileObject(const FileObject&) = delete;
+		FileObject& operator=(const FileObject&) = delete;
+		~FileObject() {
+			if (file)
+				std::fclose(file);
+		}
+		bool IsOpen() const { return file || mapping; }
+
+		std::FILE* file = nullptr;
+		bool readable = false;
+		bool writable = false;
+		bool binary = false;
+		// Set after a write so that the stream is flushed before the next read
+		bool writing = false;
+		// The unread data is buffer[bufferPos, bufferEnd)
+		std::vector<char> buffer;
+		size_t bufferPos = 0;
+		size_t bufferEnd = 0;
+		// Only set in memory-mapped mode, in which case file is null
+		RcPtr<BufferStorage> mapping;
+		size_t mapPos = 0;
+	};
+
+	static void UnmapFile(void* userdata) {
+#ifndef _WIN32
+		// The userdata is the storage that is being destroyed
+		auto* storage = (BufferStorage*)userdata;
+		munmap(storage->host, storage->hostSize);
+#else
+		(void)userdata;
+#endif
+	}
+
+	// Without mmap the file is read into memory instead
+	static RcPtr<BufferStorage> MapFile(const char* filename) {
+		auto storage = MakeRcPtr<BufferStorage>();
+#ifndef _WIN32
+		int fd = ::open(filename, O_RDONLY);
+		if (fd < 0)
+			return nullptr;
+		struct stat st{};
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+			::close(fd);
+			return nullptr;
+		}
+		if (st.st_size > 0) {
+			void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED) {
+				::close(fd);
+				return nullptr;
+			}
+			posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+			storage->borrowed = true;
+			storage->host = (unsigned char*)data;
+			storage->hostSize = (size_t)st.st_size;
+			storage->finalizer = UnmapFile;
+			storage->userdata = storage.get();
+		}
+		::close(fd);
+#else
+		std::FILE* file = std::fopen(filename, "rb");
+		if (file == nullptr)
+			return nullptr;
+		char chunk[FILE_BUFFER_SIZE];
+		size_t read;
+		while ((read = std::fread(chunk, 1, sizeof(chunk), file)) != 0)
+			storage->owned.insert(storage->owned.end(), chunk, chunk + read);
+		std::fclose(file);
+#endif
+		return storage;
+	}
+
+	static FileObject* GetFileArg(Wg_Context* context, Wg_Obj** argv) {
+		FileObject* f{};
+		if (!TryGetUserdata(argv[0], "__File", &f)) {
+			Wg_RaiseArgumentTypeError(context, 0, "__File");
+			return nullptr;
+		} else if (!f->IsOpen()) {
+			Wg_RaiseException(context, WG_EXC_VALUEERROR, "I/O operation on closed file");
+			return nullptr;
+		}
+		return f;
+	}
+
+	static FileObject* GetReadableFileArg(Wg_Context* context, Wg_Obj** argv) {
+		FileObject* f = GetFileArg(context, argv);
+		if (f && !f->readable) {
+			Wg_RaiseException(context, WG_EXC_OSERROR, "File not open for reading");
+			return nullptr;
+		}
+		return f;
 	}
-	
+
+	// Puts the stream position back to where the script has read up to
+	static void DiscardReadBuffer(FileObject& f) {
+		// A seek is also required between reading and writing the same stream
+		std::fseek(f.file, -(long)(f.bufferEnd - f.bufferPos), SEEK_CUR);
+		f.bufferPos = 0;
+		f.bufferEnd = 0;
+	}
+
+	static bool FillReadBuffer(FileObject& f) {
+		if (f.writing) {
+			std::fflush(f.file);
+			f.writing = false;
+		}
+		f.bufferPos = 0;
+		f.bufferEnd = std::fread(f.buffer.data(), 1, f.buffer.size(), f.file);
+		return f.bufferEnd != 0;
+	}
+
+	// Reads up to and including the next newline, or at most limit bytes.
+	// The result refers to the read buffer or the mapping unless the line
+	// spans more than one fill of the buffer, in which case it refers to scratch.
+	static std::string_view ReadFileLine(FileObject& f, size_t limit, std::string& scratch) {
+		if (f.mapping) {
+			const char* data = (const char*)f.mapping->Data();
+			size_t start = std::min(f.mapPos, f.mapping->Size());
+			size_t max = std::min(limit, f.mapping->Size() - start);
+			const char* nl = (const char*)std::memchr(data + start, '\n', max);
+			size_t len = nl ? (size_t)(nl - (data + start)) + 1 : max;
+			f.mapPos = start + len;
+			return { data + start, len };
+		}
+
+		scratch.clear();
+		while (scratch.size() < limit) {
+			if (f.bufferPos == f.bufferEnd && !FillReadBuffer(f))
+				break;
+			const char* start = f.buffer.data() + f.bufferPos;
+			size_t max = std::min(limit - scratch.size(), f.bufferEnd - f.bufferPos);
+			const char* nl = (const char*)std::memchr(start, '\n', max);
+			size_t len = nl ? (size_t)(nl - start) + 1 : max;
+			f.bufferPos += len;
+			if (nl && scratch.empty())
+				return { start, len };
+			scratch.append(start, len);
+			if (nl)
+				break;
+		}
+		return scratch;
+	}
+
+	// Reads at most size bytes
+	static std::string_view ReadFileData(FileObject& f, size_t size, std::string& scratch) {
+		if (f.mapping) {
+			size_t start = std::min(f.mapPos, f.mapping->Size());
+			size_t len = std::min(size, f.mapping->Size() - start);
+			f.mapPos = start + len;
+			return { (const char*)f.mapping->Data() + start, len };
+		}
+
+		scratch.clear();
+		while (scratch.size() < size) {
+			if (f.bufferPos == f.bufferEnd && !FillReadBuffer(f))
+				break;
+			size_t len = std::min(size - scratch.size(), f.bufferEnd - f.bufferPos);
+			scratch.append(f.buffer.data() + f.bufferPos, len);
+			f.bufferPos += len;
+		}
+		return scratch;
+	}
+
+	// Creates a str, or a bytes object for a binary file. A view of the mapping
+	// of a memory-mapped file becomes a bytes object without being copied.
+	static Wg_Obj* NewFileData(Wg_Context* context, const FileObject& f, std::string_view data) {
+		if (!f.binary)
+			return Wg_NewStringBuffer(context, data.data(), (int)data.size());
+
+		const char* mapped = f.mapping ? (const char*)f.mapping->Data() : nullptr;
+		if (mapped && data.data() >= mapped && data.data() < mapped + f.mapping->Size()) {
+			BufferObject view;
+			view.kind = BufferObject::Kind::Bytes;
+			view.storage = f.mapping;
+			view.offset = (size_t)(data.data() - mapped);
+			view.length = data.size();
+			return NewBuffer(context, std::move(view));
+		}
+		return NewOwnedBuffer(context, BufferObject::Kind::Bytes, data);
+	}
+
+	static Wg_int TellFile(const FileObject& f) {
+		if (f.mapping)
+			return (Wg_int)f.mapPos;
+		return (Wg_int)std::ftell(f.file) - (Wg_int)(f.bufferEnd - f.bufferPos);
+	}
+
 	namespace ctors {
 
 		static Wg_Obj* object(Wg_Context* context, Wg_Obj**, int argc) { // Excludes self
@@ -611,7 +985,7 @@ class ValueError(Exception):
 				return nullptr;
 			
 			obj->attributes = context->builtins.object->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			obj->type = "__object";
+			obj->type = ObjType::Object;
 			return obj;
 		}
 
@@ -652,11 +1026,9 @@ class ValueError(Exception):
 			}
 
 			argv[0]->attributes = context->builtins._int->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			argv[0]->type = "__int";
+			argv[0]->type = ObjType::Int;
 			
-			auto data = new Wg_int(v);
-			Wg_SetUserdata(argv[0], data);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (Wg_int*)ud; }, data);
+			argv[0]->EmplaceInline<Wg_int>(v);
 
 			return Wg_None(context);
 		}
@@ -677,11 +1049,9 @@ class ValueError(Exception):
 			}
 
 			argv[0]->attributes = context->builtins._float->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			argv[0]->type = "__float";
+			argv[0]->type = ObjType::Float;
 
-			auto data = new Wg_float(v);
-			Wg_SetUserdata(argv[0], data);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (Wg_float*)ud; }, data);
+			argv[0]->EmplaceInline<Wg_float>(v);
 
 			return Wg_None(context);
 		}
@@ -701,11 +1071,9 @@ class ValueError(Exception):
 				v = Wg_GetString(res);
 			}
 			argv[0]->attributes = context->builtins.str->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			argv[0]->type = "__str";
+			argv[0]->type = ObjType::Str;
 
-			auto data = new std::string(v);
-			Wg_SetUserdata(argv[0], data);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (std::string*)ud; }, data);
+			argv[0]->EmplaceInline<std::string>(v);
 
 			return Wg_None(context);
 		}
@@ -734,11 +1102,9 @@ class ValueError(Exception):
 				return nullptr;
 			
 			obj->attributes = context->builtins.tuple->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			obj->type = "__tuple";
+			obj->type = ObjType::Tuple;
 
-			auto data = new std::vector<Wg_Obj*>(std::move(s.v));
-			Wg_SetUserdata(obj, data);
-			Wg_RegisterFinalizer(obj, [](void* ud) { delete (std::vector<Wg_Obj*>*)ud; }, data);
+			obj->EmplaceInline<std::vector<Wg_Obj*>>(std::move(s.v));
 
 			return obj;
 		}
@@ -750,7 +1116,13 @@ class ValueError(Exception):
 				std::vector<Wg_Obj*> v;
 				std::vector<Wg_ObjRef> refs;
 			} s;
-			if (argc == 2) {
+			const auto& b = context->builtins;
+			bool sequence = argc == 2 && ((argv[1]->type == ObjType::List && IsUnmodifiedInstance(argv[1], b.list))
+				|| (argv[1]->type == ObjType::Tuple && IsUnmodifiedInstance(argv[1], b.tuple)));
+			if (sequence) {
+				// The items are kept alive by the source, so they are copied directly
+				s.v = argv[1]->Get<std::vector<Wg_Obj*>>();
+			} else if (argc == 2) {
 				auto f = [](Wg_Obj* x, void* u) {
 					State* s = (State*)u;
 					s->refs.emplace_back(x);
@@ -763,11 +1135,9 @@ class ValueError(Exception):
 			}
 
 			argv[0]->attributes = context->builtins.list->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			argv[0]->type = "__list";
+			argv[0]->type = ObjType::List;
 
-			auto data = new std::vector<Wg_Obj*>(std::move(s.v));
-			Wg_SetUserdata(argv[0], data);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (std::vector<Wg_Obj*>*)ud; }, data);
+			argv[0]->EmplaceInline<std::vector<Wg_Obj*>>(std::move(s.v));
 
 			return Wg_None(context);
 		}
@@ -776,11 +1146,11 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
 			
 			argv[0]->attributes = context->builtins.dict->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			argv[0]->type = "__map";
+			argv[0]->type = ObjType::Map;
 
 			auto data = new WDict();
 			Wg_SetUserdata(argv[0], data);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (WDict*)ud; }, data);
+			Wg_RegisterFinalizer(argv[0], DeleteUserdata<WDict>, data);
 
 			if (argc == 2) {
 				Wg_Obj* iterable = argv[1];
@@ -795,12 +1165,13 @@ class ValueError(Exception):
 
 					Wg_ObjRef ref(kv[1]);
 					try {
-						((WDict*)ud)->operator[](kv[0]) = kv[1];
+						((Wg_Obj*)ud)->Get<WDict>()[kv[0]] = kv[1];
+						WriteBarrier((Wg_Obj*)ud);
 					} catch (HashException&) {}
 					return true;
 				};
 
-				if (!Wg_Iterate(iterable, data, f))
+				if (!Wg_Iterate(iterable, argv[0], f))
 					return nullptr;
 			}
 			
@@ -808,6 +1179,7 @@ class ValueError(Exception):
 				for (const auto& [k, v] : kw->Get<WDict>()) {
 					try {
 						data->operator[](k) = v;
+						WriteBarrier(argv[0]);
 					} catch (HashException&) {
 						return nullptr;
 					}
@@ -821,22 +1193,23 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
 			
 			argv[0]->attributes = context->builtins.set->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			argv[0]->type = "__set";
+			argv[0]->type = ObjType::Set;
 
 			auto data = new WSet();
 			Wg_SetUserdata(argv[0], data);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (WSet*)ud; }, data);
+			Wg_RegisterFinalizer(argv[0], DeleteUserdata<WSet>, data);
 
 			if (argc == 2) {
 				Wg_Obj* iterable = argv[1];
 				auto f = [](Wg_Obj* obj, void* ud) {
 					try {
-						((WSet*)ud)->insert(obj);
+						((Wg_Obj*)ud)->Get<WSet>().insert(obj);
+						WriteBarrier((Wg_Obj*)ud);
 					} catch (HashException&) {}
 					return true;
 				};
 
-				if (!Wg_Iterate(iterable, data, f))
+				if (!Wg_Iterate(iterable, argv[0], f))
 					return nullptr;
 			}
 
@@ -861,10 +1234,10 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_TYPE_MAP(1);
 			auto* it = new WDict::iterator(argv[1]->Get<WDict>().begin());
 			Wg_SetUserdata(argv[0], it);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (WDict::iterator*)ud; }, it);
+			Wg_RegisterFinalizer(argv[0], DeleteUserdata<WDict::iterator>, it);
 
 			Wg_IncRef(argv[1]);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { Wg_DecRef((Wg_Obj*)ud); }, argv[1]);
+			Wg_RegisterFinalizer(argv[0], DecRefUserdata, argv[1]);
 			return Wg_None(context);
 		}
 
@@ -873,84 +1246,292 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_TYPE_SET(1);
 			auto* it = new WSet::iterator(argv[1]->Get<WSet>().begin());
 			Wg_SetUserdata(argv[0], it);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (WSet::iterator*)ud; }, it);
+			Wg_RegisterFinalizer(argv[0], DeleteUserdata<WSet::iterator>, it);
 
 			Wg_IncRef(argv[1]);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { Wg_DecRef((Wg_Obj*)ud); }, argv[1]);
+			Wg_RegisterFinalizer(argv[0], DecRefUserdata, argv[1]);
 			return Wg_None(context);
 		}
 
-		static Wg_Obj* File(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT_BETWEEN(2, 3);
-			WG_EXPECT_ARG_TYPE_STRING(1);
+		static Wg_Obj* Range(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(2, 4);
 
-			const char* filename = Wg_GetString(argv[1]);
+			Wg_Obj* start = argv[1];
+			Wg_Obj* stop = argc >= 3 ? argv[2] : nullptr;
+			Wg_Obj* step = argc == 4 ? argv[3] : nullptr;
+			if (stop && Wg_IsNone(stop))
+				stop = nullptr;
+			if (step && Wg_IsNone(step))
+				step = nullptr;
 
-			std::ios::openmode mode{};
-			if (argc == 3) {
-				WG_EXPECT_ARG_TYPE_STRING(2);
-				std::string m = Wg_GetString(argv[2]);
-	
-				size_t b;
-				if ((b = m.find('b')) != std::string::npos) {
-					mode |= std::ios::binary;
-					m.erase(b);
-				}
-				
-				if (m == "r") {
-					mode = std::ios::in;
-				} else if (m == "w") {
-					mode = std::ios::out;
-				} else if (m == "a") {
-					mode = std::ios::app;
-				} else if (m == "r+") {
-					mode = std::ios::in | std::ios::out;
-				} else if (m == "w+") {
-					mode = std::ios::in | std::ios::out | std::ios::trunc;
-				} else if (m == "a+") {
-					mode = std::ios::in | std::ios::app;
-				} else {
-					Wg_RaiseException(context, WG_EXC_VALUEERROR, "Invalid file mode");
-					return nullptr;
-				}
-			} else {
-				mode = std::ios::in;
+			if (step && Wg_IsInt(step) && Wg_GetInt(step) == 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "step cannot be 0");
+				return nullptr;
 			}
 
-			auto* f = new std::fstream(filename, mode);
-			if (!f->is_open()) {
-				Wg_RaiseException(context, WG_EXC_OSERROR, "Failed to open file");
+			if (stop == nullptr) {
+				if (!Wg_IsInt(start)) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "stop must be an integer");
+					return nullptr;
+				}
+				stop = start;
+				start = nullptr;
+			} else if (!Wg_IsInt(start)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "start must be an integer");
+				return nullptr;
+			} else if (!Wg_IsInt(stop)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "stop must be an integer");
+				return nullptr;
+			} else if (step && !Wg_IsInt(step)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "step must be an integer");
 				return nullptr;
 			}
 
-			Wg_SetUserdata(argv[0], f);
-			Wg_RegisterFinalizer(argv[0], [](void* ud) { delete (std::fstream*)ud; }, f);
+			if (start == nullptr && (start = Wg_NewInt(context, 0)) == nullptr)
+				return nullptr;
+			if (step == nullptr && (step = Wg_NewInt(context, 1)) == nullptr)
+				return nullptr;
 
-			bool readable = mode & std::ios::in;
-			bool writable = mode & std::ios::out;
-			
-			Wg_SetAttribute(argv[0], "_readable", Wg_NewBool(context, readable));
-			Wg_SetAttribute(argv[0], "_writable", Wg_NewBool(context, writable));
-			
+			Wg_SetAttribute(argv[0], "start", start);
+			Wg_SetAttribute(argv[0], "stop", stop);
+			Wg_SetAttribute(argv[0], "step", step);
 			return Wg_None(context);
 		}
-		
-	} // namespace ctors
 
-	namespace methods {
-		
-		static Wg_Obj* object_str(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(1);
-			if (Wg_IsClass(argv[0])) {
-				std::string s = "<class '" + argv[0]->Get<Wg_Obj::Class>().name + "'>";
-				return Wg_NewString(context, s.c_str());
-			} else {
-				std::string s = "<" + WObjTypeToString(argv[0]) + " object at 0x" + PtrToString(argv[0]) + ">";
-				return Wg_NewString(context, s.c_str());
-			}
+		static Wg_Obj* RangeIter(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(4);
+			WG_EXPECT_ARG_TYPE_INT(1);
+			WG_EXPECT_ARG_TYPE_INT(2);
+			WG_EXPECT_ARG_TYPE_INT(3);
+
+			auto* it = new RangeIterator{ Wg_GetInt(argv[1]), Wg_GetInt(argv[2]), Wg_GetInt(argv[3]) };
+			Wg_SetUserdata(argv[0], it);
+			Wg_RegisterFinalizer(argv[0], DeleteUserdata<RangeIterator>, it);
+			return Wg_None(context);
 		}
 
-		static Wg_Obj* object_nonzero(Wg_Context* context, Wg_Obj**, int argc) {
+		static Wg_Obj* Enumerate(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(2, 3);
+
+			Wg_int start = 0;
+			if (argc == 3) {
+				WG_EXPECT_ARG_TYPE_INT(2);
+				start = Wg_GetInt(argv[2]);
+			}
+
+			Wg_Obj* iter = Wg_CallMethod(argv[1], "__iter__", nullptr, 0);
+			if (iter == nullptr)
+				return nullptr;
+			Wg_SetAttribute(argv[0], "_iter", iter);
+
+			auto* i = new Wg_int(start);
+			Wg_SetUserdata(argv[0], i);
+			Wg_RegisterFinalizer(argv[0], DeleteUserdata<Wg_int>, i);
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* MapOrFilter(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(3);
+
+			Wg_Obj* iter = Wg_CallMethod(argv[2], "__iter__", nullptr, 0);
+			if (iter == nullptr)
+				return nullptr;
+			Wg_SetAttribute(argv[0], "_f", argv[1]);
+			Wg_SetAttribute(argv[0], "_iter", iter);
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* Zip(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_AT_LEAST(1);
+
+			std::vector<Wg_Obj*> iters;
+			std::vector<Wg_ObjRef> refs;
+			for (int i = 1; i < argc; i++) {
+				Wg_Obj* iter = Wg_CallMethod(argv[i], "__iter__", nullptr, 0);
+				if (iter == nullptr)
+					return nullptr;
+				refs.emplace_back(iter);
+				iters.push_back(iter);
+			}
+
+			Wg_Obj* tuple = Wg_NewTuple(context, iters.data(), (int)iters.size());
+			if (tuple == nullptr)
+				return nullptr;
+			Wg_SetAttribute(argv[0], "_iters", tuple);
+			return Wg_None(context);
+		}
+
+		// open(file, mode='r', buffering=-1, mmap=False)
+		// mmap is an extension that maps a file opened for reading into memory.
+		static Wg_Obj* File(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(2, 4);
+			WG_EXPECT_ARG_TYPE_STRING(1);
+
+			Wg_Obj* kw[3]{};
+			const char* keys[3] = { "mode", "buffering", "mmap" };
+			if (!Wg_ParseKwargs(Wg_GetKwargs(context), keys, 3, kw))
+				return nullptr;
+			for (int i = 2; i < argc; i++)
+				kw[i - 2] = argv[i];
+
+			const char* filename = Wg_GetString(argv[1]);
+
+			std::string m = "r";
+			if (kw[0]) {
+				if (!Wg_IsString(kw[0])) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "mode must be a string");
+					return nullptr;
+				}
+				m = Wg_GetString(kw[0]);
+			}
+
+			// The stream is always binary so that buffered reads can seek back exactly
+			bool binary = false;
+			for (char flag : { 'b', 't' }) {
+				size_t i = m.find(flag);
+				if (i != std::string::npos) {
+					binary |= flag == 'b';
+					m.erase(i, 1);
+				}
+			}
+
+			const char* cmode{};
+			bool readable = false;
+			bool writable = false;
+			if (m == "r") {
+				cmode = "rb";
+				readable = true;
+			} else if (m == "w") {
+				cmode = "wb";
+				writable = true;
+			} else if (m == "a") {
+				cmode = "ab";
+				writable = true;
+			} else if (m == "r+") {
+				cmode = "r+b";
+				readable = writable = true;
+			} else if (m == "w+") {
+				cmode = "w+b";
+				readable = writable = true;
+			} else if (m == "a+") {
+				cmode = "a+b";
+				readable = writable = true;
+			} else {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "Invalid file mode");
+				return nullptr;
+			}
+
+			size_t bufferSize = FILE_BUFFER_SIZE;
+			if (kw[1]) {
+				if (!Wg_IsInt(kw[1])) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "buffering must be an integer");
+					return nullptr;
+				}
+				if (Wg_GetInt(kw[1]) > 1)
+					bufferSize = (size_t)Wg_GetInt(kw[1]);
+			}
+
+			bool mapped = false;
+			if (kw[2]) {
+				Wg_Obj* truthy = Wg_UnaryOp(WG_UOP_BOOL, kw[2]);
+				if (truthy == nullptr)
+					return nullptr;
+				mapped = Wg_GetBool(truthy);
+			}
+			if (mapped && writable) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "mmap is only supported when reading");
+				return nullptr;
+			}
+
+			auto f = std::make_unique<FileObject>();
+			f->readable = readable;
+			f->writable = writable;
+			f->binary = binary;
+			if (mapped) {
+				f->mapping = MapFile(filename);
+			} else if ((f->file = std::fopen(filename, cmode)) != nullptr) {
+				std::setvbuf(f->file, nullptr, _IOFBF, bufferSize);
+				if (readable)
+					f->buffer.resize(bufferSize);
+			}
+
+			if (!f->IsOpen()) {
+				Wg_RaiseException(context, WG_EXC_OSERROR, "Failed to open file");
+				return nullptr;
+			}
+
+			FileObject* data = f.release();
+			Wg_SetUserdata(argv[0], data);
+			Wg_RegisterFinalizer(argv[0], DeleteUserdata<FileObject>, data);
+			return Wg_None(context);
+		}
+
+		template <BufferObject::Kind kind>
+		static Wg_Obj* buffer(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 3);
+
+			if (argc == 1) {
+				InitBuffer(argv[0], OwnedBuffer(kind, {}));
+				return Wg_None(context);
+			}
+
+			if (Wg_IsString(argv[1])) {
+				if (argc != 3) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "string argument without an encoding");
+					return nullptr;
+				}
+				std::string_view s = GetStringView(argv[1]);
+				if (!CheckEncoding(context, argv[2], s))
+					return nullptr;
+				InitBuffer(argv[0], OwnedBuffer(kind, std::vector<unsigned char>(s.begin(), s.end())));
+				return Wg_None(context);
+			} else if (argc == 3) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "encoding without a string argument");
+				return nullptr;
+			}
+
+			// Bytes are immutable so they can share their storage
+			BufferObject* source = GetBuffer(argv[1]);
+			if (kind == BufferObject::Kind::Bytes && source && source->kind == BufferObject::Kind::Bytes) {
+				InitBuffer(argv[0], *source);
+				return Wg_None(context);
+			}
+
+			std::vector<unsigned char> data;
+			if (!CollectBytes(context, argv[1], data))
+				return nullptr;
+			InitBuffer(argv[0], OwnedBuffer(kind, std::move(data)));
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* memoryview(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* source = GetBufferArg(context, argv, 1);
+			if (source == nullptr)
+				return nullptr;
+
+			BufferObject view = *source;
+			view.kind = BufferObject::Kind::MemoryView;
+			InitBuffer(argv[0], std::move(view));
+			return Wg_None(context);
+		}
+
+	} // namespace ctors
+
+	namespace methods {
+		
+		static Wg_Obj* object_str(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			if (Wg_IsClass(argv[0])) {
+				std::string s = "<class '" + argv[0]->Get<Wg_Obj::Class>().name + "'>";
+				return Wg_NewString(context, s.c_str());
+			} else {
+				std::string s = "<" + WObjTypeToString(argv[0]) + " object at 0x" + PtrToString(argv[0]) + ">";
+				return Wg_NewString(context, s.c_str());
+			}
+		}
+
+		static Wg_Obj* object_nonzero(Wg_Context* context, Wg_Obj**, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
 			return Wg_NewBool(context, true);
 		}
@@ -1178,7 +1759,7 @@ class ValueError(Exception):
 		static Wg_Obj* int_neg(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
 			WG_EXPECT_ARG_TYPE_INT(0);
-			return Wg_NewInt(context, -Wg_GetInt(argv[0]));
+			return Wg_NewInt(context, WrappingSub(0, Wg_GetInt(argv[0])));
 		}
 
 		static Wg_Obj* int_add(Wg_Context* context, Wg_Obj** argv, int argc) {
@@ -1186,7 +1767,7 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_TYPE_INT(0);
 			WG_EXPECT_ARG_TYPE_INT_OR_FLOAT(1);
 			if (Wg_IsInt(argv[1])) {
-				return Wg_NewInt(context, Wg_GetInt(argv[0]) + Wg_GetInt(argv[1]));
+				return Wg_NewInt(context, WrappingAdd(Wg_GetInt(argv[0]), Wg_GetInt(argv[1])));
 			} else {
 				return Wg_NewFloat(context, Wg_GetFloat(argv[0]) + Wg_GetFloat(argv[1]));
 			}
@@ -1197,7 +1778,7 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_TYPE_INT(0);
 			WG_EXPECT_ARG_TYPE_INT_OR_FLOAT(1);
 			if (Wg_IsInt(argv[1])) {
-				return Wg_NewInt(context, Wg_GetInt(argv[0]) - Wg_GetInt(argv[1]));
+				return Wg_NewInt(context, WrappingSub(Wg_GetInt(argv[0]), Wg_GetInt(argv[1])));
 			} else {
 				return Wg_NewFloat(context, Wg_GetFloat(argv[0]) - Wg_GetFloat(argv[1]));
 			}
@@ -1214,7 +1795,7 @@ class ValueError(Exception):
 					s += Wg_GetString(argv[1]);
 				return Wg_NewString(context, s.c_str());
 			} else if (Wg_IsInt(argv[1])) {
-				return Wg_NewInt(context, Wg_GetInt(argv[0]) * Wg_GetInt(argv[1]));
+				return Wg_NewInt(context, WrappingMul(Wg_GetInt(argv[0]), Wg_GetInt(argv[1])));
 			} else if (Wg_IsIntOrFloat(argv[1])) {
 				return Wg_NewFloat(context, Wg_GetFloat(argv[0]) * Wg_GetFloat(argv[1]));
 			} else {
@@ -1246,7 +1827,7 @@ class ValueError(Exception):
 			}
 
 			if (Wg_IsInt(argv[1])) {
-				return Wg_NewInt(context, (Wg_int)std::floor(Wg_GetFloat(argv[0]) / Wg_GetFloat(argv[1])));
+				return Wg_NewInt(context, FloorDiv(Wg_GetInt(argv[0]), Wg_GetInt(argv[1])));
 			} else {
 				return Wg_NewFloat(context, std::floor(Wg_GetFloat(argv[0]) / Wg_GetFloat(argv[1])));
 			}
@@ -1263,11 +1844,7 @@ class ValueError(Exception):
 			}
 
 			if (Wg_IsInt(argv[1])) {
-				Wg_int mod = Wg_GetInt(argv[1]);
-				Wg_int m = Wg_GetInt(argv[0]) % mod;
-				if (m < 0)
-					m += mod;
-				return Wg_NewInt(context, m);
+				return Wg_NewInt(context, FloorMod(Wg_GetInt(argv[0]), Wg_GetInt(argv[1])));
 			} else {
 				return Wg_NewFloat(context, std::fmod(Wg_GetFloat(argv[0]), Wg_GetFloat(argv[1])));
 			}
@@ -1674,36 +2251,37 @@ class ValueError(Exception):
 		static Wg_Obj* str_len(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
 			WG_EXPECT_ARG_TYPE_STRING(0);
-			return Wg_NewInt(context, (Wg_int)argv[0]->Get<std::string>().size());
+			return Wg_NewInt(context, (Wg_int)GetStringView(argv[0]).size());
 		}
 
 		static Wg_Obj* str_eq(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(2);
 			WG_EXPECT_ARG_TYPE_STRING(0);
-			return Wg_NewBool(context, Wg_IsString(argv[1]) && std::strcmp(Wg_GetString(argv[0]), Wg_GetString(argv[1])) == 0);
+			return Wg_NewBool(context, Wg_IsString(argv[1]) && GetStringView(argv[0]) == GetStringView(argv[1]));
 		}
 
 		static Wg_Obj* str_lt(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(2);
 			WG_EXPECT_ARG_TYPE_STRING(0);
 			WG_EXPECT_ARG_TYPE_STRING(1);
-			return Wg_NewBool(context, std::strcmp(Wg_GetString(argv[0]), Wg_GetString(argv[1])) < 0);
+			return Wg_NewBool(context, GetStringView(argv[0]) < GetStringView(argv[1]));
 		}
 
 		static Wg_Obj* str_hash(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
 			WG_EXPECT_ARG_TYPE_STRING(0);
-			Wg_int hash = (Wg_int)std::hash<std::string_view>()(Wg_GetString(argv[0]));
-			return Wg_NewInt(context, hash);
+			if (!argv[0]->hasCachedHash) {
+				argv[0]->cachedHash = (size_t)(Wg_int)std::hash<std::string_view>()(GetStringView(argv[0]));
+				argv[0]->hasCachedHash = true;
+			}
+			return Wg_NewInt(context, (Wg_int)argv[0]->cachedHash);
 		}
 
 		static Wg_Obj* str_add(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(2);
 			WG_EXPECT_ARG_TYPE_STRING(0);
 			WG_EXPECT_ARG_TYPE_STRING(1);
-			std::string s = Wg_GetString(argv[0]);
-			s += Wg_GetString(argv[1]);
-			return Wg_NewString(context, s.c_str());
+			return ConcatStrings(context, argv[0], GetStringView(argv[1]));
 		}
 
 		static Wg_Obj* str_mul(Wg_Context* context, Wg_Obj** argv, int argc) {
@@ -1712,6 +2290,8 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_TYPE_INT(1);
 			Wg_int multiplier = Wg_GetInt(argv[1]);
 			std::string_view arg = Wg_GetString(argv[0]);
+			if (multiplier > 0 && !CheckBytes(context, arg.size() * (size_t)multiplier))
+				return nullptr;
 			std::string s;
 			s.reserve(arg.size() * (size_t)multiplier);
 			for (Wg_int i = 0; i < multiplier; i++)
@@ -2086,7 +2666,24 @@ class ValueError(Exception):
 			struct State {
 				std::string_view sep;
 				std::string s;
-			} state = { Wg_GetString(argv[0]), "" };
+				bool first = true;
+			} state = { GetStringView(argv[0]) };
+
+			// The size of the result is known up front for lists and tuples
+			if (Wg_IsList(argv[1]) || Wg_IsTuple(argv[1])) {
+				const auto& items = argv[1]->Get<std::vector<Wg_Obj*>>();
+				size_t size = 0;
+				for (const Wg_Obj* item : items) {
+					if (!Wg_IsString(item)) {
+						Wg_RaiseException(context, WG_EXC_TYPEERROR, "sequence item must be a string");
+						return nullptr;
+					}
+					size += GetStringView(item).size();
+				}
+				if (!items.empty())
+					size += state.sep.size() * (items.size() - 1);
+				state.s.reserve(size);
+			}
 
 			bool success = Wg_Iterate(argv[1], &state, [](Wg_Obj* obj, void* ud) {
 				State& state = *(State*)ud;
@@ -2097,18 +2694,17 @@ class ValueError(Exception):
 					return false;
 				}
 				
-				state.s += Wg_GetString(obj);
-				state.s += state.sep;
+				if (!state.first)
+					state.s += state.sep;
+				state.s += GetStringView(obj);
+				state.first = false;
 				return true;
 			});
 
 			if (!success)
 				return nullptr;
 
-			if (!state.s.empty())
-				state.s.erase(state.s.end() - state.sep.size(), state.s.end());
-
-			return Wg_NewString(context, state.s.c_str());
+			return Wg_NewStringBuffer(context, state.s.data(), (int)state.s.size());
 		}
 
 		static Wg_Obj* str_replace(Wg_Context* context, Wg_Obj** argv, int argc) {
@@ -2268,6 +2864,7 @@ class ValueError(Exception):
 				if (str == nullptr)
 					return nullptr;
 				li->Get<std::vector<Wg_Obj*>>().push_back(str);
+				WriteBarrier(li);
 			}
 			return li;
 		}
@@ -2288,6 +2885,7 @@ class ValueError(Exception):
 				if (str == nullptr)
 					return nullptr;
 				li->Get<std::vector<Wg_Obj*>>().push_back(str);
+				WriteBarrier(li);
 			}
 			return li;
 		}
@@ -2315,7 +2913,8 @@ class ValueError(Exception):
 						context->reprStack.pop_back();
 						return nullptr;
 					}
-					s += v->Get<std::string>() + ", ";
+					s += GetStringView(v);
+					s += ", ";
 				}
 				context->reprStack.pop_back();
 				if (!buf.empty()) {
@@ -2347,6 +2946,11 @@ class ValueError(Exception):
 
 			Wg_int mul = Wg_GetInt(argv[1]);
 			const auto& thisBuf = argv[0]->Get<std::vector<Wg_Obj*>>();
+			if (mul > 0) {
+				Wg_ObjRef ref(col);
+				if (!ChargeBytes(context, thisBuf.size() * (size_t)mul * sizeof(Wg_Obj*)))
+					return nullptr;
+			}
 			auto& buf = col->Get<std::vector<Wg_Obj*>>();
 			buf.reserve(mul * thisBuf.size());
 			for (Wg_int i = 0; i < mul; i++) {
@@ -2391,7 +2995,7 @@ class ValueError(Exception):
 				if (Wg_GetBool(lt))
 					return lt;
 
-				Wg_Obj* gt = Wg_BinaryOp(WG_BOP_LT, buf1[i], buf2[i]);
+				Wg_Obj* gt = Wg_BinaryOp(WG_BOP_LT, buf2[i], buf1[i]);
 				if (gt == nullptr)
 					return nullptr;
 
@@ -2433,6 +3037,20 @@ class ValueError(Exception):
 			return Wg_NewBool(context, true);
 		}
 
+		static Wg_Obj* tuple_hash(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			WG_EXPECT_ARG_TYPE_TUPLE(0);
+
+			size_t hash = 0;
+			for (Wg_Obj* v : argv[0]->Get<std::vector<Wg_Obj*>>()) {
+				Wg_Obj* h = Wg_UnaryOp(WG_UOP_HASH, v);
+				if (h == nullptr)
+					return nullptr;
+				hash = CombineHash(hash, (size_t)Wg_GetInt(h));
+			}
+			return Wg_NewInt(context, (Wg_int)hash);
+		}
+
 		template <Collection collection>
 		static Wg_Obj* collection_contains(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(2);
@@ -2581,14 +3199,18 @@ class ValueError(Exception):
 			}
 
 			buf[index] = argv[2];
+			WriteBarrier(argv[0]);
 			return Wg_None(context);
 		}
 		
 		static Wg_Obj* list_append(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(2);
 			WG_EXPECT_ARG_TYPE_LIST(0);
+			if (!ChargeBytes(context, sizeof(Wg_Obj*)))
+				return nullptr;
 
 			argv[0]->Get<std::vector<Wg_Obj*>>().push_back(argv[1]);
+			WriteBarrier(argv[0]);
 			return Wg_None(context);
 		}
 
@@ -2600,10 +3222,13 @@ class ValueError(Exception):
 			Wg_int index;
 			if (!AbsIndex(argv[0], argv[1], index))
 				return nullptr;
+			if (!ChargeBytes(context, sizeof(Wg_Obj*)))
+				return nullptr;
 
-			auto& buf = argv[0]->Get<std::vector<Wg_Obj*>>();			
+			auto& buf = argv[0]->Get<std::vector<Wg_Obj*>>();
 			index = std::clamp(index, (Wg_int)0, (Wg_int)buf.size() + 1);
 			buf.insert(buf.begin() + index, argv[2]);
+			WriteBarrier(argv[0]);
 			return Wg_None(context);
 		}
 
@@ -2674,11 +3299,16 @@ class ValueError(Exception):
 
 			if (argv[0] == argv[1]) {
 				// Double the list instead of going into an infinite loop
+				if (!ChargeBytes(context, buf.size() * sizeof(Wg_Obj*)))
+					return nullptr;
 				buf.insert(buf.end(), buf.begin(), buf.end());
 			} else {
-				bool success = Wg_Iterate(argv[1], &buf, [](Wg_Obj* value, void* ud) {
-					std::vector<Wg_Obj*>& buf = *(std::vector<Wg_Obj*>*)ud;
-					buf.push_back(value);
+				bool success = Wg_Iterate(argv[1], argv[0], [](Wg_Obj* value, void* ud) {
+					Wg_Obj* list = (Wg_Obj*)ud;
+					if (!ChargeBytes(value->context, sizeof(Wg_Obj*)))
+						return false;
+					list->Get<std::vector<Wg_Obj*>>().push_back(value);
+					WriteBarrier(list);
 					return true;
 					});
 				if (!success)
@@ -2707,18 +3337,34 @@ class ValueError(Exception):
 				reverse = Wg_GetBool(reverseValue);
 			}
 
-			std::vector<Wg_Obj*> buf = argv[0]->Get<std::vector<Wg_Obj*>>();
-			std::vector<Wg_ObjRef> refs;
-			for (Wg_Obj* v : buf)
-				refs.emplace_back(v);
+			// The items are copied in case a comparison modifies the list.
+			// The copy and the keys are kept alive by a list that is not visible to the script.
+			Wg_Obj* temp = Wg_NewList(context, argv[0]->Get<std::vector<Wg_Obj*>>().data(), (int)argv[0]->Get<std::vector<Wg_Obj*>>().size());
+			if (temp == nullptr)
+				return nullptr;
+			Wg_ObjRef ref(temp);
+			auto& buf = temp->Get<std::vector<Wg_Obj*>>();
+			size_t len = buf.size();
+
+			// Each key is computed once
+			if (kw[1] && !Wg_IsNone(kw[1])) {
+				buf.reserve(len * 2);
+				for (size_t i = 0; i < len; i++) {
+					Wg_Obj* key = Wg_Call(kw[1], &buf[i], 1);
+					if (key == nullptr)
+						return nullptr;
+					buf.push_back(key);
+					WriteBarrier(temp);
+				}
+			}
 
-			if (!MergeSort(buf.data(), buf.size(), kw[1]))
+			std::vector<Wg_Obj*> items(buf.begin(), buf.begin() + len);
+			std::vector<Wg_Obj*> sortKeys(buf.end() - len, buf.end());
+			if (!SortObjects(items, sortKeys, reverse))
 				return nullptr;
 
-			if (reverse)
-				std::reverse(buf.begin(), buf.end());
-			
-			argv[0]->Get<std::vector<Wg_Obj*>>() = std::move(buf);
+			argv[0]->Get<std::vector<Wg_Obj*>>() = std::move(items);
+			WriteBarrier(argv[0]);
 
 			return Wg_None(context);
 		}
@@ -2749,14 +3395,16 @@ class ValueError(Exception):
 						context->reprStack.pop_back();
 						return nullptr;
 					}
-					s += k->Get<std::string>() + ": ";
+					s += GetStringView(k);
+					s += ": ";
 					
 					Wg_Obj* v = Wg_UnaryOp(WG_UOP_REPR, val);
 					if (v == nullptr) {
 						context->reprStack.pop_back();
 						return nullptr;
 					}
-					s += v->Get<std::string>() + ", ";
+					s += GetStringView(v);
+					s += ", ";
 				}
 				context->reprStack.pop_back();
 				if (!buf.empty()) {
@@ -2850,11 +3498,19 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_COUNT(3);
 			WG_EXPECT_ARG_TYPE_MAP(0);
 
+			if (!CheckBytes(context, WDict::ITEM_BYTES))
+				return nullptr;
+
+			auto& dict = argv[0]->Get<WDict>();
+			size_t size = dict.size();
 			try {
-				argv[0]->Get<WDict>()[argv[1]] = argv[2];
+				dict[argv[1]] = argv[2];
+				WriteBarrier(argv[0]);
 			} catch (HashException&) {
 				return nullptr;
 			}
+			if (dict.size() > size)
+				CountBytes(context, WDict::ITEM_BYTES);
 			return Wg_None(context);
 		}
 
@@ -2915,6 +3571,7 @@ class ValueError(Exception):
 				auto& entry = argv[0]->Get<WDict>()[argv[1]];
 				if (entry == nullptr)
 					entry = argc == 3 ? argv[2] : Wg_None(context);
+				WriteBarrier(argv[0]);
 				return entry;
 			} catch (HashException&) {
 				return nullptr;
@@ -2938,6 +3595,7 @@ class ValueError(Exception):
 				Wg_ObjRef ref(kv[1]);
 				try {
 					((Wg_Obj*)ud)->Get<WDict>()[kv[0]] = kv[1];
+					WriteBarrier((Wg_Obj*)ud);
 				} catch (HashException&) {}
 				return true;
 			};
@@ -2978,7 +3636,8 @@ class ValueError(Exception):
 						context->reprStack.pop_back();
 						return nullptr;
 					}
-					s += v->Get<std::string>() + ", ";
+					s += GetStringView(v);
+					s += ", ";
 				}
 				context->reprStack.pop_back();
 				if (!buf.empty()) {
@@ -3028,7 +3687,15 @@ class ValueError(Exception):
 		static Wg_Obj* set_add(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(2);
 			WG_EXPECT_ARG_TYPE_SET(0);
-			argv[0]->Get<WSet>().insert(argv[1]);
+			if (!CheckBytes(context, WSet::ITEM_BYTES))
+				return nullptr;
+
+			auto& set = argv[0]->Get<WSet>();
+			size_t size = set.size();
+			set.insert(argv[1]);
+			WriteBarrier(argv[0]);
+			if (set.size() > size)
+				CountBytes(context, WSet::ITEM_BYTES);
 			return Wg_None(context);
 		}
 
@@ -3089,14 +3756,14 @@ class ValueError(Exception):
 			WG_EXPECT_ARG_TYPE_SET(0);
 
 			auto f = [](Wg_Obj* obj, void* ud) {
-				auto set = (WSet*)ud;
 				try {
-					set->insert(obj);
+					((Wg_Obj*)ud)->Get<WSet>().insert(obj);
+					WriteBarrier((Wg_Obj*)ud);
 				} catch (HashException&) {}
 				return true;
 			};
 
-			if (!Wg_Iterate(argv[1], &argv[0]->Get<WSet>(), f))
+			if (!Wg_Iterate(argv[1], argv[0], f))
 				return nullptr;
 			
 			return Wg_None(context);
@@ -3111,13 +3778,14 @@ class ValueError(Exception):
 			
 			auto f = [](Wg_Obj* obj, void* ud) {
 				try {
-					((WSet*)ud)->insert(obj);
+					((Wg_Obj*)ud)->Get<WSet>().insert(obj);
+					WriteBarrier((Wg_Obj*)ud);
 				} catch (HashException&) {}
 				return true;
 			};
 
 			for (int i = 0; i < argc; i++)
-				if (!Wg_Iterate(argv[i], &res->Get<WSet>(), f))
+				if (!Wg_Iterate(argv[i], res, f))
 					return nullptr;
 
 			return res;
@@ -3133,8 +3801,8 @@ class ValueError(Exception):
 			struct State {
 				Wg_Obj** other;
 				int otherCount;
-				WSet* res;
-			} s{ argv + 1, argc - 1, &res->Get<WSet>() };
+				Wg_Obj* res;
+			} s{ argv + 1, argc - 1, res };
 
 			auto f = [](Wg_Obj* obj, void* ud) {
 				auto s = (State*)ud;
@@ -3148,7 +3816,8 @@ class ValueError(Exception):
 				}
 
 				try {
-					s->res->insert(obj);
+					s->res->Get<WSet>().insert(obj);
+					WriteBarrier(s->res);
 				} catch (HashException&) {}
 				return true;
 			};
@@ -3169,8 +3838,8 @@ class ValueError(Exception):
 			struct State {
 				Wg_Obj** other;
 				int otherCount;
-				WSet* res;
-			} s{ argv + 1, argc - 1, &res->Get<WSet>() };
+				Wg_Obj* res;
+			} s{ argv + 1, argc - 1, res };
 
 			auto f = [](Wg_Obj* obj, void* ud) {
 				auto s = (State*)ud;
@@ -3184,7 +3853,8 @@ class ValueError(Exception):
 				}
 
 				try {
-					s->res->insert(obj);
+					s->res->Get<WSet>().insert(obj);
+					WriteBarrier(s->res);
 				} catch (HashException&) {}
 				return true;
 			};
@@ -3204,8 +3874,8 @@ class ValueError(Exception):
 
 			struct State {
 				Wg_Obj* other;
-				WSet* res;
-			} s = { nullptr, &res->Get<WSet>() };
+				Wg_Obj* res;
+			} s = { nullptr, res };
 
 			auto f = [](Wg_Obj* obj, void* ud) {
 				auto s = (State*)ud;
@@ -3217,7 +3887,8 @@ class ValueError(Exception):
 					return true;
 					
 				try {
-					s->res->insert(obj);
+					s->res->Get<WSet>().insert(obj);
+					WriteBarrier(s->res);
 				} catch (HashException&) {}
 				return true;
 			};
@@ -3360,205 +4031,1111 @@ class ValueError(Exception):
 				Wg_RaiseException(context, WG_EXC_STOPITERATION);
 				return nullptr;
 			}
-			
-			Wg_Obj* obj = **it;
-			++(*it);
-			return obj;
-		}
+			
+			Wg_Obj* obj = **it;
+			++(*it);
+			return obj;
+		}
+
+		static bool GetRangeBounds(Wg_Obj* range, Wg_Obj* (&out)[3]) {
+			const char* names[3] = { "start", "stop", "step" };
+			for (int i = 0; i < 3; i++) {
+				out[i] = Wg_GetAttribute(range, names[i]);
+				if (out[i] == nullptr) {
+					return false;
+				} else if (!Wg_IsInt(out[i])) {
+					std::string message = std::string("range ") + names[i] + " must be an integer";
+					Wg_RaiseException(range->context, WG_EXC_TYPEERROR, message.c_str());
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static Wg_Obj* Range_iter(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* bounds[3]{};
+			if (!GetRangeBounds(argv[0], bounds))
+				return nullptr;
+			return Wg_Call(context->builtins.rangeIter, bounds, 3);
+		}
+
+		static Wg_Obj* Range_reversed(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* bounds[3]{};
+			if (!GetRangeBounds(argv[0], bounds))
+				return nullptr;
+			Wg_int start = Wg_GetInt(bounds[0]);
+			Wg_int stop = Wg_GetInt(bounds[1]);
+			Wg_int step = Wg_GetInt(bounds[2]);
+
+			Wg_Obj* args[3]{};
+			std::vector<Wg_ObjRef> refs;
+			Wg_int values[3] = { stop - step, start - step, -step };
+			for (int i = 0; i < 3; i++) {
+				if ((args[i] = Wg_NewInt(context, values[i])) == nullptr)
+					return nullptr;
+				refs.emplace_back(args[i]);
+			}
+			return Wg_Call(context->builtins.range, args, 3);
+		}
+
+		static Wg_Obj* RangeIter_next(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			RangeIterator* it{};
+			if (!TryGetUserdata(argv[0], "__RangeIter", &it)) {
+				Wg_RaiseArgumentTypeError(context, 0, "__RangeIter");
+				return nullptr;
+			}
+
+			if (it->step > 0 ? it->cur >= it->stop : it->cur <= it->stop) {
+				Wg_RaiseException(context, WG_EXC_STOPITERATION);
+				return nullptr;
+			}
+
+			Wg_int cur = it->cur;
+			it->cur += it->step;
+			return Wg_NewInt(context, cur);
+		}
+
+		static Wg_Obj* Enumerate_next(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			Wg_int* i{};
+			if (!TryGetUserdata(argv[0], "enumerate", &i)) {
+				Wg_RaiseArgumentTypeError(context, 0, "enumerate");
+				return nullptr;
+			}
+
+			Wg_Obj* iter = Wg_GetAttribute(argv[0], "_iter");
+			if (iter == nullptr)
+				return nullptr;
+
+			Wg_Obj* tup[2]{};
+			if ((tup[1] = Wg_CallMethod(iter, "__next__", nullptr, 0)) == nullptr)
+				return nullptr;
+			Wg_ObjRef ref(tup[1]);
+
+			if ((tup[0] = Wg_NewInt(context, (*i)++)) == nullptr)
+				return nullptr;
+			return Wg_NewTuple(context, tup, 2);
+		}
+
+		static Wg_Obj* Map_next(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* f = Wg_GetAttribute(argv[0], "_f");
+			if (f == nullptr)
+				return nullptr;
+			Wg_Obj* iter = Wg_GetAttribute(argv[0], "_iter");
+			if (iter == nullptr)
+				return nullptr;
+
+			Wg_Obj* val = Wg_CallMethod(iter, "__next__", nullptr, 0);
+			if (val == nullptr)
+				return nullptr;
+			Wg_ObjRef ref(val);
+			return Wg_Call(f, &val, 1);
+		}
+
+		static Wg_Obj* Filter_next(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* f = Wg_GetAttribute(argv[0], "_f");
+			if (f == nullptr)
+				return nullptr;
+			Wg_Obj* iter = Wg_GetAttribute(argv[0], "_iter");
+			if (iter == nullptr)
+				return nullptr;
+
+			while (true) {
+				Wg_Obj* val = Wg_CallMethod(iter, "__next__", nullptr, 0);
+				if (val == nullptr)
+					return nullptr;
+				Wg_ObjRef ref(val);
+
+				Wg_Obj* keep = Wg_Call(f, &val, 1);
+				if (keep == nullptr)
+					return nullptr;
+				if ((keep = Wg_UnaryOp(WG_UOP_BOOL, keep)) == nullptr)
+					return nullptr;
+				if (Wg_GetBool(keep))
+					return val;
+			}
+		}
+
+		static Wg_Obj* Zip_next(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* iters = Wg_GetAttribute(argv[0], "_iters");
+			if (iters == nullptr) {
+				return nullptr;
+			} else if (!Wg_IsTuple(iters)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "zip iterators must be a tuple");
+				return nullptr;
+			}
+			Wg_ObjRef itersRef(iters);
+
+			size_t count = iters->Get<std::vector<Wg_Obj*>>().size();
+			if (count == 0) {
+				Wg_RaiseException(context, WG_EXC_STOPITERATION);
+				return nullptr;
+			}
+
+			std::vector<Wg_Obj*> values;
+			std::vector<Wg_ObjRef> refs;
+			for (size_t i = 0; i < count; i++) {
+				Wg_Obj* iter = iters->Get<std::vector<Wg_Obj*>>()[i];
+				Wg_Obj* val = Wg_CallMethod(iter, "__next__", nullptr, 0);
+				if (val == nullptr)
+					return nullptr;
+				refs.emplace_back(val);
+				values.push_back(val);
+			}
+			return Wg_NewTuple(context, values.data(), (int)values.size());
+		}
+
+		static Wg_Obj* File_next(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			FileObject* f = GetReadableFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			std::string scratch;
+			std::string_view line = ReadFileLine(*f, SIZE_MAX, scratch);
+			if (line.empty()) {
+				Wg_RaiseException(context, WG_EXC_STOPITERATION);
+				return nullptr;
+			}
+			return NewFileData(context, *f, line);
+		}
+
+		static Wg_Obj* File_read(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+			FileObject* f = GetReadableFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			Wg_int size = -1;
+			if (argc == 2) {
+				WG_EXPECT_ARG_TYPE_INT(1);
+				size = Wg_GetInt(argv[1]);
+			}
+
+			std::string scratch;
+			std::string_view data = ReadFileData(*f, size < 0 ? SIZE_MAX : (size_t)size, scratch);
+			return NewFileData(context, *f, data);
+		}
+
+		static Wg_Obj* File_readline(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+			FileObject* f = GetReadableFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			Wg_int size = -1;
+			if (argc == 2) {
+				WG_EXPECT_ARG_TYPE_INT(1);
+				size = Wg_GetInt(argv[1]);
+			}
+
+			std::string scratch;
+			std::string_view line = ReadFileLine(*f, size < 0 ? SIZE_MAX : (size_t)size, scratch);
+			return NewFileData(context, *f, line);
+		}
+
+		static Wg_Obj* File_readlines(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+			FileObject* f = GetReadableFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			// Stops once the lines read add up to at least hint
+			Wg_int hint = -1;
+			if (argc == 2) {
+				WG_EXPECT_ARG_TYPE_INT(1);
+				hint = Wg_GetInt(argv[1]);
+			}
+
+			Wg_Obj* list = Wg_NewList(context);
+			if (list == nullptr)
+				return nullptr;
+			Wg_ObjRef ref(list);
+
+			std::string scratch;
+			size_t total = 0;
+			while (true) {
+				std::string_view line = ReadFileLine(*f, SIZE_MAX, scratch);
+				if (line.empty())
+					break;
+				Wg_Obj* value = NewFileData(context, *f, line);
+				if (value == nullptr)
+					return nullptr;
+				list->Get<std::vector<Wg_Obj*>>().push_back(value);
+				WriteBarrier(list);
+				total += line.size();
+				if (hint > 0 && total >= (size_t)hint)
+					break;
+			}
+			return list;
+		}
+
+		static Wg_Obj* File_closex(Wg_Context* context, Wg_Obj** argv, int) {
+			FileObject* f{};
+			if (!TryGetUserdata(argv[0], "__File", &f)) {
+				Wg_RaiseArgumentTypeError(context, 0, "__File");
+				return nullptr;
+			}
+
+			if (f->file) {
+				std::fclose(f->file);
+				f->file = nullptr;
+			}
+			// Bytes read from the mapping keep it alive
+			f->mapping = nullptr;
+
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* File_close(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			return File_closex(context, argv, argc);
+		}
+
+		static Wg_Obj* File_exit(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(4);
+			return File_closex(context, argv, argc);
+		}
+
+		static Wg_Obj* File_seekable(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			if (GetFileArg(context, argv) == nullptr)
+				return nullptr;
+			
+			return Wg_NewBool(context, true);
+		}
+
+		static Wg_Obj* File_readable(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			FileObject* f = GetFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			return Wg_NewBool(context, f->readable);
+		}
+
+		static Wg_Obj* File_writable(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			FileObject* f = GetFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			return Wg_NewBool(context, f->writable);
+		}
+
+		static Wg_Obj* File_seek(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(2, 3);
+			WG_EXPECT_ARG_TYPE_INT(1);
+			FileObject* f = GetFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			Wg_int whence = 0;
+			if (argc == 3) {
+				WG_EXPECT_ARG_TYPE_INT(2);
+				whence = Wg_GetInt(argv[2]);
+			}
+
+			Wg_int base{};
+			switch (whence) {
+			case 0:
+				base = 0;
+				break;
+			case 1:
+				base = TellFile(*f);
+				break;
+			case 2:
+				if (f->mapping) {
+					base = (Wg_int)f->mapping->Size();
+				} else {
+					std::fseek(f->file, 0, SEEK_END);
+					base = (Wg_int)std::ftell(f->file);
+				}
+				break;
+			default:
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "invalid whence");
+				return nullptr;
+			}
+
+			Wg_int pos = base + Wg_GetInt(argv[1]);
+			if (pos < 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "negative seek position");
+				return nullptr;
+			}
+
+			if (f->mapping) {
+				f->mapPos = (size_t)pos;
+			} else {
+				std::fseek(f->file, (long)pos, SEEK_SET);
+				f->bufferPos = 0;
+				f->bufferEnd = 0;
+				f->writing = false;
+			}
+			return Wg_NewInt(context, pos);
+		}
+
+		static Wg_Obj* File_tell(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			FileObject* f = GetFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			return Wg_NewInt(context, TellFile(*f));
+		}
+
+		static Wg_Obj* File_flush(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			FileObject* f = GetFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+
+			if (f->file)
+				std::fflush(f->file);
+
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* File_write(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			FileObject* f = GetFileArg(context, argv);
+			if (f == nullptr)
+				return nullptr;
+			if (!f->writable) {
+				Wg_RaiseException(context, WG_EXC_OSERROR, "File not open for writing");
+				return nullptr;
+			}
+
+			std::string_view data;
+			if (f->binary) {
+				BufferObject* buf = GetBufferArg(context, argv, 1);
+				if (buf == nullptr)
+					return nullptr;
+				data = buf->View();
+			} else {
+				WG_EXPECT_ARG_TYPE_STRING(1);
+				data = GetStringView(argv[1]);
+			}
+
+			if (!f->writing) {
+				DiscardReadBuffer(*f);
+				f->writing = true;
+			}
+			if (std::fwrite(data.data(), 1, data.size(), f->file) != data.size()) {
+				Wg_RaiseException(context, WG_EXC_OSERROR, "Failed to write to file");
+				return nullptr;
+			}
+
+			return Wg_NewInt(context, (Wg_int)data.size());
+		}
+
+		static Wg_Obj* File_writelines(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			if (GetFileArg(context, argv) == nullptr)
+				return nullptr;
+
+			auto fn = [](Wg_Obj* obj, void* ud) {
+				auto* file = (Wg_Obj*)ud;
+				return Wg_CallMethod(file, "write", &obj, 1) != nullptr;
+			};
+
+			if (!Wg_Iterate(argv[1], argv[0], fn))
+				return nullptr;
+
+			return Wg_None(context);
+		}
+		
+		static bool ExpectGenerator(Wg_Context* context, Wg_Obj** argv) {
+			if (argv[0]->type != ObjType::Generator) {
+				Wg_RaiseArgumentTypeError(context, 0, "generator");
+				return false;
+			}
+			return true;
+		}
+
+		static Wg_Obj* generator_str(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			if (!ExpectGenerator(context, argv))
+				return nullptr;
+			const auto& gen = *(Generator*)argv[0]->data;
+			std::string s = "<generator object " + gen.executor.def->prettyName + " at " + PtrToString(argv[0]) + ">";
+			return Wg_NewString(context, s.c_str());
+		}
+
+		static Wg_Obj* generator_send(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+			if (!ExpectGenerator(context, argv))
+				return nullptr;
+			Wg_Obj* value = ResumeGenerator(argv[0], argc == 2 ? argv[1] : nullptr, nullptr);
+			if (value == nullptr && Wg_GetException(context) == nullptr)
+				Wg_RaiseException(context, WG_EXC_STOPITERATION);
+			return value;
+		}
+
+		static Wg_Obj* generator_throw(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			if (!ExpectGenerator(context, argv))
+				return nullptr;
+			Wg_Obj* value = ResumeGenerator(argv[0], nullptr, argv[1]);
+			if (value == nullptr && Wg_GetException(context) == nullptr)
+				Wg_RaiseException(context, WG_EXC_STOPITERATION);
+			return value;
+		}
+
+		static Wg_Obj* generator_close(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			if (!ExpectGenerator(context, argv))
+				return nullptr;
+			Wg_Obj* exitClass = Wg_GetGlobal(context, "GeneratorExit");
+			if (exitClass == nullptr || !CloseGenerator(argv[0], exitClass))
+				return nullptr;
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* self(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			return argv[0];
+		}
+
+		static Wg_Obj* buffer_len(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			return Wg_NewInt(context, (Wg_int)buf->length);
+		}
+
+		static Wg_Obj* buffer_nonzero(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			return Wg_NewBool(context, buf->length != 0);
+		}
+
+		static Wg_Obj* buffer_str(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetBuffer(argv[0]);
+			if (buf == nullptr) {
+				Wg_RaiseArgumentTypeError(context, 0, "bytes, bytearray or memoryview");
+				return nullptr;
+			}
+
+			std::string s;
+			switch (buf->kind) {
+			case BufferObject::Kind::Bytes:
+				s = BytesRepr(buf->View());
+				break;
+			case BufferObject::Kind::ByteArray:
+				s = "bytearray(" + BytesRepr(buf->View()) + ")";
+				break;
+			case BufferObject::Kind::MemoryView:
+				s = std::string(buf->storage ? "<memory at " : "<released memory at ") + PtrToString(argv[0]) + ">";
+				break;
+			case BufferObject::Kind::Array:
+				// Arrays have their own repr in the array module
+				return Wg_UnaryOp(WG_UOP_REPR, argv[0]);
+			}
+			return Wg_NewStringBuffer(context, s.data(), (int)s.size());
+		}
+
+		static Wg_Obj* buffer_hash(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			if (!buf->readonly) {
+				std::string msg = "unhashable type: '" + WObjTypeToString(argv[0]) + "'";
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+				return nullptr;
+			}
+
+			if (!argv[0]->hasCachedHash) {
+				argv[0]->cachedHash = (size_t)(Wg_int)std::hash<std::string_view>()(buf->View());
+				argv[0]->hasCachedHash = true;
+			}
+			return Wg_NewInt(context, (Wg_int)argv[0]->cachedHash);
+		}
+
+		static Wg_Obj* buffer_eq(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			BufferObject* other = GetBuffer(argv[1]);
+			return Wg_NewBool(context, other && other->storage && buf->View() == other->View());
+		}
+
+		static Wg_Obj* buffer_lt(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			BufferObject* other = GetBufferArg(context, argv, 1);
+			if (other == nullptr)
+				return nullptr;
+			return Wg_NewBool(context, buf->View() < other->View());
+		}
+
+		// Gets the value searched for by find(), count(), etc., which is either a byte or a buffer
+		static bool GetSearchArg(Wg_Context* context, Wg_Obj** argv, int index, char& byte, std::string_view& out) {
+			if (Wg_IsInt(argv[index])) {
+				unsigned char b{};
+				if (!ByteFromObject(context, argv[index], b))
+					return false;
+				byte = (char)b;
+				out = { &byte, 1 };
+				return true;
+			}
+
+			BufferObject* buf = GetBufferArg(context, argv, index);
+			if (buf == nullptr)
+				return false;
+			out = buf->View();
+			return true;
+		}
+
+		// Gets the optional start and end arguments of a search, clamped to the size of the buffer
+		static bool GetSearchRange(Wg_Context* context, Wg_Obj** argv, int argc, int index, size_t size, size_t& begin, size_t& end) {
+			auto get = [&](int i, size_t& out) {
+				if (i >= argc || Wg_IsNone(argv[i]))
+					return true;
+				if (!Wg_IsInt(argv[i])) {
+					Wg_RaiseArgumentTypeError(context, i, "int");
+					return false;
+				}
+				Wg_int v = Wg_GetInt(argv[i]);
+				if (v < 0)
+					v += (Wg_int)size;
+				out = (size_t)std::clamp(v, (Wg_int)0, (Wg_int)size);
+				return true;
+			};
+			begin = 0;
+			end = size;
+			return get(index, begin) && get(index + 1, end);
+		}
+
+		static Wg_Obj* buffer_contains(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			char byte{};
+			std::string_view sub;
+			if (!GetSearchArg(context, argv, 1, byte, sub))
+				return nullptr;
+
+			std::string_view s = buf->View();
+			if (Wg_IsInt(argv[1]))
+				return Wg_NewBool(context, !s.empty() && std::memchr(s.data(), byte, s.size()) != nullptr);
+			return Wg_NewBool(context, s.find(sub) != std::string_view::npos);
+		}
+
+		template <bool reverse>
+		static Wg_Obj* buffer_findx(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(2, 4);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			char byte{};
+			std::string_view sub;
+			if (!GetSearchArg(context, argv, 1, byte, sub))
+				return nullptr;
+
+			std::string_view s = buf->View();
+			size_t begin, end;
+			if (!GetSearchRange(context, argv, argc, 2, s.size(), begin, end))
+				return nullptr;
+			if (begin > end)
+				return Wg_NewInt(context, -1);
+
+			s = s.substr(begin, end - begin);
+			size_t location = reverse ? s.rfind(sub) : s.find(sub);
+			if (location == std::string_view::npos)
+				return Wg_NewInt(context, -1);
+			return Wg_NewInt(context, (Wg_int)(begin + location));
+		}
+
+		template <bool reverse>
+		static Wg_Obj* buffer_indexx(Wg_Context* context, Wg_Obj** argv, int argc) {
+			Wg_Obj* location = buffer_findx<reverse>(context, argv, argc);
+			if (location == nullptr)
+				return nullptr;
+
+			if (Wg_GetInt(location) == -1) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "subsection not found");
+				return nullptr;
+			}
+			return location;
+		}
+
+		static Wg_Obj* buffer_count(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(2, 4);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			char byte{};
+			std::string_view sub;
+			if (!GetSearchArg(context, argv, 1, byte, sub))
+				return nullptr;
+
+			std::string_view s = buf->View();
+			size_t begin, end;
+			if (!GetSearchRange(context, argv, argc, 2, s.size(), begin, end))
+				return nullptr;
+			if (begin > end)
+				return Wg_NewInt(context, 0);
+
+			s = s.substr(begin, end - begin);
+			if (sub.empty())
+				return Wg_NewInt(context, (Wg_int)s.size() + 1);
+
+			Wg_int count = 0;
+			for (size_t pos = 0; (pos = s.find(sub, pos)) != std::string_view::npos; pos += sub.size())
+				count++;
+			return Wg_NewInt(context, count);
+		}
+
+		template <bool end>
+		static Wg_Obj* buffer_startswith(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			BufferObject* affix = GetBufferArg(context, argv, 1);
+			if (affix == nullptr)
+				return nullptr;
+
+			std::string_view s = buf->View();
+			return Wg_NewBool(context, end ? s.ends_with(affix->View()) : s.starts_with(affix->View()));
+		}
+
+		static Wg_Obj* buffer_getitem(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			if (Wg_IsInstance(argv[1], &context->builtins.slice, 1)) {
+				Wg_int start, stop, step;
+				if (!AbsSlice(argv[0], argv[1], start, stop, step))
+					return nullptr;
+				if ((buf = GetBufferArg(context, argv, 0)) == nullptr)
+					return nullptr;
+
+				Wg_int size = (Wg_int)buf->length;
+				if (step == 1) {
+					start = std::clamp(start, (Wg_int)0, size);
+					stop = std::clamp(stop, start, size);
+					if (buf->kind == BufferObject::Kind::ByteArray)
+						return NewOwnedBuffer(context, buf->kind, buf->View().substr((size_t)start, (size_t)(stop - start)));
+
+					// Bytes are immutable and memoryviews refer to the same memory, so the storage is shared
+					BufferObject view = *buf;
+					view.offset += (size_t)start;
+					view.length = (size_t)(stop - start);
+					return NewBuffer(context, std::move(view));
+				}
+
+				if (buf->kind == BufferObject::Kind::MemoryView) {
+					Wg_RaiseException(context, WG_EXC_NOTIMPLEMENTEDERROR, "memoryview slices with a step are not supported");
+					return nullptr;
+				}
+
+				std::vector<unsigned char> sliced;
+				const unsigned char* data = buf->Data();
+				IterateRange(start, stop, step, [&](Wg_int i) {
+					if (i >= 0 && i < size)
+						sliced.push_back(data[i]);
+					return true;
+					});
+				return NewBuffer(context, OwnedBuffer(buf->kind, std::move(sliced)));
+			}
+
+			Wg_Obj* idx = Wg_UnaryOp(WG_UOP_INDEX, argv[1]);
+			if (idx == nullptr)
+				return nullptr;
+			if (!Wg_IsInt(idx)) {
+				Wg_RaiseArgumentTypeError(context, 1, "int or slice");
+				return nullptr;
+			}
+			if ((buf = GetBufferArg(context, argv, 0)) == nullptr)
+				return nullptr;
+
+			Wg_int index = Wg_GetInt(idx);
+			if (index < 0)
+				index += (Wg_int)buf->length;
+			if (index < 0 || index >= (Wg_int)buf->length) {
+				Wg_RaiseException(context, WG_EXC_INDEXERROR, "index out of range");
+				return nullptr;
+			}
+			return Wg_NewInt(context, buf->Data()[index]);
+		}
+
+		static Wg_Obj* buffer_setitem(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(3);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			if (buf->readonly) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "cannot modify read-only memory");
+				return nullptr;
+			}
+
+			if (Wg_IsInstance(argv[1], &context->builtins.slice, 1)) {
+				Wg_int start, stop, step;
+				if (!AbsSlice(argv[0], argv[1], start, stop, step))
+					return nullptr;
+
+				// The value is copied first in case it refers to the same memory
+				std::vector<unsigned char> value;
+				if (Wg_IsInt(argv[2]) || (buf->kind == BufferObject::Kind::MemoryView && !GetBuffer(argv[2]))) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "can assign only bytes, buffers, or iterables of ints in range(0, 256)");
+					return nullptr;
+				}
+				if (!CollectBytes(context, argv[2], value))
+					return nullptr;
+				if ((buf = GetBufferArg(context, argv, 0)) == nullptr)
+					return nullptr;
+
+				Wg_int size = (Wg_int)buf->length;
+				if (step == 1) {
+					start = std::clamp(start, (Wg_int)0, size);
+					stop = std::clamp(stop, start, size);
+					if (value.size() == (size_t)(stop - start)) {
+						std::copy(value.begin(), value.end(), buf->Data() + start);
+					} else if (buf->kind == BufferObject::Kind::MemoryView) {
+						Wg_RaiseException(context, WG_EXC_VALUEERROR, "memoryview assignment: lvalue and rvalue have different structures");
+						return nullptr;
+					} else {
+						if (!CheckResizable(context, buf))
+							return nullptr;
+						auto& owned = buf->storage->owned;
+						owned.erase(owned.begin() + start, owned.begin() + stop);
+						owned.insert(owned.begin() + start, value.begin(), value.end());
+						buf->length = owned.size();
+					}
+					return Wg_None(context);
+				}
+
+				if (buf->kind == BufferObject::Kind::MemoryView) {
+					Wg_RaiseException(context, WG_EXC_NOTIMPLEMENTEDERROR, "memoryview slices with a step are not supported");
+					return nullptr;
+				}
+
+				std::vector<size_t> indices;
+				IterateRange(start, stop, step, [&](Wg_int i) {
+					if (i >= 0 && i < size)
+						indices.push_back((size_t)i);
+					return true;
+					});
+				if (indices.size() != value.size()) {
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, "attempt to assign bytes to an extended slice of a different size");
+					return nullptr;
+				}
+				for (size_t i = 0; i < indices.size(); i++)
+					buf->Data()[indices[i]] = value[i];
+				return Wg_None(context);
+			}
+
+			Wg_Obj* idx = Wg_UnaryOp(WG_UOP_INDEX, argv[1]);
+			if (idx == nullptr)
+				return nullptr;
+			if (!Wg_IsInt(idx)) {
+				Wg_RaiseArgumentTypeError(context, 1, "int or slice");
+				return nullptr;
+			}
+			unsigned char value{};
+			if (!ByteFromObject(context, argv[2], value))
+				return nullptr;
+			if ((buf = GetBufferArg(context, argv, 0)) == nullptr)
+				return nullptr;
 
-		static Wg_Obj* File_iter(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(1);
-			if (!Wg_TryGetUserdata(argv[0], "__File", nullptr)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+			Wg_int index = Wg_GetInt(idx);
+			if (index < 0)
+				index += (Wg_int)buf->length;
+			if (index < 0 || index >= (Wg_int)buf->length) {
+				Wg_RaiseException(context, WG_EXC_INDEXERROR, "index out of range");
 				return nullptr;
 			}
-
-			return Wg_Call(context->builtins.readlineIter, argv, 1);
+			buf->Data()[index] = value;
+			return Wg_None(context);
 		}
 
-		static Wg_Obj* File_read(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
-			std::fstream* f{};
-			if (!TryGetUserdata(argv[0], "__File", &f)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+		static Wg_Obj* buffer_add(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* lhs = GetBufferArg(context, argv, 0);
+			if (lhs == nullptr)
+				return nullptr;
+			BufferObject* rhs = GetBufferArg(context, argv, 1);
+			if (rhs == nullptr)
 				return nullptr;
-			}
-
-			Wg_int size = -1;
-			if (argc == 2) {
-				WG_EXPECT_ARG_TYPE_INT(1);
-				size = Wg_GetInt(argv[1]);
-			}
 
-			if (size < 0) {
-				auto cur = f->tellg();
-				f->seekg(0, std::ios::end);
-				size = (Wg_int)(f->tellg() - cur);
-				f->seekg(cur);
-			}
-			
-			std::vector<char> buf((size_t)size);
-			f->read(buf.data(), size);
-			return Wg_NewStringBuffer(context, buf.data(), (int)buf.size());
+			std::string_view l = lhs->View();
+			std::string_view r = rhs->View();
+			std::vector<unsigned char> data;
+			data.reserve(l.size() + r.size());
+			data.insert(data.end(), l.begin(), l.end());
+			data.insert(data.end(), r.begin(), r.end());
+			return NewBuffer(context, OwnedBuffer(lhs->kind, std::move(data)));
 		}
 
-		static Wg_Obj* File_readline(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(1);
-			std::fstream* f{};
-			if (!TryGetUserdata(argv[0], "__File", &f)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+		static Wg_Obj* buffer_mul(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
 				return nullptr;
-			}
-			
-			if (f->eof()) {
-				return Wg_NewString(context);
-			}
+			WG_EXPECT_ARG_TYPE_INT(1);
 
-			std::string s;
-			std::getline(*f, s);
-			if (f->good())
-				s += '\n';
-			return Wg_NewString(context, s.c_str());
+			std::string_view s = buf->View();
+			Wg_int multiplier = std::max(Wg_GetInt(argv[1]), (Wg_int)0);
+			if (!CheckBytes(context, s.size() * (size_t)multiplier))
+				return nullptr;
+			std::vector<unsigned char> data;
+			data.reserve(s.size() * (size_t)multiplier);
+			for (Wg_int i = 0; i < multiplier; i++)
+				data.insert(data.end(), s.begin(), s.end());
+			return NewBuffer(context, OwnedBuffer(buf->kind, std::move(data)));
 		}
 
-		static Wg_Obj* File_readlines(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(1);
-			if (!Wg_TryGetUserdata(argv[0], "__File", nullptr)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+		static Wg_Obj* buffer_decode(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
 				return nullptr;
-			}
 
-			return Wg_Call(context->builtins.list, argv, 1);
+			std::string_view s = buf->View();
+			if (!CheckEncoding(context, argc == 2 ? argv[1] : nullptr, s))
+				return nullptr;
+			return Wg_NewStringBuffer(context, s.data(), (int)s.size());
 		}
 
-		static Wg_Obj* File_closex(Wg_Context* context, Wg_Obj** argv, int) {
-			std::fstream* f{};
-			if (!TryGetUserdata(argv[0], "__File", &f)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+		static Wg_Obj* buffer_hex(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
 				return nullptr;
-			}
 
-			if (f->is_open())
-				f->close();
-
-			return Wg_None(context);
+			const char* digits = "0123456789abcdef";
+			std::string s;
+			s.reserve(buf->length * 2);
+			for (char c : buf->View()) {
+				s += digits[(unsigned char)c >> 4];
+				s += digits[(unsigned char)c & 15];
+			}
+			return Wg_NewStringBuffer(context, s.data(), (int)s.size());
 		}
 
-		static Wg_Obj* File_close(Wg_Context* context, Wg_Obj** argv, int argc) {
+		static Wg_Obj* memoryview_tobytes(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
-			return File_closex(context, argv, argc);
-		}
-
-		static Wg_Obj* File_exit(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(4);
-			return File_closex(context, argv, argc);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			return NewOwnedBuffer(context, BufferObject::Kind::Bytes, buf->View());
 		}
 
-		static Wg_Obj* File_seekable(Wg_Context* context, Wg_Obj** argv, int argc) {
+		static Wg_Obj* memoryview_tolist(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
-			if (!Wg_TryGetUserdata(argv[0], "__File", nullptr)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			Wg_Obj* list = Wg_NewList(context);
+			if (list == nullptr)
 				return nullptr;
+			Wg_ObjRef ref(list);
+
+			// Every byte is an immortal small int, so the list only grows once
+			list->Get<std::vector<Wg_Obj*>>().reserve(buf->length);
+			std::string_view data = buf->View();
+			for (char c : data) {
+				Wg_Obj* i = Wg_NewInt(context, (unsigned char)c);
+				if (i == nullptr)
+					return nullptr;
+				list->Get<std::vector<Wg_Obj*>>().push_back(i);
 			}
-			
-			return Wg_NewBool(context, true);
+			return list;
 		}
 
-		static Wg_Obj* File_readable(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(1);
-			if (!Wg_TryGetUserdata(argv[0], "__File", nullptr)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+		static Wg_Obj* memoryview_release(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_AT_LEAST(1);
+			BufferObject* buf = GetBuffer(argv[0]);
+			if (buf == nullptr) {
+				Wg_RaiseArgumentTypeError(context, 0, "memoryview");
 				return nullptr;
 			}
-
-			return Wg_GetAttribute(argv[0], "_readable");
+			buf->storage = nullptr;
+			buf->length = 0;
+			return Wg_None(context);
 		}
 
-		static Wg_Obj* File_writable(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(1);
-			if (!Wg_TryGetUserdata(argv[0], "__File", nullptr)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+		static Wg_Obj* bytearray_append(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+			unsigned char value{};
+			if (!ByteFromObject(context, argv[1], value))
+				return nullptr;
+			if (!CheckResizable(context, buf) || !ChargeBytes(context, 1))
 				return nullptr;
-			}
 
-			return Wg_GetAttribute(argv[0], "_writable");
+			buf->storage->owned.push_back(value);
+			buf->length++;
+			return Wg_None(context);
 		}
 
-		static Wg_Obj* File_seek(Wg_Context* context, Wg_Obj** argv, int argc) {
+		static Wg_Obj* bytearray_extend(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(2);
-			WG_EXPECT_ARG_TYPE_INT(1);
-			std::fstream* f{};
-			if (!TryGetUserdata(argv[0], "__File", &f)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+			if (GetBufferArg(context, argv, 0) == nullptr)
+				return nullptr;
+			if (Wg_IsInt(argv[1])) {
+				Wg_RaiseArgumentTypeError(context, 1, "iterable of ints");
 				return nullptr;
 			}
-			
-			f->seekg((std::streampos)Wg_GetInt(argv[1]));
 
+			std::vector<unsigned char> value;
+			if (!CollectBytes(context, argv[1], value))
+				return nullptr;
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr || !CheckResizable(context, buf) || !ChargeBytes(context, value.size()))
+				return nullptr;
+
+			auto& owned = buf->storage->owned;
+			owned.insert(owned.end(), value.begin(), value.end());
+			buf->length = owned.size();
 			return Wg_None(context);
 		}
 
-		static Wg_Obj* File_tell(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(1);
-			std::fstream* f{};
-			if (!TryGetUserdata(argv[0], "__File", &f)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+		static Wg_Obj* bytearray_pop(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr)
+				return nullptr;
+
+			Wg_int index = -1;
+			if (argc == 2) {
+				WG_EXPECT_ARG_TYPE_INT(1);
+				index = Wg_GetInt(argv[1]);
+			}
+			if (index < 0)
+				index += (Wg_int)buf->length;
+			if (index < 0 || index >= (Wg_int)buf->length) {
+				Wg_RaiseException(context, WG_EXC_INDEXERROR, "pop index out of range");
 				return nullptr;
 			}
+			if (!CheckResizable(context, buf))
+				return nullptr;
 
-			return Wg_NewInt(context, (Wg_int)f->tellg());
+			auto& owned = buf->storage->owned;
+			unsigned char value = owned[(size_t)index];
+			owned.erase(owned.begin() + index);
+			buf->length--;
+			return Wg_NewInt(context, value);
 		}
 
-		static Wg_Obj* File_flush(Wg_Context* context, Wg_Obj** argv, int argc) {
+		static Wg_Obj* bytearray_clear(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
-			std::fstream* f{};
-			if (!TryGetUserdata(argv[0], "__File", &f)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+			BufferObject* buf = GetBufferArg(context, argv, 0);
+			if (buf == nullptr || !CheckResizable(context, buf))
 				return nullptr;
-			}
-
-			f->flush();
 
+			buf->storage->owned.clear();
+			buf->length = 0;
 			return Wg_None(context);
 		}
 
-		static Wg_Obj* File_write(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(2);
-			WG_EXPECT_ARG_TYPE_STRING(1);
-			std::fstream* f{};
-			if (!TryGetUserdata(argv[0], "__File", &f)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
-				return nullptr;
-			}
-
-			int len{};
-			const char* s = Wg_GetString(argv[1], &len);
-			f->write(s, (std::streamsize)len);
+		static Wg_Obj* str_encode(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+			WG_EXPECT_ARG_TYPE_STRING(0);
 
-			return Wg_None(context);
+			std::string_view s = GetStringView(argv[0]);
+			if (!CheckEncoding(context, argc == 2 ? argv[1] : nullptr, s))
+				return nullptr;
+			return NewOwnedBuffer(context, BufferObject::Kind::Bytes, s);
 		}
 
-		static Wg_Obj* File_writelines(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(2);
-			if (!Wg_TryGetUserdata(argv[0], "__File", nullptr)) {
-				Wg_RaiseArgumentTypeError(context, 0, "__File");
+		static Wg_Obj* int_to_bytes(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 3);
+			WG_EXPECT_ARG_TYPE_INT(0);
+
+			Wg_Obj* kw[3]{};
+			const char* keys[3] = { "length", "byteorder", "signed" };
+			if (!Wg_ParseKwargs(Wg_GetKwargs(context), keys, 3, kw))
 				return nullptr;
+			for (int i = 1; i < argc; i++)
+				kw[i - 1] = argv[i];
+
+			Wg_int length = 1;
+			if (kw[0]) {
+				if (!Wg_IsInt(kw[0])) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "length must be an int");
+					return nullptr;
+				} else if ((length = Wg_GetInt(kw[0])) < 0) {
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, "length argument must be non-negative");
+					return nullptr;
+				}
 			}
 
-			auto fn = [](Wg_Obj* obj, void* ud) {
-				auto* file = (Wg_Obj*)ud;
-				return Wg_CallMethod(file, "write", &obj, 1) != nullptr;
-			};
+			bool little = false;
+			if (kw[1]) {
+				std::string_view order = Wg_IsString(kw[1]) ? GetStringView(kw[1]) : "";
+				if (order != "big" && order != "little") {
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, "byteorder must be either 'little' or 'big'");
+					return nullptr;
+				}
+				little = order == "little";
+			}
 
-			if (!Wg_Iterate(argv[1], argv[0], fn))
+			bool isSigned = false;
+			if (kw[2]) {
+				Wg_Obj* value = Wg_UnaryOp(WG_UOP_BOOL, kw[2]);
+				if (value == nullptr)
+					return nullptr;
+				isSigned = Wg_GetBool(value);
+			}
+
+			Wg_int value = Wg_GetInt(argv[0]);
+			bool fits = true;
+			if (!isSigned && value < 0) {
+				Wg_RaiseException(context, WG_EXC_OVERFLOWERROR, "can't convert negative int to unsigned");
+				return nullptr;
+			} else if (length == 0) {
+				fits = value == 0;
+			} else if (length < (Wg_int)sizeof(Wg_int)) {
+				Wg_int bits = 8 * length;
+				if (isSigned) {
+					Wg_int limit = (Wg_int)1 << (bits - 1);
+					fits = value >= -limit && value < limit;
+				} else {
+					fits = value < ((Wg_int)1 << bits);
+				}
+			}
+			if (!fits) {
+				Wg_RaiseException(context, WG_EXC_OVERFLOWERROR, "int too big to convert");
 				return nullptr;
+			}
 
-			return Wg_None(context);
-		}
-		
-		static Wg_Obj* self(Wg_Context* context, Wg_Obj** argv, int argc) {
-			WG_EXPECT_ARG_COUNT(1);
-			return argv[0];
+			std::vector<unsigned char> data((size_t)length);
+			for (size_t i = 0; i < data.size(); i++) {
+				unsigned char byte = i < sizeof(Wg_int) ? (unsigned char)((Wg_uint)value >> (8 * i)) : (value < 0 ? 0xFF : 0);
+				data[little ? i : data.size() - 1 - i] = byte;
+			}
+			return NewBuffer(context, OwnedBuffer(BufferObject::Kind::Bytes, std::move(data)));
 		}
 
 	} // namespace methods
@@ -3680,6 +5257,19 @@ class ValueError(Exception):
 			return Wg_GetAttribute(argv[0], name);
 		}
 		
+		static Wg_Obj* hash(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* v = Wg_CallMethod(argv[0], "__hash__", nullptr, 0);
+			if (v == nullptr) {
+				return nullptr;
+			} else if (!Wg_IsInt(v)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "__hash__() returned a non integer type");
+				return nullptr;
+			}
+			return v;
+		}
+
 		static Wg_Obj* id(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
 			return Wg_NewInt(context, (Wg_int)argv[0]);
@@ -3714,6 +5304,30 @@ class ValueError(Exception):
 			return Wg_NewBool(context, ret);
 		}
 
+		static Wg_Obj* len(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* v = Wg_CallMethod(argv[0], "__len__", nullptr, 0);
+			if (v == nullptr) {
+				return nullptr;
+			} else if (!Wg_IsInt(v)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "__len__() returned a non integer type");
+				return nullptr;
+			} else if (Wg_GetInt(v) < 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "__len__() returned a negative value");
+				return nullptr;
+			}
+			return v;
+		}
+
+		static Wg_Obj* max(Wg_Context* context, Wg_Obj** argv, int argc) {
+			return MinMax(context, argv, argc, WG_BOP_GT, "max() arg is an empty sequence");
+		}
+
+		static Wg_Obj* min(Wg_Context* context, Wg_Obj** argv, int argc) {
+			return MinMax(context, argv, argc, WG_BOP_LT, "min() arg is an empty sequence");
+		}
+
 		static Wg_Obj* ord(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT(1);
 			WG_EXPECT_ARG_TYPE_STRING(0);
@@ -3767,6 +5381,19 @@ class ValueError(Exception):
 			return Wg_None(context);
 		}
 
+		static Wg_Obj* repr(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* v = Wg_CallMethod(argv[0], "__repr__", nullptr, 0);
+			if (v == nullptr) {
+				return nullptr;
+			} else if (!Wg_IsString(v)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "__repr__() returned a non string type");
+				return nullptr;
+			}
+			return v;
+		}
+
 		static Wg_Obj* round(Wg_Context* context, Wg_Obj** argv, int argc) {
 			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
 			WG_EXPECT_ARG_TYPE_INT_OR_FLOAT(0);
@@ -3798,6 +5425,145 @@ class ValueError(Exception):
 			return Wg_None(context);
 		}
 
+		static Wg_Obj* sorted(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			// Forwards the key and reverse keyword arguments to list.sort()
+			Wg_Obj* kwargs = Wg_GetKwargs(context);
+			Wg_Obj* li = Wg_Call(context->builtins.list, argv, 1);
+			if (li == nullptr)
+				return nullptr;
+			Wg_ObjRef ref(li);
+
+			if (Wg_CallMethod(li, "sort", nullptr, 0, kwargs) == nullptr)
+				return nullptr;
+			return li;
+		}
+
+		static Wg_Obj* sum(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+
+			Wg_Obj* kwargs = Wg_GetKwargs(context);
+
+			Wg_Obj* kw[1]{};
+			const char* keys[1] = { "start" };
+			if (!Wg_ParseKwargs(kwargs, keys, 1, kw))
+				return nullptr;
+
+			struct State {
+				Wg_Obj* total;
+			} s{};
+			if (argc == 2) {
+				s.total = argv[1];
+			} else if (kw[0]) {
+				s.total = kw[0];
+			} else if ((s.total = Wg_NewInt(context, 0)) == nullptr) {
+				return nullptr;
+			}
+			Wg_IncRef(s.total);
+
+			auto f = [](Wg_Obj* x, void* u) {
+				State* s = (State*)u;
+				Wg_Obj* total = Wg_CallMethod(s->total, "__iadd__", &x, 1);
+				if (total == nullptr)
+					return false;
+				Wg_IncRef(total);
+				Wg_DecRef(s->total);
+				s->total = total;
+				return true;
+			};
+
+			bool success = Wg_Iterate(argv[0], &s, f);
+			Wg_DecRef(s.total);
+			return success ? s.total : nullptr;
+		}
+
+		static Wg_Obj* int_from_bytes(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(1, 2);
+
+			Wg_Obj* kw[2]{};
+			const char* keys[2] = { "byteorder", "signed" };
+			if (!Wg_ParseKwargs(Wg_GetKwargs(context), keys, 2, kw))
+				return nullptr;
+			if (argc == 2)
+				kw[0] = argv[1];
+
+			bool little = false;
+			if (kw[0]) {
+				std::string_view order = Wg_IsString(kw[0]) ? GetStringView(kw[0]) : "";
+				if (order != "big" && order != "little") {
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, "byteorder must be either 'little' or 'big'");
+					return nullptr;
+				}
+				little = order == "little";
+			}
+
+			bool isSigned = false;
+			if (kw[1]) {
+				Wg_Obj* value = Wg_UnaryOp(WG_UOP_BOOL, kw[1]);
+				if (value == nullptr)
+					return nullptr;
+				isSigned = Wg_GetBool(value);
+			}
+
+			std::vector<unsigned char> data;
+			if (!CollectBytes(context, argv[0], data))
+				return nullptr;
+			if (!little)
+				std::reverse(data.begin(), data.end());
+
+			// Only the bytes beyond the size of an int that are not sign extension need to be checked
+			bool negative = isSigned && !data.empty() && (data.back() & 0x80);
+			for (size_t i = sizeof(Wg_int); i < data.size(); i++) {
+				if (data[i] != (negative ? 0xFF : 0)) {
+					Wg_RaiseException(context, WG_EXC_OVERFLOWERROR, "int too big to convert");
+					return nullptr;
+				}
+			}
+
+			Wg_uint value = negative ? ~(Wg_uint)0 : 0;
+			for (size_t i = 0; i < std::min(data.size(), sizeof(Wg_int)); i++) {
+				value &= ~((Wg_uint)0xFF << (8 * i));
+				value |= (Wg_uint)data[i] << (8 * i);
+			}
+			if (!isSigned && data.size() >= sizeof(Wg_int) && (Wg_int)value < 0) {
+				Wg_RaiseException(context, WG_EXC_OVERFLOWERROR, "int too big to convert");
+				return nullptr;
+			}
+			return Wg_NewInt(context, (Wg_int)value);
+		}
+
+		static Wg_Obj* bytes_fromhex(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+			WG_EXPECT_ARG_TYPE_STRING(0);
+
+			auto digit = [](char c) {
+				if (c >= '0' && c <= '9') return c - '0';
+				if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+				if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+				return -1;
+			};
+
+			std::string_view s = GetStringView(argv[0]);
+			std::vector<unsigned char> data;
+			data.reserve(s.size() / 2);
+			for (size_t i = 0; i < s.size(); i++) {
+				if (IsSpace(s[i]))
+					continue;
+				int hi = digit(s[i]);
+				int lo = i + 1 < s.size() ? digit(s[i + 1]) : -1;
+				if (hi < 0 || lo < 0) {
+					std::string msg = "non-hexadecimal number found in fromhex() arg at position "
+						+ std::to_string(hi < 0 ? i : i + 1);
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, msg.c_str());
+					return nullptr;
+				}
+				data.push_back((unsigned char)(hi * 16 + lo));
+				i++;
+			}
+			return NewBuffer(context, OwnedBuffer(BufferObject::Kind::Bytes, std::move(data)));
+		}
+
 	} // namespace lib
 
 	bool ImportBuiltins(Wg_Context* context) {
@@ -3824,10 +5590,10 @@ class ValueError(Exception):
 			b.object = Alloc(context);
 			if (b.object == nullptr)
 				throw LibraryInitException();
-			b.object->type = "__class";
+			b.object->type = ObjType::Class;
 			klass = new Wg_Obj::Class{ std::string("object") };
 			Wg_SetUserdata(b.object, klass);
-			Wg_RegisterFinalizer(b.object, [](void* ud) { delete (Wg_Obj::Class*)ud; }, klass);
+			Wg_RegisterFinalizer(b.object, DeleteUserdata<Wg_Obj::Class>, klass);
 			b.object->Get<Wg_Obj::Class>().instanceAttributes.Set("__class__", b.object);
 			b.object->attributes.AddParent(b.object->Get<Wg_Obj::Class>().instanceAttributes);
 			b.object->Get<Wg_Obj::Class>().userdata = context;
@@ -3838,10 +5604,10 @@ class ValueError(Exception):
 			b.func = Alloc(context);
 			if (b.func == nullptr)
 				throw LibraryInitException();
-			b.func->type = "__class";
+			b.func->type = ObjType::Class;
 			klass = new Wg_Obj::Class{ std::string("function") };
 			Wg_SetUserdata(b.func, klass);
-			Wg_RegisterFinalizer(b.func, [](void* ud) { delete (Wg_Obj::Class*)ud; }, klass);
+			Wg_RegisterFinalizer(b.func, DeleteUserdata<Wg_Obj::Class>, klass);
 			b.func->Get<Wg_Obj::Class>().instanceAttributes.Set("__class__", b.func);
 			b.func->Get<Wg_Obj::Class>().instanceAttributes.AddParent(b.object->Get<Wg_Obj::Class>().instanceAttributes);
 			b.func->attributes.AddParent(b.object->Get<Wg_Obj::Class>().instanceAttributes);
@@ -3853,10 +5619,10 @@ class ValueError(Exception):
 
 			// Create tuple class
 			b.tuple = Alloc(context);
-			b.tuple->type = "__class";
+			b.tuple->type = ObjType::Class;
 			klass = new Wg_Obj::Class{ std::string("tuple") };
 			Wg_SetUserdata(b.tuple, klass);
-			Wg_RegisterFinalizer(b.tuple, [](void* ud) { delete (Wg_Obj::Class*)ud; }, klass);
+			Wg_RegisterFinalizer(b.tuple, DeleteUserdata<Wg_Obj::Class>, klass);
 			b.tuple->Get<Wg_Obj::Class>().instanceAttributes.Set("__class__", b.tuple);
 			b.tuple->Get<Wg_Obj::Class>().instanceAttributes.AddParent(b.object->Get<Wg_Obj::Class>().instanceAttributes);
 			b.tuple->attributes.AddParent(b.object->Get<Wg_Obj::Class>().instanceAttributes);
@@ -3870,6 +5636,7 @@ class ValueError(Exception):
 			RegisterMethod(b.tuple, "__len__", methods::collection_len<Collection::Tuple>);
 			RegisterMethod(b.tuple, "__contains__", methods::collection_contains<Collection::Tuple>);
 			RegisterMethod(b.tuple, "__eq__", methods::collection_eq<Collection::Tuple>);
+			RegisterMethod(b.tuple, "__hash__", methods::tuple_hash);
 			RegisterMethod(b.tuple, "__lt__", methods::collection_lt<Collection::Tuple>);
 			RegisterMethod(b.tuple, "__nonzero__", methods::collection_nonzero<Collection::Tuple>);
 			RegisterMethod(b.tuple, "count", methods::collection_count<Collection::Tuple>);
@@ -3877,17 +5644,17 @@ class ValueError(Exception):
 
 			// Create NoneType class
 			b.noneType = Alloc(context);
-			b.noneType->type = "__class";
+			b.noneType->type = ObjType::Class;
 			klass = new Wg_Obj::Class{ std::string("NoneType") };
 			Wg_SetUserdata(b.noneType, klass);
-			Wg_RegisterFinalizer(b.noneType, [](void* ud) { delete (Wg_Obj::Class*)ud; }, klass);
+			Wg_RegisterFinalizer(b.noneType, DeleteUserdata<Wg_Obj::Class>, klass);
 			b.noneType->attributes.AddParent(b.object->Get<Wg_Obj::Class>().instanceAttributes);
 			b.noneType->Get<Wg_Obj::Class>().userdata = context;
 			b.noneType->Get<Wg_Obj::Class>().ctor = ctors::none;
 
 			// Create None singleton
 			b.none = Alloc(context);
-			b.none->type = "__null";
+			b.none->type = ObjType::Null;
 			Wg_SetAttribute(b.none, "__class__", b.none);
 			b.none->attributes.AddParent(b.object->Get<Wg_Obj::Class>().instanceAttributes);
 			RegisterMethod(b.none, "__nonzero__", methods::null_nonzero);
@@ -3897,6 +5664,7 @@ class ValueError(Exception):
 			Wg_Obj* emptyTuple = Wg_NewTuple(context, nullptr, 0);
 			if (emptyTuple == nullptr)
 				throw LibraryInitException();
+			Wg_ObjRef emptyTupleRef(emptyTuple);
 			Wg_Obj* objectTuple = Wg_NewTuple(context, &b.object, 1);
 			if (objectTuple == nullptr)
 				throw LibraryInitException();
@@ -3945,19 +5713,19 @@ class ValueError(Exception):
 			if (b._false == nullptr)
 				throw LibraryInitException();
 			b._false->attributes = b._bool->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			b._false->type = "__bool";
+			b._false->type = ObjType::Bool;
 			auto falseData = new bool(false);
 			Wg_SetUserdata(b._false, falseData);
-			Wg_RegisterFinalizer(b._false, [](void* ud) { delete (bool*)ud; }, falseData);
+			Wg_RegisterFinalizer(b._false, DeleteUserdata<bool>, falseData);
 
 			b._true = Alloc(context);
 			if (b._true == nullptr)
 				throw LibraryInitException();
 			b._true->attributes = b._bool->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			b._true->type = "__bool";
+			b._true->type = ObjType::Bool;
 			auto trueData = new bool(true);
 			Wg_SetUserdata(b._true, trueData);
-			Wg_RegisterFinalizer(b._true, [](void* ud) { delete (bool*)ud; }, trueData);
+			Wg_RegisterFinalizer(b._true, DeleteUserdata<bool>, trueData);
 
 			b._int = createClass("int");
 			RegisterMethod(b._int, "__init__", ctors::_int);
@@ -3986,6 +5754,7 @@ class ValueError(Exception):
 			RegisterMethod(b._int, "__abs__", methods::int_abs);
 			RegisterMethod(b._int, "bit_length", methods::int_bit_length);
 			RegisterMethod(b._int, "bit_count", methods::int_bit_count);
+			RegisterMethod(b._int, "to_bytes", methods::int_to_bytes);
 
 			b._float = createClass("float");
 			RegisterMethod(b._float, "__init__", ctors::_float);
@@ -4056,6 +5825,7 @@ class ValueError(Exception):
 			RegisterMethod(b.str, "splitlines", methods::str_splitlines);
 			RegisterMethod(b.str, "strip", methods::str_strip);
 			RegisterMethod(b.str, "zfill", methods::str_zfill);
+			RegisterMethod(b.str, "encode", methods::str_encode);
 
 			b.list = createClass("list");
 			RegisterMethod(b.list, "__init__", ctors::list);
@@ -4142,9 +5912,40 @@ class ValueError(Exception):
 			RegisterMethod(b.setIter, "__next__", methods::SetIter_next);
 			RegisterMethod(b.setIter, "__iter__", methods::self);
 
+			b.range = createClass("range");
+			RegisterMethod(b.range, "__init__", ctors::Range);
+			RegisterMethod(b.range, "__iter__", methods::Range_iter);
+			RegisterMethod(b.range, "__reversed__", methods::Range_reversed);
+
+			b.rangeIter = createClass("__RangeIter", nullptr, false);
+			RegisterMethod(b.rangeIter, "__init__", ctors::RangeIter);
+			RegisterMethod(b.rangeIter, "__next__", methods::RangeIter_next);
+			RegisterMethod(b.rangeIter, "__iter__", methods::self);
+
+			Wg_Obj* enumerate = createClass("enumerate");
+			RegisterMethod(enumerate, "__init__", ctors::Enumerate);
+			RegisterMethod(enumerate, "__next__", methods::Enumerate_next);
+			RegisterMethod(enumerate, "__iter__", methods::self);
+
+			Wg_Obj* filter = createClass("filter");
+			RegisterMethod(filter, "__init__", ctors::MapOrFilter);
+			RegisterMethod(filter, "__next__", methods::Filter_next);
+			RegisterMethod(filter, "__iter__", methods::self);
+
+			Wg_Obj* map = createClass("map");
+			RegisterMethod(map, "__init__", ctors::MapOrFilter);
+			RegisterMethod(map, "__next__", methods::Map_next);
+			RegisterMethod(map, "__iter__", methods::self);
+
+			Wg_Obj* zip = createClass("zip");
+			RegisterMethod(zip, "__init__", ctors::Zip);
+			RegisterMethod(zip, "__next__", methods::Zip_next);
+			RegisterMethod(zip, "__iter__", methods::self);
+
 			b.file = createClass("__File", nullptr, false);
 			RegisterMethod(b.file, "__init__", ctors::File);
-			RegisterMethod(b.file, "__iter__", methods::File_iter);
+			RegisterMethod(b.file, "__iter__", methods::self);
+			RegisterMethod(b.file, "__next__", methods::File_next);
 			RegisterMethod(b.file, "__enter__", methods::self);
 			RegisterMethod(b.file, "__exit__", methods::File_exit);
 			RegisterMethod(b.file, "close", methods::File_close);
@@ -4158,9 +5959,75 @@ class ValueError(Exception):
 			RegisterMethod(b.file, "seekable", methods::File_seekable);
 			RegisterMethod(b.file, "seek", methods::File_seek);
 			RegisterMethod(b.file, "tell", methods::File_tell);
+			RegisterMethod(b.file, "flush", methods::File_flush);
 			if (context->config.enableOSAccess)
 				Wg_SetGlobal(context, "open", b.file);
 
+			auto registerBufferMethods = [&](Wg_Obj* klass) {
+				RegisterMethod(klass, "__len__", methods::buffer_len);
+				RegisterMethod(klass, "__nonzero__", methods::buffer_nonzero);
+				RegisterMethod(klass, "__str__", methods::buffer_str);
+				RegisterMethod(klass, "__hash__", methods::buffer_hash);
+				RegisterMethod(klass, "__eq__", methods::buffer_eq);
+				RegisterMethod(klass, "__getitem__", methods::buffer_getitem);
+				RegisterMethod(klass, "__contains__", methods::buffer_contains);
+				RegisterMethod(klass, "hex", methods::buffer_hex);
+				if (klass == b.memoryview)
+					return;
+				RegisterMethod(klass, "__lt__", methods::buffer_lt);
+				RegisterMethod(klass, "__add__", methods::buffer_add);
+				RegisterMethod(klass, "__mul__", methods::buffer_mul);
+				RegisterMethod(klass, "count", methods::buffer_count);
+				RegisterMethod(klass, "decode", methods::buffer_decode);
+				RegisterMethod(klass, "endswith", methods::buffer_startswith<true>);
+				RegisterMethod(klass, "find", methods::buffer_findx<false>);
+				RegisterMethod(klass, "index", methods::buffer_indexx<false>);
+				RegisterMethod(klass, "rfind", methods::buffer_findx<true>);
+				RegisterMethod(klass, "rindex", methods::buffer_indexx<true>);
+				RegisterMethod(klass, "startswith", methods::buffer_startswith<false>);
+			};
+
+			b.bytes = createClass("bytes");
+			RegisterMethod(b.bytes, "__init__", ctors::buffer<BufferObject::Kind::Bytes>);
+			registerBufferMethods(b.bytes);
+
+			b.bytearray = createClass("bytearray");
+			RegisterMethod(b.bytearray, "__init__", ctors::buffer<BufferObject::Kind::ByteArray>);
+			registerBufferMethods(b.bytearray);
+			RegisterMethod(b.bytearray, "__setitem__", methods::buffer_setitem);
+			RegisterMethod(b.bytearray, "append", methods::bytearray_append);
+			RegisterMethod(b.bytearray, "clear", methods::bytearray_clear);
+			RegisterMethod(b.bytearray, "extend", methods::bytearray_extend);
+			RegisterMethod(b.bytearray, "pop", methods::bytearray_pop);
+
+			b.memoryview = createClass("memoryview");
+			RegisterMethod(b.memoryview, "__init__", ctors::memoryview);
+			registerBufferMethods(b.memoryview);
+			RegisterMethod(b.memoryview, "__setitem__", methods::buffer_setitem);
+			RegisterMethod(b.memoryview, "__enter__", methods::self);
+			RegisterMethod(b.memoryview, "__exit__", methods::memoryview_release);
+			RegisterMethod(b.memoryview, "release", methods::memoryview_release);
+			RegisterMethod(b.memoryview, "tobytes", methods::memoryview_tobytes);
+			RegisterMethod(b.memoryview, "tolist", methods::memoryview_tolist);
+
+			b.generator = createClass("generator", nullptr, false);
+			RegisterMethod(b.generator, "__str__", methods::generator_str);
+			RegisterMethod(b.generator, "__iter__", methods::self);
+			RegisterMethod(b.generator, "__next__", methods::generator_send);
+			RegisterMethod(b.generator, "send", methods::generator_send);
+			RegisterMethod(b.generator, "throw", methods::generator_throw);
+			RegisterMethod(b.generator, "close", methods::generator_close);
+
+			// Class level functions
+			auto addClassFunction = [&](Wg_Obj* klass, const char* name, Wg_Function fptr) {
+				Wg_Obj* fn = Wg_NewFunction(context, fptr, nullptr, name);
+				if (fn == nullptr)
+					throw LibraryInitException();
+				Wg_SetAttribute(klass, name, fn);
+			};
+			addClassFunction(b._int, "from_bytes", lib::int_from_bytes);
+			addClassFunction(b.bytes, "fromhex", lib::bytes_fromhex);
+
 			// Add native free functions
 			b.isinstance = RegisterFunction(context, "isinstance", lib::isinstance);
 			RegisterFunction(context, "bin", lib::base_str<2>);
@@ -4172,13 +6039,20 @@ class ValueError(Exception):
 			RegisterFunction(context, "eval", lib::eval);
 			RegisterFunction(context, "exec", lib::exec);
 			RegisterFunction(context, "getattr", lib::getattr);
+			b.hash = RegisterFunction(context, "hash", lib::hash);
 			RegisterFunction(context, "id", lib::id);
 			RegisterFunction(context, "input", lib::input);
+			b.len = RegisterFunction(context, "len", lib::len);
+			RegisterFunction(context, "max", lib::max);
+			RegisterFunction(context, "min", lib::min);
 			RegisterFunction(context, "ord", lib::ord);
 			RegisterFunction(context, "pow", lib::pow);
 			RegisterFunction(context, "print", lib::print);
+			b.repr = RegisterFunction(context, "repr", lib::repr);
 			RegisterFunction(context, "round", lib::round);
 			RegisterFunction(context, "setattr", lib::setattr);
+			RegisterFunction(context, "sorted", lib::sorted);
+			RegisterFunction(context, "sum", lib::sum);
 			RegisterFunction(context, "exit", lib::exit);
 			RegisterFunction(context, "quit", lib::exit);
 			
@@ -4186,15 +6060,11 @@ class ValueError(Exception):
 			if (Execute(context, BUILTINS_CODE, "__builtins__") == nullptr)
 				throw LibraryInitException();
 
-			b.len = getGlobal("len");
-			b.repr = getGlobal("repr");
-			b.hash = getGlobal("hash");
 			b.slice = getGlobal("slice");
 			b.defaultIter = getGlobal("__DefaultIter");
 			b.defaultReverseIter = getGlobal("__DefaultReverseIter");
 			b.codeObject = getGlobal("__CodeObject");
 			b.moduleObject = createClass("ModuleObject", nullptr, false);
-			b.readlineIter = getGlobal("__ReadLineIter");
 			
 			b.baseException = getGlobal("BaseException");
 			b.wingsTimeoutError = getGlobal("WingsTimeoutError");
@@ -4219,6 +6089,7 @@ class ValueError(Exception):
 			b.recursionError = getGlobal("RecursionError");
 			b.typeError = getGlobal("TypeError");
 			b.valueError = getGlobal("ValueError");
+			b.bufferError = getGlobal("BufferError");
 
 			b.memoryErrorInstance = Wg_Call(b.memoryError, nullptr, 0);
 			if (b.memoryErrorInstance == nullptr)
@@ -4227,6 +6098,10 @@ class ValueError(Exception):
 			b.recursionErrorInstance = Wg_Call(b.recursionError, nullptr, 0);
 			if (b.recursionErrorInstance == nullptr)
 				throw LibraryInitException();
+
+			b.pending = Wg_Call(b.object, nullptr, 0);
+			if (b.pending == nullptr)
+				throw LibraryInitException();
 			
 		} catch (LibraryInitException&) {
 			std::abort(); // Internal error
@@ -2,9 +2,14 @@
 #include "lex.h"
 #include "parse.h"
 #include "executor.h"
+#include "profiler.h"
 
 #include <algorithm>
 #include <unordered_set>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
 
 namespace wings {
 
@@ -25,19 +30,218 @@ namespace wings {
 			}
 		}
 
+		if (!ChargeBytes(context, sizeof(Wg_Obj)))
+			return nullptr;
+
 		// Check if GC should run
+		size_t nurserySize = (size_t)context->config.gcNurserySize;
+		if (nurserySize && context->mem.size() - context->promotedCount >= nurserySize) {
+			CollectNursery(context);
+		}
+
 		size_t threshold = (size_t)((double)context->config.gcRunFactor * context->lastObjectCountAfterGC);
 		if (context->mem.size() >= threshold) {
 			Wg_CollectGarbage(context);
 		}
 
+		context->gcStats.allocations++;
+		if (context->profiler)
+			context->profiler->CountAllocation();
+
 		// Allocate new object
-		auto obj = std::make_unique<Wg_Obj>();
+		Wg_Obj* obj = context->pool.Allocate();
 		obj->context = context;
+		context->mem.push_back(obj);
+		return obj;
+	}
+
+	bool CheckBytes(Wg_Context* context, size_t bytes) {
+		size_t limit = (size_t)context->config.maxBytes;
+		if (limit == 0)
+			return true;
+
+		const auto& stats = context->gcStats;
+		auto fits = [&] {
+			size_t used = stats.bytesAfterCollection + stats.bytesSinceCollection;
+			return used <= limit && bytes <= limit - used;
+		};
+		if (fits())
+			return true;
+
+		// The estimate may include freed objects so measure it again
+		Wg_CollectGarbage(context);
+		if (fits())
+			return true;
+
+		Wg_RaiseException(context, WG_EXC_MEMORYERROR);
+		return false;
+	}
+
+	void CountBytes(Wg_Context* context, size_t bytes) {
+		context->gcStats.bytesAllocated += bytes;
+		context->gcStats.bytesSinceCollection += bytes;
+	}
+
+	bool ChargeBytes(Wg_Context* context, size_t bytes) {
+		if (!CheckBytes(context, bytes))
+			return false;
+		CountBytes(context, bytes);
+		return true;
+	}
+
+	size_t ObjectBytes(const Wg_Obj* obj) {
+		size_t bytes = sizeof(Wg_Obj)
+			+ obj->attributes.MemoryUsage()
+			+ obj->finalizers.capacity() * sizeof(obj->finalizers[0])
+			+ obj->userdataSize;
+		if (obj->data == nullptr)
+			return bytes;
+
+		switch (obj->type) {
+		case ObjType::Str:
+			if (obj->HoldsInline<StrSlice>()) {
+				bytes += obj->Get<StrSlice>().length;
+			} else {
+				// Short strings are stored within the std::string itself
+				const auto& s = obj->Get<std::string>();
+				const char* inside = (const char*)&s;
+				if (s.data() < inside || s.data() >= inside + sizeof(s))
+					bytes += s.capacity() + 1;
+			}
+			break;
+		case ObjType::Tuple:
+		case ObjType::List:
+			bytes += obj->Get<std::vector<Wg_Obj*>>().capacity() * sizeof(Wg_Obj*);
+			break;
+		case ObjType::Map:
+			bytes += obj->Get<WDict>().memory_usage();
+			break;
+		case ObjType::Set:
+			bytes += obj->Get<WSet>().memory_usage();
+			break;
+		case ObjType::Func: {
+			const auto& fn = obj->Get<Wg_Obj::Func>();
+			bytes += sizeof(fn) + fn.module.capacity() + fn.prettyName.capacity();
+			break;
+		}
+		case ObjType::Class: {
+			const auto& klass = obj->Get<Wg_Obj::Class>();
+			bytes += sizeof(klass)
+				+ klass.name.capacity()
+				+ klass.bases.capacity() * sizeof(Wg_Obj*)
+				+ klass.instanceAttributes.MemoryUsage();
+			break;
+		}
+		default:
+			if (const BufferObject* buf = GetBuffer(obj)) {
+				// Storage shared between buffers is divided between them
+				bytes += sizeof(*buf);
+				if (buf->storage && !buf->storage->borrowed)
+					bytes += buf->storage->owned.capacity() / (size_t)buf->storage.use_count();
+			}
+			break;
+		}
+		return bytes;
+	}
+
+	Wg_Obj* ObjectPool::Allocate() {
+		if (freeList == nullptr) {
+			pages.push_back(std::make_unique<Slot[]>(PAGE_SIZE));
+			Slot* page = pages.back().get();
+			for (size_t i = 0; i < PAGE_SIZE; i++)
+				page[i].next = i + 1 < PAGE_SIZE ? &page[i + 1] : nullptr;
+			freeList = page;
+		}
+
+		Slot* slot = freeList;
+		freeList = slot->next;
+		return new (slot->storage) Wg_Obj();
+	}
+
+	void ObjectPool::Free(Wg_Obj* obj) {
+		obj->~Wg_Obj();
+		Slot* slot = (Slot*)obj;
+		slot->next = freeList;
+		freeList = slot;
+	}
+
+	Wg_Obj** ArgumentStack::Push(size_t count) {
+		if (blocks.empty())
+			blocks.push_back({ std::make_unique<Wg_Obj*[]>(BLOCK_SIZE), BLOCK_SIZE, 0 });
+
+		if (blocks[current].size + count > blocks[current].capacity) {
+			// The blocks after the current one are empty so a small one can be replaced
+			current++;
+			if (current == blocks.size() || blocks[current].capacity < count) {
+				size_t capacity = std::max(BLOCK_SIZE, count);
+				Block block{ std::make_unique<Wg_Obj*[]>(capacity), capacity, 0 };
+				if (current == blocks.size()) {
+					blocks.push_back(std::move(block));
+				} else {
+					blocks[current] = std::move(block);
+				}
+			}
+		}
+
+		Block& block = blocks[current];
+		Wg_Obj** values = block.data.get() + block.size;
+		block.size += count;
+		return values;
+	}
+
+	void ArgumentStack::Pop(Mark mark) {
+		for (size_t i = mark.block + 1; i <= current && i < blocks.size(); i++)
+			blocks[i].size = 0;
+		current = mark.block;
+		if (!blocks.empty())
+			blocks[current].size = mark.size;
+	}
 
-		auto p = obj.get();
-		context->mem.push_back(std::move(obj));
-		return p;
+	void DecRefUserdata(void* userdata) {
+		Wg_DecRef((Wg_Obj*)userdata);
+	}
+
+	GCPauseTimer::GCPauseTimer(Wg_Context* context, bool young) :
+		context(context),
+		young(young),
+		start(std::chrono::steady_clock::now())
+	{
+	}
+
+	GCPauseTimer::~GCPauseTimer() {
+		auto pause = std::chrono::steady_clock::now() - start;
+		auto& stats = context->gcStats;
+		stats.collections++;
+		if (young)
+			stats.youngCollections++;
+		stats.pauseTime += pause;
+		stats.maxPause = std::max(stats.maxPause, pause);
+		stats.lastPause = pause;
+
+		auto us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(pause).count();
+		size_t bucket = 0;
+		while (us && bucket < GC_PAUSE_BUCKETS - 1) {
+			us >>= 1;
+			bucket++;
+		}
+		stats.pauseHistogram[bucket]++;
+
+		if (context->gcCallback && !context->closing)
+			context->gcCallback(context, context->gcCallbackUserdata);
+	}
+
+	void WriteBarrier(Wg_Obj* obj) {
+		if (obj->promoted && !obj->remembered) {
+			obj->remembered = true;
+			obj->context->rememberedSet.push_back(obj);
+		}
+	}
+
+	void CellWriteBarrier(Wg_Obj* value) {
+		if (!value->promoted && !value->remembered && value->context->config.gcNurserySize) {
+			value->remembered = true;
+			value->context->rememberedSet.push_back(value);
+		}
 	}
 
 	void CallErrorCallback(const char* message) {
@@ -78,13 +282,46 @@ namespace wings {
 			return "function";
 		} else if (Wg_IsClass(obj)) {
 			return "class";
-		} else if (obj->type == "__object") {
+		} else if (obj->type == ObjType::Object) {
 			return "object";
 		} else {
-			return obj->type;
+			return obj->context->types.Name(obj->type);
 		}
 	}
 
+	TypeTable::TypeTable() {
+		static const char* const BUILTIN_NAMES[] = {
+			"", "__null", "__bool", "__int", "__float", "__str", "__tuple",
+			"__list", "__map", "__set", "__func", "__class", "__object", "__foriter",
+			"__generator",
+		};
+		static_assert(std::size(BUILTIN_NAMES) == (size_t)ObjType::BuiltinCount);
+
+		for (const char* name : BUILTIN_NAMES)
+			Intern(name);
+	}
+
+	ObjType TypeTable::Intern(std::string_view name) {
+		if (auto type = Find(name))
+			return type.value();
+
+		auto type = (ObjType)names.size();
+		names.emplace_back(name);
+		ids.insert({ names.back(), type });
+		return type;
+	}
+
+	std::optional<ObjType> TypeTable::Find(std::string_view name) const {
+		auto it = ids.find(name);
+		if (it == ids.end())
+			return std::nullopt;
+		return it->second;
+	}
+
+	const std::string& TypeTable::Name(ObjType type) const {
+		return names[(size_t)type];
+	}
+
 	std::string CodeError::ToString() const {
 		if (good) {
 			return "Success";
@@ -111,13 +348,137 @@ namespace wings {
 		};
 	}
 
+	bool IsUnmodifiedInstance(const Wg_Obj* obj, const Wg_Obj* klass) {
+		return obj->attributes.IsUnmodifiedCopyOf(klass->Get<Wg_Obj::Class>().instanceAttributes);
+	}
+
+	BufferObject* GetBuffer(const Wg_Obj* obj) {
+		// Type names can be reused by other classes, so the userdata
+		// is identified by its finalizer instead.
+		if (obj->data == nullptr || obj->type < ObjType::BuiltinCount)
+			return nullptr;
+		for (const auto& [finalizer, userdata] : obj->finalizers)
+			if (finalizer == &DeleteUserdata<BufferObject> && userdata == obj->data)
+				return (BufferObject*)userdata;
+		return nullptr;
+	}
+
+	Wg_Obj* NewBuffer(Wg_Context* context, BufferObject buffer) {
+		const auto& b = context->builtins;
+		Wg_Obj* klass{};
+		switch (buffer.kind) {
+		case BufferObject::Kind::Bytes: klass = b.bytes; break;
+		case BufferObject::Kind::ByteArray: klass = b.bytearray; break;
+		case BufferObject::Kind::MemoryView: klass = b.memoryview; break;
+		case BufferObject::Kind::Array:
+			// Only the array module creates arrays, so a copy made elsewhere is bytes
+			klass = b.bytes;
+			buffer.kind = BufferObject::Kind::Bytes;
+			buffer.readonly = true;
+			break;
+		}
+
+		// Slices share the storage, which was already counted
+		const auto& storage = buffer.storage;
+		if (storage && !storage->borrowed && storage.use_count() == 1) {
+			if (!ChargeBytes(context, storage->owned.capacity()))
+				return nullptr;
+		}
+
+		Wg_Obj* obj = Alloc(context);
+		if (obj == nullptr)
+			return nullptr;
+
+		auto& cls = klass->Get<Wg_Obj::Class>();
+		obj->attributes = cls.instanceAttributes.Copy();
+		obj->type = cls.instanceType;
+		auto* data = new BufferObject(std::move(buffer));
+		Wg_SetUserdata(obj, data);
+		Wg_RegisterFinalizer(obj, DeleteUserdata<BufferObject>, data);
+		if (data->kind == BufferObject::Kind::MemoryView)
+			Wg_SetAttribute(obj, "readonly", Wg_NewBool(context, data->readonly));
+		return obj;
+	}
+
+	bool CheckResizable(Wg_Context* context, const BufferObject* buf) {
+		// Views that are no longer referenced keep the storage until they are collected
+		if (buf->storage.use_count() > 1)
+			Wg_CollectGarbage(context);
+		if (buf->storage.use_count() > 1 || buf->storage->borrowed) {
+			Wg_RaiseExceptionClass(context->builtins.bufferError, "Existing exports of data: object cannot be re-sized");
+			return false;
+		}
+		return true;
+	}
+
+	// Computes the same value as hash() for a str, int, float, bool, None,
+	// or tuple of those without calling __hash__, if it has not been overridden.
+	static std::optional<size_t> FastHash(const Wg_Obj* obj) {
+		const auto& b = obj->context->builtins;
+		switch (obj->type) {
+		case ObjType::Str:
+			if (!IsUnmodifiedInstance(obj, b.str))
+				return std::nullopt;
+			if (!obj->hasCachedHash) {
+				obj->cachedHash = (size_t)(Wg_int)std::hash<std::string_view>()(GetStringView(obj));
+				obj->hasCachedHash = true;
+			}
+			return obj->cachedHash;
+		case ObjType::Int:
+			if (!IsUnmodifiedInstance(obj, b._int))
+				return std::nullopt;
+			return (size_t)Wg_GetInt(obj);
+		case ObjType::Float:
+			if (!IsUnmodifiedInstance(obj, b._float))
+				return std::nullopt;
+			return (size_t)(Wg_int)std::hash<Wg_float>()(Wg_GetFloat(obj));
+		case ObjType::Bool:
+			if (!IsUnmodifiedInstance(obj, b._bool))
+				return std::nullopt;
+			return (size_t)(Wg_int)std::hash<bool>()(Wg_GetBool(obj));
+		case ObjType::Null:
+			if (!IsUnmodifiedInstance(obj, b.noneType))
+				return std::nullopt;
+			return (size_t)(Wg_int)std::hash<const Wg_Obj*>()(obj);
+		case ObjType::Tuple: {
+			if (!IsUnmodifiedInstance(obj, b.tuple))
+				return std::nullopt;
+			size_t hash = 0;
+			for (const Wg_Obj* v : obj->Get<std::vector<Wg_Obj*>>()) {
+				auto h = FastHash(v);
+				if (!h.has_value())
+					return std::nullopt;
+				hash = CombineHash(hash, h.value());
+			}
+			return hash;
+		}
+		default:
+			return std::nullopt;
+		}
+	}
+
 	size_t WObjHasher::operator()(Wg_Obj* obj) const {
+		if (auto hash = FastHash(obj))
+			return hash.value();
 		if (Wg_Obj* hash = Wg_UnaryOp(WG_UOP_HASH, obj))
 			return (size_t)Wg_GetInt(hash);
 		throw HashException();
 	}
 
 	bool WObjComparer::operator()(Wg_Obj* lhs, Wg_Obj* rhs) const {
+		// Strings are the most common keys, so compare them without going through Wg_BinaryOp()
+		if (lhs->type == ObjType::Str && rhs->type == ObjType::Str
+			&& IsUnmodifiedInstance(lhs, lhs->context->builtins.str)) {
+			if (lhs == rhs)
+				return true;
+			// There is only one interned string with each value
+			if (lhs->interned && rhs->interned)
+				return false;
+			if (lhs->hasCachedHash && rhs->hasCachedHash && lhs->cachedHash != rhs->cachedHash)
+				return false;
+			return GetStringView(lhs) == GetStringView(rhs);
+		}
+
 		if (Wg_Obj* eq = Wg_BinaryOp(WG_BOP_EQ, lhs, rhs))
 			return Wg_GetBool(eq);
 		throw HashException();
@@ -181,50 +542,190 @@ namespace wings {
 	void AddAttributeToClass(Wg_Obj* klass, const char* attribute, Wg_Obj* value) {
 		WG_ASSERT_VOID(klass && attribute && value && Wg_IsClass(klass) && IsValidIdentifier(attribute));
 		klass->Get<Wg_Obj::Class>().instanceAttributes.Set(attribute, value);
+		WriteBarrier(klass);
 	}
 
-	Wg_Obj* Compile(Wg_Context* context, const char* code, const char* module, const char* prettyName, bool expr) {
-		WG_ASSERT(context && code);
+	// Whether an object is a builtin int, float or str whose methods have not been
+	// overridden, so that its operators can be evaluated without a method call.
+	bool IsPlainBuiltin(const Wg_Obj* obj) {
+		const auto& b = obj->context->builtins;
+		const Wg_Obj* klass = nullptr;
+		switch (obj->type) {
+		case ObjType::Int: klass = b._int; break;
+		case ObjType::Float: klass = b._float; break;
+		case ObjType::Str: klass = b.str; break;
+		default: return false;
+		}
+		return IsUnmodifiedInstance(obj, klass);
+	}
 
-		if (prettyName == nullptr)
-			prettyName = DEFAULT_FUNC_NAME;
+	static Wg_Obj* FastEq(Wg_Context* context, Wg_Obj* lhs, Wg_Obj* rhs) {
+		if (Wg_IsString(lhs)) {
+			if (lhs == rhs || (lhs->interned && rhs->interned))
+				return Wg_NewBool(context, lhs == rhs);
+			return Wg_NewBool(context, Wg_IsString(rhs) && GetStringView(lhs) == GetStringView(rhs));
+		} else if (Wg_IsInt(lhs)) {
+			return Wg_NewBool(context, Wg_IsInt(rhs) && Wg_GetInt(lhs) == Wg_GetInt(rhs));
+		} else {
+			return Wg_NewBool(context, Wg_IsIntOrFloat(rhs) && Wg_GetFloat(lhs) == Wg_GetFloat(rhs));
+		}
+	}
 
-		auto lexResult = Lex(code);
-		auto originalSource = MakeRcPtr<std::vector<std::string>>(lexResult.originalSource);
+	static std::optional<bool> FastLt(Wg_Obj* lhs, Wg_Obj* rhs) {
+		if (Wg_IsString(lhs) && Wg_IsString(rhs)) {
+			return GetStringView(lhs) < GetStringView(rhs);
+		} else if (Wg_IsIntOrFloat(lhs) && Wg_IsIntOrFloat(rhs)) {
+			return Wg_GetFloat(lhs) < Wg_GetFloat(rhs);
+		} else {
+			return std::nullopt;
+		}
+	}
 
-		auto raiseException = [&](const CodeError& error) {
-			std::string_view lineText;
-			if (error.srcPos.line < originalSource->size()) {
-				lineText = (*originalSource)[error.srcPos.line];
+	static Wg_Obj* FastNumericOp(Wg_Context* context, Wg_BinOp op, Wg_Obj* lhs, Wg_Obj* rhs, bool& handled) {
+		bool ints = Wg_IsInt(lhs) && Wg_IsInt(rhs);
+		Wg_float l = Wg_GetFloat(lhs);
+		Wg_float r = Wg_GetFloat(rhs);
+
+		switch (op) {
+		case WG_BOP_ADD:
+			return ints ? Wg_NewInt(context, WrappingAdd(Wg_GetInt(lhs), Wg_GetInt(rhs))) : Wg_NewFloat(context, l + r);
+		case WG_BOP_SUB:
+			return ints ? Wg_NewInt(context, WrappingSub(Wg_GetInt(lhs), Wg_GetInt(rhs))) : Wg_NewFloat(context, l - r);
+		case WG_BOP_MUL:
+			return ints ? Wg_NewInt(context, WrappingMul(Wg_GetInt(lhs), Wg_GetInt(rhs))) : Wg_NewFloat(context, l * r);
+		case WG_BOP_DIV:
+		case WG_BOP_FLOORDIV:
+		case WG_BOP_MOD:
+			if (Wg_IsInt(lhs) && r == 0) {
+				Wg_RaiseException(context, WG_EXC_ZERODIVISIONERROR);
+				return nullptr;
 			}
-			context->currentTrace.push_back(TraceFrame{
-				error.srcPos,
-				lineText,
-				module,
-				prettyName,
-				true
-				});
 
-			Wg_RaiseException(context, WG_EXC_SYNTAXERROR, error.message.c_str());
+			if (op == WG_BOP_DIV) {
+				return Wg_NewFloat(context, l / r);
+			} else if (op == WG_BOP_FLOORDIV) {
+				return ints ? Wg_NewInt(context, FloorDiv(Wg_GetInt(lhs), Wg_GetInt(rhs))) : Wg_NewFloat(context, std::floor(l / r));
+			} else if (ints) {
+				return Wg_NewInt(context, FloorMod(Wg_GetInt(lhs), Wg_GetInt(rhs)));
+			} else {
+				return Wg_NewFloat(context, std::fmod(l, r));
+			}
+		case WG_BOP_POW:
+			return ints ? Wg_NewInt(context, (Wg_int)std::pow(l, r)) : Wg_NewFloat(context, std::pow(l, r));
+		case WG_BOP_BITAND:
+		case WG_BOP_BITOR:
+		case WG_BOP_BITXOR:
+		case WG_BOP_SHL:
+		case WG_BOP_SHR: {
+			if (!ints)
+				break;
+
+			Wg_int a = Wg_GetInt(lhs);
+			Wg_int b = Wg_GetInt(rhs);
+			if (op == WG_BOP_BITAND) {
+				return Wg_NewInt(context, a & b);
+			} else if (op == WG_BOP_BITOR) {
+				return Wg_NewInt(context, a | b);
+			} else if (op == WG_BOP_BITXOR) {
+				return Wg_NewInt(context, a ^ b);
+			}
 
-			context->currentTrace.pop_back();
-		};
+			if (b < 0) {
+				Wg_RaiseException(context, WG_EXC_VALUEERROR, "Shift cannot be negative");
+				return nullptr;
+			}
+			b = std::min(b, (Wg_int)sizeof(Wg_int) * 8);
+			if (op == WG_BOP_SHL) {
+				return Wg_NewInt(context, a << b);
+			} else {
+				Wg_uint shifted = (Wg_uint)a >> b;
+				Wg_int i{};
+				std::memcpy(&i, &shifted, sizeof(Wg_int));
+				return Wg_NewInt(context, i);
+			}
+		}
+		default:
+			break;
+		}
+
+		handled = false;
+		return nullptr;
+	}
+
+	bool TryFastBinaryOp(Wg_BinOp op, Wg_Obj* lhs, Wg_Obj* rhs, Wg_Obj** result) {
+		if (!IsPlainBuiltin(lhs) || !IsPlainBuiltin(rhs))
+			return false;
 
+		Wg_Context* context = lhs->context;
+		bool numeric = Wg_IsIntOrFloat(lhs) && Wg_IsIntOrFloat(rhs);
+
+		// Comparisons mirror the object_* fallbacks, which are defined in terms of __eq__ and __lt__
+		switch (op) {
+		case WG_BOP_EQ:
+			*result = FastEq(context, lhs, rhs);
+			return true;
+		case WG_BOP_NE: {
+			Wg_Obj* eq = FastEq(context, lhs, rhs);
+			*result = eq ? Wg_NewBool(context, !Wg_GetBool(eq)) : nullptr;
+			return true;
+		}
+		case WG_BOP_LT:
+		case WG_BOP_LE:
+		case WG_BOP_GT:
+		case WG_BOP_GE: {
+			auto lt = FastLt(lhs, rhs);
+			if (!lt.has_value())
+				return false;
+
+			if (op == WG_BOP_LT) {
+				*result = Wg_NewBool(context, lt.value());
+			} else if (op == WG_BOP_GE) {
+				*result = Wg_NewBool(context, !lt.value());
+			} else if (lt.value()) {
+				*result = Wg_NewBool(context, op == WG_BOP_LE);
+			} else {
+				Wg_Obj* eq = FastEq(context, lhs, rhs);
+				*result = eq && op == WG_BOP_GT ? Wg_NewBool(context, !Wg_GetBool(eq)) : eq;
+			}
+			return true;
+		}
+		case WG_BOP_ADD:
+			if (Wg_IsString(lhs) && Wg_IsString(rhs)) {
+				*result = ConcatStrings(context, lhs, GetStringView(rhs));
+				return true;
+			}
+			break;
+		default:
+			break;
+		}
+
+		if (!numeric)
+			return false;
+
+		bool handled = true;
+		*result = FastNumericOp(context, op, lhs, rhs, handled);
+		return handled;
+	}
+
+	RcPtr<Bytecode> CompileSource(const RcPtr<SourceText>& source, bool expr, int optimizationLevel, CodeError& error) {
+		WG_ASSERT(source);
+
+		auto lexResult = Lex(source);
 		if (lexResult.error) {
-			raiseException(lexResult.error);
+			error = std::move(lexResult.error);
 			return nullptr;
 		}
 
 		auto parseResult = Parse(lexResult.lexTree);
 		if (parseResult.error) {
-			raiseException(parseResult.error);
+			error = std::move(parseResult.error);
 			return nullptr;
 		}
 
 		if (expr) {
-			std::vector<Statement> body = std::move(parseResult.parseTree.expr.def.body);
+			std::vector<Statement> body = std::move(parseResult.parseTree.expr.def->body);
 			if (body.size() != 1 || !std::holds_alternative<stat::Expr>(body[0].data)) {
-				raiseException(CodeError::Bad("Invalid syntax"));
+				error = CodeError::Bad("Invalid syntax");
 				return nullptr;
 			}
 
@@ -234,17 +735,55 @@ namespace wings {
 			stat.srcPos = body[0].srcPos;
 			stat.data = std::move(ret);
 
-			parseResult.parseTree.expr.def.body.clear();
-			parseResult.parseTree.expr.def.body.push_back(std::move(stat));
+			parseResult.parseTree.expr.def->body.clear();
+			parseResult.parseTree.expr.def->body.push_back(std::move(stat));
 		}
 
+		return Compile(parseResult.parseTree, optimizationLevel);
+	}
+
+	void RaiseSyntaxError(Wg_Context* context, const CodeError& error, const SourceText& source, const char* module, const char* prettyName) {
+		if (prettyName == nullptr)
+			prettyName = DEFAULT_FUNC_NAME;
+
+		std::string_view lineText;
+		if (error.srcPos.line < source.lines.size()) {
+			lineText = source.lines[error.srcPos.line];
+		}
+		context->currentTrace.push_back(TraceFrame{
+			error.srcPos,
+			lineText,
+			module,
+			prettyName,
+			true
+			});
+
+		Wg_RaiseException(context, WG_EXC_SYNTAXERROR, error.message.c_str());
+
+		context->currentTrace.pop_back();
+	}
+
+	RcPtr<Bytecode> CompileSource(Wg_Context* context, const RcPtr<SourceText>& source, const char* module, const char* prettyName, bool expr) {
+		WG_ASSERT(context && source);
+
+		CodeError error;
+		RcPtr<Bytecode> code = CompileSource(source, expr, context->config.optimizationLevel, error);
+		if (code == nullptr)
+			RaiseSyntaxError(context, error, *source, module, prettyName);
+		return code;
+	}
+
+	Wg_Obj* NewCodeFunction(Wg_Context* context, RcPtr<Bytecode> code, RcPtr<SourceText> source, const char* module, const char* prettyName) {
+		if (prettyName == nullptr)
+			prettyName = DEFAULT_FUNC_NAME;
+
 		auto* def = new DefObject();
 		def->context = context;
 		def->module = module;
 		def->prettyName = prettyName;
-		def->originalSource = std::move(originalSource);
-		auto instructions = Compile(parseResult.parseTree);
-		def->instructions = MakeRcPtr<std::vector<Instruction>>(std::move(instructions));
+		def->originalSource = std::move(source);
+		def->caches = MakeRcPtr<CodeCaches>(*code);
+		def->code = std::move(code);
 
 		Wg_Obj* obj = Wg_NewFunction(context, &DefObject::Run, def);
 		if (obj == nullptr) {
@@ -252,13 +791,48 @@ namespace wings {
 			return nullptr;
 		}
 		
-		Wg_RegisterFinalizer(obj, [](void* ud) { delete (DefObject*)ud; }, def);
+		Wg_RegisterFinalizer(obj, DeleteUserdata<DefObject>, def);
 
 		return obj;
 	}
 
+	Wg_Obj* Compile(Wg_Context* context, std::string_view code, const char* module, const char* prettyName, bool expr) {
+		auto source = MakeRcPtr<SourceText>(code);
+		RcPtr<Bytecode> bytecode = CompileSource(context, source, module, prettyName, expr);
+		if (bytecode == nullptr)
+			return nullptr;
+
+		return NewCodeFunction(context, std::move(bytecode), std::move(source), module, prettyName);
+	}
+
 	Wg_Obj* Execute(Wg_Context* context, const char* code, const char* module) {
-		if (Wg_Obj* fn = Compile(context, code, module, module, false)) {
+		// Execute is only used for the source embedded in the library, so the
+		// compiled form is kept for the lifetime of the process and shared
+		// by every context.
+		static std::mutex cacheMutex;
+		static std::map<std::pair<const char*, int>, std::pair<RcPtr<Bytecode>, RcPtr<SourceText>>> cache;
+		int optimizationLevel = context->config.optimizationLevel;
+
+		RcPtr<Bytecode> bytecode;
+		RcPtr<SourceText> source;
+		{
+			std::lock_guard lock(cacheMutex);
+			auto it = cache.find({ code, optimizationLevel });
+			if (it != cache.end())
+				std::tie(bytecode, source) = it->second;
+		}
+
+		if (bytecode == nullptr) {
+			source = MakeRcPtr<SourceText>(code);
+			bytecode = CompileSource(context, source, module, module, false);
+			if (bytecode == nullptr)
+				return nullptr;
+
+			std::lock_guard lock(cacheMutex);
+			cache.insert({ { code, optimizationLevel }, { bytecode, source } });
+		}
+
+		if (Wg_Obj* fn = NewCodeFunction(context, std::move(bytecode), std::move(source), module, module)) {
 			return Wg_Call(fn, nullptr, 0);
 		} else {
 			return nullptr;
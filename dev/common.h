@@ -17,6 +17,11 @@
 #include <atomic>
 #include <random>
 #include <variant>
+#include <optional>
+#include <algorithm>
+#include <new>
+#include <cstddef>
+#include <chrono>
 
 static_assert(sizeof(Wg_int) == sizeof(Wg_uint));
 
@@ -27,13 +32,77 @@ namespace wings {
 	std::string WObjTypeToString(const Wg_Obj* obj);
 	void CallErrorCallback(const char* message);
 	Wg_Obj* Alloc(Wg_Context* context);
+	// Must be called when a promoted object may have been given a reference to
+	// a young one, with no allocation between the store and the call.
+	void WriteBarrier(Wg_Obj* obj);
+	// Cells are shared by frames and closures that cannot be found from the cell,
+	// so a young value stored in one is kept alive by the next nursery collection instead.
+	void CellWriteBarrier(Wg_Obj* value);
+	void CollectNursery(Wg_Context* context);
+	// Moves every object from index 'first' onwards in the object list into the old generation
+	void Promote(Wg_Context* context, size_t first);
+	// Raises a MemoryError if 'bytes' more bytes would exceed maxBytes even after a full collection
+	bool CheckBytes(Wg_Context* context, size_t bytes);
+	// Records that 'bytes' more bytes are in use
+	void CountBytes(Wg_Context* context, size_t bytes);
+	bool ChargeBytes(Wg_Context* context, size_t bytes);
+	// The bytes used by an object and by the data that it owns
+	size_t ObjectBytes(const Wg_Obj* obj);
+	Wg_Obj* GetAttribute(Wg_Obj* obj, const std::string& attribute, AttributeTable::InlineCache& cache);
+	void SetAttribute(Wg_Obj* obj, const std::string& attribute, Wg_Obj* value, AttributeTable::InlineCache& cache);
+	// If self is not null then it is passed as the first argument instead of the function's bound self
+	Wg_Obj* CallWithSelf(Wg_Obj* callable, Wg_Obj* self, Wg_Obj** argv, int argc, Wg_Obj* kwargsDict);
+	// Like CallWithSelf() but the values of the keyword arguments follow the positional arguments in argv
+	Wg_Obj* CallVector(Wg_Obj* callable, Wg_Obj* self, Wg_Obj** argv, int argc, Wg_Obj** kwnames, int kwargc);
+	// Like CallVector() but for the calls of script instructions, which may be suspended by the callee
+	Wg_Obj* CallFromScript(Wg_Obj* callable, Wg_Obj* self, Wg_Obj** argv, int argc, Wg_Obj** kwnames, int kwargc);
+	Wg_Obj* CallMethod(Wg_Obj* obj, const char* member, Wg_Obj** argv, int argc, Wg_Obj* kwargsDict);
 	bool IsKeyword(std::string_view s);
 	bool IsValidIdentifier(std::string_view s);
-	Wg_Obj* Compile(Wg_Context* context, const char* code, const char* module, const char* prettyName, bool expr);
+	struct Bytecode;
+	struct SourceText;
+	struct CodeError;
+	// Sets error and returns null if the source could not be compiled
+	RcPtr<Bytecode> CompileSource(const RcPtr<SourceText>& source, bool expr, int optimizationLevel, CodeError& error);
+	void RaiseSyntaxError(Wg_Context* context, const CodeError& error, const SourceText& source, const char* module, const char* prettyName);
+	// Raises a SyntaxError and returns null if the source could not be compiled
+	RcPtr<Bytecode> CompileSource(Wg_Context* context, const RcPtr<SourceText>& source, const char* module, const char* prettyName, bool expr);
+	Wg_Obj* NewCodeFunction(Wg_Context* context, RcPtr<Bytecode> code, RcPtr<SourceText> source, const char* module, const char* prettyName);
+	Wg_Obj* Compile(Wg_Context* context, std::string_view code, const char* module, const char* prettyName, bool expr);
 	Wg_Obj* Execute(Wg_Context* context, const char* code, const char* module);
 	void RegisterMethod(Wg_Obj* klass, const char* name, Wg_Function fptr);
 	Wg_Obj* RegisterFunction(Wg_Context* context, const char* name, Wg_Function fptr);
 	void AddAttributeToClass(Wg_Obj* klass, const char* attribute, Wg_Obj* value);
+	bool TryFastBinaryOp(Wg_BinOp op, Wg_Obj* lhs, Wg_Obj* rhs, Wg_Obj** result);
+	// Whether an instance still shares the attributes of its class, i.e. no methods were overridden
+	bool IsUnmodifiedInstance(const Wg_Obj* obj, const Wg_Obj* klass);
+	// Whether an object is an unmodified int, float or str
+	bool IsPlainBuiltin(const Wg_Obj* obj);
+
+	// Integer arithmetic wraps around on overflow
+	inline Wg_int WrappingAdd(Wg_int a, Wg_int b) { return (Wg_int)((Wg_uint)a + (Wg_uint)b); }
+	inline Wg_int WrappingSub(Wg_int a, Wg_int b) { return (Wg_int)((Wg_uint)a - (Wg_uint)b); }
+	inline Wg_int WrappingMul(Wg_int a, Wg_int b) { return (Wg_int)((Wg_uint)a * (Wg_uint)b); }
+
+	// Division rounding towards negative infinity. The divisor must not be zero.
+	inline Wg_int FloorDiv(Wg_int a, Wg_int b) {
+		if (b == -1)
+			return WrappingSub(0, a);
+		Wg_int q = a / b;
+		if (a % b != 0 && (a < 0) != (b < 0))
+			q--;
+		return q;
+	}
+
+	// Remainder with the sign of the divisor. The divisor must not be zero.
+	inline Wg_int FloorMod(Wg_int a, Wg_int b) {
+		if (b == -1)
+			return 0;
+		Wg_int m = a % b;
+		if (m != 0 && (m < 0) != (b < 0))
+			m += b;
+		return m;
+	}
 
 	struct LibraryInitException : std::exception {};
 
@@ -52,6 +121,53 @@ namespace wings {
 		return Wg_TryGetUserdata(obj, type, (void**)out);
 	}
 
+	// Finalizer for userdata allocated with new. Snapshots identify
+	// the type of an object's userdata by its finalizer.
+	template <class T>
+	void DeleteUserdata(void* userdata) {
+		delete (T*)userdata;
+	}
+
+	// Finalizer that releases a reference taken with Wg_IncRef()
+	void DecRefUserdata(void* userdata);
+
+	// Interned object type tags. Builtin types have fixed ids. Every other
+	// type name (i.e. the class name of an instance) is given an id on first use.
+	enum class ObjType : uint32_t {
+		Uninitialised,
+		Null,
+		Bool,
+		Int,
+		Float,
+		Str,
+		Tuple,
+		List,
+		Map,
+		Set,
+		Func,
+		Class,
+		Object,
+		ForIter,
+		Generator,
+		BuiltinCount,
+	};
+
+	// Allows string keyed containers to be searched with a std::string_view
+	struct StringHasher {
+		using is_transparent = void;
+		size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+	};
+
+	struct TypeTable {
+		TypeTable();
+		ObjType Intern(std::string_view name);
+		std::optional<ObjType> Find(std::string_view name) const;
+		const std::string& Name(ObjType type) const;
+	private:
+		std::unordered_map<std::string, ObjType, StringHasher, std::equal_to<>> ids;
+		std::vector<std::string> names;
+	};
+
 	struct Rng {
 		Rng();
 		void Seed(Wg_int seed);
@@ -64,6 +180,11 @@ namespace wings {
 		std::uniform_real_distribution<Wg_float> dist;
 	};
 	
+	// Mixes the hash of an element into the hash of a tuple
+	inline size_t CombineHash(size_t seed, size_t hash) {
+		return seed ^ (hash + (size_t)0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+	}
+
 	struct WObjHasher {
 		size_t operator()(Wg_Obj* obj) const;
 	};
@@ -91,23 +212,25 @@ namespace wings {
 		static CodeError Bad(std::string message, SourcePosition srcPos = {});
 	};
 
-	struct OwnedTraceFrame {
-		SourcePosition srcPos;
-		std::string lineText;
-		std::string module;
-		std::string func;
-		bool syntaxError;
-	};
-
 	struct TraceFrame {
 		SourcePosition srcPos;
 		std::string_view lineText;
 		std::string_view module;
 		std::string_view func;
 		bool syntaxError = false;
-		OwnedTraceFrame ToOwned() const {
-			return { srcPos, std::string(lineText), std::string(module), std::string(func), syntaxError };
-		}
+		// The function that owns the strings of this frame. Tracebacks keep it alive
+		// instead of copying the strings. Null if the strings are only temporary.
+		Wg_Obj* function = nullptr;
+		// Whether every call from the Wg_CallSuspendable() entry to this frame
+		// was made by a script instruction, so that the frame can be suspended
+		bool suspendable = false;
+	};
+
+	// A script frame of a suspended call, kept until the host resumes the call
+	struct SuspendedFrame {
+		Executor* executor;
+		// The function that owns the DefObject of the executor
+		Wg_Obj* function;
 	};
 
 	struct HashException : public std::exception {};
@@ -145,10 +268,15 @@ namespace wings {
 		Wg_Obj* dictValuesIter;
 		Wg_Obj* dictItemsIter;
 		Wg_Obj* setIter;
+		Wg_Obj* range;
+		Wg_Obj* rangeIter;
 		Wg_Obj* codeObject;
 		Wg_Obj* moduleObject;
 		Wg_Obj* file;
-		Wg_Obj* readlineIter;
+		Wg_Obj* bytes;
+		Wg_Obj* bytearray;
+		Wg_Obj* memoryview;
+		Wg_Obj* generator;
 
 		// Exception types
 		Wg_Obj* baseException;
@@ -174,6 +302,7 @@ namespace wings {
 		Wg_Obj* recursionError;
 		Wg_Obj* typeError;
 		Wg_Obj* valueError;
+		Wg_Obj* bufferError;
 
 		// Functions
 		Wg_Obj* isinstance;
@@ -187,23 +316,32 @@ namespace wings {
 		Wg_Obj* _false;
 		Wg_Obj* memoryErrorInstance;
 		Wg_Obj* recursionErrorInstance;
+		// Returned by Wg_Suspend() and passed up by the suspended frames
+		Wg_Obj* pending;
+
+		// Immortal ints in [SMALL_INT_MIN, SMALL_INT_MAX], created on first use
+		static constexpr Wg_int SMALL_INT_MIN = -5;
+		static constexpr Wg_int SMALL_INT_MAX = 256;
+		std::array<Wg_Obj*, SMALL_INT_MAX - SMALL_INT_MIN + 1> smallInts;
 
-		auto GetAll() const {
+		// Pointers to every member except smallInts, so that they can be visited or remapped
+		auto GetAll() {
 			return std::array{
-				object, noneType, _bool, _int, _float, str, tuple, list,
-				dict, set, func, slice, defaultIter, defaultReverseIter,
-				dictKeysIter, dictValuesIter, dictItemsIter, setIter,
-				codeObject, moduleObject, file, readlineIter,
+				&object, &noneType, &_bool, &_int, &_float, &str, &tuple, &list,
+				&dict, &set, &func, &slice, &defaultIter, &defaultReverseIter,
+				&dictKeysIter, &dictValuesIter, &dictItemsIter, &setIter,
+				&range, &rangeIter, &codeObject, &moduleObject, &file,
+				&bytes, &bytearray, &memoryview, &generator,
 
-				baseException, wingsTimeoutError, systemExit, exception, stopIteration, arithmeticError,
-				overflowError, zeroDivisionError, attributeError, importError,
-				syntaxError, lookupError, indexError, keyError, memoryError,
-				osError, isADirectoryError, nameError, runtimeError, notImplementedError, recursionError,
-				typeError, valueError,
+				&baseException, &wingsTimeoutError, &systemExit, &exception, &stopIteration, &arithmeticError,
+				&overflowError, &zeroDivisionError, &attributeError, &importError,
+				&syntaxError, &lookupError, &indexError, &keyError, &memoryError,
+				&osError, &isADirectoryError, &nameError, &runtimeError, &notImplementedError, &recursionError,
+				&typeError, &valueError, &bufferError,
 
-				isinstance, repr, hash, len,
+				&isinstance, &repr, &hash, &len,
 
-				none, _true, _false, memoryErrorInstance, recursionError,
+				&none, &_true, &_false, &memoryErrorInstance, &recursionErrorInstance, &pending,
 			};
 		}
 	};
@@ -223,9 +361,167 @@ namespace wings {
 	}
 	
 	struct Timeout {
-		uint64_t start;
+		std::chrono::steady_clock::time_point deadline;
 		uint64_t time;
 	};
+
+	// The execution limits are only checked once every this many ticks.
+	// A tick is counted on every call and backward jump.
+	constexpr int64_t TICKS_PER_LIMIT_CHECK = 1024;
+
+	// The maximum depth of calls through native code, each of which
+	// recurses on the host stack. Calls between script functions do not count.
+	constexpr size_t MAX_NATIVE_RECURSION = 200;
+
+	struct Profiler;
+	struct GCWorkers;
+
+	// Full collections of smaller heaps are faster on one thread than with helper threads
+	constexpr size_t PARALLEL_GC_MIN_OBJECTS = 65536;
+
+	// Bucket 0 of the pause histogram is below 1us and bucket i is [2^(i-1), 2^i) us
+	constexpr size_t GC_PAUSE_BUCKETS = 24;
+
+	// Totals since a context was created
+	struct GCStats {
+		uint64_t allocations = 0;
+		uint64_t collections = 0;
+		uint64_t youngCollections = 0;
+		std::chrono::steady_clock::duration pauseTime{};
+		std::chrono::steady_clock::duration maxPause{};
+		std::chrono::steady_clock::duration lastPause{};
+		uint64_t pauseHistogram[GC_PAUSE_BUCKETS]{};
+		uint64_t bytesAllocated = 0;
+		// Measured by the last full collection
+		size_t bytesAfterCollection = 0;
+		// Charged by allocations since the last full collection
+		size_t bytesSinceCollection = 0;
+	};
+
+	// Adds the time from construction to destruction to the GC pause statistics
+	// and then invokes the GC callback
+	struct GCPauseTimer {
+		GCPauseTimer(Wg_Context* context, bool young);
+		~GCPauseTimer();
+		Wg_Context* context;
+		bool young;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	// The characters of a str built by concatenation. A string built by appending to
+	// the same string in a loop reuses one buffer, which grows in place if the left
+	// operand ends at the end of the buffer, so the bytes that a string refers to
+	// are never modified.
+	struct StrBuffer {
+		std::unique_ptr<char[]> data;
+		size_t size = 0;
+		size_t capacity = 0;
+		// Set once the NUL terminated end of the buffer has been handed out by Wg_GetString()
+		bool sealed = false;
+	};
+
+	// Concatenations shorter than this produce a plain std::string
+	constexpr size_t MIN_STR_BUFFER_SIZE = 64;
+
+	// The data of a str that refers to the beginning of a shared buffer
+	struct StrSlice {
+		StrSlice(RcPtr<StrBuffer> buffer, size_t length) : buffer(std::move(buffer)), length(length) {}
+		StrSlice(const StrSlice& other) : buffer(other.buffer), length(other.length) {}
+		RcPtr<StrBuffer> buffer;
+		size_t length;
+		// A NUL terminated copy, made if the buffer was appended to after this string
+		mutable std::unique_ptr<std::string> terminated;
+	};
+
+	// The memory shared by bytes, bytearray and memoryview objects. The memory either
+	// belongs to the storage or is borrowed from the host, in which case the host's
+	// finalizer is called once the last object referring to it is destroyed.
+	struct BufferStorage {
+		BufferStorage() = default;
+		BufferStorage(const BufferStorage&) = delete;
+		BufferStorage& operator=(const BufferStorage&) = delete;
+		~BufferStorage() {
+			if (finalizer)
+				finalizer(userdata);
+		}
+		unsigned char* Data() { return borrowed ? host : owned.data(); }
+		size_t Size() const { return borrowed ? hostSize : owned.size(); }
+
+		std::vector<unsigned char> owned;
+		bool borrowed = false;
+		unsigned char* host = nullptr;
+		size_t hostSize = 0;
+		Wg_Finalizer finalizer = nullptr;
+		void* userdata = nullptr;
+	};
+
+	// The userdata of a bytes, bytearray or memoryview, which refers to
+	// a range of a storage. Slicing a bytes or memoryview shares the storage.
+	struct BufferObject {
+		enum class Kind : uint8_t {
+			Bytes,
+			ByteArray,
+			MemoryView,
+			// An array from the array module
+			Array,
+		} kind{};
+		bool readonly = true;
+		// The type of the items of an array
+		char typecode = 0;
+		// Null once a memoryview has been released
+		RcPtr<BufferStorage> storage;
+		size_t offset = 0;
+		size_t length = 0;
+
+		unsigned char* Data() const { return storage->Data() + offset; }
+		std::string_view View() const {
+			if (storage == nullptr)
+				return {};
+			return { (const char*)Data(), length };
+		}
+	};
+
+	// Holds the arguments of the calls in progress, which keeps them alive without
+	// reference counting. Blocks are never reallocated, so the arguments of a call
+	// stay in place while nested calls push their own.
+	struct ArgumentStack {
+		struct Mark {
+			size_t block;
+			size_t size;
+		};
+
+		Mark GetMark() const { return { current, blocks.empty() ? 0 : blocks[current].size }; }
+		// Returns space for count contiguous values
+		Wg_Obj** Push(size_t count);
+		void Pop(Mark mark);
+		template <class F> void ForEach(F f) const {
+			for (size_t i = 0; i < blocks.size() && i <= current; i++)
+				for (size_t j = 0; j < blocks[i].size; j++)
+					f(blocks[i].data[j]);
+		}
+	private:
+		static constexpr size_t BLOCK_SIZE = 1024;
+		struct Block {
+			std::unique_ptr<Wg_Obj*[]> data;
+			size_t capacity;
+			size_t size;
+		};
+		std::vector<Block> blocks;
+		size_t current = 0;
+	};
+
+	// The keyword arguments of a call in progress. If they were passed by name,
+	// a dictionary is only created when the callee asks for one.
+	struct CallKwargs {
+		Wg_Obj* dict;
+		Wg_Obj** names;
+		Wg_Obj** values;
+		int count;
+	};
+
+	// Returns the str with this value from the intern table, creating it if it does not exist
+	Wg_Obj* InternString(Wg_Context* context, std::string_view value);
+	Wg_Obj* ConcatStrings(Wg_Context* context, const Wg_Obj* lhs, std::string_view rhs);
 }
 
 struct Wg_Obj {
@@ -243,11 +539,12 @@ struct Wg_Obj {
 		std::string module;
 		Wg_Function ctor;
 		void* userdata;
+		wings::ObjType instanceType;
 		std::vector<Wg_Obj*> bases;
 		wings::AttributeTable instanceAttributes;
 	};
 
-	std::string type;
+	wings::ObjType type{};
 	union {
 		void* data;
 
@@ -265,24 +562,144 @@ struct Wg_Obj {
 	template <class T> const T& Get() const { return *(const T*)data; }
 	template <class T> T& Get() { return *(T*)data; }
 
+	// Construct the data of a builtin type in place instead of on the heap
+	template <class T, class... Args> T& EmplaceInline(Args&&... args) {
+		static_assert(sizeof(T) <= sizeof(inlineData) && alignof(T) <= alignof(std::max_align_t));
+		wings::WriteBarrier(this);
+		DestroyInline();
+		hasCachedHash = false;
+		data = new (inlineData) T(std::forward<Args>(args)...);
+		inlineOps = &InlineOpsFor<T>;
+		return *(T*)data;
+	}
+	void DestroyInline() {
+		if (inlineOps) {
+			inlineOps->destroy(inlineData);
+			inlineOps = nullptr;
+		}
+	}
+	template <class T> bool HoldsInline() const {
+		return inlineOps == &InlineOpsFor<T>;
+	}
+	// Copies the inline data of another object. Returns false if there is none.
+	bool CopyInline(const Wg_Obj& other) {
+		if (other.inlineOps == nullptr)
+			return false;
+		DestroyInline();
+		other.inlineOps->copy(other.inlineData, inlineData);
+		data = inlineData;
+		inlineOps = other.inlineOps;
+		return true;
+	}
+
 	wings::AttributeTable attributes;
 	std::vector<std::pair<Wg_Finalizer, void*>> finalizers;
 	Wg_Context* context;
 	uint32_t refCount = 0;
+	bool promoted = false;
+	bool remembered = false;
+	mutable bool marked = false;
+	// Whether this str is in the intern table of its context
+	bool interned = false;
+	// The hash of a str, computed on first use as dictionary or set key
+	mutable bool hasCachedHash = false;
+	mutable size_t cachedHash = 0;
+	// The size reported with Wg_SetUserdataSize()
+	size_t userdataSize = 0;
+private:
+	static constexpr size_t INLINE_DATA_SIZE = std::max(sizeof(std::string), sizeof(std::vector<Wg_Obj*>));
+	alignas(std::max_align_t) unsigned char inlineData[INLINE_DATA_SIZE];
+
+	struct InlineOps {
+		void (*destroy)(void*);
+		void (*copy)(const void* src, void* dst);
+	};
+	template <class T> static constexpr InlineOps InlineOpsFor = {
+		[](void* p) { ((T*)p)->~T(); },
+		[](const void* src, void* dst) { new (dst) T(*(const T*)src); },
+	};
+	const InlineOps* inlineOps = nullptr;
 };
 
+namespace wings {
+	// Unlike Wg_GetString(), this does not need the string to be NUL terminated
+	inline std::string_view GetStringView(const Wg_Obj* obj) {
+		if (obj->HoldsInline<StrSlice>()) {
+			const auto& slice = obj->Get<StrSlice>();
+			return { slice.buffer->data.get(), slice.length };
+		}
+		return obj->Get<std::string>();
+	}
+
+	// Gets the userdata of a bytes, bytearray, memoryview or array (or an instance
+	// of a subclass of one). Returns null for any other object.
+	BufferObject* GetBuffer(const Wg_Obj* obj);
+	// Creates a bytes, bytearray or memoryview, depending on the kind of the
+	// buffer, without calling its constructor. Returns null on failure.
+	Wg_Obj* NewBuffer(Wg_Context* context, BufferObject buffer);
+	// A buffer cannot change size while another object refers to its storage.
+	// Raises BufferError and returns false if it is shared.
+	bool CheckResizable(Wg_Context* context, const BufferObject* buf);
+
+	// Allocates objects from fixed size pages and reuses the slots of freed objects
+	struct ObjectPool {
+		ObjectPool() = default;
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool& operator=(const ObjectPool&) = delete;
+
+		Wg_Obj* Allocate();
+		void Free(Wg_Obj* obj);
+	private:
+		static constexpr size_t PAGE_SIZE = 256;
+		union Slot {
+			Slot* next;
+			alignas(Wg_Obj) unsigned char storage[sizeof(Wg_Obj)];
+		};
+		std::vector<std::unique_ptr<Slot[]>> pages;
+		Slot* freeList = nullptr;
+	};
+}
+
 struct Wg_Context {
 	Wg_Config config{};
 	wings::Rng rng;
+	wings::TypeTable types;
 	bool closing = false;
 	bool gcRunning = false;
 	std::vector<std::string> argv;
+
+	// Execution limits
 	std::vector<wings::Timeout> timeouts;
+	int64_t ticksUntilCheck = wings::TICKS_PER_LIMIT_CHECK;
+	int64_t ticksScheduled = wings::TICKS_PER_LIMIT_CHECK;
+	// The number of ticks left before the instruction budget is exceeded, or -1 if there is no budget
+	int64_t instructionBudget = -1;
+	std::atomic<bool> interruptRequested = false;
+	bool raisingLimitError = false;
+
+	// Only set while profiling or while the results of the last profile are kept
+	wings::Profiler* profiler = nullptr;
 	
 	// Garbage collection
 	size_t lastObjectCountAfterGC = 0;
-	std::vector<std::unique_ptr<Wg_Obj>> mem;
+	size_t promotedCount = 0;
+	wings::ObjectPool pool;
+	std::vector<Wg_Obj*> mem;
+	std::vector<Wg_Obj*> rememberedSet;
 	std::vector<wings::Executor*> executors;
+	// Finished executors, kept so that their containers are reused by later calls
+	std::vector<wings::Executor*> executorPool;
+	// The frames of a call waiting for Wg_Resume(), innermost first
+	std::vector<wings::SuspendedFrame> suspendedFrames;
+	bool suspended = false;
+	wings::GCStats gcStats;
+	Wg_GCCallback gcCallback = nullptr;
+	void* gcCallbackUserdata = nullptr;
+	// Created by the first parallel collection
+	wings::GCWorkers* gcWorkers = nullptr;
+	// Strings that are shared by value, keyed by their own data.
+	// Entries are removed when the strings are freed.
+	std::unordered_map<std::string_view, Wg_Obj*> internedStrings;
 
 	// Object instances
 	using Globals = std::unordered_map<std::string, wings::RcPtr<Wg_Obj*>>;
@@ -291,12 +708,15 @@ struct Wg_Context {
 	
 	// Exception info
 	std::vector<wings::TraceFrame> currentTrace;
-	std::vector<wings::OwnedTraceFrame> exceptionTrace;
+	std::vector<wings::TraceFrame> exceptionTrace;
+	// Copies of the strings of trace frames that have no function
+	std::deque<std::string> exceptionTraceText;
 	std::string traceMessage;
 	Wg_Obj* currentException = nullptr;
 	
 	// Function call data
-	std::vector<Wg_Obj*> kwargs;
+	wings::ArgumentStack argumentStack;
+	std::vector<wings::CallKwargs> kwargs;
 	std::vector<void*> userdata;
 	std::vector<Wg_Obj*> reprStack;
 
@@ -306,6 +726,30 @@ struct Wg_Context {
 	std::string importPath;
 };
 
+struct Wg_Snapshot {
+	// A private copy of the snapshotted context. Nothing is ever executed
+	// in it so that it can be cloned from several threads at once.
+	Wg_Context* context;
+};
+
+struct Wg_Program {
+	// Null if the source could not be compiled
+	wings::RcPtr<wings::Bytecode> code;
+	wings::RcPtr<wings::SourceText> source;
+	std::string prettyName;
+	wings::CodeError error;
+};
+
+namespace wings {
+	// Counts a tick towards the execution limits.
+	// Returns false and raises an exception if a limit was exceeded.
+	inline bool Tick(Wg_Context* context) {
+		if (--context->ticksUntilCheck > 0)
+			return true;
+		return !Wg_CheckTimeout(context);
+	}
+}
+
 #define WG_UNREACHABLE() std::abort()
 
 #define WG_STRINGIZE_HELPER(x) WG_STRINGIZE2_HELPER(x)
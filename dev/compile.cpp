@@ -1,18 +1,88 @@
 #include "compile.h"
 #include "common.h"
+#include "optimize.h"
 
 #include <unordered_map>
+#include <algorithm>
 #include <stack>
 
 namespace wings {
 
 	static thread_local std::stack<std::vector<size_t>> breakInstructions;
 	static thread_local std::stack<std::vector<size_t>> continueInstructions;
-	static thread_local std::stack<std::optional<size_t>> forLoopBreakInstructions;
+	static thread_local std::stack<std::optional<size_t>> forIterInstructions;
+	static thread_local int optimizationLevel;
+
+	// Variables of a function being compiled. References to a variable are recorded
+	// and patched with the final slot once the whole function body has been compiled,
+	// since only then is it known whether a nested function captures the variable.
+	struct Scope {
+		struct Variable {
+			bool captured = false;
+			std::vector<VariableSlot*> references;
+		};
+		std::unordered_map<std::string, size_t> indices;
+		std::vector<Variable> variables;
+		size_t captureCount = 0;
+
+		void Add(const std::string& name, bool captured = false) {
+			if (indices.try_emplace(name, variables.size()).second)
+				variables.push_back({ captured });
+		}
+	};
+
+	static thread_local std::stack<Scope> scopes;
+
+	static void ResolveVariable(const std::string& name, VariableSlot& slot) {
+		slot.type = VariableSlot::Type::Global;
+		if (scopes.empty())
+			return;
+
+		auto& scope = scopes.top();
+		auto it = scope.indices.find(name);
+		if (it != scope.indices.end())
+			scope.variables[it->second].references.push_back(&slot);
+	}
+
+	static size_t CountDirectTargets(const AssignTarget& target) {
+		if (target.type == AssignType::Direct)
+			return 1;
+
+		size_t count = 0;
+		for (const auto& child : target.pack)
+			count += CountDirectTargets(child);
+		return count;
+	}
+
+	static void ResolveAssignTarget(const AssignTarget& target, VariableSlot*& slot) {
+		if (target.type == AssignType::Direct) {
+			ResolveVariable(target.direct, *slot++);
+		} else {
+			for (const auto& child : target.pack)
+				ResolveAssignTarget(child, slot);
+		}
+	}
+
+	static std::unique_ptr<DirectAssignInstruction> MakeDirectAssign(const AssignTarget& target) {
+		auto instr = std::make_unique<DirectAssignInstruction>();
+		instr->assignTarget = target;
+		instr->slots.resize(CountDirectTargets(target));
+		VariableSlot* slot = instr->slots.data();
+		ResolveAssignTarget(target, slot);
+		return instr;
+	}
+
+	static std::unique_ptr<DirectAssignInstruction> MakeDirectAssign(const std::string& name) {
+		AssignTarget target{};
+		target.type = AssignType::Direct;
+		target.direct = name;
+		return MakeDirectAssign(target);
+	}
 
 	static void CompileBody(const std::vector<Statement>& body, std::vector<Instruction>& instructions);
 	static void CompileExpression(const Expression& expression, std::vector<Instruction>& instructions);
 	static void CompileFunction(const Expression& node, std::vector<Instruction>& instructions);
+	static RcPtr<Bytecode> Assemble(std::vector<Instruction>& instructions);
 
 	static const std::unordered_map<Operation, std::string> OP_METHODS = {
 		{ Operation::Index,  "__getitem__"  },
@@ -53,6 +123,41 @@ namespace wings {
 		{ Operation::ShiftRAssign, "__irshift__" },
 	};
 
+	// Binary operations compiled to an Operation instruction instead of a method call
+	static const std::unordered_map<Operation, Wg_BinOp> BINARY_OP_INSTRUCTIONS = {
+		{ Operation::Add,	 WG_BOP_ADD      },
+		{ Operation::Sub,	 WG_BOP_SUB      },
+		{ Operation::Mul,	 WG_BOP_MUL      },
+		{ Operation::Div,	 WG_BOP_DIV      },
+		{ Operation::IDiv,	 WG_BOP_FLOORDIV },
+		{ Operation::Mod,	 WG_BOP_MOD      },
+		{ Operation::Pow,	 WG_BOP_POW      },
+		{ Operation::Eq,	 WG_BOP_EQ       },
+		{ Operation::Ne,	 WG_BOP_NE       },
+		{ Operation::Lt,	 WG_BOP_LT       },
+		{ Operation::Le,	 WG_BOP_LE       },
+		{ Operation::Gt,	 WG_BOP_GT       },
+		{ Operation::Ge,	 WG_BOP_GE       },
+		{ Operation::BitAnd, WG_BOP_BITAND   },
+		{ Operation::BitOr,  WG_BOP_BITOR    },
+		{ Operation::BitXor, WG_BOP_BITXOR   },
+		{ Operation::ShiftL, WG_BOP_SHL      },
+		{ Operation::ShiftR, WG_BOP_SHR      },
+
+		{ Operation::AddAssign, WG_BOP_ADD         },
+		{ Operation::SubAssign, WG_BOP_SUB         },
+		{ Operation::MulAssign, WG_BOP_MUL         },
+		{ Operation::DivAssign, WG_BOP_DIV         },
+		{ Operation::IDivAssign, WG_BOP_FLOORDIV   },
+		{ Operation::ModAssign, WG_BOP_MOD         },
+		{ Operation::PowAssign, WG_BOP_POW         },
+		{ Operation::AndAssign, WG_BOP_BITAND      },
+		{ Operation::OrAssign, WG_BOP_BITOR        },
+		{ Operation::XorAssign, WG_BOP_BITXOR      },
+		{ Operation::ShiftLAssign, WG_BOP_SHL      },
+		{ Operation::ShiftRAssign, WG_BOP_SHR      },
+	};
+
 	static const std::unordered_set<Operation> COMPOUND_OPS = {
 		Operation::AddAssign,
 		Operation::SubAssign,
@@ -167,8 +272,7 @@ namespace wings {
 			//		<assignee>
 			//		<expr>
 			CompileExpression(value, instructions);
-			instr.directAssign = std::make_unique<DirectAssignInstruction>();
-			instr.directAssign->assignTarget = assignTarget;
+			instr.directAssign = MakeDirectAssign(assignTarget);
 			instr.type = Instruction::Type::DirectAssign;
 			break;
 		case AssignType::Index: {
@@ -191,7 +295,18 @@ namespace wings {
 			dot.string->string = "__setitem__";
 			instructions.push_back(std::move(dot));
 
-			CompileExpression(assignee.children[1], instructions);
+			if (assignee.operation == Operation::Slice) {
+				// var.__setitem__(slice(...), value)
+				for (size_t i = 1; i < assignee.children.size(); i++)
+					CompileExpression(assignee.children[i], instructions);
+
+				Instruction slice{};
+				slice.srcPos = srcPos;
+				slice.type = Instruction::Type::Slice;
+				instructions.push_back(std::move(slice));
+			} else {
+				CompileExpression(assignee.children[1], instructions);
+			}
 			CompileExpression(value, instructions);
 
 			instr.type = Instruction::Type::Call;
@@ -238,6 +353,7 @@ namespace wings {
 			case LiteralValue::Type::Int: *instr.literal = expression.literalValue.i; break;
 			case LiteralValue::Type::Float: *instr.literal = expression.literalValue.f; break;
 			case LiteralValue::Type::String: *instr.literal = expression.literalValue.s; break;
+			case LiteralValue::Type::Bytes: *instr.literal = BytesLiteral{ expression.literalValue.s }; break;
 			default: WG_UNREACHABLE();
 			}
 			instr.type = Instruction::Type::Literal;
@@ -263,8 +379,9 @@ namespace wings {
 			break;
 		}
 		case Operation::Variable:
-			instr.string = std::make_unique<StringArgInstruction>();
-			instr.string->string = expression.variableName;
+			instr.variable = std::make_unique<VariableInstruction>();
+			instr.variable->name = expression.variableName;
+			ResolveVariable(instr.variable->name, instr.variable->slot);
 			instr.type = Instruction::Type::Variable;
 			break;
 		case Operation::Dot:
@@ -279,8 +396,26 @@ namespace wings {
 			pushArgFrame.type = Instruction::Type::PushArgFrame;
 			instructions.push_back(std::move(pushArgFrame));
 
-			compileChildExpressions();
-			instr.type = Instruction::Type::Call;
+			const auto& callee = expression.children[0];
+			if (callee.operation != Operation::Dot) {
+				compileChildExpressions();
+				instr.type = Instruction::Type::Call;
+				break;
+			}
+
+			// Look up the method without binding it to avoid allocating a bound method object
+			CompileExpression(callee.children[0], instructions);
+
+			Instruction loadMethod{};
+			loadMethod.srcPos = callee.srcPos;
+			loadMethod.string = std::make_unique<StringArgInstruction>();
+			loadMethod.string->string = callee.variableName;
+			loadMethod.type = Instruction::Type::LoadMethod;
+			instructions.push_back(std::move(loadMethod));
+
+			for (size_t i = 1; i < expression.children.size(); i++)
+				CompileExpression(expression.children[i], instructions);
+			instr.type = Instruction::Type::CallMethod;
 			break;
 		}
 		case Operation::Or:
@@ -365,17 +500,26 @@ namespace wings {
 			Instruction assign{};
 			assign.srcPos = expression.srcPos;
 			assign.type = Instruction::Type::DirectAssign;
-			assign.directAssign = std::make_unique<DirectAssignInstruction>();
-			assign.directAssign->assignTarget.type = AssignType::Direct;
-			assign.directAssign->assignTarget.direct = expression.listComp.listName;
+			assign.directAssign = MakeDirectAssign(expression.listComp->listName);
 			instructions.push_back(std::move(assign));
 			
-			CompileBody(expression.listComp.forBody, instructions);
+			CompileBody(expression.listComp->forBody, instructions);
 			return;
 		}
 		case Operation::Function:
 			CompileFunction(expression, instructions);
 			return;
+		case Operation::GetIter:
+			compileChildExpressions();
+			instr.type = Instruction::Type::GetIter;
+			break;
+		case Operation::ForIter:
+			// Jumps out of the enclosing loop once the iterator is exhausted
+			compileChildExpressions();
+			forIterInstructions.top() = instructions.size();
+			instr.type = Instruction::Type::ForIter;
+			instr.jump = std::make_unique<JumpInstruction>();
+			break;
 		case Operation::Kwarg: {
 			Instruction load{};
 			load.srcPos = expression.srcPos;
@@ -392,10 +536,25 @@ namespace wings {
 			compileChildExpressions();
 			return;
 		}
+		case Operation::Yield:
+			// Leaves the value sent into the generator on the stack
+			compileChildExpressions();
+			instr.type = Instruction::Type::Yield;
+			break;
 		case Operation::CompoundAssignment:
 			CompileAssignment(expression.assignTarget, expression.children[0].children[0], expression.children[0], expression.srcPos, instructions);
 			return;
 		default: {
+			auto binaryOp = BINARY_OP_INSTRUCTIONS.find(expression.operation);
+			if (binaryOp != BINARY_OP_INSTRUCTIONS.end()) {
+				compileChildExpressions();
+				instr.operation = std::make_unique<OperationInstruction>();
+				instr.operation->op = binaryOp->second;
+				instr.operation->method = OP_METHODS.at(expression.operation);
+				instr.type = Instruction::Type::Operation;
+				break;
+			}
+
 			Instruction argFrame{};
 			argFrame.srcPos = expression.srcPos;
 			argFrame.type = Instruction::Type::PushArgFrame;
@@ -466,19 +625,28 @@ namespace wings {
 	static void CompileWhile(const Statement& node, std::vector<Instruction>& instructions) {
 		auto& whileStat = node.Get<stat::While>();
 		
+		// Loops transformed from for loops have a constant condition so there is nothing to test
+		const auto& condition = whileStat.expr;
+		bool alwaysTrue = condition.operation == Operation::Literal
+			&& condition.literalValue.type == LiteralValue::Type::Bool
+			&& condition.literalValue.b;
+
 		size_t conditionLocation = instructions.size();
-		CompileExpression(whileStat.expr, instructions);
+		std::optional<size_t> terminateJumpInstrIndex;
+		if (!alwaysTrue) {
+			CompileExpression(condition, instructions);
 		
-		size_t terminateJumpInstrIndex = instructions.size();
-		Instruction terminateJump{};
-		terminateJump.srcPos = node.srcPos;
-		terminateJump.type = Instruction::Type::JumpIfFalsePop;
-		terminateJump.jump = std::make_unique<JumpInstruction>();
-		instructions.push_back(std::move(terminateJump));
+			terminateJumpInstrIndex = instructions.size();
+			Instruction terminateJump{};
+			terminateJump.srcPos = node.srcPos;
+			terminateJump.type = Instruction::Type::JumpIfFalsePop;
+			terminateJump.jump = std::make_unique<JumpInstruction>();
+			instructions.push_back(std::move(terminateJump));
+		}
 
 		breakInstructions.emplace();
 		continueInstructions.emplace();
-		forLoopBreakInstructions.emplace();
+		forIterInstructions.emplace();
 		
 		CompileBody(whileStat.body, instructions);
 
@@ -489,10 +657,12 @@ namespace wings {
 		loopJump.jump->location = conditionLocation;
 		instructions.push_back(std::move(loopJump));
 
-		instructions[terminateJumpInstrIndex].jump->location = instructions.size();
+		if (terminateJumpInstrIndex) {
+			instructions[terminateJumpInstrIndex.value()].jump->location = instructions.size();
+		}
 
-		if (forLoopBreakInstructions.top()) {
-			instructions[forLoopBreakInstructions.top().value()].queuedJump->location = instructions.size();
+		if (forIterInstructions.top()) {
+			instructions[forIterInstructions.top().value()].jump->location = instructions.size();
 		}
 
 		if (whileStat.elseClause) {
@@ -508,17 +678,12 @@ namespace wings {
 		
 		breakInstructions.pop();
 		continueInstructions.pop();
-		forLoopBreakInstructions.pop();
+		forIterInstructions.pop();
 	}
 
 	static void CompileBreak(const Statement& node, std::vector<Instruction>& instructions) {
 		auto& brk = node.Get<stat::Break>();
-
-		if (brk.exitForLoopNormally) {
-			forLoopBreakInstructions.top() = instructions.size();
-		} else {
-			breakInstructions.top().push_back(instructions.size());
-		}
+		breakInstructions.top().push_back(instructions.size());
 
 		Instruction jump{};
 		jump.srcPos = node.srcPos;
@@ -552,7 +717,7 @@ namespace wings {
 	}
 
 	static void CompileFunction(const Expression& node, std::vector<Instruction>& instructions) {
-		const auto& parameters = node.def.parameters;
+		const auto& parameters = node.def->parameters;
 		size_t defaultParamCount = 0;
 		for (size_t i = parameters.size(); i-- > 0; ) {
 			const auto& param = parameters[i];
@@ -569,22 +734,21 @@ namespace wings {
 		def.type = Instruction::Type::Def;
 		def.def = std::make_unique<DefInstruction>();
 		def.def->variables = std::vector<std::string>(
-			node.def.variables.begin(),
-			node.def.variables.end()
+			node.def->variables.begin(),
+			node.def->variables.end()
 			);
 		def.def->localCaptures = std::vector<std::string>(
-			node.def.localCaptures.begin(),
-			node.def.localCaptures.end()
+			node.def->localCaptures.begin(),
+			node.def->localCaptures.end()
 			);
 		def.def->globalCaptures = std::vector<std::string>(
-			node.def.globalCaptures.begin(),
-			node.def.globalCaptures.end()
+			node.def->globalCaptures.begin(),
+			node.def->globalCaptures.end()
 			);
-		def.def->instructions = MakeRcPtr<std::vector<Instruction>>();
-		def.def->prettyName = node.def.name;
+		def.def->prettyName = node.def->name;
+		def.def->isGenerator = node.def->isGenerator;
 		def.def->defaultParameterCount = defaultParamCount;
-		auto& params = def.def->parameters;
-		params = std::move(node.def.parameters);
+		auto params = std::move(node.def->parameters);
 		if (!params.empty() && params.back().type == Parameter::Type::Kwargs) {
 			def.def->kwArgs = std::move(params.back().name);
 			params.pop_back();
@@ -593,7 +757,80 @@ namespace wings {
 			def.def->listArgs = std::move(params.back().name);
 			params.pop_back();
 		}
-		CompileBody(node.def.body, *def.def->instructions);
+		for (const auto& param : params)
+			def.def->parameters.push_back(param.name);
+
+		// Captures are resolved in the enclosing scope
+		const auto& localCaptures = def.def->localCaptures;
+		def.def->localCaptureSlots.resize(localCaptures.size());
+		for (size_t i = 0; i < localCaptures.size(); i++) {
+			ResolveVariable(localCaptures[i], def.def->localCaptureSlots[i]);
+			if (!scopes.empty()) {
+				auto& enclosing = scopes.top();
+				auto it = enclosing.indices.find(localCaptures[i]);
+				if (it != enclosing.indices.end())
+					enclosing.variables[it->second].captured = true;
+			}
+		}
+
+		Scope& scope = scopes.emplace();
+		for (const auto& capture : localCaptures)
+			scope.Add(capture, true);
+		scope.captureCount = scope.variables.size();
+		for (const auto& param : params)
+			scope.Add(param.name);
+		if (def.def->listArgs)
+			scope.Add(def.def->listArgs.value());
+		if (def.def->kwArgs)
+			scope.Add(def.def->kwArgs.value());
+		for (const auto& var : def.def->variables)
+			scope.Add(var);
+
+		def.def->parameterSlots.resize(params.size());
+		for (size_t i = 0; i < params.size(); i++)
+			ResolveVariable(params[i].name, def.def->parameterSlots[i]);
+		if (def.def->listArgs)
+			ResolveVariable(def.def->listArgs.value(), def.def->listArgsSlot);
+		if (def.def->kwArgs)
+			ResolveVariable(def.def->kwArgs.value(), def.def->kwArgsSlot);
+
+		std::vector<Instruction> body;
+		CompileBody(node.def->body, body);
+
+		// Captured variables become cells, everything else gets a local slot
+		size_t cellCount = scope.captureCount;
+		size_t localCount = 0;
+		for (size_t i = 0; i < scope.variables.size(); i++) {
+			VariableSlot slot{};
+			if (i < scope.captureCount) {
+				slot = { VariableSlot::Type::Cell, i };
+			} else if (scope.variables[i].captured) {
+				slot = { VariableSlot::Type::Cell, cellCount++ };
+			} else {
+				slot = { VariableSlot::Type::Local, localCount++ };
+			}
+
+			for (VariableSlot* ref : scope.variables[i].references)
+				*ref = slot;
+		}
+		def.def->cellCount = cellCount;
+		def.def->localCount = localCount;
+		scopes.pop();
+
+		const auto& paramSlots = def.def->parameterSlots;
+		def.def->contiguousParameters = true;
+		def.def->firstParameterLocal = paramSlots.empty() ? 0 : paramSlots[0].index;
+		for (size_t i = 0; i < paramSlots.size(); i++) {
+			if (paramSlots[i].type != VariableSlot::Type::Local
+				|| paramSlots[i].index != def.def->firstParameterLocal + i) {
+				def.def->contiguousParameters = false;
+				break;
+			}
+		}
+
+		// All slots are patched now so the body can be assembled
+		def.def->code = Assemble(body);
+
 		instructions.push_back(std::move(def));
 	}
 
@@ -604,9 +841,7 @@ namespace wings {
 		Instruction assign{};
 		assign.srcPos = node.srcPos;
 		assign.type = Instruction::Type::DirectAssign;
-		assign.directAssign = std::make_unique<DirectAssignInstruction>();
-		assign.directAssign->assignTarget.type = AssignType::Direct;
-		assign.directAssign->assignTarget.direct = def.def.name;
+		assign.directAssign = MakeDirectAssign(def.def->name);
 		instructions.push_back(std::move(assign));
 
 		Instruction pop{};
@@ -617,10 +852,8 @@ namespace wings {
 
 	static void CompileClass(const Statement& node, std::vector<Instruction>& instructions) {
 		auto& klass = node.Get<stat::Class>();
-		for (const auto& child :klass .body) {
-			CompileDef(child, instructions);
-			instructions.pop_back();
-			instructions.pop_back();
+		for (const auto& child : klass.body) {
+			CompileFunction(child.Get<stat::Def>().expr, instructions);
 			instructions.back().def->isMethod = true;
 		}
 
@@ -644,9 +877,7 @@ namespace wings {
 		Instruction assign{};
 		assign.srcPos = node.srcPos;
 		assign.type = Instruction::Type::DirectAssign;
-		assign.directAssign = std::make_unique<DirectAssignInstruction>();
-		assign.directAssign->assignTarget.type = AssignType::Direct;
-		assign.directAssign->assignTarget.direct = klass.name;
+		assign.directAssign = MakeDirectAssign(klass.name);
 		instructions.push_back(std::move(assign));
 
 		Instruction pop{};
@@ -778,9 +1009,7 @@ namespace wings {
 					Instruction assign{};
 					assign.srcPos = exceptClause.srcPos;
 					assign.type = Instruction::Type::DirectAssign;
-					assign.directAssign = std::make_unique<DirectAssignInstruction>();
-					assign.directAssign->assignTarget.type = AssignType::Direct;
-					assign.directAssign->assignTarget.direct = except.variable;
+					assign.directAssign = MakeDirectAssign(except.variable);
 					instructions.push_back(std::move(assign));
 
 					Instruction pop{};
@@ -855,11 +1084,108 @@ namespace wings {
 		}
 	}
 
-	std::vector<Instruction> Compile(const stat::Root& parseTree) {
+	template <class T>
+	static uint32_t AddOperand(std::vector<T>& table, std::unique_ptr<T>& value) {
+		table.push_back(std::move(*value));
+		return (uint32_t)(table.size() - 1);
+	}
+
+	static RcPtr<Bytecode> Assemble(std::vector<Instruction>& instructions) {
+		if (optimizationLevel > 0)
+			Optimize(instructions);
+
+		auto code = MakeRcPtr<Bytecode>();
+		code->ops.reserve(instructions.size());
+
+		for (size_t i = 0; i < instructions.size(); i++) {
+			auto& instr = instructions[i];
+
+			uint32_t operand = 0;
+			if (instr.jump) operand = (uint32_t)instr.jump->location;
+			else if (instr.literal) operand = AddOperand(code->literals, instr.literal);
+			else if (instr.string) operand = AddOperand(code->strings, instr.string);
+			else if (instr.variable) operand = AddOperand(code->variables, instr.variable);
+			else if (instr.directAssign) operand = AddOperand(code->directAssigns, instr.directAssign);
+			else if (instr.operation) operand = AddOperand(code->operations, instr.operation);
+			else if (instr.def) operand = AddOperand(code->defs, instr.def);
+			else if (instr.klass) operand = AddOperand(code->classes, instr.klass);
+			else if (instr.pushTry) operand = AddOperand(code->tryFrames, instr.pushTry);
+			else if (instr.queuedJump) operand = AddOperand(code->queuedJumps, instr.queuedJump);
+			else if (instr.import) operand = AddOperand(code->imports, instr.import);
+			else if (instr.importFrom) operand = AddOperand(code->importFroms, instr.importFrom);
+			code->ops.push_back({ instr.type, 0, operand });
+
+			// Only lines are shown in tracebacks so a new entry is only needed when the line changes
+			if (code->lineTable.empty() || code->lineTable.back().second.line != instr.srcPos.line)
+				code->lineTable.push_back({ (uint32_t)i, instr.srcPos });
+		}
+
+		SelectHandlers(*code);
+		return code;
+	}
+
+	static bool IsComparison(Wg_BinOp op) {
+		switch (op) {
+		case WG_BOP_EQ:
+		case WG_BOP_NE:
+		case WG_BOP_LT:
+		case WG_BOP_LE:
+		case WG_BOP_GT:
+		case WG_BOP_GE:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void SelectHandlers(Bytecode& code) {
+		using Type = Instruction::Type;
+		auto& ops = code.ops;
+		for (auto& op : ops)
+			op.handler = (uint8_t)op.type;
+
+		// Sequences never cross a line so that tracebacks stay accurate
+		for (size_t line = 0; line < code.lineTable.size(); line++) {
+			size_t end = line + 1 < code.lineTable.size() ? code.lineTable[line + 1].first : ops.size();
+			end = std::min(end, ops.size());
+			auto is = [&](size_t i, Type type) { return i < end && ops[i].type == type; };
+			auto isLoad = [&](size_t i) { return is(i, Type::Variable) || is(i, Type::Literal); };
+
+			for (size_t i = code.lineTable[line].first; i < end; i++) {
+				if (is(i, Type::Variable) && isLoad(i + 1) && is(i + 2, Type::Operation)
+					&& ops[i + 2].operand < code.operations.size()
+					&& IsComparison(code.operations[ops[i + 2].operand].op)
+					&& (is(i + 3, Type::JumpIfFalsePop) || is(i + 3, Type::JumpIfTruePop))) {
+					ops[i].handler = (uint8_t)SuperInstruction::CompareJump;
+				} else if (is(i, Type::Variable) && is(i + 1, Type::Dot)) {
+					ops[i].handler = (uint8_t)SuperInstruction::VariableDot;
+				} else if (is(i, Type::PushArgFrame) && isLoad(i + 1)) {
+					size_t j = i + 1;
+					while (isLoad(j))
+						j++;
+					if (is(j, Type::Call))
+						ops[i].handler = (uint8_t)SuperInstruction::SimpleCall;
+				}
+			}
+		}
+	}
+
+	size_t Bytecode::FindLine(size_t pc) const {
+		auto it = std::upper_bound(
+			lineTable.begin(),
+			lineTable.end(),
+			pc,
+			[](size_t pc, const auto& entry) { return pc < entry.first; }
+		);
+		return it == lineTable.begin() ? 0 : (size_t)(it - lineTable.begin() - 1);
+	}
+
+	RcPtr<Bytecode> Compile(const stat::Root& parseTree, int optimizationLevel) {
+		wings::optimizationLevel = optimizationLevel;
 		std::vector<Instruction> instructions;
-		CompileBody(parseTree.expr.def.body, instructions);
+		CompileBody(parseTree.expr.def->body, instructions);
 
-		return instructions;
+		return Assemble(instructions);
 	}
 
 }
@@ -2,26 +2,59 @@
 #include "wings.h"
 #include "parse.h"
 #include "rcptr.h"
+#include "attributetable.h"
 
 #include <string>
 #include <vector>
 #include <variant>
 #include <memory>
+#include <cstdint>
 
 namespace wings {
-	struct Instruction;
+	struct Bytecode;
+
+	// Where a variable lives at runtime. Locals index into the executor's
+	// flat slot array. Cells are heap allocated so that they can be shared
+	// with closures. Anything else is looked up by name in the module globals.
+	struct VariableSlot {
+		enum class Type {
+			Global,
+			Local,
+			Cell,
+		} type{};
+		size_t index{};
+	};
 
 	struct DefInstruction {
 		size_t defaultParameterCount{};
 		std::string prettyName;
 		bool isMethod = false;
-		std::vector<Parameter> parameters;
+		// Calls create a generator instead of running the body
+		bool isGenerator = false;
+		// Names of the positional parameters. Their default
+		// values are compiled into the enclosing function.
+		std::vector<std::string> parameters;
 		std::vector<std::string> globalCaptures;
 		std::vector<std::string> localCaptures;
 		std::vector<std::string> variables;
-		RcPtr<std::vector<Instruction>> instructions;
+		RcPtr<Bytecode> code;
 		std::optional<std::string> listArgs;
 		std::optional<std::string> kwArgs;
+
+		// Slots in the new function's frame
+		size_t localCount{};
+		size_t cellCount{};
+		std::vector<VariableSlot> parameterSlots;
+		VariableSlot listArgsSlot;
+		VariableSlot kwArgsSlot;
+		// Whether the positional parameters occupy consecutive locals
+		// starting at firstParameterLocal, so that plain positional
+		// calls can copy their arguments straight into the frame.
+		bool contiguousParameters = false;
+		size_t firstParameterLocal{};
+		// Slots in the enclosing frame to capture from.
+		// Capture i is placed in cell i of the new frame.
+		std::vector<VariableSlot> localCaptureSlots;
 	};
 
 	struct ClassInstruction {
@@ -29,18 +62,45 @@ namespace wings {
 		std::string prettyName;
 	};
 
-	using LiteralInstruction = std::variant<std::nullptr_t, bool, Wg_int, Wg_float, std::string>;
+	struct TupleLiteral;
+	struct BytesLiteral;
+	using LiteralInstruction = std::variant<std::nullptr_t, bool, Wg_int, Wg_float, std::string, TupleLiteral, BytesLiteral>;
 
+	// A tuple of constants folded by the optimizer
+	struct TupleLiteral {
+		std::vector<LiteralInstruction> items;
+	};
+
+	// A new bytes object is created every time the literal is evaluated
+	struct BytesLiteral {
+		std::string data;
+	};
+
+	// Dot, LoadMethod and MemberAssign skip the attribute lookup
+	// with the inline cache of the same index in CodeCaches
 	struct StringArgInstruction {
 		std::string string;
 	};
 
+	struct OperationInstruction {
+		Wg_BinOp op;
+		// Special method to call when the operands are not plain builtins
+		std::string method;
+	};
+
 	struct JumpInstruction {
 		size_t location;
 	};
 
+	struct VariableInstruction {
+		std::string name;
+		VariableSlot slot;
+	};
+
 	struct DirectAssignInstruction {
 		AssignTarget assignTarget;
+		// Slots of the direct targets in depth first order
+		std::vector<VariableSlot> slots;
 	};
 
 	struct TryFrameInstruction {
@@ -64,8 +124,11 @@ namespace wings {
 		std::string alias;
 	};
 
+	// The compiler's intermediate form of an instruction.
+	// Function bodies are assembled into Bytecode once compiled.
+	// Changing the opcodes requires bumping BYTECODE_FORMAT_VERSION.
 	struct Instruction {
-		enum class Type {
+		enum class Type : uint8_t {
 			Literal,
 			Tuple, List, Map, Set,
 			Slice,
@@ -85,10 +148,13 @@ namespace wings {
 
 			Jump,
 			JumpIfFalsePop,
+			JumpIfTruePop,
 			JumpIfFalse,
 			JumpIfTrue,
 			Return,
 			QueueJump,
+			GetIter,
+			ForIter,
 
 			Raise,
 			PushTry,
@@ -99,16 +165,21 @@ namespace wings {
 			EndFinally,
 
 			Call,
+			LoadMethod,
+			CallMethod,
 			PushArgFrame,
 			Unpack,
 			UnpackMapForMapCreation,
 			UnpackMapForCall,
 			PushKwarg,
+			Yield,
 		} type{};
 
 		std::unique_ptr<DirectAssignInstruction> directAssign;
 		std::unique_ptr<LiteralInstruction> literal;
+		std::unique_ptr<VariableInstruction> variable;
 		std::unique_ptr<StringArgInstruction> string;
+		std::unique_ptr<OperationInstruction> operation;
 		std::unique_ptr<DefInstruction> def;
 		std::unique_ptr<ClassInstruction> klass;
 		std::unique_ptr<JumpInstruction> jump;
@@ -120,5 +191,55 @@ namespace wings {
 		SourcePosition srcPos;
 	};
 
-	std::vector<Instruction> Compile(const stat::Root& parseTree);
+	// Fused handlers for common instruction sequences. Their values follow the
+	// opcodes so that both share a dispatch table. They are never serialized
+	// and the instructions they cover are kept, so jumps into the middle of a
+	// sequence and the disassembly are unaffected.
+	enum class SuperInstruction : uint8_t {
+		// Variable, then Variable or Literal, then a comparison Operation, then JumpIfFalsePop or JumpIfTruePop
+		CompareJump = (uint8_t)Instruction::Type::Yield + 1,
+		// Variable, then Dot
+		VariableDot,
+		// PushArgFrame, then a Variable or Literal for the function and each argument, then Call
+		SimpleCall,
+	};
+
+	constexpr size_t HANDLER_COUNT = (size_t)SuperInstruction::SimpleCall + 1;
+
+	// The executable form of a function body. Each instruction is an opcode
+	// and a 32 bit operand, which is either a jump location or an index into
+	// the table matching the opcode.
+	struct Bytecode {
+		struct Op {
+			Instruction::Type type;
+			// Either the opcode or the SuperInstruction starting at this op
+			uint8_t handler;
+			uint32_t operand;
+		};
+
+		// Gets the index into lineTable covering the instruction at pc
+		size_t FindLine(size_t pc) const;
+
+		std::vector<Op> ops;
+		// Each entry covers the instructions from its index up to the next entry
+		std::vector<std::pair<uint32_t, SourcePosition>> lineTable;
+
+		std::vector<LiteralInstruction> literals;
+		std::vector<StringArgInstruction> strings;
+		std::vector<VariableInstruction> variables;
+		std::vector<DirectAssignInstruction> directAssigns;
+		std::vector<OperationInstruction> operations;
+		std::vector<DefInstruction> defs;
+		std::vector<ClassInstruction> classes;
+		std::vector<TryFrameInstruction> tryFrames;
+		std::vector<QueuedJumpInstruction> queuedJumps;
+		std::vector<ImportInstruction> imports;
+		std::vector<ImportFromInstruction> importFroms;
+	};
+
+	// Picks the handler of every op. Must be called on bytecode once it is assembled or read.
+	void SelectHandlers(Bytecode& code);
+
+	// Instructions are passed through Optimize when optimizationLevel is above 0
+	RcPtr<Bytecode> Compile(const stat::Root& parseTree, int optimizationLevel);
 }
@@ -0,0 +1,378 @@
+#include "contextpool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <optional>
+
+namespace wings {
+
+	static bool ExportPlainValue(Wg_Obj* obj, PlainValue& out, std::vector<const Wg_Obj*>& parents) {
+		using Type = PlainValue::Type;
+		Wg_Context* context = obj->context;
+
+		if (Wg_IsNone(obj)) {
+			out.type = Type::None;
+			return true;
+		} else if (Wg_IsBool(obj)) {
+			out.type = Type::Bool;
+			out.b = Wg_GetBool(obj);
+			return true;
+		} else if (Wg_IsInt(obj)) {
+			out.type = Type::Int;
+			out.i = Wg_GetInt(obj);
+			return true;
+		} else if (obj->type == ObjType::Float) {
+			out.type = Type::Float;
+			out.f = Wg_GetFloat(obj);
+			return true;
+		} else if (Wg_IsString(obj)) {
+			out.type = Type::Str;
+			out.s = Wg_GetString(obj);
+			return true;
+		}
+
+		if (std::find(parents.begin(), parents.end(), obj) != parents.end()) {
+			Wg_RaiseException(context, WG_EXC_VALUEERROR, "cannot marshal a recursive object");
+			return false;
+		}
+
+		std::vector<Wg_Obj*> children;
+		if (Wg_IsTuple(obj) || Wg_IsList(obj)) {
+			out.type = Wg_IsTuple(obj) ? Type::Tuple : Type::List;
+			children = obj->Get<std::vector<Wg_Obj*>>();
+		} else if (Wg_IsDictionary(obj)) {
+			out.type = Type::Dict;
+			for (const auto& [key, value] : obj->Get<WDict>()) {
+				children.push_back(key);
+				children.push_back(value);
+			}
+		} else if (Wg_IsSet(obj)) {
+			out.type = Type::Set;
+			for (Wg_Obj* value : obj->Get<WSet>())
+				children.push_back(value);
+		} else {
+			std::string msg = "cannot marshal '" + WObjTypeToString(obj) + "' object";
+			Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+			return false;
+		}
+
+		parents.push_back(obj);
+		out.items.resize(children.size());
+		for (size_t i = 0; i < children.size(); i++) {
+			if (!ExportPlainValue(children[i], out.items[i], parents))
+				return false;
+		}
+		parents.pop_back();
+		return true;
+	}
+
+	bool ExportPlainValue(Wg_Obj* obj, PlainValue& out) {
+		std::vector<const Wg_Obj*> parents;
+		return ExportPlainValue(obj, out, parents);
+	}
+
+	Wg_Obj* ImportPlainValue(Wg_Context* context, const PlainValue& value) {
+		using Type = PlainValue::Type;
+		switch (value.type) {
+		case Type::None: return Wg_None(context);
+		case Type::Bool: return Wg_NewBool(context, value.b);
+		case Type::Int: return Wg_NewInt(context, value.i);
+		case Type::Float: return Wg_NewFloat(context, value.f);
+		case Type::Str: return Wg_NewStringBuffer(context, value.s.data(), (int)value.s.size());
+		default: break;
+		}
+
+		std::vector<Wg_ObjRef> refs;
+		std::vector<Wg_Obj*> items;
+		for (const auto& item : value.items) {
+			Wg_Obj* obj = ImportPlainValue(context, item);
+			if (obj == nullptr)
+				return nullptr;
+			refs.emplace_back(obj);
+			items.push_back(obj);
+		}
+
+		int count = (int)items.size();
+		switch (value.type) {
+		case Type::Tuple: return Wg_NewTuple(context, items.data(), count);
+		case Type::List: return Wg_NewList(context, items.data(), count);
+		case Type::Set: return Wg_NewSet(context, items.data(), count);
+		case Type::Dict: {
+			std::vector<Wg_Obj*> keys, values;
+			for (size_t i = 0; i < items.size(); i += 2) {
+				keys.push_back(items[i]);
+				values.push_back(items[i + 1]);
+			}
+			return Wg_NewDictionary(context, keys.data(), values.data(), (int)keys.size());
+		}
+		default: WG_UNREACHABLE();
+		}
+	}
+
+	struct FutureState {
+		std::mutex mutex;
+		std::condition_variable done;
+		bool ready = false;
+		bool success = false;
+		PlainValue result;
+		// The class name and message of the exception raised by a failed job
+		std::string exceptionType;
+		std::string exceptionMessage;
+	};
+
+	struct PoolJob {
+		enum class Kind {
+			Execute,
+			Expression,
+			Call,
+		} kind{};
+		// The script, or the name of the global function to call
+		std::string source;
+		std::string prettyName;
+		std::vector<PlainValue> args;
+		RcPtr<FutureState> future;
+	};
+
+	struct PoolWorker {
+		Wg_Context* context{};
+		std::mutex mutex;
+		std::deque<PoolJob> jobs;
+		std::thread thread;
+	};
+
+	static Wg_Obj* RunJob(Wg_Context* context, const PoolJob& job) {
+		switch (job.kind) {
+		case PoolJob::Kind::Execute: {
+			if (!Wg_Execute(context, job.source.c_str(), job.prettyName.c_str()))
+				return nullptr;
+			return Wg_None(context);
+		}
+		case PoolJob::Kind::Expression:
+			return Wg_ExecuteExpression(context, job.source.c_str(), job.prettyName.c_str());
+		case PoolJob::Kind::Call: {
+			Wg_Obj* fn = Wg_GetGlobal(context, job.source.c_str());
+			if (fn == nullptr) {
+				Wg_RaiseNameError(context, job.source.c_str());
+				return nullptr;
+			}
+			Wg_ObjRef fnRef(fn);
+
+			std::vector<Wg_ObjRef> refs;
+			std::vector<Wg_Obj*> argv;
+			for (const auto& arg : job.args) {
+				Wg_Obj* obj = ImportPlainValue(context, arg);
+				if (obj == nullptr)
+					return nullptr;
+				refs.emplace_back(obj);
+				argv.push_back(obj);
+			}
+			return Wg_Call(fn, argv.data(), (int)argv.size());
+		}
+		default:
+			WG_UNREACHABLE();
+		}
+	}
+
+	static bool IsSubclass(Wg_Obj* klass, Wg_Obj* base) {
+		if (klass == base)
+			return true;
+		for (Wg_Obj* parent : klass->Get<Wg_Obj::Class>().bases)
+			if (IsSubclass(parent, base))
+				return true;
+		return false;
+	}
+
+	static void CompleteJob(Wg_Context* context, const PoolJob& job) {
+		FutureState& future = *job.future;
+		Wg_Obj* result = RunJob(context, job);
+		bool success = result && ExportPlainValue(result, future.result);
+
+		if (!success) {
+			Wg_Obj* exc = Wg_GetException(context);
+			future.exceptionType = WObjTypeToString(exc);
+			if (Wg_Obj* msg = Wg_GetAttributeNoExcept(exc, "_message"))
+				if (Wg_IsString(msg))
+					future.exceptionMessage = Wg_GetString(msg);
+			Wg_ClearException(context);
+		}
+
+		std::lock_guard lock(future.mutex);
+		future.success = success;
+		future.ready = true;
+		future.done.notify_all();
+	}
+}
+
+struct Wg_Future {
+	wings::RcPtr<wings::FutureState> state;
+};
+
+struct Wg_ContextPool {
+	std::vector<std::unique_ptr<wings::PoolWorker>> workers;
+	// Guards stopping and pending so that idle workers do not miss new jobs
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+	size_t pending = 0;
+	std::atomic<size_t> nextWorker = 0;
+
+	// Takes the oldest job of a worker, or steals the newest job of another worker
+	std::optional<wings::PoolJob> TakeJob(size_t self) {
+		for (size_t i = 0; i < workers.size(); i++) {
+			auto& worker = *workers[(self + i) % workers.size()];
+			std::lock_guard lock(worker.mutex);
+			if (worker.jobs.empty())
+				continue;
+
+			std::optional<wings::PoolJob> job;
+			if (i == 0) {
+				job = std::move(worker.jobs.front());
+				worker.jobs.pop_front();
+			} else {
+				job = std::move(worker.jobs.back());
+				worker.jobs.pop_back();
+			}
+			return job;
+		}
+		return std::nullopt;
+	}
+
+	void Work(size_t self) {
+		while (true) {
+			if (auto job = TakeJob(self)) {
+				{
+					std::lock_guard lock(mutex);
+					pending--;
+				}
+				wings::CompleteJob(workers[self]->context, *job);
+				continue;
+			}
+
+			std::unique_lock lock(mutex);
+			if (stopping && pending == 0)
+				return;
+			wake.wait(lock, [&] { return stopping || pending > 0; });
+		}
+	}
+
+	Wg_Future* Submit(wings::PoolJob job) {
+		auto future = wings::MakeRcPtr<wings::FutureState>();
+		job.future = future;
+
+		// The job is counted before it can be taken so that pending never wraps below zero
+		auto& worker = *workers[nextWorker++ % workers.size()];
+		{
+			std::lock_guard lock(mutex);
+			pending++;
+			std::lock_guard jobsLock(worker.mutex);
+			worker.jobs.push_back(std::move(job));
+		}
+		wake.notify_one();
+		return new Wg_Future{ std::move(future) };
+	}
+};
+
+extern "C" {
+	Wg_ContextPool* Wg_CreateContextPool(const Wg_Config* config, const Wg_Snapshot* snapshot, int threadCount) {
+		WG_ASSERT(threadCount >= 0);
+		if (threadCount == 0)
+			threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+
+		auto pool = new Wg_ContextPool();
+		for (int i = 0; i < threadCount; i++) {
+			auto worker = std::make_unique<wings::PoolWorker>();
+			worker->context = snapshot ? Wg_CreateContextFromSnapshot(snapshot) : Wg_CreateContext(config);
+			if (worker->context == nullptr) {
+				Wg_DestroyContextPool(pool);
+				return nullptr;
+			}
+			pool->workers.push_back(std::move(worker));
+		}
+
+		for (size_t i = 0; i < pool->workers.size(); i++)
+			pool->workers[i]->thread = std::thread([pool, i] { pool->Work(i); });
+		return pool;
+	}
+
+	void Wg_DestroyContextPool(Wg_ContextPool* pool) {
+		WG_ASSERT_VOID(pool);
+		{
+			std::lock_guard lock(pool->mutex);
+			pool->stopping = true;
+		}
+		pool->wake.notify_all();
+
+		for (auto& worker : pool->workers) {
+			if (worker->thread.joinable())
+				worker->thread.join();
+			Wg_DestroyContext(worker->context);
+		}
+		delete pool;
+	}
+
+	Wg_Future* Wg_SubmitExecute(Wg_ContextPool* pool, const char* script, const char* prettyName) {
+		WG_ASSERT(pool && script);
+		wings::PoolJob job{ wings::PoolJob::Kind::Execute, script, prettyName ? prettyName : wings::DEFAULT_FUNC_NAME };
+		return pool->Submit(std::move(job));
+	}
+
+	Wg_Future* Wg_SubmitExecuteExpression(Wg_ContextPool* pool, const char* script, const char* prettyName) {
+		WG_ASSERT(pool && script);
+		wings::PoolJob job{ wings::PoolJob::Kind::Expression, script, prettyName ? prettyName : wings::DEFAULT_FUNC_NAME };
+		return pool->Submit(std::move(job));
+	}
+
+	Wg_Future* Wg_SubmitCall(Wg_ContextPool* pool, const char* function, Wg_Obj** argv, int argc) {
+		WG_ASSERT(pool && function && argc >= 0 && wings::IsValidIdentifier(function));
+		if (argc > 0) {
+			WG_ASSERT(argv);
+			for (int i = 0; i < argc; i++)
+				WG_ASSERT(argv[i]);
+		}
+
+		wings::PoolJob job{ wings::PoolJob::Kind::Call, function };
+		job.args.resize(argc);
+		for (int i = 0; i < argc; i++) {
+			if (!wings::ExportPlainValue(argv[i], job.args[i]))
+				return nullptr;
+		}
+		return pool->Submit(std::move(job));
+	}
+
+	bool Wg_IsFutureReady(Wg_Future* future) {
+		WG_ASSERT(future);
+		std::lock_guard lock(future->state->mutex);
+		return future->state->ready;
+	}
+
+	Wg_Obj* Wg_GetFutureResult(Wg_Future* future, Wg_Context* context) {
+		WG_ASSERT(future && context);
+		wings::FutureState& state = *future->state;
+		{
+			std::unique_lock lock(state.mutex);
+			state.done.wait(lock, [&] { return state.ready; });
+		}
+
+		if (state.success)
+			return wings::ImportPlainValue(context, state.result);
+
+		// Raise the same exception type if it is a builtin exception
+		const auto& builtins = context->globals.at("__builtins__");
+		auto it = builtins.find(state.exceptionType);
+		if (it != builtins.end() && Wg_IsClass(*it->second)
+			&& wings::IsSubclass(*it->second, context->builtins.baseException)) {
+			Wg_RaiseExceptionClass(*it->second, state.exceptionMessage.c_str());
+		} else {
+			std::string msg = state.exceptionType + ": " + state.exceptionMessage;
+			Wg_RaiseException(context, WG_EXC_RUNTIMEERROR, msg.c_str());
+		}
+		return nullptr;
+	}
+
+	void Wg_DestroyFuture(Wg_Future* future) {
+		WG_ASSERT_VOID(future);
+		delete future;
+	}
+}
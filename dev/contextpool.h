@@ -0,0 +1,36 @@
+#pragma once
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+namespace wings {
+	// A copy of plain data that does not belong to any context, so that it
+	// can be passed between contexts on different threads. Plain data is None,
+	// bool, int, float, str, and tuples, lists, dicts and sets of plain data.
+	struct PlainValue {
+		enum class Type : uint8_t {
+			None,
+			Bool,
+			Int,
+			Float,
+			Str,
+			Tuple,
+			List,
+			Dict,
+			Set,
+		} type = Type::None;
+		bool b{};
+		Wg_int i{};
+		Wg_float f{};
+		std::string s;
+		// The keys and values of a dict are stored alternately
+		std::vector<PlainValue> items;
+	};
+
+	// Raises a TypeError and returns false if the object is not plain data
+	bool ExportPlainValue(Wg_Obj* obj, PlainValue& out);
+
+	// Creates the objects described by a value in a context. Returns null on failure.
+	Wg_Obj* ImportPlainValue(Wg_Context* context, const PlainValue& value);
+}
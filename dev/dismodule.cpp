@@ -33,6 +33,19 @@ namespace wings {
 				return std::to_string(std::get<Wg_float>(literal));
 			} else if (std::holds_alternative<std::string>(literal)) {
 				return "\"" + std::get<std::string>(literal) + "\"";
+			} else if (auto* tuple = std::get_if<TupleLiteral>(&literal)) {
+				std::string s = "(";
+				for (const auto& item : tuple->items) {
+					s += LiteralToString(item);
+					s += ", ";
+				}
+				if (tuple->items.size() > 1) {
+					s.pop_back();
+					s.pop_back();
+				} else if (!tuple->items.empty()) {
+					s.pop_back();
+				}
+				return s + ")";
 			} else {
 				WG_UNREACHABLE();
 			}
@@ -56,52 +69,60 @@ namespace wings {
 			}
 
 			struct Func {
-				const std::vector<Instruction>* instructions;
+				const Bytecode* code;
 				std::string_view name;
 			};
 
 			std::queue<Func> functions;
 			DefObject* def = (DefObject*)fn.userdata;
-			functions.push(Func{ &*def->instructions, def->prettyName });
+			functions.push(Func{ def->code.get(), def->prettyName });
 
 			std::string s;
 			while (!functions.empty()) {
 				s += "Function ";
 				s += functions.front().name;
 				s += "()\n";
-				const auto* instructions = functions.front().instructions;
+				const Bytecode& code = *functions.front().code;
 				functions.pop();
 
-				for (size_t i = 0; i < instructions->size(); i++) {
-					const Instruction& instr = (*instructions)[i];
+				size_t line = 0;
+				for (size_t i = 0; i < code.ops.size(); i++) {
+					const Bytecode::Op& op = code.ops[i];
 
-					if (i == 0 || instr.srcPos.line != (*instructions)[i - 1].srcPos.line) {
+					if (line < code.lineTable.size() && code.lineTable[line].first == i) {
 						if (i)
 							s += "\n";
-						s += PadLeft(instr.srcPos.line + 1, 6) + " ";
+						s += PadLeft(code.lineTable[line].second.line + 1, 6) + " ";
+						line++;
 					} else {
 						s += "       ";
 					}
 					s += PadLeft(i, 4) + " ";
 
-					switch (instr.type) {
+					switch (op.type) {
 					case Instruction::Type::DirectAssign:
-						if (instr.directAssign->assignTarget.type == AssignType::Direct) {
+						if (code.directAssigns[op.operand].assignTarget.type == AssignType::Direct) {
 							s += "ASSIGN\t\t";
 						} else {
 							s += "ASSIGN_PACK\t\t";
 						}
-						s += AssignTargetToString(instr.directAssign->assignTarget);
+						s += AssignTargetToString(code.directAssigns[op.operand].assignTarget);
 						break;
 					case Instruction::Type::MemberAssign:
-						s += "ASSIGN_ATTR\t\t" + instr.string->string;
+						s += "ASSIGN_ATTR\t\t" + code.strings[op.operand].string;
 						break;
 					case Instruction::Type::Literal:
-						s += "LOAD_CONST\t\t" + LiteralToString(*instr.literal);
+						s += "LOAD_CONST\t\t" + LiteralToString(code.literals[op.operand]);
 						break;
 					case Instruction::Type::Call:
 						s += "CALL";
 						break;
+					case Instruction::Type::LoadMethod:
+						s += "LOAD_METHOD\t\t" + code.strings[op.operand].string;
+						break;
+					case Instruction::Type::CallMethod:
+						s += "CALL_METHOD";
+						break;
 					case Instruction::Type::Return:
 						s += "RETURN";
 						break;
@@ -112,22 +133,31 @@ namespace wings {
 						s += "BEGIN_ARGS";
 						break;
 					case Instruction::Type::Dot:
-						s += "GET_ATTR\t\t" + instr.string->string;
+						s += "GET_ATTR\t\t" + code.strings[op.operand].string;
 						break;
 					case Instruction::Type::Variable:
-						s += "LOAD_VAR\t\t" + instr.string->string;
+						s += "LOAD_VAR\t\t" + code.variables[op.operand].name;
 						break;
 					case Instruction::Type::Jump:
-						s += "JUMP\t\tto " + std::to_string(instr.jump->location);
+						s += "JUMP\t\tto " + std::to_string(op.operand);
 						break;
 					case Instruction::Type::JumpIfFalsePop:
-						s += "JUMP_IF_FALSE_POP\tto " + std::to_string(instr.jump->location);
+						s += "JUMP_IF_FALSE_POP\tto " + std::to_string(op.operand);
+						break;
+					case Instruction::Type::JumpIfTruePop:
+						s += "JUMP_IF_TRUE_POP\tto " + std::to_string(op.operand);
 						break;
 					case Instruction::Type::JumpIfFalse:
-						s += "JUMP_IF_FALSE\tto " + std::to_string(instr.jump->location);
+						s += "JUMP_IF_FALSE\tto " + std::to_string(op.operand);
 						break;
 					case Instruction::Type::JumpIfTrue:
-						s += "JUMP_IF_TRUE\tto " + std::to_string(instr.jump->location);
+						s += "JUMP_IF_TRUE\tto " + std::to_string(op.operand);
+						break;
+					case Instruction::Type::GetIter:
+						s += "GET_ITER";
+						break;
+					case Instruction::Type::ForIter:
+						s += "FOR_ITER\tto " + std::to_string(op.operand);
 						break;
 					case Instruction::Type::List:
 						s += "MAKE_LIST";
@@ -148,8 +178,8 @@ namespace wings {
 						s += "RAISE";
 						break;
 					case Instruction::Type::PushTry:
-						s += "BEGIN_TRY\t\t" + std::to_string(instr.pushTry->exceptJump)
-							+ ", " + std::to_string(instr.pushTry->finallyJump);
+						s += "BEGIN_TRY\t\t" + std::to_string(code.tryFrames[op.operand].exceptJump)
+							+ ", " + std::to_string(code.tryFrames[op.operand].finallyJump);
 						break;
 					case Instruction::Type::PopTry:
 						s += "END_TRY";
@@ -161,32 +191,38 @@ namespace wings {
 						s += "LOAD_IS_INSTANCE";
 						break;
 					case Instruction::Type::Import:
-						s += "IMPORT\t\t" + instr.import->module;
-						if (!instr.import->alias.empty())
-							s += " as " + instr.import->alias;
+						s += "IMPORT\t\t" + code.imports[op.operand].module;
+						if (!code.imports[op.operand].alias.empty())
+							s += " as " + code.imports[op.operand].alias;
 						break;
 					case Instruction::Type::ImportFrom:
-						if (instr.importFrom->names.empty()) {
-							s += "IMPORT_ALL\t\t" + instr.importFrom->module;
-						} else if (!instr.importFrom->alias.empty()) {
-							s += "IMPORT_FROM\t\tfrom " + instr.importFrom->module
-								+ " import " + instr.importFrom->names[0]
-								+ " as " + instr.importFrom->alias;
+						if (code.importFroms[op.operand].names.empty()) {
+							s += "IMPORT_ALL\t\t" + code.importFroms[op.operand].module;
+						} else if (!code.importFroms[op.operand].alias.empty()) {
+							s += "IMPORT_FROM\t\tfrom " + code.importFroms[op.operand].module
+								+ " import " + code.importFroms[op.operand].names[0]
+								+ " as " + code.importFroms[op.operand].alias;
 						} else {
-							s += "IMPORT_FROM\t\tfrom " + instr.importFrom->module + " import ";
-							for (const auto& name : instr.importFrom->names) {
+							s += "IMPORT_FROM\t\tfrom " + code.importFroms[op.operand].module + " import ";
+							for (const auto& name : code.importFroms[op.operand].names) {
 								s += name + ", ";
 							}
 							s.pop_back();
 							s.pop_back();
 						}
 						break;
+					case Instruction::Type::Operation:
+						s += "BINARY_OP\t\t" + code.operations[op.operand].method;
+						break;
 					case Instruction::Type::Is:
 						s += "IS";
 						break;
 					case Instruction::Type::PushKwarg:
 						s += "PUSH_KWARG";
 						break;
+					case Instruction::Type::Yield:
+						s += "YIELD";
+						break;
 					case Instruction::Type::UnpackMapForCall:
 						s += "UNPACK_KWARGS";
 						break;
@@ -197,8 +233,8 @@ namespace wings {
 						s += "UNPACK_ITERABLE";
 						break;
 					case Instruction::Type::Class:
-						s += "MAKE_CLASS\t\t" + instr.klass->prettyName + " [";
-						for (const auto& name : instr.klass->methodNames) {
+						s += "MAKE_CLASS\t\t" + code.classes[op.operand].prettyName + " [";
+						for (const auto& name : code.classes[op.operand].methodNames) {
 							s += name + ", ";
 						}
 						s.pop_back();
@@ -206,9 +242,9 @@ namespace wings {
 						s += "]";
 						break;
 					case Instruction::Type::Def:
-						s += "MAKE_FUNCTION\t" + instr.def->prettyName;
+						s += "MAKE_FUNCTION\t" + code.defs[op.operand].prettyName;
 
-						functions.push(Func{ &*instr.def->instructions, instr.def->prettyName });
+						functions.push(Func{ code.defs[op.operand].code.get(), code.defs[op.operand].prettyName });
 						break;
 					default:
 						s += "???";
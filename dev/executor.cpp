@@ -1,28 +1,280 @@
 #include "executor.h"
 #include "common.h"
+#include "profiler.h"
 
 namespace wings {
 
-	Wg_Obj* DefObject::Run(Wg_Context* context, Wg_Obj** args, int argc) {
-		DefObject* def = (DefObject*)Wg_GetFunctionUserdata(context);
-		Wg_Obj* kwargs = Wg_GetKwargs(context);
+	// Gets the kind of native iteration usable for an iterable, if any
+	static std::optional<ForLoopIterator::Kind> BuiltinIterationKind(Wg_Obj* iterable) {
+		Wg_Context* context = iterable->context;
+		const auto& b = context->builtins;
+		using Kind = ForLoopIterator::Kind;
 
-		Executor executor{};
-		executor.def = def;
-		executor.context = context;
+		switch (iterable->type) {
+		case ObjType::List:
+			return IsUnmodifiedInstance(iterable, b.list) ? std::optional(Kind::Sequence) : std::nullopt;
+		case ObjType::Tuple:
+			return IsUnmodifiedInstance(iterable, b.tuple) ? std::optional(Kind::Sequence) : std::nullopt;
+		case ObjType::Str:
+			return IsUnmodifiedInstance(iterable, b.str) ? std::optional(Kind::String) : std::nullopt;
+		case ObjType::Map:
+			return IsUnmodifiedInstance(iterable, b.dict) ? std::optional(Kind::DictKeys) : std::nullopt;
+		case ObjType::Set:
+			return IsUnmodifiedInstance(iterable, b.set) ? std::optional(Kind::Set) : std::nullopt;
+		default:
+			break;
+		}
 
-		// Create local variables
-		for (const auto& localVar : def->localVariables) {
-			Wg_Obj* null = Wg_None(def->context);
-			executor.variables.insert({ localVar, MakeRcPtr<Wg_Obj*>(null) });
+		if (b.range && iterable->attributes.Get("__class__") == b.range)
+			return Kind::Range;
+
+		if (GetBuffer(iterable)) {
+			Wg_Obj* klass = iterable->attributes.Get("__class__");
+			if (klass == b.bytes || klass == b.bytearray || klass == b.memoryview)
+				return Kind::Buffer;
 		}
 
-		// Add captures
-		for (const auto& capture : def->captures) {
-			executor.variables.insert(capture);
+		// The native dict and set iterators returned by keys(), values(), items() and __iter__()
+		auto isType = [&](const char* name) {
+			auto type = context->types.Find(name);
+			return type && iterable->type == type.value();
+		};
+		if (isType("__DictKeysIter")) return Kind::DictKeys;
+		if (isType("__DictValuesIter")) return Kind::DictValues;
+		if (isType("__DictItemsIter")) return Kind::DictItems;
+		if (isType("__SetIter")) return Kind::Set;
+		return std::nullopt;
+	}
+
+	// Gets the iterator used by a for loop. Falls back to calling __iter__
+	// if the iterable is not a builtin or has overridden methods.
+	static Wg_Obj* GetForLoopIterator(Wg_Obj* iterable) {
+		Wg_Context* context = iterable->context;
+		const auto& b = context->builtins;
+		using Kind = ForLoopIterator::Kind;
+
+		// Generators are their own iterators
+		if (iterable->type == ObjType::Generator && IsUnmodifiedInstance(iterable, b.generator))
+			return iterable;
+
+		auto kind = BuiltinIterationKind(iterable);
+		if (!kind)
+			return Wg_CallMethod(iterable, "__iter__", nullptr, 0);
+
+		ForLoopIterator state{};
+		state.kind = kind.value();
+		state.sequence = { iterable, 0 };
+		
+		if (state.kind == Kind::Range) {
+			Wg_Obj* start = iterable->attributes.Get("start");
+			Wg_Obj* stop = iterable->attributes.Get("stop");
+			Wg_Obj* step = iterable->attributes.Get("step");
+			if (!start || !stop || !step || !Wg_IsInt(start) || !Wg_IsInt(stop) || !Wg_IsInt(step))
+				return Wg_CallMethod(iterable, "__iter__", nullptr, 0);
+			state.range = { Wg_GetInt(start), Wg_GetInt(stop), Wg_GetInt(step) };
+		} else if (iterable->type == ObjType::Map || iterable->type == ObjType::Set) {
+			Wg_Obj* klass = iterable->type == ObjType::Map ? b.dictKeysIter : b.setIter;
+			state.sequence.obj = Wg_Call(klass, &iterable, 1);
+			if (state.sequence.obj == nullptr)
+				return nullptr;
 		}
 
-		// Initialise parameters
+		Wg_ObjRef ref(state.kind == Kind::Range ? nullptr : state.sequence.obj);
+		Wg_Obj* obj = Alloc(context);
+		if (obj == nullptr)
+			return nullptr;
+
+		obj->attributes = b.object->Get<Wg_Obj::Class>().instanceAttributes.Copy();
+		obj->type = ObjType::ForIter;
+		obj->EmplaceInline<ForLoopIterator>(state);
+		return obj;
+	}
+
+	template <class Iterator>
+	static Wg_Obj* NextInContainer(Wg_Obj* iterator) {
+		auto* it = (Iterator*)iterator->data;
+		it->Revalidate();
+		if (*it == Iterator{})
+			return nullptr;
+
+		Wg_Obj* value{};
+		if constexpr (std::is_same_v<Iterator, WSet::iterator>) {
+			value = **it;
+		} else {
+			value = (*it)->first;
+		}
+		++(*it);
+		return value;
+	}
+
+	// Gets the next value of a for loop iterator.
+	// Returns null without raising an exception once the iterator is exhausted.
+	static Wg_Obj* NextForLoopValue(Wg_Obj* iterator) {
+		Wg_Context* context = iterator->context;
+		using Kind = ForLoopIterator::Kind;
+
+		if (iterator->type == ObjType::Generator && IsUnmodifiedInstance(iterator, context->builtins.generator))
+			return ResumeGenerator(iterator, nullptr, nullptr);
+
+		if (iterator->type != ObjType::ForIter) {
+			Wg_Obj* value = Wg_CallMethod(iterator, "__next__", nullptr, 0);
+			if (value == nullptr && Wg_IsInstance(Wg_GetException(context), &context->builtins.stopIteration, 1))
+				Wg_ClearException(context);
+			return value;
+		}
+
+		auto& state = iterator->Get<ForLoopIterator>();
+		auto& seq = state.sequence;
+		switch (state.kind) {
+		case Kind::Sequence: {
+			const auto& items = seq.obj->Get<std::vector<Wg_Obj*>>();
+			if (seq.index >= items.size())
+				return nullptr;
+			return items[seq.index++];
+		}
+		case Kind::String: {
+			std::string_view s = GetStringView(seq.obj);
+			if (seq.index >= s.size())
+				return nullptr;
+			return Wg_NewStringBuffer(context, s.data() + seq.index++, 1);
+		}
+		case Kind::Range: {
+			auto& range = state.range;
+			if (range.step > 0 ? range.cur >= range.stop : range.cur <= range.stop)
+				return nullptr;
+			Wg_int cur = range.cur;
+			range.cur += range.step;
+			return Wg_NewInt(context, cur);
+		}
+		case Kind::DictKeys:
+			return NextInContainer<WDict::iterator>(seq.obj);
+		case Kind::DictValues:
+		case Kind::DictItems: {
+			auto* it = (WDict::iterator*)seq.obj->data;
+			it->Revalidate();
+			if (*it == WDict::iterator{})
+				return nullptr;
+
+			auto [key, value] = **it;
+			++(*it);
+			if (state.kind == Kind::DictValues)
+				return value;
+
+			Wg_Obj* pair[2] = { key, value };
+			return Wg_NewTuple(context, pair, 2);
+		}
+		case Kind::Set:
+			return NextInContainer<WSet::iterator>(seq.obj);
+		case Kind::Buffer: {
+			// The length is checked on every iteration since a bytearray can be
+			// resized and a memoryview can be released during the loop
+			std::string_view data = GetBuffer(seq.obj)->View();
+			if (seq.index >= data.size())
+				return nullptr;
+			return Wg_NewInt(context, (unsigned char)data[seq.index++]);
+		}
+		default:
+			WG_UNREACHABLE();
+		}
+	}
+
+	static constexpr size_t MAX_POOLED_EXECUTORS = 64;
+
+	// Returns an executor to the pool of the context once its call has finished
+	static void RecycleExecutor(Wg_Context* context, Executor* executor) {
+		auto& pool = context->executorPool;
+		if (pool.size() >= MAX_POOLED_EXECUTORS) {
+			delete executor;
+			return;
+		}
+
+		executor->def = nullptr;
+		executor->code = nullptr;
+		executor->caches = nullptr;
+		executor->pc = 0;
+		executor->stack.clear();
+		executor->argFrames.clear();
+		executor->kwargNames.clear();
+		executor->locals.clear();
+		executor->cells.clear();
+		executor->returnValue = nullptr;
+		executor->yielded = false;
+		executor->resumeStackSize = 0;
+		executor->caller = nullptr;
+		executor->callee = nullptr;
+		executor->profiled = false;
+		executor->tryFrames.clear();
+		executor->storedException = nullptr;
+		executor->queuedFinallyCount = 0;
+		executor->queuedJump = 0;
+		pool.push_back(executor);
+	}
+
+	// Takes an executor from the pool of the context so that
+	// calls reuse the containers of finished calls
+	static Executor* AcquireExecutor(Wg_Context* context) {
+		auto& pool = context->executorPool;
+		Executor* executor;
+		if (pool.empty()) {
+			executor = new Executor{};
+		} else {
+			executor = pool.back();
+			pool.pop_back();
+		}
+		executor->context = context;
+		return executor;
+	}
+
+	// Borrows an executor for the duration of a call
+	class PooledExecutor {
+	public:
+		PooledExecutor(Wg_Context* context) : context(context), executor(AcquireExecutor(context)) {
+		}
+
+		~PooledExecutor() {
+			if (executor)
+				RecycleExecutor(context, executor);
+		}
+
+		// Keeps the executor after the call returns, for a frame that was suspended
+		Executor* Release() {
+			return std::exchange(executor, nullptr);
+		}
+
+		PooledExecutor(const PooledExecutor&) = delete;
+		PooledExecutor& operator=(const PooledExecutor&) = delete;
+
+		Executor& operator*() const { return *executor; }
+	private:
+		Wg_Context* context;
+		Executor* executor;
+	};
+
+	// Binds the arguments of calls that do not fit the fast path of DefObject::Run.
+	// Parameters are null until they are assigned.
+	static bool BindArguments(Executor& executor, const CallKwargs& kwargs, Wg_Obj** args, int argc) {
+		Wg_Context* context = executor.context;
+		const DefObject* def = executor.def;
+		size_t paramCount = def->parameterNames.size();
+
+		// Parameters are never globals
+		auto param = [&](size_t i) -> Wg_Obj*& {
+			const auto& slot = def->parameterSlots[i];
+			if (slot.type == VariableSlot::Type::Cell)
+				return *executor.cells[slot.index];
+			return executor.locals[slot.index];
+		};
+		auto raise = [&](const std::string& msg) {
+			std::string full;
+			if (!def->prettyName.empty())
+				full = def->prettyName + "() ";
+			full += msg;
+			Wg_RaiseException(context, WG_EXC_TYPEERROR, full.c_str());
+			return false;
+		};
+
+		for (size_t i = 0; i < paramCount; i++)
+			param(i) = nullptr;
 
 		// Set kwargs
 		Wg_Obj* newKwargs = nullptr;
@@ -30,42 +282,42 @@ namespace wings {
 		if (def->kwArgs.has_value()) {
 			newKwargs = Wg_NewDictionary(context);
 			if (newKwargs == nullptr)
-				return nullptr;
+				return false;
 			ref = Wg_ObjRef(newKwargs);
-			executor.variables.insert({ def->kwArgs.value(), MakeRcPtr<Wg_Obj*>(newKwargs)});
-		}
-
-		std::vector<bool> assignedParams(def->parameterNames.size());
-		if (kwargs) {
-			for (const auto& [k, value] : kwargs->Get<WDict>()) {
-				const char* key = Wg_GetString(k);
-				bool found = false;
-				for (size_t i = 0; i < def->parameterNames.size(); i++) {
-					if (def->parameterNames[i] == key) {
-						executor.variables.insert({ key, MakeRcPtr<Wg_Obj*>(value) });
-						assignedParams[i] = true;
-						found = true;
-						break;
-					}
+			executor.SetVariable(def->kwArgs.value(), def->kwArgsSlot, newKwargs);
+		}
+
+		auto bindKeyword = [&](Wg_Obj* k, Wg_Obj* value) {
+			std::string_view key = GetStringView(k);
+			for (size_t i = 0; i < paramCount; i++) {
+				if (def->parameterNames[i] == key) {
+					if (param(i))
+						return raise("got multiple values for argument '" + def->parameterNames[i] + "'");
+					param(i) = value;
+					return true;
 				}
+			}
 
-				if (!found) {
-					if (newKwargs == nullptr) {
-						std::string msg;
-						if (!def->prettyName.empty())
-							msg = def->prettyName + "() ";
-						msg += std::string("got an unexpected keyword argument '") + key + "'";
-						Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
-						return nullptr;
-					}
+			if (newKwargs == nullptr)
+				return raise("got an unexpected keyword argument '" + std::string(key) + "'");
 
-					try {
-						newKwargs->Get<WDict>()[k] = value;
-					} catch (HashException&) {
-						return nullptr;
-					}
-				}
+			try {
+				newKwargs->Get<WDict>()[k] = value;
+				WriteBarrier(newKwargs);
+			} catch (HashException&) {
+				return false;
 			}
+			return true;
+		};
+
+		if (kwargs.dict) {
+			for (const auto& [k, value] : kwargs.dict->Get<WDict>())
+				if (!bindKeyword(k, value))
+					return false;
+		} else {
+			for (int i = 0; i < kwargs.count; i++)
+				if (!bindKeyword(kwargs.names[i], kwargs.values[i]))
+					return false;
 		}
 
 		// Set positional args
@@ -73,51 +325,34 @@ namespace wings {
 		if (def->listArgs.has_value()) {
 			listArgs = Wg_NewTuple(context, nullptr, 0);
 			if (listArgs == nullptr)
-				return nullptr;
-			executor.variables.insert({ def->listArgs.value(), MakeRcPtr<Wg_Obj*>(listArgs) });
+				return false;
+			executor.SetVariable(def->listArgs.value(), def->listArgsSlot, listArgs);
 		}
 
 		for (size_t i = 0; i < (size_t)argc; i++) {
-			if (i < def->parameterNames.size()) {
-				if (assignedParams[i]) {
-					std::string msg;
-					if (!def->prettyName.empty())
-						msg = def->prettyName + "() ";
-					msg += "got multiple values for argument '" + def->parameterNames[i] + "'";
-					Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
-					return nullptr;
-				}
-				executor.variables.insert({ def->parameterNames[i], MakeRcPtr<Wg_Obj*>(args[i]) });
-				assignedParams[i] = true;
-			} else {
-				if (listArgs == nullptr) {
-					std::string msg;
-					if (!def->prettyName.empty())
-						msg = def->prettyName + "() ";
-					msg += "takes " + std::to_string(def->parameterNames.size())
-						+ " positional argument(s) but " + std::to_string(argc)
-						+ (argc == 1 ? " was given" : " were given");
-					Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
-					return nullptr;
-				}
+			if (i < paramCount) {
+				if (param(i))
+					return raise("got multiple values for argument '" + def->parameterNames[i] + "'");
+				param(i) = args[i];
+			} else if (listArgs) {
 				listArgs->Get<std::vector<Wg_Obj*>>().push_back(args[i]);
+			} else {
+				return raise("takes " + std::to_string(paramCount)
+					+ " positional argument(s) but " + std::to_string(argc)
+					+ (argc == 1 ? " was given" : " were given"));
 			}
 		}
-		
+
 		// Set default args
-		size_t defaultableArgsStart = def->parameterNames.size() - def->defaultParameterValues.size();
-		for (size_t i = 0; i < def->defaultParameterValues.size(); i++) {
-			size_t index = defaultableArgsStart + i;
-			if (!assignedParams[index]) {
-				executor.variables.insert({ def->parameterNames[index], MakeRcPtr<Wg_Obj*>(def->defaultParameterValues[i]) });
-				assignedParams[index] = true;
-			}
-		}
+		size_t defaultableArgsStart = paramCount - def->defaultParameterValues.size();
+		for (size_t i = 0; i < def->defaultParameterValues.size(); i++)
+			if (param(defaultableArgsStart + i) == nullptr)
+				param(defaultableArgsStart + i) = def->defaultParameterValues[i];
 
 		// Check for unassigned arguments
 		std::string unassigned;
-		for (size_t i = 0; i < def->parameterNames.size(); i++)
-			if (!assignedParams[i])
+		for (size_t i = 0; i < paramCount; i++)
+			if (param(i) == nullptr)
 				unassigned += std::to_string(i + 1) + ", ";
 		if (!unassigned.empty()) {
 			unassigned.pop_back();
@@ -127,12 +362,208 @@ namespace wings {
 				+ " missing parameter(s) "
 				+ unassigned;
 			Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// Creates the variables of a call and binds its arguments
+	static bool InitialiseFrame(Executor& executor, const CallKwargs& kwargs, Wg_Obj** args, int argc) {
+		Wg_Context* context = executor.context;
+		const DefObject* def = executor.def;
+
+		// Create local variables
+		executor.locals.resize(def->localCount, Wg_None(context));
+		executor.cells.reserve(def->cellCount);
+		executor.cells.insert(executor.cells.end(), def->captures.begin(), def->captures.end());
+		while (executor.cells.size() < def->cellCount)
+			executor.cells.push_back(MakeRcPtr<Wg_Obj*>(Wg_None(context)));
+
+		// Initialise parameters
+		size_t paramCount = def->parameterNames.size();
+		size_t defaultCount = def->defaultParameterValues.size();
+		bool positionalOnly = kwargs.dict == nullptr && kwargs.count == 0
+			&& !def->listArgs.has_value() && !def->kwArgs.has_value();
+		if (positionalOnly && def->contiguousParameters
+			&& (size_t)argc <= paramCount && (size_t)argc + defaultCount >= paramCount) {
+			// Copy the arguments and the missing defaults straight into the frame
+			Wg_Obj** frame = executor.locals.data() + def->firstParameterLocal;
+			const auto& defaults = def->defaultParameterValues;
+			std::copy(args, args + argc, frame);
+			std::copy(defaults.end() - (paramCount - argc), defaults.end(), frame + argc);
+			return true;
+		}
+		return BindArguments(executor, kwargs, args, argc);
+	}
+
+	// Calling a generator function only binds the arguments. The body runs once the generator is resumed.
+	static Wg_Obj* NewGenerator(Wg_Context* context, DefObject* def, const CallKwargs& kwargs, Wg_Obj** args, int argc) {
+		Wg_Obj* obj = Alloc(context);
+		if (obj == nullptr)
+			return nullptr;
+
+		obj->attributes = context->builtins.generator->Get<Wg_Obj::Class>().instanceAttributes.Copy();
+		obj->type = ObjType::Generator;
+		auto* gen = new Generator{};
+		// Calls of functions always push a trace frame referring to the function
+		gen->function = context->currentTrace.back().function;
+		gen->executor.context = context;
+		gen->executor.def = def;
+		Wg_SetUserdata(obj, gen);
+		Wg_RegisterFinalizer(obj, DeleteUserdata<Generator>, gen);
+
+		Wg_ObjRef ref(obj);
+		if (!InitialiseFrame(gen->executor, kwargs, args, argc))
+			return nullptr;
+		// The generator may have been promoted while the frame was initialised
+		WriteBarrier(obj);
+		return obj;
+	}
+
+	// Returns the function of a call that can be made with Executor::PushFrame, or null.
+	// Generators and functions bound to a different self still go through Invoke.
+	static const DefObject* StacklessCallee(Wg_Obj* fn, Wg_Obj* self) {
+		if (!Wg_IsFunction(fn))
 			return nullptr;
+		const auto& func = fn->Get<Wg_Obj::Func>();
+		if (func.fptr != &DefObject::Run || (func.self && !self))
+			return nullptr;
+		const auto* def = (const DefObject*)func.userdata;
+		return def->isGenerator ? nullptr : def;
+	}
+
+	bool Executor::PushFrame(Wg_Obj* fn, Wg_Obj** args, int argc, Wg_Obj** kwnames, int kwargc) {
+		if (!Tick(context))
+			return false;
+		if (context->currentTrace.size() >= (size_t)context->config.maxRecursion) {
+			Wg_RaiseException(context, WG_EXC_RECURSIONERROR);
+			return false;
+		}
+
+		const auto& func = fn->Get<Wg_Obj::Func>();
+		Executor* frame = AcquireExecutor(context);
+		frame->def = (DefObject*)func.userdata;
+		context->currentModule.push(func.module);
+		context->currentTrace.push_back(TraceFrame{
+			{},
+			"",
+			func.module,
+			func.prettyName,
+			false,
+			fn,
+			context->currentTrace.back().suspendable
+			});
+
+		// The arguments stay on the stack of this frame while they are bound
+		bool initialised = false;
+		try {
+			initialised = InitialiseFrame(*frame, CallKwargs{ nullptr, kwnames, args + argc, kwargc }, args, argc);
+		} catch (std::bad_alloc&) {
+			Wg_RaiseException(context, WG_EXC_MEMORYERROR);
+		}
+		if (!initialised) {
+			context->currentTrace.pop_back();
+			context->currentModule.pop();
+			RecycleExecutor(context, frame);
+			return false;
+		}
+
+		if (Profiler* profiler = context->profiler; profiler && profiler->running) {
+			profiler->Enter(frame->def);
+			frame->profiled = true;
+		}
+		context->executors.push_back(frame);
+		frame->caller = this;
+		callee = frame;
+		return true;
+	}
+
+	// Removes a frame pushed by Executor::PushFrame once it has returned or been suspended
+	static void PopFrame(Executor* frame, Wg_Obj* result) {
+		Wg_Context* context = frame->context;
+		if (frame->profiled)
+			context->profiler->Exit();
+		frame->caller->callee = nullptr;
+		context->executors.pop_back();
+		if (result == context->builtins.pending) {
+			frame->caller = nullptr;
+			frame->profiled = false;
+			context->suspendedFrames.push_back({ frame, context->currentTrace.back().function });
+		} else {
+			RecycleExecutor(context, frame);
+		}
+		context->currentTrace.pop_back();
+		context->currentModule.pop();
+	}
+
+	// Runs an executor along with the frames of the script functions that it calls.
+	// Only calls through native code recurse on the C stack.
+	static Wg_Obj* RunFrames(Executor& entry) {
+		Wg_Context* context = entry.context;
+		Executor* current = &entry;
+		for (;;) {
+			Wg_Obj* result = nullptr;
+			try {
+				if (Profiler* profiler = context->profiler; profiler && profiler->running) {
+					result = current->Run<true>();
+				} else {
+					result = current->Run<false>();
+				}
+			} catch (std::bad_alloc&) {
+				Wg_RaiseException(context, WG_EXC_MEMORYERROR);
+				result = nullptr;
+			}
+
+			if (current->callee) {
+				current = current->callee;
+				continue;
+			} else if (current == &entry) {
+				return result;
+			}
+
+			// Pass the result to the caller. A suspended call suspends its callers too.
+			do {
+				Executor* caller = current->caller;
+				PopFrame(current, result);
+				current = caller;
+			} while (result == context->builtins.pending && current != &entry);
+			if (result == context->builtins.pending)
+				return result;
+
+			current->PopStackUntil(current->resumeStackSize);
+			if (result) {
+				current->PushStack(result);
+				current->pc++;
+			}
 		}
+	}
+
+	Wg_Obj* DefObject::Run(Wg_Context* context, Wg_Obj** args, int argc) {
+		DefObject* def = (DefObject*)Wg_GetFunctionUserdata(context);
+		CallKwargs kwargs = context->kwargs.back();
+		if (def->isGenerator)
+			return NewGenerator(context, def, kwargs, args, argc);
+
+		PooledExecutor pooled(context);
+		Executor& executor = *pooled;
+		executor.def = def;
+		if (!InitialiseFrame(executor, kwargs, args, argc))
+			return nullptr;
 
 		context->executors.push_back(&executor);
-		auto result = executor.Run();
+		Wg_Obj* result;
+		if (Profiler* profiler = context->profiler; profiler && profiler->running) {
+			profiler->Enter(def);
+			result = RunFrames(executor);
+			profiler->Exit();
+		} else {
+			result = RunFrames(executor);
+		}
 		context->executors.pop_back();
+
+		// The caller is suspended too, so the frame is kept until the call is resumed
+		if (result == context->builtins.pending)
+			context->suspendedFrames.push_back({ pooled.Release(), context->currentTrace.back().function });
 		return result;
 	}
 
@@ -158,49 +589,76 @@ namespace wings {
 	void Executor::ClearStack() {
 		while (!stack.empty())
 			PopStack();
-		argFrames = {};
-		kwargsStack = {};
+		argFrames.clear();
+		kwargNames.clear();
 	}
 
 	size_t Executor::PopArgFrame() {
-		kwargsStack.pop_back();
-		size_t ret = stack.size() - argFrames.top();
-		argFrames.pop();
+		size_t ret = stack.size() - argFrames.back().stackSize;
+		kwargNames.resize(argFrames.back().kwargStart);
+		argFrames.pop_back();
 		return ret;
 	}
 
-	Wg_Obj* Executor::GetVariable(const std::string& name) {
-		auto it = variables.find(name);
-		if (it != variables.end()) {
-			return *it->second;
-		} else {
-			return Wg_GetGlobal(context, name.c_str());
+	Wg_Obj* Executor::GetVariable(size_t index) {
+		const auto& variable = code->variables[index];
+		switch (variable.slot.type) {
+		case VariableSlot::Type::Local:
+			return locals[variable.slot.index];
+		case VariableSlot::Type::Cell:
+			return *cells[variable.slot.index];
+		default:
+			break;
 		}
+
+		auto& cell = caches->globals[index];
+		if (cell == nullptr) {
+			auto& globals = context->globals.at(std::string(context->currentModule.top()));
+			auto it = globals.find(variable.name);
+			if (it == globals.end())
+				return nullptr;
+			cell = it->second;
+		}
+		return *cell;
 	}
 
-	void Executor::SetVariable(const std::string& name, Wg_Obj* value) {
-		auto it = variables.find(name);
-		if (it != variables.end()) {
-			*it->second = value;
-		} else {
+	void Executor::SetVariable(const std::string& name, const VariableSlot& slot, Wg_Obj* value) {
+		switch (slot.type) {
+		case VariableSlot::Type::Local:
+			locals[slot.index] = value;
+			break;
+		case VariableSlot::Type::Cell:
+			*cells[slot.index] = value;
+			CellWriteBarrier(value);
+			break;
+		default:
 			Wg_SetGlobal(context, name.c_str(), value);
+			break;
 		}
 	}
 
-	Wg_Obj* Executor::DirectAssign(const AssignTarget& target, Wg_Obj* value) {
+	Wg_Obj* Executor::DirectAssign(const AssignTarget& target, const VariableSlot*& slot, Wg_Obj* value) {
 		switch (target.type) {
 		case AssignType::Direct:
-			SetVariable(target.direct, value);
+			SetVariable(target.direct, *slot++, value);
 			return value;
 		case AssignType::Pack: {
 			std::vector<Wg_ObjRef> values;
-			auto f = [](Wg_Obj* value, void* userdata) {
-				((std::vector<Wg_ObjRef>*)userdata)->emplace_back(value);
-				return true;
-			};
+			const auto& b = context->builtins;
+			if ((Wg_IsTuple(value) && IsUnmodifiedInstance(value, b.tuple))
+				|| (Wg_IsList(value) && IsUnmodifiedInstance(value, b.list))) {
+				// Copied since the assignments could modify a list
+				for (Wg_Obj* item : value->Get<std::vector<Wg_Obj*>>())
+					values.emplace_back(item);
+			} else {
+				auto f = [](Wg_Obj* value, void* userdata) {
+					((std::vector<Wg_ObjRef>*)userdata)->emplace_back(value);
+					return true;
+				};
 
-			if (!Wg_Iterate(value, &values, f))
-				return nullptr;
+				if (!Wg_Iterate(value, &values, f))
+					return nullptr;
+			}
 
 			if (values.size() != target.pack.size()) {
 				Wg_RaiseException(context, WG_EXC_TYPEERROR, "Packed assignment argument count mismatch");
@@ -208,7 +666,7 @@ namespace wings {
 			}
 
 			for (size_t i = 0; i < values.size(); i++)
-				if (!DirectAssign(target.pack[i], values[i].Get()))
+				if (!DirectAssign(target.pack[i], slot, values[i].Get()))
 					return nullptr;
 
 			std::vector<Wg_Obj*> buf;
@@ -221,129 +679,572 @@ namespace wings {
 		}
 	}
 
+	static Wg_Obj* NewLiteral(Wg_Context* context, const LiteralInstruction& literal) {
+		if (std::holds_alternative<std::nullptr_t>(literal)) {
+			return Wg_None(context);
+		} else if (auto* b = std::get_if<bool>(&literal)) {
+			return Wg_NewBool(context, *b);
+		} else if (auto* i = std::get_if<Wg_int>(&literal)) {
+			return Wg_NewInt(context, *i);
+		} else if (auto* f = std::get_if<Wg_float>(&literal)) {
+			return Wg_NewFloat(context, *f);
+		} else if (auto* s = std::get_if<std::string>(&literal)) {
+			return InternString(context, *s);
+		} else if (auto* t = std::get_if<TupleLiteral>(&literal)) {
+			std::vector<Wg_ObjRef> refs;
+			std::vector<Wg_Obj*> items;
+			for (const auto& item : t->items) {
+				Wg_Obj* value = NewLiteral(context, item);
+				if (value == nullptr)
+					return nullptr;
+				refs.emplace_back(value);
+				items.push_back(value);
+			}
+			return Wg_NewTuple(context, items.data(), (int)items.size());
+		} else if (auto* bytes = std::get_if<BytesLiteral>(&literal)) {
+			return Wg_NewBytes(context, bytes->data.data(), (int)bytes->data.size());
+		} else {
+			WG_UNREACHABLE();
+		}
+	}
+
+	// Compares plain ints for the CompareJump superinstruction
+	static bool CompareInts(Wg_BinOp op, Wg_int lhs, Wg_int rhs) {
+		switch (op) {
+		case WG_BOP_EQ: return lhs == rhs;
+		case WG_BOP_NE: return lhs != rhs;
+		case WG_BOP_LT: return lhs < rhs;
+		case WG_BOP_LE: return lhs <= rhs;
+		case WG_BOP_GT: return lhs > rhs;
+		case WG_BOP_GE: return lhs >= rhs;
+		default: WG_UNREACHABLE();
+		}
+	}
+
+	// The instructions that run most often are handled directly in Run and
+	// jump straight to the next handler, using computed goto where available.
+	// Handlers only check for exceptions when they fail and everything else
+	// goes through DoInstruction.
+#if defined(__GNUC__) || defined(__clang__)
+#define WG_COMPUTED_GOTO
+#endif
+
+#ifdef WG_COMPUTED_GOTO
+#define WG_OP(name) op_##name:
+#define WG_SUPER(name) op_##name:
+#define WG_DISPATCH() do { op = &ops[pc]; goto *handlers[op->handler]; } while (0)
+#else
+#define WG_OP(name) case (uint8_t)Instruction::Type::name:
+#define WG_SUPER(name) case (uint8_t)SuperInstruction::name:
+#define WG_DISPATCH() goto dispatch
+#endif
+
+	// Stays on the fast path while the next instruction is on the same line
+#define WG_NEXT() do { \
+		pc++; \
+		if (!Profiling && pc - lineStart < lineEnd - lineStart) \
+			WG_DISPATCH(); \
+		goto next; \
+	} while (0)
+
+	template <bool Profiling>
 	Wg_Obj* Executor::Run() {
 		auto& frame = context->currentTrace.back();
 		frame.module = def->module;
 		frame.func = def->prettyName;
 
-		for (pc = 0; pc < def->instructions->size(); pc++) {
-			const auto& instr = (*def->instructions)[pc];
-			
+		code = def->code.get();
+		caches = def->caches.get();
+		const Bytecode::Op* ops = code->ops.data();
+		const Bytecode::Op* op = nullptr;
+		size_t lineStart = 0;
+		size_t lineEnd = 0;
+
+#ifdef WG_COMPUTED_GOTO
+		// Indexed by handler, in the order of Instruction::Type then SuperInstruction
+		static const void* const handlers[] = {
+			&&op_Literal,
+			&&op_Generic, // Tuple
+			&&op_Generic, // List
+			&&op_Generic, // Map
+			&&op_Generic, // Set
+			&&op_Generic, // Slice
+			&&op_Generic, // Def
+			&&op_Generic, // Class
+			&&op_Variable,
+			&&op_Dot,
+			&&op_Generic, // Import
+			&&op_Generic, // ImportFrom
+			&&op_Operation,
+			&&op_Pop,
+			&&op_Generic, // Not
+			&&op_Generic, // Is
+			&&op_DirectAssign,
+			&&op_Generic, // MemberAssign
+			&&op_Jump,
+			&&op_JumpIfFalsePop,
+			&&op_JumpIfTruePop,
+			&&op_JumpIfFalse,
+			&&op_JumpIfTrue,
+			&&op_Generic, // Return
+			&&op_Generic, // QueueJump
+			&&op_Generic, // GetIter
+			&&op_ForIter,
+			&&op_Generic, // Raise
+			&&op_Generic, // PushTry
+			&&op_Generic, // PopTry
+			&&op_Generic, // ClearException
+			&&op_Generic, // CurrentException
+			&&op_Generic, // IsInstance
+			&&op_Generic, // EndFinally
+			&&op_Call,
+			&&op_LoadMethod,
+			&&op_CallMethod,
+			&&op_PushArgFrame,
+			&&op_Generic, // Unpack
+			&&op_Generic, // UnpackMapForMapCreation
+			&&op_Generic, // UnpackMapForCall
+			&&op_Generic, // PushKwarg
+			&&op_Yield,
+			&&op_CompareJump,
+			&&op_VariableDot,
+			&&op_SimpleCall,
+		};
+		static_assert(std::size(handlers) == HANDLER_COUNT);
+#endif
+
+		if (Wg_GetException(context))
+			goto raised;
+
+	next:
+		if (pc >= code->ops.size())
+			return returnValue ? returnValue : Wg_None(context);
+
+		// Only update the trace frame when moving to a different line
+		if (pc < lineStart || pc >= lineEnd) {
+			size_t line = code->FindLine(pc);
+			lineStart = code->lineTable[line].first;
+			lineEnd = line + 1 < code->lineTable.size() ? code->lineTable[line + 1].first : code->ops.size();
+
 			auto& frame = context->currentTrace.back();
-			frame.lineText = (*def->originalSource)[instr.srcPos.line];
-			frame.srcPos = instr.srcPos;
+			frame.srcPos = code->lineTable[line].second;
+			frame.lineText = def->originalSource->lines[frame.srcPos.line];
+		}
 
-			DoInstruction(instr);
+		if constexpr (Profiling)
+			context->profiler->PollSample(context);
 
-			if (Wg_GetException(context)) {
-				// No handlers so propagate
-				if (tryFrames.empty()) {
-					return nullptr;
-				}
+#ifdef WG_COMPUTED_GOTO
+		WG_DISPATCH();
+#else
+	dispatch:
+		op = &ops[pc];
+		switch (op->handler) {
+#endif
 
-				storedException = Wg_GetException(context);
-				Wg_ClearException(context);
-				PopStackUntil(tryFrames.back().stackSize);
-				
-				auto& back = tryFrames.back();
-				if (!back.exceptTaken) {
-					// Jump to except block
-					pc = back.exceptJump - 1;
-					back.exceptTaken = true;
-				} else {
-					// Another exception occurred while handling exception.
-					// Jump to finally block
-					queuedFinallyCount = 1;
-					DequeueJump();
-				}
+		WG_OP(Literal) {
+			Wg_Obj* value = NewLiteral(context, code->literals[op->operand]);
+			if (value == nullptr)
+				goto raised;
+			PushStack(value);
+			WG_NEXT();
+		}
+		WG_OP(Variable) {
+			const auto& variable = code->variables[op->operand];
+			Wg_Obj* value = GetVariable(op->operand);
+			if (value == nullptr) {
+				Wg_RaiseNameError(context, variable.name.c_str());
+				goto raised;
 			}
+			PushStack(value);
+			WG_NEXT();
 		}
+		WG_OP(Dot) {
+			Wg_Obj* attr = GetAttribute(PopStack(), code->strings[op->operand].string, caches->strings[op->operand]);
+			if (attr == nullptr)
+				goto raised;
+			PushStack(attr);
+			WG_NEXT();
+		}
+		WG_OP(Operation) {
+			// Operands stay on the stack until the result is ready so that they are not collected
+			const auto& operation = code->operations[op->operand];
+			Wg_Obj* lhs = stack[stack.size() - 2];
+			Wg_Obj* rhs = stack.back();
 
-		return returnValue ? returnValue : Wg_None(context);
-	}
+			Wg_Obj* result = nullptr;
+			if (!TryFastBinaryOp(operation.op, lhs, rhs, &result))
+				result = Wg_CallMethod(lhs, operation.method.c_str(), &rhs, 1);
+			if (result == nullptr)
+				goto raised;
 
-	void Executor::DoInstruction(const Instruction& instr) {
-		switch (instr.type) {
-		case Instruction::Type::Jump:
-			pc = instr.jump->location - 1;
-			return;
-		case Instruction::Type::JumpIfFalsePop:
-			if (Wg_Obj* truthy = Wg_UnaryOp(WG_UOP_BOOL, PopStack())) {
-				if (!Wg_GetBool(truthy)) {
-					pc = instr.jump->location - 1;
+			PopStack();
+			stack.back() = result;
+			WG_NEXT();
+		}
+		WG_OP(Pop) {
+			PopStack();
+			WG_NEXT();
+		}
+		WG_OP(DirectAssign) {
+			const auto& assign = code->directAssigns[op->operand];
+			const VariableSlot* slot = assign.slots.data();
+			if (assign.assignTarget.type == AssignType::Direct) {
+				SetVariable(assign.assignTarget.direct, *slot, stack.back());
+				WG_NEXT();
+			}
+
+			Wg_Obj* value = DirectAssign(assign.assignTarget, slot, PopStack());
+			if (value == nullptr)
+				goto raised;
+			PushStack(value);
+			WG_NEXT();
+		}
+		WG_OP(Jump) {
+			// Loops jump backwards so count a tick to bound their running time
+			if (op->operand <= pc && !Tick(context))
+				goto raised;
+			pc = (size_t)op->operand - 1;
+			WG_NEXT();
+		}
+		WG_OP(JumpIfFalsePop)
+		WG_OP(JumpIfTruePop) {
+			Wg_Obj* truthy = Wg_UnaryOp(WG_UOP_BOOL, PopStack());
+			if (truthy == nullptr)
+				goto raised;
+			if (Wg_GetBool(truthy) == (op->type == Instruction::Type::JumpIfTruePop))
+				pc = (size_t)op->operand - 1;
+			WG_NEXT();
+		}
+		WG_OP(JumpIfFalse)
+		WG_OP(JumpIfTrue) {
+			Wg_Obj* truthy = Wg_UnaryOp(WG_UOP_BOOL, PeekStack());
+			if (truthy == nullptr)
+				goto raised;
+			if (Wg_GetBool(truthy) == (op->type == Instruction::Type::JumpIfTrue))
+				pc = (size_t)op->operand - 1;
+			WG_NEXT();
+		}
+		WG_OP(ForIter) {
+			if (Wg_Obj* value = NextForLoopValue(PopStack())) {
+				PushStack(value);
+			} else if (Wg_GetException(context)) {
+				goto raised;
+			} else {
+				pc = (size_t)op->operand - 1;
+			}
+			WG_NEXT();
+		}
+		WG_OP(PushArgFrame) {
+			argFrames.push_back({ stack.size(), kwargNames.size() });
+			WG_NEXT();
+		}
+		WG_OP(Call) {
+			size_t kwargStart = argFrames.back().kwargStart;
+			size_t kwargc = kwargNames.size() - kwargStart;
+			size_t argc = stack.size() - argFrames.back().stackSize - kwargc - 1;
+
+			Wg_Obj* fn = stack[stack.size() - argc - kwargc - 1];
+			Wg_Obj** args = stack.data() + stack.size() - argc - kwargc;
+
+			if (StacklessCallee(fn, nullptr)) {
+				bool pushed = PushFrame(fn, args, (int)argc, kwargNames.data() + kwargStart, (int)kwargc);
+				PopArgFrame();
+				if (!pushed)
+					goto raised;
+				resumeStackSize = stack.size() - argc - kwargc - 1;
+				return nullptr;
+			}
+
+			Wg_Obj* ret = CallFromScript(fn, nullptr, args, (int)argc, kwargNames.data() + kwargStart, (int)kwargc);
+			PopArgFrame();
+			if (ret == nullptr) {
+				goto raised;
+			} else if (ret == context->builtins.pending) {
+				resumeStackSize = stack.size() - argc - kwargc - 1;
+				return ret;
+			}
+
+			PopStackUntil(stack.size() - argc - kwargc - 1);
+			PushStack(ret);
+			WG_NEXT();
+		}
+		WG_OP(LoadMethod) {
+			// Leaves the attribute and its object on the stack. CallMethod passes
+			// the object as self if the attribute turns out to be a method.
+			Wg_Obj* obj = stack.back();
+			Wg_Obj* attr = obj->attributes.Get(code->strings[op->operand].string, caches->strings[op->operand]);
+			if (attr == nullptr) {
+				Wg_RaiseAttributeError(obj, code->strings[op->operand].string.c_str());
+				goto raised;
+			}
+			stack.back() = attr;
+			PushStack(obj);
+			WG_NEXT();
+		}
+		WG_OP(CallMethod) {
+			size_t kwargStart = argFrames.back().kwargStart;
+			size_t kwargc = kwargNames.size() - kwargStart;
+			size_t argc = stack.size() - argFrames.back().stackSize - kwargc - 2;
+
+			Wg_Obj* fn = stack[stack.size() - argc - kwargc - 2];
+			Wg_Obj* self = stack[stack.size() - argc - kwargc - 1];
+			Wg_Obj** args = stack.data() + stack.size() - argc - kwargc;
+
+			if (!Wg_IsFunction(fn) || !fn->Get<Wg_Obj::Func>().isMethod)
+				self = nullptr;
+
+			if (StacklessCallee(fn, self)) {
+				// self is already in front of the arguments on the stack
+				bool pushed = self
+					? PushFrame(fn, args - 1, (int)argc + 1, kwargNames.data() + kwargStart, (int)kwargc)
+					: PushFrame(fn, args, (int)argc, kwargNames.data() + kwargStart, (int)kwargc);
+				PopArgFrame();
+				if (!pushed)
+					goto raised;
+				resumeStackSize = stack.size() - argc - kwargc - 2;
+				return nullptr;
+			}
+
+			Wg_Obj* ret = CallFromScript(fn, self, args, (int)argc, kwargNames.data() + kwargStart, (int)kwargc);
+			PopArgFrame();
+			if (ret == nullptr) {
+				goto raised;
+			} else if (ret == context->builtins.pending) {
+				resumeStackSize = stack.size() - argc - kwargc - 2;
+				return ret;
+			}
+
+			PopStackUntil(stack.size() - argc - kwargc - 2);
+			PushStack(ret);
+			WG_NEXT();
+		}
+		WG_OP(Yield) {
+			// The generator pushes the sent value once it is resumed
+			yielded = true;
+			pc++;
+			return PopStack();
+		}
+
+		WG_SUPER(CompareJump) {
+			// Plain ints are compared without creating the literal or the result
+			const auto& lhsVariable = code->variables[op->operand];
+			Wg_Obj* lhs = GetVariable(op->operand);
+			if (lhs == nullptr) {
+				Wg_RaiseNameError(context, lhsVariable.name.c_str());
+				goto raised;
+			}
+
+			const Bytecode::Op& load = op[1];
+			Wg_Obj* rhs = nullptr;
+			const Wg_int* rhsInt = nullptr;
+			if (load.type == Instruction::Type::Literal) {
+				rhsInt = std::get_if<Wg_int>(&code->literals[load.operand]);
+			} else {
+				const auto& rhsVariable = code->variables[load.operand];
+				rhs = GetVariable(load.operand);
+				if (rhs == nullptr) {
+					pc++;
+					Wg_RaiseNameError(context, rhsVariable.name.c_str());
+					goto raised;
 				}
+				if (Wg_IsInt(rhs) && IsPlainBuiltin(rhs))
+					rhsInt = &rhs->Get<Wg_int>();
 			}
-			return;
-		case Instruction::Type::JumpIfFalse:
-		case Instruction::Type::JumpIfTrue:
-			if (Wg_Obj* truthy = Wg_UnaryOp(WG_UOP_BOOL, PeekStack())) {
-				if (Wg_GetBool(truthy) == (instr.type == Instruction::Type::JumpIfTrue)) {
-					pc = instr.jump->location - 1;
+
+			if (rhsInt && Wg_IsInt(lhs) && IsPlainBuiltin(lhs)) {
+				bool result = CompareInts(code->operations[op[2].operand].op, lhs->Get<Wg_int>(), *rhsInt);
+				const Bytecode::Op& jump = op[3];
+				pc += 3;
+				if (result == (jump.type == Instruction::Type::JumpIfTruePop))
+					pc = (size_t)jump.operand - 1;
+				WG_NEXT();
+			}
+
+			// Otherwise continue with the ordinary instructions
+			PushStack(lhs);
+			pc++;
+			if (rhs) {
+				PushStack(rhs);
+				pc++;
+			}
+			WG_DISPATCH();
+		}
+		WG_SUPER(VariableDot) {
+			const auto& variable = code->variables[op->operand];
+			Wg_Obj* obj = GetVariable(op->operand);
+			if (obj == nullptr) {
+				Wg_RaiseNameError(context, variable.name.c_str());
+				goto raised;
+			}
+
+			pc++;
+			op = &ops[pc];
+			Wg_Obj* attr = GetAttribute(obj, code->strings[op->operand].string, caches->strings[op->operand]);
+			if (attr == nullptr)
+				goto raised;
+			PushStack(attr);
+			WG_NEXT();
+		}
+		WG_SUPER(SimpleCall) {
+			// The values are pushed without an argument frame since there are no keyword arguments
+			size_t base = stack.size();
+			for (pc++; ops[pc].type != Instruction::Type::Call; pc++) {
+				op = &ops[pc];
+				Wg_Obj* value;
+				if (op->type == Instruction::Type::Variable) {
+					const auto& variable = code->variables[op->operand];
+					value = GetVariable(op->operand);
+					if (value == nullptr) {
+						Wg_RaiseNameError(context, variable.name.c_str());
+						goto raised;
+					}
+				} else if ((value = NewLiteral(context, code->literals[op->operand])) == nullptr) {
+					goto raised;
 				}
+				PushStack(value);
 			}
-			return;
-		case Instruction::Type::Pop:
-			PopStack();
-			return;
+
+			size_t argc = stack.size() - base - 1;
+			if (StacklessCallee(stack[base], nullptr)) {
+				if (!PushFrame(stack[base], stack.data() + base + 1, (int)argc, nullptr, 0))
+					goto raised;
+				resumeStackSize = base;
+				return nullptr;
+			}
+
+			Wg_Obj* ret = CallFromScript(stack[base], nullptr, stack.data() + base + 1, (int)argc, nullptr, 0);
+			if (ret == nullptr) {
+				goto raised;
+			} else if (ret == context->builtins.pending) {
+				resumeStackSize = base;
+				return ret;
+			}
+
+			PopStackUntil(base);
+			PushStack(ret);
+			WG_NEXT();
+		}
+
+#ifdef WG_COMPUTED_GOTO
+		op_Generic:
+#else
+		default:
+#endif
+			DoInstruction(*op);
+			if (Wg_GetException(context))
+				goto raised;
+			WG_NEXT();
+
+#ifndef WG_COMPUTED_GOTO
+		}
+#endif
+
+	raised:
+		// No handlers so propagate
+		if (tryFrames.empty())
+			return nullptr;
+
+		storedException = Wg_GetException(context);
+		Wg_ClearException(context);
+		PopStackUntil(tryFrames.back().stackSize);
+
+		if (auto& back = tryFrames.back(); !back.exceptTaken) {
+			// Jump to except block
+			pc = back.exceptJump - 1;
+			back.exceptTaken = true;
+		} else {
+			// Another exception occurred while handling exception.
+			// Jump to finally block
+			queuedFinallyCount = 1;
+			DequeueJump();
+		}
+		WG_NEXT();
+	}
+
+#undef WG_NEXT
+#undef WG_DISPATCH
+#undef WG_SUPER
+#undef WG_OP
+#undef WG_COMPUTED_GOTO
+
+	void Executor::DoInstruction(const Bytecode::Op& op) {
+		switch (op.type) {
 		case Instruction::Type::Return:
 			storedException = nullptr;
-			queuedFinallyCount = instr.queuedJump->finallyCount;
-			queuedJump = def->instructions->size();
+			queuedFinallyCount = code->queuedJumps[op.operand].finallyCount;
+			queuedJump = code->ops.size();
 			returnValue = PopStack();
 			DequeueJump();
 			return;
+		case Instruction::Type::GetIter:
+			if (Wg_Obj* iterator = GetForLoopIterator(PeekStack())) {
+				PopStack();
+				PushStack(iterator);
+			}
+			return;
 		case Instruction::Type::Def: {
+			const auto& defInstr = code->defs[op.operand];
 			DefObject* def = new DefObject();
 			def->context = context;
 			def->module = this->def->module;
-			def->prettyName = instr.def->prettyName;
-			def->instructions = instr.def->instructions;
+			def->prettyName = defInstr.prettyName;
+			def->code = defInstr.code;
+			auto& defCaches = caches->defs[op.operand];
+			if (defCaches == nullptr)
+				defCaches = MakeRcPtr<CodeCaches>(*defInstr.code);
+			def->caches = defCaches;
 			def->originalSource = this->def->originalSource;
 
-			for (const auto& param : instr.def->parameters)
-				def->parameterNames.push_back(param.name);
-			for (size_t i = 0; i < instr.def->defaultParameterCount; i++)
+			def->parameterNames = defInstr.parameters;
+			for (size_t i = 0; i < defInstr.defaultParameterCount; i++)
 				def->defaultParameterValues.push_back(PopStack());
-			def->listArgs = instr.def->listArgs;
-			def->kwArgs = instr.def->kwArgs;
-
-			const auto& module = std::string(context->currentModule.top());
-			auto& globals = context->globals.at(module);
-			
-			for (const auto& capture : instr.def->localCaptures) {
-				if (variables.contains(capture)) {
-					def->captures.insert({ capture, variables[capture] });
+			def->listArgs = defInstr.listArgs;
+			def->kwArgs = defInstr.kwArgs;
+
+			const auto& localCaptures = defInstr.localCaptures;
+			for (size_t i = 0; i < localCaptures.size(); i++) {
+				const auto& slot = defInstr.localCaptureSlots[i];
+				if (slot.type == VariableSlot::Type::Cell) {
+					def->captures.push_back(cells[slot.index]);
 				} else {
-					if (!globals.contains(capture))
-						Wg_SetGlobal(context, capture.c_str(), Wg_None(context));
-					
-					def->captures.insert({ capture, globals.at(capture) });
+					const auto& module = std::string(context->currentModule.top());
+					auto& globals = context->globals.at(module);
+					if (!globals.contains(localCaptures[i]))
+						Wg_SetGlobal(context, localCaptures[i].c_str(), Wg_None(context));
+
+					def->captures.push_back(globals.at(localCaptures[i]));
 				}
 			}
-			for (const auto& capture : instr.def->globalCaptures) {
-				def->captures.insert({ capture, globals.at(capture) });
-			}
-			def->localVariables = instr.def->variables;
+			def->localCount = defInstr.localCount;
+			def->cellCount = defInstr.cellCount;
+			def->parameterSlots = defInstr.parameterSlots;
+			def->listArgsSlot = defInstr.listArgsSlot;
+			def->kwArgsSlot = defInstr.kwArgsSlot;
+			def->contiguousParameters = defInstr.contiguousParameters;
+			def->firstParameterLocal = defInstr.firstParameterLocal;
+			def->isGenerator = defInstr.isGenerator;
 
-			Wg_Obj* obj = Wg_NewFunction(context, &DefObject::Run, def, instr.def->prettyName.c_str());
+			Wg_Obj* obj = Wg_NewFunction(context, &DefObject::Run, def, defInstr.prettyName.c_str());
 			if (obj == nullptr) {
 				delete def;
 				return;
 			}
-			obj->Get<Wg_Obj::Func>().isMethod = instr.def->isMethod;
+			obj->Get<Wg_Obj::Func>().isMethod = defInstr.isMethod;
 
-			Wg_RegisterFinalizer(obj, [](void* userdata) { delete (DefObject*)userdata; }, def);
+			Wg_RegisterFinalizer(obj, DeleteUserdata<DefObject>, def);
 
 			PushStack(obj);
 			return;
 		}
 		case Instruction::Type::Class: {
-			size_t methodCount = instr.klass->methodNames.size();
+			const auto& classInstr = code->classes[op.operand];
+			size_t methodCount = classInstr.methodNames.size();
 			size_t baseCount = PopArgFrame();
 			auto stackEnd = stack.data() + stack.size();
 
 			std::vector<const char*> methodNames;
-			for (const auto& methodName : instr.klass->methodNames)
+			for (const auto& methodName : classInstr.methodNames)
 				methodNames.push_back(methodName.c_str());
 
 			Wg_Obj** bases = stackEnd - baseCount;
@@ -356,12 +1257,12 @@ namespace wings {
 				}
 			}
 
-			Wg_Obj* klass = Wg_NewClass(context, instr.klass->prettyName.c_str(), bases, (int)baseCount);
+			Wg_Obj* klass = Wg_NewClass(context, classInstr.prettyName.c_str(), bases, (int)baseCount);
 			if (klass == nullptr)
 				return;
 
 			for (size_t i = 0; i < methodCount; i++)
-				AddAttributeToClass(klass, instr.klass->methodNames[i].c_str(), methods[i]);
+				AddAttributeToClass(klass, classInstr.methodNames[i].c_str(), methods[i]);
 
 			for (size_t i = 0; i < methodCount + baseCount; i++)
 				PopStack();
@@ -371,32 +1272,11 @@ namespace wings {
 			}
 			return;
 		}
-		case Instruction::Type::Literal: {
-			Wg_Obj* value{};
-			if (std::holds_alternative<std::nullptr_t>(*instr.literal)) {
-				value = Wg_None(context);
-			} else if (auto* b = std::get_if<bool>(instr.literal.get())) {
-				value = Wg_NewBool(context, *b);
-			} else if (auto* i = std::get_if<Wg_int>(instr.literal.get())) {
-				value = Wg_NewInt(context, *i);
-			} else if (auto* f = std::get_if<Wg_float>(instr.literal.get())) {
-				value = Wg_NewFloat(context, *f);
-			} else if (auto* s = std::get_if<std::string>(instr.literal.get())) {
-				value = Wg_NewStringBuffer(context, s->c_str(), (int)s->size());
-			} else {
-				WG_UNREACHABLE();
-			}
-
-			if (value) {
-				PushStack(value);
-			}
-			return;
-		}
 		case Instruction::Type::Tuple:
 		case Instruction::Type::List:
 		case Instruction::Type::Set: {
 			Wg_Obj* (*creator)(Wg_Context*, Wg_Obj**, int) = nullptr;
-			switch (instr.type) {
+			switch (op.type) {
 			case Instruction::Type::Tuple: creator = Wg_NewTuple; break;
 			case Instruction::Type::List: creator = Wg_NewList; break;
 			case Instruction::Type::Set: creator = Wg_NewSet; break;
@@ -420,6 +1300,7 @@ namespace wings {
 					Wg_ObjRef ref(dict);
 					try {
 						dict->Get<WDict>()[key] = val;
+						WriteBarrier(dict);
 					} catch (HashException&) {
 						return;
 					}
@@ -430,57 +1311,13 @@ namespace wings {
 				PushStack(dict);
 			}
 			return;
-		case Instruction::Type::Variable:
-			if (Wg_Obj* value = GetVariable(instr.string->string)) {
-				PushStack(value);
-			} else {
-				Wg_RaiseNameError(context, instr.string->string.c_str());
-			}
-			return;
-		case Instruction::Type::DirectAssign:
-			if (Wg_Obj* v = DirectAssign(instr.directAssign->assignTarget, PopStack())) {
-				PushStack(v);
-			}
-			return;
 		case Instruction::Type::MemberAssign: {
 			Wg_Obj* value = PopStack();
 			Wg_Obj* obj = PopStack();
-			Wg_SetAttribute(obj, instr.string->string.c_str(), value);
+			SetAttribute(obj, code->strings[op.operand].string, value, caches->strings[op.operand]);
 			PushStack(value);
 			return;
 		}
-		case Instruction::Type::PushArgFrame:
-			argFrames.push(stack.size());
-			kwargsStack.push_back({});
-			return;
-		case Instruction::Type::Call: {
-			size_t kwargc = kwargsStack.back().size();
-			size_t argc = stack.size() - argFrames.top() - kwargc - 1;
-
-			Wg_Obj* fn = stack[stack.size() - argc - kwargc - 1];
-			Wg_Obj** args = stack.data() + stack.size() - argc - kwargc;
-			Wg_Obj** kwargsv = stack.data() + stack.size() - kwargc;
-
-			Wg_Obj* kwargs = nullptr;
-			if (kwargc) {
-				kwargs = Wg_NewDictionary(context, kwargsStack.back().data(), kwargsv, (int)kwargc);
-				if (kwargs == nullptr)
-					return;
-			}
-
-			if (Wg_Obj* ret = Wg_Call(fn, args, (int)argc, kwargs)) {
-				for (size_t i = 0; i < argc + kwargc + 1; i++)
-					PopStack();
-				PushStack(ret);
-			}
-			PopArgFrame();
-			return;
-		}
-		case Instruction::Type::Dot:
-			if (Wg_Obj* attr = Wg_GetAttribute(PopStack(), instr.string->string.c_str())) {
-				PushStack(attr);
-			}
-			return;
 		case Instruction::Type::Unpack:
 			Wg_Iterate(PopStack(), this, [](Wg_Obj* value, void* userdata) {
 				Executor* executor = (Executor*)userdata;
@@ -513,13 +1350,13 @@ namespace wings {
 					Wg_RaiseException(context, WG_EXC_TYPEERROR, "Keywords must be strings");
 					return;
 				}
-				kwargsStack.back().push_back(key);
+				kwargNames.push_back(key);
 				PushStack(value);
 			}
 			return;
 		}
 		case Instruction::Type::PushKwarg:
-			kwargsStack.back().push_back(PopStack());
+			kwargNames.push_back(PopStack());
 			return;
 		case Instruction::Type::Not: {
 			Wg_Obj* arg = Wg_UnaryOp(WG_UOP_BOOL, PopStack());
@@ -545,8 +1382,8 @@ namespace wings {
 		}
 		case Instruction::Type::PushTry:
 			tryFrames.push_back({
-				instr.pushTry->exceptJump,
-				instr.pushTry->finallyJump,
+				code->tryFrames[op.operand].exceptJump,
+				code->tryFrames[op.operand].finallyJump,
 				stack.size(),
 				false,
 				});
@@ -564,9 +1401,11 @@ namespace wings {
 			PushStack(storedException);
 			return;
 		case Instruction::Type::QueueJump:
+			if (code->queuedJumps[op.operand].location <= pc && !Tick(context))
+				return;
 			storedException = nullptr;
-			queuedFinallyCount = instr.queuedJump->finallyCount;
-			queuedJump = instr.queuedJump->location;
+			queuedFinallyCount = code->queuedJumps[op.operand].finallyCount;
+			queuedJump = code->queuedJumps[op.operand].location;
 			DequeueJump();
 			return;
 		case Instruction::Type::EndFinally:
@@ -594,23 +1433,25 @@ namespace wings {
 			return;
 		}
 		case Instruction::Type::Import: {
-			const char* alias = instr.import->alias.empty() ? nullptr : instr.import->alias.c_str();
-			Wg_ImportModule(context, instr.import->module.c_str(), alias);
+			const auto& import = code->imports[op.operand];
+			const char* alias = import.alias.empty() ? nullptr : import.alias.c_str();
+			Wg_ImportModule(context, import.module.c_str(), alias);
 			return;
 		}
 		case Instruction::Type::ImportFrom: {
-			const char* moduleName = instr.importFrom->module.c_str();
-			if (instr.importFrom->names.empty()) {
+			const auto& importFrom = code->importFroms[op.operand];
+			const char* moduleName = importFrom.module.c_str();
+			if (importFrom.names.empty()) {
 				Wg_ImportAllFromModule(context, moduleName);
-			} else if (!instr.importFrom->alias.empty()) {
+			} else if (!importFrom.alias.empty()) {
 				Wg_ImportFromModule(
 					context,
 					moduleName,
-					instr.importFrom->names[0].c_str(),
-					instr.importFrom->alias.c_str()
+					importFrom.names[0].c_str(),
+					importFrom.alias.c_str()
 				);
 			} else {
-				for (const auto& name : instr.importFrom->names)
+				for (const auto& name : importFrom.names)
 					if (!Wg_ImportFromModule(context, moduleName, name.c_str()))
 						break;
 			}
@@ -630,12 +1471,13 @@ namespace wings {
 		}
 	}
 
-	void Executor::GetReferences(std::deque<const Wg_Obj*>& refs) {
-		for (const auto& var : variables)
-			refs.push_back(*var.second);
-		for (const auto& frame : kwargsStack)
-			for (const auto& kwarg : frame)
-				refs.push_back(kwarg);
+	void Executor::GetReferences(std::vector<const Wg_Obj*>& refs) const {
+		for (Wg_Obj* local : locals)
+			refs.push_back(local);
+		for (const auto& cell : cells)
+			refs.push_back(*cell);
+		for (Wg_Obj* name : kwargNames)
+			refs.push_back(name);
 		for (const auto& val : this->stack)
 			refs.push_back(val);
 		if (storedException)
@@ -643,4 +1485,190 @@ namespace wings {
 		if (returnValue)
 			refs.push_back(returnValue);
 	}
+
+	// Frees the frame of a generator that cannot be resumed again
+	static void FinishGenerator(Generator& gen) {
+		gen.finished = true;
+		gen.executor.stack.clear();
+		gen.executor.argFrames.clear();
+		gen.executor.kwargNames.clear();
+		gen.executor.locals.clear();
+		gen.executor.cells.clear();
+		gen.executor.returnValue = nullptr;
+		gen.executor.tryFrames.clear();
+		gen.executor.storedException = nullptr;
+	}
+
+	Wg_Obj* ResumeGenerator(Wg_Obj* generator, Wg_Obj* value, Wg_Obj* exception) {
+		Wg_Context* context = generator->context;
+		auto& gen = *(Generator*)generator->data;
+		Executor& executor = gen.executor;
+		const DefObject* def = executor.def;
+
+		if (gen.running) {
+			Wg_RaiseException(context, WG_EXC_VALUEERROR, "generator already executing");
+			return nullptr;
+		} else if (gen.finished || (!gen.started && exception)) {
+			// An exception thrown into a generator that has not started or has finished propagates immediately
+			FinishGenerator(gen);
+			if (exception && Wg_IsClass(exception)) {
+				Wg_RaiseExceptionClass(exception);
+			} else if (exception) {
+				Wg_RaiseExceptionObject(exception);
+			}
+			return nullptr;
+		} else if (!gen.started && value && !Wg_IsNone(value)) {
+			Wg_RaiseException(context, WG_EXC_TYPEERROR, "can't send non-None value to a just-started generator");
+			return nullptr;
+		}
+
+		if (gen.started && !exception)
+			executor.PushStack(value ? value : Wg_None(context));
+		gen.started = true;
+		gen.running = true;
+
+		Wg_ObjRef ref(generator);
+		context->currentModule.push(def->module);
+		context->currentTrace.push_back(TraceFrame{
+			{},
+			"",
+			def->module,
+			def->prettyName,
+			false,
+			gen.function
+			});
+		context->executors.push_back(&executor);
+
+		// Raised after the frame is pushed so that the traceback includes the generator
+		if (exception && Wg_IsClass(exception)) {
+			Wg_RaiseExceptionClass(exception);
+		} else if (exception) {
+			Wg_RaiseExceptionObject(exception);
+		}
+
+		executor.yielded = false;
+		Wg_Obj* result;
+		if (Profiler* profiler = context->profiler; profiler && profiler->running) {
+			profiler->Enter(def);
+			result = RunFrames(executor);
+			profiler->Exit();
+		} else {
+			result = RunFrames(executor);
+		}
+
+		context->executors.pop_back();
+		context->currentTrace.pop_back();
+		context->currentModule.pop();
+		gen.running = false;
+		// The frame is only a root while it runs
+		WriteBarrier(generator);
+
+		if (result == nullptr || !executor.yielded) {
+			FinishGenerator(gen);
+			return nullptr;
+		}
+		return result;
+	}
+
+	bool CloseGenerator(Wg_Obj* generator, Wg_Obj* exitClass) {
+		Wg_Context* context = generator->context;
+		auto& gen = *(Generator*)generator->data;
+		if (gen.running) {
+			Wg_RaiseException(context, WG_EXC_VALUEERROR, "generator already executing");
+			return false;
+		} else if (!gen.started || gen.finished) {
+			FinishGenerator(gen);
+			return true;
+		}
+
+		// Raise GeneratorExit at the paused yield so that finally blocks run
+		if (ResumeGenerator(generator, nullptr, exitClass)) {
+			Wg_RaiseException(context, WG_EXC_RUNTIMEERROR, "generator ignored GeneratorExit");
+			return false;
+		}
+
+		Wg_Obj* exception = Wg_GetException(context);
+		Wg_Obj* expected[] = { exitClass, context->builtins.stopIteration };
+		if (exception && Wg_IsInstance(exception, expected, 2) == nullptr)
+			return false;
+		Wg_ClearException(context);
+		return true;
+	}
+
+	// The trace frame of a suspended frame, pointing at the call it is suspended at
+	static TraceFrame SuspendedTraceFrame(const SuspendedFrame& frame) {
+		const Executor& executor = *frame.executor;
+		const DefObject* def = executor.def;
+		size_t line = executor.code->FindLine(executor.pc);
+		SourcePosition srcPos = executor.code->lineTable[line].second;
+		return TraceFrame{
+			srcPos,
+			def->originalSource->lines[srcPos.line],
+			def->module,
+			def->prettyName,
+			false,
+			frame.function,
+			true
+		};
+	}
+
+	Wg_Obj* ResumeSuspendedCall(Wg_Context* context, Wg_Obj* value, Wg_Obj* exception) {
+		std::vector<SuspendedFrame> frames = std::move(context->suspendedFrames);
+		context->suspendedFrames.clear();
+		context->suspended = false;
+
+		// Restore the outer frames first so that tracebacks and
+		// further suspensions see the whole chain of calls
+		auto mark = context->argumentStack.GetMark();
+		Wg_Obj** functions = context->argumentStack.Push(frames.size());
+		Profiler* profiler = context->profiler;
+		bool profiling = profiler && profiler->running;
+		for (size_t i = frames.size(); i-- > 0; ) {
+			functions[i] = frames[i].function;
+			context->currentModule.push(frames[i].executor->def->module);
+			context->currentTrace.push_back(SuspendedTraceFrame(frames[i]));
+			context->executors.push_back(frames[i].executor);
+			if (profiling)
+				profiler->Enter(frames[i].executor->def);
+		}
+
+		// Raised after the frames are pushed so that the traceback includes them
+		if (exception && Wg_IsClass(exception)) {
+			Wg_RaiseExceptionClass(exception);
+		} else if (exception) {
+			Wg_RaiseExceptionObject(exception);
+		}
+
+		// Each frame receives the result of the frame inside it
+		Wg_Obj* result = value;
+		for (auto& frame : frames) {
+			Executor& executor = *frame.executor;
+			if (result != context->builtins.pending) {
+				executor.PopStackUntil(executor.resumeStackSize);
+				if (result) {
+					executor.PushStack(result);
+					executor.pc++;
+				}
+				result = RunFrames(executor);
+			}
+
+			if (profiling)
+				profiler->Exit();
+			context->executors.pop_back();
+			context->currentTrace.pop_back();
+			context->currentModule.pop();
+
+			if (result == context->builtins.pending) {
+				context->suspendedFrames.push_back(frame);
+			} else {
+				RecycleExecutor(context, frame.executor);
+			}
+		}
+		context->argumentStack.Pop(mark);
+
+		if (result != context->builtins.pending)
+			return result;
+		context->suspended = true;
+		return nullptr;
+	}
 }
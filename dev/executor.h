@@ -11,19 +11,73 @@
 
 namespace wings {
 
+	// The inline caches of a function body. Bytecode is never modified once compiled
+	// so that it can be shared between contexts, but caches refer to the shapes of one
+	// heap. The caches of a nested function are created when its def first runs and
+	// are shared by every function object created by that def.
+	struct CodeCaches {
+		explicit CodeCaches(const Bytecode& code) :
+			strings(code.strings.size()),
+			globals(code.variables.size()),
+			defs(code.defs.size())
+		{
+		}
+
+		std::vector<AttributeTable::InlineCache> strings;
+		// The cells of global variables, indexed like Bytecode::variables.
+		// Names are never removed from a module so a cell is cached once found.
+		std::vector<RcPtr<Wg_Obj*>> globals;
+		std::vector<RcPtr<CodeCaches>> defs;
+	};
+
 	struct DefObject {
 		static Wg_Obj* Run(Wg_Context* context, Wg_Obj** args, int argc);
 		Wg_Context* context{};
-		RcPtr<std::vector<Instruction>> instructions;
+		RcPtr<Bytecode> code;
+		RcPtr<CodeCaches> caches;
 		std::string module;
 		std::string prettyName;
-		std::vector<std::string> localVariables;
 		std::vector<std::string> parameterNames;
 		std::vector<Wg_Obj*> defaultParameterValues;
 		std::optional<std::string> listArgs;
 		std::optional<std::string> kwArgs;
-		std::unordered_map<std::string, RcPtr<Wg_Obj*>> captures;
-		RcPtr<std::vector<std::string>> originalSource;
+		size_t localCount{};
+		size_t cellCount{};
+		std::vector<VariableSlot> parameterSlots;
+		VariableSlot listArgsSlot;
+		VariableSlot kwArgsSlot;
+		bool contiguousParameters{};
+		size_t firstParameterLocal{};
+		bool isGenerator{};
+		std::vector<RcPtr<Wg_Obj*>> captures;
+		RcPtr<SourceText> originalSource;
+	};
+
+	// State of a for loop over a builtin iterable. ForIter advances
+	// it directly instead of calling __next__ and catching StopIteration.
+	struct ForLoopIterator {
+		enum class Kind : uint8_t {
+			Sequence,
+			String,
+			Range,
+			DictKeys,
+			DictValues,
+			DictItems,
+			Set,
+			Buffer,
+		} kind;
+		union {
+			// For dicts and sets obj is the native iterator object
+			struct {
+				Wg_Obj* obj;
+				size_t index;
+			} sequence;
+			struct {
+				Wg_int cur;
+				Wg_int stop;
+				Wg_int step;
+			} range;
+		};
 	};
 
 	struct TryFrame {
@@ -34,9 +88,18 @@ namespace wings {
 	};
 
 	struct Executor {
+		// Profiling polls for samples before every instruction
+		// Runs from the current instruction. Starts by handling the
+		// current exception if there is one, so that it can be thrown into generators.
+		template <bool Profiling>
 		Wg_Obj* Run();
 
-		void GetReferences(std::deque<const Wg_Obj*>& refs);
+		void GetReferences(std::vector<const Wg_Obj*>& refs) const;
+
+		// Starts a call of a script function as a frame of the same dispatch loop
+		// instead of recursing through Invoke. Run returns to RunFrames, which
+		// runs the callee and then resumes this frame with its result.
+		bool PushFrame(Wg_Obj* fn, Wg_Obj** args, int argc, Wg_Obj** kwnames, int kwargc);
 
 		void PushStack(Wg_Obj* obj);
 		Wg_Obj* PopStack();
@@ -44,22 +107,41 @@ namespace wings {
 		Wg_Obj* PeekStack();
 		void ClearStack();
 		size_t PopArgFrame();
-		Wg_Obj* DirectAssign(const AssignTarget& target, Wg_Obj* value);
+		Wg_Obj* DirectAssign(const AssignTarget& target, const VariableSlot*& slot, Wg_Obj* value);
 		void DequeueJump();
-		void DoInstruction(const Instruction& instr);
+		// Runs the instructions without a handler in Run
+		void DoInstruction(const Bytecode::Op& op);
 
-		Wg_Obj* GetVariable(const std::string& name);
-		void SetVariable(const std::string& name, Wg_Obj* value);
+		// Gets the value of the variable at an index of Bytecode::variables
+		Wg_Obj* GetVariable(size_t index);
+		void SetVariable(const std::string& name, const VariableSlot& slot, Wg_Obj* value);
 
 
 		DefObject* def;
+		const Bytecode* code{};
+		CodeCaches* caches{};
 		Wg_Context* context;
 		size_t pc{};
 		std::vector<Wg_Obj*> stack;
-		std::stack<size_t> argFrames;
-		std::vector<std::vector<Wg_Obj*>> kwargsStack;
-		std::unordered_map<std::string, RcPtr<Wg_Obj*>> variables;
+		struct ArgFrame {
+			size_t stackSize;
+			size_t kwargStart;
+		};
+		std::vector<ArgFrame> argFrames;
+		// The names of the keyword arguments of the calls being built
+		std::vector<Wg_Obj*> kwargNames;
+		std::vector<Wg_Obj*> locals;
+		std::vector<RcPtr<Wg_Obj*>> cells;
 		Wg_Obj* returnValue;
+		// Whether Run returned because of a yield rather than a return
+		bool yielded = false;
+		// The stack size to restore when the current call returns or a suspended call is resumed
+		size_t resumeStackSize = 0;
+		// The frames of a call made with PushFrame
+		Executor* caller = nullptr;
+		Executor* callee = nullptr;
+		// Whether the profiler was entered when the frame was pushed
+		bool profiled = false;
 
 		std::vector<TryFrame> tryFrames;
 		Wg_Obj* storedException = nullptr;
@@ -67,4 +149,28 @@ namespace wings {
 		size_t queuedJump = 0;
 	};
 
+	// The suspended frame of a generator function call, kept between resumptions
+	struct Generator {
+		Executor executor;
+		// The generator function, which owns the DefObject of the executor
+		Wg_Obj* function{};
+		bool started = false;
+		bool running = false;
+		bool finished = false;
+	};
+
+	// Runs a generator until its next yield. The value is the result of the yield the generator
+	// is suspended at, or the exception is raised there instead if it is not null.
+	// Returns null without raising an exception once the generator is exhausted.
+	Wg_Obj* ResumeGenerator(Wg_Obj* generator, Wg_Obj* value, Wg_Obj* exception);
+
+	// Raises exitClass at the yield a generator is suspended at. Returns false if the generator
+	// raised another exception or yielded again, in which case an exception is set.
+	bool CloseGenerator(Wg_Obj* generator, Wg_Obj* exitClass);
+
+	// Resumes the suspended call of a context with the result of the native function
+	// that suspended it, or raises the exception there instead if it is not null.
+	// Returns null without raising an exception if the call is suspended again.
+	Wg_Obj* ResumeSuspendedCall(Wg_Context* context, Wg_Obj* value, Wg_Obj* exception);
+
 }
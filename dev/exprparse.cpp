@@ -8,10 +8,11 @@ namespace wings {
 	static thread_local bool disableInOperator;
 
 	static CodeError ParseExpression(TokenIter& p, Expression& out, size_t minPrecedence, std::optional<Expression> preParsedArg = std::nullopt);
+	static CodeError ParseGeneratorExpression(TokenIter& p, Expression value, Expression& out);
 
-	TokenIter::TokenIter(const std::vector<Token>& tokens) :
+	TokenIter::TokenIter(std::span<const Token> tokens) :
 		index(0),
-		tokens(&tokens)
+		tokens(tokens)
 	{
 	}
 
@@ -26,15 +27,15 @@ namespace wings {
 	}
 
 	const Token& TokenIter::operator*() const {
-		return (*tokens)[index];
+		return tokens[index];
 	}
 
 	const Token* TokenIter::operator->() const {
-		return &(*tokens)[index];
+		return &tokens[index];
 	}
 
 	bool TokenIter::operator==(const TokenIter& rhs) const {
-		return index == rhs.index && tokens == rhs.tokens;
+		return index == rhs.index && tokens.data() == rhs.tokens.data();
 	}
 
 	bool TokenIter::operator!=(const TokenIter& rhs) const {
@@ -42,10 +43,12 @@ namespace wings {
 	}
 
 	bool TokenIter::EndReached() const {
-		return index >= tokens->size();
+		return index >= tokens.size();
 	}
 
-	static const std::unordered_map<std::string, Operation> BINARY_OP_STRINGS = {
+	using OpStringMap = std::unordered_map<std::string, Operation, StringHasher, std::equal_to<>>;
+
+	static const OpStringMap BINARY_OP_STRINGS = {
 		{ "+",  Operation::Add },
 		{ "-",  Operation::Sub },
 		{ "*",  Operation::Mul },
@@ -87,7 +90,7 @@ namespace wings {
 		{ ".", Operation::Dot },
 	};
 
-	static const std::unordered_map<std::string, Operation> PREFIX_UNARY_OP_STRINGS = {
+	static const OpStringMap PREFIX_UNARY_OP_STRINGS = {
 		{ "+", Operation::Pos },
 		{ "-", Operation::Neg },
 		{ "~", Operation::BitNot },
@@ -225,6 +228,7 @@ namespace wings {
 	}
 
 	CodeError ParseExpressionList(TokenIter& p, const std::string& terminate, std::vector<Expression>& out, bool isFnCall, bool* seenComma) {
+		size_t start = out.size();
 		bool mustTerminate = false;
 		bool seenKwarg = false;
 		if (seenComma) *seenComma = false;
@@ -287,6 +291,16 @@ namespace wings {
 				kw.variableName = std::move(keyword.value());
 				kw.children.push_back(std::move(expr));
 				out.push_back(std::move(kw));
+			} else if (terminate == ")" && out.size() == start && unpackType == Operation{}
+				&& !p.EndReached() && p->text == "for") {
+				// A generator expression must be the only item
+				Expression genexpr{};
+				if (auto error = ParseGeneratorExpression(p, std::move(expr), genexpr)) {
+					return error;
+				}
+				out.push_back(std::move(genexpr));
+				--p;
+				return CodeError::Good();
 			} else if (unpackType != Operation{}) {
 				Expression unpack{};
 				unpack.srcPos = expr.srcPos;
@@ -565,27 +579,8 @@ namespace wings {
 		}
 	}
 
-	static CodeError TryParseListComprehension(TokenIter& p, Expression& out, bool& isListComp) {
-		isListComp = false;
-		out.srcPos = p->srcPos;
-		out.operation = Operation::ListComprehension;
-		TokenIter begin = p;
-		++p;
-
-		Expression value{};
-		if (auto error = ParseExpression(p, value)) {
-			p = begin;
-			return CodeError::Good();
-		}
-
-		if (p.EndReached()) {
-			p = begin;
-			return CodeError::Good();
-		} else if (p->text != "for") {
-			p = begin;
-			return CodeError::Good();
-		}
-		isListComp = true;
+	// Parses the 'for' and optional 'if' clauses of a comprehension up to and including the closing bracket
+	static CodeError ParseComprehensionClauses(TokenIter& p, const std::string& closing, stat::For& forLoop, Expression& condition) {
 		++p;
 
 		std::vector<std::string> vars;
@@ -594,29 +589,26 @@ namespace wings {
 			return error;
 		}
 
-		AssignTarget assignTarget{};
 		if (!isTuple) {
-			assignTarget.type = AssignType::Direct;
-			assignTarget.direct = vars[0];
+			forLoop.assignTarget.type = AssignType::Direct;
+			forLoop.assignTarget.direct = vars[0];
 		} else {
-			assignTarget.type = AssignType::Pack;
+			forLoop.assignTarget.type = AssignType::Pack;
 			for (auto& var : vars) {
 				AssignTarget elem{};
 				elem.type = AssignType::Direct;
 				elem.direct = std::move(var);
-				assignTarget.pack.push_back(std::move(elem));
+				forLoop.assignTarget.pack.push_back(std::move(elem));
 			}
 		}
 		++p;
 
-		Expression iterable{};
-		if (auto error = ParseExpression(p, iterable)) {
+		if (auto error = ParseExpression(p, forLoop.expr)) {
 			return error;
 		}
 
-		Expression condition{};
 		if (p.EndReached()) {
-			return CodeError::Bad("Expected a ']'", (--p)->srcPos);
+			return CodeError::Bad("Expected a '" + closing + "'", (--p)->srcPos);
 		} else if (p->text == "if") {
 			++p;
 			if (auto error = ParseExpression(p, condition)) {
@@ -630,11 +622,41 @@ namespace wings {
 		}
 
 		if (p.EndReached()) {
-			return CodeError::Bad("Expected a ']'", (--p)->srcPos);
-		} else if (p->text != "]") {
-			return CodeError::Bad("Expected a ']'", p->srcPos);
+			return CodeError::Bad("Expected a '" + closing + "'", (--p)->srcPos);
+		} else if (p->text != closing) {
+			return CodeError::Bad("Expected a '" + closing + "'", p->srcPos);
 		}
 		++p;
+		return CodeError::Good();
+	}
+
+	static CodeError TryParseListComprehension(TokenIter& p, Expression& out, bool& isListComp) {
+		isListComp = false;
+		out.srcPos = p->srcPos;
+		out.operation = Operation::ListComprehension;
+		TokenIter begin = p;
+		++p;
+
+		Expression value{};
+		if (auto error = ParseExpression(p, value)) {
+			p = begin;
+			return CodeError::Good();
+		}
+
+		if (p.EndReached()) {
+			p = begin;
+			return CodeError::Good();
+		} else if (p->text != "for") {
+			p = begin;
+			return CodeError::Good();
+		}
+		isListComp = true;
+
+		stat::For forLoop;
+		Expression condition{};
+		if (auto error = ParseComprehensionClauses(p, "]", forLoop, condition)) {
+			return error;
+		}
 
 		std::string listName = "__ListComp" + std::to_string(Guid());
 
@@ -672,18 +694,93 @@ namespace wings {
 			ifStat.data = std::move(ifStatData);
 		}
 		
-		stat::For forLoop;
-		forLoop.assignTarget = std::move(assignTarget);
-		forLoop.expr = std::move(iterable);
 		forLoop.body.push_back(std::move(ifStat));
 
-		out.listComp.listName = listName;
-		out.listComp.forBody.push_back(TransformForToWhile(std::move(forLoop)));
-		ExpandCompositeStatements(out.listComp.forBody);
+		out.listComp->listName = listName;
+		out.listComp->forBody.push_back(TransformForToWhile(std::move(forLoop)));
+		ExpandCompositeStatements(out.listComp->forBody);
 		
 		return CodeError::Good();
 	}
 
+	// Parses the clauses of a generator expression whose value has already been parsed.
+	// The expression becomes a call to a generator function taking the outermost iterable.
+	static CodeError ParseGeneratorExpression(TokenIter& p, Expression value, Expression& out) {
+		SourcePosition srcPos = value.srcPos;
+
+		stat::For forLoop;
+		Expression condition{};
+		if (auto error = ParseComprehensionClauses(p, ")", forLoop, condition)) {
+			return error;
+		}
+		Expression iterable = std::move(forLoop.expr);
+
+		std::string iterableName = "__GenExpr" + std::to_string(Guid());
+		forLoop.expr.srcPos = srcPos;
+		forLoop.expr.operation = Operation::Variable;
+		forLoop.expr.variableName = iterableName;
+
+		Expression yield{};
+		yield.srcPos = srcPos;
+		yield.operation = Operation::Yield;
+		yield.children.push_back(std::move(value));
+
+		Statement yieldStat{};
+		yieldStat.srcPos = srcPos;
+		{
+			stat::Expr expr;
+			expr.expr = std::move(yield);
+			yieldStat.data = std::move(expr);
+		}
+
+		Statement ifStat{};
+		ifStat.srcPos = srcPos;
+		{
+			stat::If ifStatData;
+			ifStatData.expr = std::move(condition);
+			ifStatData.body.push_back(std::move(yieldStat));
+			ifStat.data = std::move(ifStatData);
+		}
+		forLoop.body.push_back(std::move(ifStat));
+
+		Expression fn{};
+		fn.srcPos = srcPos;
+		fn.operation = Operation::Function;
+		fn.def->name = "<genexpr>";
+		fn.def->parameters.push_back(Parameter{ iterableName });
+		fn.def->body.push_back(TransformForToWhile(std::move(forLoop)));
+		fn.def->isGenerator = true;
+		ExpandCompositeStatements(fn.def->body);
+		ResolveCaptures(fn);
+
+		out = {};
+		out.srcPos = srcPos;
+		out.operation = Operation::Call;
+		out.children.push_back(std::move(fn));
+		out.children.push_back(std::move(iterable));
+		return CodeError::Good();
+	}
+
+	static CodeError ParseYield(TokenIter& p, Expression& out) {
+		out.srcPos = p->srcPos;
+		out.operation = Operation::Yield;
+		++p;
+
+		Expression value{};
+		if (!p.EndReached() && p->text == "from") {
+			return CodeError::Bad("'yield from' can only be used as a statement", p->srcPos);
+		} else if (p.EndReached() || p->text == ")" || p->text == "]" || p->text == "}" || p->text == "," || p->text == ":") {
+			// A bare yield produces None
+			value.srcPos = out.srcPos;
+			value.operation = Operation::Literal;
+			value.literalValue.type = LiteralValue::Type::Null;
+		} else if (auto error = ParseExpression(p, value, (size_t)0)) {
+			return error;
+		}
+		out.children.push_back(std::move(value));
+		return CodeError::Good();
+	}
+
 	static CodeError ParseLambda(TokenIter& p, Expression& out) {
 		out.srcPos = p->srcPos;
 		++p;
@@ -710,6 +807,7 @@ namespace wings {
 		auto captures = GetReferencedVariables(lambdaExpr);
 		for (const auto& param : params)
 			captures.erase(param.name);
+		out.def->isGenerator = FindYield(lambdaExpr) != nullptr;
 
 		Statement lambdaRet{};
 		lambdaRet.srcPos = out.srcPos;
@@ -720,10 +818,10 @@ namespace wings {
 		}
 
 		out.operation = Operation::Function;
-		out.def.localCaptures = std::move(captures);
-		out.def.name = "<lambda>";
-		out.def.parameters = std::move(params);
-		out.def.body.push_back(std::move(lambdaRet));
+		out.def->localCaptures = std::move(captures);
+		out.def->name = "<lambda>";
+		out.def->parameters = std::move(params);
+		out.def->body.push_back(std::move(lambdaRet));
 
 		return CodeError::Good();
 	}
@@ -761,6 +859,8 @@ namespace wings {
 			if (auto error = ParseLambda(p, out)) {
 				return error;
 			}
+		} else if (p->text == "yield") {
+			return ParseYield(p, out);
 		} else {
 			switch (p->type) {
 			case Token::Type::Null:
@@ -782,6 +882,10 @@ namespace wings {
 				out.literalValue.type = LiteralValue::Type::String;
 				out.literalValue.s = p->literal.s;
 				break;
+			case Token::Type::Bytes:
+				out.literalValue.type = LiteralValue::Type::Bytes;
+				out.literalValue.s = p->literal.s;
+				break;
 			case Token::Type::Word:
 				out.operation = Operation::Variable;
 				out.variableName = p->text;
@@ -808,8 +912,9 @@ namespace wings {
 	}
 
 	static CodeError ParsePrefix(TokenIter& p, Expression& out) {
-		if (PREFIX_UNARY_OP_STRINGS.contains(p->text)) {
-			Operation op = PREFIX_UNARY_OP_STRINGS.at(p->text);
+		auto it = PREFIX_UNARY_OP_STRINGS.find(p->text);
+		if (it != PREFIX_UNARY_OP_STRINGS.end()) {
+			Operation op = it->second;
 			out.srcPos = p->srcPos;
 			++p;
 			if (p.EndReached()) {
@@ -833,11 +938,12 @@ namespace wings {
 			}
 		}
 
-		if (p.EndReached() || !BINARY_OP_STRINGS.contains(p->text)) {
+		auto it = p.EndReached() ? BINARY_OP_STRINGS.end() : BINARY_OP_STRINGS.find(p->text);
+		if (it == BINARY_OP_STRINGS.end()) {
 			out = std::move(lhs);
 			return CodeError::Good();
 		}
-		Operation op = BINARY_OP_STRINGS.at(p->text);
+		Operation op = it->second;
 		size_t precedence = PrecedenceOf(op);
 		if (precedence < minPrecedence) {
 			out = std::move(lhs);
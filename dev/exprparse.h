@@ -5,6 +5,7 @@
 #include <vector>
 #include <optional>
 #include <unordered_set>
+#include <memory>
 
 namespace wings {
 
@@ -29,6 +30,9 @@ namespace wings {
 		Function,
 		Unpack, UnpackMapForMapCreation, UnpackMapForCall,
 		Kwarg,
+		Yield,
+		// Produced by for loops
+		GetIter, ForIter,
 
 		CompoundAssignment,
 	};
@@ -58,6 +62,7 @@ namespace wings {
 			Int,
 			Float,
 			String,
+			Bytes,
 		} type;
 
 		union {
@@ -71,6 +76,40 @@ namespace wings {
 	struct Statement;
 	struct Parameter;
 
+	// Owns a value that is only allocated once it is written to. Most
+	// expressions are not functions or comprehensions, so their parts
+	// are kept out of line to keep the tree small.
+	template <class T>
+	struct LazyBox {
+		T* operator->() {
+			if (value == nullptr)
+				value = std::make_unique<T>();
+			return value.get();
+		}
+		const T* operator->() const {
+			static const T empty{};
+			return value ? value.get() : &empty;
+		}
+	private:
+		std::unique_ptr<T> value;
+	};
+
+	struct FunctionDefinition {
+		std::string name;
+		mutable std::vector<Parameter> parameters;
+		std::unordered_set<std::string> globalCaptures;
+		std::unordered_set<std::string> localCaptures;
+		std::unordered_set<std::string> variables;
+		std::vector<Statement> body;
+		// Whether the body contains a yield, so that calls create a generator
+		bool isGenerator = false;
+	};
+
+	struct ListComprehension {
+		std::string listName;
+		std::vector<Statement> forBody;
+	};
+
 	struct Expression {
 		Operation operation{};
 		std::vector<Expression> children;
@@ -79,19 +118,8 @@ namespace wings {
 		AssignTarget assignTarget;
 		std::string variableName;
 		LiteralValue literalValue;
-		struct {
-			std::string name;
-			mutable std::vector<Parameter> parameters;
-			std::unordered_set<std::string> globalCaptures;
-			std::unordered_set<std::string> localCaptures;
-			std::unordered_set<std::string> variables;
-			std::vector<Statement> body;
-		} def;
-
-		struct {
-			std::string listName;
-			std::vector<Statement> forBody;
-		} listComp;
+		LazyBox<FunctionDefinition> def;
+		LazyBox<ListComprehension> listComp;
 
 		Expression() = default;
 		Expression(Expression&&) = default;
@@ -105,7 +133,7 @@ namespace wings {
 	};
 
 	struct TokenIter {
-		TokenIter(const std::vector<Token>& tokens);
+		TokenIter(std::span<const Token> tokens);
 		TokenIter& operator++();
 		TokenIter& operator--();
 		const Token& operator*() const;
@@ -115,7 +143,7 @@ namespace wings {
 		bool EndReached() const;
 	private:
 		size_t index;
-		const std::vector<Token>* tokens;
+		std::span<const Token> tokens;
 	};
 
 	CodeError ParseExpression(TokenIter& p, Expression& out, bool disableInOp = false);
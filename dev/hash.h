@@ -9,37 +9,52 @@
 /*
 * The RelaxedSet and RelaxedMap are versions of std::unordered_set
 * and std::unordered_map with more relaxed requirements.
-* 
+*
 * Unlike the STL versions, an inconsistent hash or equality
 * function will yield unspecified behaviour instead of
 * undefined behaviour.
 * Furthermore, the container can be modified while iterating
-* through it. Doing so will yield unspecified but not undefined behaviour.
-* 
-* RelaxedMap will also iterate by insertion order. To achieve fast ordered iteration
-* and O(1) insertion, deletion, and lookup, deletions do not shrink the
-* underlying buffer.
-* 
+* through it, or from within the hash or equality function.
+* Doing so will yield unspecified but not undefined behaviour.
+*
+* Both containers iterate by insertion order. Items are stored densely
+* in insertion order alongside their hash, and a separate open addressing
+* table of indices into the items is used for lookup. Erased items leave a
+* hole which is skipped during iteration. The holes are compacted away
+* when the table grows or once they outnumber the live items.
+*
 * If an exception is thrown from the hash or equality function,
 * the container if left unmodified.
 */
 
 namespace wings {
 
-	template <class Key, class Hash, class Equal, class BucketItem>
+	template <class Key, class Item, class KeyOf, class Hash, class Equal>
 	struct RelaxedHash {
-	private:
-		using Bucket = std::vector<BucketItem>;
-		
+	protected:
+		struct Entry {
+			size_t hash;
+			std::optional<Item> item;
+		};
+
+		using Index = uint32_t;
+		static constexpr Index EMPTY = (Index)-1;
+		static constexpr Index DELETED = (Index)-2;
+		static constexpr size_t MIN_CAPACITY = 8;
+		static constexpr size_t NOT_FOUND = (size_t)-1;
+
+		// The position of an item in the index table and in the item storage
+		struct Location {
+			size_t slot;
+			size_t entry;
+		};
+
 	public:
-		virtual void rehash(size_t count) = 0;
-		
-		RelaxedHash() : hasher(), equal(), buckets(1) {
+		RelaxedHash() : hasher(), equal() {
 		}
 
 		bool contains(const Key& key) const {
-			const Bucket* buck = nullptr;
-			return get_item(key, &buck);
+			return lookup(key, hasher(key)).entry != NOT_FOUND;
 		}
 
 		bool empty() const noexcept {
@@ -50,85 +65,172 @@ namespace wings {
 			return mySize;
 		}
 
-		size_t bucket_count() const noexcept {
-			return buckets.size();
+		void clear() noexcept {
+			entries.clear();
+			indices.clear();
+			mySize = 0;
+			filled = 0;
 		}
 
-		size_t bucket(const Key& key) const {
-			return hasher(key) % bucket_count();
+		// The bytes used by the entries and the index table, excluding what the items refer to
+		size_t memory_usage() const noexcept {
+			return entries.capacity() * sizeof(Entry) + indices.capacity() * sizeof(Index);
 		}
 
-		size_t bucket_size(size_t n) noexcept {
-			return buckets[n].size();
-		}
+		// The approximate bytes added by inserting an item
+		static constexpr size_t ITEM_BYTES = sizeof(Entry) + 2 * sizeof(Index);
 
-		float load_factor() const noexcept {
-			return (float)size() / bucket_count();
+		// Makes room for count items so that inserting them does not grow the table
+		void reserve(size_t count) {
+			entries.reserve(count);
+			if (indices.size() * 2 <= (count + 1) * 3)
+				rebuild(count);
 		}
 
-		float max_load_factor() const noexcept {
-			return maxLoadFactor;
+	protected:
+		Location lookup(const Key& key, size_t hash) const {
+		restart:
+			if (indices.empty())
+				return { NOT_FOUND, NOT_FOUND };
+
+			size_t mask = indices.size() - 1;
+			size_t perturb = hash;
+			for (size_t slot = hash & mask; ; slot = next_slot(slot, perturb, mask)) {
+				Index index = indices[slot];
+				if (index == EMPTY)
+					return { slot, NOT_FOUND };
+				if (index == DELETED || entries[index].hash != hash)
+					continue;
+
+				// The equality function may modify the container, so
+				// copy the key and start over if the table has changed.
+				Key candidate = KeyOf()(*entries[index].item);
+				const Index* table = indices.data();
+				size_t capacity = indices.size();
+				bool eq = equal(candidate, key);
+				if (indices.data() != table || indices.size() != capacity || indices[slot] != index)
+					goto restart;
+				if (eq)
+					return { slot, index };
+			}
 		}
 
-		void max_load_factor(float ml) noexcept {
-			maxLoadFactor = ml;
-		}
+		size_t insert_new(size_t hash, Item item) {
+			if ((filled + 1) * 3 >= indices.size() * 2)
+				rebuild();
 
-	protected:
-		virtual BucketItem* get_item(const Key& key, Bucket** buck) = 0;
-		virtual const BucketItem* get_item(const Key& key, const Bucket** buck) const = 0;
-		
-		void incr_size() {
+			entries.push_back(Entry{ hash, std::move(item) });
+			size_t slot = free_slot(hash);
+			if (indices[slot] == EMPTY)
+				filled++;
+			indices[slot] = (Index)(entries.size() - 1);
 			mySize++;
-			if (load_factor() > max_load_factor())
-				rehash(bucket_count() * 2 + 1);
+			return entries.size() - 1;
 		}
 
-		void decr_size() {
+		void erase_entry(size_t entry) {
+			indices[slot_of(entry)] = DELETED;
+			entries[entry].item.reset();
 			mySize--;
+
+			size_t holes = entries.size() - mySize;
+			if (holes > MIN_CAPACITY && holes >= mySize)
+				rebuild();
+		}
+
+		// Removes the holes left by erased items and resizes the index table to fit
+		// the items, or at least minSize items
+		void rebuild(size_t minSize = 0) {
+			if (entries.size() != mySize) {
+				std::vector<Entry> compacted;
+				compacted.reserve(mySize);
+				for (auto& entry : entries)
+					if (entry.item.has_value())
+						compacted.push_back(std::move(entry));
+				entries = std::move(compacted);
+			}
+
+			size_t capacity = MIN_CAPACITY;
+			while (capacity * 2 <= (std::max(mySize, minSize) + 1) * 3)
+				capacity *= 2;
+
+			indices.assign(capacity, EMPTY);
+			for (size_t i = 0; i < entries.size(); i++)
+				indices[free_slot(entries[i].hash)] = (Index)i;
+			filled = entries.size();
 		}
 
-		void clear_buckets() noexcept {
-			for (auto& buck : buckets)
-				buck.clear();
-			mySize = 0;
+		size_t next_entry(size_t entry) const noexcept {
+			while (entry < entries.size() && !entries[entry].item.has_value())
+				entry++;
+			return entry;
 		}
-		
+
 		Hash hasher;
 		Equal equal;
-		std::vector<Bucket> buckets;
-		float maxLoadFactor = 1.0f;
+		std::vector<Entry> entries;
+		std::vector<Index> indices;
 		size_t mySize = 0;
+		// The number of slots in the index table that are not empty
+		size_t filled = 0;
+
+	private:
+		static size_t next_slot(size_t slot, size_t& perturb, size_t mask) noexcept {
+			perturb >>= 5;
+			return (slot * 5 + perturb + 1) & mask;
+		}
+
+		size_t free_slot(size_t hash) const noexcept {
+			size_t mask = indices.size() - 1;
+			size_t perturb = hash;
+			size_t slot = hash & mask;
+			while (indices[slot] != EMPTY && indices[slot] != DELETED)
+				slot = next_slot(slot, perturb, mask);
+			return slot;
+		}
+
+		size_t slot_of(size_t entry) const noexcept {
+			size_t mask = indices.size() - 1;
+			size_t perturb = entries[entry].hash;
+			size_t slot = perturb & mask;
+			while (indices[slot] != (Index)entry)
+				slot = next_slot(slot, perturb, mask);
+			return slot;
+		}
+	};
+
+	template <class Key>
+	struct RelaxedSetKeyOf {
+		const Key& operator()(const Key& key) const noexcept { return key; }
 	};
 
 	template <class Key, class Hash = std::hash<Key>, class Equal = std::equal_to<Key>>
-	struct RelaxedSet : RelaxedHash<Key, Hash, Equal, Key> {
+	struct RelaxedSet : RelaxedHash<Key, Key, RelaxedSetKeyOf<Key>, Hash, Equal> {
 	private:
 		template <class Container>
 		struct Iterator {
-			Iterator(Container* container = nullptr, size_t bucketIndex = (size_t)-1, size_t itemIndex = (size_t)-1) :
-				container(container), bucketIndex(bucketIndex), itemIndex(itemIndex) {
+			Iterator(Container* container = nullptr, size_t index = (size_t)-1) :
+				container(container), index(index) {
 				Revalidate();
 			}
-			
+
 			const Key& operator*() const {
-				return container->buckets[bucketIndex][itemIndex];
+				return container->entries[index].item.value();
 			}
 
 			const Key* operator->() const {
-				return &container->buckets[bucketIndex][itemIndex];
+				return &container->entries[index].item.value();
 			}
 
 			Iterator& operator++() {
-				itemIndex++;
+				index++;
 				Revalidate();
 				return *this;
 			}
 
 			bool operator==(const Iterator& rhs) const {
 				return (!container && !rhs.container)
-					|| (bucketIndex == rhs.bucketIndex
-					    && itemIndex == rhs.itemIndex);
+					|| (container == rhs.container && index == rhs.index);
 			}
 
 			bool operator!=(const Iterator& rhs) const {
@@ -136,107 +238,58 @@ namespace wings {
 			}
 
 			void Revalidate() {
-				while (!CheckEnd() && itemIndex >= container->buckets[bucketIndex].size()) {
-					bucketIndex++;
-					itemIndex = 0;
+				if (container) {
+					index = container->next_entry(index);
+					if (index >= container->entries.size())
+						container = nullptr;
 				}
 			}
 		private:
-			bool CheckEnd() {
-				if (container && bucketIndex >= container->buckets.size())
-					container = nullptr;
-				return container == nullptr;
-			}
-			
 			friend RelaxedSet;
 			Container* container;
-			size_t bucketIndex;
-			size_t itemIndex;
+			size_t index;
 		};
-		
-		using Bucket = std::vector<Key>;
 
 	public:
 		using iterator = Iterator<RelaxedSet>;
 		using const_iterator = Iterator<const RelaxedSet>;
 
-		void clear() noexcept {
-			this->clear_buckets();
-		}
-		
 		void insert(Key key) {
-			Bucket* buck = nullptr;
-			if (!this->get_item(key, &buck)) {
-				buck->push_back(std::move(key));
-				this->incr_size();
-			}
+			size_t hash = this->hasher(key);
+			if (this->lookup(key, hash).entry == this->NOT_FOUND)
+				this->insert_new(hash, std::move(key));
 		}
 
 		const_iterator find(const Key& key) const {
-			const Bucket* buck = nullptr;
-			if (auto* item = this->get_item(key, &buck)) {
-				return const_iterator{
-					this,
-					(size_t)(buck - this->buckets.data()),
-					(size_t)(item - buck->data())
-				};
-			}
+			size_t entry = this->lookup(key, this->hasher(key)).entry;
+			if (entry != this->NOT_FOUND)
+				return const_iterator{ this, entry };
 			return end();
 		}
 
 		void erase(iterator it) {
-			auto& buck = this->buckets[it.bucketIndex];
-			buck.erase(buck.begin() + it.itemIndex);
-			this->decr_size();
+			this->erase_entry(it.index);
 		}
 
 		void erase(const_iterator it) {
-			erase(iterator{ this, it.bucketIndex, it.itemIndex });
+			this->erase_entry(it.index);
 		}
 
-		void rehash(size_t count) override {
-			auto oldBuckets = std::move(this->buckets);
-			clear();
-			this->buckets.resize(count);
-			for (auto& oldBucket : oldBuckets) {
-				for (auto& item : oldBucket) {
-					Bucket* buck = nullptr;
-					this->get_item(item, &buck);
-					buck->push_back(std::move(item));
-					this->mySize++;
-				}
-			}
-		}
-
-		const_iterator cbegin() const noexcept { return const_iterator(this, 0, 0); }
+		const_iterator cbegin() const noexcept { return const_iterator(this, 0); }
 		const_iterator begin() const noexcept { return cbegin(); }
-		iterator begin() noexcept { return iterator(this, 0, 0); }
+		iterator begin() noexcept { return iterator(this, 0); }
 		const_iterator cend() const noexcept { return const_iterator(); }
 		const_iterator end() const noexcept { return cend(); }
 		iterator end() noexcept { return iterator(); }
-		
-	protected:
-		Key* get_item(const Key& key, Bucket** buck) override {
-			auto& b = this->buckets[this->bucket(key)];
-			*buck = &b;
-			for (auto& item : b)
-				if (this->equal(item, key))
-					return &item;
-			return nullptr;
-		}
+	};
 
-		const Key* get_item(const Key& key, const Bucket** buck) const override {
-			auto& b = this->buckets[this->bucket(key)];
-			*buck = &b;
-			for (auto& item : b)
-				if (this->equal(item, key))
-					return &item;
-			return nullptr;
-		}
+	template <class Key, class Value>
+	struct RelaxedMapKeyOf {
+		const Key& operator()(const std::pair<const Key, Value>& pair) const noexcept { return pair.first; }
 	};
-	
+
 	template <class Key, class Value, class Hash = std::hash<Key>, class Equal = std::equal_to<Key>>
-	struct RelaxedMap : RelaxedHash<Key, Hash, Equal, size_t> {
+	struct RelaxedMap : RelaxedHash<Key, std::pair<const Key, Value>, RelaxedMapKeyOf<Key, Value>, Hash, Equal> {
 	private:
 		template <class Container>
 		struct Iterator {
@@ -244,13 +297,13 @@ namespace wings {
 				container(container), index(index) {
 				Revalidate();
 			}
-			
+
 			auto& operator*() const {
-				return container->storage[index].value();
+				return container->entries[index].item.value();
 			}
 
 			auto* operator->() const {
-				return &container->storage[index].value();
+				return &container->entries[index].item.value();
 			}
 
 			Iterator& operator++() {
@@ -260,7 +313,8 @@ namespace wings {
 			}
 
 			bool operator==(const Iterator& rhs) const {
-				return (!container && !rhs.container) || index == rhs.index;
+				return (!container && !rhs.container)
+					|| (container == rhs.container && index == rhs.index);
 			}
 
 			bool operator!=(const Iterator& rhs) const {
@@ -268,25 +322,20 @@ namespace wings {
 			}
 
 			void Revalidate() {
-				while (!CheckEnd() && container->storage[index] == std::nullopt) {
-					index++;
+				if (container) {
+					index = container->next_entry(index);
+					if (index >= container->entries.size())
+						container = nullptr;
 				}
 			}
 		private:
-			bool CheckEnd() {
-				if (container && index >= container->storage.size())
-					container = nullptr;
-				return container == nullptr;
-			}
-
 			friend RelaxedMap;
 			Container* container;
 			size_t index;
 		};
 
-		using Bucket = std::vector<size_t>;
-		std::vector<std::optional<std::pair<const Key, Value>>> storage;
-		
+		using Pair = std::pair<const Key, Value>;
+
 	public:
 		using iterator = Iterator<RelaxedMap>;
 		using const_iterator = Iterator<const RelaxedMap>;
@@ -295,93 +344,66 @@ namespace wings {
 		RelaxedMap(RelaxedMap&&) = delete;
 		RelaxedMap& operator=(RelaxedMap&&) = delete;
 
-		void clear() noexcept {
-			this->clear_buckets();
-			storage.clear();
-		}
-		
-		void insert(std::pair<const Key, Value> pair) {
-			Bucket* buck = nullptr;
-			if (!this->get_item(pair.first, &buck)) {
-				buck->push_back(storage.size());
-				storage.push_back(std::move(pair));
-				this->incr_size();
-			}
+		void insert(Pair pair) {
+			size_t hash = this->hasher(pair.first);
+			if (this->lookup(pair.first, hash).entry == this->NOT_FOUND)
+				this->insert_new(hash, std::move(pair));
 		}
 
 		std::optional<Value> erase(const Key& key) {
-			Bucket* buck = nullptr;
-			if (auto* index = this->get_item(key, &buck)) {
-				buck->erase(std::find(buck->begin(), buck->end(), *index));
-				auto pair = std::move(storage[*index]);
-				storage[*index] = std::nullopt;
-				this->decr_size();
-				return pair.value().second;
-			}
-			return std::nullopt;
+			size_t entry = this->lookup(key, this->hasher(key)).entry;
+			if (entry == this->NOT_FOUND)
+				return std::nullopt;
+
+			Value value = std::move(this->entries[entry].item.value().second);
+			this->erase_entry(entry);
+			return value;
 		}
 
-		std::pair<const Key, Value> pop() {
-			size_t i = storage.size() - 1;
-			while (storage[i] == std::nullopt)
-				i--;
-			const auto& key = storage[i].value().first;
-
-			Bucket* buck = nullptr;
-			auto* index = this->get_item(key, &buck);
-			buck->erase(std::find(buck->begin(), buck->end(), *index));
-			auto pair = std::move(storage[*index]);
-			storage[*index] = std::nullopt;
-			this->decr_size();
-			return pair.value();
+		Pair pop() {
+			size_t entry = this->entries.size() - 1;
+			while (!this->entries[entry].item.has_value())
+				entry--;
+
+			Pair pair = std::move(this->entries[entry].item.value());
+			this->erase_entry(entry);
+			return pair;
 		}
-		
+
 		iterator find(const Key& key) {
-			Bucket* buck = nullptr;
-			if (auto* index = this->get_item(key, &buck))
-				return iterator{ this, *index };
+			size_t entry = this->lookup(key, this->hasher(key)).entry;
+			if (entry != this->NOT_FOUND)
+				return iterator{ this, entry };
 			return end();
 		}
 
 		const_iterator find(const Key& key) const {
-			const Bucket* buck = nullptr;
-			if (auto* index = this->get_item(key, &buck))
-				return iterator{ this, *index };
+			size_t entry = this->lookup(key, this->hasher(key)).entry;
+			if (entry != this->NOT_FOUND)
+				return const_iterator{ this, entry };
 			return end();
 		}
 
 		Value& at(const Key& key) {
-			if (auto* value = try_at(key))
-				return *value;
-			throw std::out_of_range("Key not found");
+			auto it = find(key);
+			if (it == end())
+				throw std::out_of_range("Key not found");
+			return it->second;
 		}
-		
+
 		const Value& at(const Key& key) const {
-			if (auto* value = try_at(key))
-				return *value;
-			throw std::out_of_range("Key not found");
+			auto it = find(key);
+			if (it == end())
+				throw std::out_of_range("Key not found");
+			return it->second;
 		}
 
 		Value& operator[](const Key& key) {
-			this->incr_size();
-			Bucket* buck = nullptr;
-			if (auto* index = this->get_item(key, &buck))
-				return storage[*index].value().second;
-			buck->push_back(storage.size());
-			storage.push_back(std::pair<const Key, Value>({ key, Value() }));
-			return storage.back().value().second;
-		}
-
-		void rehash(size_t count) override {
-			this->buckets.clear();
-			this->buckets.resize(count);
-			for (size_t i = 0; i < storage.size(); i++) {
-				if (storage[i] != std::nullopt) {
-					Bucket* buck = nullptr;
-					this->get_item(storage[i].value().first, &buck);
-					buck->push_back(i);
-				}
-			}
+			size_t hash = this->hasher(key);
+			size_t entry = this->lookup(key, hash).entry;
+			if (entry == this->NOT_FOUND)
+				entry = this->insert_new(hash, Pair(key, Value()));
+			return this->entries[entry].item.value().second;
 		}
 
 		const_iterator cbegin() const noexcept { return const_iterator(this, 0); }
@@ -390,24 +412,5 @@ namespace wings {
 		const_iterator cend() const noexcept { return const_iterator(); }
 		const_iterator end() const noexcept { return cend(); }
 		iterator end() noexcept { return iterator(); }
-
-	protected:
-		size_t* get_item(const Key& key, Bucket** buck) override {
-			auto& b = this->buckets[this->bucket(key)];
-			*buck = &b;
-			for (auto& index : b)
-				if (this->equal(storage[index].value().first, key))
-					return &index;
-			return nullptr;
-		}
-
-		const size_t* get_item(const Key& key, const Bucket** buck) const override {
-			auto& b = this->buckets[this->bucket(key)];
-			*buck = &b;
-			for (auto& index : b)
-				if (this->equal(storage[index].value().first, key))
-					return &index;
-			return nullptr;
-		}
 	};
 }
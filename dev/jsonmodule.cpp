@@ -0,0 +1,820 @@
+#include "jsonmodule.h"
+#include "common.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wings {
+	namespace jsonmodule {
+		// The decoder makes a single pass over the input without recursing. Finished values are
+		// kept on a stack and rooted by their reference count. A list or dict is only created once
+		// its closing bracket is reached, so it is allocated at its final size and filled directly.
+		// The encoder appends everything to a single string which becomes the result.
+
+		static constexpr const char* JSON_CODE = R"(
+class JSONDecodeError(ValueError):
+	pass
+
+def load(fp):
+	return loads(fp.read())
+
+def dump(obj, fp, **kwargs):
+	fp.write(dumps(obj, **kwargs))
+)";
+
+		static constexpr size_t MAX_DEPTH = 1000;
+
+		static bool IsJsonDigit(char c) {
+			return c >= '0' && c <= '9';
+		}
+
+		static int HexValue(char c) {
+			if (c >= '0' && c <= '9') return c - '0';
+			if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+			if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+			return -1;
+		}
+
+		static void AppendUtf8(std::string& s, uint32_t cp) {
+			if (cp < 0x80) {
+				s += (char)cp;
+			} else if (cp < 0x800) {
+				s += (char)(0xC0 | (cp >> 6));
+				s += (char)(0x80 | (cp & 0x3F));
+			} else if (cp < 0x10000) {
+				s += (char)(0xE0 | (cp >> 12));
+				s += (char)(0x80 | ((cp >> 6) & 0x3F));
+				s += (char)(0x80 | (cp & 0x3F));
+			} else {
+				s += (char)(0xF0 | (cp >> 18));
+				s += (char)(0x80 | ((cp >> 12) & 0x3F));
+				s += (char)(0x80 | ((cp >> 6) & 0x3F));
+				s += (char)(0x80 | (cp & 0x3F));
+			}
+		}
+
+		// Decodes the UTF-8 sequence starting at s[i] and returns its length, or 0 if it is invalid
+		static size_t DecodeUtf8(std::string_view s, size_t i, uint32_t& cp) {
+			unsigned char c = (unsigned char)s[i];
+			size_t len;
+			if (c >= 0xF0 && c <= 0xF7) {
+				len = 4;
+				cp = c & 0x07;
+			} else if (c >= 0xE0) {
+				len = 3;
+				cp = c & 0x0F;
+			} else if (c >= 0xC0) {
+				len = 2;
+				cp = c & 0x1F;
+			} else {
+				return 0;
+			}
+			if (c > 0xF7 || i + len > s.size())
+				return 0;
+			for (size_t j = 1; j < len; j++) {
+				unsigned char cont = (unsigned char)s[i + j];
+				if ((cont & 0xC0) != 0x80)
+					return 0;
+				cp = (cp << 6) | (cont & 0x3F);
+			}
+			return len;
+		}
+
+		struct Decoder {
+			Decoder(Wg_Context* context, Wg_Obj* errorClass, const char* buffer, size_t len) :
+				context(context), errorClass(errorClass), begin(buffer), p(buffer), end(buffer + len) {
+			}
+
+			~Decoder() {
+				for (Wg_Obj* value : values)
+					Wg_DecRef(value);
+			}
+
+			Wg_Obj* Parse() {
+				struct Frame {
+					size_t start;
+					bool isObject;
+				};
+				enum class Next {
+					Value,
+					Key,
+					AfterValue,
+				};
+
+				std::vector<Frame> frames;
+				Next next = Next::Value;
+				while (true) {
+					SkipWhitespace();
+					if (next == Next::Value) {
+						if (p == end) {
+							Error("Expecting value", p);
+							return nullptr;
+						}
+
+						if (*p == '[' || *p == '{') {
+							bool isObject = *p++ == '{';
+							SkipWhitespace();
+							if (p != end && *p == (isObject ? '}' : ']')) {
+								p++;
+								if (!EndContainer(values.size(), isObject))
+									return nullptr;
+								next = Next::AfterValue;
+							} else {
+								frames.push_back({ values.size(), isObject });
+								next = isObject ? Next::Key : Next::Value;
+							}
+							continue;
+						}
+
+						if (!Push(ParseScalar()))
+							return nullptr;
+						next = Next::AfterValue;
+					} else if (next == Next::Key) {
+						if (p == end || *p != '"') {
+							Error("Expecting property name enclosed in double quotes", p);
+							return nullptr;
+						}
+						if (!Push(ParseString(true)))
+							return nullptr;
+
+						SkipWhitespace();
+						if (p == end || *p != ':') {
+							Error("Expecting ':' delimiter", p);
+							return nullptr;
+						}
+						p++;
+						next = Next::Value;
+					} else {
+						if (frames.empty())
+							break;
+
+						Frame frame = frames.back();
+						if (p != end && *p == ',') {
+							p++;
+							next = frame.isObject ? Next::Key : Next::Value;
+						} else if (p != end && *p == (frame.isObject ? '}' : ']')) {
+							p++;
+							frames.pop_back();
+							if (!EndContainer(frame.start, frame.isObject))
+								return nullptr;
+						} else {
+							Error("Expecting ',' delimiter", p);
+							return nullptr;
+						}
+					}
+				}
+
+				if (p != end) {
+					Error("Extra data", p);
+					return nullptr;
+				}
+				return values.back();
+			}
+
+		private:
+			void Error(const char* message, const char* at) {
+				const char* lineStart = at;
+				while (lineStart != begin && lineStart[-1] != '\n')
+					lineStart--;
+
+				std::string msg = message;
+				msg += ": line " + std::to_string(std::count(begin, at, '\n') + 1);
+				msg += " column " + std::to_string(at - lineStart + 1);
+				msg += " (char " + std::to_string(at - begin) + ")";
+				if (errorClass) {
+					Wg_RaiseExceptionClass(errorClass, msg.c_str());
+				} else {
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, msg.c_str());
+				}
+			}
+
+			bool Push(Wg_Obj* value) {
+				if (value == nullptr)
+					return false;
+				values.push_back(value);
+				Wg_IncRef(value);
+				return true;
+			}
+
+			void PopFrom(size_t start) {
+				for (size_t i = start; i < values.size(); i++)
+					Wg_DecRef(values[i]);
+				values.resize(start);
+			}
+
+			void SkipWhitespace() {
+				while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+					p++;
+			}
+
+			bool Match(std::string_view word) {
+				if ((size_t)(end - p) < word.size() || std::string_view(p, word.size()) != word)
+					return false;
+				p += word.size();
+				return true;
+			}
+
+			Wg_Obj* ParseScalar() {
+				switch (*p) {
+				case '"':
+					return ParseString(false);
+				case 'n':
+					if (Match("null"))
+						return Wg_None(context);
+					break;
+				case 't':
+					if (Match("true"))
+						return Wg_NewBool(context, true);
+					break;
+				case 'f':
+					if (Match("false"))
+						return Wg_NewBool(context, false);
+					break;
+				case 'N':
+					if (Match("NaN"))
+						return Wg_NewFloat(context, std::numeric_limits<Wg_float>::quiet_NaN());
+					break;
+				case 'I':
+					if (Match("Infinity"))
+						return Wg_NewFloat(context, std::numeric_limits<Wg_float>::infinity());
+					break;
+				case '-':
+					if (Match("-Infinity"))
+						return Wg_NewFloat(context, -std::numeric_limits<Wg_float>::infinity());
+					return ParseNumber();
+				default:
+					if (IsJsonDigit(*p))
+						return ParseNumber();
+					break;
+				}
+				Error("Expecting value", p);
+				return nullptr;
+			}
+
+			Wg_Obj* ParseNumber() {
+				const char* start = p;
+				if (*p == '-')
+					p++;
+				if (p == end || !IsJsonDigit(*p)) {
+					Error("Expecting value", start);
+					return nullptr;
+				}
+
+				// Leading zeros are not allowed, so anything after a zero is left for the caller
+				if (*p == '0') {
+					p++;
+				} else {
+					while (p != end && IsJsonDigit(*p))
+						p++;
+				}
+
+				bool isFloat = false;
+				if (end - p >= 2 && *p == '.' && IsJsonDigit(p[1])) {
+					isFloat = true;
+					p += 2;
+					while (p != end && IsJsonDigit(*p))
+						p++;
+				}
+				if (p != end && (*p == 'e' || *p == 'E')) {
+					const char* exponent = p + 1;
+					if (exponent != end && (*exponent == '+' || *exponent == '-'))
+						exponent++;
+					if (exponent != end && IsJsonDigit(*exponent)) {
+						isFloat = true;
+						p = exponent;
+						while (p != end && IsJsonDigit(*p))
+							p++;
+					}
+				}
+
+				// Integers that do not fit in an int are read as a float
+				if (!isFloat) {
+					Wg_int i{};
+					if (std::from_chars(start, p, i).ec == std::errc())
+						return Wg_NewInt(context, i);
+				}
+
+				Wg_float f{};
+				if (std::from_chars(start, p, f).ec == std::errc::result_out_of_range)
+					f = std::strtod(std::string(start, p).c_str(), nullptr);
+				return Wg_NewFloat(context, f);
+			}
+
+			// Reads exactly 4 hex digits at p and only moves past them on success
+			bool ParseHex4(uint32_t& value) {
+				if (end - p < 4)
+					return false;
+				value = 0;
+				for (int i = 0; i < 4; i++) {
+					int digit = HexValue(p[i]);
+					if (digit < 0)
+						return false;
+					value = (value << 4) | (uint32_t)digit;
+				}
+				p += 4;
+				return true;
+			}
+
+			Wg_Obj* ParseString(bool key) {
+				const char* start = p++;
+
+				// Most strings have no escapes and can be created straight from the input
+				const char* run = p;
+				while (p != end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20)
+					p++;
+				if (p != end && *p == '"') {
+					std::string_view s(run, (size_t)(p - run));
+					p++;
+					if (key)
+						return InternString(context, s);
+					return Wg_NewStringBuffer(context, s.data(), (int)s.size());
+				}
+
+				scratch.assign(run, p);
+				while (true) {
+					if (p == end) {
+						Error("Unterminated string starting at", start);
+						return nullptr;
+					}
+
+					unsigned char c = (unsigned char)*p;
+					if (c == '"') {
+						p++;
+						break;
+					} else if (c < 0x20) {
+						Error("Invalid control character at", p);
+						return nullptr;
+					} else if (c != '\\') {
+						scratch += (char)c;
+						p++;
+						continue;
+					}
+
+					const char* escape = p++;
+					if (p == end) {
+						Error("Unterminated string starting at", start);
+						return nullptr;
+					}
+					switch (*p++) {
+					case '"': scratch += '"'; break;
+					case '\\': scratch += '\\'; break;
+					case '/': scratch += '/'; break;
+					case 'b': scratch += '\b'; break;
+					case 'f': scratch += '\f'; break;
+					case 'n': scratch += '\n'; break;
+					case 'r': scratch += '\r'; break;
+					case 't': scratch += '\t'; break;
+					case 'u': {
+						uint32_t cp;
+						if (!ParseHex4(cp)) {
+							Error("Invalid \\uXXXX escape", escape);
+							return nullptr;
+						}
+
+						// Combine a surrogate pair, otherwise a lone surrogate is kept as is
+						if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+							p += 2;
+							uint32_t low;
+							if (ParseHex4(low) && low >= 0xDC00 && low <= 0xDFFF) {
+								cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+							} else {
+								p -= 2;
+							}
+						}
+						AppendUtf8(scratch, cp);
+						break;
+					}
+					default:
+						Error("Invalid \\escape", escape);
+						return nullptr;
+					}
+				}
+
+				if (key)
+					return InternString(context, scratch);
+				return Wg_NewStringBuffer(context, scratch.data(), (int)scratch.size());
+			}
+
+			// Replaces the values from start onwards with a list or dict of them
+			bool EndContainer(size_t start, bool isObject) {
+				size_t count = values.size() - start;
+				size_t bytes = isObject ? count / 2 * WDict::ITEM_BYTES : count * sizeof(Wg_Obj*);
+				if (!ChargeBytes(context, bytes))
+					return false;
+
+				Wg_Obj* obj = Alloc(context);
+				if (obj == nullptr)
+					return false;
+
+				if (isObject) {
+					obj->attributes = context->builtins.dict->Get<Wg_Obj::Class>().instanceAttributes.Copy();
+					obj->type = ObjType::Map;
+					auto data = new WDict();
+					Wg_SetUserdata(obj, data);
+					Wg_RegisterFinalizer(obj, DeleteUserdata<WDict>, data);
+
+					try {
+						data->reserve(count / 2);
+						for (size_t i = start; i < values.size(); i += 2)
+							(*data)[values[i]] = values[i + 1];
+					} catch (HashException&) {
+						return false;
+					}
+				} else {
+					obj->attributes = context->builtins.list->Get<Wg_Obj::Class>().instanceAttributes.Copy();
+					obj->type = ObjType::List;
+					obj->EmplaceInline<std::vector<Wg_Obj*>>(values.begin() + start, values.end());
+				}
+
+				PopFrom(start);
+				return Push(obj);
+			}
+
+			Wg_Context* context;
+			Wg_Obj* errorClass;
+			const char* begin;
+			const char* p;
+			const char* end;
+			std::vector<Wg_Obj*> values;
+			std::string scratch;
+		};
+
+		struct EncodeOptions {
+			bool pretty = false;
+			std::string indent;
+			std::string itemSeparator = ", ";
+			std::string keySeparator = ": ";
+			bool sortKeys = false;
+			bool ensureAscii = true;
+		};
+
+		struct Encoder {
+			Encoder(Wg_Context* context, const EncodeOptions& options) :
+				context(context), options(options) {
+			}
+
+			bool Write(Wg_Obj* obj, size_t depth) {
+				if (Wg_IsNone(obj)) {
+					out += "null";
+				} else if (Wg_IsBool(obj)) {
+					out += Wg_GetBool(obj) ? "true" : "false";
+				} else if (Wg_IsInt(obj)) {
+					WriteInt(Wg_GetInt(obj));
+				} else if (obj->type == ObjType::Float) {
+					WriteFloat(Wg_GetFloat(obj));
+				} else if (Wg_IsString(obj)) {
+					WriteString(GetStringView(obj));
+				} else if (Wg_IsList(obj) || Wg_IsTuple(obj) || Wg_IsDictionary(obj)) {
+					if (depth >= MAX_DEPTH) {
+						Wg_RaiseException(context, WG_EXC_RECURSIONERROR, "maximum recursion depth exceeded while encoding a JSON object");
+						return false;
+					}
+					if (std::find(parents.begin(), parents.end(), obj) != parents.end()) {
+						Wg_RaiseException(context, WG_EXC_VALUEERROR, "Circular reference detected");
+						return false;
+					}
+
+					parents.push_back(obj);
+					bool ok = Wg_IsDictionary(obj) ? WriteDict(obj, depth + 1) : WriteArray(obj, depth + 1);
+					parents.pop_back();
+					return ok;
+				} else {
+					std::string msg = "Object of type " + WObjTypeToString(obj) + " is not JSON serializable";
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+					return false;
+				}
+				return true;
+			}
+
+			std::string out;
+
+		private:
+			void Newline(size_t depth) {
+				if (!options.pretty)
+					return;
+				out += '\n';
+				for (size_t i = 0; i < depth; i++)
+					out += options.indent;
+			}
+
+			void WriteInt(Wg_int i) {
+				char buf[32];
+				out.append(buf, std::to_chars(buf, buf + sizeof(buf), i).ptr);
+			}
+
+			// Uses the shortest digits that read back the same value, laid out like repr()
+			void WriteFloat(Wg_float f) {
+				if (std::isnan(f)) {
+					out += "NaN";
+					return;
+				} else if (std::isinf(f)) {
+					out += f > 0 ? "Infinity" : "-Infinity";
+					return;
+				}
+
+				char buf[64];
+				char* last = std::to_chars(buf, buf + sizeof(buf), f, std::chars_format::scientific).ptr;
+				int exponent = std::atoi(std::find(buf, last, 'e') + 1);
+				if (exponent >= -4 && exponent < 16) {
+					last = std::to_chars(buf, buf + sizeof(buf), f, std::chars_format::fixed).ptr;
+					out.append(buf, last);
+					if (std::find(buf, last, '.') == last)
+						out += ".0";
+				} else {
+					out.append(buf, last);
+				}
+			}
+
+			void WriteEscape(uint32_t unit) {
+				static constexpr const char* HEX = "0123456789abcdef";
+				out += "\\u";
+				for (int shift = 12; shift >= 0; shift -= 4)
+					out += HEX[(unit >> shift) & 0xF];
+			}
+
+			void WriteString(std::string_view s) {
+				out += '"';
+				size_t run = 0;
+				for (size_t i = 0; i < s.size(); i++) {
+					unsigned char c = (unsigned char)s[i];
+					bool plain = c >= 0x20 && c != '"' && c != '\\' && (!options.ensureAscii || c < 0x7F);
+					if (plain)
+						continue;
+
+					out.append(s.data() + run, i - run);
+					switch (c) {
+					case '"': out += "\\\""; break;
+					case '\\': out += "\\\\"; break;
+					case '\n': out += "\\n"; break;
+					case '\r': out += "\\r"; break;
+					case '\t': out += "\\t"; break;
+					case '\b': out += "\\b"; break;
+					case '\f': out += "\\f"; break;
+					default: {
+						uint32_t cp;
+						size_t len = c >= 0x80 ? DecodeUtf8(s, i, cp) : 0;
+						if (len == 0) {
+							WriteEscape(c);
+						} else if (cp >= 0x10000) {
+							WriteEscape(0xD800 + ((cp - 0x10000) >> 10));
+							WriteEscape(0xDC00 + ((cp - 0x10000) & 0x3FF));
+							i += len - 1;
+						} else {
+							WriteEscape(cp);
+							i += len - 1;
+						}
+						break;
+					}
+					}
+					run = i + 1;
+				}
+				out.append(s.data() + run, s.size() - run);
+				out += '"';
+			}
+
+			bool WriteKey(Wg_Obj* key) {
+				if (Wg_IsString(key)) {
+					WriteString(GetStringView(key));
+					return true;
+				}
+
+				out += '"';
+				if (Wg_IsNone(key)) {
+					out += "null";
+				} else if (Wg_IsBool(key)) {
+					out += Wg_GetBool(key) ? "true" : "false";
+				} else if (Wg_IsInt(key)) {
+					WriteInt(Wg_GetInt(key));
+				} else if (key->type == ObjType::Float) {
+					WriteFloat(Wg_GetFloat(key));
+				} else {
+					std::string msg = "keys must be str, int, float, bool or None, not " + WObjTypeToString(key);
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+					return false;
+				}
+				out += '"';
+				return true;
+			}
+
+			bool WriteArray(Wg_Obj* obj, size_t depth) {
+				const auto& items = obj->Get<std::vector<Wg_Obj*>>();
+				if (items.empty()) {
+					out += "[]";
+					return true;
+				}
+
+				out += '[';
+				for (size_t i = 0; i < items.size(); i++) {
+					if (i)
+						out += options.itemSeparator;
+					Newline(depth);
+					if (!Write(items[i], depth))
+						return false;
+				}
+				Newline(depth - 1);
+				out += ']';
+				return true;
+			}
+
+			bool WriteDict(Wg_Obj* obj, size_t depth) {
+				const auto& dict = obj->Get<WDict>();
+				if (dict.empty()) {
+					out += "{}";
+					return true;
+				}
+
+				std::vector<std::pair<Wg_Obj*, Wg_Obj*>> items;
+				items.reserve(dict.size());
+				for (const auto& [key, value] : dict)
+					items.push_back({ key, value });
+				if (options.sortKeys && !SortItems(items))
+					return false;
+
+				out += '{';
+				for (size_t i = 0; i < items.size(); i++) {
+					if (i)
+						out += options.itemSeparator;
+					Newline(depth);
+					if (!WriteKey(items[i].first))
+						return false;
+					out += options.keySeparator;
+					if (!Write(items[i].second, depth))
+						return false;
+				}
+				Newline(depth - 1);
+				out += '}';
+				return true;
+			}
+
+			// Keys can be sorted if they are all strings or all numbers
+			bool SortItems(std::vector<std::pair<Wg_Obj*, Wg_Obj*>>& items) {
+				auto isNumber = [](const Wg_Obj* obj) {
+					return Wg_IsIntOrFloat(obj) || Wg_IsBool(obj);
+				};
+				auto toNumber = [](const Wg_Obj* obj) {
+					return Wg_IsBool(obj) ? (Wg_float)Wg_GetBool(obj) : Wg_GetFloat(obj);
+				};
+
+				Wg_Obj* first = items[0].first;
+				for (const auto& [key, value] : items) {
+					bool comparable = Wg_IsString(first) ? Wg_IsString(key) : (isNumber(first) && isNumber(key));
+					if (!comparable && items.size() > 1) {
+						std::string msg = "'<' not supported between instances of '"
+							+ WObjTypeToString(key) + "' and '" + WObjTypeToString(first) + "'";
+						Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+						return false;
+					}
+				}
+
+				std::stable_sort(items.begin(), items.end(), [&](const auto& a, const auto& b) {
+					if (Wg_IsString(a.first))
+						return GetStringView(a.first) < GetStringView(b.first);
+					if (Wg_IsInt(a.first) && Wg_IsInt(b.first))
+						return Wg_GetInt(a.first) < Wg_GetInt(b.first);
+					return toNumber(a.first) < toNumber(b.first);
+					});
+				return true;
+			}
+
+			Wg_Context* context;
+			EncodeOptions options;
+			std::vector<const Wg_Obj*> parents;
+		};
+
+		static Wg_Obj* ParseJson(Wg_Context* context, Wg_Obj* errorClass, const char* buffer, size_t len) {
+			Decoder decoder(context, errorClass, buffer, len);
+			return decoder.Parse();
+		}
+
+		static Wg_Obj* ToJson(Wg_Context* context, Wg_Obj* obj, const EncodeOptions& options) {
+			Encoder encoder(context, options);
+			if (!encoder.Write(obj, 0))
+				return nullptr;
+			if (encoder.out.size() > (size_t)std::numeric_limits<int>::max()) {
+				Wg_RaiseException(context, WG_EXC_MEMORYERROR);
+				return nullptr;
+			}
+			return Wg_NewStringBuffer(context, encoder.out.data(), (int)encoder.out.size());
+		}
+
+		static Wg_Obj* loads(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* errorClass = Wg_GetGlobal(context, "JSONDecodeError");
+			if (errorClass == nullptr)
+				return nullptr;
+
+			if (Wg_IsString(argv[0])) {
+				std::string_view s = GetStringView(argv[0]);
+				return ParseJson(context, errorClass, s.data(), s.size());
+			}
+
+			void* data;
+			int len;
+			if (!Wg_TryGetBuffer(argv[0], &data, &len, nullptr)) {
+				std::string msg = "the JSON object must be str or bytes, not " + WObjTypeToString(argv[0]);
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+				return nullptr;
+			}
+			return ParseJson(context, errorClass, (const char*)data, (size_t)len);
+		}
+
+		static bool GetTruth(Wg_Obj* obj, bool& out) {
+			if (obj == nullptr)
+				return true;
+			Wg_Obj* truth = Wg_UnaryOp(WG_UOP_BOOL, obj);
+			if (truth == nullptr)
+				return false;
+			out = Wg_GetBool(truth);
+			return true;
+		}
+
+		static Wg_Obj* dumps(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT(1);
+
+			Wg_Obj* kw[4]{};
+			const char* keys[4] = { "indent", "separators", "sort_keys", "ensure_ascii" };
+			if (!Wg_ParseKwargs(Wg_GetKwargs(context), keys, 4, kw))
+				return nullptr;
+
+			EncodeOptions options;
+			if (kw[0] && !Wg_IsNone(kw[0])) {
+				options.pretty = true;
+				options.itemSeparator = ",";
+				if (Wg_IsInt(kw[0])) {
+					options.indent.assign((size_t)std::max<Wg_int>(Wg_GetInt(kw[0]), 0), ' ');
+				} else if (Wg_IsString(kw[0])) {
+					options.indent = GetStringView(kw[0]);
+				} else {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "indent must be an int, str or None");
+					return nullptr;
+				}
+			}
+
+			if (kw[1] && !Wg_IsNone(kw[1])) {
+				bool valid = Wg_IsTuple(kw[1]) || Wg_IsList(kw[1]);
+				if (valid) {
+					const auto& seps = kw[1]->Get<std::vector<Wg_Obj*>>();
+					valid = seps.size() == 2 && Wg_IsString(seps[0]) && Wg_IsString(seps[1]);
+					if (valid) {
+						options.itemSeparator = GetStringView(seps[0]);
+						options.keySeparator = GetStringView(seps[1]);
+					}
+				}
+				if (!valid) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "separators must be a pair of strings");
+					return nullptr;
+				}
+			}
+
+			if (!GetTruth(kw[2], options.sortKeys) || !GetTruth(kw[3], options.ensureAscii))
+				return nullptr;
+
+			return ToJson(context, argv[0], options);
+		}
+	}
+
+	bool ImportJson(Wg_Context* context) {
+		using namespace jsonmodule;
+		try {
+			RegisterFunction(context, "loads", loads);
+			RegisterFunction(context, "dumps", dumps);
+
+			if (!Execute(context, JSON_CODE, "json"))
+				throw LibraryInitException();
+
+			return true;
+		} catch (LibraryInitException&) {
+			return false;
+		}
+	}
+}
+
+extern "C" {
+	Wg_Obj* Wg_ParseJson(Wg_Context* context, const char* buffer, int len) {
+		WG_ASSERT(context && len >= 0 && (buffer || len == 0));
+		return wings::jsonmodule::ParseJson(context, nullptr, buffer ? buffer : "", (size_t)len);
+	}
+
+	Wg_Obj* Wg_ToJson(Wg_Obj* obj, int indent) {
+		WG_ASSERT(obj);
+		wings::jsonmodule::EncodeOptions options;
+		options.ensureAscii = false;
+		if (indent >= 0) {
+			options.pretty = true;
+			options.indent.assign((size_t)indent, ' ');
+			options.itemSeparator = ",";
+		} else {
+			options.itemSeparator = ",";
+			options.keySeparator = ":";
+		}
+		return wings::jsonmodule::ToJson(obj->context, obj, options);
+	}
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "wings.h"
+
+namespace wings {
+	bool ImportJson(Wg_Context* context);
+}
@@ -1,15 +1,14 @@
 #include "lex.h"
 
-#include <regex>
 #include <optional>
-#include <stack>
+#include <cstring>
 
 namespace wings {
 
 	std::string Token::ToString() const {
 		std::vector<std::pair<std::string, std::string>> props;
 
-		props.push_back({ "text", '"' + text + '"' });
+		props.push_back({ "text", '"' + std::string(text) + '"' });
 		props.push_back({ "srcPos", '(' + std::to_string(srcPos.line + 1)
 								  + ',' + std::to_string(srcPos.column + 1) + ')' });
 		switch (type) {
@@ -32,6 +31,10 @@ namespace wings {
 			props.push_back({ "type", "string" });
 			props.push_back({ "value", literal.s });
 			break;
+		case Token::Type::Bytes:
+			props.push_back({ "type", "bytes" });
+			props.push_back({ "value", literal.s });
+			break;
 		case Token::Type::Symbol:
 			props.push_back({ "type", "symbol" });
 			break;
@@ -58,10 +61,31 @@ namespace wings {
 		">>=", "<<=", "|=", "&=", "^=", ";", "--", "++"
 	};
 
-	static std::string NormalizeLineEndings(const std::string& text) {
-		auto s = std::regex_replace(text, std::regex("\r\n"), "\n");
-		std::replace(s.begin(), s.end(), '\r', '\n');
-		return s;
+	SourceText::SourceText(std::string_view code) {
+		// Normalize line endings
+		if (code.find('\r') == std::string_view::npos) {
+			text = code;
+		} else {
+			text.reserve(code.size());
+			for (size_t i = 0; i < code.size(); i++) {
+				if (code[i] != '\r') {
+					text += code[i];
+				} else {
+					text += '\n';
+					if (i + 1 < code.size() && code[i + 1] == '\n')
+						i++;
+				}
+			}
+		}
+
+		std::string_view view = text;
+		size_t last = 0;
+		size_t next = 0;
+		while ((next = view.find('\n', last)) != std::string_view::npos) {
+			lines.push_back(view.substr(last, next - last));
+			last = next + 1;
+		}
+		lines.push_back(view.substr(last));
 	}
 
 	static bool IsAlpha(char c) {
@@ -101,7 +125,7 @@ namespace wings {
 		return IsAlpha(c) || IsDigit(c);
 	}
 
-	static bool IsWhitespace(const std::string& s) {
+	static bool IsWhitespace(std::string_view s) {
 		return s.find_first_not_of(" \t") == std::string::npos;
 	}
 
@@ -109,34 +133,15 @@ namespace wings {
 		return c == ' ' || c == '\t';
 	}
 
-	static void StripComments(std::string& s) {
-		s.erase(
-			std::find(s.begin(), s.end(), '#'),
-			s.end()
-		);
-	}
-
-	static bool IsPossibleSymbol(const std::string& s) {
-		return std::any_of(SYMBOLS.begin(), SYMBOLS.end(), [&](const auto& x) { return x.starts_with(s); });
+	static std::string_view StripComments(std::string_view s) {
+		return s.substr(0, s.find('#'));
 	}
 
 	static bool IsPossibleSymbol(char c) {
-		return IsPossibleSymbol(std::string(1, c));
+		return std::any_of(SYMBOLS.begin(), SYMBOLS.end(), [&](const auto& x) { return x[0] == c; });
 	}
 
-	static std::vector<std::string> SplitLines(const std::string& s) {
-		std::vector<std::string> v;
-		size_t last = 0;
-		size_t next = 0;
-		while ((next = s.find('\n', last)) != std::string::npos) {
-			v.push_back(s.substr(last, next - last));
-			last = next + 1;
-		}
-		v.push_back(s.substr(last));
-		return v;
-	}
-
-	static int IndentOf(const std::string& line, std::optional<std::string>& indentString, size_t& indent) {
+	static int IndentOf(std::string_view line, std::optional<std::string_view>& indentString, size_t& indent) {
 		size_t i = 0;
 		while (true) {
 			// Reached end of line or comment before any code
@@ -179,13 +184,30 @@ namespace wings {
 		}
 	}
 
-	using StringIter = const char*;
+	// Reads as '\0' past the end of the line so that
+	// the scanners below do not need bounds checks.
+	struct StringIter {
+		const char* p;
+		const char* end;
+
+		char operator*() const { return p < end ? *p : '\0'; }
+		char operator[](size_t i) const { return p + i < end ? p[i] : '\0'; }
+		StringIter& operator++() { ++p; return *this; }
+		StringIter& operator+=(size_t n) { p += n; return *this; }
+		bool EndReached() const { return p >= end; }
+	};
+
+	static std::string_view Slice(StringIter start, StringIter end) {
+		return std::string_view(start.p, end.p - start.p);
+	}
 
 	static Token ConsumeWord(StringIter& p) {
+		StringIter start = p;
+		while (IsAlphaNum(*p))
+			++p;
+
 		Token t{};
-		for (; *p && IsAlphaNum(*p); ++p) {
-			t.text += *p;
-		}
+		t.text = Slice(start, p);
 		t.type = Token::Type::Word;
 		if (t.text == "None") {
 			t.type = Token::Type::Null;
@@ -212,8 +234,6 @@ namespace wings {
 		}
 
 		if (base != 10) {
-			t.text += p[0];
-			t.text += p[1];
 			p += 2;
 
 			if (!IsDigit(*p, base) && *p != '.') {
@@ -255,7 +275,7 @@ namespace wings {
 			return CodeError::Bad("Invalid numerical literal");
 		}
 
-		t.text = std::string(start, p);
+		t.text = Slice(start, p);
 		out = std::move(t);
 		return CodeError::Good();
 	}
@@ -276,13 +296,12 @@ namespace wings {
 	}
 
 	static CodeError ConsumeString(StringIter& p, Token& out) {
+		StringIter start = p;
 		char quote = *p;
 		++p;
 
 		Token t{};
 		for (; *p && *p != quote; ++p) {
-			t.text += *p;
-
 			// Escape sequences
 			if (*p == '\\') {
 				++p;
@@ -296,14 +315,12 @@ namespace wings {
 					if (!IsHexDigit(*p, d1)) {
 						return CodeError::Bad("Invalid hex escape sequence");
 					}
-					t.text += *p;
 					
 					++p;
 					int d2 = 0;
 					if (!IsHexDigit(*p, d2)) {
 						return CodeError::Bad("Invalid hex escape sequence");
 					}
-					t.text += *p;
 					
 					t.literal.s += (char)((d1 << 4) | d2);
 				} else {
@@ -321,7 +338,6 @@ namespace wings {
 					case '\\': esc = '\\'; break;
 					default: return CodeError::Bad("Invalid escape sequence");
 					}
-					t.text += *p;
 					t.literal.s += esc;
 				}
 			} else {
@@ -336,7 +352,7 @@ namespace wings {
 		// Skip closing quote
 		++p;
 
-		t.text = quote + t.text + quote;
+		t.text = Slice(start, p);
 		t.type = Token::Type::String;
 		out = std::move(t);
 		return CodeError::Good();
@@ -348,43 +364,56 @@ namespace wings {
 	}
 
 	static CodeError ConsumeSymbol(StringIter& p, Token& t) {
-		for (; *p && IsPossibleSymbol(t.text + *p); ++p) {
-			t.text += *p;
-		}
-		t.type = Token::Type::Symbol;
-
-		if (std::find(SYMBOLS.begin(), SYMBOLS.end(), t.text) == SYMBOLS.end()) {
-			return CodeError::Bad("Unrecognised symbol " + t.text);
-		} else {
-			return CodeError::Good();
+		// Every prefix of a symbol is also a symbol so the longest match is taken
+		constexpr size_t MAX_SYMBOL_LENGTH = 3;
+		size_t available = std::min<size_t>(MAX_SYMBOL_LENGTH, p.end - p.p);
+		for (size_t length = available; length > 0; length--) {
+			std::string_view text(p.p, length);
+			if (std::find(SYMBOLS.begin(), SYMBOLS.end(), text) != SYMBOLS.end()) {
+				t.text = text;
+				t.type = Token::Type::Symbol;
+				p += length;
+				return CodeError::Good();
+			}
 		}
+		return CodeError::Bad(std::string("Unrecognised symbol ") + *p);
 	}
 
-	static CodeError TokenizeLine(const std::string& line, std::vector<Token>& out) {
-		std::vector<Token> tokens;
+	// Appends the tokens of a line to out
+	static CodeError TokenizeLine(std::string_view line, std::vector<Token>& out) {
+		size_t first = out.size();
 		CodeError error = CodeError::Good();
 
-		StringIter p = line.data();
-		while (*p) {
-			size_t srcColumn = p - line.data();
+		StringIter p{ line.data(), line.data() + line.size() };
+		while (!p.EndReached()) {
+			size_t srcColumn = p.p - line.data();
 			bool wasWhitespace = false;
 
-			if (IsAlpha(*p)) {
-				tokens.push_back(ConsumeWord(p));
+			if ((*p == 'b' || *p == 'B') && (p[1] == '\'' || p[1] == '"')) {
+				StringIter start = p;
+				++p;
+				Token t{};
+				if (!(error = ConsumeString(p, t))) {
+					t.text = Slice(start, p);
+					t.type = Token::Type::Bytes;
+					out.push_back(std::move(t));
+				}
+			} else if (IsAlpha(*p)) {
+				out.push_back(ConsumeWord(p));
 			} else if (IsDigit(*p)) {
 				Token t{};
 				if (!(error = ConsumeNumber(p, t))) {
-					tokens.push_back(std::move(t));
+					out.push_back(std::move(t));
 				}
 			} else if (*p == '\'' || *p == '"') {
 				Token t{};
 				if (!(error = ConsumeString(p, t))) {
-					tokens.push_back(std::move(t));
+					out.push_back(std::move(t));
 				}
 			} else if (IsPossibleSymbol(*p)) {
 				Token t{};
 				if (!(error = ConsumeSymbol(p, t))) {
-					tokens.push_back(std::move(t));
+					out.push_back(std::move(t));
 				}
 			} else if (IsWhitespaceChar(*p)) {
 				ConsumeWhitespace(p);
@@ -396,22 +425,21 @@ namespace wings {
 			}
 
 			if (error) {
-				out.clear();
+				out.resize(first);
 				error.srcPos.column = srcColumn;
 				return error;
 			}
 
 			if (!wasWhitespace) {
-				tokens.back().srcPos.column = srcColumn;
+				out.back().srcPos.column = srcColumn;
 			}
 		}
 
-		out = std::move(tokens);
 		return CodeError::Good();
 	}
 
 	// Returns [no. of open brackets] minus [no. close brackets]
-	static int BracketBalance(std::vector<Token>& tokens) {
+	static int BracketBalance(std::span<const Token> tokens) {
 		int balance = 0;
 		for (const auto& t : tokens) {
 			if (t.text.size() == 1) {
@@ -424,51 +452,66 @@ namespace wings {
 		return balance;
 	}
 
-	LexResult Lex(std::string code) {
-		code = NormalizeLineEndings(code);
-		auto originalSource = SplitLines(code);
+	struct LogicalLine {
+		size_t firstToken;
+		size_t tokenCount;
+		size_t indent;
+	};
 
-		std::vector<std::string> lines = originalSource;
-		for (auto& line : lines)
-			StripComments(line);
+	static void BuildLexTree(LexTree& parent, size_t indent, const std::vector<Token>& tokens,
+		const std::vector<LogicalLine>& lines, size_t& i) {
+		while (i < lines.size() && lines[i].indent == indent) {
+			const auto& line = lines[i++];
+			auto& child = parent.children.emplace_back();
+			child.tokens = std::span<const Token>(tokens.data() + line.firstToken, line.tokenCount);
+			if (i < lines.size() && lines[i].indent > indent)
+				BuildLexTree(child, indent + 1, tokens, lines, i);
+		}
+	}
+
+	LexResult Lex(RcPtr<SourceText> source) {
+		const auto& sourceLines = source->lines;
 
 		CodeError error = CodeError::Good();
-		std::optional<std::string> indentString;
+		std::optional<std::string_view> indentString;
 		int bracketBalance = 0;
 
-		LexTree rootTree;
-		std::stack<LexTree*> parents;
-		parents.push(&rootTree);
+		// The tokens of the whole script are stored contiguously, so the
+		// tree is built once all lines are tokenized and the storage is
+		// no longer reallocated.
+		std::vector<Token> tokens;
+		std::vector<LogicalLine> lines;
 
-		for (size_t i = 0; i < lines.size(); i++) {
-			if (IsWhitespace(lines[i]))
+		for (size_t i = 0; i < sourceLines.size(); i++) {
+			std::string_view line = StripComments(sourceLines[i]);
+			if (IsWhitespace(line))
 				continue;
 
-			std::vector<Token> tokens;
-			if (error = TokenizeLine(lines[i], tokens)) {
+			size_t firstToken = tokens.size();
+			if (error = TokenizeLine(line, tokens)) {
 				// Line had tokenizing errors
 				error.srcPos.line = i;
 				break;
 			} else {
 				// Assign line numbers
-				for (auto& token : tokens) {
-					token.srcPos.line = i;
+				for (size_t j = firstToken; j < tokens.size(); j++) {
+					tokens[j].srcPos.line = i;
 				}
 			}
 
+			size_t tokenCount = tokens.size() - firstToken;
 			bool continuePrevLine = bracketBalance > 0;
-			bracketBalance = std::max(0, bracketBalance + BracketBalance(tokens));
+			bracketBalance = std::max(0, bracketBalance + BracketBalance({ tokens.data() + firstToken, tokenCount }));
 			if (continuePrevLine) {
 				// Ignore indenting and continue as previous line
-				auto& prevLineTokens = parents.top()->children.back().tokens;
-				prevLineTokens.insert(prevLineTokens.end(), tokens.begin(), tokens.end());
+				lines.back().tokenCount += tokenCount;
 				continue;
 			}
 
 			// Get indentation level
-			size_t parentIndent = parents.size() - 1;
+			size_t parentIndent = lines.empty() ? 0 : lines.back().indent;
 			size_t currentIndent = 0;
-			if (IndentOf(lines[i], indentString, currentIndent)) {
+			if (IndentOf(line, indentString, currentIndent)) {
 				error = CodeError::Bad("Invalid indentation", { i, 0 });
 				break;
 			}
@@ -477,27 +520,22 @@ namespace wings {
 				// Indented too much
 				error = CodeError::Bad("Indentation level increased by more than 1", { i, 0 });
 				break;
-			} else if (currentIndent == parentIndent + 1) {
-				// Indented
-				// Make the last child the new parent
-				if (parents.top()->children.empty()) {
-					error = CodeError::Bad("Indentation not expected", { i, 0 });
-					break;
-				}
-				parents.push(&parents.top()->children.back());
-			} else if (currentIndent < parentIndent) {
-				// De-indented
-				for (size_t j = 0; j < parentIndent - currentIndent; j++)
-					parents.pop();
+			} else if (currentIndent == parentIndent + 1 && lines.empty()) {
+				error = CodeError::Bad("Indentation not expected", { i, 0 });
+				break;
 			}
 
-			parents.top()->children.push_back(LexTree{ std::move(tokens), {} });
+			lines.push_back({ firstToken, tokenCount, currentIndent });
 		}
 
 		LexResult result{};
+		result.tokens = std::move(tokens);
+		if (!error) {
+			size_t i = 0;
+			BuildLexTree(result.lexTree, 0, result.tokens, lines, i);
+		}
 		result.error = std::move(error);
-		result.lexTree = std::move(rootTree);
-		result.originalSource = std::move(originalSource);
+		result.source = std::move(source);
 		return result;
 	}
 }
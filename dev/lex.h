@@ -1,8 +1,11 @@
 #pragma once
 #include "common.h"
+#include "rcptr.h"
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <span>
 
 namespace wings {
 	struct Token {
@@ -12,12 +15,14 @@ namespace wings {
 			Int,
 			Float,
 			String,
+			Bytes,
 			Symbol,
 			Word,
 			Keyword,
 		} type;
 
-		std::string text;
+		// Points into the SourceText the token was lexed from
+		std::string_view text;
 		SourcePosition srcPos;
 
 		struct {
@@ -33,15 +38,28 @@ namespace wings {
 	};
 
 	struct LexTree {
-		std::vector<Token> tokens;
+		std::span<const Token> tokens; // Points into LexResult::tokens
 		std::vector<LexTree> children;
 	};
 
+	// A script with normalized line endings, shared by the tokens lexed from
+	// it and the functions compiled from it. The lines point into text so
+	// the object is not copyable.
+	struct SourceText {
+		SourceText(std::string_view code);
+		SourceText(const SourceText&) = delete;
+		SourceText& operator=(const SourceText&) = delete;
+
+		std::string text;
+		std::vector<std::string_view> lines;
+	};
+
 	struct LexResult {
-		std::vector<std::string> originalSource;
+		RcPtr<SourceText> source; // Keeps the token text alive
+		std::vector<Token> tokens;
 		LexTree lexTree; // Root tree contains no tokens
 		CodeError error;
 	};
 
-	LexResult Lex(std::string code);
+	LexResult Lex(RcPtr<SourceText> source);
 }
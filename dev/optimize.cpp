@@ -0,0 +1,388 @@
+#include "optimize.h"
+#include "common.h"
+
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+namespace wings {
+	namespace optimizer {
+		using Type = Instruction::Type;
+		using Literal = LiteralInstruction;
+
+		constexpr Wg_int INT_MIN_VALUE = std::numeric_limits<Wg_int>::min();
+		constexpr Wg_int INT_MAX_VALUE = std::numeric_limits<Wg_int>::max();
+
+		static bool IsNumber(const Literal& value) {
+			return std::holds_alternative<Wg_int>(value) || std::holds_alternative<Wg_float>(value);
+		}
+
+		static Wg_float ToFloat(const Literal& value) {
+			if (auto* i = std::get_if<Wg_int>(&value))
+				return (Wg_float)*i;
+			return std::get<Wg_float>(value);
+		}
+
+		static bool IsTruthy(const Literal& value) {
+			if (auto* b = std::get_if<bool>(&value)) {
+				return *b;
+			} else if (auto* i = std::get_if<Wg_int>(&value)) {
+				return *i != 0;
+			} else if (auto* f = std::get_if<Wg_float>(&value)) {
+				return *f != 0;
+			} else if (auto* s = std::get_if<std::string>(&value)) {
+				return !s->empty();
+			} else if (auto* t = std::get_if<TupleLiteral>(&value)) {
+				return !t->items.empty();
+			} else if (auto* bytes = std::get_if<BytesLiteral>(&value)) {
+				return !bytes->data.empty();
+			} else {
+				return false;
+			}
+		}
+
+		// Converts a float result to an int the way the interpreter does,
+		// unless the conversion would overflow.
+		static std::optional<Literal> FloatToInt(Wg_float f) {
+			if (!(f >= (Wg_float)INT_MIN_VALUE && f < -(Wg_float)INT_MIN_VALUE))
+				return std::nullopt;
+			return (Wg_int)f;
+		}
+
+		// Mirrors FastNumericOp, but gives up whenever the operation would
+		// raise an exception or overflow so that it still happens at runtime.
+		static std::optional<Literal> FoldNumeric(Wg_BinOp op, const Literal& lhs, const Literal& rhs) {
+			bool ints = std::holds_alternative<Wg_int>(lhs) && std::holds_alternative<Wg_int>(rhs);
+			Wg_float l = ToFloat(lhs);
+			Wg_float r = ToFloat(rhs);
+			Wg_int a = ints ? std::get<Wg_int>(lhs) : 0;
+			Wg_int b = ints ? std::get<Wg_int>(rhs) : 0;
+
+			switch (op) {
+			case WG_BOP_ADD:
+				if (!ints)
+					return l + r;
+				if ((b > 0 && a > INT_MAX_VALUE - b) || (b < 0 && a < INT_MIN_VALUE - b))
+					return std::nullopt;
+				return a + b;
+			case WG_BOP_SUB:
+				if (!ints)
+					return l - r;
+				if ((b < 0 && a > INT_MAX_VALUE + b) || (b > 0 && a < INT_MIN_VALUE + b))
+					return std::nullopt;
+				return a - b;
+			case WG_BOP_MUL: {
+				if (!ints)
+					return l * r;
+				Wg_int product = (Wg_int)((Wg_uint)a * (Wg_uint)b);
+				if (a != 0 && (product / a != b || (a == -1 && b == INT_MIN_VALUE)))
+					return std::nullopt;
+				return product;
+			}
+			case WG_BOP_DIV:
+				if (r == 0)
+					return std::nullopt;
+				return l / r;
+			case WG_BOP_FLOORDIV:
+				if (r == 0)
+					return std::nullopt;
+				if (!ints)
+					return std::floor(l / r);
+				if (a == INT_MIN_VALUE && b == -1)
+					return std::nullopt;
+				return FloorDiv(a, b);
+			case WG_BOP_MOD: {
+				if (r == 0)
+					return std::nullopt;
+				if (!ints)
+					return std::fmod(l, r);
+				return FloorMod(a, b);
+			}
+			case WG_BOP_POW:
+				if (ints)
+					return FloatToInt(std::pow(l, r));
+				return std::pow(l, r);
+			case WG_BOP_BITAND:
+				return ints ? std::optional<Literal>(a & b) : std::nullopt;
+			case WG_BOP_BITOR:
+				return ints ? std::optional<Literal>(a | b) : std::nullopt;
+			case WG_BOP_BITXOR:
+				return ints ? std::optional<Literal>(a ^ b) : std::nullopt;
+			case WG_BOP_SHL:
+			case WG_BOP_SHR: {
+				if (!ints || b < 0 || b >= (Wg_int)sizeof(Wg_int) * 8)
+					return std::nullopt;
+				if (op == WG_BOP_SHL)
+					return (Wg_int)((Wg_uint)a << b);
+				return (Wg_int)((Wg_uint)a >> b);
+			}
+			default:
+				return std::nullopt;
+			}
+		}
+
+		// Mirrors the comparisons of TryFastBinaryOp
+		static std::optional<Literal> FoldComparison(Wg_BinOp op, const Literal& lhs, const Literal& rhs) {
+			bool eq{};
+			bool lt{};
+			if (auto* l = std::get_if<std::string>(&lhs)) {
+				auto* r = std::get_if<std::string>(&rhs);
+				if (r == nullptr)
+					return std::nullopt;
+				eq = *l == *r;
+				lt = *l < *r;
+			} else if (IsNumber(lhs) && IsNumber(rhs)) {
+				if (std::holds_alternative<Wg_int>(lhs)) {
+					eq = std::holds_alternative<Wg_int>(rhs) && std::get<Wg_int>(lhs) == std::get<Wg_int>(rhs);
+				} else {
+					eq = ToFloat(lhs) == ToFloat(rhs);
+				}
+				lt = ToFloat(lhs) < ToFloat(rhs);
+			} else {
+				return std::nullopt;
+			}
+
+			switch (op) {
+			case WG_BOP_EQ: return eq;
+			case WG_BOP_NE: return !eq;
+			case WG_BOP_LT: return lt;
+			case WG_BOP_LE: return lt || eq;
+			case WG_BOP_GT: return !lt && !eq;
+			case WG_BOP_GE: return !lt;
+			default: WG_UNREACHABLE();
+			}
+		}
+
+		static std::optional<Literal> FoldBinary(Wg_BinOp op, const Literal& lhs, const Literal& rhs) {
+			switch (op) {
+			case WG_BOP_EQ:
+			case WG_BOP_NE:
+			case WG_BOP_LT:
+			case WG_BOP_LE:
+			case WG_BOP_GT:
+			case WG_BOP_GE:
+				return FoldComparison(op, lhs, rhs);
+			default:
+				break;
+			}
+
+			if (IsNumber(lhs) && IsNumber(rhs))
+				return FoldNumeric(op, lhs, rhs);
+
+			auto* l = std::get_if<std::string>(&lhs);
+			auto* r = std::get_if<std::string>(&rhs);
+			if (op == WG_BOP_ADD && l && r)
+				return *l + *r;
+			return std::nullopt;
+		}
+
+		static std::optional<Literal> FoldUnary(std::string_view method, const Literal& arg) {
+			if (auto* i = std::get_if<Wg_int>(&arg)) {
+				if (method == "__pos__")
+					return *i;
+				if (method == "__neg__" && *i != INT_MIN_VALUE)
+					return -*i;
+				if (method == "__invert__")
+					return ~*i;
+			} else if (auto* f = std::get_if<Wg_float>(&arg)) {
+				if (method == "__pos__")
+					return *f;
+				if (method == "__neg__")
+					return -*f;
+			}
+			return std::nullopt;
+		}
+
+		template <class Fn>
+		static void ForEachLocation(std::vector<Instruction>& instructions, Fn fn) {
+			for (auto& instr : instructions) {
+				// The location of PopTry is unused
+				if (instr.jump && instr.type != Type::PopTry)
+					fn(instr.jump->location);
+				if (instr.pushTry) {
+					fn(instr.pushTry->exceptJump);
+					fn(instr.pushTry->finallyJump);
+				}
+				if (instr.queuedJump && instr.type == Type::QueueJump)
+					fn(instr.queuedJump->location);
+			}
+		}
+
+		// The instructions emitted so far. Only the first instruction of
+		// a sequence being merged may be a jump target, since jumping into
+		// the middle of the sequence would skip part of the merged result.
+		struct Output {
+			std::vector<Instruction> instructions;
+			std::vector<bool> targets;
+
+			size_t Size() const { return instructions.size(); }
+			Instruction& Back(size_t n) { return instructions[Size() - 1 - n]; }
+			bool Is(size_t n, Type type) const {
+				return n < Size() && instructions[Size() - 1 - n].type == type;
+			}
+			bool IsTarget(size_t n) const { return targets[Size() - 1 - n]; }
+			void Truncate(size_t size) {
+				instructions.resize(size);
+				targets.resize(size);
+			}
+			void Push(Instruction instr, bool target) {
+				instructions.push_back(std::move(instr));
+				targets.push_back(target);
+			}
+		};
+
+		static void MakeLiteral(Instruction& instr, Literal value) {
+			instr.type = Type::Literal;
+			instr.literal = std::make_unique<Literal>(std::move(value));
+		}
+
+		// Merges instr into the end of out where possible. Returns whether
+		// execution continues past the merged instructions, or nothing
+		// if instr could not be merged.
+		static std::optional<bool> Merge(Output& out, Instruction& instr) {
+			switch (instr.type) {
+			case Type::Operation:
+				// <literal> <literal> <op>
+				if (out.Is(0, Type::Literal) && out.Is(1, Type::Literal) && !out.IsTarget(0)) {
+					auto folded = FoldBinary(instr.operation->op, *out.Back(1).literal, *out.Back(0).literal);
+					if (folded) {
+						MakeLiteral(out.Back(1), std::move(*folded));
+						out.Truncate(out.Size() - 1);
+						return true;
+					}
+				}
+				break;
+			case Type::Call:
+				// Unary operators compile to <begin args> <literal> <get attr> <call>
+				if (out.Is(0, Type::Dot) && out.Is(1, Type::Literal) && out.Is(2, Type::PushArgFrame)
+					&& !out.IsTarget(0) && !out.IsTarget(1)) {
+					auto folded = FoldUnary(out.Back(0).string->string, *out.Back(1).literal);
+					if (folded) {
+						MakeLiteral(out.Back(2), std::move(*folded));
+						out.Truncate(out.Size() - 2);
+						return true;
+					}
+				}
+				break;
+			case Type::Not:
+				if (out.Is(0, Type::Literal)) {
+					bool truthy = IsTruthy(*out.Back(0).literal);
+					MakeLiteral(out.Back(0), !truthy);
+					return true;
+				}
+				break;
+			case Type::Tuple: {
+				// <begin args> <literal>... <tuple>
+				size_t count = 0;
+				while (out.Is(count, Type::Literal) && !out.IsTarget(count))
+					count++;
+				if (!out.Is(count, Type::PushArgFrame))
+					break;
+
+				TupleLiteral tuple;
+				for (size_t i = count; i-- > 0; )
+					tuple.items.push_back(std::move(*out.Back(i).literal));
+				MakeLiteral(out.Back(count), std::move(tuple));
+				out.Truncate(out.Size() - count);
+				return true;
+			}
+			case Type::Pop:
+				// Literals have no side effects
+				if (out.Is(0, Type::Literal)) {
+					out.Truncate(out.Size() - 1);
+					return true;
+				}
+				break;
+			case Type::JumpIfFalsePop:
+				if (out.Is(0, Type::Literal)) {
+					if (IsTruthy(*out.Back(0).literal)) {
+						out.Truncate(out.Size() - 1);
+						return true;
+					}
+					Instruction& jump = out.Back(0);
+					jump.type = Type::Jump;
+					jump.literal.reset();
+					jump.jump = std::move(instr.jump);
+					return false;
+				} else if (out.Is(0, Type::Not)) {
+					Instruction& jump = out.Back(0);
+					jump.type = Type::JumpIfTruePop;
+					jump.jump = std::move(instr.jump);
+					return true;
+				}
+				break;
+			default:
+				break;
+			}
+			return std::nullopt;
+		}
+
+		// Returns whether execution can continue past instr
+		static bool Emit(Output& out, Instruction instr, bool target) {
+			// A jump target cannot be merged into the instructions before it
+			if (!target) {
+				if (auto fallsThrough = Merge(out, instr))
+					return *fallsThrough;
+			}
+
+			bool fallsThrough = instr.type != Type::Jump
+				&& instr.type != Type::QueueJump
+				&& instr.type != Type::Return
+				&& instr.type != Type::Raise;
+			out.Push(std::move(instr), target);
+			return fallsThrough;
+		}
+
+		// Retargets jumps that land on an unconditional jump
+		static void ThreadJumps(std::vector<Instruction>& instructions) {
+			for (auto& instr : instructions) {
+				switch (instr.type) {
+				case Type::Jump:
+				case Type::JumpIfFalsePop:
+				case Type::JumpIfTruePop:
+				case Type::JumpIfFalse:
+				case Type::JumpIfTrue:
+				case Type::ForIter:
+					break;
+				default:
+					continue;
+				}
+
+				// Bounded in case the jumps form a cycle
+				size_t location = instr.jump->location;
+				for (size_t steps = 0; steps < instructions.size(); steps++) {
+					if (location >= instructions.size() || instructions[location].type != Type::Jump)
+						break;
+					location = instructions[location].jump->location;
+				}
+				instr.jump->location = location;
+			}
+		}
+	}
+
+	void Optimize(std::vector<Instruction>& instructions) {
+		using namespace optimizer;
+
+		size_t count = instructions.size();
+		std::vector<bool> targets(count + 1);
+		ForEachLocation(instructions, [&](size_t location) { targets[location] = true; });
+
+		// Instructions that are removed map to the next instruction kept
+		Output out;
+		std::vector<size_t> newLocations(count + 1);
+		bool reachable = true;
+		for (size_t i = 0; i < count; i++) {
+			newLocations[i] = out.Size();
+			if (targets[i])
+				reachable = true;
+			if (reachable)
+				reachable = Emit(out, std::move(instructions[i]), targets[i]);
+		}
+		newLocations[count] = out.Size();
+
+		instructions = std::move(out.instructions);
+		ForEachLocation(instructions, [&](size_t& location) { location = newLocations[location]; });
+		ThreadJumps(instructions);
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "compile.h"
+
+#include <vector>
+
+namespace wings {
+	// Rewrites the instructions of a function body before it is assembled.
+	// Constant expressions are folded, unreachable code is removed and
+	// jumps are simplified. Folding assumes that the operators of the
+	// builtin types are not replaced.
+	void Optimize(std::vector<Instruction>& instructions);
+}
@@ -0,0 +1,124 @@
+#include "parallelgc.h"
+
+namespace wings {
+	// A private stack is only shared once it has this many objects, so that
+	// short traces do not pay for locking
+	static constexpr size_t MIN_SHARED_OBJECTS = 64;
+
+	GCWorkers::GCWorkers(int helperCount) {
+		for (int i = 0; i < helperCount; i++)
+			threads.emplace_back(&GCWorkers::HelperLoop, this, (size_t)i + 1);
+	}
+
+	GCWorkers::~GCWorkers() {
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	size_t GCWorkers::Count() const {
+		return threads.size() + 1;
+	}
+
+	void GCWorkers::Run(const std::function<void(size_t)>& fn) {
+		{
+			std::lock_guard lock(mutex);
+			task = &fn;
+			running = threads.size();
+			generation++;
+		}
+		wake.notify_all();
+
+		fn(0);
+
+		std::unique_lock lock(mutex);
+		finished.wait(lock, [&] { return running == 0; });
+		task = nullptr;
+	}
+
+	void GCWorkers::HelperLoop(size_t worker) {
+		size_t seen = 0;
+		while (true) {
+			const std::function<void(size_t)>* fn;
+			{
+				std::unique_lock lock(mutex);
+				wake.wait(lock, [&] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+				fn = task;
+			}
+
+			(*fn)(worker);
+
+			std::lock_guard lock(mutex);
+			if (--running == 0)
+				finished.notify_one();
+		}
+	}
+
+	MarkStacks::MarkStacks(size_t workerCount) {
+		for (size_t i = 0; i < workerCount; i++)
+			shared.push_back(std::make_unique<Shared>());
+	}
+
+	void MarkStacks::Share(size_t worker, std::vector<const Wg_Obj*>& stack) {
+		Shared& own = *shared[worker];
+		if (stack.size() < MIN_SHARED_OBJECTS || own.size.load(std::memory_order_relaxed) != 0)
+			return;
+
+		// The oldest objects are nearest the roots so they are likely to lead to the most work
+		size_t half = stack.size() / 2;
+		std::lock_guard lock(own.mutex);
+		own.items.assign(stack.begin(), stack.begin() + half);
+		own.size = half;
+		stack.erase(stack.begin(), stack.begin() + half);
+	}
+
+	bool MarkStacks::Take(Shared& from, std::vector<const Wg_Obj*>& stack, bool all) {
+		if (from.size.load(std::memory_order_relaxed) == 0)
+			return false;
+
+		std::lock_guard lock(from.mutex);
+		size_t size = from.items.size();
+		if (size == 0)
+			return false;
+
+		size_t count = all ? size : (size + 1) / 2;
+		stack.insert(stack.end(), from.items.end() - count, from.items.end());
+		from.items.resize(size - count);
+		from.size = size - count;
+		return true;
+	}
+
+	bool MarkStacks::AnyShared() const {
+		for (const auto& s : shared)
+			if (s->size != 0)
+				return true;
+		return false;
+	}
+
+	bool MarkStacks::Refill(size_t worker, std::vector<const Wg_Obj*>& stack) {
+		while (true) {
+			if (Take(*shared[worker], stack, true))
+				return true;
+			for (size_t i = 1; i < shared.size(); i++)
+				if (Take(*shared[(worker + i) % shared.size()], stack, false))
+					return true;
+
+			// Only a worker that is marking can share more objects, so the
+			// mark is finished once every worker is idle at the same time.
+			idle++;
+			while (!AnyShared()) {
+				if (idle == shared.size())
+					return false;
+				std::this_thread::yield();
+			}
+			idle--;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "wings.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wings {
+	// Helper threads that run the parallel phases of a full collection together
+	// with the thread that owns the context. They are started by the first parallel
+	// collection of a context and sleep in between collections.
+	struct GCWorkers {
+		explicit GCWorkers(int helperCount);
+		~GCWorkers();
+		GCWorkers(const GCWorkers&) = delete;
+		GCWorkers& operator=(const GCWorkers&) = delete;
+
+		// The number of workers, including the owning thread
+		size_t Count() const;
+		// Calls task(worker) once for every worker, with the calling thread as
+		// worker 0, and returns once every call has finished.
+		void Run(const std::function<void(size_t)>& task);
+	private:
+		void HelperLoop(size_t worker);
+
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable finished;
+		const std::function<void(size_t)>* task = nullptr;
+		size_t generation = 0;
+		size_t running = 0;
+		bool stopping = false;
+	};
+
+	// The mark stacks of a parallel mark. Each worker marks from a private stack.
+	// When its shared stack is empty, it moves the older half of the private stack
+	// there so that workers that run out of objects can steal it.
+	struct MarkStacks {
+		explicit MarkStacks(size_t workerCount);
+
+		// Offers part of the private stack of a worker to the other workers
+		void Share(size_t worker, std::vector<const Wg_Obj*>& stack);
+		// Refills the empty private stack of a worker, from its own shared stack or by
+		// stealing from another worker. Returns false once every worker has run out.
+		bool Refill(size_t worker, std::vector<const Wg_Obj*>& stack);
+	private:
+		struct alignas(64) Shared {
+			std::mutex mutex;
+			std::vector<const Wg_Obj*> items;
+			std::atomic<size_t> size = 0;
+		};
+
+		bool Take(Shared& from, std::vector<const Wg_Obj*>& stack, bool all);
+		bool AnyShared() const;
+
+		std::vector<std::unique_ptr<Shared>> shared;
+		std::atomic<size_t> idle = 0;
+	};
+}
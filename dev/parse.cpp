@@ -91,7 +91,7 @@ namespace wings {
 		}
 
 		while (true) {
-			out.push_back(p->text);
+			out.emplace_back(p->text);
 			++p;
 
 			if (p.EndReached()) {
@@ -110,124 +110,77 @@ namespace wings {
 	}
 
 	Statement TransformForToWhile(stat::For forLoop) {
-		// __VarXXX = expression.__iter__()
+		// __VarXXX = GetIter(expression)
 		std::string rangeVarName = "__For" + std::to_string(Guid());
 
-		Expression loadIter;
-		loadIter.srcPos = forLoop.expr.srcPos;
-		loadIter.operation = Operation::Dot;
-		loadIter.variableName = "__iter__";
-		loadIter.children.push_back(std::move(forLoop.expr));
-
-		Expression callIter;
-		callIter.srcPos = forLoop.expr.srcPos;
-		callIter.operation = Operation::Call;
-		callIter.children.push_back(std::move(loadIter));
+		Expression getIter;
+		getIter.srcPos = forLoop.expr.srcPos;
+		getIter.operation = Operation::GetIter;
+		getIter.children.push_back(std::move(forLoop.expr));
 		
 		Statement rangeEval;
-		rangeEval.srcPos = forLoop.expr.srcPos;
+		rangeEval.srcPos = getIter.srcPos;
 		{
 			stat::Expr assign;
 			assign.expr.operation = Operation::Assign;
-			assign.expr.srcPos = forLoop.expr.srcPos;
+			assign.expr.srcPos = getIter.srcPos;
 			assign.expr.assignTarget.type = AssignType::Direct;
 			assign.expr.assignTarget.direct = rangeVarName;
 			assign.expr.children.push_back({}); // Dummy
-			assign.expr.children.push_back(std::move(callIter));
+			assign.expr.children.push_back(std::move(getIter));
 			rangeEval.data = std::move(assign);
 		}
 
 		// while True:
 		Expression condition;
-		condition.srcPos = forLoop.expr.srcPos;
+		condition.srcPos = rangeEval.srcPos;
 		condition.operation = Operation::Literal;
 		condition.literalValue.type = LiteralValue::Type::Bool;
 		condition.literalValue.b = true;
 
 		Statement wh;
-		wh.srcPos = forLoop.expr.srcPos;
+		wh.srcPos = rangeEval.srcPos;
 		{
 			stat::While w;
 			w.expr = std::move(condition);
 			wh.data = std::move(w);
 		}
 
-		// try:
-		//		__VarXXX = __VarXXX.__next__()
-		// except StopIteration:
-		//		break
-		Statement brk;
-		brk.srcPos = forLoop.expr.srcPos;
-		{
-			stat::Break b;
-			b.finallyCount = 1;
-			b.exitForLoopNormally = true;
-			brk.data = std::move(b);
-		}
-
-		Expression stopIter;
-		stopIter.srcPos = forLoop.expr.srcPos;
-		stopIter.operation = Operation::Variable;
-		stopIter.variableName = "StopIteration";
-
-		Statement except;
-		except.srcPos = forLoop.expr.srcPos;
-		{
-			stat::Except exc;
-			exc.type = std::move(stopIter);
-			exc.body.push_back(std::move(brk));
-			except.data = std::move(exc);
-		}
-
-		Statement tryExcept;
-		tryExcept.srcPos = forLoop.expr.srcPos;
-		{
-			stat::Try tr;
-			tr.exceptBlocks.push_back(std::move(except));
-			tryExcept.data = std::move(tr);
-		}
-
-		// vars = __VarXXX.__next__()
+		// vars = ForIter(__VarXXX)
+		// ForIter leaves the loop normally once the iterator is exhausted
 		Expression rangeVar;
-		rangeVar.srcPos = forLoop.expr.srcPos;
+		rangeVar.srcPos = rangeEval.srcPos;
 		rangeVar.operation = Operation::Variable;
 		rangeVar.variableName = rangeVarName;
 
-		Expression loadNext;
-		loadNext.srcPos = forLoop.expr.srcPos;
-		loadNext.operation = Operation::Dot;
-		loadNext.variableName = "__next__";
-		loadNext.children.push_back(std::move(rangeVar));
-
-		Expression callNext;
-		callNext.srcPos = forLoop.expr.srcPos;
-		callNext.operation = Operation::Call;
-		callNext.children.push_back(std::move(loadNext));
+		Expression forIter;
+		forIter.srcPos = rangeEval.srcPos;
+		forIter.operation = Operation::ForIter;
+		forIter.children.push_back(std::move(rangeVar));
 
 		Expression iterAssign;
-		iterAssign.srcPos = forLoop.expr.srcPos;
+		iterAssign.srcPos = rangeEval.srcPos;
 		iterAssign.operation = Operation::Assign;
 		iterAssign.assignTarget = forLoop.assignTarget;
 		iterAssign.children.push_back({}); // Dummy
-		iterAssign.children.push_back(std::move(callNext));
+		iterAssign.children.push_back(std::move(forIter));
 
 		Statement iterAssignStat;
-		iterAssignStat.srcPos = forLoop.expr.srcPos;
+		iterAssignStat.srcPos = rangeEval.srcPos;
 		{
 			stat::Expr expr;
 			expr.expr = std::move(iterAssign);
 			iterAssignStat.data = std::move(expr);
 		}
-		tryExcept.Get<stat::Try>().body.push_back(std::move(iterAssignStat));
 
 		// Transfer body over
 		auto& whileBody = wh.Get<stat::While>().body;
-		whileBody.push_back(std::move(tryExcept));
+		whileBody.push_back(std::move(iterAssignStat));
 		for (auto& child : forLoop.body)
 			whileBody.push_back(std::move(child));
 
 		Statement out;
-		out.srcPos = forLoop.expr.srcPos;
+		out.srcPos = rangeEval.srcPos;
 		{
 			stat::Composite comp;
 			comp.body.push_back(std::move(rangeEval));
@@ -254,7 +207,7 @@ namespace wings {
 			} else if (p->type != Token::Type::Word) {
 				return CodeError::Bad("Expected a variable name", p->srcPos);
 			}
-			vars.push_back(p->text);
+			vars.emplace_back(p->text);
 			++p;
 
 			if (!p.EndReached() && p->text == ",") {
@@ -342,7 +295,7 @@ namespace wings {
 				return CodeError::Bad("Expected a parameter name", p->srcPos);
 			}
 
-			std::string parameterName = p->text;
+			std::string parameterName(p->text);
 
 			// Check for duplicate parameters
 			if (std::find_if(out.begin(), out.end(), [&](const Parameter& p) {
@@ -403,6 +356,12 @@ namespace wings {
 		std::unordered_set<std::string> variables;
 		if (expr.operation == Operation::Variable) {
 			variables.insert(expr.variableName);
+		} else if (expr.operation == Operation::Function) {
+			// Nested functions, such as lambdas and generator expressions, capture from this scope
+			variables.insert(expr.def->localCaptures.begin(), expr.def->localCaptures.end());
+			for (const auto& parameter : expr.def->parameters)
+				if (parameter.defaultValue)
+					variables.merge(GetReferencedVariables(parameter.defaultValue.value()));
 		} else {
 			for (const auto& child : expr.children) {
 				variables.merge(GetReferencedVariables(child));
@@ -435,22 +394,77 @@ namespace wings {
 		}
 	}
 
-	static void ResolveCaptures(Expression& func) {
+	static const Expression* FindYield(const std::vector<Statement>& body);
+
+	// Finds a yield that belongs to the function containing an expression. Yields in the
+	// bodies of nested functions are skipped, but list comprehensions are compiled inline.
+	const Expression* FindYield(const Expression& expr) {
+		if (expr.operation == Operation::Yield)
+			return &expr;
+
+		for (const auto& child : expr.children)
+			if (const Expression* yield = FindYield(child))
+				return yield;
+
+		if (expr.operation == Operation::Function) {
+			for (const auto& parameter : expr.def->parameters)
+				if (parameter.defaultValue)
+					if (const Expression* yield = FindYield(parameter.defaultValue.value()))
+						return yield;
+		} else if (expr.operation == Operation::ListComprehension) {
+			return FindYield(expr.listComp->forBody);
+		}
+		return nullptr;
+	}
+
+	static const Expression* FindYield(const std::vector<Statement>& body) {
+		for (const auto& child : body) {
+			const Expression* yield = nullptr;
+			if (auto* node = child.GetIf<stat::Expr>()) {
+				yield = FindYield(node->expr);
+			} else if (auto* node = child.GetIf<stat::If>()) {
+				if (!(yield = FindYield(node->expr)) && !(yield = FindYield(node->body)) && node->elseClause)
+					yield = FindYield(node->elseClause->Get<stat::Else>().body);
+			} else if (auto* node = child.GetIf<stat::While>()) {
+				if (!(yield = FindYield(node->expr)) && !(yield = FindYield(node->body)) && node->elseClause)
+					yield = FindYield(node->elseClause->Get<stat::Else>().body);
+			} else if (auto* node = child.GetIf<stat::Try>()) {
+				if (!(yield = FindYield(node->body)) && !(yield = FindYield(node->exceptBlocks)))
+					yield = FindYield(node->finallyBody);
+			} else if (auto* node = child.GetIf<stat::Except>()) {
+				if (!node->type || !(yield = FindYield(node->type.value())))
+					yield = FindYield(node->body);
+			} else if (auto* node = child.GetIf<stat::Raise>()) {
+				yield = FindYield(node->expr);
+			} else if (auto* node = child.GetIf<stat::Return>()) {
+				yield = FindYield(node->expr);
+			} else if (auto* node = child.GetIf<stat::Def>()) {
+				yield = FindYield(node->expr);
+			} else if (auto* node = child.GetIf<stat::Composite>()) {
+				yield = FindYield(node->body);
+			}
+			if (yield)
+				return yield;
+		}
+		return nullptr;
+	}
+
+	void ResolveCaptures(Expression& func) {
 		std::unordered_set<std::string> writeVars;
 		std::unordered_set<std::string> allVars;
 		
 		auto processExpression = [&]<class T>(const T* data) {
 			const Expression& expr = data->expr;
 			if (expr.operation == Operation::Function) {
-				writeVars.insert(expr.def.name);
-				allVars.insert(expr.def.name);
-				for (const auto& parameter : expr.def.parameters) {
+				writeVars.insert(expr.def->name);
+				allVars.insert(expr.def->name);
+				for (const auto& parameter : expr.def->parameters) {
 					if (parameter.defaultValue) {
 						writeVars.merge(GetWriteVariables(parameter.defaultValue.value()));
 						allVars.merge(GetReferencedVariables(parameter.defaultValue.value()));
 					}
 				}
-				allVars.insert(expr.def.localCaptures.begin(), expr.def.localCaptures.end());
+				allVars.insert(expr.def->localCaptures.begin(), expr.def->localCaptures.end());
 			} else {
 				writeVars.merge(GetWriteVariables(expr));
 				allVars.merge(GetReferencedVariables(expr));
@@ -479,23 +493,23 @@ namespace wings {
 					writeVars.insert(node->name);
 					allVars.insert(node->name);
 				} else if (auto* node = child.GetIf<stat::Def>()) {
-					writeVars.insert(node->expr.def.name);
-					allVars.insert(node->expr.def.name);
+					writeVars.insert(node->expr.def->name);
+					allVars.insert(node->expr.def->name);
 				} else if (auto* node = child.GetIf<stat::Global>()) {
-					func.def.globalCaptures.insert(node->name);
+					func.def->globalCaptures.insert(node->name);
 				} else if (auto* node = child.GetIf<stat::NonLocal>()) {
-					func.def.localCaptures.insert(node->name);
+					func.def->localCaptures.insert(node->name);
 				}
 			}
 		};
 
-		scan(func.def.body);
+		scan(func.def->body);
 
 		std::vector<std::string> parameterVars;
-		for (const auto& param : func.def.parameters)
+		for (const auto& param : func.def->parameters)
 			parameterVars.push_back(param.name);
-		func.def.localCaptures.merge(SetDifference(allVars, writeVars, parameterVars));
-		func.def.variables = SetDifference(writeVars, func.def.globalCaptures, func.def.localCaptures, parameterVars);
+		func.def->localCaptures.merge(SetDifference(allVars, writeVars, parameterVars));
+		func.def->variables = SetDifference(writeVars, func.def->globalCaptures, func.def->localCaptures, parameterVars);
 	}
 
 	static CodeError ParseDef(const LexTree& node, Statement& out) {		
@@ -511,7 +525,7 @@ namespace wings {
 		} else if (p->type != Token::Type::Word) {
 			return CodeError::Bad("Expected a function name", p->srcPos);
 		}
-		fn.def.name = p->text;
+		fn.def->name = p->text;
 		++p;
 
 		if (p.EndReached()) {
@@ -521,7 +535,7 @@ namespace wings {
 		}
 		++p;
 
-		if (auto error = ParseParameterList(p, fn.def.parameters)) {
+		if (auto error = ParseParameterList(p, fn.def->parameters)) {
 			return error;
 		}
 
@@ -536,10 +550,11 @@ namespace wings {
 			return error;
 		}
 
-		if (auto error = ParseBody<stat::Def>(node, fn.def.body)) {
+		if (auto error = ParseBody<stat::Def>(node, fn.def->body)) {
 			return error;
 		}
 		
+		fn.def->isGenerator = FindYield(fn.def->body) != nullptr;
 		ResolveCaptures(fn);
 		
 		stat::Def def;
@@ -591,7 +606,7 @@ namespace wings {
 				return error;
 			}
 			stat.srcPos = method.tokens[0].srcPos;
-			klass.methodNames.push_back(stat.Get<stat::Def>().expr.def.name);
+			klass.methodNames.push_back(stat.Get<stat::Def>().expr.def->name);
 			klass.body.push_back(std::move(stat));
 		}
 
@@ -990,6 +1005,49 @@ namespace wings {
 		return CheckTrailingTokens(p);
 	}
 
+	static CodeError ParseYield(const LexTree& node, Statement& out) {
+		TokenIter p(node.tokens);
+		++p;
+		if (p.EndReached() || p->text != "from")
+			return ParseExpressionStatement(node, out);
+		++p;
+
+		// yield from iterable  ->  for __YieldFromXXX in iterable: yield __YieldFromXXX
+		stat::For forLoop;
+		if (auto error = ParseExpression(p, forLoop.expr)) {
+			return error;
+		} else if (auto error = CheckTrailingTokens(p)) {
+			return error;
+		}
+
+		SourcePosition srcPos = node.tokens[0].srcPos;
+		std::string itemName = "__YieldFrom" + std::to_string(Guid());
+		forLoop.assignTarget.type = AssignType::Direct;
+		forLoop.assignTarget.direct = itemName;
+
+		Expression item{};
+		item.srcPos = srcPos;
+		item.operation = Operation::Variable;
+		item.variableName = itemName;
+
+		Expression yield{};
+		yield.srcPos = srcPos;
+		yield.operation = Operation::Yield;
+		yield.children.push_back(std::move(item));
+
+		Statement yieldStat{};
+		yieldStat.srcPos = srcPos;
+		{
+			stat::Expr expr;
+			expr.expr = std::move(yield);
+			yieldStat.data = std::move(expr);
+		}
+		forLoop.body.push_back(std::move(yieldStat));
+
+		out = TransformForToWhile(std::move(forLoop));
+		return CodeError::Good();
+	}
+
 	static CodeError ParseImportFrom(const LexTree& node, Statement& out) {
 		TokenIter p(node.tokens);
 		++p;
@@ -1022,7 +1080,7 @@ namespace wings {
 				if (p->type != Token::Type::Word) {
 					return CodeError::Bad("Expected a name", p->srcPos);
 				}
-				importFrom.names.push_back(p->text);
+				importFrom.names.emplace_back(p->text);
 				++p;
 
 				if (p.EndReached()) {
@@ -1084,7 +1142,7 @@ namespace wings {
 
 	using ParseFn = CodeError(*)(const LexTree& node, Statement& out);
 
-	static const std::unordered_map<std::string, ParseFn> STATEMENT_STARTINGS = {
+	static const std::unordered_map<std::string, ParseFn, StringHasher, std::equal_to<>> STATEMENT_STARTINGS = {
 		{ "if", ParseIf },
 		{ "elif", ParseElif },
 		{ "else", ParseElse },
@@ -1105,12 +1163,14 @@ namespace wings {
 		{ "with", ParseWith },
 		{ "from", ParseImportFrom },
 		{ "import", ParseImport },
+		{ "yield", ParseYield },
 	};
 
 	static CodeError ParseStatement(const LexTree& node, Statement& out) {
 		const auto& firstToken = node.tokens[0].text;
-		if (STATEMENT_STARTINGS.contains(firstToken)) {
-			if (auto error = STATEMENT_STARTINGS.at(firstToken)(node, out)) {
+		auto it = STATEMENT_STARTINGS.find(firstToken);
+		if (it != STATEMENT_STARTINGS.end()) {
+			if (auto error = it->second(node, out)) {
 				return error;
 			}
 		} else {
@@ -1294,12 +1354,16 @@ namespace wings {
 
 		statementHierarchy.clear();
 		stat::Root root;
-		auto error = ParseBody<stat::Root>(lexTree, root.expr.def.body);
+		auto error = ParseBody<stat::Root>(lexTree, root.expr.def->body);
 		statementHierarchy.clear();
+
+		if (const Expression* yield = FindYield(root.expr.def->body); yield && !error) {
+			error = CodeError::Bad("'yield' outside function", yield->srcPos);
+		}
 		
 		ResolveCaptures(root.expr);
-		root.expr.def.variables.merge(root.expr.def.localCaptures);
-		root.expr.def.localCaptures.clear();
+		root.expr.def->variables.merge(root.expr.def->localCaptures);
+		root.expr.def->localCaptures.clear();
 
 		ParseResult result{};
 		result.error = std::move(error);
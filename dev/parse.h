@@ -94,7 +94,6 @@ namespace wings {
 
 		struct Break {
 			size_t finallyCount = 0;
-			bool exitForLoopNormally = false;
 		};
 
 		struct Continue {
@@ -169,6 +168,8 @@ namespace wings {
 	ParseResult Parse(const LexTree& lexTree);
 
 	std::unordered_set<std::string> GetReferencedVariables(const Expression& expr);
+	const Expression* FindYield(const Expression& expr);
+	void ResolveCaptures(Expression& func);
 	CodeError ParseParameterList(TokenIter& p, std::vector<Parameter>& out);
 	CodeError ParseForLoopVariableList(TokenIter& p, std::vector<std::string>& vars, bool& isTuple);
 	Statement TransformForToWhile(stat::For forLoop);
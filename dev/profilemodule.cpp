@@ -0,0 +1,122 @@
+#include "profilemodule.h"
+#include "common.h"
+#include "profiler.h"
+
+namespace wings {
+	namespace profilemodule {
+		static Wg_Obj* start(Wg_Context* context, Wg_Obj** argv, int argc) {
+			WG_EXPECT_ARG_COUNT_BETWEEN(0, 1);
+			Wg_float interval = 0.001;
+			if (argc == 1) {
+				WG_EXPECT_ARG_TYPE_INT_OR_FLOAT(0);
+				interval = Wg_GetFloat(argv[0]);
+				if (interval < 0) {
+					Wg_RaiseException(context, WG_EXC_VALUEERROR, "sample interval must be non-negative");
+					return nullptr;
+				}
+			}
+			Wg_StartProfiler(context, (int)(interval * 1'000'000));
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* stop(Wg_Context* context, Wg_Obj**, int argc) {
+			WG_EXPECT_ARG_COUNT(0);
+			Wg_StopProfiler(context);
+			return Wg_None(context);
+		}
+
+		static Wg_Obj* report(Wg_Context* context, Wg_Obj**, int argc) {
+			WG_EXPECT_ARG_COUNT(0);
+			return Wg_NewString(context, Wg_GetProfileReport(context));
+		}
+
+		static Wg_Obj* collapsed(Wg_Context* context, Wg_Obj**, int argc) {
+			WG_EXPECT_ARG_COUNT(0);
+			return Wg_NewString(context, Wg_GetProfileCollapsedStacks(context));
+		}
+
+		// Creates a tuple from values, which are kept alive as they are created
+		class EntryBuilder {
+		public:
+			bool Add(Wg_Obj* value) {
+				if (value == nullptr)
+					return false;
+				refs.emplace_back(value);
+				values.push_back(value);
+				return true;
+			}
+			Wg_Obj* Build(Wg_Context* context) {
+				return Wg_NewTuple(context, values.data(), (int)values.size());
+			}
+		private:
+			std::vector<Wg_ObjRef> refs;
+			std::vector<Wg_Obj*> values;
+		};
+
+		static Wg_Obj* stats(Wg_Context* context, Wg_Obj**, int argc) {
+			WG_EXPECT_ARG_COUNT(0);
+			Wg_Obj* list = Wg_NewList(context);
+			if (list == nullptr || context->profiler == nullptr)
+				return list;
+			Wg_ObjRef ref(list);
+
+			for (const auto* stats : context->profiler->SortedFunctions()) {
+				EntryBuilder entry;
+				if (!entry.Add(Wg_NewString(context, stats->module.c_str()))
+					|| !entry.Add(Wg_NewString(context, stats->name.c_str()))
+					|| !entry.Add(Wg_NewInt(context, (Wg_int)stats->calls))
+					|| !entry.Add(Wg_NewFloat(context, std::chrono::duration<Wg_float>(stats->inclusive).count()))
+					|| !entry.Add(Wg_NewFloat(context, std::chrono::duration<Wg_float>(stats->exclusive).count()))
+					|| !entry.Add(Wg_NewInt(context, (Wg_int)stats->allocations)))
+					return nullptr;
+
+				Wg_Obj* tuple = entry.Build(context);
+				if (tuple == nullptr)
+					return nullptr;
+				list->Get<std::vector<Wg_Obj*>>().push_back(tuple);
+				WriteBarrier(list);
+			}
+			return list;
+		}
+
+		static Wg_Obj* lines(Wg_Context* context, Wg_Obj**, int argc) {
+			WG_EXPECT_ARG_COUNT(0);
+			Wg_Obj* list = Wg_NewList(context);
+			if (list == nullptr || context->profiler == nullptr)
+				return list;
+			Wg_ObjRef ref(list);
+
+			for (const auto* stats : context->profiler->SortedLines()) {
+				EntryBuilder entry;
+				if (!entry.Add(Wg_NewString(context, stats->module.c_str()))
+					|| !entry.Add(Wg_NewString(context, stats->function.c_str()))
+					|| !entry.Add(Wg_NewInt(context, (Wg_int)stats->line))
+					|| !entry.Add(Wg_NewInt(context, (Wg_int)stats->hits)))
+					return nullptr;
+
+				Wg_Obj* tuple = entry.Build(context);
+				if (tuple == nullptr)
+					return nullptr;
+				list->Get<std::vector<Wg_Obj*>>().push_back(tuple);
+				WriteBarrier(list);
+			}
+			return list;
+		}
+	}
+
+	bool ImportProfile(Wg_Context* context) {
+		using namespace profilemodule;
+		try {
+			RegisterFunction(context, "start", start);
+			RegisterFunction(context, "stop", stop);
+			RegisterFunction(context, "report", report);
+			RegisterFunction(context, "collapsed", collapsed);
+			RegisterFunction(context, "stats", stats);
+			RegisterFunction(context, "lines", lines);
+
+			return true;
+		} catch (LibraryInitException&) {
+			return false;
+		}
+	}
+}
@@ -0,0 +1,190 @@
+#include "profiler.h"
+#include "executor.h"
+
+#include <sstream>
+#include <iomanip>
+
+namespace wings {
+
+	static std::string FrameName(std::string_view module, std::string_view func) {
+		std::string name(module);
+		name += '.';
+		name += func.empty() ? "<module>" : func;
+		return name;
+	}
+
+	static double Milliseconds(Profiler::Clock::duration duration) {
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	Profiler::~Profiler() {
+		Stop();
+	}
+
+	void Profiler::Start(Clock::duration sampleInterval) {
+		Stop();
+
+		// Functions that are still running may be in the middle of exiting,
+		// so their entries are reset rather than removed.
+		for (auto it = functions.begin(); it != functions.end();) {
+			if (it->second.active) {
+				auto& stats = it->second;
+				stats.calls = 0;
+				stats.inclusive = {};
+				stats.exclusive = {};
+				stats.allocations = 0;
+				++it;
+			} else {
+				it = functions.erase(it);
+			}
+		}
+		lines.clear();
+		stacks.clear();
+		samples = 0;
+		running = true;
+
+		if (sampleInterval <= Clock::duration::zero())
+			return;
+
+		samplerStopping = false;
+		sampler = std::thread([this, sampleInterval] {
+			std::unique_lock lock(mutex);
+			while (!stopSampler.wait_for(lock, sampleInterval, [this] { return samplerStopping; }))
+				sampleRequested.store(true, std::memory_order_relaxed);
+		});
+	}
+
+	void Profiler::Stop() {
+		running = false;
+		{
+			std::lock_guard lock(mutex);
+			samplerStopping = true;
+		}
+		stopSampler.notify_one();
+		if (sampler.joinable())
+			sampler.join();
+		sampleRequested.store(false, std::memory_order_relaxed);
+	}
+
+	void Profiler::Enter(const DefObject* def) {
+		std::string name = FrameName(def->module, def->prettyName);
+		auto [it, inserted] = functions.try_emplace(name);
+		FunctionStats& stats = it->second;
+		if (inserted) {
+			stats.module = def->module;
+			stats.name = def->prettyName.empty() ? "<module>" : def->prettyName;
+		}
+
+		stats.calls++;
+		stats.active++;
+		frames.push_back({ &stats, Clock::now() });
+	}
+
+	void Profiler::Exit() {
+		Frame frame = frames.back();
+		frames.pop_back();
+
+		auto elapsed = Clock::now() - frame.start;
+		frame.stats->exclusive += elapsed - frame.children;
+		if (--frame.stats->active == 0)
+			frame.stats->inclusive += elapsed;
+		if (!frames.empty())
+			frames.back().children += elapsed;
+	}
+
+	void Profiler::CountAllocation() {
+		if (running && !frames.empty())
+			frames.back().stats->allocations++;
+	}
+
+	void Profiler::TakeSample(Wg_Context* context) {
+		sampleRequested.store(false, std::memory_order_relaxed);
+		if (!running || context->currentTrace.empty())
+			return;
+		samples++;
+
+		std::string stack;
+		for (const auto& frame : context->currentTrace) {
+			if (!stack.empty())
+				stack += ';';
+			stack += FrameName(frame.module, frame.func);
+		}
+		stacks[stack]++;
+
+		const auto& top = context->currentTrace.back();
+		size_t line = top.srcPos.line + 1;
+		std::string name = FrameName(top.module, top.func);
+		auto [it, inserted] = lines.try_emplace(name + ":" + std::to_string(line));
+		if (inserted) {
+			it->second.module = top.module;
+			it->second.function = top.func.empty() ? "<module>" : top.func;
+			it->second.line = line;
+		}
+		it->second.hits++;
+	}
+
+	std::vector<const Profiler::FunctionStats*> Profiler::SortedFunctions() const {
+		std::vector<const FunctionStats*> sorted;
+		for (const auto& [_, stats] : functions)
+			if (stats.calls)
+				sorted.push_back(&stats);
+		std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) {
+			if (a->exclusive != b->exclusive)
+				return a->exclusive > b->exclusive;
+			return std::tie(a->module, a->name) < std::tie(b->module, b->name);
+		});
+		return sorted;
+	}
+
+	std::vector<const Profiler::LineStats*> Profiler::SortedLines() const {
+		std::vector<const LineStats*> sorted;
+		for (const auto& [_, stats] : lines)
+			sorted.push_back(&stats);
+		std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) {
+			if (a->hits != b->hits)
+				return a->hits > b->hits;
+			return std::tie(a->module, a->function, a->line) < std::tie(b->module, b->function, b->line);
+		});
+		return sorted;
+	}
+
+	std::string Profiler::Report() const {
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(3);
+		ss << std::setw(10) << "calls"
+			<< std::setw(16) << "inclusive (ms)"
+			<< std::setw(16) << "exclusive (ms)"
+			<< std::setw(14) << "allocations"
+			<< "  function\n";
+		for (const FunctionStats* stats : SortedFunctions()) {
+			ss << std::setw(10) << stats->calls
+				<< std::setw(16) << Milliseconds(stats->inclusive)
+				<< std::setw(16) << Milliseconds(stats->exclusive)
+				<< std::setw(14) << stats->allocations
+				<< "  " << FrameName(stats->module, stats->name) << "\n";
+		}
+
+		if (samples) {
+			ss << "\n" << std::setw(10) << "samples" << "  line\n";
+			for (const LineStats* stats : SortedLines()) {
+				ss << std::setw(10) << stats->hits << "  "
+					<< FrameName(stats->module, stats->function) << ":" << stats->line << "\n";
+			}
+		}
+		return ss.str();
+	}
+
+	std::string Profiler::CollapsedStacks() const {
+		std::vector<std::pair<std::string_view, uint64_t>> sorted(stacks.begin(), stacks.end());
+		std::sort(sorted.begin(), sorted.end());
+
+		std::string s;
+		for (const auto& [stack, count] : sorted) {
+			s += stack;
+			s += ' ';
+			s += std::to_string(count);
+			s += '\n';
+		}
+		return s;
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "common.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace wings {
+	struct DefObject;
+
+	struct Profiler {
+		using Clock = std::chrono::steady_clock;
+
+		struct FunctionStats {
+			std::string module;
+			std::string name;
+			uint64_t calls = 0;
+			Clock::duration inclusive{};
+			Clock::duration exclusive{};
+			uint64_t allocations = 0;
+			// The number of calls currently on the stack, so that
+			// recursive calls do not count inclusive time twice
+			size_t active = 0;
+		};
+
+		struct LineStats {
+			std::string module;
+			std::string function;
+			size_t line;
+			uint64_t hits = 0;
+		};
+
+		~Profiler();
+		// Discards the previous results. A sampleInterval of zero disables sampling.
+		void Start(Clock::duration sampleInterval);
+		void Stop();
+
+		void Enter(const DefObject* def);
+		void Exit();
+		void CountAllocation();
+
+		// Records the current stack if the sampler thread asked for a sample
+		void PollSample(Wg_Context* context) {
+			if (sampleRequested.load(std::memory_order_relaxed))
+				TakeSample(context);
+		}
+
+		std::vector<const FunctionStats*> SortedFunctions() const;
+		std::vector<const LineStats*> SortedLines() const;
+		std::string Report() const;
+		std::string CollapsedStacks() const;
+
+		bool running = false;
+		std::unordered_map<std::string, FunctionStats> functions;
+		std::unordered_map<std::string, LineStats> lines;
+		std::unordered_map<std::string, uint64_t> stacks;
+		uint64_t samples = 0;
+		// The last string returned by the C API
+		std::string output;
+
+	private:
+		struct Frame {
+			FunctionStats* stats;
+			Clock::time_point start;
+			Clock::duration children{};
+		};
+
+		void TakeSample(Wg_Context* context);
+
+		std::vector<Frame> frames;
+
+		std::atomic<bool> sampleRequested = false;
+		std::thread sampler;
+		std::mutex mutex;
+		std::condition_variable stopSampler;
+		bool samplerStopping = false;
+	};
+}
@@ -0,0 +1,575 @@
+#include "serialize.h"
+
+#include <cstring>
+
+namespace wings {
+	static constexpr char BYTECODE_MAGIC[4] = { 'W', 'G', 'B', 'C' };
+
+	// Integers are written little endian so that caches are portable
+	struct BytecodeWriter {
+		void Byte(uint8_t value) {
+			out.push_back((char)value);
+		}
+
+		void U32(uint32_t value) {
+			for (int i = 0; i < 4; i++)
+				Byte((uint8_t)(value >> (8 * i)));
+		}
+
+		void U64(uint64_t value) {
+			for (int i = 0; i < 8; i++)
+				Byte((uint8_t)(value >> (8 * i)));
+		}
+
+		std::string out;
+	};
+
+	struct BytecodeReader {
+		uint8_t Byte() {
+			if (pos >= data.size()) {
+				good = false;
+				return 0;
+			}
+			return (uint8_t)data[pos++];
+		}
+
+		uint32_t U32() {
+			uint32_t value = 0;
+			for (int i = 0; i < 4; i++)
+				value |= (uint32_t)Byte() << (8 * i);
+			return value;
+		}
+
+		uint64_t U64() {
+			uint64_t value = 0;
+			for (int i = 0; i < 8; i++)
+				value |= (uint64_t)Byte() << (8 * i);
+			return value;
+		}
+
+		// Every serialized element takes at least one byte, so a length
+		// longer than the remaining data means the data is corrupt.
+		size_t Length() {
+			uint64_t length = U64();
+			if (length > data.size() - pos) {
+				good = false;
+				return 0;
+			}
+			return (size_t)length;
+		}
+
+		std::string_view data;
+		size_t pos = 0;
+		bool good = true;
+	};
+
+	static void Write(BytecodeWriter& w, const std::string& s) {
+		w.U64(s.size());
+		w.out.append(s);
+	}
+
+	static void Read(BytecodeReader& r, std::string& s) {
+		size_t length = r.Length();
+		s = r.data.substr(r.pos, length);
+		r.pos += length;
+	}
+
+	static void Write(BytecodeWriter& w, const std::optional<std::string>& s) {
+		w.Byte(s.has_value());
+		if (s)
+			Write(w, *s);
+	}
+
+	static void Read(BytecodeReader& r, std::optional<std::string>& s) {
+		if (r.Byte()) {
+			Read(r, s.emplace());
+		} else {
+			s.reset();
+		}
+	}
+
+	static void Write(BytecodeWriter& w, const Bytecode& code);
+	static void Read(BytecodeReader& r, Bytecode& code);
+
+	template <class T>
+	static void Write(BytecodeWriter& w, const std::vector<T>& v) {
+		w.U64(v.size());
+		for (const auto& item : v)
+			Write(w, item);
+	}
+
+	template <class T>
+	static void Read(BytecodeReader& r, std::vector<T>& v) {
+		v.clear();
+		v.resize(r.Length());
+		for (auto& item : v) {
+			if (!r.good)
+				return;
+			Read(r, item);
+		}
+	}
+
+	static void Write(BytecodeWriter& w, const SourcePosition& srcPos) {
+		w.U64(srcPos.line);
+		w.U64(srcPos.column);
+	}
+
+	static void Read(BytecodeReader& r, SourcePosition& srcPos) {
+		srcPos.line = (size_t)r.U64();
+		srcPos.column = (size_t)r.U64();
+	}
+
+	static void Write(BytecodeWriter& w, const VariableSlot& slot) {
+		w.Byte((uint8_t)slot.type);
+		w.U64(slot.index);
+	}
+
+	static void Read(BytecodeReader& r, VariableSlot& slot) {
+		slot.type = (VariableSlot::Type)r.Byte();
+		slot.index = (size_t)r.U64();
+	}
+
+	static void Write(BytecodeWriter& w, const AssignTarget& target) {
+		w.Byte((uint8_t)target.type);
+		Write(w, target.direct);
+		Write(w, target.pack);
+	}
+
+	static void Read(BytecodeReader& r, AssignTarget& target) {
+		target.type = (AssignType)r.Byte();
+		Read(r, target.direct);
+		Read(r, target.pack);
+	}
+
+	static void Write(BytecodeWriter& w, const LiteralInstruction& literal) {
+		w.Byte((uint8_t)literal.index());
+		if (auto* b = std::get_if<bool>(&literal)) {
+			w.Byte(*b);
+		} else if (auto* i = std::get_if<Wg_int>(&literal)) {
+			w.U64((uint64_t)*i);
+		} else if (auto* f = std::get_if<Wg_float>(&literal)) {
+			uint64_t bits{};
+			std::memcpy(&bits, f, sizeof(bits));
+			w.U64(bits);
+		} else if (auto* s = std::get_if<std::string>(&literal)) {
+			Write(w, *s);
+		} else if (auto* t = std::get_if<TupleLiteral>(&literal)) {
+			Write(w, t->items);
+		} else if (auto* bytes = std::get_if<BytesLiteral>(&literal)) {
+			Write(w, bytes->data);
+		}
+	}
+
+	static void Read(BytecodeReader& r, LiteralInstruction& literal) {
+		switch (r.Byte()) {
+		case 0:
+			literal = nullptr;
+			break;
+		case 1:
+			literal = (bool)r.Byte();
+			break;
+		case 2:
+			literal = (Wg_int)r.U64();
+			break;
+		case 3: {
+			uint64_t bits = r.U64();
+			Wg_float f{};
+			std::memcpy(&f, &bits, sizeof(f));
+			literal = f;
+			break;
+		}
+		case 4:
+			Read(r, literal.emplace<std::string>());
+			break;
+		case 5:
+			Read(r, literal.emplace<TupleLiteral>().items);
+			break;
+		case 6:
+			Read(r, literal.emplace<BytesLiteral>().data);
+			break;
+		default:
+			r.good = false;
+		}
+	}
+
+	static void Write(BytecodeWriter& w, const StringArgInstruction& instr) {
+		Write(w, instr.string);
+	}
+
+	static void Read(BytecodeReader& r, StringArgInstruction& instr) {
+		Read(r, instr.string);
+	}
+
+	static void Write(BytecodeWriter& w, const VariableInstruction& instr) {
+		Write(w, instr.name);
+		Write(w, instr.slot);
+	}
+
+	static void Read(BytecodeReader& r, VariableInstruction& instr) {
+		Read(r, instr.name);
+		Read(r, instr.slot);
+	}
+
+	static void Write(BytecodeWriter& w, const DirectAssignInstruction& instr) {
+		Write(w, instr.assignTarget);
+		Write(w, instr.slots);
+	}
+
+	static void Read(BytecodeReader& r, DirectAssignInstruction& instr) {
+		Read(r, instr.assignTarget);
+		Read(r, instr.slots);
+	}
+
+	static void Write(BytecodeWriter& w, const OperationInstruction& instr) {
+		w.U32((uint32_t)instr.op);
+		Write(w, instr.method);
+	}
+
+	static void Read(BytecodeReader& r, OperationInstruction& instr) {
+		instr.op = (Wg_BinOp)r.U32();
+		Read(r, instr.method);
+	}
+
+	static void Write(BytecodeWriter& w, const DefInstruction& instr) {
+		w.U64(instr.defaultParameterCount);
+		Write(w, instr.prettyName);
+		w.Byte(instr.isMethod);
+		w.Byte(instr.isGenerator);
+		Write(w, instr.parameters);
+		Write(w, instr.globalCaptures);
+		Write(w, instr.localCaptures);
+		Write(w, instr.variables);
+		Write(w, *instr.code);
+		Write(w, instr.listArgs);
+		Write(w, instr.kwArgs);
+		w.U64(instr.localCount);
+		w.U64(instr.cellCount);
+		Write(w, instr.parameterSlots);
+		Write(w, instr.listArgsSlot);
+		Write(w, instr.kwArgsSlot);
+		w.Byte(instr.contiguousParameters);
+		w.U64(instr.firstParameterLocal);
+		Write(w, instr.localCaptureSlots);
+	}
+
+	static void Read(BytecodeReader& r, DefInstruction& instr) {
+		instr.defaultParameterCount = (size_t)r.U64();
+		Read(r, instr.prettyName);
+		instr.isMethod = r.Byte();
+		instr.isGenerator = r.Byte();
+		Read(r, instr.parameters);
+		Read(r, instr.globalCaptures);
+		Read(r, instr.localCaptures);
+		Read(r, instr.variables);
+		instr.code = MakeRcPtr<Bytecode>();
+		Read(r, *instr.code);
+		Read(r, instr.listArgs);
+		Read(r, instr.kwArgs);
+		instr.localCount = (size_t)r.U64();
+		instr.cellCount = (size_t)r.U64();
+		Read(r, instr.parameterSlots);
+		Read(r, instr.listArgsSlot);
+		Read(r, instr.kwArgsSlot);
+		instr.contiguousParameters = r.Byte();
+		instr.firstParameterLocal = (size_t)r.U64();
+		Read(r, instr.localCaptureSlots);
+	}
+
+	static void Write(BytecodeWriter& w, const ClassInstruction& instr) {
+		Write(w, instr.methodNames);
+		Write(w, instr.prettyName);
+	}
+
+	static void Read(BytecodeReader& r, ClassInstruction& instr) {
+		Read(r, instr.methodNames);
+		Read(r, instr.prettyName);
+	}
+
+	static void Write(BytecodeWriter& w, const TryFrameInstruction& instr) {
+		w.U64(instr.exceptJump);
+		w.U64(instr.finallyJump);
+	}
+
+	static void Read(BytecodeReader& r, TryFrameInstruction& instr) {
+		instr.exceptJump = (size_t)r.U64();
+		instr.finallyJump = (size_t)r.U64();
+	}
+
+	static void Write(BytecodeWriter& w, const QueuedJumpInstruction& instr) {
+		w.U64(instr.location);
+		w.U64(instr.finallyCount);
+	}
+
+	static void Read(BytecodeReader& r, QueuedJumpInstruction& instr) {
+		instr.location = (size_t)r.U64();
+		instr.finallyCount = (size_t)r.U64();
+	}
+
+	static void Write(BytecodeWriter& w, const ImportInstruction& instr) {
+		Write(w, instr.module);
+		Write(w, instr.alias);
+	}
+
+	static void Read(BytecodeReader& r, ImportInstruction& instr) {
+		Read(r, instr.module);
+		Read(r, instr.alias);
+	}
+
+	static void Write(BytecodeWriter& w, const ImportFromInstruction& instr) {
+		Write(w, instr.module);
+		Write(w, instr.names);
+		Write(w, instr.alias);
+	}
+
+	static void Read(BytecodeReader& r, ImportFromInstruction& instr) {
+		Read(r, instr.module);
+		Read(r, instr.names);
+		Read(r, instr.alias);
+	}
+
+	static void Write(BytecodeWriter& w, const Bytecode::Op& op) {
+		w.Byte((uint8_t)op.type);
+		w.U32(op.operand);
+	}
+
+	static void Read(BytecodeReader& r, Bytecode::Op& op) {
+		op.type = (Instruction::Type)r.Byte();
+		op.operand = r.U32();
+	}
+
+	static void Write(BytecodeWriter& w, const std::pair<uint32_t, SourcePosition>& line) {
+		w.U32(line.first);
+		Write(w, line.second);
+	}
+
+	static void Read(BytecodeReader& r, std::pair<uint32_t, SourcePosition>& line) {
+		line.first = r.U32();
+		Read(r, line.second);
+	}
+
+	static void Write(BytecodeWriter& w, const Bytecode& code) {
+		Write(w, code.ops);
+		Write(w, code.lineTable);
+		Write(w, code.literals);
+		Write(w, code.strings);
+		Write(w, code.variables);
+		Write(w, code.directAssigns);
+		Write(w, code.operations);
+		Write(w, code.defs);
+		Write(w, code.classes);
+		Write(w, code.tryFrames);
+		Write(w, code.queuedJumps);
+		Write(w, code.imports);
+		Write(w, code.importFroms);
+	}
+
+	static void Read(BytecodeReader& r, Bytecode& code) {
+		Read(r, code.ops);
+		Read(r, code.lineTable);
+		Read(r, code.literals);
+		Read(r, code.strings);
+		Read(r, code.variables);
+		Read(r, code.directAssigns);
+		Read(r, code.operations);
+		Read(r, code.defs);
+		Read(r, code.classes);
+		Read(r, code.tryFrames);
+		Read(r, code.queuedJumps);
+		Read(r, code.imports);
+		Read(r, code.importFroms);
+		SelectHandlers(code);
+	}
+
+	// A cache that passes the checksum can still have been written by a buggy or
+	// malicious writer, so every operand is checked before the executor indexes with it.
+	// The frame sizes belong to the function the code is the body of.
+	static bool ValidSlot(const VariableSlot& slot, size_t localCount, size_t cellCount) {
+		switch (slot.type) {
+		case VariableSlot::Type::Global:
+			return true;
+		case VariableSlot::Type::Local:
+			return slot.index < localCount;
+		case VariableSlot::Type::Cell:
+			return slot.index < cellCount;
+		default:
+			return false;
+		}
+	}
+
+	static bool ValidAssignTarget(const AssignTarget& target, size_t& directCount) {
+		switch (target.type) {
+		case AssignType::Direct:
+			directCount++;
+			return true;
+		case AssignType::Pack:
+			for (const auto& child : target.pack)
+				if (!ValidAssignTarget(child, directCount))
+					return false;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool ValidateBytecode(const Bytecode& code, size_t localCount, size_t cellCount);
+
+	static bool ValidDef(const DefInstruction& def, size_t localCount, size_t cellCount) {
+		if (def.code == nullptr
+			|| def.defaultParameterCount > def.parameters.size()
+			|| def.parameterSlots.size() != def.parameters.size()
+			|| def.localCaptureSlots.size() != def.localCaptures.size()
+			|| def.localCaptures.size() > def.cellCount)
+			return false;
+
+		// Parameters are never globals
+		for (const auto& slot : def.parameterSlots)
+			if (slot.type == VariableSlot::Type::Global || !ValidSlot(slot, def.localCount, def.cellCount))
+				return false;
+		if (def.listArgs && !ValidSlot(def.listArgsSlot, def.localCount, def.cellCount))
+			return false;
+		if (def.kwArgs && !ValidSlot(def.kwArgsSlot, def.localCount, def.cellCount))
+			return false;
+		if (def.contiguousParameters && def.firstParameterLocal + def.parameters.size() > def.localCount)
+			return false;
+
+		// Captures are taken from the enclosing frame
+		for (const auto& slot : def.localCaptureSlots)
+			if (!ValidSlot(slot, localCount, cellCount))
+				return false;
+
+		return ValidateBytecode(*def.code, def.localCount, def.cellCount);
+	}
+
+	static bool ValidateBytecode(const Bytecode& code, size_t localCount, size_t cellCount) {
+		using Type = Instruction::Type;
+		size_t size = code.ops.size();
+		// Jumping to the end of the code returns from it
+		auto validJump = [&](size_t location) { return location <= size; };
+
+		for (const auto& op : code.ops) {
+			size_t operand = op.operand;
+			bool valid = true;
+			switch (op.type) {
+			case Type::Literal: valid = operand < code.literals.size(); break;
+			case Type::Variable:
+				valid = operand < code.variables.size()
+					&& ValidSlot(code.variables[operand].slot, localCount, cellCount);
+				break;
+			case Type::Dot:
+			case Type::LoadMethod:
+			case Type::MemberAssign:
+				valid = operand < code.strings.size();
+				break;
+			case Type::Operation:
+				valid = operand < code.operations.size()
+					&& code.operations[operand].op >= WG_BOP_ADD
+					&& code.operations[operand].op <= WG_BOP_GE;
+				break;
+			case Type::DirectAssign: {
+				if (operand >= code.directAssigns.size()) {
+					valid = false;
+					break;
+				}
+				const auto& assign = code.directAssigns[operand];
+				size_t directCount = 0;
+				valid = ValidAssignTarget(assign.assignTarget, directCount) && directCount == assign.slots.size();
+				for (const auto& slot : assign.slots)
+					valid = valid && ValidSlot(slot, localCount, cellCount);
+				break;
+			}
+			case Type::Def: valid = operand < code.defs.size(); break;
+			case Type::Class: valid = operand < code.classes.size(); break;
+			case Type::Import: valid = operand < code.imports.size(); break;
+			case Type::ImportFrom: valid = operand < code.importFroms.size(); break;
+			case Type::PushTry:
+				valid = operand < code.tryFrames.size()
+					&& validJump(code.tryFrames[operand].exceptJump)
+					&& validJump(code.tryFrames[operand].finallyJump);
+				break;
+			case Type::Return:
+			case Type::QueueJump:
+				valid = operand < code.queuedJumps.size()
+					&& validJump(code.queuedJumps[operand].location);
+				break;
+			case Type::Jump:
+			case Type::JumpIfFalsePop:
+			case Type::JumpIfTruePop:
+			case Type::JumpIfFalse:
+			case Type::JumpIfTrue:
+			case Type::ForIter:
+			case Type::PopTry:
+				valid = validJump(operand);
+				break;
+			default:
+				// The remaining opcodes ignore their operand but must still have a handler
+				valid = op.type <= Type::Yield;
+				break;
+			}
+			if (!valid)
+				return false;
+		}
+
+		for (const auto& line : code.lineTable)
+			if (line.first > size)
+				return false;
+
+		for (const auto& def : code.defs)
+			if (!ValidDef(def, localCount, cellCount))
+				return false;
+		return true;
+	}
+
+	uint64_t HashSource(std::string_view source) {
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : source) {
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	uint64_t HashSource(std::string_view source, int optimizationLevel) {
+		return (HashSource(source) ^ (uint64_t)optimizationLevel) * 1099511628211ull;
+	}
+
+	std::string SerializeBytecode(const Bytecode& code, uint64_t sourceHash) {
+		BytecodeWriter w;
+		w.out.append(BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC));
+		w.U32(BYTECODE_FORMAT_VERSION);
+		w.Byte((uint8_t)sizeof(Wg_int));
+		w.Byte((uint8_t)sizeof(Wg_float));
+		w.U64(sourceHash);
+		Write(w, code);
+
+		// Trailing checksum to detect truncated or corrupted caches
+		w.U64(HashSource(w.out));
+		return std::move(w.out);
+	}
+
+	RcPtr<Bytecode> DeserializeBytecode(std::string_view data, uint64_t sourceHash) {
+		if (data.size() < sizeof(BYTECODE_MAGIC) + 8)
+			return nullptr;
+		if (std::memcmp(data.data(), BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC)) != 0)
+			return nullptr;
+
+		std::string_view body = data.substr(0, data.size() - 8);
+		BytecodeReader checksum{ data.substr(body.size()) };
+		if (checksum.U64() != HashSource(body))
+			return nullptr;
+
+		BytecodeReader r{ body, sizeof(BYTECODE_MAGIC) };
+		if (r.U32() != BYTECODE_FORMAT_VERSION
+			|| r.Byte() != sizeof(Wg_int)
+			|| r.Byte() != sizeof(Wg_float)
+			|| r.U64() != sourceHash)
+			return nullptr;
+
+		auto code = MakeRcPtr<Bytecode>();
+		Read(r, *code);
+		// Module code has no locals or cells since its variables are globals
+		if (!r.good || r.pos != body.size() || !ValidateBytecode(*code, 0, 0))
+			return nullptr;
+		return code;
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "compile.h"
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace wings {
+	// Must be bumped whenever Instruction::Type or the layout of Bytecode changes
+	// so that stale cache files are recompiled instead of misread.
+	constexpr uint32_t BYTECODE_FORMAT_VERSION = 7;
+
+	uint64_t HashSource(std::string_view source);
+	// Identifies the compiled form of source, which also depends on the optimization level
+	uint64_t HashSource(std::string_view source, int optimizationLevel);
+
+	// Serializes a compiled module. The source hash is stored
+	// alongside the code so that stale caches can be detected.
+	std::string SerializeBytecode(const Bytecode& code, uint64_t sourceHash);
+
+	// Returns null if the data is malformed, was written by a different format
+	// version, was compiled from a different source, or has an operand that is
+	// out of range of the tables and frame of its code.
+	RcPtr<Bytecode> DeserializeBytecode(std::string_view data, uint64_t sourceHash);
+}
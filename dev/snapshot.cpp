@@ -0,0 +1,275 @@
+#include "snapshot.h"
+#include "executor.h"
+#include "compile.h"
+
+#include <unordered_set>
+
+namespace wings {
+
+	// Objects may only own userdata of these types. The type
+	// of the userdata is identified by the finalizer that frees it.
+	static bool IsCloneableFinalizer(Wg_Finalizer finalizer) {
+		return finalizer == &DeleteUserdata<bool>
+			|| finalizer == &DeleteUserdata<Wg_int>
+			|| finalizer == &DeleteUserdata<WDict>
+			|| finalizer == &DeleteUserdata<WSet>
+			|| finalizer == &DeleteUserdata<Wg_Obj::Func>
+			|| finalizer == &DeleteUserdata<Wg_Obj::Class>
+			|| finalizer == &DeleteUserdata<DefObject>;
+	}
+
+	// Memory borrowed from the host cannot be copied into another context
+	static bool IsCloneableBuffer(const BufferObject* buffer) {
+		return buffer->storage == nullptr || !buffer->storage->borrowed;
+	}
+
+	bool CheckCloneable(Wg_Context* context) {
+		std::unordered_set<const Wg_Obj*> objects(context->mem.begin(), context->mem.end());
+		for (const Wg_Obj* obj : context->mem) {
+			for (const auto& [finalizer, userdata] : obj->finalizers) {
+				bool cloneable{};
+				if (finalizer == &DecRefUserdata) {
+					cloneable = objects.contains((const Wg_Obj*)userdata);
+				} else if (finalizer == &DeleteUserdata<BufferObject>) {
+					cloneable = IsCloneableBuffer((const BufferObject*)userdata);
+				} else {
+					cloneable = IsCloneableFinalizer(finalizer);
+				}
+				if (!cloneable) {
+					std::string msg = "cannot snapshot '" + WObjTypeToString(obj) + "' object";
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	struct HeapCloner {
+		HeapCloner(const Wg_Context& src, Wg_Context& dst) : src(src), dst(dst) {
+			tables.remap = [this](Wg_Obj* obj) { return Map(obj); };
+		}
+
+		bool Run() {
+			dst.config = src.config;
+			dst.types = src.types;
+			dst.argv = src.argv;
+			dst.moduleLoaders = src.moduleLoaders;
+			dst.importPath = src.importPath;
+			dst.currentModule.push("__main__");
+
+			// Allocate every object up front so that references can be remapped in any order
+			objects.reserve(src.mem.size());
+			userdataCopies.reserve(src.mem.size());
+			dst.mem.reserve(src.mem.size());
+			for (const Wg_Obj* obj : src.mem) {
+				Wg_Obj* copy = dst.pool.Allocate();
+				copy->context = &dst;
+				copy->type = obj->type;
+				copy->hasCachedHash = obj->hasCachedHash;
+				copy->cachedHash = obj->cachedHash;
+				copy->interned = obj->interned;
+				copy->userdataSize = obj->userdataSize;
+				dst.mem.push_back(copy);
+				objects.insert({ obj, copy });
+			}
+
+			for (size_t i = 0; i < src.mem.size(); i++)
+				CloneFinalizers(*src.mem[i], *dst.mem[i]);
+			for (const auto& [original, copy] : ownedUserdata)
+				CloneUserdata(original, copy);
+			for (size_t i = 0; i < src.mem.size(); i++)
+				CloneData(*src.mem[i], *dst.mem[i]);
+			for (Wg_Obj* obj : dst.mem)
+				if (obj->interned)
+					dst.internedStrings.insert({ obj->Get<std::string>(), obj });
+
+			for (const auto& [module, globals] : src.globals) {
+				auto& copy = dst.globals[module];
+				for (const auto& [name, cell] : globals)
+					copy.insert({ name, MapCell(cell) });
+			}
+
+			dst.builtins = src.builtins;
+			for (Wg_Obj** obj : dst.builtins.GetAll())
+				*obj = Map(*obj);
+			for (Wg_Obj*& obj : dst.builtins.smallInts)
+				obj = Map(obj);
+
+			// The whole heap is already live, so treat it as if it survived a collection
+			dst.lastObjectCountAfterGC = dst.mem.size();
+			dst.gcStats.bytesAfterCollection = src.gcStats.bytesAfterCollection + src.gcStats.bytesSinceCollection;
+			if (dst.config.gcNurserySize)
+				Promote(&dst, 0);
+
+			return Rehash();
+		}
+
+	private:
+		Wg_Obj* Map(Wg_Obj* obj) const {
+			return obj ? objects.at(obj) : nullptr;
+		}
+
+		// Userdata of native functions and classes may be an object, userdata
+		// owned by an object, or belong to the host, in which case it is shared.
+		void* MapUserdata(void* userdata) const {
+			if (auto it = objects.find((Wg_Obj*)userdata); it != objects.end())
+				return it->second;
+			if (auto it = userdataCopies.find(userdata); it != userdataCopies.end())
+				return it->second;
+			return userdata;
+		}
+
+		RcPtr<Wg_Obj*> MapCell(const RcPtr<Wg_Obj*>& cell) {
+			auto& copy = cells[cell.get()];
+			if (copy == nullptr)
+				copy = MakeRcPtr<Wg_Obj*>(Map(*cell));
+			return copy;
+		}
+
+		// Views of the same storage must still share it in the new context
+		RcPtr<BufferStorage> MapStorage(const RcPtr<BufferStorage>& storage) {
+			if (storage == nullptr)
+				return nullptr;
+			auto& copy = storages[storage.get()];
+			if (copy == nullptr) {
+				copy = MakeRcPtr<BufferStorage>();
+				copy->owned = storage->owned;
+			}
+			return copy;
+		}
+
+		// Bytecode is shared, but inline caches refer to shapes of the source heap
+		RcPtr<CodeCaches> MapCaches(const RcPtr<CodeCaches>& caches, const Bytecode& code) {
+			auto& copy = codeCaches[caches.get()];
+			if (copy == nullptr)
+				copy = MakeRcPtr<CodeCaches>(code);
+			return copy;
+		}
+
+		void CloneFinalizers(const Wg_Obj& obj, Wg_Obj& copy) {
+			for (const auto& [finalizer, userdata] : obj.finalizers) {
+				void* copied{};
+				if (finalizer == &DecRefUserdata) {
+					Wg_Obj* ref = Map((Wg_Obj*)userdata);
+					ref->refCount++;
+					copied = ref;
+				} else if (finalizer == &DeleteUserdata<bool>) {
+					copied = new bool(*(bool*)userdata);
+				} else if (finalizer == &DeleteUserdata<Wg_int>) {
+					copied = new Wg_int(*(Wg_int*)userdata);
+				} else if (finalizer == &DeleteUserdata<WDict>) {
+					copied = new WDict();
+				} else if (finalizer == &DeleteUserdata<WSet>) {
+					copied = new WSet();
+				} else if (finalizer == &DeleteUserdata<Wg_Obj::Func>) {
+					copied = new Wg_Obj::Func(*(Wg_Obj::Func*)userdata);
+				} else if (finalizer == &DeleteUserdata<Wg_Obj::Class>) {
+					const auto& klass = *(Wg_Obj::Class*)userdata;
+					copied = new Wg_Obj::Class{ klass.name, klass.module, klass.ctor, klass.userdata, klass.instanceType, klass.bases };
+				} else if (finalizer == &DeleteUserdata<DefObject>) {
+					copied = new DefObject(*(DefObject*)userdata);
+				} else if (finalizer == &DeleteUserdata<BufferObject>) {
+					auto* buffer = new BufferObject(*(BufferObject*)userdata);
+					buffer->storage = MapStorage(buffer->storage);
+					copied = buffer;
+				} else {
+					WG_UNREACHABLE();
+				}
+
+				copy.finalizers.push_back({ finalizer, copied });
+				if (finalizer != &DecRefUserdata) {
+					ownedUserdata.push_back({ { finalizer, userdata }, copied });
+					userdataCopies.insert({ userdata, copied });
+				}
+			}
+		}
+
+		// Remaps the references held by userdata. Must be called once every userdata has been copied.
+		void CloneUserdata(const std::pair<Wg_Finalizer, void*>& original, void* copied) {
+			auto [finalizer, userdata] = original;
+			if (finalizer == &DeleteUserdata<WDict>) {
+				pendingDicts.push_back({ (const WDict*)userdata, (WDict*)copied });
+			} else if (finalizer == &DeleteUserdata<WSet>) {
+				pendingSets.push_back({ (const WSet*)userdata, (WSet*)copied });
+			} else if (finalizer == &DeleteUserdata<Wg_Obj::Func>) {
+				auto& fn = *(Wg_Obj::Func*)copied;
+				fn.self = Map(fn.self);
+				fn.userdata = MapUserdata(fn.userdata);
+			} else if (finalizer == &DeleteUserdata<Wg_Obj::Class>) {
+				auto& klass = *(Wg_Obj::Class*)copied;
+				for (Wg_Obj*& base : klass.bases)
+					base = Map(base);
+				klass.userdata = MapUserdata(klass.userdata);
+				klass.instanceAttributes = ((const Wg_Obj::Class*)userdata)->instanceAttributes.Clone(tables);
+			} else if (finalizer == &DeleteUserdata<DefObject>) {
+				auto& def = *(DefObject*)copied;
+				def.context = &dst;
+				def.caches = MapCaches(def.caches, *def.code);
+				for (Wg_Obj*& value : def.defaultParameterValues)
+					value = Map(value);
+				for (auto& capture : def.captures)
+					capture = MapCell(capture);
+			}
+		}
+
+		void CloneData(const Wg_Obj& obj, Wg_Obj& copy) {
+			if (obj.HoldsInline<StrSlice>()) {
+				// Buffers are appended to in place, so they cannot be shared with contexts on other threads
+				copy.EmplaceInline<std::string>(GetStringView(&obj));
+				copy.hasCachedHash = obj.hasCachedHash;
+			} else if (copy.CopyInline(obj)) {
+				if (copy.HoldsInline<std::vector<Wg_Obj*>>()) {
+					for (Wg_Obj*& value : copy.Get<std::vector<Wg_Obj*>>())
+						value = Map(value);
+				} else if (copy.HoldsInline<ForLoopIterator>()) {
+					auto& it = copy.Get<ForLoopIterator>();
+					if (it.kind != ForLoopIterator::Kind::Range)
+						it.sequence.obj = Map(it.sequence.obj);
+				}
+			} else {
+				copy.data = MapUserdata(obj.data);
+			}
+			copy.attributes = obj.attributes.Clone(tables);
+		}
+
+		// Hashes may depend on object identity so the keys are rehashed in the new context.
+		// The hash functions may allocate, so every object is kept alive until all keys are inserted.
+		bool Rehash() {
+			for (auto& [_, obj] : objects)
+				obj->refCount++;
+
+			bool success = true;
+			try {
+				for (const auto& [original, copy] : pendingDicts)
+					for (const auto& [key, value] : *original)
+						(*copy)[Map(key)] = Map(value);
+				for (const auto& [original, copy] : pendingSets)
+					for (Wg_Obj* value : *original)
+						copy->insert(Map(value));
+			} catch (HashException&) {
+				success = false;
+			}
+
+			for (auto& [_, obj] : objects)
+				obj->refCount--;
+			return success;
+		}
+
+		const Wg_Context& src;
+		Wg_Context& dst;
+		std::unordered_map<const Wg_Obj*, Wg_Obj*> objects;
+		std::unordered_map<const void*, void*> userdataCopies;
+		std::vector<std::pair<std::pair<Wg_Finalizer, void*>, void*>> ownedUserdata;
+		std::unordered_map<const Wg_Obj* const*, RcPtr<Wg_Obj*>> cells;
+		std::unordered_map<const CodeCaches*, RcPtr<CodeCaches>> codeCaches;
+		std::unordered_map<const BufferStorage*, RcPtr<BufferStorage>> storages;
+		std::vector<std::pair<const WDict*, WDict*>> pendingDicts;
+		std::vector<std::pair<const WSet*, WSet*>> pendingSets;
+		AttributeTable::Cloner tables;
+	};
+
+	bool CloneContext(const Wg_Context& src, Wg_Context& dst) {
+		return HeapCloner(src, dst).Run();
+	}
+}
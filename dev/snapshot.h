@@ -0,0 +1,14 @@
+#pragma once
+#include "common.h"
+
+namespace wings {
+	// Raises a TypeError in the context and returns false if it holds an object
+	// whose native data cannot be copied into another context.
+	bool CheckCloneable(Wg_Context* context);
+
+	// Copies the objects, globals and module state of a context into a newly
+	// created context. The source context is only read from, so several
+	// contexts may be cloned from the same source at once.
+	// Returns false if a dictionary key could not be rehashed in the copy.
+	bool CloneContext(const Wg_Context& src, Wg_Context& dst);
+}
@@ -1,14 +1,23 @@
 #include "tests.h"
 #include "wings.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <string_view>
+#include <cstring>
 #include <memory>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 
 static std::string output;
 static size_t testsPassed;
 static size_t testsRun;
+static int gcNurserySize;
+static int optimizationLevel;
 
 static void PrintFailure(const char* code, size_t line, std::string_view reason) {
 	std::cout
@@ -39,6 +48,8 @@ static void PrintFailure(const char* code, size_t line, std::string_view expecte
 static auto CreateContext() {
 	Wg_Config cfg{};
 	Wg_DefaultConfig(&cfg);
+	cfg.gcNurserySize = gcNurserySize;
+	cfg.optimizationLevel = optimizationLevel;
 	output.clear();
 	cfg.print = [](const char* message, int len, void*) {
 		output += std::string(message, len);
@@ -94,8 +105,46 @@ static void ExpectFailure(const char* code, size_t line) {
 	PrintFailure(code, line, "Test did not fail as expected.");
 }
 
+// Runs the setup code, snapshots the context and then runs
+// the test code in two separate contexts created from the snapshot.
+static void ExpectFromSnapshot(const char* setup, const char* code, const char* expected, size_t line) {
+	testsRun++;
+
+	auto context = CreateContext();
+	if (!Wg_Execute(context.get(), setup)) {
+		PrintFailure(setup, line, Wg_GetErrorMessage(context.get()));
+		return;
+	}
+
+	Wg_Snapshot* snapshot = Wg_SnapshotContext(context.get());
+	if (snapshot == nullptr) {
+		PrintFailure(setup, line, Wg_GetErrorMessage(context.get()));
+		return;
+	}
+	context.reset();
+
+	bool passed = true;
+	for (int i = 0; i < 2 && passed; i++) {
+		output.clear();
+		Wg_Context* copy = Wg_CreateContextFromSnapshot(snapshot);
+		if (!Wg_Execute(copy, code)) {
+			PrintFailure(code, line, Wg_GetErrorMessage(copy));
+			passed = false;
+		} else if (output.pop_back(), output != expected) {
+			PrintFailure(code, line, expected, output);
+			passed = false;
+		}
+		Wg_DestroyContext(copy);
+	}
+	Wg_DestroySnapshot(snapshot);
+
+	if (passed)
+		testsPassed++;
+}
+
 #define T(code, expected) Expect(code, expected, __LINE__)
 #define F(code) ExpectFailure(code, __LINE__)
+#define S(setup, code, expected) ExpectFromSnapshot(setup, code, expected, __LINE__)
 
 void TestPrint() {
 	T("print(None)", "None");
@@ -274,6 +323,110 @@ print(i)
 );
 }
 
+void TestFor() {
+	T(R"(
+d = {1: 2, 3: 4}
+out = []
+for x in [1, 2]:
+	out.append(x)
+for x in (3, 4):
+	out.append(x)
+for c in "ab":
+	out.append(c)
+for k in d:
+	out.append(k)
+for v in d.values():
+	out.append(v)
+for k, v in d.items():
+	out.append(k + v)
+for x in {5}:
+	out.append(x)
+for i in range(10, 0, -4):
+	out.append(i)
+print(out)
+)"
+,
+"[1, 2, 3, 4, 'a', 'b', 1, 3, 2, 4, 3, 7, 5, 10, 6, 2]"
+);
+
+	T(R"(
+li = [1, 2]
+for x in li:
+	if x < 3:
+		li.append(x + 2)
+print(li)
+)"
+,
+"[1, 2, 3, 4]"
+);
+
+	T(R"(
+n = 0
+for i in range(10):
+	if i % 2:
+		continue
+	if i == 8:
+		break
+	n += i
+else:
+	n = None
+for i in range(3):
+	pass
+else:
+	n += 100
+print(n, i)
+)"
+,
+"112 2"
+);
+
+	T(R"(
+class It:
+	def __init__(self):
+		self.i = 0
+	def __iter__(self):
+		return self
+	def __next__(self):
+		self.i += 1
+		if self.i > 3:
+			raise StopIteration
+		return self.i
+out = []
+for x in It():
+	for y in It():
+		out.append(x * y)
+print(out)
+)"
+,
+"[1, 2, 3, 2, 4, 6, 3, 6, 9]"
+);
+
+	T(R"(
+def f():
+	for x in [1, 2, 3]:
+		try:
+			if x == 2:
+				return x
+		finally:
+			print(x)
+print(f())
+)"
+,
+"1\n2\n2"
+);
+
+	F("for x in 5:\n\tpass");
+	F(R"(
+class It:
+	def __iter__(self):
+		return self
+	def __next__(self):
+		raise ValueError
+for x in It():
+	pass
+)");
+}
+
 void TestExceptions() {
 	F(R"(
 try:
@@ -531,6 +684,160 @@ f()
 );
 }
 
+// Checks that a traceback is still formatted after the functions it refers to are unreachable
+static void TestTracebacks() {
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+
+	const char* code = R"(
+def make():
+	def inner():
+		raise ValueError('boom')
+	return inner
+make()()
+)";
+
+	testsRun++;
+	if (Wg_Execute(ctx, code, "traced")) {
+		PrintFailure(code, __LINE__, "Expected an exception.");
+		return;
+	}
+	Wg_CollectGarbage(ctx);
+	Wg_NewList(ctx);
+
+	std::string message = Wg_GetErrorMessage(ctx);
+	if (message.find("Line 4, Function inner()\n    raise ValueError('boom')") != std::string::npos
+		&& message.find("ValueError: boom") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure(code, __LINE__, message);
+	}
+
+	testsRun++;
+	Wg_ClearException(ctx);
+	Wg_Execute(ctx, "x = )", "broken");
+	Wg_CollectGarbage(ctx);
+	message = Wg_GetErrorMessage(ctx);
+	if (message.find("Line 1, Function broken()\n    x = )\n        ^") != std::string::npos
+		&& message.find("SyntaxError") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure("x = )", __LINE__, message);
+	}
+}
+
+static void TestCompileBuffer() {
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+
+	testsRun++;
+	const char buffer[] = "print(1)\nprint(2)garbage";
+	Wg_Obj* fn = Wg_CompileBuffer(ctx, buffer, (int)std::strlen("print(1)\nprint(2)"), "buffer");
+	if (fn && Wg_Call(fn, nullptr, 0) && output == "1\n2\n") {
+		testsPassed++;
+	} else {
+		PrintFailure(buffer, __LINE__, fn ? output : Wg_GetErrorMessage(ctx));
+	}
+	Wg_ClearException(ctx);
+
+	// The source must outlive the buffer for tracebacks
+	testsRun++;
+	{
+		std::string source = "def late():\r\n\traise ValueError('late')\r\n";
+		fn = Wg_CompileBuffer(ctx, source.data(), (int)source.size(), "buffer");
+		if (fn)
+			Wg_Call(fn, nullptr, 0);
+	}
+	Wg_Obj* late = Wg_GetGlobal(ctx, "late");
+	std::string message = late && Wg_Call(late, nullptr, 0) == nullptr ? Wg_GetErrorMessage(ctx) : "";
+	if (message.find("Line 2, Function late()\n    raise ValueError('late')\n") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure("late()", __LINE__, message);
+	}
+	Wg_ClearException(ctx);
+
+	testsRun++;
+	Wg_Execute(ctx, "x = 1\r\ny = )\r\n", "crlf");
+	message = Wg_GetErrorMessage(ctx);
+	if (message.find("Line 2, Function crlf()\n    y = )\n") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure("y = )", __LINE__, message);
+	}
+	Wg_ClearException(ctx);
+}
+
+// One program is instantiated in contexts on several threads
+static void TestPrograms() {
+	const char* code = R"(
+class Point:
+	def __init__(self, x, y):
+		self.x = x
+		self.y = y
+def total(n):
+	s = 0
+	for i in range(n):
+		p = Point(i, 2 * i)
+		s += p.x + p.y
+	return s
+result = total(100)
+)";
+	Wg_Program* program = Wg_CompileProgram(code, (int)std::strlen(code), "program");
+
+	testsRun++;
+	std::vector<std::thread> threads;
+	std::vector<Wg_int> results(4);
+	for (size_t i = 0; i < results.size(); i++) {
+		threads.emplace_back([&, i] {
+			Wg_Context* ctx = Wg_CreateContext();
+			for (int run = 0; ctx && run < 2; run++) {
+				Wg_Obj* fn = Wg_InstantiateProgram(ctx, program);
+				if (fn && Wg_Call(fn, nullptr, 0))
+					results[i] += Wg_GetInt(Wg_GetGlobal(ctx, "result"));
+			}
+			Wg_DestroyContext(ctx);
+			});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	if (program && Wg_GetProgramError(program) == nullptr
+		&& std::all_of(results.begin(), results.end(), [](Wg_int r) { return r == 2 * 14850; })) {
+		testsPassed++;
+	} else {
+		PrintFailure(code, __LINE__, "A program did not run correctly in every context.");
+	}
+
+	// Functions keep the code and source alive after the program is freed
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+	testsRun++;
+	Wg_Obj* fn = Wg_InstantiateProgram(ctx, program);
+	Wg_DestroyProgram(program);
+	Wg_Obj* total = fn && Wg_Call(fn, nullptr, 0) ? Wg_GetGlobal(ctx, "total") : nullptr;
+	Wg_Obj* arg = Wg_NewString(ctx, "x");
+	std::string message = total && arg && Wg_Call(total, &arg, 1) == nullptr ? Wg_GetErrorMessage(ctx) : "";
+	if (message.find("Function total()\n    for i in range(n):\n") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure("total('x')", __LINE__, message);
+	}
+	Wg_ClearException(ctx);
+
+	testsRun++;
+	const char* bad = "x = 1\ny = )\n";
+	program = Wg_CompileProgram(bad, (int)std::strlen(bad), "bad");
+	message = program && Wg_GetProgramError(program) && !Wg_InstantiateProgram(ctx, program) ? Wg_GetErrorMessage(ctx) : "";
+	if (message.find("Line 2, Function bad()\n    y = )\n") != std::string::npos
+		&& message.find("SyntaxError") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure(bad, __LINE__, message);
+	}
+	Wg_ClearException(ctx);
+	Wg_DestroyProgram(program);
+}
+
 static void TestStringMethods() {
 	T("print('abc'.capitalize())", "Abc");
 	T("print('AbC'.casefold())", "abc");
@@ -570,6 +877,422 @@ static void TestStringMethods() {
 	T("print('93A09f'.isupper())", "False");
 	T("print('      '.isspace())", "True");
 	T("print('  s   '.isspace())", "False");
+
+	T("print('-'.join(['a', 'b', 'c']), ''.join([]), ','.join(('x',)), '.'.join(map(str, range(3))))", "a-b-c  x 0.1.2");
+	F("','.join(['a', 1])");
+	T("a = 'hello'\nb = 'hel' + 'lo'\nprint(a == b, a is 'hello', {a: 1}[b], 'x' is 'xy'[0])", "True True 1 True");
+	T(R"(
+s = ''
+for i in range(100):
+	s += 'ab'
+t = s
+s += 'x'
+u = t + 'y'
+print(len(s), len(t), len(u), s[-3:], t[-2:], u[-3:], u == t + 'y', s < u)
+)", "201 200 201 abx ab aby True True");
+}
+
+// Checks that strings built by appending to a shared buffer do not change
+static void TestStringBuilding() {
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+	std::string s(100, 'a');
+
+	testsRun++;
+	if (!Wg_Execute(ctx, "s = 'a' * 100\nt = s + 'b'\nu = t + 'c'")) {
+		PrintFailure("", __LINE__, Wg_GetErrorMessage(ctx));
+		return;
+	}
+
+	const char* u = Wg_GetString(Wg_GetGlobal(ctx, "u"));
+	if (!Wg_Execute(ctx, "v = t + 'd'\nw = u + 'e'")) {
+		PrintFailure("", __LINE__, Wg_GetErrorMessage(ctx));
+		return;
+	}
+
+	int len = 0;
+	const char* t = Wg_GetString(Wg_GetGlobal(ctx, "t"), &len);
+	if (s + "b" == t && len == 101
+		&& s + "bc" == u
+		&& s + "bd" == Wg_GetString(Wg_GetGlobal(ctx, "v"))
+		&& s + "bce" == Wg_GetString(Wg_GetGlobal(ctx, "w"))
+		&& Wg_NewString(ctx, "x") == Wg_NewStringBuffer(ctx, "xy", 1)) {
+		testsPassed++;
+	} else {
+		PrintFailure("", __LINE__, "Concatenated strings were modified.");
+	}
+}
+
+static void TestBuffers() {
+	T("print(b'ab\\x00\\xff', bytes(2), bytes([1, 2]), bytes('hi', 'utf-8'), 'hi'.encode(), bytes(b'\"'), b\"'\")", "b'ab\\x00\\xff' b'\\x00\\x00' b'\\x01\\x02' b'hi' b'hi' b'\"' b\"'\"");
+	T("b = b'hello'\nprint(len(b), b[0], b[-1], b[1:3], b[::-2], list(b[:2]), b[10:])", "5 104 111 b'el' b'olh' [104, 101] b''");
+	T("b = b'abcabc'\nprint(b.find(b'c'), b.find(99, 3), b.rfind(b'bc'), b.find(b'x'), b.count(b'bc'), b.index(b'ca'), b'ca' in b, 100 in b)", "2 5 4 -1 2 2 True False");
+	T("print(b'ab'.startswith(b'a'), b'ab'.endswith(b'a'), b'ab'.decode(), b'\\x01\\xab'.hex(), bytes.fromhex('01 AB'))", "True False ab 01ab b'\\x01\\xab'");
+	T("print(b'ab' + b'c', b'ab' * 2, b'a' < b'b', b'a' == bytearray(b'a'), b'a' == 'a', sorted([b'b', b'a', b'']))", "b'abc' b'abab' True True False [b'', b'a', b'b']");
+	T("print(hash(b'ab') == hash(b'abc'[:2]), {b'k': 1}[b'k'], not b'', not b'a')", "True 1 True False");
+	T("s = 0\nfor x in b'\\x01\\x02\\xff':\n\ts += x\nprint(s)", "258");
+	T("a = bytearray(b'ab')\na[0] = 65\na.append(67)\na.extend(b'DE')\na[1:3] = b'xyz'\nprint(a, a.pop(), a.pop(0), len(a))", "bytearray(b'xyzD') 69 65 4");
+	T("a = bytearray(4)\na[::2] = b'\\x01\\x02'\ndel_ = a[1:]\nprint(a, del_, type(del_) is bytearray)", "bytearray(b'\\x01\\x00\\x02\\x00') bytearray(b'\\x00\\x02\\x00') True");
+	T("a = bytearray(b'abc')\nm = memoryview(a)[1:]\nm[0] = 66\nprint(a, m.readonly, m.tobytes(), m.tolist(), len(m))", "bytearray(b'aBc') False b'Bc' [66, 99] 2");
+	T("a = bytearray(b'ab')\nm = memoryview(a)\ntry:\n\ta.append(1)\nexcept BufferError:\n\tprint('exported')\nm.release()\na.append(99)\nprint(a)", "exported\nbytearray(b'abc')");
+	T("with memoryview(b'ab') as m:\n\tprint(m.readonly, m[1])\ntry:\n\tlen(m)\nexcept ValueError:\n\tprint('released')", "True 98\nreleased");
+	T("print((1024).to_bytes(2, 'big'), (1).to_bytes(2, byteorder='little'), (-2).to_bytes(1, 'big', signed=True))", "b'\\x04\\x00' b'\\x01\\x00' b'\\xfe'");
+	T("print(int.from_bytes(b'\\x04\\x00', 'big'), int.from_bytes(b'\\xfe', 'big', signed=True), int.from_bytes([1, 0], byteorder='little'))", "1024 -2 1");
+	T("class B(bytes):\n\tpass\nb = B(b'xy')\nprint(len(b), b[1], isinstance(b, bytes))", "2 121 True");
+	F("bytes([256])");
+	F("bytes('a')");
+	F("b'a'[1]");
+	F("b'a'[0] = 1");
+	F("memoryview(b'a')[0] = 1");
+	F("hash(bytearray())");
+	F("hash(memoryview(bytearray(1)))");
+	F("memoryview(bytearray(2))[0:1] = b'ab'");
+	F("(256).to_bytes(1, 'big')");
+	F("(-1).to_bytes(1, 'big')");
+	F("bytes.fromhex('0g')");
+	F("b'\\xff'.decode('ascii')");
+
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+
+	// Host memory is shared with the script and released once no view refers to it
+	testsRun++;
+	unsigned char packet[] = { 0x45, 0x00, 0x00, 0x1c };
+	static int released;
+	released = 0;
+	Wg_Obj* view = Wg_NewBufferView(ctx, packet, sizeof(packet), false, [](void* userdata) { released += *(int*)userdata; }, &released);
+	if (view)
+		Wg_IncRef(view);
+	Wg_Obj* bytes = Wg_NewBytes(ctx, packet, 2);
+	if (bytes)
+		Wg_IncRef(bytes);
+	if (view && bytes) {
+		Wg_SetGlobal(ctx, "packet", view);
+		Wg_SetGlobal(ctx, "header", bytes);
+	}
+	// The globals keep the objects alive from here on
+	if (view)
+		Wg_DecRef(view);
+	if (bytes)
+		Wg_DecRef(bytes);
+	const char* code = "length = packet[2:].tobytes()\npacket[1] = 7\nversion = packet[0] >> 4\ntail = packet[1:]\n";
+	void* data{};
+	int len{};
+	bool readOnly = true;
+	if (view && bytes && Wg_Execute(ctx, code)
+		&& packet[1] == 7
+		&& Wg_GetInt(Wg_GetGlobal(ctx, "version")) == 4
+		&& Wg_TryGetBuffer(Wg_GetGlobal(ctx, "tail"), &data, &len, &readOnly)
+		&& data == packet + 1 && len == 3 && !readOnly
+		&& Wg_TryGetBuffer(Wg_GetGlobal(ctx, "header"), &data, &len, &readOnly)
+		&& len == 2 && readOnly && ((unsigned char*)data)[0] == 0x45
+		&& !Wg_TryGetBuffer(Wg_GetGlobal(ctx, "version"), nullptr, nullptr, nullptr)) {
+		released = 1;
+		Wg_Execute(ctx, "packet = None\n");
+		Wg_CollectGarbage(ctx);
+		bool stillReferenced = released == 1;
+		Wg_Execute(ctx, "tail = None\n");
+		Wg_CollectGarbage(ctx);
+		if (stillReferenced && released == 2) {
+			testsPassed++;
+		} else {
+			PrintFailure(code, __LINE__, "The host finalizer was not called once the last view was collected.");
+		}
+	} else {
+		PrintFailure(code, __LINE__, Wg_GetErrorMessage(ctx));
+	}
+	Wg_ClearException(ctx);
+
+	testsRun++;
+	unsigned char constant[] = { 1, 2 };
+	view = Wg_NewBufferView(ctx, constant, sizeof(constant), true);
+	if (view) {
+		Wg_IncRef(view);
+		Wg_SetGlobal(ctx, "constant", view);
+		Wg_DecRef(view);
+	}
+	if (view && !Wg_Execute(ctx, "constant[0] = 5") && constant[0] == 1) {
+		testsPassed++;
+	} else {
+		PrintFailure("constant[0] = 5", __LINE__, "A readonly view was written to.");
+	}
+	Wg_ClearException(ctx);
+}
+
+static void TestFiles() {
+	Wg_Config cfg{};
+	Wg_DefaultConfig(&cfg);
+	cfg.enableOSAccess = true;
+	output.clear();
+	cfg.print = [](const char* message, int len, void*) {
+		output += std::string(message, len);
+	};
+	std::unique_ptr<Wg_Context, void(*)(Wg_Context*)> context(Wg_CreateContext(&cfg), Wg_DestroyContext);
+	Wg_Context* ctx = context.get();
+
+	std::string path = (std::filesystem::temp_directory_path() / "wings_test_file.txt").string();
+	Wg_SetGlobal(ctx, "path", Wg_NewString(ctx, path.c_str()));
+
+	auto expect = [&](const char* code, const char* expected, size_t line) {
+		testsRun++;
+		output.clear();
+		if (!Wg_Execute(ctx, code)) {
+			PrintFailure(code, line, Wg_GetErrorMessage(ctx));
+			Wg_ClearException(ctx);
+		} else if (output != std::string(expected) + "\n") {
+			PrintFailure(code, line, expected, output);
+		} else {
+			testsPassed++;
+		}
+	};
+
+	expect(R"(
+with open(path, "w") as f:
+	f.write("alpha\nbeta\n")
+	f.writelines(["gamma\n", "delta"])
+with open(path) as f:
+	print([line for line in f])
+)", "['alpha\\n', 'beta\\n', 'gamma\\n', 'delta']", __LINE__);
+
+	// A read buffer smaller than a line
+	expect(R"(
+with open(path, buffering=4) as f:
+	print(f.readline(), f.readline(2), f.readline(), f.tell(), f.readlines(3), f.readlines(), f.read())
+)", "alpha\n be ta\n 11 ['gamma\\n'] ['delta'] ", __LINE__);
+
+	expect(R"(
+with open(path, "r+") as f:
+	f.read(2)
+	f.write("X")
+	f.seek(-5, 2)
+	print(f.read(), f.seek(0), f.read(4))
+)", "delta 0 alXh", __LINE__);
+
+	expect(R"(
+with open(path, "rb", mmap=True) as f:
+	lines = list(f)
+	f.seek(6)
+	print(f.read(4), f.tell(), f.readline(), f.readlines(6))
+print(lines)
+)", "b'beta' 10 b'\\n' [b'gamma\\n']\n[b'alXha\\n', b'beta\\n', b'gamma\\n', b'delta']", __LINE__);
+
+	expect(R"(
+with open(path, "wb") as f:
+	f.write(b"\x00\xff")
+with open(path, "rb") as f:
+	print(f.read())
+)", "b'\\x00\\xff'", __LINE__);
+
+	expect(R"(
+f = open(path, "w")
+f.close()
+try:
+	f.write("x")
+except ValueError:
+	print("closed")
+try:
+	open(path).write("x")
+except OSError:
+	print("not writable")
+try:
+	open(path, "w", mmap=True)
+except ValueError:
+	print("not mappable")
+)", "closed\nnot writable\nnot mappable", __LINE__);
+
+	context.reset();
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+}
+
+static void TestBytecodeCache() {
+	namespace fs = std::filesystem;
+	fs::path dir = fs::temp_directory_path() / ("wings_test_cache_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+	fs::path cachePath = dir / "__wgcache__" / "cached.wgc";
+	std::string importPath = dir.string() + "/";
+	fs::create_directories(dir);
+	std::ofstream(dir / "cached.py") << R"(
+def counter(n):
+	total = 0
+	def add(x):
+		nonlocal total
+		total += x
+	for i in range(n):
+		add(i)
+	return total
+def gen():
+	try:
+		yield 1
+	finally:
+		pass
+class C:
+	def f(self, *args, **kwargs):
+		(a, (b, c)) = (1, (2, 3))
+		return a + b + c + len(args)
+value = 81985529216486895
+def run():
+	return [counter(4), list(gen()), C().f(1), value]
+)";
+
+	auto readCache = [&] {
+		std::ifstream f(cachePath, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(f), {});
+	};
+	// Patches the cache and recomputes its FNV-1a checksum so that only the contents are wrong
+	auto writeCache = [&](std::string data) {
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < data.size() - 8; i++) {
+			hash ^= (uint8_t)data[i];
+			hash *= 1099511628211ull;
+		}
+		for (int i = 0; i < 8; i++)
+			data[data.size() - 8 + i] = (char)(hash >> (8 * i));
+		std::ofstream(cachePath, std::ios::binary) << data;
+	};
+	auto run = [&](const char* expected, size_t line) {
+		Wg_Config cfg{};
+		Wg_DefaultConfig(&cfg);
+		cfg.importPath = importPath.c_str();
+		cfg.enableBytecodeCache = true;
+		output.clear();
+		cfg.print = [](const char* message, int len, void*) {
+			output += std::string(message, len);
+		};
+		Wg_Context* ctx = Wg_CreateContext(&cfg);
+		const char* code = "import cached\nprint(cached.run())";
+		testsRun++;
+		if (!Wg_Execute(ctx, code)) {
+			PrintFailure(code, line, Wg_GetErrorMessage(ctx));
+		} else if (output != std::string(expected) + "\n") {
+			PrintFailure(code, line, expected, output.c_str());
+		} else {
+			testsPassed++;
+		}
+		Wg_DestroyContext(ctx);
+	};
+
+	run("[6, [1], 7, 81985529216486895]", __LINE__);
+	std::string valid = readCache();
+
+	// A patched literal shows that the cache of every kind of function is accepted
+	std::string literal = valid;
+	char bytes[8];
+	for (int i = 0; i < 8; i++)
+		bytes[i] = (char)(81985529216486895ull >> (8 * i));
+	size_t pos = literal.find(std::string_view(bytes, 8));
+	if (pos != std::string::npos)
+		literal[pos]++;
+	writeCache(literal);
+	run("[6, [1], 7, 81985529216486896]", __LINE__);
+
+	// The operand of the first op of the module, which follows the
+	// magic, version, scalar sizes, source hash and op count
+	std::string corrupt = valid;
+	size_t operand = 4 + 4 + 2 + 8 + 8 + 1;
+	for (size_t i = 0; i < 4; i++)
+		corrupt[operand + i] = (char)0xFF;
+	writeCache(corrupt);
+	run("[6, [1], 7, 81985529216486895]", __LINE__);
+
+	testsRun++;
+	if (readCache() != corrupt) {
+		testsPassed++;
+	} else {
+		PrintFailure("__wgcache__", __LINE__, "A cache with an invalid operand was not replaced.");
+	}
+
+	std::error_code ec;
+	fs::remove_all(dir, ec);
+}
+
+static void TestArrays() {
+	T("from array import array\na = array('q', range(1, 6))\nprint(a, len(a), a[0], a[-1], a[1:4], a[::-2], list(a), a.typecode, a.itemsize)", "array('q', [1, 2, 3, 4, 5]) 5 1 5 array('q', [2, 3, 4]) array('q', [5, 3, 1]) [1, 2, 3, 4, 5] q 8");
+	T("from array import array\na = array('d', [1, 2.5])\na.append(3)\na.extend(array('q', [4]))\na[0] = 0\nprint(a, a.tolist(), array('q'), bool(array('d')))", "array('d', [0.0, 2.5, 3.0, 4.0]) [0.0, 2.5, 3.0, 4.0] array('q') False");
+	T("from array import array\na = array('q', range(100))\nb = array('d', range(100))\nprint(a.sum(), b.sum(), a.min(), b.max(), a.mean(), a.dot(a), a.dot(b))", "4950 4950.0 0 99.0 49.5 328350 328350.0");
+	T("from array import array\na = array('q', [1, 2, 3])\nprint(a + a, a - 1, a * array('d', [0.5, 1, 2]), a / 2, a * 2.0)", "array('q', [2, 4, 6]) array('q', [0, 1, 2]) array('d', [0.5, 2.0, 6.0]) array('d', [0.5, 1.0, 1.5]) array('d', [2.0, 4.0, 6.0])");
+	T("from array import array\nprint(array('q', [9223372036854775807]) + 1, array('q', [9223372036854775807, 1]).sum())", "array('q', [-9223372036854775808]) -9223372036854775808");
+	T("from array import array\na = array('q', range(6))\na[::2] = [7, 8, 9]\na[1:3] = a[4:6]\nprint(a)", "array('q', [7, 9, 5, 3, 9, 5])");
+	T("import array\nb = bytearray(16)\na = array.frombuffer('q', b)\na[1] = -1\nprint(b[8], a, bytes(a[:1]), len(memoryview(a)))", "255 array('q', [0, -1]) b'\\x00\\x00\\x00\\x00\\x00\\x00\\x00\\x00' 16");
+	T("from array import array\na = array('q', [1])\nm = memoryview(a)\ntry:\n\ta.append(2)\nexcept BufferError:\n\tprint('exported')\nm.release()\na.append(2)\nprint(a)", "exported\narray('q', [1, 2])");
+	T("from array import array\na = array('q', range(5))[1:]\na[1:3] = array('q', [9])\nprint(a)\na[:0] = [7, 8]\na[5:] = []\na[-1:] = range(3)\nprint(a, len(a))", "array('q', [1, 9, 4])\narray('q', [7, 8, 1, 9, 0, 1, 2]) 7");
+	F("import array\narray.array('i')");
+	F("import array\narray.array('q', [1.5])");
+	F("import array\narray.array('q', [1])[1]");
+	F("import array\narray.array('q').max()");
+	F("import array\narray.array('q', [1]) + array.array('q', [1, 2])");
+	F("import array\narray.array('q', [1, 2])[::2] = [1, 2]");
+	F("import array\nb = bytearray(16)\narray.frombuffer('q', b)[0:1] = []");
+	F("import array\narray.frombuffer('q', bytes(7))");
+	F("import array\narray.frombuffer('q', bytes(8))[0] = 1");
+
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+
+	// Host memory is shared with an array without copying
+	testsRun++;
+	alignas(8) Wg_float samples[4] = { 1, 2, 3, 4 };
+	Wg_Obj* view = Wg_NewBufferView(ctx, samples, sizeof(samples), false);
+	if (view) {
+		Wg_SetGlobal(ctx, "samples", view);
+	}
+	const char* code = "import array\na = array.frombuffer('d', samples)\ntotal = a.sum()\na[0] = 10\nscaled = a * 2\n";
+	void* data{};
+	int len{};
+	bool readOnly = true;
+	if (view && Wg_Execute(ctx, code)
+		&& Wg_GetFloat(Wg_GetGlobal(ctx, "total")) == 10 && samples[0] == 10
+		&& Wg_TryGetBuffer(Wg_GetGlobal(ctx, "a"), &data, &len, &readOnly)
+		&& data == samples && len == (int)sizeof(samples) && !readOnly
+		&& Wg_TryGetBuffer(Wg_GetGlobal(ctx, "scaled"), &data, &len, &readOnly)
+		&& len == (int)sizeof(samples) && ((Wg_float*)data)[3] == 8) {
+		testsPassed++;
+	} else {
+		PrintFailure(code, __LINE__, Wg_GetErrorMessage(ctx));
+	}
+	Wg_ClearException(ctx);
+}
+
+void TestBuiltinFunctions() {
+	T("print(list(range(5)), list(range(5, 0, -2)), list(reversed(range(1, 10, 3))))", "[0, 1, 2, 3, 4] [5, 3, 1] [7, 4, 1]");
+	T("r = range(3, 9)\nprint(r.start, r.stop, r.step, type(r) is range)", "3 9 1 True");
+	T("print(list(enumerate('ab', 1)), list(zip([1, 2, 3], 'ab')), list(zip()))", "[(1, 'a'), (2, 'b')] [(1, 'a'), (2, 'b')] []");
+	T("print(list(map(lambda x: x * 2, [1, 2])), list(filter(lambda x: x % 2, range(6))))", "[2, 4] [1, 3, 5]");
+	T("print(sum([1, 2, 3]), sum([1.5, 2], 10), sum([1], start=5))", "6 13.5 6");
+	T("print(max(3, 1, 2), min([4, 2, 8]), max([], default=0), max([1, -5, 3], key=lambda x: x * x))", "3 2 0 -5");
+	T("print(sorted([3, 1, 2]), sorted('cba', reverse=True), sorted([1, -3, 2], key=abs))", "[1, 2, 3] ['c', 'b', 'a'] [1, 2, -3]");
+	T("print(len([1, 2]), repr('x'), hash(5) == hash(5))", "2 'x' True");
+	T("print(('g', 1) < ('f', 10), [1, 5] < [2, 0], sorted([('g', 1), ('f', 10)]))", "False True [('f', 10), ('g', 1)]");
+	T("calls = []\ndef key(x):\n\tcalls.append(x)\n\treturn x % 3\nprint(sorted(range(8), key=key), sorted(range(8), key=key, reverse=True), len(calls))", "[0, 3, 6, 1, 4, 7, 2, 5] [2, 5, 1, 4, 7, 0, 3, 6] 16");
+	T("print(sorted([3, 1.5, 1, -2]), sorted(['b', 'B', 'a']), sorted([2.5, 1]), sorted([]), sorted([1]))", "[-2, 1, 1.5, 3] ['B', 'a', 'b'] [1, 2.5] [] [1]");
+	T("x = [(i * 7919) % 1000 for i in range(3000)]\nx.extend(range(500))\nx.extend(range(500, 0, -1))\ny = sorted(x)\nprint(len(y), all([y[i] <= y[i + 1] for i in range(len(y) - 1)]), y[:3], y == sorted(y), sorted(y, reverse=True)[:2])", "4000 True [0, 0, 0] True [999, 999]");
+	T("class P:\n\tdef __init__(self, v):\n\t\tself.v = v\n\tdef __lt__(self, o):\n\t\treturn self.v < o.v\nprint([p.v for p in sorted([P(2), P(1), P(3)])])", "[1, 2, 3]");
+	T("x = [3, 1, 2]\ntry:\n\tx.sort(key=lambda v: 1 / (v - 1))\nexcept ZeroDivisionError:\n\tprint(x)", "[3, 1, 2]");
+	F("sorted([1, 'a'])");
+	T("d = {}\nfor i in range(50):\n\td[(i, str(i))] = i\nprint(d[(7, '7')], (49, '49') in d, hash((1, 'a')) == hash((1, 'a')))", "7 True True");
+	T(R"(
+class K:
+	def __init__(self, v):
+		self.v = v
+	def __hash__(self):
+		return 0
+	def __eq__(self, other):
+		return self.v % 3 == other.v % 3
+d = {K(1): 'a', 'k': 'b', None: 'c', 1.5: 'd'}
+print(d[K(4)], d['k'], d[None], d[1.5], len({'x', 'x', 'y'}))
+)", "a b c d 2");
+	T(R"(
+d = {'a': 1, 'b': 2}
+d['a'] = 3
+for i in range(100):
+	d[i] = i
+for i in range(100):
+	d.pop(i)
+d['c'] = 4
+print(len(d), d)
+)", "3 {'a': 3, 'b': 2, 'c': 4}");
+	F("range(1, 2, 0)");
+	F("range('a')");
+	F("max([])");
 }
 
 void TestSlices() {
@@ -592,14 +1315,1522 @@ void TestSlices() {
 	F("print('12345'[:::])");
 }
 
+void TestFunctions() {
+	T("def f():\n\tx = [1, # one\n2,\n\t\t\t3]\n\treturn x\nprint(f(), 0x1F, 'a\\x41', len('\\n'))", "[1, 2, 3] 31 aA 1");
+	T(R"(
+def f(a, *args, **kwargs):
+	return (a, args, kwargs)
+def g(a, b=2):
+	c = a + b
+	return c
+print(f(1), f(1, 3, 4), f(a=1, z=0), g(1), g(b=5, a=1))
+)"
+,
+"(1, (), {}) (1, (3, 4), {}) (1, (), {'z': 0}) 3 6"
+);
+
+	T(R"(
+def f():
+	(x, (y, z)) = (1, (2, 3))
+	return x + y + z
+print(f())
+)"
+,
+"6"
+);
+
+	T(R"(
+def counter(n):
+	def inc():
+		nonlocal n
+		n += 1
+		return n
+	return inc
+c = counter(10)
+c()
+print(c(), counter(0)())
+)"
+,
+"12 1"
+);
+
+	T(R"(
+def f():
+	x = 1
+	g = lambda: x
+	x = 2
+	return g()
+print(f())
+)"
+,
+"2"
+);
+
+	F(R"(
+def f(a):
+	return a
+f()
+)");
+
+	T(R"(
+class Adder:
+	def __call__(self, a, b, **rest):
+		return a + b + len(rest)
+def f(a, b, **kwargs):
+	return (a, b, kwargs)
+def g(a, b=2, c=3):
+	return (a, b, c)
+add = Adder()
+print(f(1, b=2), f(b=1, a=0, x=9, y=8), add(1, b=2, z=0), add(b=5, a=1), f(*[1], **{'b': 2}), g(1, c=5))
+)"
+,
+"(1, 2, {}) (0, 1, {'x': 9, 'y': 8}) 4 6 (1, 2, {}) (1, 2, 5)"
+);
+
+	F(R"(
+def f(a, b):
+	return a
+f(1, a=2)
+)");
+
+	T(R"(
+def f(a, b=2, c=3):
+	return (a, b, c)
+def g(x, y=5):
+	return lambda: x + y
+def h(a, *rest):
+	return (a, rest)
+print(f(1), f(1, 4), f(1, 4, 6), g(1)(), g(1, 2)(), h(1), h(1, 2, 3))
+)"
+,
+"(1, 2, 3) (1, 4, 3) (1, 4, 6) 6 3 (1, ()) (1, (2, 3))"
+);
+
+	F(R"(
+def f(a, b=2):
+	return a
+f()
+)");
+
+	F(R"(
+def f(a):
+	return a
+f(1, 2)
+)");
+
+	F(R"(
+def f(a):
+	return a
+f(b=1)
+)");
+
+	// Calls between script functions do not recurse on the host stack
+	T(R"(
+class Node:
+	def __init__(self, n):
+		self.n = n
+	def depth(self, extra=0):
+		if self.n == 0:
+			return extra
+		return Node(self.n - 1).depth(extra=extra + 1)
+def count(n):
+	if n == 0:
+		return 0
+	return count(n - 1) + 1
+try:
+	count(100000)
+except RecursionError:
+	print("limit")
+print(count(900), Node(500).depth())
+)"
+,
+"limit\n900 500"
+);
+
+	// Other calls still go through native code and are limited further
+	F(R"(
+class S:
+	def __str__(self):
+		return str(self)
+str(S())
+)");
+}
+
+// Passes keyword arguments through an array together with a tuple of their names
+void TestGlobalCaches() {
+	// Module level code and global declarations look up the module globals
+	T(R"(
+for i in range(2):
+	try:
+		print(later)
+	except NameError:
+		print('missing')
+	later = 3
+)"
+,
+"missing\n3"
+);
+
+	T(R"(
+values = []
+for i in range(2):
+	values.append(len('ab'))
+	def len(x):
+		return 0
+print(values)
+)"
+,
+"[2, 0]"
+);
+
+	T(R"(
+LIMIT = 3
+total = 0
+i = 0
+while i < LIMIT:
+	total += abs(-i)
+	i += 1
+LIMIT = 0
+print(total, i < LIMIT)
+)"
+,
+"3 False"
+);
+}
+
+void TestGenerators() {
+	T(R"(
+def count(n):
+	i = 0
+	while i < n:
+		yield i
+		i += 1
+g = count(2)
+print(list(count(4)), sum(count(5)), next(g), next(g))
+try:
+	next(g)
+except StopIteration:
+	print('stop')
+)"
+,
+"[0, 1, 2, 3] 10 0 1\nstop"
+);
+
+	T(R"(
+def running_total():
+	total = 0
+	while True:
+		value = yield total
+		if value is None:
+			return
+		total += value
+g = running_total()
+print(next(g), g.send(3), g.send(4))
+)"
+,
+"0 3 7"
+);
+
+	T(R"(
+def f():
+	try:
+		yield 1
+		yield 2
+	finally:
+		print('finally')
+def g():
+	while True:
+		try:
+			yield 1
+		except ValueError:
+			print('caught')
+for x in f():
+	print(x)
+h = g()
+next(h)
+print(h.throw(ValueError))
+)"
+,
+"1\n2\nfinally\ncaught\n1"
+);
+
+	T(R"(
+def f(n):
+	if n > 0:
+		yield n
+		yield from f(n - 1)
+	yield from [0]
+def g():
+	for i in range(2):
+		for j in range(2):
+			yield (i, j)
+print(list(f(2)), list(g()))
+)"
+,
+"[2, 1, 0, 0, 0] [(0, 0), (0, 1), (1, 0), (1, 1)]"
+);
+
+	// Generator expressions capture from enclosing functions
+	T(R"(
+def f():
+	k = 10
+	def g():
+		return list(x * k for x in range(3) if x != 1)
+	return g()
+print(f(), sum(x * x for x in range(4)), dict((k, v) for k, v in [('a', 1)]))
+)"
+,
+"[0, 20] 14 {'a': 1}"
+);
+
+	T(R"(
+def f():
+	yield 1
+	raise KeyError()
+def g():
+	yield next(h)
+h = g()
+try:
+	for x in f():
+		print(x)
+except KeyError:
+	print('KeyError')
+try:
+	next(h)
+except ValueError:
+	print('ValueError')
+)"
+,
+"1\nKeyError\nValueError"
+);
+
+	T(R"(
+def f():
+	try:
+		yield 1
+		yield 2
+	finally:
+		print('cleanup')
+def g():
+	try:
+		yield 1
+	except GeneratorExit:
+		print('exit')
+def h():
+	while True:
+		try:
+			yield 1
+		except GeneratorExit:
+			pass
+x = f()
+print(next(x))
+x.close()
+x.close()
+f().close()
+y = g()
+next(y)
+y.close()
+z = h()
+next(z)
+try:
+	z.close()
+except RuntimeError as e:
+	print(e)
+print('done')
+)"
+,
+"1\ncleanup\nexit\ngenerator ignored GeneratorExit\ndone"
+);
+
+	F("yield 1");
+	F("print(x for x in range(2), 1)");
+}
+
+static void TestCallVector() {
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+	Wg_Execute(ctx, "def f(a, b, **kw):\n\treturn (a, b, kw)", "vector");
+
+	// Keep the objects alive since the context is destroyed afterwards anyway
+	auto keep = [](Wg_Obj* obj) { Wg_IncRef(obj); return obj; };
+	Wg_Obj* names[] = { keep(Wg_NewString(ctx, "c")), keep(Wg_NewString(ctx, "extra")) };
+	Wg_Obj* kwnames = keep(Wg_NewTuple(ctx, names, 2));
+	Wg_Obj* argv[] = { keep(Wg_NewInt(ctx, 1)), keep(Wg_NewInt(ctx, 2)), keep(Wg_NewInt(ctx, 3)), keep(Wg_NewInt(ctx, 4)) };
+
+	testsRun++;
+	Wg_Obj* result = Wg_CallVector(Wg_GetGlobal(ctx, "f"), argv, 2, kwnames);
+	const char* repr = result ? Wg_GetString(Wg_UnaryOp(WG_UOP_REPR, result)) : "";
+	if (result && std::string(repr) == "(1, 2, {'c': 3, 'extra': 4})") {
+		testsPassed++;
+	} else {
+		PrintFailure("f(1, 2, c=3, extra=4)", __LINE__, result ? repr : Wg_GetErrorMessage(ctx));
+	}
+	Wg_ClearException(ctx);
+
+	testsRun++;
+	Wg_Obj* duplicate[] = { keep(Wg_NewString(ctx, "a")) };
+	Wg_Obj* duplicateNames = keep(Wg_NewTuple(ctx, duplicate, 1));
+	if (Wg_CallVector(Wg_GetGlobal(ctx, "f"), argv, 2, duplicateNames) == nullptr
+		&& std::string(Wg_GetErrorMessage(ctx)).find("multiple values for argument 'a'") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure("f(1, 2, a=3)", __LINE__, "Expected a duplicate argument error.");
+	}
+	Wg_ClearException(ctx);
+}
+
+static void TestJson() {
+	T("import json\nd = json.loads('{\"a\": [1, 2.5, \"x\", true, false, null], \"b\": {}, \"c\": -0.5e1}')\nprint(d['a'], d['b'], d['c'])", "[1, 2.5, 'x', True, False, None] {} -5.0");
+	T("import json\nprint(json.loads(' [ ] '), json.loads(b'[1]'), json.loads('1e999'), json.loads('12345678901234567890') > 10.0 ** 19)", "[] [1] inf True");
+	T("import json\nprint(json.dumps({'a': [1, 2.5, None, True], 'b': 'q\"\\n\\t', 'c': (1,)}))", R"({"a": [1, 2.5, null, true], "b": "q\"\n\t", "c": [1]})");
+	T("import json\nprint(json.dumps([0.1, 10.0 ** 16, 10.0 ** -5, 100.0, 0.0001, float('nan'), -float('inf')]))", "[0.1, 1e+16, 1e-05, 100.0, 0.0001, NaN, -Infinity]");
+	T("import json\nprint(json.dumps({'b': 1, 'a': [1, 2], 'c': {}}, indent=2, sort_keys=True))", "{\n  \"a\": [\n    1,\n    2\n  ],\n  \"b\": 1,\n  \"c\": {}\n}");
+	T("import json\nprint(json.dumps({1: 2, 2.5: 3, True: 4, None: 5}), json.dumps((1, 2), separators=(',', ':')), json.dumps({10: 1, 9: 2}, sort_keys=True))", R"({"1": 2, "2.5": 3, "true": 4, "null": 5} [1,2] {"9": 2, "10": 1})");
+	T("import json\ns = json.loads('\"\\\\u00e9\\\\ud83d\\\\ude00\\\\n\"')\nprint(len(s), json.dumps(s), s == b'\\xc3\\xa9\\xf0\\x9f\\x98\\x80\\n'.decode(), json.loads(json.dumps(s, ensure_ascii=False)) == s)", R"(7 "\u00e9\ud83d\ude00\n" True True)");
+	T("import json\ntry:\n\tjson.loads('{\\n\"a\" 1}')\nexcept json.JSONDecodeError as e:\n\tprint(isinstance(e, ValueError), e)", "True Expecting ':' delimiter: line 2 column 5 (char 6)");
+	T("import json\nfor doc in ['', '[1, 2', '[1,]', '{\"a\": 1,}', '1 2', '\"abc', '\"\\\\x\"', '\"\\x01\"']:\n\ttry:\n\t\tjson.loads(doc)\n\texcept json.JSONDecodeError as e:\n\t\tprint(e)",
+		"Expecting value: line 1 column 1 (char 0)\n"
+		"Expecting ',' delimiter: line 1 column 6 (char 5)\n"
+		"Expecting value: line 1 column 4 (char 3)\n"
+		"Expecting property name enclosed in double quotes: line 1 column 9 (char 8)\n"
+		"Extra data: line 1 column 3 (char 2)\n"
+		"Unterminated string starting at: line 1 column 1 (char 0)\n"
+		"Invalid \\escape: line 1 column 2 (char 1)\n"
+		"Invalid control character at: line 1 column 2 (char 1)");
+	T("import json\nclass File:\n\tdef __init__(self):\n\t\tself.s = ''\n\tdef write(self, s):\n\t\tself.s += s\n\tdef read(self):\n\t\treturn self.s\nf = File()\njson.dump({'x': [1, 2]}, f, indent=1)\nprint(f.s, json.load(f))", "{\n \"x\": [\n  1,\n  2\n ]\n} {'x': [1, 2]}");
+	F("import json\njson.dumps({1, 2})");
+	F("import json\njson.dumps({(1, 2): 3})");
+	F("import json\na = []\na.append(a)\njson.dumps(a)");
+	F("import json\njson.dumps({'a': 1, 1: 2}, sort_keys=True)");
+	F("import json\njson.loads(1)");
+
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+
+	// The C API writes compact JSON and raises a ValueError for invalid documents
+	testsRun++;
+	const char* doc = "{\"name\": \"wings\", \"tags\": [1, 2.5, null], \"nested\": {\"ok\": true}}";
+	auto keep = [](Wg_Obj* obj) { if (obj) Wg_IncRef(obj); return obj; };
+	auto release = [](Wg_Obj* obj) { if (obj) Wg_DecRef(obj); };
+	Wg_Obj* parsed = keep(Wg_ParseJson(ctx, doc, (int)std::strlen(doc)));
+	Wg_Obj* json = parsed ? keep(Wg_ToJson(parsed)) : nullptr;
+	Wg_Obj* pretty = parsed ? keep(Wg_ToJson(parsed, 1)) : nullptr;
+	bool compact = json && std::strcmp(Wg_GetString(json), "{\"name\":\"wings\",\"tags\":[1,2.5,null],\"nested\":{\"ok\":true}}") == 0;
+	bool indented = pretty && std::string_view(Wg_GetString(pretty)).starts_with("{\n \"name\": \"wings\",\n \"tags\": [\n  1,");
+	bool rejected = Wg_ParseJson(ctx, "[1", 2) == nullptr && Wg_GetException(ctx) != nullptr;
+	release(parsed);
+	release(json);
+	release(pretty);
+	if (compact && indented && rejected) {
+		testsPassed++;
+	} else {
+		PrintFailure(doc, __LINE__, Wg_GetErrorMessage(ctx));
+	}
+	Wg_ClearException(ctx);
+}
+
+static void TestSuspension() {
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+	Wg_Execute(ctx, R"(
+def read(key):
+	return fetch(key) + 1
+
+def handler(n):
+	total = 0
+	for i in range(n):
+		try:
+			total += read(i)
+		except ValueError:
+			total += 100
+	return total
+
+def indirect():
+	return list(map(fetch, [1]))
+)", "suspension");
+
+	// The native function records the key and waits for the host
+	static Wg_int requested;
+	Wg_Function fetch = [](Wg_Context* context, Wg_Obj** argv, int argc) -> Wg_Obj* {
+		requested = Wg_GetInt(argv[0]);
+		return Wg_Suspend(context);
+	};
+	Wg_SetGlobal(ctx, "fetch", Wg_NewFunction(ctx, fetch, nullptr, "fetch"));
+
+	testsRun++;
+	Wg_Obj* argv[] = { Wg_NewInt(ctx, 3) };
+	Wg_Obj* result = Wg_CallSuspendable(Wg_GetGlobal(ctx, "handler"), argv, 1);
+	std::vector<Wg_int> keys;
+	while (result == nullptr && Wg_IsSuspended(ctx)) {
+		keys.push_back(requested);
+		Wg_CollectGarbage(ctx);
+		if (requested == 2) {
+			result = Wg_Resume(ctx, nullptr, Wg_GetGlobal(ctx, "ValueError"));
+		} else {
+			result = Wg_Resume(ctx, Wg_NewInt(ctx, requested * 10));
+		}
+	}
+	if (result && Wg_GetInt(result) == 112 && keys == std::vector<Wg_int>{ 0, 1, 2 }) {
+		testsPassed++;
+	} else {
+		PrintFailure("handler(3)", __LINE__, result ? "Wrong result." : Wg_GetErrorMessage(ctx));
+	}
+	Wg_ClearException(ctx);
+
+	testsRun++;
+	result = Wg_CallSuspendable(Wg_GetGlobal(ctx, "read"), argv, 1);
+	if (result == nullptr && Wg_IsSuspended(ctx)
+		&& Wg_Resume(ctx, nullptr, Wg_GetGlobal(ctx, "KeyError")) == nullptr && !Wg_IsSuspended(ctx)
+		&& std::string(Wg_GetErrorMessage(ctx)).find("Function read()") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure("read(3)", __LINE__, "Expected the exception to propagate into read.");
+	}
+	Wg_ClearException(ctx);
+
+	testsRun++;
+	if (Wg_CallSuspendable(Wg_GetGlobal(ctx, "indirect"), nullptr, 0) == nullptr && !Wg_IsSuspended(ctx)
+		&& std::string(Wg_GetErrorMessage(ctx)).find("RuntimeError") != std::string::npos
+		&& Wg_Call(Wg_GetGlobal(ctx, "read"), argv, 1) == nullptr && !Wg_IsSuspended(ctx)) {
+		testsPassed++;
+	} else {
+		PrintFailure("indirect()", __LINE__, "Expected suspension through a native frame to fail.");
+	}
+	Wg_ClearException(ctx);
+}
+
+static void TestBulkMarshalling() {
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+	auto keep = [](Wg_Obj* obj) { if (obj) Wg_IncRef(obj); return obj; };
+	auto repr = [&](Wg_Obj* obj) -> std::string {
+		Wg_Obj* s = obj ? Wg_UnaryOp(WG_UOP_REPR, obj) : nullptr;
+		return s ? Wg_GetString(s) : Wg_GetErrorMessage(ctx);
+	};
+
+	std::vector<Wg_int> ints(1000);
+	for (size_t i = 0; i < ints.size(); i++)
+		ints[i] = (Wg_int)i * 3;
+	Wg_float floats[] = { 1.5, -2.0 };
+	const char* strings[] = { "a", "bc", "\xc3\xa9" };
+
+	testsRun++;
+	Wg_Obj* list = keep(Wg_NewListFromInts(ctx, ints.data(), (int)ints.size()));
+	Wg_Obj* tuple = keep(Wg_NewTupleFromFloats(ctx, floats, 2));
+	Wg_Obj* strs = keep(Wg_NewListFromStrings(ctx, strings, 3));
+	Wg_Obj* dict = keep(Wg_NewDictionaryFromStrings(ctx, strings, strings, 3));
+	Wg_Obj* empty = keep(Wg_NewTupleFromInts(ctx, nullptr, 0));
+	Wg_Obj* sum = list ? Wg_CallMethod(list, "__len__", nullptr, 0) : nullptr;
+	if (sum && Wg_GetInt(sum) == 1000 && Wg_GetInt(Wg_GetIndex(list, Wg_NewInt(ctx, 999))) == 2997
+		&& repr(tuple) == "(1.5, -2.0)"
+		&& repr(strs) == R"(['a', 'bc', '\xc3\xa9'])"
+		&& repr(dict) == R"({'a': 'a', 'bc': 'bc', '\xc3\xa9': '\xc3\xa9'})"
+		&& repr(empty) == "()") {
+		testsPassed++;
+	} else {
+		PrintFailure("Wg_NewListFromInts()", __LINE__, repr(list) + repr(tuple) + repr(strs) + repr(dict));
+	}
+
+	testsRun++;
+	std::vector<Wg_int> readInts(2000);
+	Wg_float readFloats[4]{};
+	const char* readStrings[2]{};
+	Wg_Obj* keys[4]{};
+	Wg_Obj* values[4]{};
+	bool ok = Wg_GetInts(list, readInts.data(), (int)readInts.size()) == 1000
+		&& std::equal(ints.begin(), ints.end(), readInts.begin())
+		&& Wg_GetFloats(tuple, readFloats, 4) == 2 && readFloats[0] == 1.5 && readFloats[1] == -2.0
+		&& Wg_GetStrings(strs, readStrings, 2) == 3 && std::string(readStrings[1]) == "bc"
+		&& Wg_GetDictionaryItems(dict, keys, values, 4) == 3 && std::string(Wg_GetString(values[2])) == "\xc3\xa9";
+	Wg_Execute(ctx, "r = range(5)\ng = (lambda: [i * i for i in range(4)])()\nd = {'x': 1}", "bulk");
+	ok = ok && Wg_GetInts(Wg_GetGlobal(ctx, "r"), readInts.data(), 3) == 5 && readInts[2] == 2
+		&& Wg_GetFloats(Wg_GetGlobal(ctx, "g"), readFloats, 4) == 4 && readFloats[3] == 9.0
+		&& Wg_GetStrings(Wg_GetGlobal(ctx, "d"), readStrings, 2) == 1 && std::string(readStrings[0]) == "x";
+	if (ok) {
+		testsPassed++;
+	} else {
+		PrintFailure("Wg_GetInts()", __LINE__, "The items were not read correctly.");
+	}
+
+	testsRun++;
+	if (Wg_GetInts(strs, readInts.data(), 3) == -1
+		&& std::string(Wg_GetErrorMessage(ctx)).find("TypeError") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure("Wg_GetInts(['a'])", __LINE__, "Expected a TypeError.");
+	}
+	Wg_ClearException(ctx);
+
+	testsRun++;
+	const char* names[] = { "r", "missing", "d" };
+	Wg_Obj* globals[3]{};
+	Wg_Obj* yielded[3]{};
+	Wg_Execute(ctx, R"(
+class Count:
+	def __init__(self):
+		self.i = -1
+	def __iter__(self):
+		return self
+	def __next__(self):
+		self.i += 1
+		return self.i
+)", "bulk");
+	Wg_Obj* counter = Wg_ExecuteExpression(ctx, "Count()", "bulk");
+	if (Wg_GetGlobals(ctx, names, 3, globals) == 2 && globals[1] == nullptr
+		&& globals[2] == Wg_GetGlobal(ctx, "d")
+		&& counter && Wg_IterateInto(counter, yielded, 3) == 3 && Wg_GetInt(yielded[2]) == 2) {
+		testsPassed++;
+	} else {
+		PrintFailure("Wg_GetGlobals()", __LINE__, Wg_GetErrorMessage(ctx));
+	}
+	Wg_ClearException(ctx);
+}
+
+void TestOperators() {
+	T("print(1 + 2, 1 - 2.5, 3 * 4, 7 / 2, 7 // 2, 7 % 3, 2 ** 3)", "3 -1.5 12 3.5 3 1 8");
+	T("print(6 & 3, 6 | 3, 6 ^ 3, 1 << 4, 16 >> 2)", "2 7 5 16 4");
+	T("print(1 < 2, 2 <= 2, 3 > 2, 2 >= 3, 1 == 1, 1 != 1)", "True True True False True False");
+	T("print('ab' + 'cd', 'a' < 'b', 'a' == 'a', 'a' != 'b')", "abcd True True True");
+	T("x = 5\nx += 1\nx *= 2\nprint(x)", "12");
+	T("print(-6 + 1, -5 - 1, 255 + 1, 256 + 1, [i * i for i in range(14, 18)])", "-5 -6 256 257 [196, 225, 256, 289]");
+
+	T(R"(
+class V:
+	def __init__(self, x):
+		self.x = x
+	def __add__(self, other):
+		return V(self.x + other.x)
+	def __lt__(self, other):
+		return self.x < other.x
+print((V(1) + V(2)).x, V(1) < V(2))
+)"
+,
+"3 True"
+);
+
+	T(R"(
+big = 9007199254740993
+m = -9223372036854775807 - 1
+print(big // 1, big // 3, -big // 2, big % 10, m // -1, m % -1, m // 1, m % 7)
+print(big.__floordiv__(3), big.__mod__(10), m.__floordiv__(-1), m.__mod__(-1))
+print(9223372036854775807 * 2, m - 1, m * -1, -m, m.__neg__())
+)"
+,
+"9007199254740993 3002399751580331 -4503599627370497 3 -9223372036854775808 0 -9223372036854775808 6\n"
+"3002399751580331 3 -9223372036854775808 0\n"
+"-2 9223372036854775807 -9223372036854775808 -9223372036854775808 -9223372036854775808"
+);
+
+	T(R"(
+(a, b) = (7, -2)
+print(a // b, -a // b, -a // -b, a % b, -a % b, -a % -b, 6 % -3, 6 // -3)
+print(a.__floordiv__(b), a.__mod__(b), (-a).__floordiv__(b * -1), (-a).__mod__(-b))
+)"
+,
+"-4 3 -4 -1 -1 1 0 -2\n"
+"-4 -1 -4 1"
+);
+
+	F("print(1 // 0)");
+	F("print(1 + 'a')");
+	F("print(1 << -1)");
+}
+
+void TestSuperinstructions() {
+	// Compare and jump, with and without the plain int fast path
+	T(R"(
+n = 3
+i = 0
+while i < n:
+	i += 1
+s = 'b'
+f = 2.5
+print(i, i == 3, s < 'c', f > 2, 1 if i != 3 else 0)
+)"
+,
+"3 True True True 0"
+);
+
+	T(R"(
+class V:
+	def __init__(self, x):
+		self.x = x
+	def __lt__(self, other):
+		return self.x < other
+v = V(1)
+big = 9223372036854775807
+if v < 2:
+	print('lt', big > 0, big >= big)
+)"
+,
+"lt True True"
+);
+
+	// Variable and Dot
+	T(R"(
+class P:
+	pass
+p = P()
+p.x = 4
+print(p.x, [].__class__ is list)
+)"
+,
+"4 True"
+);
+
+	// Calls with loads only, including jumps back into the arguments of a loop
+	T(R"(
+def add(a, b, c=10):
+	return a + b + c
+x = 1
+total = 0
+for i in range(3):
+	total = add(x, i) + add(x, 2, 3) + len('ab')
+print(total, print is print)
+)"
+,
+"21 True"
+);
+
+	T(R"(
+try:
+	len(missing)
+except NameError:
+	print('caught')
+try:
+	if missing < 1:
+		pass
+except NameError:
+	print('caught')
+try:
+	missing.x
+except NameError:
+	print('caught')
+try:
+	len(1, 2)
+except TypeError:
+	print('caught')
+)"
+,
+"caught\ncaught\ncaught\ncaught"
+);
+
+	F("x = 1\nif x < missing:\n\tpass");
+	F("x = 1\nif x < 'a':\n\tpass");
+	F("x = 1\nx.y");
+
+	// Sequences are not fused across lines so the failing line is reported
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+	const char* code = R"(
+x = 1
+print(x,
+	missing)
+)";
+	testsRun++;
+	if (Wg_Execute(ctx, code)) {
+		PrintFailure(code, __LINE__, "Expected an exception.");
+		return;
+	}
+	std::string message = Wg_GetErrorMessage(ctx);
+	if (message.find("Line 4") != std::string::npos && message.find("NameError") != std::string::npos) {
+		testsPassed++;
+	} else {
+		PrintFailure(code, __LINE__, message);
+	}
+}
+
+void TestAttributes() {
+	T(R"(
+class A:
+	def __init__(self):
+		self.x = 1
+		self.y = 2
+class B:
+	def __init__(self):
+		self.y = 3
+		self.x = 4
+def get(o):
+	return o.x * 10 + o.y
+print([get(o) for o in [A(), B(), A(), B()]])
+)"
+,
+"[12, 43, 12, 43]"
+);
+
+	T(R"(
+class P:
+	def __init__(self):
+		self.v = 0
+	def f(self):
+		return 'method'
+ps = [P(), P()]
+for p in ps:
+	p.v += 1
+ps[1].f = lambda: 'attr'
+ps[1].w = 5
+print([p.f() for p in ps], ps[0].v, ps[1].v, ps[1].w)
+)"
+,
+"['method', 'attr'] 1 1 5"
+);
+
+	T(R"(
+class A:
+	def f(self, *args, **kw):
+		return (self.n, args, kw)
+	def __init__(self):
+		self.n = 1
+		self.g = lambda x: x * 2
+class B(A):
+	pass
+a = A()
+print(a.f(*[1, 2], z=3), a.g(4), B().f(5), None.__str__(), [1, 2].__len__())
+)"
+,
+"(1, (1, 2), {'z': 3}) 8 (1, (5,), {}) None 2"
+);
+
+	F("class A:\n\tpass\nA().f()");
+
+	T(R"(
+class O:
+	pass
+o = O()
+for i in range(100):
+	setattr(o, 'a' + str(i), i)
+o.a50 = -1
+print(o.a0, o.a50, o.a99, hasattr(O(), 'a0'))
+)"
+,
+"0 -1 99 False"
+);
+}
+
+void TestGenerationalGC() {
+	gcNurserySize = 16;
+
+	T(R"(
+x = []
+for i in range(2000):
+	x.append([str(i)])
+	if len(x) > 50:
+		x = x[25:]
+print(x[-1], len(x))
+)"
+,
+"['1999'] 50"
+);
+
+	T(R"(
+class Node:
+	def __init__(self, v):
+		self.v = v
+		self.next = None
+head = Node(0)
+for i in range(2000):
+	n = Node(str(i))
+	n.next = head.next
+	head.next = n
+	if i % 100 == 0:
+		head.next.next = None
+print(head.next.v, head.next.next.v)
+)"
+,
+"1999 1998"
+);
+
+	T(R"(
+def make():
+	d = {}
+	def put(k):
+		d[str(k)] = [k]
+		return d
+	return put
+put = make()
+for i in range(2000):
+	put(i)
+d = put(2000)
+print(len(d), d['1500'])
+)"
+,
+"2001 [1500]"
+);
+
+	T(R"(
+def make():
+	x = None
+	def put(v):
+		nonlocal x
+		x = v
+	def get():
+		return x
+	return (put, get)
+(put, get) = make()
+for i in range(2000):
+	put([str(i)])
+	junk = [str(j) for j in range(5)]
+print(get())
+)"
+,
+"['1999']"
+);
+
+	T(R"(
+def gen():
+	last = None
+	while True:
+		got = yield last
+		last = [got]
+		yield None
+g = gen()
+next(g)
+for i in range(2000):
+	g.send(str(i))
+	junk = [str(j) for j in range(5)]
+	r = next(g)
+print(r)
+)"
+,
+"['1999']"
+);
+
+	T(R"(
+d = {}
+s = set()
+for i in range(2000):
+	d.setdefault('a' + str(i % 50), []).append(str(i))
+	d.update([('b' + str(i % 7), [str(i)])])
+	s.update([str(i % 30)])
+	t = s.union([str(i)])
+print(len(d), d['a3'][-1], d['b4'], len(s), len(t))
+)"
+,
+"57 1953 ['1999'] 30 31"
+);
+
+	T(R"(
+x = []
+for i in range(300):
+	x.insert(0, str(i))
+	x.extend([str(i)])
+	x.sort(key=lambda s: len(s))
+print(len(x), x[0], x[-1])
+)"
+,
+"600 9 299"
+);
+
+	gcNurserySize = 0;
+}
+
+static void TestParallelGC() {
+	// A serial and a parallel collection of the same heap must keep the same objects
+	const char* build = R"(
+class Node:
+	def __init__(self, v, next):
+		self.v = v
+		self.next = next
+chain = None
+for i in range(20000):
+	chain = Node(i, chain)
+table = {}
+for i in range(20000):
+	table[str(i)] = [i, (i, str(i))]
+ring = [[] for i in range(1000)]
+for i in range(1000):
+	ring[i].append(ring[i - 1])
+garbage = [[i] for i in range(50000)]
+garbage = None
+)";
+	const char* check = R"(
+total = 0
+n = chain
+while n:
+	total += n.v
+	n = n.next
+print(total, len(table), table['19999'][1][1], ring[0][0] is ring[-1])
+)";
+
+	struct Finalized {
+		std::thread::id owner;
+		int count = 0;
+		bool onOwner = true;
+	} finalized;
+	finalized.owner = std::this_thread::get_id();
+
+	Wg_GCStats stats[2]{};
+	for (int gcThreads : { 0, 3 }) {
+		Wg_Config cfg{};
+		Wg_DefaultConfig(&cfg);
+		cfg.gcThreads = gcThreads;
+		output.clear();
+		cfg.print = [](const char* message, int len, void*) {
+			output += std::string(message, len);
+		};
+		Wg_Context* ctx = Wg_CreateContext(&cfg);
+
+		for (int i = 0; i < 100; i++) {
+			Wg_RegisterFinalizer(Wg_NewInt(ctx, 1000 + i), [](void* userdata) {
+				auto f = (Finalized*)userdata;
+				f->count++;
+				f->onOwner &= std::this_thread::get_id() == f->owner;
+				}, &finalized);
+		}
+
+		testsRun++;
+		bool printed = false;
+		if (Wg_Execute(ctx, build)) {
+			Wg_CollectGarbage(ctx);
+			Wg_GetGCStats(ctx, &stats[gcThreads ? 1 : 0]);
+			printed = Wg_Execute(ctx, check);
+		}
+		if (printed && output == "199990000 20000 19999 True\n") {
+			testsPassed++;
+		} else {
+			PrintFailure(check, __LINE__, Wg_GetErrorMessage(ctx));
+		}
+		Wg_DestroyContext(ctx);
+	}
+
+	testsRun++;
+	if (stats[0].objects == stats[1].objects && stats[0].objects > (int64_t)100'000
+		&& stats[0].bytes == stats[1].bytes
+		&& finalized.count == 200 && finalized.onOwner) {
+		testsPassed++;
+	} else {
+		PrintFailure("gcThreads", __LINE__, "The parallel collection kept different objects.");
+	}
+}
+
+static void TestMemoryAccounting() {
+	// Measure the heap of a fresh context to pick a limit above it
+	Wg_GCStats stats{};
+	{
+		auto context = CreateContext();
+		Wg_CollectGarbage(context.get());
+		Wg_GetGCStats(context.get(), &stats);
+	}
+
+	Wg_Config cfg{};
+	Wg_DefaultConfig(&cfg);
+	cfg.maxBytes = stats.bytes + 1'000'000;
+	output.clear();
+	cfg.print = [](const char* message, int len, void*) {
+		output += std::string(message, len);
+	};
+	Wg_Context* ctx = Wg_CreateContext(&cfg);
+
+	int callbacks = 0;
+	Wg_SetGCCallback(ctx, [](Wg_Context*, void* userdata) { (*(int*)userdata)++; }, &callbacks);
+	Wg_GetGCStats(ctx, &stats);
+	int64_t collections = stats.collections;
+
+	const char* code = R"(
+def fill(make):
+	x = []
+	try:
+		while True:
+			x.append(make())
+	except MemoryError:
+		x = None
+		return True
+big = []
+try:
+	big = 'a' * 10000000
+except MemoryError:
+	print('str')
+print(fill(lambda: 'abc' * 100), fill(lambda: [0] * 100), fill(lambda: bytes(100)))
+x = [[i] for i in range(1000)]
+)";
+	testsRun++;
+	if (!Wg_Execute(ctx, code) || output != "str\nTrue True True\n") {
+		PrintFailure(code, __LINE__, Wg_GetErrorMessage(ctx));
+	} else {
+		testsPassed++;
+	}
+
+	testsRun++;
+	Wg_CollectGarbage(ctx);
+	Wg_GetGCStats(ctx, &stats);
+	int64_t histogram[64]{};
+	int buckets = Wg_GetGCPauseHistogram(ctx, histogram, 64);
+	int64_t objects[WG_GC_TYPE_COUNT]{};
+	int64_t bytes[WG_GC_TYPE_COUNT]{};
+	int types = Wg_GetGCTypeStats(ctx, objects, bytes, WG_GC_TYPE_COUNT);
+	int64_t histogramTotal = 0, objectTotal = 0, byteTotal = 0;
+	for (int i = 0; i < buckets && i < 64; i++)
+		histogramTotal += histogram[i];
+	for (int i = 0; i < types; i++) {
+		objectTotal += objects[i];
+		byteTotal += bytes[i];
+	}
+	if (callbacks == stats.collections - collections
+		&& histogramTotal == stats.collections
+		&& stats.maxPauseNanoseconds <= stats.pauseNanoseconds
+		&& stats.bytesSinceCollection == 0
+		&& stats.bytes == stats.bytesAfterCollection
+		&& stats.bytesAllocated > stats.bytes
+		&& objectTotal == stats.objects
+		&& byteTotal == stats.bytes
+		&& objects[WG_GC_LIST] > 1000
+		&& objects[WG_GC_NONE] == 1) {
+		testsPassed++;
+	} else {
+		PrintFailure("Wg_GetGCStats()", __LINE__, "The GC statistics are inconsistent.");
+	}
+
+	// Userdata sizes count towards the limit
+	testsRun++;
+	Wg_Obj* obj = Wg_Call(Wg_GetGlobal(ctx, "object"), nullptr, 0);
+	bool fits = obj && Wg_SetUserdataSize(obj, 1000);
+	bool exceeds = obj && !Wg_SetUserdataSize(obj, cfg.maxBytes)
+		&& std::string(Wg_GetErrorMessage(ctx)).find("MemoryError") != std::string::npos;
+	Wg_ClearException(ctx);
+	if (fits && exceeds) {
+		testsPassed++;
+	} else {
+		PrintFailure("Wg_SetUserdataSize()", __LINE__, "The userdata size was not limited.");
+	}
+
+	Wg_DestroyContext(ctx);
+}
+
+// Checks that the optimizer removes the constant work from a function
+static void TestOptimizerDisassembly() {
+	auto context = CreateContext();
+	const char* code = R"(
+import dis
+def f(x):
+	if not x:
+		return [-(2 * 3), 'a' + 'bc', (1, 2.5)]
+	return 0
+	print('unreachable')
+dis.dis(f)
+)";
+
+	testsRun++;
+	if (!Wg_Execute(context.get(), code)) {
+		PrintFailure(code, __LINE__, Wg_GetErrorMessage(context.get()));
+		return;
+	}
+
+	bool folded = output.find("LOAD_CONST\t\t-6\n") != std::string::npos
+		&& output.find("LOAD_CONST\t\t\"abc\"\n") != std::string::npos
+		&& output.find("LOAD_CONST\t\t(1, 2.500000)\n") != std::string::npos
+		&& output.find("JUMP_IF_TRUE_POP") != std::string::npos;
+	bool removed = output.find("__neg__") == std::string::npos
+		&& output.find("print") == std::string::npos
+		&& output.find("JUMP_IF_FALSE_POP") == std::string::npos;
+	if (folded && removed) {
+		testsPassed++;
+	} else {
+		PrintFailure(code, __LINE__, output);
+	}
+}
+
+// Runs part of the suite again with the optimizer enabled
+void TestOptimizer() {
+	optimizationLevel = 1;
+
+	T(R"(
+x = 2 * 3 + 1
+s = 'ab' + 'cd' + 'e'
+t = (1, (2.5, 'x'), -4, ())
+print(x, s, t, 7 // 2, -7 % 3, 2 ** 10, 1 << 4, ~5, not 0, not '', 1 < 2.5, 1 == 1, 'a' < 'b', 5 / 2)
+print(1 == 1.0, 1.0 == 1, 2 ** -1, 7.5 // 2, -7.5 % 2, 3 <= 3.0, 3 > 2.5, 'b' >= 'a', 2 ** 62, -(-5), +3.5)
+)"
+,
+"7 abcde (1, (2.5, 'x'), -4, ()) 3 2 1024 16 -6 True True True True True 2.5\n"
+"False True 0 3.0 -1.5 False True True 4611686018427387904 5 3.5"
+);
+
+	T("print(9007199254740993 // 3, 7 // -2, 7 % -2, -7 % 2, (-9223372036854775807 - 1) // -1, 5 % -1)",
+		"3002399751580331 -4 -1 1 -9223372036854775808 0");
+
+	T(R"(
+def f(x):
+	while 1:
+		if not x:
+			break
+		x -= 1
+		if x == 2:
+			return x
+		continue
+		print('unreachable')
+	return -1
+def g():
+	try:
+		return 'try'
+		print('unreachable')
+	finally:
+		print('finally')
+print(f(5), f(0), g())
+)"
+,
+"finally\n2 -1 try"
+);
+
+	T(R"(
+'Documentation strings are dropped'
+x = 1 if 0 else 2
+y = 0 and 1 or 3
+if False:
+	print('never')
+else:
+	print(x, y, 9223372036854775807 + 0)
+)"
+,
+"2 3 9223372036854775807"
+);
+
+	F("x = 1 // 0");
+	F("x = 1 << -1");
+	F("x = 'a' + 1");
+
+	TestOptimizerDisassembly();
+	TestConditional();
+	TestWhile();
+	TestFor();
+	TestExceptions();
+	TestFunctions();
+	TestOperators();
+	TestSuperinstructions();
+	TestGenerators();
+
+	optimizationLevel = 0;
+}
+
+void TestSnapshots() {
+	S(R"(
+x = [1, 2]
+)"
+,
+R"(
+x.append(3)
+print(x, list(range(3)), sorted({3: 'a', 1: 'b'}.keys()))
+)"
+,
+"[1, 2, 3] [0, 1, 2] [1, 3]"
+);
+
+	S(R"(
+class Counter:
+	def __init__(self):
+		self.n = 0
+	def inc(self):
+		self.n += 1
+		return self.n
+c = Counter()
+c.inc()
+def make(k):
+	def get():
+		return k
+	return get
+getters = {(1, 'a'): make(1), None: make(None), c: make(2)}
+)"
+,
+R"(
+print(c.inc(), getters[(1, 'a')](), getters[None](), getters[c](), isinstance(c, Counter))
+)"
+,
+"2 1 None 2 True"
+);
+
+	S(R"(
+import math
+from random import randint
+)"
+,
+R"(
+print(math.floor(2.5), randint(3, 3))
+)"
+,
+"2 3"
+);
+
+	gcNurserySize = 8;
+	S(R"(
+d = {}
+for i in range(100):
+	d[str(i)] = [i]
+)"
+,
+R"(
+s = 0
+for i in range(1000):
+	d[str(i)] = [i]
+	s += d[str(i // 2)][0]
+print(len(d), s)
+)"
+,
+"1000 249500"
+);
+	gcNurserySize = 0;
+
+	S(R"(
+a = bytearray(b'abc')
+m = memoryview(a)[1:]
+b = b'xyz'[1:]
+)"
+,
+R"(
+m[0] = 66
+print(a, b, m.tobytes())
+)"
+,
+"bytearray(b'aBc') b'yz' b'Bc'"
+);
+
+	{
+		testsRun++;
+		auto context = CreateContext();
+		unsigned char data[] = { 1 };
+		Wg_SetGlobal(context.get(), "x", Wg_NewBufferView(context.get(), data, 1, false));
+		if (Wg_SnapshotContext(context.get()) == nullptr && Wg_GetException(context.get())) {
+			testsPassed++;
+		} else {
+			PrintFailure("", __LINE__, "Snapshot of a host buffer did not fail.");
+		}
+	}
+
+	{
+		testsRun++;
+		auto context = CreateContext();
+		Wg_Obj* obj = Wg_ExecuteExpression(context.get(), "[]");
+		Wg_SetGlobal(context.get(), "x", obj);
+		Wg_RegisterFinalizer(obj, [](void*) {}, nullptr);
+		if (Wg_SnapshotContext(context.get()) == nullptr && Wg_GetException(context.get())) {
+			testsPassed++;
+		} else {
+			PrintFailure("", __LINE__, "Snapshot of a host finalizer did not fail.");
+		}
+	}
+}
+
+// Runs code that is expected to be stopped by an execution limit
+static void ExpectLimitError(Wg_Context* context, const char* code, const char* expected, size_t line) {
+	testsRun++;
+	if (Wg_Execute(context, code)) {
+		PrintFailure(code, line, "Test did not fail as expected.");
+	} else if (std::string message = Wg_GetErrorMessage(context); message.find(expected) == std::string::npos) {
+		PrintFailure(code, line, expected, message);
+	} else {
+		testsPassed++;
+	}
+	Wg_ClearException(context);
+}
+
+void TestExecutionLimits() {
+	auto context = CreateContext();
+	Wg_Context* ctx = context.get();
+
+	Wg_SetInstructionBudget(ctx, 5000);
+	ExpectLimitError(ctx, "while True:\n\tpass", "WingsTimeoutError: Instruction budget exceeded", __LINE__);
+	ExpectLimitError(ctx, "x = 1", "WingsTimeoutError: Instruction budget exceeded", __LINE__);
+
+	Wg_SetInstructionBudget(ctx, 5000);
+	ExpectLimitError(ctx, "while True:\n\tcontinue", "WingsTimeoutError: Instruction budget exceeded", __LINE__);
+
+	Wg_SetInstructionBudget(ctx, 5000);
+	ExpectLimitError(ctx, "def f(x):\n\treturn x\nlist(map(f, range(100000)))", "WingsTimeoutError: Instruction budget exceeded", __LINE__);
+
+	Wg_SetInstructionBudget(ctx, 5000);
+	{
+		testsRun++;
+		if (Wg_Execute(ctx, "for i in range(1000):\n\tpass") && Wg_GetInstructionBudget(ctx) < 5000 - 1000) {
+			testsPassed++;
+		} else {
+			PrintFailure("", __LINE__, "Instruction budget was not used by a loop.");
+		}
+	}
+	Wg_SetInstructionBudget(ctx, -1);
+
+	Wg_SetTimeout(ctx, 10);
+	ExpectLimitError(ctx, "while True:\n\tpass", "WingsTimeoutError: Time exceeded 10ms", __LINE__);
+	Wg_ClearTimeout(ctx);
+
+	std::thread interrupter([ctx] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		Wg_Interrupt(ctx);
+	});
+	ExpectLimitError(ctx, "while True:\n\tpass", "WingsTimeoutError: Interrupted", __LINE__);
+	interrupter.join();
+
+	{
+		testsRun++;
+		if (Wg_Execute(ctx, "for i in range(10000):\n\tpass")) {
+			testsPassed++;
+		} else {
+			PrintFailure("", __LINE__, Wg_GetErrorMessage(ctx));
+		}
+	}
+}
+
+void TestProfiler() {
+	T(R"(
+import profile
+def f(n):
+	return [n]
+def g():
+	for i in range(10):
+		f(i)
+profile.start(0)
+g()
+profile.stop()
+g()
+entries = []
+for entry in profile.stats():
+	entries.append((entry[1], entry[2], entry[3] >= entry[4], entry[5] >= 10))
+print(sorted(entries), profile.lines(), profile.collapsed())
+)", "[('f', 10, True, True), ('g', 1, True, True)] [] ");
+
+	{
+		testsRun++;
+		auto context = CreateContext();
+		Wg_StartProfiler(context.get(), 100);
+		bool success = Wg_Execute(context.get(), R"(
+def spin():
+	i = 0
+	while i < 300000:
+		i += 1
+spin()
+)");
+		Wg_StopProfiler(context.get());
+
+		std::string report = Wg_GetProfileReport(context.get());
+		std::string stacks = Wg_GetProfileCollapsedStacks(context.get());
+		if (!success) {
+			PrintFailure("", __LINE__, Wg_GetErrorMessage(context.get()));
+		} else if (report.find("__main__.spin:") == std::string::npos || stacks.find(";__main__.spin ") == std::string::npos) {
+			PrintFailure("", __LINE__, "Samples of spin()", report + stacks);
+		} else {
+			testsPassed++;
+		}
+	}
+}
+
+// Waits for a job of a context pool and checks the repr of its result,
+// or that the error message contains the rest of expected if it begins with "!".
+static void ExpectFutureResult(Wg_Context* context, Wg_Future* future, const char* expected, size_t line) {
+	testsRun++;
+
+	std::string result;
+	if (Wg_Obj* obj = Wg_GetFutureResult(future, context)) {
+		result = Wg_GetString(Wg_UnaryOp(WG_UOP_REPR, obj));
+	} else {
+		result = std::string("!") + Wg_GetErrorMessage(context);
+		Wg_ClearException(context);
+	}
+	Wg_DestroyFuture(future);
+
+	bool passed = expected[0] == '!'
+		? result.find(expected + 1) != std::string::npos
+		: result == expected;
+	if (passed) {
+		testsPassed++;
+	} else {
+		PrintFailure("", line, expected, result);
+	}
+}
+
+void TestContextPool() {
+	auto context = CreateContext();
+	Wg_Execute(context.get(), R"(
+def square(x):
+	return x * x
+def summarize(values):
+	return {'sum': sum(values), 'count': len(values), 'items': tuple(values)}
+)");
+	Wg_Snapshot* snapshot = Wg_SnapshotContext(context.get());
+	Wg_ContextPool* pool = Wg_CreateContextPool(nullptr, snapshot, 4);
+
+	{
+		testsRun++;
+		std::vector<Wg_Future*> futures;
+		for (int i = 0; i < 100; i++) {
+			Wg_Obj* arg = Wg_NewInt(context.get(), i);
+			futures.push_back(Wg_SubmitCall(pool, "square", &arg, 1));
+		}
+
+		Wg_int sum = 0;
+		for (Wg_Future* future : futures) {
+			if (Wg_Obj* result = Wg_GetFutureResult(future, context.get()))
+				sum += Wg_GetInt(result);
+			Wg_DestroyFuture(future);
+		}
+
+		if (sum == 328350) {
+			testsPassed++;
+		} else {
+			PrintFailure("", __LINE__, "328350", std::to_string(sum));
+		}
+	}
+
+	Wg_Obj* values = Wg_ExecuteExpression(context.get(), "[1, 2.5, 3]");
+	ExpectFutureResult(context.get(), Wg_SubmitCall(pool, "summarize", &values, 1),
+		"{'sum': 6.5, 'count': 3, 'items': (1, 2.5, 3)}", __LINE__);
+	ExpectFutureResult(context.get(), Wg_SubmitExecuteExpression(pool, "[None, 'a', {2}, ()]"),
+		"[None, 'a', {2}, ()]", __LINE__);
+	ExpectFutureResult(context.get(), Wg_SubmitExecute(pool, "x = 1"), "None", __LINE__);
+	ExpectFutureResult(context.get(), Wg_SubmitExecuteExpression(pool, "1 // 0"), "!ZeroDivisionError", __LINE__);
+	ExpectFutureResult(context.get(), Wg_SubmitExecuteExpression(pool, "object()"), "!TypeError: cannot marshal 'object' object", __LINE__);
+	ExpectFutureResult(context.get(), Wg_SubmitCall(pool, "missing", nullptr, 0), "!NameError", __LINE__);
+
+	{
+		testsRun++;
+		Wg_Obj* recursive = Wg_ExecuteExpression(context.get(), "[]");
+		Wg_IncRef(recursive);
+		Wg_CallMethod(recursive, "append", &recursive, 1);
+		if (Wg_SubmitCall(pool, "square", &recursive, 1) == nullptr && Wg_GetException(context.get())) {
+			testsPassed++;
+		} else {
+			PrintFailure("", __LINE__, "Marshalling a recursive list did not fail.");
+		}
+		Wg_ClearException(context.get());
+		Wg_DecRef(recursive);
+	}
+
+	Wg_DestroyContextPool(pool);
+	Wg_DestroySnapshot(snapshot);
+}
+
 namespace wings {
 	int RunTests() {
 		TestPrint();
 		TestConditional();
 		TestWhile();
+		TestFor();
 		TestExceptions();
+		TestTracebacks();
+		TestCompileBuffer();
+		TestPrograms();
 		TestStringMethods();
+		TestStringBuilding();
+		TestBuffers();
+		TestFiles();
+		TestBytecodeCache();
+		TestArrays();
+		TestJson();
+		TestBuiltinFunctions();
 		TestSlices();
+		TestFunctions();
+		TestGlobalCaches();
+		TestGenerators();
+		TestCallVector();
+		TestSuspension();
+		TestBulkMarshalling();
+		TestOperators();
+		TestSuperinstructions();
+		TestAttributes();
+		TestGenerationalGC();
+		TestParallelGC();
+		TestMemoryAccounting();
+		TestOptimizer();
+		TestSnapshots();
+		TestExecutionLimits();
+		TestProfiler();
+		TestContextPool();
 
 		std::cout << testsPassed << "/" << testsRun << " tests passed." << std::endl << std::endl;
 		return (int)(testsPassed < testsRun);
@@ -1,15 +1,23 @@
 #include "wings.h"
 #include "common.h"
 #include "executor.h"
+#include "serialize.h"
+#include "snapshot.h"
+#include "profiler.h"
+#include "parallelgc.h"
 
+#include "arraymodule.h"
 #include "builtinsmodule.h"
 #include "dismodule.h"
+#include "jsonmodule.h"
 #include "mathmodule.h"
 #include "osmodule.h"
+#include "profilemodule.h"
 #include "randommodule.h"
 #include "sysmodule.h"
 #include "timemodule.h"
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <fstream>
@@ -18,13 +26,15 @@
 #include <string_view>
 #include <sstream>
 #include <queue>
-#include <unordered_set>
 #include <cstring>
 #include <chrono>
+#include <filesystem>
 
 namespace wings {
-	static bool ReadFromFile(const std::string& path, std::string& data) {
-		std::ifstream f(path);
+	static constexpr const char* BYTECODE_CACHE_DIR = "__wgcache__";
+
+	static bool ReadFromFile(const std::string& path, std::string& data, std::ios::openmode mode = std::ios::in) {
+		std::ifstream f(path, mode);
 		if (!f.is_open())
 			return false;
 
@@ -38,6 +48,46 @@ namespace wings {
 		return true;
 	}
 
+	static bool WriteToFile(const std::string& path, const std::string& data) {
+		std::ofstream f(path, std::ios::binary);
+		if (!f.is_open())
+			return false;
+
+		f.write(data.data(), (std::streamsize)data.size());
+		return (bool)f;
+	}
+
+	// Loads the cached bytecode of a file module, or compiles it and updates the cache.
+	// Failing to read or write the cache is not an error since it can always be rebuilt.
+	static RcPtr<Bytecode> LoadCachedModule(Wg_Context* context, const std::string& module, const RcPtr<SourceText>& source) {
+		namespace fs = std::filesystem;
+		std::string cacheDir = context->importPath + BYTECODE_CACHE_DIR;
+		std::string cachePath = cacheDir + "/" + module + ".wgc";
+		uint64_t sourceHash = HashSource(source->text, context->config.optimizationLevel);
+
+		std::string cached;
+		if (ReadFromFile(cachePath, cached, std::ios::in | std::ios::binary)) {
+			if (auto code = DeserializeBytecode(cached, sourceHash))
+				return code;
+		}
+
+		auto code = CompileSource(context, source, module.c_str(), module.c_str(), false);
+		if (code == nullptr)
+			return nullptr;
+
+		// Write to a temporary file first so that other processes never see a partial cache
+		std::error_code ec;
+		fs::create_directories(cacheDir, ec);
+		std::string tempPath = cachePath + "." + std::to_string(Guid()) + ".tmp";
+		bool written = WriteToFile(tempPath, SerializeBytecode(*code, sourceHash));
+		if (written)
+			fs::rename(tempPath, cachePath, ec);
+		if (!written || ec)
+			fs::remove(tempPath, ec);
+
+		return code;
+	}
+
 	static bool LoadFileModule(Wg_Context* context, const std::string& module) {
 		std::string path = context->importPath + module + ".py";
 		std::string source;
@@ -47,13 +97,215 @@ namespace wings {
 			return false;
 		}
 
-		Wg_Obj* fn = Compile(context, source.c_str(), module.c_str(), module.c_str(), false);
+		Wg_Obj* fn{};
+		if (context->config.enableBytecodeCache) {
+			auto text = MakeRcPtr<SourceText>(source);
+			auto code = LoadCachedModule(context, module, text);
+			if (code == nullptr)
+				return false;
+			fn = NewCodeFunction(context, std::move(code), std::move(text), module.c_str(), module.c_str());
+		} else {
+			fn = Compile(context, source, module.c_str(), module.c_str(), false);
+		}
 		if (fn == nullptr)
 			return false;
 
 		return Wg_Call(fn, nullptr, 0) != nullptr;
 	}
 
+	// Create an int, float or str directly instead of calling the class constructor
+	template <class T>
+	static Wg_Obj* NewPrimitive(Wg_Context* context, Wg_Obj* klass, ObjType type, T value) {
+		if constexpr (std::is_same_v<T, std::string>) {
+			if (!ChargeBytes(context, value.size()))
+				return nullptr;
+		}
+
+		Wg_Obj* obj = Alloc(context);
+		if (obj == nullptr)
+			return nullptr;
+
+		obj->attributes = klass->Get<Wg_Obj::Class>().instanceAttributes.Copy();
+		obj->type = type;
+		obj->EmplaceInline<T>(std::move(value));
+		return obj;
+	}
+
+	Wg_Obj* InternString(Wg_Context* context, std::string_view value) {
+		auto it = context->internedStrings.find(value);
+		if (it != context->internedStrings.end())
+			return it->second;
+
+		Wg_Obj* obj = NewPrimitive(context, context->builtins.str, ObjType::Str, std::string(value));
+		if (obj == nullptr)
+			return nullptr;
+
+		std::string_view key = obj->Get<std::string>();
+		obj->interned = true;
+		obj->cachedHash = (size_t)(Wg_int)std::hash<std::string_view>()(key);
+		obj->hasCachedHash = true;
+		context->internedStrings.insert({ key, obj });
+		return obj;
+	}
+
+	Wg_Obj* ConcatStrings(Wg_Context* context, const Wg_Obj* lhs, std::string_view rhs) {
+		std::string_view l = GetStringView(lhs);
+		size_t size = l.size() + rhs.size();
+		if (size < MIN_STR_BUFFER_SIZE) {
+			std::string s;
+			s.reserve(size);
+			s += l;
+			s += rhs;
+			return NewPrimitive(context, context->builtins.str, ObjType::Str, std::move(s));
+		}
+
+		// Append in place if nothing else has been appended after the left operand
+		RcPtr<StrBuffer> buffer;
+		if (lhs->HoldsInline<StrSlice>()) {
+			const auto& slice = lhs->Get<StrSlice>();
+			const auto& shared = slice.buffer;
+			if (slice.length == shared->size && !shared->sealed && size <= shared->capacity)
+				buffer = shared;
+		}
+
+		// Only the appended characters are new if the buffer is reused
+		if (!ChargeBytes(context, buffer ? rhs.size() : size))
+			return nullptr;
+
+		if (buffer == nullptr) {
+			buffer = MakeRcPtr<StrBuffer>();
+			buffer->capacity = size * 2;
+			buffer->data = std::make_unique<char[]>(buffer->capacity + 1);
+			std::memcpy(buffer->data.get(), l.data(), l.size());
+			buffer->size = l.size();
+		}
+
+		// The right operand may be in the same buffer, but only before the end
+		std::memcpy(buffer->data.get() + buffer->size, rhs.data(), rhs.size());
+		buffer->size = size;
+		buffer->data[size] = '\0';
+		return NewPrimitive(context, context->builtins.str, ObjType::Str, StrSlice(std::move(buffer), size));
+	}
+
+	static Wg_Obj* NewItem(Wg_Context* context, Wg_int value) { return Wg_NewInt(context, value); }
+	static Wg_Obj* NewItem(Wg_Context* context, Wg_float value) { return Wg_NewFloat(context, value); }
+	static Wg_Obj* NewItem(Wg_Context* context, const char* value) { return Wg_NewString(context, value); }
+
+	// Creates a list or tuple from an array of host values
+	template <class T>
+	static Wg_Obj* NewSequenceFrom(Wg_Context* context, Wg_Obj* klass, const T* values, int len) {
+		WG_ASSERT(context && len >= 0 && (values || len == 0));
+		Wg_Obj* seq = Wg_Call(klass, nullptr, 0);
+		if (seq == nullptr)
+			return nullptr;
+		Wg_ObjRef ref(seq);
+		if (!ChargeBytes(context, (size_t)len * sizeof(Wg_Obj*)))
+			return nullptr;
+
+		auto& buf = seq->Get<std::vector<Wg_Obj*>>();
+		buf.reserve((size_t)len);
+		for (int i = 0; i < len; i++) {
+			Wg_Obj* item = NewItem(context, values[i]);
+			if (item == nullptr)
+				return nullptr;
+			buf.push_back(item);
+			// The sequence may have been promoted while allocating the item
+			WriteBarrier(seq);
+		}
+		return seq;
+	}
+
+	template <class T>
+	static Wg_Obj* NewDictionaryFrom(Wg_Context* context, const char* const* keys, const T* values, int len) {
+		WG_ASSERT(context && len >= 0 && ((keys && values) || len == 0));
+		Wg_Obj* dict = Wg_NewDictionary(context);
+		if (dict == nullptr)
+			return nullptr;
+		Wg_ObjRef ref(dict);
+
+		for (int i = 0; i < len; i++) {
+			WG_ASSERT(keys[i]);
+			Wg_Obj* value = NewItem(context, values[i]);
+			if (value == nullptr)
+				return nullptr;
+			Wg_ObjRef valueRef(value);
+			Wg_Obj* key = Wg_NewString(context, keys[i]);
+			if (key == nullptr || !ChargeBytes(context, WDict::ITEM_BYTES))
+				return nullptr;
+			WriteBarrier(dict);
+			dict->Get<WDict>()[key] = value;
+		}
+		return dict;
+	}
+
+	static bool GetItem(const Wg_Obj* obj, Wg_int& out) {
+		if (!Wg_IsInt(obj))
+			return false;
+		out = Wg_GetInt(obj);
+		return true;
+	}
+
+	static bool GetItem(const Wg_Obj* obj, Wg_float& out) {
+		if (!Wg_IsIntOrFloat(obj))
+			return false;
+		out = Wg_GetFloat(obj);
+		return true;
+	}
+
+	static bool GetItem(const Wg_Obj* obj, const char*& out) {
+		if (!Wg_IsString(obj))
+			return false;
+		out = Wg_GetString(obj);
+		return true;
+	}
+
+	// Copies the items of an iterable into an array of host values
+	template <class T>
+	static int GetItems(Wg_Obj* obj, T* values, int len, const char* expected) {
+		WG_ASSERT(obj && len >= 0 && (values || len == 0));
+		Wg_Context* context = obj->context;
+		auto raise = [&] {
+			std::string msg = std::string("Expected an iterable of ") + expected;
+			Wg_RaiseException(context, WG_EXC_TYPEERROR, msg.c_str());
+			return -1;
+		};
+
+		if (Wg_IsList(obj) || Wg_IsTuple(obj)) {
+			const auto& buf = obj->Get<std::vector<Wg_Obj*>>();
+			for (size_t i = 0; i < buf.size(); i++) {
+				T item{};
+				if (!GetItem(buf[i], item))
+					return raise();
+				if (i < (size_t)len)
+					values[i] = item;
+			}
+			return (int)buf.size();
+		}
+
+		struct State {
+			T* values;
+			int len;
+			int count;
+			bool typeError;
+		} state = { values, len, 0, false };
+
+		bool success = Wg_Iterate(obj, &state, [](Wg_Obj* yielded, void* userdata) {
+			State& state = *(State*)userdata;
+			T item{};
+			if (!GetItem(yielded, item)) {
+				state.typeError = true;
+				return false;
+			}
+			if (state.count < state.len)
+				state.values[state.count] = item;
+			state.count++;
+			return true;
+			});
+		if (state.typeError)
+			return raise();
+		return success ? state.count : -1;
+	}
+
 	static bool LoadModule(Wg_Context* context, const std::string& name) {
 		if (!context->globals.contains(name)) {
 			bool success{};
@@ -78,18 +330,486 @@ namespace wings {
 		}
 		return true;
 	}
+	static void GatherRoots(Wg_Context* context, std::vector<const Wg_Obj*>& inUse, bool nurseryOnly) {
+		if (context->currentException)
+			inUse.push_back(context->currentException);
+		// Keep the functions of the last traceback alive since it refers to their strings
+		for (const auto& frame : context->exceptionTrace)
+			if (frame.function)
+				inUse.push_back(frame.function);
+		// Promoted objects are never freed by a nursery collection
+		// so only the young objects need to be checked for references.
+		size_t first = nurseryOnly ? context->promotedCount : 0;
+		for (size_t i = first; i < context->mem.size(); i++)
+			if (context->mem[i]->refCount)
+				inUse.push_back(context->mem[i]);
+		for (auto& [_, globals] : context->globals)
+			for (auto& var : globals)
+				inUse.push_back(*var.second);
+		for (const auto& kwargs : context->kwargs)
+			if (kwargs.dict)
+				inUse.push_back(kwargs.dict);
+		context->argumentStack.ForEach([&](Wg_Obj* obj) { inUse.push_back(obj); });
+		for (Wg_Obj** obj : context->builtins.GetAll())
+			if (*obj)
+				inUse.push_back(*obj);
+		for (Wg_Obj* obj : context->builtins.smallInts)
+			if (obj)
+				inUse.push_back(obj);
+		for (const auto& executor : context->executors)
+			executor->GetReferences(inUse);
+		for (const auto& frame : context->suspendedFrames) {
+			inUse.push_back(frame.function);
+			frame.executor->GetReferences(inUse);
+		}
+	}
+
+	static void PushChildren(const Wg_Obj* obj, std::vector<const Wg_Obj*>& inUse) {
+		if (Wg_IsTuple(obj) || Wg_IsList(obj)) {
+			inUse.insert(
+				inUse.end(),
+				obj->Get<std::vector<Wg_Obj*>>().begin(),
+				obj->Get<std::vector<Wg_Obj*>>().end()
+			);
+		} else if (Wg_IsDictionary(obj)) {
+			for (const auto& [key, value] : obj->Get<wings::WDict>()) {
+				inUse.push_back(key);
+				inUse.push_back(value);
+			}
+		} else if (Wg_IsSet(obj)) {
+			for (Wg_Obj* value : obj->Get<wings::WSet>()) {
+				inUse.push_back(value);
+			}
+		} else if (Wg_IsFunction(obj)) {
+			const auto& fn = obj->Get<Wg_Obj::Func>();
+			if (fn.self) {
+				inUse.push_back(fn.self);
+			}
+			if (fn.fptr == &wings::DefObject::Run) {
+				auto* def = (wings::DefObject*)fn.userdata;
+				for (const auto& capture : def->captures)
+					inUse.push_back(*capture);
+				for (const auto& arg : def->defaultParameterValues)
+					inUse.push_back(arg);
+			}
+		} else if (obj->type == wings::ObjType::ForIter) {
+			const auto& it = obj->Get<wings::ForLoopIterator>();
+			if (it.kind != wings::ForLoopIterator::Kind::Range)
+				inUse.push_back(it.sequence.obj);
+		} else if (obj->type == wings::ObjType::Generator) {
+			const auto& gen = *(const wings::Generator*)obj->data;
+			inUse.push_back(gen.function);
+			gen.executor.GetReferences(inUse);
+		} else if (Wg_IsClass(obj)) {
+			inUse.insert(
+				inUse.end(),
+				obj->Get<Wg_Obj::Class>().bases.begin(),
+				obj->Get<Wg_Obj::Class>().bases.end()
+			);
+			obj->Get<Wg_Obj::Class>().instanceAttributes.ForEach([&](auto& entry) {
+				inUse.push_back(entry);
+				});
+		}
+
+		obj->attributes.ForEach([&](auto& entry) {
+			inUse.push_back(entry);
+			});
+	}
+
+	static void MarkReachable(std::vector<const Wg_Obj*>& inUse, bool nurseryOnly) {
+		while (inUse.size()) {
+			auto obj = inUse.back();
+			inUse.pop_back();
+			if (nurseryOnly && obj->promoted)
+				continue;
+			if (!obj->marked) {
+				obj->marked = true;
+				PushChildren(obj, inUse);
+			}
+		}
+	}
+
+	void Promote(Wg_Context* context, size_t first) {
+		for (size_t i = first; i < context->mem.size(); i++)
+			context->mem[i]->promoted = true;
+		context->promotedCount = context->mem.size();
+	}
+
+	static void ClearRememberedSet(Wg_Context* context) {
+		for (Wg_Obj* obj : context->rememberedSet)
+			obj->remembered = false;
+		context->rememberedSet.clear();
+	}
+
+	// Returns the number of bytes freed
+	static size_t FreeUnreachable(Wg_Context* context, size_t first) {
+		auto& mem = context->mem;
+		size_t freedBytes = 0;
+
+		// Call finalizers
+		for (size_t i = first; i < mem.size(); i++) {
+			if (!mem[i]->marked) {
+				freedBytes += ObjectBytes(mem[i]);
+				for (const auto& finalizer : mem[i]->finalizers)
+					finalizer.first(finalizer.second);
+				if (mem[i]->interned)
+					context->internedStrings.erase(mem[i]->Get<std::string>());
+				mem[i]->DestroyInline();
+			}
+		}
+
+		// Remove unused objects. The removal is stable so
+		// promoted objects stay at the front of the list.
+		size_t kept = first;
+		for (size_t i = first; i < mem.size(); i++) {
+			if (mem[i]->marked) {
+				mem[i]->marked = false;
+				mem[kept++] = mem[i];
+			} else {
+				context->pool.Free(mem[i]);
+			}
+		}
+		mem.resize(kept);
+		return freedBytes;
+	}
+
+	static GCWorkers& GetGCWorkers(Wg_Context* context) {
+		if (context->gcWorkers == nullptr)
+			context->gcWorkers = new GCWorkers(context->config.gcThreads);
+		return *context->gcWorkers;
+	}
+
+	// The same as MarkReachable() for a full collection, but the objects are
+	// split between the workers, which steal from each other once they run out.
+	static void MarkReachableParallel(Wg_Context* context, const std::vector<const Wg_Obj*>& roots) {
+		GCWorkers& workers = GetGCWorkers(context);
+		size_t count = workers.Count();
+		MarkStacks stacks(count);
+		workers.Run([&](size_t worker) {
+			std::vector<const Wg_Obj*> stack(
+				roots.begin() + roots.size() * worker / count,
+				roots.begin() + roots.size() * (worker + 1) / count
+			);
+			do {
+				while (stack.size()) {
+					const Wg_Obj* obj = stack.back();
+					stack.pop_back();
+					std::atomic_ref<bool> marked(obj->marked);
+					if (marked.load(std::memory_order_relaxed) || marked.exchange(true, std::memory_order_relaxed))
+						continue;
+					PushChildren(obj, stack);
+					stacks.Share(worker, stack);
+				}
+			} while (stacks.Refill(worker, stack));
+			});
+	}
+
+	// The data of these objects can be destroyed on any thread
+	static bool IsPlainData(const Wg_Obj* obj) {
+		return obj->finalizers.empty() && !obj->interned
+			&& (obj->HoldsInline<std::string>() || obj->HoldsInline<std::vector<Wg_Obj*>>()
+				|| obj->HoldsInline<Wg_int>() || obj->HoldsInline<Wg_float>());
+	}
+
+	// The same as FreeUnreachable() for a full collection, but the workers scan
+	// and compact a range of the objects each. Anything that can reach other
+	// objects or the context, such as finalizers, the intern table and the
+	// object pool, is left to the owning thread. Returns the bytes still in use.
+	static size_t FreeUnreachableParallel(Wg_Context* context) {
+		struct Range {
+			size_t begin;
+			size_t end;
+			size_t kept = 0;
+			size_t keptBytes = 0;
+			std::vector<Wg_Obj*> unreachable;
+		};
+
+		auto& mem = context->mem;
+		GCWorkers& workers = GetGCWorkers(context);
+		size_t count = workers.Count();
+		std::vector<Range> ranges(count);
+		for (size_t i = 0; i < count; i++) {
+			ranges[i].begin = mem.size() * i / count;
+			ranges[i].end = mem.size() * (i + 1) / count;
+		}
+
+		workers.Run([&](size_t worker) {
+			Range& range = ranges[worker];
+			for (size_t i = range.begin; i < range.end; i++) {
+				Wg_Obj* obj = mem[i];
+				if (obj->marked) {
+					range.kept++;
+				} else {
+					if (IsPlainData(obj))
+						obj->DestroyInline();
+					range.unreachable.push_back(obj);
+				}
+			}
+			});
+
+		// Call finalizers
+		for (const Range& range : ranges) {
+			for (Wg_Obj* obj : range.unreachable) {
+				for (const auto& finalizer : obj->finalizers)
+					finalizer.first(finalizer.second);
+				if (obj->interned)
+					context->internedStrings.erase(obj->Get<std::string>());
+				obj->DestroyInline();
+			}
+		}
+
+		// Move the survivors into place, keeping their order
+		std::vector<Wg_Obj*> survivors;
+		size_t offset = 0;
+		std::vector<size_t> offsets(count);
+		for (size_t i = 0; i < count; i++) {
+			offsets[i] = offset;
+			offset += ranges[i].kept;
+		}
+		survivors.resize(offset);
+
+		workers.Run([&](size_t worker) {
+			Range& range = ranges[worker];
+			Wg_Obj** out = survivors.data() + offsets[worker];
+			for (size_t i = range.begin; i < range.end; i++) {
+				Wg_Obj* obj = mem[i];
+				if (obj->marked) {
+					obj->marked = false;
+					range.keptBytes += ObjectBytes(obj);
+					*out++ = obj;
+				}
+			}
+			});
+
+		size_t bytes = 0;
+		for (const Range& range : ranges) {
+			bytes += range.keptBytes;
+			for (Wg_Obj* obj : range.unreachable)
+				context->pool.Free(obj);
+		}
+		mem.swap(survivors);
+		return bytes;
+	}
+
+	static Wg_Obj* DuplicateMethod(Wg_Obj* method, Wg_Obj* self) {
+		const auto& func = method->Get<Wg_Obj::Func>();
+		if (func.self == self) {
+			return method;
+		}
+		
+		wings::Wg_ObjRef ref(method);
+		wings::Wg_ObjRef ref2(self);
+		
+		Wg_Obj* dup = Wg_NewFunction(
+			method->context,
+			func.fptr,
+			func.userdata,
+			func.prettyName.c_str());
+		if (dup) {
+			dup->Get<Wg_Obj::Func>().self = self;
+			dup->Get<Wg_Obj::Func>().module = func.module;
+		}
+		
+		return dup;
+	}
+
+	static Wg_Obj* BindAttribute(Wg_Obj* obj, Wg_Obj* mem, const char* attribute) {
+		if (mem == nullptr) {
+			Wg_RaiseAttributeError(obj, attribute);
+		} else if (Wg_IsFunction(mem) && mem->Get<Wg_Obj::Func>().isMethod) {
+			return DuplicateMethod(mem, obj);
+		}
+		return mem;
+	}
+
+	Wg_Obj* GetAttribute(Wg_Obj* obj, const std::string& attribute, AttributeTable::InlineCache& cache) {
+		return BindAttribute(obj, obj->attributes.Get(attribute, cache), attribute.c_str());
+	}
+
+	void SetAttribute(Wg_Obj* obj, const std::string& attribute, Wg_Obj* value, AttributeTable::InlineCache& cache) {
+		WriteBarrier(obj);
+		obj->attributes.Set(attribute, value, cache);
+	}
+
+	// Keyword arguments are passed either as a dictionary or as names whose values follow argv.
+	// fromScript is set for calls that can be suspended if their caller can be.
+	static Wg_Obj* Invoke(Wg_Obj* callable, Wg_Obj* self, Wg_Obj** argv, int argc, Wg_Obj* kwargsDict, Wg_Obj** kwnames, int kwargc, bool fromScript = false) {
+		Wg_Context* context = callable->context;
+		
+		if (!Tick(context)) {
+			return nullptr;
+		}
+		
+		// Check recursion limit. Calls through native code use the host stack so they are limited further.
+		if (context->currentTrace.size() >= (size_t)context->config.maxRecursion
+			|| context->kwargs.size() >= MAX_NATIVE_RECURSION) {
+			Wg_RaiseException(context, WG_EXC_RECURSIONERROR);
+			return nullptr;
+		}
+
+		// Call the __call__ method if object is neither a function nor a class
+		if (!Wg_IsFunction(callable) && !Wg_IsClass(callable)) {
+			if (kwargc) {
+				kwargsDict = Wg_NewDictionary(context, kwnames, argv + argc, kwargc);
+				if (kwargsDict == nullptr)
+					return nullptr;
+			}
+			return CallMethod(callable, "__call__", argv, argc, kwargsDict);
+		}
+
+		// Validate keyword arguments
+		if (kwargsDict) {
+			if (!Wg_IsDictionary(kwargsDict)) {
+				Wg_RaiseException(context, WG_EXC_TYPEERROR, "Keyword arguments must be a dictionary");
+				return nullptr;
+			}
+			for (const auto& [key, value] : kwargsDict->Get<wings::WDict>()) {
+				if (!Wg_IsString(key)) {
+					Wg_RaiseException(context, WG_EXC_TYPEERROR, "Keyword arguments dictionary must only contain string keys");
+					return nullptr;
+				}
+			}
+		}
+
+		// Get the raw function pointer, userdata, module, and self
+		// depending on whether the callable is a function or class.
+		Wg_Obj* (*fptr)(Wg_Context*, Wg_Obj**, int);
+		void* userdata = nullptr;
+		std::string_view module;
+		if (Wg_IsFunction(callable)) {
+			const auto& func = callable->Get<Wg_Obj::Func>();
+			if (self == nullptr)
+				self = func.self;
+			fptr = func.fptr;
+			userdata = func.userdata;
+			module = func.module;
+		} else {
+			const auto& klass = callable->Get<Wg_Obj::Class>();
+			fptr = klass.ctor;
+			userdata = klass.userdata;
+			module = klass.module;
+		}
+
+		// Copy the arguments onto the argument stack, which also keeps them alive.
+		// The layout is the callable, self if there is one, the positional
+		// arguments, the keyword argument values, then the keyword names.
+		auto mark = context->argumentStack.GetMark();
+		int totalArgc = argc + (self ? 1 : 0);
+		Wg_Obj** values = context->argumentStack.Push(1 + (size_t)totalArgc + 2 * (size_t)kwargc);
+		values[0] = callable;
+		Wg_Obj** contiguousArgs = values + 1;
+		if (self)
+			contiguousArgs[0] = self;
+		std::copy(argv, argv + argc + kwargc, contiguousArgs + (self ? 1 : 0));
+		Wg_Obj** names = contiguousArgs + totalArgc + kwargc;
+		std::copy(kwnames, kwnames + kwargc, names);
+
+		// Push various data onto stacks
+		context->currentModule.push(module);
+		context->userdata.push_back(userdata);
+		context->kwargs.push_back({ kwargsDict, names, contiguousArgs + totalArgc, kwargc });
+		if (Wg_IsFunction(callable)) {
+			const auto& func = callable->Get<Wg_Obj::Func>();
+			bool suspendable = fromScript
+				&& (context->currentTrace.empty() || context->currentTrace.back().suspendable);
+			context->currentTrace.push_back(wings::TraceFrame{
+				{},
+				"",
+				func.module,
+				func.prettyName,
+				false,
+				callable,
+				suspendable
+				});
+		}
+		
+		// Perform the call
+		Wg_Obj* ret = nullptr;
+		try {
+			ret = fptr(context, contiguousArgs, totalArgc);
+		} catch (std::bad_alloc&) {
+			Wg_RaiseException(context, WG_EXC_MEMORYERROR);
+		}
+		
+		// Pop the data off the stacks
+		context->currentModule.pop();
+		context->userdata.pop_back();
+		context->kwargs.pop_back();
+		if (Wg_IsFunction(callable)) {
+			context->currentTrace.pop_back();
+		}
+		context->argumentStack.Pop(mark);
+
+		return ret;
+	}
+
+	Wg_Obj* CallWithSelf(Wg_Obj* callable, Wg_Obj* self, Wg_Obj** argv, int argc, Wg_Obj* kwargsDict) {
+		return Invoke(callable, self, argv, argc, kwargsDict, nullptr, 0);
+	}
+
+	Wg_Obj* CallVector(Wg_Obj* callable, Wg_Obj* self, Wg_Obj** argv, int argc, Wg_Obj** kwnames, int kwargc) {
+		return Invoke(callable, self, argv, argc, nullptr, kwnames, kwargc);
+	}
+
+	Wg_Obj* CallFromScript(Wg_Obj* callable, Wg_Obj* self, Wg_Obj** argv, int argc, Wg_Obj** kwnames, int kwargc) {
+		return Invoke(callable, self, argv, argc, nullptr, kwnames, kwargc, true);
+	}
+
+	Wg_Obj* CallMethod(Wg_Obj* obj, const char* member, Wg_Obj** argv, int argc, Wg_Obj* kwargsDict) {
+		Wg_Obj* method = obj->attributes.Get(member);
+		if (method == nullptr) {
+			Wg_RaiseAttributeError(obj, member);
+			return nullptr;
+		} else if (Wg_IsFunction(method) && method->Get<Wg_Obj::Func>().isMethod) {
+			return CallWithSelf(method, obj, argv, argc, kwargsDict);
+		} else {
+			return Wg_Call(method, argv, argc, kwargsDict);
+		}
+	}
+
+	void CollectNursery(Wg_Context* context) {
+		GCPauseTimer timer(context, true);
+		std::vector<const Wg_Obj*> inUse;
+		GatherRoots(context, inUse, true);
+		// Young objects in the remembered set were stored in a cell
+		for (const Wg_Obj* obj : context->rememberedSet) {
+			if (obj->promoted) {
+				PushChildren(obj, inUse);
+			} else {
+				inUse.push_back(obj);
+			}
+		}
+
+		MarkReachable(inUse, true);
+
+		// Young objects were all charged since the last full collection
+		size_t first = context->promotedCount;
+		size_t freed = FreeUnreachable(context, first);
+		auto& stats = context->gcStats;
+		stats.bytesSinceCollection -= std::min(freed, stats.bytesSinceCollection);
+
+		// Every survivor is promoted so no old object points at a young one
+		Promote(context, first);
+		ClearRememberedSet(context);
+	}
 }
 
 extern "C" {
 	void Wg_DefaultConfig(Wg_Config* config) {
 		WG_ASSERT_VOID(config);
 		config->maxAlloc = 1'000'000;
-		config->maxRecursion = 50;
+		config->maxBytes = 0;
+		config->maxRecursion = 1000;
 		config->gcRunFactor = 20.0f;
+		config->gcNurserySize = 0;
+		config->gcThreads = 0;
 		config->printUserdata = nullptr;
 		config->argv = nullptr;
 		config->argc = 0;
 		config->enableOSAccess = false;
+		config->enableBytecodeCache = false;
+		config->optimizationLevel = 0;
+		config->importPath = nullptr;
 		config->print = [](const char* message, int len, void*) {
 			std::cout << std::string_view(message, (size_t)len);
 		};
@@ -102,8 +822,11 @@ extern "C" {
 		context->globals.insert({ std::string("__main__"), {} });
 
 		Wg_RegisterModule(context, "__builtins__", wings::ImportBuiltins);
+		Wg_RegisterModule(context, "array", wings::ImportArray);
 		Wg_RegisterModule(context, "dis", wings::ImportDis);
+		Wg_RegisterModule(context, "json", wings::ImportJson);
 		Wg_RegisterModule(context, "math", wings::ImportMath);
+		Wg_RegisterModule(context, "profile", wings::ImportProfile);
 		Wg_RegisterModule(context, "random", wings::ImportRandom);
 		Wg_RegisterModule(context, "sys", wings::ImportSys);
 		Wg_RegisterModule(context, "time", wings::ImportTime);
@@ -117,8 +840,12 @@ extern "C" {
 		if (config) {
 			WG_ASSERT(context);
 			WG_ASSERT(config->maxAlloc >= 0);
+			WG_ASSERT(config->maxBytes >= 0);
 			WG_ASSERT(config->maxRecursion >= 0);
 			WG_ASSERT(config->gcRunFactor >= 1.0f);
+			WG_ASSERT(config->gcNurserySize >= 0);
+			WG_ASSERT(config->gcThreads >= 0);
+			WG_ASSERT(config->optimizationLevel >= 0);
 			WG_ASSERT(config->argc >= 0);
 			if (config->argc) {
 				WG_ASSERT(config->argv);
@@ -150,9 +877,51 @@ extern "C" {
 		WG_ASSERT_VOID(context);
 		context->closing = true;
 		Wg_CollectGarbage(context);
+		for (wings::Executor* executor : context->executorPool)
+			delete executor;
+		for (const auto& frame : context->suspendedFrames)
+			delete frame.executor;
+		delete context->profiler;
+		delete context->gcWorkers;
 		delete context;
 	}
 
+	Wg_Snapshot* Wg_SnapshotContext(Wg_Context* context) {
+		WG_ASSERT(context && context->executors.empty() && context->kwargs.empty() && !context->suspended);
+
+		// Garbage does not need to be copied
+		Wg_CollectGarbage(context);
+		if (!wings::CheckCloneable(context))
+			return nullptr;
+
+		auto snapshot = new Wg_Snapshot{ new Wg_Context() };
+		if (!wings::CloneContext(*context, *snapshot->context)) {
+			Wg_DestroySnapshot(snapshot);
+			Wg_RaiseException(context, WG_EXC_TYPEERROR, "cannot snapshot a dictionary or set with unhashable keys");
+			return nullptr;
+		}
+
+		// Drop the objects that were only referenced by the host
+		Wg_CollectGarbage(snapshot->context);
+		return snapshot;
+	}
+
+	Wg_Context* Wg_CreateContextFromSnapshot(const Wg_Snapshot* snapshot) {
+		WG_ASSERT(snapshot);
+		Wg_Context* context = new Wg_Context();
+		if (!wings::CloneContext(*snapshot->context, *context)) {
+			Wg_DestroyContext(context);
+			return nullptr;
+		}
+		return context;
+	}
+
+	void Wg_DestroySnapshot(Wg_Snapshot* snapshot) {
+		WG_ASSERT_VOID(snapshot);
+		Wg_DestroyContext(snapshot->context);
+		delete snapshot;
+	}
+
 	void Wg_Print(const Wg_Context* context, const char* message, int len) {
 		WG_ASSERT_VOID(context && message);
 		if (context->config.print) {
@@ -170,13 +939,58 @@ extern "C" {
 	}
 
 	Wg_Obj* Wg_Compile(Wg_Context* context, const char* script, const char* prettyName) {
+		WG_ASSERT(context && script);
 		return wings::Compile(context, script, "__main__", prettyName, false);
 	}
 
 	Wg_Obj* Wg_CompileExpression(Wg_Context* context, const char* script, const char* prettyName) {
+		WG_ASSERT(context && script);
 		return wings::Compile(context, script, "__main__", prettyName, true);
 	}
 
+	Wg_Obj* Wg_CompileBuffer(Wg_Context* context, const char* buffer, int len, const char* prettyName) {
+		WG_ASSERT(context && (buffer || len == 0) && len >= 0);
+		return wings::Compile(context, std::string_view(buffer, len), "__main__", prettyName, false);
+	}
+
+	Wg_Program* Wg_CompileProgram(const char* buffer, int len, const char* prettyName, const Wg_Config* config) {
+		WG_ASSERT((buffer || len == 0) && len >= 0);
+		Wg_Config defaultConfig{};
+		if (config == nullptr) {
+			Wg_DefaultConfig(&defaultConfig);
+			config = &defaultConfig;
+		}
+
+		try {
+			auto program = std::make_unique<Wg_Program>();
+			program->prettyName = prettyName ? prettyName : wings::DEFAULT_FUNC_NAME;
+			program->source = wings::MakeRcPtr<wings::SourceText>(std::string_view(buffer, len));
+			program->code = wings::CompileSource(program->source, false, config->optimizationLevel, program->error);
+			return program.release();
+		} catch (std::bad_alloc&) {
+			return nullptr;
+		}
+	}
+
+	const char* Wg_GetProgramError(const Wg_Program* program) {
+		WG_ASSERT(program);
+		return program->code ? nullptr : program->error.message.c_str();
+	}
+
+	Wg_Obj* Wg_InstantiateProgram(Wg_Context* context, const Wg_Program* program) {
+		WG_ASSERT(context && program);
+		if (program->code == nullptr) {
+			wings::RaiseSyntaxError(context, program->error, *program->source, "__main__", program->prettyName.c_str());
+			return nullptr;
+		}
+		return wings::NewCodeFunction(context, program->code, program->source, "__main__", program->prettyName.c_str());
+	}
+
+	void Wg_DestroyProgram(Wg_Program* program) {
+		WG_ASSERT_VOID(program);
+		delete program;
+	}
+
 	bool Wg_Execute(Wg_Context* context, const char* script, const char* prettyName) {
 		if (Wg_Obj* fn = Wg_Compile(context, script, prettyName)) {
 			return Wg_Call(fn, nullptr, 0) != nullptr;
@@ -203,6 +1017,19 @@ extern "C" {
 		}
 	}
 
+	int Wg_GetGlobals(Wg_Context* context, const char* const* names, int len, Wg_Obj** values) {
+		WG_ASSERT(context && len >= 0 && ((names && values) || len == 0));
+		auto& globals = context->globals.at(std::string(context->currentModule.top()));
+		int found = 0;
+		for (int i = 0; i < len; i++) {
+			WG_ASSERT(names[i] && wings::IsValidIdentifier(names[i]));
+			auto it = globals.find(names[i]);
+			values[i] = it == globals.end() ? nullptr : *it->second;
+			found += values[i] != nullptr;
+		}
+		return found;
+	}
+
 	void Wg_SetGlobal(Wg_Context* context, const char* name, Wg_Obj* value) {
 		WG_ASSERT_VOID(context && name && value && wings::IsValidIdentifier(name));
 		const auto& module = std::string(context->currentModule.top());
@@ -297,42 +1124,65 @@ extern "C" {
 
 	Wg_Obj* Wg_NewInt(Wg_Context* context, Wg_int value) {
 		WG_ASSERT(context);
-		if (Wg_Obj* v = Wg_Call(context->builtins._int, nullptr, 0)) {
-			v->Get<Wg_int>() = value;
-			return v;
-		} else {
-			return nullptr;
+		using B = wings::Builtins;
+		auto& b = context->builtins;
+
+		Wg_Obj** cached = nullptr;
+		if (value >= B::SMALL_INT_MIN && value <= B::SMALL_INT_MAX) {
+			cached = &b.smallInts[(size_t)(value - B::SMALL_INT_MIN)];
+			if (*cached)
+				return *cached;
 		}
+
+		Wg_Obj* v = wings::NewPrimitive(context, b._int, wings::ObjType::Int, value);
+		if (v && cached)
+			*cached = v;
+		return v;
 	}
 
 	Wg_Obj* Wg_NewFloat(Wg_Context* context, Wg_float value) {
 		WG_ASSERT(context);
-		if (Wg_Obj* v = Wg_Call(context->builtins._float, nullptr, 0)) {
-			v->Get<Wg_float>() = value;
-			return v;
-		} else {
-			return nullptr;
-		}
+		return wings::NewPrimitive(context, context->builtins._float, wings::ObjType::Float, value);
 	}
-
-	Wg_Obj* Wg_NewString(Wg_Context* context, const char* value) {
-		WG_ASSERT(context);
-		if (Wg_Obj* v = Wg_Call(context->builtins.str, nullptr, 0)) {
-			v->Get<std::string>() = value ? value : "";
-			return v;
-		} else {
-			return nullptr;
-		}
+
+	Wg_Obj* Wg_NewString(Wg_Context* context, const char* value) {
+		WG_ASSERT(context);
+		return Wg_NewStringBuffer(context, value ? value : "", value ? (int)std::strlen(value) : 0);
 	}
 
 	Wg_Obj* Wg_NewStringBuffer(Wg_Context* context, const char* buffer, int length) {
 		WG_ASSERT(context && buffer && length >= 0);
-		if (Wg_Obj* v = Wg_Call(context->builtins.str, nullptr, 0)) {
-			v->Get<std::string>() = std::string(buffer, length);
-			return v;
-		} else {
-			return nullptr;
-		}
+		// Characters are created often, such as when iterating over a string
+		if (length <= 1)
+			return wings::InternString(context, std::string_view(buffer, length));
+		return wings::NewPrimitive(context, context->builtins.str, wings::ObjType::Str, std::string(buffer, length));
+	}
+
+	Wg_Obj* Wg_NewBytes(Wg_Context* context, const void* buffer, int len) {
+		WG_ASSERT(context && len >= 0 && (buffer || len == 0));
+		wings::BufferObject buf;
+		buf.kind = wings::BufferObject::Kind::Bytes;
+		buf.storage = wings::MakeRcPtr<wings::BufferStorage>();
+		if (len > 0)
+			buf.storage->owned.assign((const unsigned char*)buffer, (const unsigned char*)buffer + len);
+		buf.length = (size_t)len;
+		return wings::NewBuffer(context, std::move(buf));
+	}
+
+	Wg_Obj* Wg_NewBufferView(Wg_Context* context, void* buffer, int len, bool readOnly, Wg_Finalizer finalizer, void* userdata) {
+		WG_ASSERT(context && len >= 0 && (buffer || len == 0));
+		// The storage calls the finalizer even if the object cannot be allocated
+		wings::BufferObject buf;
+		buf.kind = wings::BufferObject::Kind::MemoryView;
+		buf.readonly = readOnly;
+		buf.storage = wings::MakeRcPtr<wings::BufferStorage>();
+		buf.storage->borrowed = true;
+		buf.storage->host = (unsigned char*)buffer;
+		buf.storage->hostSize = (size_t)len;
+		buf.storage->finalizer = finalizer;
+		buf.storage->userdata = userdata;
+		buf.length = (size_t)len;
+		return wings::NewBuffer(context, std::move(buf));
 	}
 
 	Wg_Obj* Wg_NewTuple(Wg_Context* context, Wg_Obj** argv, int argc) {
@@ -346,8 +1196,12 @@ extern "C" {
 			}
 		}
 
+		if (!wings::ChargeBytes(context, (size_t)argc * sizeof(Wg_Obj*)))
+			return nullptr;
+
 		if (Wg_Obj* v = Wg_Call(context->builtins.tuple, nullptr, 0)) {
 			v->Get<std::vector<Wg_Obj*>>() = std::vector<Wg_Obj*>(argv, argv + argc);
+			wings::WriteBarrier(v);
 			return v;
 		} else {
 			return nullptr;
@@ -365,8 +1219,12 @@ extern "C" {
 			}
 		}
 
+		if (!wings::ChargeBytes(context, (size_t)argc * sizeof(Wg_Obj*)))
+			return nullptr;
+
 		if (Wg_Obj* v = Wg_Call(context->builtins.list, nullptr, 0)) {
 			v->Get<std::vector<Wg_Obj*>>() = std::vector<Wg_Obj*>(argv, argv + argc);
+			wings::WriteBarrier(v);
 			return v;
 		} else {
 			return nullptr;
@@ -389,15 +1247,17 @@ extern "C" {
 		Wg_Obj* dummyKwargs = wings::Alloc(context);
 		if (dummyKwargs == nullptr)
 			return nullptr;
-		dummyKwargs->type = "__map";
-		wings::WDict wd{};
-		dummyKwargs->data = &wd;
+		dummyKwargs->type = wings::ObjType::Map;
+		auto wd = new wings::WDict();
+		Wg_SetUserdata(dummyKwargs, wd);
+		Wg_RegisterFinalizer(dummyKwargs, wings::DeleteUserdata<wings::WDict>, wd);
 
 		if (Wg_Obj* v = Wg_Call(context->builtins.dict, nullptr, 0, dummyKwargs)) {
 			for (int i = 0; i < argc; i++) {
 				refs.emplace_back(v);
 				try {
 					v->Get<wings::WDict>()[keys[i]] = values[i];
+					wings::WriteBarrier(v);
 				} catch (wings::HashException&) {
 					return nullptr;
 				}
@@ -423,6 +1283,7 @@ extern "C" {
 			for (int i = 0; i < argc; i++) {
 				try {
 					v->Get<wings::WSet>().insert(argv[i]);
+					wings::WriteBarrier(v);
 				} catch (wings::HashException&) {
 					return nullptr;
 				}
@@ -433,6 +1294,42 @@ extern "C" {
 		}
 	}
 
+	Wg_Obj* Wg_NewListFromInts(Wg_Context* context, const Wg_int* values, int len) {
+		return wings::NewSequenceFrom(context, context->builtins.list, values, len);
+	}
+
+	Wg_Obj* Wg_NewListFromFloats(Wg_Context* context, const Wg_float* values, int len) {
+		return wings::NewSequenceFrom(context, context->builtins.list, values, len);
+	}
+
+	Wg_Obj* Wg_NewListFromStrings(Wg_Context* context, const char* const* values, int len) {
+		return wings::NewSequenceFrom(context, context->builtins.list, values, len);
+	}
+
+	Wg_Obj* Wg_NewTupleFromInts(Wg_Context* context, const Wg_int* values, int len) {
+		return wings::NewSequenceFrom(context, context->builtins.tuple, values, len);
+	}
+
+	Wg_Obj* Wg_NewTupleFromFloats(Wg_Context* context, const Wg_float* values, int len) {
+		return wings::NewSequenceFrom(context, context->builtins.tuple, values, len);
+	}
+
+	Wg_Obj* Wg_NewTupleFromStrings(Wg_Context* context, const char* const* values, int len) {
+		return wings::NewSequenceFrom(context, context->builtins.tuple, values, len);
+	}
+
+	Wg_Obj* Wg_NewDictionaryFromInts(Wg_Context* context, const char* const* keys, const Wg_int* values, int len) {
+		return wings::NewDictionaryFrom(context, keys, values, len);
+	}
+
+	Wg_Obj* Wg_NewDictionaryFromFloats(Wg_Context* context, const char* const* keys, const Wg_float* values, int len) {
+		return wings::NewDictionaryFrom(context, keys, values, len);
+	}
+
+	Wg_Obj* Wg_NewDictionaryFromStrings(Wg_Context* context, const char* const* keys, const char* const* values, int len) {
+		return wings::NewDictionaryFrom(context, keys, values, len);
+	}
+
 	Wg_Obj* Wg_NewFunction(Wg_Context* context, Wg_Function fptr, void* userdata, const char* prettyName) {
 		WG_ASSERT(context && fptr);
 
@@ -441,10 +1338,10 @@ extern "C" {
 			return nullptr;
 
 		obj->attributes = context->builtins.func->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-		obj->type = "__func";
+		obj->type = wings::ObjType::Func;
 		auto data = new Wg_Obj::Func;
 		Wg_SetUserdata(obj, data);
-		Wg_RegisterFinalizer(obj, [](void* ud) { delete (Wg_Obj::Func*)ud; }, data);
+		Wg_RegisterFinalizer(obj, wings::DeleteUserdata<Wg_Obj::Func>, data);
 
 		data->fptr = fptr;
 		data->userdata = userdata;
@@ -465,6 +1362,7 @@ extern "C" {
 			return nullptr;
 		fn->Get<Wg_Obj::Func>().isMethod = true;
 		klass->Get<Wg_Obj::Class>().instanceAttributes.Set(name, fn);
+		wings::WriteBarrier(klass);
 		return fn;
 	}
 
@@ -485,10 +1383,11 @@ extern "C" {
 			return nullptr;
 		}
 		refs.emplace_back(klass);
-		klass->type = "__class";
+		klass->type = wings::ObjType::Class;
 		klass->data = new Wg_Obj::Class{ std::string(name) };
-		Wg_RegisterFinalizer(klass, [](void* ud) { delete (Wg_Obj::Class*)ud; }, klass->data);
+		Wg_RegisterFinalizer(klass, wings::DeleteUserdata<Wg_Obj::Class>, klass->data);
 		klass->Get<Wg_Obj::Class>().module = context->currentModule.top();
+		klass->Get<Wg_Obj::Class>().instanceType = context->types.Intern(name);
 		klass->Get<Wg_Obj::Class>().instanceAttributes.Set("__class__", klass);
 		klass->attributes.AddParent(context->builtins.object->Get<Wg_Obj::Class>().instanceAttributes);
 
@@ -501,6 +1400,7 @@ extern "C" {
 		}
 		if (Wg_Obj* basesTuple = Wg_NewTuple(context, actualBases, actualBaseCount)) {
 			klass->attributes.Set("__bases__", basesTuple);
+			wings::WriteBarrier(klass);
 		} else {
 			return nullptr;
 		}
@@ -516,7 +1416,7 @@ extern "C" {
 			wings::Wg_ObjRef ref(instance);
 
 			instance->attributes = _classObj->Get<Wg_Obj::Class>().instanceAttributes.Copy();
-			instance->type = _classObj->Get<Wg_Obj::Class>().name;
+			instance->type = _classObj->Get<Wg_Obj::Class>().instanceType;
 
 			if (Wg_HasAttribute(instance, "__init__")) {
 				Wg_Obj* init = Wg_GetAttribute(instance, "__init__");
@@ -571,7 +1471,7 @@ extern "C" {
 			return nullptr;
 
 		Wg_IncRef(klass);
-		Wg_RegisterFinalizer(initFn, [](void* ud) { Wg_DecRef((Wg_Obj*)ud); }, klass);
+		Wg_RegisterFinalizer(initFn, wings::DecRefUserdata, klass);
 
 		return klass;
 	}
@@ -589,47 +1489,47 @@ extern "C" {
 
 	bool Wg_IsInt(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__int";
+		return obj->type == wings::ObjType::Int;
 	}
 
 	bool Wg_IsIntOrFloat(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__int" || obj->type == "__float";
+		return obj->type == wings::ObjType::Int || obj->type == wings::ObjType::Float;
 	}
 
 	bool Wg_IsString(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__str";
+		return obj->type == wings::ObjType::Str;
 	}
 
 	bool Wg_IsTuple(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__tuple";
+		return obj->type == wings::ObjType::Tuple;
 	}
 
 	bool Wg_IsList(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__list";
+		return obj->type == wings::ObjType::List;
 	}
 
 	bool Wg_IsDictionary(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__map";
+		return obj->type == wings::ObjType::Map;
 	}
 
 	bool Wg_IsSet(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__set";
+		return obj->type == wings::ObjType::Set;
 	}
 
 	bool Wg_IsClass(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__class";
+		return obj->type == wings::ObjType::Class;
 	}
 
 	bool Wg_IsFunction(const Wg_Obj* obj) {
 		WG_ASSERT(obj);
-		return obj->type == "__func";
+		return obj->type == wings::ObjType::Func;
 	}
 
 	bool Wg_GetBool(const Wg_Obj* obj) {
@@ -648,22 +1548,92 @@ extern "C" {
 		else return obj->Get<Wg_float>();
 	}
 
+	bool Wg_TryGetBuffer(Wg_Obj* obj, void** data, int* len, bool* readOnly) {
+		WG_ASSERT(obj);
+		wings::BufferObject* buf = wings::GetBuffer(obj);
+		if (buf == nullptr || buf->storage == nullptr)
+			return false;
+		if (data)
+			*data = buf->Data();
+		if (len)
+			*len = (int)buf->length;
+		if (readOnly)
+			*readOnly = buf->readonly;
+		return true;
+	}
+
 	const char* Wg_GetString(const Wg_Obj* obj, int* len) {
 		WG_ASSERT(obj && Wg_IsString(obj));
+		if (obj->HoldsInline<wings::StrSlice>()) {
+			const auto& slice = obj->Get<wings::StrSlice>();
+			if (len)
+				*len = (int)slice.length;
+
+			// The end of the buffer is NUL terminated until something is appended to it
+			auto& buffer = *slice.buffer;
+			if (slice.length == buffer.size) {
+				buffer.sealed = true;
+				return buffer.data.get();
+			}
+			if (slice.terminated == nullptr)
+				slice.terminated = std::make_unique<std::string>(buffer.data.get(), slice.length);
+			return slice.terminated->c_str();
+		}
+
 		const auto& s = obj->Get<std::string>();
 		if (len)
 			*len = (int)s.size();
 		return s.c_str();
 	}
 
+	int Wg_GetInts(Wg_Obj* obj, Wg_int* values, int len) {
+		return wings::GetItems(obj, values, len, "int");
+	}
+
+	int Wg_GetFloats(Wg_Obj* obj, Wg_float* values, int len) {
+		return wings::GetItems(obj, values, len, "int or float");
+	}
+
+	int Wg_GetStrings(Wg_Obj* obj, const char** values, int len) {
+		return wings::GetItems(obj, values, len, "str");
+	}
+
+	int Wg_GetDictionaryItems(Wg_Obj* obj, Wg_Obj** keys, Wg_Obj** values, int len) {
+		WG_ASSERT(obj && Wg_IsDictionary(obj) && len >= 0);
+		const auto& dict = obj->Get<wings::WDict>();
+		int i = 0;
+		for (auto it = dict.begin(); it != dict.end() && i < len; ++it, i++) {
+			if (keys)
+				keys[i] = it->first;
+			if (values)
+				values[i] = it->second;
+		}
+		return (int)dict.size();
+	}
+
 	void Wg_SetUserdata(Wg_Obj* obj, void* userdata) {
 		WG_ASSERT_VOID(obj);
+		// An object may be promoted before its constructor has installed its data
+		wings::WriteBarrier(obj);
 		obj->data = userdata;
 	}
 
+	bool Wg_SetUserdataSize(Wg_Obj* obj, int64_t size) {
+		WG_ASSERT(obj && size >= 0);
+		if ((size_t)size > obj->userdataSize) {
+			wings::Wg_ObjRef ref(obj);
+			if (!wings::ChargeBytes(obj->context, (size_t)size - obj->userdataSize))
+				return false;
+		}
+		// A smaller size is accounted for by the next full collection
+		obj->userdataSize = (size_t)size;
+		return true;
+	}
+
 	bool Wg_TryGetUserdata(const Wg_Obj* obj, const char* type, void** out) {
 		WG_ASSERT(obj && type);
-		if (obj->type == std::string(type)) {
+		auto id = obj->context->types.Find(type);
+		if (id && obj->type == id.value()) {
 			if (out)
 				*out = obj->data;
 			return true;
@@ -677,40 +1647,13 @@ extern "C" {
 		obj->finalizers.push_back({ finalizer, userdata });
 	}
 	
-	static Wg_Obj* DuplicateMethod(Wg_Obj* method, Wg_Obj* self) {
-		const auto& func = method->Get<Wg_Obj::Func>();
-		if (func.self == self) {
-			return method;
-		}
-		
-		wings::Wg_ObjRef ref(method);
-		wings::Wg_ObjRef ref2(self);
-		
-		Wg_Obj* dup = Wg_NewFunction(
-			method->context,
-			func.fptr,
-			func.userdata,
-			func.prettyName.c_str());
-		if (dup) {
-			dup->Get<Wg_Obj::Func>().self = self;
-		}
-		
-		return dup;
-	}
-
 	bool Wg_HasAttribute(Wg_Obj* obj, const char* attribute) {
 		return Wg_GetAttributeNoExcept(obj, attribute) != nullptr;
 	}
 
 	Wg_Obj* Wg_GetAttribute(Wg_Obj* obj, const char* attribute) {
 		WG_ASSERT(obj && attribute && wings::IsValidIdentifier(attribute));
-		Wg_Obj* mem = obj->attributes.Get(attribute);
-		if (mem == nullptr) {
-			Wg_RaiseAttributeError(obj, attribute);
-		} else if (Wg_IsFunction(mem) && mem->Get<Wg_Obj::Func>().isMethod) {
-			return DuplicateMethod(mem, obj);
-		}
-		return mem;
+		return wings::BindAttribute(obj, obj->attributes.Get(attribute), attribute);
 	}
 
 	Wg_Obj* Wg_GetAttributeNoExcept(Wg_Obj* obj, const char* attribute) {
@@ -720,6 +1663,7 @@ extern "C" {
 
 	void Wg_SetAttribute(Wg_Obj* obj, const char* attribute, Wg_Obj* value) {
 		WG_ASSERT_VOID(obj && attribute && value && wings::IsValidIdentifier(attribute));
+		wings::WriteBarrier(obj);
 		obj->attributes.Set(attribute, value);
 	}
 
@@ -735,6 +1679,7 @@ extern "C" {
 
 		if (mem && Wg_IsFunction(mem) && mem->Get<Wg_Obj::Func>().isMethod) {
 			mem->Get<Wg_Obj::Func>().self = obj;
+			wings::WriteBarrier(mem);
 		}
 		return mem;
 	}
@@ -839,9 +1784,40 @@ extern "C" {
 		}
 	}
 
+	int Wg_IterateInto(Wg_Obj* obj, Wg_Obj** out, int len) {
+		WG_ASSERT(obj && len >= 0 && (out || len == 0));
+		if (len == 0)
+			return 0;
+
+		// The yielded objects are kept alive until iteration ends
+		struct State {
+			Wg_Obj** values;
+			int len;
+			int count;
+		} s = { out, len, 0 };
+
+		bool success = Wg_Iterate(obj, &s, [](Wg_Obj* yielded, void* userdata) {
+			State* s = (State*)userdata;
+			Wg_IncRef(yielded);
+			s->values[s->count++] = yielded;
+			return s->count < s->len;
+			});
+
+		for (int i = 0; i < s.count; i++)
+			Wg_DecRef(out[i]);
+		return success ? s.count : -1;
+	}
+
 	Wg_Obj* Wg_GetKwargs(Wg_Context* context) {
 		WG_ASSERT(context && !context->kwargs.empty());
-		return context->kwargs.back();
+		wings::CallKwargs kwargs = context->kwargs.back();
+		if (kwargs.dict == nullptr && kwargs.count) {
+			// Building the dictionary can make nested calls that grow the kwargs stack
+			Wg_Obj* dict = Wg_NewDictionary(context, kwargs.names, kwargs.values, kwargs.count);
+			context->kwargs.back().dict = dict;
+			return dict;
+		}
+		return kwargs.dict;
 	}
 
 	void* Wg_GetFunctionUserdata(Wg_Context* context) {
@@ -856,112 +1832,31 @@ extern "C" {
 		for (int i = 0; i < argc; i++)
 			WG_ASSERT(argv[i]);
 
-		Wg_Context* context = callable->context;
-		
-		if (Wg_CheckTimeout(context)) {
-			return nullptr;
-		}
-		
-		// Check recursion limit
-		if (context->kwargs.size() >= (size_t)context->config.maxRecursion) {
-			Wg_RaiseException(context, WG_EXC_RECURSIONERROR);
-			return nullptr;
-		}
-
-		// Call the __call__ method if object is neither a function nor a class
-		if (!Wg_IsFunction(callable) && !Wg_IsClass(callable)) {
-			return Wg_CallMethod(callable, "__call__", argv, argc);
-		}
-
-		// Validate keyword arguments
-		if (kwargsDict) {
-			if (!Wg_IsDictionary(kwargsDict)) {
-				Wg_RaiseException(context, WG_EXC_TYPEERROR, "Keyword arguments must be a dictionary");
-				return nullptr;
-			}
-			for (const auto& [key, value] : kwargsDict->Get<wings::WDict>()) {
-				if (!Wg_IsString(key)) {
-					Wg_RaiseException(context, WG_EXC_TYPEERROR, "Keyword arguments dictionary must only contain string keys");
+		return wings::CallWithSelf(callable, nullptr, argv, argc, kwargsDict);
+	}
+
+	Wg_Obj* Wg_CallVector(Wg_Obj* callable, Wg_Obj** argv, int argc, Wg_Obj* kwnames) {
+		WG_ASSERT(callable && argc >= 0);
+		int kwargc = 0;
+		Wg_Obj** names = nullptr;
+		if (kwnames) {
+			WG_ASSERT(Wg_IsTuple(kwnames));
+			auto& buf = kwnames->Get<std::vector<Wg_Obj*>>();
+			kwargc = (int)buf.size();
+			names = buf.data();
+			for (Wg_Obj* name : buf) {
+				if (!Wg_IsString(name)) {
+					Wg_RaiseException(callable->context, WG_EXC_TYPEERROR, "Keyword argument names must be strings");
 					return nullptr;
 				}
 			}
 		}
+		if (argc + kwargc)
+			WG_ASSERT(argv);
+		for (int i = 0; i < argc + kwargc; i++)
+			WG_ASSERT(argv[i]);
 
-		// Prevent arguments from being garbage collected
-		std::vector<wings::Wg_ObjRef> refs;
-		refs.emplace_back(callable);
-		for (int i = 0; i < argc; i++)
-			refs.emplace_back(argv[i]);
-
-		// Get the raw function pointer, userdata, module, and self
-		// depending on whether the callable is a function or class.
-		Wg_Obj* (*fptr)(Wg_Context*, Wg_Obj**, int);
-		void* userdata = nullptr;
-		std::string_view module;
-		Wg_Obj* self = nullptr;
-		if (Wg_IsFunction(callable)) {
-			const auto& func = callable->Get<Wg_Obj::Func>();
-			if (func.self)
-				self = func.self;
-			fptr = func.fptr;
-			userdata = func.userdata;
-			module = func.module;
-		} else {
-			const auto& klass = callable->Get<Wg_Obj::Class>();
-			fptr = klass.ctor;
-			userdata = klass.userdata;
-			module = klass.module;
-		}
-
-		// Prepare arguments into a contiguous buffer
-		std::vector<Wg_Obj*> argsHeap;
-		std::array<Wg_Obj*, 4> argsStack;
-		Wg_Obj** contiguousArgs;
-		int totalArgc = argc + (self ? 1 : 0);
-		if (totalArgc <= argsStack.size()) {
-			contiguousArgs = argsStack.data();
-		} else {
-			argsHeap.resize(totalArgc);
-			contiguousArgs = argsHeap.data();
-		}
-		if (self) {
-			contiguousArgs[0] = self;
-		}
-		for (int i = 0; i < argc; i++) {
-			contiguousArgs[i + (self ? 1 : 0)] = argv[i];
-		}
-
-		// Push various data onto stacks
-		context->currentModule.push(module);
-		context->userdata.push_back(userdata);
-		context->kwargs.push_back(kwargsDict);
-		if (Wg_IsFunction(callable)) {
-			const auto& func = callable->Get<Wg_Obj::Func>();
-			context->currentTrace.push_back(wings::TraceFrame{
-				{},
-				"",
-				func.module,
-				func.prettyName
-				});
-		}
-		
-		// Perform the call
-		Wg_Obj* ret = nullptr;
-		try {
-			ret = fptr(context, contiguousArgs, totalArgc);
-		} catch (std::bad_alloc&) {
-			Wg_RaiseException(context, WG_EXC_MEMORYERROR);
-		}
-		
-		// Pop the data off the stacks
-		context->currentModule.pop();
-		context->userdata.pop_back();
-		context->kwargs.pop_back();
-		if (Wg_IsFunction(callable)) {
-			context->currentTrace.pop_back();
-		}
-
-		return ret;
+		return wings::CallVector(callable, nullptr, argv, argc, names, kwargc);
 	}
 
 	Wg_Obj* Wg_CallMethod(Wg_Obj* obj, const char* member, Wg_Obj** argv, int argc, Wg_Obj* kwargsDict) {
@@ -971,11 +1866,7 @@ extern "C" {
 		for (int i = 0; i < argc; i++)
 			WG_ASSERT(argv[i]);
 
-		if (Wg_Obj* method = Wg_GetAttribute(obj, member)) {
-			return Wg_Call(method, argv, argc, kwargsDict);
-		} else {
-			return nullptr;
-		}
+		return wings::CallMethod(obj, member, argv, argc, kwargsDict);
 	}
 
 	Wg_Obj* Wg_CallMethodFromBase(Wg_Obj* obj, const char* member, Wg_Obj** argv, int argc, Wg_Obj* kwargsDict, Wg_Obj* baseClass) {
@@ -993,6 +1884,40 @@ extern "C" {
 		}
 	}
 
+	Wg_Obj* Wg_CallSuspendable(Wg_Obj* callable, Wg_Obj** argv, int argc) {
+		WG_ASSERT(callable && argc >= 0 && (argc == 0 || argv));
+		for (int i = 0; i < argc; i++)
+			WG_ASSERT(argv[i]);
+		Wg_Context* context = callable->context;
+		WG_ASSERT(context->currentTrace.empty() && !context->suspended);
+
+		Wg_Obj* result = wings::CallFromScript(callable, nullptr, argv, argc, nullptr, 0);
+		if (result != context->builtins.pending)
+			return result;
+		context->suspended = true;
+		return nullptr;
+	}
+
+	Wg_Obj* Wg_Suspend(Wg_Context* context) {
+		WG_ASSERT(context && !context->kwargs.empty());
+		if (!context->currentTrace.back().suspendable) {
+			Wg_RaiseException(context, WG_EXC_RUNTIMEERROR, "cannot suspend a call that was not made directly by a suspendable script");
+			return nullptr;
+		}
+		return context->builtins.pending;
+	}
+
+	bool Wg_IsSuspended(Wg_Context* context) {
+		WG_ASSERT(context);
+		return context->suspended;
+	}
+
+	Wg_Obj* Wg_Resume(Wg_Context* context, Wg_Obj* value, Wg_Obj* exception) {
+		WG_ASSERT(context && context->suspended && context->currentTrace.empty());
+		WG_ASSERT((value || exception) && !Wg_GetException(context));
+		return wings::ResumeSuspendedCall(context, exception ? nullptr : value, exception);
+	}
+
 	bool Wg_ParseKwargs(Wg_Obj* kwargs, const char* const* keys, int count, Wg_Obj** out) {
 		WG_ASSERT(keys && out && count > 0 && (!kwargs || Wg_IsDictionary(kwargs)));
 
@@ -1052,19 +1977,19 @@ extern "C" {
 			return Wg_Call(context->builtins.len, &arg, 1);
 		case WG_UOP_BOOL:
 			if (Wg_IsBool(arg))
-				return Wg_CheckTimeout(context) ? nullptr : arg;
+				return arg;
 			return Wg_Call(context->builtins._bool, &arg, 1);
 		case WG_UOP_INT:
 			if (Wg_IsInt(arg))
-				return Wg_CheckTimeout(context) ? nullptr : arg;
+				return arg;
 			return Wg_Call(context->builtins._int, &arg, 1);
 		case WG_UOP_FLOAT:
 			if (Wg_IsIntOrFloat(arg))
-				return Wg_CheckTimeout(context) ? nullptr : arg;
+				return arg;
 			return Wg_Call(context->builtins._float, &arg, 1);
 		case WG_UOP_STR:
 			if (Wg_IsString(arg))
-				return Wg_CheckTimeout(context) ? nullptr : arg;
+				return arg;
 			return Wg_Call(context->builtins.str, &arg, 1);
 		case WG_UOP_REPR:
 			return Wg_Call(context->builtins.repr, &arg, 1);
@@ -1094,7 +2019,7 @@ extern "C" {
 		{ WG_BOP_POW, "__pow__" },
 		{ WG_BOP_BITAND, "__and__" },
 		{ WG_BOP_BITOR, "__or__" },
-		{ WG_BOP_BITXOR, "__not__" },
+		{ WG_BOP_BITXOR, "__xor__" },
 		{ WG_BOP_SHL, "__lshift__" },
 		{ WG_BOP_SHR, "__rshift__" },
 		{ WG_BOP_IN, "__contains__" },
@@ -1112,6 +2037,10 @@ extern "C" {
 		if (op == WG_BOP_IN)
 			std::swap(lhs, rhs);
 
+		Wg_Obj* result = nullptr;
+		if (wings::TryFastBinaryOp(op, lhs, rhs, &result))
+			return result;
+
 		auto method = OP_METHOD_NAMES.find(op);
 
 		switch (op) {
@@ -1136,7 +2065,9 @@ extern "C" {
 		case WG_BOP_GE:
 		case WG_BOP_IN: {
 			Wg_Obj* boolResult = Wg_CallMethod(lhs, method->second, &rhs, 1);
-			if (!Wg_IsBool(boolResult)) {
+			if (boolResult == nullptr) {
+				return nullptr;
+			} else if (!Wg_IsBool(boolResult)) {
 				std::string message = method->second;
 				message += "() returned a non bool type";
 				Wg_RaiseException(boolResult->context, WG_EXC_TYPEERROR, message.c_str());
@@ -1210,7 +2141,7 @@ extern "C" {
 			ss << "\n";
 
 			if (!frame.lineText.empty()) {
-				std::string lineText = frame.lineText;
+				std::string lineText(frame.lineText);
 				std::replace(lineText.begin(), lineText.end(), '\t', ' ');
 
 				size_t skip = lineText.find_first_not_of(' ');
@@ -1220,7 +2151,7 @@ extern "C" {
 			}
 		}
 
-		ss << context->currentException->type;
+		ss << context->types.Name(context->currentException->type);
 		if (Wg_Obj* msg = Wg_GetAttributeNoExcept(context->currentException, "_message"))
 			if (Wg_IsString(msg) && *Wg_GetString(msg))
 				ss << ": " << Wg_GetString(msg);
@@ -1326,9 +2257,21 @@ extern "C" {
 		Wg_Context* context = obj->context;
 		if (Wg_IsInstance(obj, &context->builtins.baseException, 1)) {
 			context->currentException = obj;
-			context->exceptionTrace.clear();
-			for (const auto& frame : context->currentTrace)
-				context->exceptionTrace.push_back(frame.ToOwned());
+
+			// Only the frames are copied. Their strings are formatted by Wg_GetErrorMessage().
+			auto& trace = context->exceptionTrace;
+			trace.assign(context->currentTrace.begin(), context->currentTrace.end());
+			context->exceptionTraceText.clear();
+			for (auto& frame : trace) {
+				if (frame.function == nullptr) {
+					auto own = [&](std::string_view& text) {
+						text = context->exceptionTraceText.emplace_back(text);
+					};
+					own(frame.lineText);
+					own(frame.module);
+					own(frame.func);
+				}
+			}
 		} else {
 			Wg_RaiseException(context, WG_EXC_TYPEERROR, "exceptions must derive from BaseException");
 		}
@@ -1398,96 +2341,101 @@ extern "C" {
 
 	void Wg_CollectGarbage(Wg_Context* context) {
 		WG_ASSERT_VOID(context);
+		wings::GCPauseTimer timer(context, false);
 
-		std::deque<const Wg_Obj*> inUse;
-		if (!context->closing) {
-			if (context->currentException)
-				inUse.push_back(context->currentException);
-			for (const auto& obj : context->mem)
-				if (obj->refCount)
-					inUse.push_back(obj.get());
-			for (auto& [_, globals] : context->globals)
-				for (auto& var : globals)
-					inUse.push_back(*var.second);
-			for (Wg_Obj* obj : context->kwargs)
-				if (obj)
-					inUse.push_back(obj);
-			for (auto& obj : context->builtins.GetAll())
-				if (obj)
-					inUse.push_back(obj);
-			for (const auto& executor : context->executors)
-				executor->GetReferences(inUse);
-		}
+		bool parallel = context->config.gcThreads > 0 && context->mem.size() >= wings::PARALLEL_GC_MIN_OBJECTS;
 
-		// Recursively find objects in use
-		std::unordered_set<const Wg_Obj*> traversed;
-		while (inUse.size()) {
-			auto obj = inUse.back();
-			inUse.pop_back();
-			if (!traversed.contains(obj)) {
-				traversed.insert(obj);
-
-				if (Wg_IsTuple(obj) || Wg_IsList(obj)) {
-					inUse.insert(
-						inUse.end(),
-						obj->Get<std::vector<Wg_Obj*>>().begin(),
-						obj->Get<std::vector<Wg_Obj*>>().end()
-					);
-				} else if (Wg_IsDictionary(obj)) {
-					for (const auto& [key, value] : obj->Get<wings::WDict>()) {
-						inUse.push_back(key);
-						inUse.push_back(value);
-					}
-				} else if (Wg_IsSet(obj)) {
-					for (Wg_Obj* value : obj->Get<wings::WSet>()) {
-						inUse.push_back(value);
-					}
-				} else if (Wg_IsFunction(obj)) {
-					const auto& fn = obj->Get<Wg_Obj::Func>();
-					if (fn.self) {
-						inUse.push_back(fn.self);
-					}
-					if (fn.fptr == &wings::DefObject::Run) {
-						auto* def = (wings::DefObject*)fn.userdata;
-						for (const auto& capture : def->captures)
-							inUse.push_back(*capture.second);
-						for (const auto& arg : def->defaultParameterValues)
-							inUse.push_back(arg);
-					}
-				} else if (Wg_IsClass(obj)) {
-					inUse.insert(
-						inUse.end(),
-						obj->Get<Wg_Obj::Class>().bases.begin(),
-						obj->Get<Wg_Obj::Class>().bases.end()
-					);
-					obj->Get<Wg_Obj::Class>().instanceAttributes.ForEach([&](auto& entry) {
-						inUse.push_back(entry);
-						});
-				}
+		std::vector<const Wg_Obj*> inUse;
+		if (!context->closing)
+			wings::GatherRoots(context, inUse, false);
 
-				obj->attributes.ForEach([&](auto& entry) {
-					inUse.push_back(entry);
-					});
+		// Recursively find objects in use
+		size_t bytes = 0;
+		if (parallel) {
+			wings::MarkReachableParallel(context, inUse);
+			bytes = wings::FreeUnreachableParallel(context);
+		} else {
+			wings::MarkReachable(inUse, false);
+			wings::FreeUnreachable(context, 0);
+			for (const Wg_Obj* obj : context->mem)
+				bytes += wings::ObjectBytes(obj);
+		}
+		context->lastObjectCountAfterGC = context->mem.size();
+		context->gcStats.bytesAfterCollection = bytes;
+		context->gcStats.bytesSinceCollection = 0;
+
+		// Every survivor is promoted so the remembered set starts out empty.
+		// It may refer to objects that were just freed so the flags are reset from the survivors.
+		context->rememberedSet.clear();
+		for (Wg_Obj* obj : context->mem)
+			obj->remembered = false;
+		if (context->config.gcNurserySize)
+			wings::Promote(context, 0);
+	}
+
+	void Wg_GetGCStats(Wg_Context* context, Wg_GCStats* stats) {
+		WG_ASSERT_VOID(context && stats);
+		using std::chrono::nanoseconds;
+		auto ns = [](auto duration) { return (int64_t)std::chrono::duration_cast<nanoseconds>(duration).count(); };
+		const auto& s = context->gcStats;
+		stats->collections = (int64_t)s.collections;
+		stats->youngCollections = (int64_t)s.youngCollections;
+		stats->allocations = (int64_t)s.allocations;
+		stats->bytesAllocated = (int64_t)s.bytesAllocated;
+		stats->objects = (int64_t)context->mem.size();
+		stats->bytes = (int64_t)(s.bytesAfterCollection + s.bytesSinceCollection);
+		stats->bytesAfterCollection = (int64_t)s.bytesAfterCollection;
+		stats->bytesSinceCollection = (int64_t)s.bytesSinceCollection;
+		stats->pauseNanoseconds = ns(s.pauseTime);
+		stats->maxPauseNanoseconds = ns(s.maxPause);
+		stats->lastPauseNanoseconds = ns(s.lastPause);
+	}
+
+	int Wg_GetGCPauseHistogram(Wg_Context* context, int64_t* counts, int len) {
+		WG_ASSERT(context && len >= 0 && (counts || len == 0));
+		const auto& histogram = context->gcStats.pauseHistogram;
+		for (size_t i = 0; i < wings::GC_PAUSE_BUCKETS && i < (size_t)len; i++)
+			counts[i] = (int64_t)histogram[i];
+		return (int)wings::GC_PAUSE_BUCKETS;
+	}
+
+	int Wg_GetGCTypeStats(Wg_Context* context, int64_t* objects, int64_t* bytes, int len) {
+		WG_ASSERT(context && len >= 0);
+		int64_t objectCounts[WG_GC_TYPE_COUNT]{};
+		int64_t byteCounts[WG_GC_TYPE_COUNT]{};
+		for (const Wg_Obj* obj : context->mem) {
+			Wg_GCType type{};
+			switch (obj->type) {
+			case wings::ObjType::Null: type = WG_GC_NONE; break;
+			case wings::ObjType::Bool: type = WG_GC_BOOL; break;
+			case wings::ObjType::Int: type = WG_GC_INT; break;
+			case wings::ObjType::Float: type = WG_GC_FLOAT; break;
+			case wings::ObjType::Str: type = WG_GC_STR; break;
+			case wings::ObjType::Tuple: type = WG_GC_TUPLE; break;
+			case wings::ObjType::List: type = WG_GC_LIST; break;
+			case wings::ObjType::Map: type = WG_GC_DICT; break;
+			case wings::ObjType::Set: type = WG_GC_SET; break;
+			case wings::ObjType::Func: type = WG_GC_FUNCTION; break;
+			case wings::ObjType::Class: type = WG_GC_CLASS; break;
+			default: type = WG_GC_OBJECT; break;
 			}
+			objectCounts[type]++;
+			byteCounts[type] += (int64_t)wings::ObjectBytes(obj);
 		}
 
-		// Call finalizers
-		for (auto& obj : context->mem)
-			if (!traversed.contains(obj.get()))
-				for (const auto& finalizer : obj->finalizers)
-					finalizer.first(finalizer.second);
-
-		// Remove unused objects
-		context->mem.erase(
-			std::remove_if(
-				context->mem.begin(),
-				context->mem.end(),
-				[&traversed](const auto& obj) { return !traversed.contains(obj.get()); }
-			),
-			context->mem.end()
-		);
+		for (int i = 0; i < WG_GC_TYPE_COUNT && i < len; i++) {
+			if (objects)
+				objects[i] = objectCounts[i];
+			if (bytes)
+				bytes[i] = byteCounts[i];
+		}
+		return WG_GC_TYPE_COUNT;
+	}
 
-		context->lastObjectCountAfterGC = context->mem.size();
+	void Wg_SetGCCallback(Wg_Context* context, Wg_GCCallback callback, void* userdata) {
+		WG_ASSERT_VOID(context);
+		context->gcCallback = callback;
+		context->gcCallbackUserdata = userdata;
 	}
 
 	void Wg_IncRef(Wg_Obj* obj) {
@@ -1507,36 +2455,107 @@ extern "C" {
 
 	void Wg_SetTimeout(Wg_Context* context, int milliseconds) {
 		WG_ASSERT_VOID(context && milliseconds >= 0);
-		uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
-			std::chrono::system_clock::now().time_since_epoch()
-		).count();
-		context->timeouts.push_back({ now, (uint64_t)milliseconds });
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+		context->timeouts.push_back({ deadline, (uint64_t)milliseconds });
 	}
 
 	void Wg_ClearTimeout(Wg_Context* context) {
 		WG_ASSERT_VOID(context && context->timeouts.size() > 0);
 		context->timeouts.pop_back();
 	}
+
+	void Wg_SetInstructionBudget(Wg_Context* context, int64_t ticks) {
+		WG_ASSERT_VOID(context && ticks >= -1);
+		context->instructionBudget = ticks;
+		context->ticksScheduled = ticks == -1
+			? wings::TICKS_PER_LIMIT_CHECK
+			: std::min(wings::TICKS_PER_LIMIT_CHECK, ticks + 1);
+		context->ticksUntilCheck = context->ticksScheduled;
+	}
+
+	int64_t Wg_GetInstructionBudget(Wg_Context* context) {
+		WG_ASSERT(context);
+		if (context->instructionBudget == -1)
+			return -1;
+		int64_t used = context->ticksScheduled - context->ticksUntilCheck;
+		return std::max<int64_t>(0, context->instructionBudget - used);
+	}
+
+	void Wg_Interrupt(Wg_Context* context) {
+		WG_ASSERT_VOID(context);
+		context->interruptRequested.store(true, std::memory_order_relaxed);
+	}
 	
 	bool Wg_CheckTimeout(Wg_Context* context) {
-		uint64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
-			std::chrono::system_clock::now().time_since_epoch()
-		).count();
-		
-		for (auto& timeout : context->timeouts) {
-			if (timeout.start && now >= timeout.start + timeout.time) {
-				std::string msg = "Time exceeded " + std::to_string(timeout.time) + "ms";
-
-				// Temporarily disable timeout to prevent timeout being hit again in Wg_RaiseException
-				timeout.start = 0;
-				
-				Wg_RaiseException(context, Wg_Exc::WG_EXC_WINGSTIMEOUTERROR, msg.c_str());
-
-				// Re-enable timeout
-				timeout.start = 1;
-				return true;
+		WG_ASSERT(context);
+
+		// Constructing the exception object counts ticks, so avoid raising another exception
+		if (context->raisingLimitError)
+			return false;
+
+		std::string msg;
+		int64_t used = context->ticksScheduled - context->ticksUntilCheck;
+		if (context->instructionBudget != -1) {
+			context->instructionBudget -= used;
+			if (context->instructionBudget < 0) {
+				context->instructionBudget = 0;
+				msg = "Instruction budget exceeded";
 			}
 		}
-		return false;
+
+		context->ticksScheduled = context->instructionBudget == -1
+			? wings::TICKS_PER_LIMIT_CHECK
+			: std::min(wings::TICKS_PER_LIMIT_CHECK, context->instructionBudget + 1);
+		context->ticksUntilCheck = context->ticksScheduled;
+
+		if (msg.empty() && context->interruptRequested.exchange(false, std::memory_order_relaxed))
+			msg = "Interrupted";
+
+		if (msg.empty() && !context->timeouts.empty()) {
+			auto now = std::chrono::steady_clock::now();
+			for (const auto& timeout : context->timeouts) {
+				if (now >= timeout.deadline) {
+					msg = "Time exceeded " + std::to_string(timeout.time) + "ms";
+					break;
+				}
+			}
+		}
+
+		if (msg.empty())
+			return false;
+
+		context->raisingLimitError = true;
+		Wg_RaiseException(context, Wg_Exc::WG_EXC_WINGSTIMEOUTERROR, msg.c_str());
+		context->raisingLimitError = false;
+		return true;
+	}
+
+	void Wg_StartProfiler(Wg_Context* context, int sampleInterval) {
+		WG_ASSERT_VOID(context && sampleInterval >= 0);
+		if (context->profiler == nullptr)
+			context->profiler = new wings::Profiler();
+		context->profiler->Start(std::chrono::microseconds(sampleInterval));
+	}
+
+	void Wg_StopProfiler(Wg_Context* context) {
+		WG_ASSERT_VOID(context);
+		if (context->profiler)
+			context->profiler->Stop();
+	}
+
+	const char* Wg_GetProfileReport(Wg_Context* context) {
+		WG_ASSERT(context);
+		if (context->profiler == nullptr)
+			return "";
+		context->profiler->output = context->profiler->Report();
+		return context->profiler->output.c_str();
+	}
+
+	const char* Wg_GetProfileCollapsedStacks(Wg_Context* context) {
+		WG_ASSERT(context);
+		if (context->profiler == nullptr)
+			return "";
+		context->profiler->output = context->profiler->CollapsedStacks();
+		return context->profiler->output.c_str();
 	}
 } // extern "C"
@@ -28,6 +28,34 @@ extern "C" {
 */
 typedef struct Wg_Context Wg_Context;
 
+/**
+ * @brief An opaque type representing a frozen copy of the state of an interpreter.
+ * 
+ * @see Wg_SnapshotContext, Wg_CreateContextFromSnapshot, Wg_DestroySnapshot
+*/
+typedef struct Wg_Snapshot Wg_Snapshot;
+
+/**
+ * @brief An opaque type representing a set of worker threads that each own a context.
+ * 
+ * @see Wg_CreateContextPool, Wg_DestroyContextPool
+*/
+typedef struct Wg_ContextPool Wg_ContextPool;
+
+/**
+ * @brief An opaque type representing the pending result of a job submitted to a context pool.
+ * 
+ * @see Wg_GetFutureResult, Wg_DestroyFuture
+*/
+typedef struct Wg_Future Wg_Future;
+
+/**
+ * @brief An opaque type representing compiled code that can be run in any context.
+ * 
+ * @see Wg_CompileProgram, Wg_InstantiateProgram, Wg_DestroyProgram
+*/
+typedef struct Wg_Program Wg_Program;
+
 /**
  * @brief An opaque type representing an object in the interpreter.
 */
@@ -127,6 +155,18 @@ typedef bool (*Wg_IterationCallback)(Wg_Obj* obj, void* userdata);
 */
 typedef bool (*Wg_ModuleLoader)(Wg_Context* context);
 
+/**
+* @brief The signature of a callback invoked after every garbage collection.
+* 
+* @warning Do not perform any object allocations in this function.
+* 
+* @param context The associated context.
+* @param userdata The userdata specified when this callback was registered.
+* 
+* @see Wg_SetGCCallback, Wg_GetGCStats
+*/
+typedef void (*Wg_GCCallback)(Wg_Context* context, void* userdata);
+
 #ifdef _WIN32
 #pragma pack(push, 1)
 #endif
@@ -158,9 +198,25 @@ typedef struct Wg_Config {
 	*/
 	int maxAlloc;
 	/**
+	* @brief The approximate number of bytes that objects may use
+	*		 before a MemoryError will be raised.
+	* 
+	* This includes the storage of strings, containers, bytes objects and the sizes
+	* reported with Wg_SetUserdataSize(), but not the memory used for compiled code.
+	* 
+	* This is set to 0 by default, which means there is no limit, and must be >= 0.
+	* 
+	* @see Wg_GetGCStats
+	*/
+	int64_t maxBytes;
+	/**
 	* @brief The maximum recursion depth allowed before a RecursionError will be raised.
 	* 
-	* This is set to 50 by default.
+	* Calls between script functions do not use the host stack. Calls that go
+	* through native code, such as a script function called by map() or an
+	* operator calling a dunder method, are also limited to a depth of 200.
+	* 
+	* This is set to 1000 by default.
 	*/
 	int maxRecursion;
 	/**
@@ -173,6 +229,35 @@ typedef struct Wg_Config {
 	*/
 	float gcRunFactor;
 	/**
+	* @brief The number of newly allocated objects that triggers a collection
+	*		 of the young generation only.
+	* 
+	* Objects that survive a young collection are promoted and are then only
+	* freed by a full collection, which still runs according to gcRunFactor.
+	* If this is 0, generational collection is disabled and every collection
+	* is a full collection.
+	* 
+	* This is set to 0 by default and must be >= 0.
+	* 
+	* @see gcRunFactor
+	*/
+	int gcNurserySize;
+	/**
+	* @brief The number of helper threads that mark and sweep together with the
+	*		 owning thread during a full collection.
+	* 
+	* The helper threads are only used once the heap has at least 65536 objects,
+	* since smaller heaps are collected faster by one thread. They are started by
+	* the first such collection and stopped when the context is destroyed.
+	* Finalizers always run on the thread that started the collection, and
+	* collections of the young generation are never parallel.
+	* 
+	* This is set to 0 by default and must be >= 0.
+	* 
+	* @see gcNurserySize
+	*/
+	int gcThreads;
+	/**
 	* @brief The callback to be invoked when print is called in the interpreter.
 	* If this is NULL, then print messages are discarded.
 	* 
@@ -193,6 +278,30 @@ typedef struct Wg_Config {
 	*/
 	const char* importPath;
 	/**
+	* @brief Caches the compiled form of imported file modules.
+	*
+	* Compiled modules are written to a __wgcache__ directory inside the import path
+	* and are loaded from there without recompiling for as long as the source is unchanged.
+	* Failing to read or write the cache is not an error.
+	*
+	* This is set to false by default.
+	*
+	* @see importPath
+	*/
+	bool enableBytecodeCache;
+	/**
+	* @brief The amount of optimization applied when compiling scripts.
+	*
+	* At level 0 the compiled code follows the source directly. From level 1,
+	* constant expressions are folded, unreachable code is removed and jumps
+	* are simplified. The result can be inspected with the dis module.
+	*
+	* Folding assumes that the operators of the builtin types are not replaced.
+	*
+	* This is set to 0 by default and must be >= 0.
+	*/
+	int optimizationLevel;
+	/**
 	* @brief The commandline arguments passed to the interpreter.
 	* If argc is 0, then this can be NULL.
 	*/
@@ -214,6 +323,122 @@ Wg_Config;
 #pragma pack(pop)
 #endif
 
+/**
+* @brief Garbage collection and memory statistics of a context.
+* 
+* Object and byte counts are measured exactly by every full collection.
+* Between collections, the bytes used by newly allocated objects
+* and by growing containers are added as they are allocated.
+* 
+* @see Wg_GetGCStats
+*/
+typedef struct Wg_GCStats {
+	/**
+	* @brief The number of collections, including young collections.
+	*/
+	int64_t collections;
+	/**
+	* @brief The number of collections of the young generation only.
+	*/
+	int64_t youngCollections;
+	/**
+	* @brief The total number of objects allocated.
+	*/
+	int64_t allocations;
+	/**
+	* @brief The total number of bytes allocated.
+	*/
+	int64_t bytesAllocated;
+	/**
+	* @brief The number of objects currently allocated.
+	*/
+	int64_t objects;
+	/**
+	* @brief The approximate number of bytes currently in use.
+	* 
+	* This is the sum of bytesAfterCollection and bytesSinceCollection.
+	*/
+	int64_t bytes;
+	/**
+	* @brief The number of bytes in use after the last full collection.
+	*/
+	int64_t bytesAfterCollection;
+	/**
+	* @brief The number of bytes allocated since the last full collection.
+	*/
+	int64_t bytesSinceCollection;
+	/**
+	* @brief The total time spent collecting garbage in nanoseconds.
+	*/
+	int64_t pauseNanoseconds;
+	/**
+	* @brief The longest collection in nanoseconds.
+	*/
+	int64_t maxPauseNanoseconds;
+	/**
+	* @brief The duration of the last collection in nanoseconds.
+	*/
+	int64_t lastPauseNanoseconds;
+} Wg_GCStats;
+
+/**
+* @brief The categories of objects counted by Wg_GetGCTypeStats.
+*/
+typedef enum Wg_GCType {
+	/**
+	* @brief None
+	*/
+	WG_GC_NONE,
+	/**
+	* @brief bool
+	*/
+	WG_GC_BOOL,
+	/**
+	* @brief int
+	*/
+	WG_GC_INT,
+	/**
+	* @brief float
+	*/
+	WG_GC_FLOAT,
+	/**
+	* @brief str
+	*/
+	WG_GC_STR,
+	/**
+	* @brief tuple
+	*/
+	WG_GC_TUPLE,
+	/**
+	* @brief list
+	*/
+	WG_GC_LIST,
+	/**
+	* @brief dict
+	*/
+	WG_GC_DICT,
+	/**
+	* @brief set
+	*/
+	WG_GC_SET,
+	/**
+	* @brief Functions and bound methods
+	*/
+	WG_GC_FUNCTION,
+	/**
+	* @brief Classes
+	*/
+	WG_GC_CLASS,
+	/**
+	* @brief Instances of every other class
+	*/
+	WG_GC_OBJECT,
+	/**
+	* @brief The number of categories
+	*/
+	WG_GC_TYPE_COUNT,
+} Wg_GCType;
+
 /**
 * @brief The unary operation to be used Wg_UnaryOp.
 */
@@ -569,6 +794,176 @@ Wg_Context* Wg_CreateContext(const Wg_Config* config WG_DEFAULT_ARG(nullptr));
 WG_DLL_EXPORT
 void Wg_DestroyContext(Wg_Context* context);
 
+/**
+* @brief Freeze the state of a context so that new contexts can be created from it.
+* 
+* The snapshot holds a copy of the globals of every imported module
+* and the objects they reference. Creating a context from a snapshot
+* is faster than creating a fresh context with Wg_CreateContext() and
+* importing the same modules again, since no code has to be run.
+* The original context is unchanged and can continue to be used.
+* 
+* Objects only referenced through Wg_IncRef() are not copied.
+* Userdata without a finalizer and the userdata of native functions
+* are shared with the copies. An exception is raised if an object has a
+* finalizer registered with Wg_RegisterFinalizer(), or is a native
+* object such as an open file or an iterator over a dict, set or range.
+* 
+* This function must not be called from within a native function.
+* The returned snapshot must be freed with Wg_DestroySnapshot().
+* 
+* @param context The context to snapshot.
+* @return The snapshot, or NULL on failure.
+* 
+* @see Wg_CreateContextFromSnapshot
+*/
+WG_DLL_EXPORT
+Wg_Snapshot* Wg_SnapshotContext(Wg_Context* context);
+
+/**
+* @brief Create an instance of an interpreter from a snapshot.
+* 
+* The new context uses the configuration of the snapshotted context.
+* The returned context must be freed with Wg_DestroyContext().
+* This function may be called from several threads at once with the same snapshot.
+* 
+* @param snapshot The snapshot to copy.
+* @return A newly created context, or NULL if a dictionary key could not be rehashed.
+* 
+* @see Wg_SnapshotContext
+*/
+WG_DLL_EXPORT
+Wg_Context* Wg_CreateContextFromSnapshot(const Wg_Snapshot* snapshot);
+
+/**
+* @brief Free a snapshot created with Wg_SnapshotContext().
+* 
+* Contexts created from the snapshot are unaffected.
+* 
+* @param snapshot The snapshot to free.
+*/
+WG_DLL_EXPORT
+void Wg_DestroySnapshot(Wg_Snapshot* snapshot);
+
+/**
+* @brief Create a pool of worker threads that each own a context.
+* 
+* Jobs submitted to the pool are queued on one of the workers, and
+* idle workers steal jobs queued on busy workers. Values are passed
+* into and out of jobs by copying them, so only plain data can be passed:
+* None, bool, int, float, str, and tuples, lists, dicts and sets of plain data.
+* 
+* Each job may run on any worker, so jobs should not rely on
+* globals set by other jobs. To avoid compiling the same code for every job,
+* define functions in a snapshot and submit them with Wg_SubmitCall().
+* The print and error callbacks of the configuration are called from the worker threads.
+* 
+* The returned pool must be freed with Wg_DestroyContextPool().
+* 
+* @param config The configuration of the worker contexts, or NULL to use the default configuration.
+* Ignored if a snapshot is given.
+* @param snapshot A snapshot to create the worker contexts from, or NULL to create fresh contexts.
+* @param threadCount The number of worker threads, or 0 to use the number of hardware threads.
+* @return The newly created pool, or NULL if a worker context could not be created.
+* 
+* @see Wg_SubmitExecute, Wg_SubmitExecuteExpression, Wg_SubmitCall
+*/
+WG_DLL_EXPORT
+Wg_ContextPool* Wg_CreateContextPool(const Wg_Config* config WG_DEFAULT_ARG(nullptr), const Wg_Snapshot* snapshot WG_DEFAULT_ARG(nullptr), int threadCount WG_DEFAULT_ARG(0));
+
+/**
+* @brief Free a context pool.
+* 
+* Waits for every submitted job to finish before the worker threads are stopped.
+* Futures of the pool remain valid and must still be freed with Wg_DestroyFuture().
+* 
+* @param pool The pool to free.
+*/
+WG_DLL_EXPORT
+void Wg_DestroyContextPool(Wg_ContextPool* pool);
+
+/**
+* @brief Submit a script to be executed by a context pool.
+* 
+* The result of the future is None if the script ran successfully.
+* The returned future must be freed with Wg_DestroyFuture().
+* 
+* @param pool The pool to run the script.
+* @param script The script to execute.
+* @param prettyName The name to run the script under, or NULL to use a default name.
+* @return The future of the job.
+* 
+* @see Wg_Execute
+*/
+WG_DLL_EXPORT
+Wg_Future* Wg_SubmitExecute(Wg_ContextPool* pool, const char* script, const char* prettyName WG_DEFAULT_ARG(nullptr));
+
+/**
+* @brief Submit an expression to be evaluated by a context pool.
+* 
+* The returned future must be freed with Wg_DestroyFuture().
+* 
+* @param pool The pool to evaluate the expression.
+* @param script The expression to evaluate.
+* @param prettyName The name to run the script under, or NULL to use a default name.
+* @return The future of the job.
+* 
+* @see Wg_ExecuteExpression
+*/
+WG_DLL_EXPORT
+Wg_Future* Wg_SubmitExecuteExpression(Wg_ContextPool* pool, const char* script, const char* prettyName WG_DEFAULT_ARG(nullptr));
+
+/**
+* @brief Submit a call to a global function of the __main__ module to a context pool.
+* 
+* The arguments are copied before this function returns.
+* The returned future must be freed with Wg_DestroyFuture().
+* 
+* @param pool The pool to run the function.
+* @param function The name of the global function to call.
+* @param argv A pointer to an array of arguments. This can be NULL if argc is 0.
+* @param argc The number of arguments.
+* @return The future of the job, or NULL if an argument is not plain data.
+* In this case, an exception is raised in the context of the argument.
+* 
+* @see Wg_Call
+*/
+WG_DLL_EXPORT
+Wg_Future* Wg_SubmitCall(Wg_ContextPool* pool, const char* function, Wg_Obj** argv, int argc);
+
+/**
+* @brief Check if the job of a future has finished.
+* 
+* @param future The future to check.
+* @return True if Wg_GetFutureResult() would not block, otherwise false.
+*/
+WG_DLL_EXPORT
+bool Wg_IsFutureReady(Wg_Future* future);
+
+/**
+* @brief Wait for the job of a future to finish and copy its result into a context.
+* 
+* If the job raised an exception, an exception of the same builtin type
+* and message is raised in the context. Other exception types are raised as a RuntimeError.
+* This function may be called more than once.
+* 
+* @param future The future to wait for.
+* @param context The context to create the result in.
+* @return The result of the job, or NULL on failure.
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_GetFutureResult(Wg_Future* future, Wg_Context* context);
+
+/**
+* @brief Free a future.
+* 
+* The job of the future still runs if it has not finished.
+* 
+* @param future The future to free.
+*/
+WG_DLL_EXPORT
+void Wg_DestroyFuture(Wg_Future* future);
+
 /**
 * @brief Get the default configuration.
 * 
@@ -643,6 +1038,89 @@ Wg_Obj* Wg_Compile(Wg_Context* context, const char* script, const char* prettyNa
 WG_DLL_EXPORT
 Wg_Obj* Wg_CompileExpression(Wg_Context* context, const char* script, const char* prettyName WG_DEFAULT_ARG(nullptr));
 
+/**
+* @brief Compile a script from a buffer into a function object.
+* 
+* The buffer does not need to be null terminated and does not need to
+* outlive the call. A single copy of the script is kept by the function
+* for tracebacks.
+* 
+* An exception will be raised if there are any errors
+* and should be handled with Wg_ClearException() or propagated.
+*
+* @param context The associated context.
+* @param buffer The script to compile.
+* @param len The length of the buffer.
+* @param prettyName The name to run the script under, or NULL to use a default name.
+* @return A function object, or NULL on failure.
+*
+* @see Wg_Compile, Wg_GetException, Wg_GetErrorMessage, Wg_Call
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_CompileBuffer(Wg_Context* context, const char* buffer, int len, const char* prettyName WG_DEFAULT_ARG(nullptr));
+
+/**
+* @brief Compile a script without a context.
+* 
+* The compiled code and a single copy of the source are shared by every
+* function instantiated from the program with Wg_InstantiateProgram(), so
+* a script can be run in many contexts without compiling it in each one.
+* The program is never modified once compiled, so it may be instantiated
+* in contexts on several threads at once.
+* 
+* A program is created even if the script has a syntax error,
+* in which case Wg_InstantiateProgram() raises the SyntaxError.
+* The returned program must be freed with Wg_DestroyProgram().
+* 
+* @param buffer The script to compile. This does not need to be null terminated.
+* @param len The length of the buffer.
+* @param prettyName The name to run the script under, or NULL to use a default name.
+* @param config The configuration to take the optimization level from, or NULL to use the default configuration.
+* @return The program, or NULL if memory could not be allocated.
+* 
+* @see Wg_GetProgramError
+*/
+WG_DLL_EXPORT
+Wg_Program* Wg_CompileProgram(const char* buffer, int len, const char* prettyName WG_DEFAULT_ARG(nullptr), const Wg_Config* config WG_DEFAULT_ARG(nullptr));
+
+/**
+* @brief Get the syntax error of a program.
+* 
+* @param program The program.
+* @return The error message, or NULL if the program compiled successfully.
+* The string is valid until the program is freed.
+*/
+WG_DLL_EXPORT
+const char* Wg_GetProgramError(const Wg_Program* program);
+
+/**
+* @brief Create a function object that runs a program in the __main__ module of a context.
+* 
+* This does not copy the compiled code. This function may be called
+* from several threads at once with the same program.
+* 
+* An exception will be raised if the program has a syntax error
+* and should be handled with Wg_ClearException() or propagated.
+* 
+* @param context The associated context.
+* @param program The program to instantiate.
+* @return A function object, or NULL on failure.
+* 
+* @see Wg_Compile, Wg_Call
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_InstantiateProgram(Wg_Context* context, const Wg_Program* program);
+
+/**
+* @brief Free a program created with Wg_CompileProgram().
+* 
+* Functions instantiated from the program are unaffected.
+* 
+* @param program The program to free.
+*/
+WG_DLL_EXPORT
+void Wg_DestroyProgram(Wg_Program* program);
+
 /**
 * @brief Set a callback for programmer errors.
 * 
@@ -682,6 +1160,10 @@ Wg_Obj* Wg_GetException(Wg_Context* context);
 * Call Wg_ClearTimeout() after the timeout is no longer needed.
 * This function may be called multiple times and will stack.
 * 
+* To keep the overhead low, the clock is only read once every
+* 1024 function calls and loop iterations, so the error may be
+* raised slightly after the timeout has elapsed.
+* 
 * @param context The associated context.
 * @param milliseconds The timeout in milliseconds.
 * 
@@ -701,47 +1183,152 @@ WG_DLL_EXPORT
 void Wg_ClearTimeout(Wg_Context* context);
 
 /**
-* @brief Check if any timeout has occurred.
+* @brief Limit the amount of work a context may perform before a WingsTimeoutError is raised.
 *
+* The budget is measured in ticks, where a tick is counted on every function call
+* and loop iteration. The budget is shared by every subsequent execution in the
+* context and is not restored after an execution finishes. Once exceeded, the
+* error is raised again on every check until a new budget is set.
+* 
 * @param context The associated context.
-* @return True if any timeout has occurred, otherwise false.
+* @param ticks The number of ticks allowed, or -1 to remove the budget.
 * 
-* @see Wg_SetTimeout, Wg_ClearTimeout
+* @see Wg_GetInstructionBudget, Wg_CheckTimeout
 */
 WG_DLL_EXPORT
-bool Wg_CheckTimeout(Wg_Context* context);
+void Wg_SetInstructionBudget(Wg_Context* context, int64_t ticks);
 
 /**
-* @brief Create and raise an exception.
-*
-* If an exception is already set, the old exception will be overwritten.
+* @brief Get the number of ticks left in the instruction budget.
 *
 * @param context The associated context.
-* @param type The exception type.
-* @param message The error message, or NULL for an empty string.
+* @return The number of ticks left, or -1 if there is no budget.
 * 
-* @see Wg_RaiseExceptionClass, Wg_RaiseExceptionObject, Wg_ReraiseExceptionObject
+* @see Wg_SetInstructionBudget
 */
 WG_DLL_EXPORT
-void Wg_RaiseException(Wg_Context* context, Wg_Exc type, const char* message WG_DEFAULT_ARG(nullptr));
+int64_t Wg_GetInstructionBudget(Wg_Context* context);
 
 /**
-* @brief Create and raise an exception using a class object.
-* 
-* The class must derive from BaseException, otherwise a TypeError is raised.
-* 
-* If an exception is already set, the old exception will be overwritten.
+* @brief Request that the code running in a context is stopped.
+*
+* A WingsTimeoutError is raised in the context the next time its limits are checked.
+* Unlike the other functions of this library, this function may be called from any
+* thread while the context is in use.
 * 
-* @param klass The exception class.
-* @param message The error message, or NULL for an empty string.
+* @param context The context to interrupt.
 * 
-* @see Wg_RaiseException, Wg_RaiseExceptionObject, Wg_ReraiseExceptionObject
+* @see Wg_CheckTimeout
 */
 WG_DLL_EXPORT
-void Wg_RaiseExceptionClass(Wg_Obj* klass, const char* message WG_DEFAULT_ARG(nullptr));
+void Wg_Interrupt(Wg_Context* context);
 
 /**
-* @brief Raise an existing exception object.
+* @brief Check if any timeout has occurred, the instruction budget has
+* been exceeded, or an interrupt has been requested.
+*
+* If so, a WingsTimeoutError is raised. This is called automatically while
+* code is executed, but native functions that run for a long time can call
+* this function to respond to the limits sooner.
+* 
+* @param context The associated context.
+* @return True if any limit has been hit, otherwise false.
+* 
+* @see Wg_SetTimeout, Wg_ClearTimeout, Wg_SetInstructionBudget, Wg_Interrupt
+*/
+WG_DLL_EXPORT
+bool Wg_CheckTimeout(Wg_Context* context);
+
+/**
+* @brief Start recording where the time of a context is spent.
+*
+* For every script function, the number of calls, the time spent inside it including and
+* excluding the functions it calls, and the number of objects it allocates are recorded.
+* In addition, the currently executing line and call stack are sampled at a regular interval.
+* Samples are only taken while script code is running, so time spent in a native
+* function is attributed to the script code that runs after it returns.
+* 
+* The results of the previous profile are discarded.
+* The profiler has no overhead until it is first started.
+* 
+* @param context The context to profile.
+* @param sampleInterval The interval between samples in microseconds, or 0 to disable sampling.
+* 
+* @see Wg_StopProfiler, Wg_GetProfileReport, Wg_GetProfileCollapsedStacks
+*/
+WG_DLL_EXPORT
+void Wg_StartProfiler(Wg_Context* context, int sampleInterval);
+
+/**
+* @brief Stop recording a profile.
+*
+* The results remain available until the profiler is started again.
+* 
+* @param context The associated context.
+* 
+* @see Wg_StartProfiler
+*/
+WG_DLL_EXPORT
+void Wg_StopProfiler(Wg_Context* context);
+
+/**
+* @brief Get a human readable table of the results of the profiler.
+*
+* The returned string is valid until the next call to this function or Wg_GetProfileCollapsedStacks().
+* 
+* @param context The associated context.
+* @return The report, or an empty string if the profiler has not been started.
+* 
+* @see Wg_StartProfiler, Wg_GetProfileCollapsedStacks
+*/
+WG_DLL_EXPORT
+const char* Wg_GetProfileReport(Wg_Context* context);
+
+/**
+* @brief Get the sampled call stacks of the profiler in the collapsed stack format used by flame graph tools.
+*
+* Each line holds the frames of a stack separated by semicolons, followed by a space and the number of samples.
+* The returned string is valid until the next call to this function or Wg_GetProfileReport().
+* 
+* @param context The associated context.
+* @return The collapsed stacks, or an empty string if the profiler has not been started.
+* 
+* @see Wg_StartProfiler, Wg_GetProfileReport
+*/
+WG_DLL_EXPORT
+const char* Wg_GetProfileCollapsedStacks(Wg_Context* context);
+
+/**
+* @brief Create and raise an exception.
+*
+* If an exception is already set, the old exception will be overwritten.
+*
+* @param context The associated context.
+* @param type The exception type.
+* @param message The error message, or NULL for an empty string.
+* 
+* @see Wg_RaiseExceptionClass, Wg_RaiseExceptionObject, Wg_ReraiseExceptionObject
+*/
+WG_DLL_EXPORT
+void Wg_RaiseException(Wg_Context* context, Wg_Exc type, const char* message WG_DEFAULT_ARG(nullptr));
+
+/**
+* @brief Create and raise an exception using a class object.
+* 
+* The class must derive from BaseException, otherwise a TypeError is raised.
+* 
+* If an exception is already set, the old exception will be overwritten.
+* 
+* @param klass The exception class.
+* @param message The error message, or NULL for an empty string.
+* 
+* @see Wg_RaiseException, Wg_RaiseExceptionObject, Wg_ReraiseExceptionObject
+*/
+WG_DLL_EXPORT
+void Wg_RaiseExceptionClass(Wg_Obj* klass, const char* message WG_DEFAULT_ARG(nullptr));
+
+/**
+* @brief Raise an existing exception object.
 * 
 * The object's type must derive from BaseException, otherwise a TypeError is raised.
 *
@@ -878,6 +1465,21 @@ Wg_Obj* Wg_IsInstance(const Wg_Obj* instance, Wg_Obj*const* types, int typesLen)
 WG_DLL_EXPORT
 Wg_Obj* Wg_GetGlobal(Wg_Context* context, const char* name);
 
+/**
+* @brief Get several global variables in the current module namespace.
+* 
+* @param context The associated context.
+* @param names An array of the names of the global variables.
+* @param len The length of the names and values arrays.
+* @param[out] values An array to receive the values.
+*					  A value is NULL if the global variable does not exist.
+* @return The number of global variables that exist.
+* 
+* @see Wg_GetGlobal
+*/
+WG_DLL_EXPORT
+int Wg_GetGlobals(Wg_Context* context, const char*const* names, int len, Wg_Obj** values);
+
 /**
 * @brief Set a global variable in the current module namespace.
 * 
@@ -926,6 +1528,67 @@ void Wg_PrintString(const Wg_Context* context, const char* message);
 WG_DLL_EXPORT
 void Wg_CollectGarbage(Wg_Context* context);
 
+/**
+* @brief Get the garbage collection and memory statistics of a context.
+* 
+* @param context The associated context.
+* @param[out] stats The statistics.
+* 
+* @see Wg_GetGCPauseHistogram, Wg_GetGCTypeStats, Wg_SetGCCallback
+*/
+WG_DLL_EXPORT
+void Wg_GetGCStats(Wg_Context* context, Wg_GCStats* stats);
+
+/**
+* @brief Get a histogram of the durations of garbage collections.
+* 
+* Bucket 0 counts the collections that took less than 1 microsecond and
+* bucket i counts the collections that took at least 2^(i-1) and less than
+* 2^i microseconds. The last bucket also counts all longer collections.
+* 
+* @param context The associated context.
+* @param[out] counts An array to receive the number of collections in each bucket.
+*					  At most len buckets are written. This parameter may be NULL.
+* @param len The length of the counts array.
+* @return The number of buckets in the histogram.
+* 
+* @see Wg_GetGCStats
+*/
+WG_DLL_EXPORT
+int Wg_GetGCPauseHistogram(Wg_Context* context, int64_t* counts, int len);
+
+/**
+* @brief Get the number of live objects and the bytes they use for each category of object.
+* 
+* This walks the heap so it takes time proportional to the number of objects.
+* 
+* @param context The associated context.
+* @param[out] objects An array indexed by Wg_GCType to receive the object counts.
+*					   At most len values are written. This parameter may be NULL.
+* @param[out] bytes An array indexed by Wg_GCType to receive the byte counts.
+*					 At most len values are written. This parameter may be NULL.
+* @param len The length of the arrays.
+* @return The number of categories, which is WG_GC_TYPE_COUNT.
+* 
+* @see Wg_GetGCStats, Wg_GCType
+*/
+WG_DLL_EXPORT
+int Wg_GetGCTypeStats(Wg_Context* context, int64_t* objects, int64_t* bytes, int len);
+
+/**
+* @brief Set a callback to be invoked after every garbage collection.
+* 
+* The callback is not invoked for the collection that happens when a context is destroyed.
+* 
+* @param context The associated context.
+* @param callback The callback, or NULL to remove the callback.
+* @param userdata The userdata to pass to the callback.
+* 
+* @see Wg_GCCallback, Wg_GetGCStats
+*/
+WG_DLL_EXPORT
+void Wg_SetGCCallback(Wg_Context* context, Wg_GCCallback callback, void* userdata WG_DEFAULT_ARG(nullptr));
+
 /**
 * @brief Increment the reference count of an object.
 * A positive reference count prevents the object from being garbage collected.
@@ -1020,6 +1683,39 @@ Wg_Obj* Wg_NewString(Wg_Context* context, const char* value WG_DEFAULT_ARG(nullp
 WG_DLL_EXPORT
 Wg_Obj* Wg_NewStringBuffer(Wg_Context* context, const char* buffer, int len);
 
+/**
+* @brief Instantiate a bytes object by copying a buffer.
+*
+* @param context The associated context.
+* @param buffer The buffer. This can be NULL if len is 0.
+* @param len The length of the buffer.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewBufferView, Wg_TryGetBuffer
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewBytes(Wg_Context* context, const void* buffer, int len);
+
+/**
+* @brief Instantiate a memoryview object that refers to host memory without copying it.
+*
+* The memory must stay valid until the finalizer is called, which happens once the
+* memoryview and every slice of it have been destroyed or released. If the memoryview
+* could not be created, the finalizer is called before this function returns.
+*
+* @param context The associated context.
+* @param buffer The memory to refer to. This can be NULL if len is 0.
+* @param len The length of the memory in bytes.
+* @param readOnly Whether scripts are prevented from writing to the memory.
+* @param finalizer The function to call when the memory is no longer referenced. This may be NULL.
+* @param userdata The userdata to pass to the finalizer.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewBytes, Wg_TryGetBuffer
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewBufferView(Wg_Context* context, void* buffer, int len, bool readOnly, Wg_Finalizer finalizer WG_DEFAULT_ARG(nullptr), void* userdata WG_DEFAULT_ARG(nullptr));
+
 /**
 * @brief Instantiate a tuple object.
 *
@@ -1080,6 +1776,201 @@ Wg_Obj* Wg_NewDictionary(Wg_Context* context, Wg_Obj** keys WG_DEFAULT_ARG(nullp
 WG_DLL_EXPORT
 Wg_Obj* Wg_NewSet(Wg_Context* context, Wg_Obj** argv WG_DEFAULT_ARG(nullptr), int argc WG_DEFAULT_ARG(0));
 
+/**
+* @brief Instantiate a list object from an array of integers.
+*
+* This is equivalent to creating each item and then the list,
+* but takes a single call.
+*
+* @param context The associated context.
+* @param values An array of values to initialise the list with.
+*               This can be NULL if len is 0.
+* @param len The length of the values array.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewList, Wg_GetInts
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewListFromInts(Wg_Context* context, const Wg_int* values, int len);
+
+/**
+* @brief Instantiate a list object from an array of floats.
+*
+* This is equivalent to creating each item and then the list,
+* but takes a single call.
+*
+* @param context The associated context.
+* @param values An array of values to initialise the list with.
+*               This can be NULL if len is 0.
+* @param len The length of the values array.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewList, Wg_GetFloats
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewListFromFloats(Wg_Context* context, const Wg_float* values, int len);
+
+/**
+* @brief Instantiate a list object from an array of strings.
+*
+* This is equivalent to creating each item and then the list,
+* but takes a single call.
+* Each string must be null terminated UTF-8.
+*
+* @param context The associated context.
+* @param values An array of values to initialise the list with.
+*               This can be NULL if len is 0.
+* @param len The length of the values array.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewList, Wg_GetStrings
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewListFromStrings(Wg_Context* context, const char*const* values, int len);
+
+/**
+* @brief Instantiate a tuple object from an array of integers.
+*
+* This is equivalent to creating each item and then the tuple,
+* but takes a single call.
+*
+* @param context The associated context.
+* @param values An array of values to initialise the tuple with.
+*               This can be NULL if len is 0.
+* @param len The length of the values array.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewTuple, Wg_GetInts
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewTupleFromInts(Wg_Context* context, const Wg_int* values, int len);
+
+/**
+* @brief Instantiate a tuple object from an array of floats.
+*
+* This is equivalent to creating each item and then the tuple,
+* but takes a single call.
+*
+* @param context The associated context.
+* @param values An array of values to initialise the tuple with.
+*               This can be NULL if len is 0.
+* @param len The length of the values array.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewTuple, Wg_GetFloats
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewTupleFromFloats(Wg_Context* context, const Wg_float* values, int len);
+
+/**
+* @brief Instantiate a tuple object from an array of strings.
+*
+* This is equivalent to creating each item and then the tuple,
+* but takes a single call.
+* Each string must be null terminated UTF-8.
+*
+* @param context The associated context.
+* @param values An array of values to initialise the tuple with.
+*               This can be NULL if len is 0.
+* @param len The length of the values array.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewTuple, Wg_GetStrings
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewTupleFromStrings(Wg_Context* context, const char*const* values, int len);
+
+/**
+* @brief Instantiate a dictionary object with string keys from an array of integers.
+*
+* The keys must be null terminated UTF-8. If a key is repeated,
+* the last value is kept.
+*
+* @param context The associated context.
+* @param keys An array of keys to initialise the dictionary with.
+*             This can be NULL if len is 0.
+* @param values An array of values to initialise the dictionary with.
+*               This can be NULL if len is 0.
+* @param len The length of the keys and values arrays.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewDictionary, Wg_GetDictionaryItems
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewDictionaryFromInts(Wg_Context* context, const char*const* keys, const Wg_int* values, int len);
+
+/**
+* @brief Instantiate a dictionary object with string keys from an array of floats.
+*
+* The keys must be null terminated UTF-8. If a key is repeated,
+* the last value is kept.
+*
+* @param context The associated context.
+* @param keys An array of keys to initialise the dictionary with.
+*             This can be NULL if len is 0.
+* @param values An array of values to initialise the dictionary with.
+*               This can be NULL if len is 0.
+* @param len The length of the keys and values arrays.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewDictionary, Wg_GetDictionaryItems
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewDictionaryFromFloats(Wg_Context* context, const char*const* keys, const Wg_float* values, int len);
+
+/**
+* @brief Instantiate a dictionary object with string keys from an array of strings.
+*
+* The keys and values must be null terminated UTF-8. If a key is repeated,
+* the last value is kept.
+*
+* @param context The associated context.
+* @param keys An array of keys to initialise the dictionary with.
+*             This can be NULL if len is 0.
+* @param values An array of values to initialise the dictionary with.
+*               This can be NULL if len is 0.
+* @param len The length of the keys and values arrays.
+* @return The instantiated object, or NULL on failure.
+* 
+* @see Wg_NewDictionary, Wg_GetDictionaryItems
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_NewDictionaryFromStrings(Wg_Context* context, const char*const* keys, const char*const* values, int len);
+
+/**
+* @brief Parse a JSON document into objects.
+*
+* Objects become dictionaries, arrays become lists and numbers become ints, or floats
+* if they have a fraction or exponent or do not fit in an int. NaN, Infinity and
+* -Infinity are accepted. This is the same parser as json.loads() but a ValueError
+* is raised on invalid input.
+*
+* @param context The associated context.
+* @param buffer The UTF-8 document. This can be NULL if len is 0.
+* @param len The length of the buffer in bytes.
+* @return The parsed value, or NULL on failure.
+*
+* @see Wg_ToJson, Wg_GetException, Wg_GetErrorMessage
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_ParseJson(Wg_Context* context, const char* buffer, int len);
+
+/**
+* @brief Serialise an object to a JSON string.
+*
+* Only None, bool, int, float, str, list, tuple and dict objects are accepted.
+* Non-ASCII characters are written as UTF-8 instead of being escaped.
+*
+* @param obj The object to serialise.
+* @param indent The number of spaces to indent nested values by, or -1 to write the
+*               most compact form with no whitespace.
+* @return A str object containing the JSON, or NULL on failure.
+*
+* @see Wg_ParseJson, Wg_GetException, Wg_GetErrorMessage
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_ToJson(Wg_Obj* obj, int indent WG_DEFAULT_ARG(-1));
+
 /**
 * @brief Instantiate a function object.
 * 
@@ -1278,6 +2169,99 @@ Wg_float Wg_GetFloat(const Wg_Obj* obj);
 WG_DLL_EXPORT
 const char* Wg_GetString(const Wg_Obj* obj, int* len WG_DEFAULT_ARG(nullptr));
 
+/**
+* @brief Copy the items of an iterable object into an array of integers.
+*
+* Lists and tuples are read directly. Other objects are iterated over to the end,
+* which means a dictionary gives its keys.
+* If an item is not an int, a TypeError is raised.
+*
+* @param obj The object to read.
+* @param[out] values An array to receive the items. At most len items are written.
+*					  This parameter may be NULL if len is 0.
+* @param len The length of the values array.
+* @return The number of items in obj, which may be more than len, or -1 on failure.
+* 
+* @see Wg_NewListFromInts, Wg_GetException, Wg_GetErrorMessage
+*/
+WG_DLL_EXPORT
+int Wg_GetInts(Wg_Obj* obj, Wg_int* values, int len);
+
+/**
+* @brief Copy the items of an iterable object into an array of floats.
+*
+* Lists and tuples are read directly. Other objects are iterated over to the end,
+* which means a dictionary gives its keys.
+* If an item is not an int or float, a TypeError is raised.
+*
+* @param obj The object to read.
+* @param[out] values An array to receive the items. At most len items are written.
+*					  This parameter may be NULL if len is 0.
+* @param len The length of the values array.
+* @return The number of items in obj, which may be more than len, or -1 on failure.
+* 
+* @see Wg_NewListFromFloats, Wg_GetException, Wg_GetErrorMessage
+*/
+WG_DLL_EXPORT
+int Wg_GetFloats(Wg_Obj* obj, Wg_float* values, int len);
+
+/**
+* @brief Copy the items of an iterable object into an array of strings.
+*
+* Lists and tuples are read directly. Other objects are iterated over to the end,
+* which means a dictionary gives its keys.
+* If an item is not a str, a TypeError is raised.
+*
+* The strings are valid for as long as the string objects are alive.
+*
+* @param obj The object to read.
+* @param[out] values An array to receive the items. At most len items are written.
+*					  This parameter may be NULL if len is 0.
+* @param len The length of the values array.
+* @return The number of items in obj, which may be more than len, or -1 on failure.
+* 
+* @see Wg_NewListFromStrings, Wg_GetException, Wg_GetErrorMessage
+*/
+WG_DLL_EXPORT
+int Wg_GetStrings(Wg_Obj* obj, const char** values, int len);
+
+/**
+* @brief Copy the items of a dictionary into arrays of keys and values.
+*
+* The items are written in insertion order.
+*
+* @param obj The dictionary to read.
+* @param[out] keys An array to receive the keys. At most len keys are written.
+*					This parameter may be NULL.
+* @param[out] values An array to receive the values. At most len values are written.
+*					  This parameter may be NULL.
+* @param len The length of the keys and values arrays.
+* @return The number of items in the dictionary, which may be more than len.
+* 
+* @see Wg_NewDictionary, Wg_IsDictionary
+*/
+WG_DLL_EXPORT
+int Wg_GetDictionaryItems(Wg_Obj* obj, Wg_Obj** keys, Wg_Obj** values, int len);
+
+/**
+* @brief Get the memory of a bytes, bytearray, memoryview or array object without copying it.
+*
+* The items of an array from the array module are int64 or float64 in native byte order.
+*
+* @warning The memory of a bytearray or array may move when it is resized.
+* Do not keep the pointer after running any code that may modify the object.
+*
+* @param obj The object to get the memory from.
+* @param[out] data The memory. This parameter may be NULL.
+* @param[out] len The length of the memory in bytes. This parameter may be NULL.
+* @param[out] readOnly Whether the memory must not be written to. This parameter may be NULL.
+* @return A boolean indicating whether obj is a bytes, bytearray, array or unreleased memoryview.
+* 
+* @see Wg_NewBytes, Wg_NewBufferView
+*/
+WG_DLL_EXPORT
+bool Wg_TryGetBuffer(Wg_Obj* obj, void** data, int* len, bool* readOnly);
+
 /**
 * @brief Set the userdata for an object.
 * 
@@ -1295,6 +2279,22 @@ const char* Wg_GetString(const Wg_Obj* obj, int* len WG_DEFAULT_ARG(nullptr));
 WG_DLL_EXPORT
 void Wg_SetUserdata(Wg_Obj* obj, void* userdata);
 
+/**
+* @brief Report the number of bytes of memory owned by the userdata of an object.
+* 
+* The size counts towards the memory statistics and the maxBytes limit
+* for as long as the object is alive. If the limit would be exceeded,
+* a MemoryError is raised and the previous size is kept.
+* 
+* @param obj The object that owns the userdata.
+* @param size The size of the userdata in bytes.
+* @return A boolean indicating whether the size was set.
+* 
+* @see Wg_SetUserdata, Wg_Config, Wg_GetGCStats
+*/
+WG_DLL_EXPORT
+bool Wg_SetUserdataSize(Wg_Obj* obj, int64_t size);
+
 /**
 * @brief Get the userdata from an object if it is of the expected type.
 *
@@ -1424,6 +2424,22 @@ bool Wg_Iterate(Wg_Obj* obj, void* userdata, Wg_IterationCallback callback);
 WG_DLL_EXPORT
 bool Wg_Unpack(Wg_Obj* obj, int count, Wg_Obj** values);
 
+/**
+* @brief Iterate over an object and store the yielded objects in an array.
+*
+* Iteration stops after len objects, so this can be used with iterators that never end.
+* The objects are not protected from garbage collection after this function returns.
+* 
+* @param obj The object to iterate over.
+* @param[out] values An array to receive the yielded objects.
+* @param len The length of the values array.
+* @return The number of objects written, or -1 on failure.
+* 
+* @see Wg_Iterate, Wg_Unpack
+*/
+WG_DLL_EXPORT
+int Wg_IterateInto(Wg_Obj* obj, Wg_Obj** values, int len);
+
 /**
 * @brief Get the keyword arguments dictionary passed to the current function.
 * 
@@ -1471,6 +2487,24 @@ void* Wg_GetFunctionUserdata(Wg_Context* context);
 WG_DLL_EXPORT
 Wg_Obj* Wg_Call(Wg_Obj* callable, Wg_Obj** argv, int argc, Wg_Obj* kwargs WG_DEFAULT_ARG(nullptr));
 
+/**
+* @brief Call a callable object with keyword arguments stored in an array.
+* 
+* This avoids creating a dictionary for the keyword arguments.
+* 
+* @param callable The object to call.
+* @param argv An array of the positional arguments followed by the
+*             values of the keyword arguments.
+* @param argc The number of positional arguments in argv.
+* @param kwnames A tuple of strings naming the keyword arguments at the
+*                end of argv, or NULL if there are none.
+* @return The return value of the callable, or NULL on failure.
+* 
+* @see Wg_Call
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_CallVector(Wg_Obj* callable, Wg_Obj** argv, int argc, Wg_Obj* kwnames);
+
 /**
 * @brief Call a method on a object.
 * 
@@ -1518,6 +2552,77 @@ Wg_Obj* Wg_CallMethod(Wg_Obj* obj, const char* method, Wg_Obj** argv, int argc,
 WG_DLL_EXPORT
 Wg_Obj* Wg_CallMethodFromBase(Wg_Obj* obj, const char* method, Wg_Obj** argv, int argc, Wg_Obj* kwargs WG_DEFAULT_ARG(nullptr), Wg_Obj* baseClass WG_DEFAULT_ARG(nullptr));
 
+/**
+* @brief Call a callable object so that native functions called by it can suspend it.
+* 
+* A native function called directly by the callable, or by a script function that
+* was itself called directly by a script, may return the result of Wg_Suspend().
+* The script frames are then kept in the context and this function returns NULL
+* without raising an exception. The host resumes the call with Wg_Resume()
+* once the result is ready.
+* 
+* A context has at most one suspended call, and no script may be
+* running in the context when this function is called.
+* 
+* @param callable The object to call.
+* @param argv An array of arguments to pass to the callable object.
+*             If argc is 0 then this can be NULL.
+* @param argc The length of the argv array.
+* @return The return value of the callable, or NULL on failure or suspension.
+* 
+* @see Wg_Suspend, Wg_Resume, Wg_IsSuspended
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_CallSuspendable(Wg_Obj* callable, Wg_Obj** argv, int argc);
+
+/**
+* @brief Suspend the script calling the current native function.
+* 
+* The native function must return the result of this function immediately.
+* The value passed to Wg_Resume() then becomes the return value of the native function.
+* 
+* A RuntimeError is raised if the call cannot be suspended, for example if
+* it was not made directly by a script started with Wg_CallSuspendable(),
+* or if the script was called by another native function such as map().
+* 
+* @note This function must be called inside a function bound with Wg_NewFunction() or Wg_BindMethod().
+* 
+* @param context The associated context.
+* @return The value to return from the native function, or NULL on failure.
+* 
+* @see Wg_CallSuspendable, Wg_Resume
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_Suspend(Wg_Context* context);
+
+/**
+* @brief Check whether the context has a suspended call waiting for Wg_Resume().
+* 
+* @param context The associated context.
+* @return True if the last call to Wg_CallSuspendable() or Wg_Resume() was suspended.
+* 
+* @see Wg_CallSuspendable, Wg_Resume
+*/
+WG_DLL_EXPORT
+bool Wg_IsSuspended(Wg_Context* context);
+
+/**
+* @brief Resume the suspended call of a context.
+* 
+* The suspended native function returns the value, or raises
+* the exception instead if it is not NULL. The call may be suspended again.
+* 
+* @param context The associated context.
+* @param value The return value of the suspended native function. This is ignored if exception is not NULL.
+* @param exception An exception class or instance to raise, or NULL.
+* @return The return value of the callable passed to Wg_CallSuspendable(),
+* or NULL on failure or suspension.
+* 
+* @see Wg_CallSuspendable, Wg_IsSuspended
+*/
+WG_DLL_EXPORT
+Wg_Obj* Wg_Resume(Wg_Context* context, Wg_Obj* value, Wg_Obj* exception WG_DEFAULT_ARG(nullptr));
+
 /**
 * @brief Get the values from a kwargs parameter.
 * 
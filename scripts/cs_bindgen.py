@@ -8,9 +8,14 @@ RETURN = {
     "bool":                     ("bool",                    "byte"),
     "int":                      ("int",                     "int"),
     "Wg_int":                   ("long",                    "long"),
-    "Wg_float":                 ("float",                   "float"),
+    "int64_t":                  ("long",                    "long"),
+    "Wg_float":                 ("double",                  "double"),
     "Wg_Obj*":                  ("Obj",                     "Obj"),
     "Wg_Context*":              ("Context",                 "Context"),
+    "Wg_Snapshot*":             ("Snapshot",                "Snapshot"),
+    "Wg_ContextPool*":          ("ContextPool",             "ContextPool"),
+    "Wg_Future*":               ("Future",                  "Future"),
+    "Wg_Program*":              ("Program",                 "Program"),
     "const char*":              ("string",                  "IntPtr"),
     "void*":                    ("IntPtr",                  "IntPtr"),
 }
@@ -19,12 +24,19 @@ IN_PARAM = {
     "const Wg_Config*":         ("Config?",                 "IntPtr"),
     "const Wg_Context*":        ("Context",                 "Context"),
     "Wg_Context*":              ("Context",                 "Context"),
+    "const Wg_Snapshot*":       ("Snapshot",                "Snapshot"),
+    "Wg_Snapshot*":             ("Snapshot",                "Snapshot"),
+    "Wg_ContextPool*":          ("ContextPool",             "ContextPool"),
+    "Wg_Future*":               ("Future",                  "Future"),
+    "const Wg_Program*":        ("Program",                 "Program"),
+    "Wg_Program*":              ("Program",                 "Program"),
     "const char*":              ("string",                  "IntPtr"),
     "Wg_ErrorCallback":         ("ErrorCallback",           "ErrorCallback"),
     "Wg_Function":              ("Function",                "Function"),
     "Wg_Finalizer":             ("Finalizer",               "Finalizer"),
     "Wg_IterationCallback":     ("IterationCallback",       "IterationCallback"),
     "Wg_ModuleLoader":          ("ModuleLoader",            "ModuleLoader"),
+    "Wg_GCCallback":            ("GCCallback",              "GCCallback"),
     "Wg_Exc":                   ("Exc",                     "Exc"),
     "Wg_UnOp":                  ("UnOp",                    "UnOp"),
     "Wg_BinOp":                 ("BinOp",                   "BinOp"),
@@ -33,22 +45,33 @@ IN_PARAM = {
     "bool":                     ("bool",                    "byte"),
     "int":                      ("int",                     "int"),
     "Wg_int":                   ("long",                    "long"),
-    "Wg_float":                 ("float",                   "float"),
+    "int64_t":                  ("long",                    "long"),
+    "Wg_float":                 ("double",                  "double"),
+    "const Wg_int*":            ("long[]",                  "IntPtr"),
+    "const Wg_float*":          ("double[]",                "IntPtr"),
     "Wg_Obj*const*":            ("Obj[]",                   "IntPtr"),
     "Wg_Obj**":                 ("Obj[]",                   "IntPtr"),
     "void*":                    ("IntPtr",                  "IntPtr"),
+    "const void*":              ("IntPtr",                  "IntPtr"),
     "const char*const*":        ("string[]",                "IntPtr"),
 }
 
 OUT_PARAM = {
     "Wg_Config*":               ("out Config",              "out Wg_ConfigNative"),
+    "Wg_GCStats*":              ("out GCStats",             "out Wg_GCStatsNative"),
     "int*":                     ("out int",                 "out int"),
+    "bool*":                    ("out bool",                "out byte"),
     "void**":                   ("out IntPtr",              "out IntPtr"),
     "Wg_Obj**":                 ("Obj[]",                   "[In, Out] Obj[]"),
+    "int64_t*":                 ("long[]",                  "[In, Out] long[]"),
+    "Wg_int*":                  ("long[]",                  "[In, Out] long[]"),
+    "Wg_float*":                ("double[]",                "[In, Out] double[]"),
+    "const char**":             ("string?[]",               "[In, Out] IntPtr[]"),
 }
 
 FIELDS = {
     "int":                      ("int",                     "int"),
+    "int64_t":                  ("long",                    "long"),
     "float":                    ("float",                   "float"),
     "bool":                     ("bool",                    "byte"),
     "void*":                    ("IntPtr",                  "IntPtr"),
@@ -80,12 +103,27 @@ class OutParam(Param):
         self.in_name = param.name
         self.out_name = "out " + param.name
 
-        if type == "Wg_Obj**":
+        if type in ("Wg_Obj**", "int64_t*", "Wg_int*", "Wg_float*"):
             self.out_name = param.name
-        elif type == "Wg_Config*":
+        elif type == "const char**":
+            self.out_name = f"_{param.name}"
+            self.setup = [
+                f"var _{param.name} = {param.name} is null ? null : new IntPtr[{param.name}.Length];",
+            ]
+            self.cleanup = [
+                f"for (int i = 0; {param.name} is not null && i < {param.name}.Length && i < r; i++) {{",
+                f"{param.name}[i] = Marshal.PtrToStringUTF8(_{param.name}![i]);",
+                "}",
+            ]
+        elif type == "bool*":
             self.out_name = f"out var _{param.name}"
             self.cleanup = [
-                f"{param.name} = MakeWg_Config(_{param.name});",
+                f"{param.name} = _{param.name} != 0;",
+            ]
+        elif type in ("Wg_Config*", "Wg_GCStats*"):
+            self.out_name = f"out var _{param.name}"
+            self.cleanup = [
+                f"{param.name} = Make{type[:-1]}(_{param.name});",
             ]
 
 class InParam(Param):
@@ -111,7 +149,7 @@ class InParam(Param):
             self.out_name = "(IntPtr)_" + param.name
             self.setup = [
                 f"var handles = {self.in_name}.Select(x => "
-                + f"GCHandle.Alloc(Encoding.ASCII.GetBytes(x + '\\0'), GCHandleType.Pinned)).ToArray();",
+                + f"GCHandle.Alloc(Encoding.UTF8.GetBytes(x + '\\0'), GCHandleType.Pinned)).ToArray();",
                 
                 f"fixed(void* _{param.name} = handles.Select(x => x.AddrOfPinnedObject()).ToArray()) {{",
             ]
@@ -175,6 +213,10 @@ class CSBindGen:
         self.write("public static class Wg {")
 
         self.write_ptr_newtype("Context")
+        self.write_ptr_newtype("Snapshot")
+        self.write_ptr_newtype("ContextPool")
+        self.write_ptr_newtype("Future")
+        self.write_ptr_newtype("Program")
         self.write_ptr_newtype("Obj")
 
         self.write_calling_convention()
@@ -190,6 +232,8 @@ class CSBindGen:
         self.write_calling_convention()
         self.write("[return: MarshalAs(UnmanagedType.U1)]")
         self.write("public delegate bool ModuleLoader(Context context);")
+        self.write_calling_convention()
+        self.write("public delegate void GCCallback(Context context, IntPtr userdata);")
         self.write("\n")
 
         for struct in defs.structs:
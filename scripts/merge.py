@@ -50,7 +50,7 @@ def main():
     # /single_include
     output_path = PROJECT_ROOT.joinpath("single_include").absolute()
 
-    source = [f for f in input_path.glob("*.cpp") if not should_ignore(f)]
+    source = [f for f in sorted(input_path.glob("*.cpp")) if not should_ignore(f)]
     main_header = input_path.joinpath("wings.h")
 
     os.makedirs(output_path, exist_ok=True)